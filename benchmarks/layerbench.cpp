@@ -0,0 +1,621 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Per-Layer Micro-Benchmarks
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <iostream>
+#include <benchmark/benchmark.h>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include <fyusenet/fyusenet.h>
+#include <fyusenet/gl/glinfo.h>
+#include <fyusenet/cpu/convlayerbuilder.h>
+#include <fyusenet/cpu/reducelayerbuilder.h>
+#include <fyusenet/gpu/custom/sequence/linear_gateup.h>
+#include <fyusenet/gpu/custom/sequence/linear_hadamard.h>
+#include "layerbenchbase.h"
+
+//-------------------------------------- Global Variables ------------------------------------------
+
+
+//-------------------------------------- Local Definitions -----------------------------------------
+
+using namespace fyusion::fyusenet;
+
+/**
+ * @brief Benchmark a GPU layer, marking the benchmark as failed if the layer cannot be built
+ *
+ * @param state Benchmark state
+ * @param builder Builder for the layer under test, ownership is transferred
+ * @param paramElements Number of random parameter elements that the layer requires
+ */
+static void runGPU(benchmark::State & state, gpu::GPULayerBuilder * builder, size_t paramElements, int inputChannels = 0) {
+    try {
+        LayerBench bench;
+        bench.gpuLayer(builder, paramElements, inputChannels);
+        bench.run(state);
+    } catch (std::exception & ex) {
+        state.SkipWithError(ex.what());
+    }
+}
+
+
+/**
+ * @brief Benchmark a GPU sequence layer, marking the benchmark as failed if the layer cannot be built
+ *
+ * @param state Benchmark state
+ * @param builder Builder for the layer under test, ownership is transferred
+ * @param tokens Number of tokens to process per run
+ * @param position Sequence position of the first token per run
+ * @param paramElements Number of random parameter elements that the layer requires
+ * @param weightType Data type of the layer weights
+ * @param inputChannels Number of channels per input token, 0 to use the builder's input channels
+ */
+static void runSequence(benchmark::State & state, gpu::GPULayerBuilder * builder, int tokens, int position, size_t paramElements,
+                        param_type weightType = param_type::WGT_FLOAT32, int inputChannels = 0) {
+    try {
+        LayerBench bench;
+        bench.sequenceLayer(builder, tokens, position, paramElements, weightType, inputChannels);
+        bench.run(state);
+    } catch (std::exception & ex) {
+        state.SkipWithError(ex.what());
+    }
+}
+
+
+/**
+ * @brief Benchmark a CPU layer, marking the benchmark as failed if the layer cannot be built
+ *
+ * @param state Benchmark state
+ * @param builder Builder for the layer under test, ownership is transferred
+ * @param paramElements Number of random parameter elements that the layer requires
+ */
+static void runCPU(benchmark::State & state, LayerBuilder * builder, size_t paramElements) {
+    try {
+        LayerBench bench;
+        bench.cpuLayer(builder, paramElements);
+        bench.run(state);
+    } catch (std::exception & ex) {
+        state.SkipWithError(ex.what());
+    }
+}
+
+
+/*##################################################################################################
+#                                      G P U   L A Y E R S                                         #
+##################################################################################################*/
+
+/**
+ * Arguments: spatial size, channels, kernel size
+ */
+static void BM_DeepConv(benchmark::State & state) {
+    int size = (int)state.range(0), chans = (int)state.range(1), kernel = (int)state.range(2);
+    auto * bld = new gpu::ConvLayerBuilder(kernel, "deepconv");
+    bld->type(LayerType::CONVOLUTION2D).shape(chans, size, size, chans).deep().inputPadding(kernel/2);
+    runGPU(state, (gpu::GPULayerBuilder *)bld, (size_t)kernel * kernel * chans * chans + 4 * chans);
+}
+
+BENCHMARK(BM_DeepConv)->ArgNames({"size", "chans", "kernel"})->ArgsProduct({{32, 64, 112}, {16, 64, 128}, {1, 3}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels, kernel size
+ */
+static void BM_ShallowConv(benchmark::State & state) {
+    int size = (int)state.range(0), chans = (int)state.range(1), kernel = (int)state.range(2);
+    auto * bld = new gpu::ConvLayerBuilder(kernel, "conv");
+    bld->type(LayerType::CONVOLUTION2D).shape(chans, size, size, chans).inputPadding(kernel/2);
+    runGPU(state, (gpu::GPULayerBuilder *)bld, (size_t)kernel * kernel * chans * chans + 4 * chans);
+}
+
+BENCHMARK(BM_ShallowConv)->ArgNames({"size", "chans", "kernel"})->ArgsProduct({{64, 128, 224}, {4, 8, 16}, {1, 3}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels
+ */
+static void BM_DeepPool(benchmark::State & state, gpu::PoolLayerBuilder::op op) {
+    int size = (int)state.range(0), chans = (int)state.range(1);
+    auto * bld = new gpu::PoolLayerBuilder(op, "deeppool");
+    bld->poolSize(2).downsample(2).shape(chans, size, size, chans).deep();
+    runGPU(state, (gpu::GPULayerBuilder *)bld, 0);
+}
+
+BENCHMARK_CAPTURE(BM_DeepPool, max, gpu::PoolLayerBuilder::POOL_MAX)->ArgNames({"size", "chans"})->ArgsProduct({{32, 64, 112}, {16, 64, 128}})->UseRealTime();
+BENCHMARK_CAPTURE(BM_DeepPool, avg, gpu::PoolLayerBuilder::POOL_AVG)->ArgNames({"size", "chans"})->ArgsProduct({{32, 64, 112}, {16, 64, 128}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels
+ */
+static void BM_DeepElementwise(benchmark::State & state, LayerType type) {
+    int size = (int)state.range(0), chans = (int)state.range(1);
+    auto * bld = new gpu::GPULayerBuilder("deepelem");
+    bld->type(type).shape(chans, size, size, chans).deep();
+    runGPU(state, bld, 2 * chans);
+}
+
+BENCHMARK_CAPTURE(BM_DeepElementwise, batchnorm, LayerType::BATCHNORM)->ArgNames({"size", "chans"})->ArgsProduct({{32, 64, 112}, {16, 64, 128}})->UseRealTime();
+BENCHMARK_CAPTURE(BM_DeepElementwise, sigmoid, LayerType::SIGMOID)->ArgNames({"size", "chans"})->ArgsProduct({{32, 64, 112}, {16, 64, 128}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels
+ */
+static void BM_ShallowElementwise(benchmark::State & state, LayerType type) {
+    int size = (int)state.range(0), chans = (int)state.range(1);
+    auto * bld = new gpu::GPULayerBuilder("elem");
+    bld->type(type).shape(chans, size, size, chans);
+    runGPU(state, bld, 2 * chans);
+}
+
+BENCHMARK_CAPTURE(BM_ShallowElementwise, sigmoid, LayerType::SIGMOID)->ArgNames({"size", "chans"})->ArgsProduct({{64, 128, 224}, {4, 8, 16}})->UseRealTime();
+BENCHMARK_CAPTURE(BM_ShallowElementwise, batchnorm, LayerType::BATCHNORM)->ArgNames({"size", "chans"})->ArgsProduct({{64, 128, 224}, {4, 8, 16}})->UseRealTime();
+BENCHMARK_CAPTURE(BM_ShallowElementwise, silu, LayerType::SILU)->ArgNames({"size", "chans"})->ArgsProduct({{64, 128, 224}, {4, 8, 16}})->UseRealTime();
+BENCHMARK_CAPTURE(BM_ShallowElementwise, gelu, LayerType::GELU)->ArgNames({"size", "chans"})->ArgsProduct({{64, 128, 224}, {4, 8, 16}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels
+ */
+static void BM_DeepArgMax(benchmark::State & state) {
+    int size = (int)state.range(0), chans = (int)state.range(1);
+    auto * bld = new gpu::ArgMaxLayerBuilder("argmax");
+    bld->shape(2, size, size, chans).deep();
+    runGPU(state, (gpu::GPULayerBuilder *)bld, 0);
+}
+
+BENCHMARK(BM_DeepArgMax)->ArgNames({"size", "chans"})->ArgsProduct({{32, 64, 112}, {16, 64, 128}})->UseRealTime();
+
+
+/**
+ * Arguments: channels, K
+ */
+static void BM_DeepTopK(benchmark::State & state) {
+    int chans = (int)state.range(0), k = (int)state.range(1);
+    auto * bld = new gpu::TopKLayerBuilder("topk");
+    bld->topK(k).softmax().shape(chans, 1, 1, chans).deep();
+    runGPU(state, (gpu::GPULayerBuilder *)bld, 0);
+}
+
+BENCHMARK(BM_DeepTopK)->ArgNames({"chans", "k"})->ArgsProduct({{128, 1000}, {1, 5}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels, kernel size
+ */
+static void BM_DeepTransConv(benchmark::State & state) {
+    int size = (int)state.range(0), chans = (int)state.range(1), kernel = (int)state.range(2);
+    auto * bld = new gpu::ConvLayerBuilder(kernel, "deeptransconv");
+    bld->type(LayerType::TRANSCONVOLUTION2D).shape(chans, size, size, chans).upsample(2).deep();
+    runGPU(state, (gpu::GPULayerBuilder *)bld, (size_t)kernel * kernel * chans * chans + 4 * chans);
+}
+
+BENCHMARK(BM_DeepTransConv)->ArgNames({"size", "chans", "kernel"})->ArgsProduct({{32, 64}, {16, 32}, {2, 3}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size
+ *
+ * Only 2x2 kernels and 4 channels, the shallow 2x2 weight layout does not support multiple render
+ * targets and the shallow 3x3 shader does not compile (yet)
+ */
+static void BM_ShallowTransConv(benchmark::State & state) {
+    int size = (int)state.range(0);
+    auto * bld = new gpu::ConvLayerBuilder(2, "transconv");
+    bld->type(LayerType::TRANSCONVOLUTION2D).shape(4, size, size, 4).upsample(2);
+    runGPU(state, (gpu::GPULayerBuilder *)bld, 4 * 4 * 4 + 4 * 4);
+}
+
+BENCHMARK(BM_ShallowTransConv)->ArgNames({"size"})->Arg(64)->Arg(128)->Arg(224)->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels
+ */
+static void BM_ShallowFracConv(benchmark::State & state) {
+    int size = (int)state.range(0), chans = (int)state.range(1);
+    auto * bld = new gpu::ConvLayerBuilder(3, "fracconv");
+    bld->type(LayerType::FRACCONVOLUTION2D).shape(chans, size, size, chans).sourceStep(0.5f).inputPadding(1);
+    runGPU(state, (gpu::GPULayerBuilder *)bld, (size_t)9 * chans * chans + 4 * chans);
+}
+
+BENCHMARK(BM_ShallowFracConv)->ArgNames({"size", "chans"})->ArgsProduct({{64, 128}, {4, 8}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels
+ */
+static void BM_DeepDepthwiseConv(benchmark::State & state) {
+    int size = (int)state.range(0), chans = (int)state.range(1);
+    auto * bld = new gpu::ConvLayerBuilder(3, "deepdwconv");
+    bld->type(LayerType::CONVOLUTION2D).shape(chans, size, size, chans).groupSize(chans).deep().inputPadding(1);
+    runGPU(state, (gpu::GPULayerBuilder *)bld, (size_t)9 * chans + 4 * chans);
+}
+
+BENCHMARK(BM_DeepDepthwiseConv)->ArgNames({"size", "chans"})->ArgsProduct({{32, 64, 112}, {16, 64, 128}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels
+ */
+static void BM_ShallowDepthwiseConv(benchmark::State & state) {
+    int size = (int)state.range(0), chans = (int)state.range(1);
+    auto * bld = new gpu::ConvLayerBuilder(3, "dwconv");
+    bld->type(LayerType::CONVOLUTION2D).shape(chans, size, size, chans).groupSize(chans).inputPadding(1);
+    runGPU(state, (gpu::GPULayerBuilder *)bld, (size_t)9 * chans + 4 * chans);
+}
+
+BENCHMARK(BM_ShallowDepthwiseConv)->ArgNames({"size", "chans"})->ArgsProduct({{64, 128, 224}, {4, 8, 16}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels
+ */
+static void BM_DeepScale(benchmark::State & state, ScalingType type) {
+    int size = (int)state.range(0), chans = (int)state.range(1);
+    auto * bld = new gpu::ScaleLayerBuilder("deepscale");
+    bld->scaleType(type).type(LayerType::SCALE2D).upsample(2).shape(chans, size, size, chans).deep();
+    runGPU(state, (gpu::GPULayerBuilder *)bld, 0);
+}
+
+BENCHMARK_CAPTURE(BM_DeepScale, nearest, ScalingType::NEAREST)->ArgNames({"size", "chans"})->ArgsProduct({{32, 64}, {16, 64}})->UseRealTime();
+BENCHMARK_CAPTURE(BM_DeepScale, linear, ScalingType::LINEAR)->ArgNames({"size", "chans"})->ArgsProduct({{32, 64}, {16, 64}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels
+ */
+static void BM_DeepPadding(benchmark::State & state) {
+    int size = (int)state.range(0), chans = (int)state.range(1);
+    auto * bld = new gpu::GPULayerBuilder("deeppad");
+    bld->type(LayerType::PADDING2D).shape(chans, size, size, chans).outputPadding(1).deep();
+    runGPU(state, bld, 0);
+}
+
+BENCHMARK(BM_DeepPadding)->ArgNames({"size", "chans"})->ArgsProduct({{32, 64, 112}, {16, 64}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels (per input)
+ */
+static void BM_ShallowConcat(benchmark::State & state) {
+    int size = (int)state.range(0), chans = (int)state.range(1);
+    auto * bld = new gpu::ConcatLayerBuilder("concat");
+    bld->size(size, size).outChannels(2 * chans);
+    bld->input(chans, 0).input(chans, 0);
+    runGPU(state, (gpu::GPULayerBuilder *)bld, 0, chans);
+}
+
+BENCHMARK(BM_ShallowConcat)->ArgNames({"size", "chans"})->ArgsProduct({{64, 128, 224}, {3, 6}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels
+ */
+static void BM_Shallow2Deep(benchmark::State & state) {
+    int size = (int)state.range(0), chans = (int)state.range(1);
+    auto * bld = new gpu::GPULayerBuilder("s2d");
+    bld->type(LayerType::SHALLOW2DEEP).shape(chans, size, size, chans).deep();
+    runGPU(state, bld, 0);
+}
+
+BENCHMARK(BM_Shallow2Deep)->ArgNames({"size", "chans"})->ArgsProduct({{64, 128, 224}, {4, 16, 64}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels
+ */
+static void BM_Deep2Shallow(benchmark::State & state) {
+    int size = (int)state.range(0), chans = (int)state.range(1);
+    auto * bld = new gpu::GPULayerBuilder("d2s");
+    bld->type(LayerType::DEEP2SHALLOW).shape(chans, size, size, chans);
+    runGPU(state, bld, 0);
+}
+
+BENCHMARK(BM_Deep2Shallow)->ArgNames({"size", "chans"})->ArgsProduct({{64, 128, 224}, {4, 16, 64}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels
+ */
+static void BM_DeepTranspose(benchmark::State & state) {
+    int size = (int)state.range(0), chans = (int)state.range(1);
+    auto * bld = new gpu::TransposeLayerBuilder("deeptranspose");
+    bld->shape(chans, size, size, chans).deep();
+    runGPU(state, (gpu::GPULayerBuilder *)bld, 0);
+}
+
+BENCHMARK(BM_DeepTranspose)->ArgNames({"size", "chans"})->ArgsProduct({{32, 64, 112}, {16, 64}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels
+ */
+static void BM_DeepTanh(benchmark::State & state) {
+    int size = (int)state.range(0), chans = (int)state.range(1);
+    auto * bld = new gpu::GPULayerBuilder("deeptanh");
+    bld->type(LayerType::TANH).shape(chans, size, size, chans).deep();
+    runGPU(state, bld, 0);
+}
+
+BENCHMARK(BM_DeepTanh)->ArgNames({"size", "chans"})->ArgsProduct({{32, 64, 112}, {16, 64, 128}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels
+ */
+static void BM_DeepSingletonArith(benchmark::State & state) {
+    int size = (int)state.range(0), chans = (int)state.range(1);
+    auto * bld = new gpu::SingletonArithLayerBuilder("deeparith", ArithType::MUL);
+    bld->operand(0.5f).shape(chans, size, size, chans).deep();
+    runGPU(state, (gpu::GPULayerBuilder *)bld, 0);
+}
+
+BENCHMARK(BM_DeepSingletonArith)->ArgNames({"size", "chans"})->ArgsProduct({{32, 64, 112}, {16, 64}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels
+ */
+static void BM_DeepCast(benchmark::State & state) {
+    int size = (int)state.range(0), chans = (int)state.range(1);
+    auto * bld = new gpu::CastLayerBuilder("deepcast", CastTarget::CT_INT32);
+    bld->shape(chans, size, size, chans).deep();
+    runGPU(state, (gpu::GPULayerBuilder *)bld, 0);
+}
+
+BENCHMARK(BM_DeepCast)->ArgNames({"size", "chans"})->ArgsProduct({{32, 64, 112}, {16, 64}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels
+ */
+static void BM_ShallowCast(benchmark::State & state) {
+    int size = (int)state.range(0), chans = (int)state.range(1);
+    auto * bld = new gpu::CastLayerBuilder("cast", CastTarget::CT_INT32);
+    bld->shape(chans, size, size, chans);
+    runGPU(state, (gpu::GPULayerBuilder *)bld, 0);
+}
+
+BENCHMARK(BM_ShallowCast)->ArgNames({"size", "chans"})->ArgsProduct({{64, 128, 224}, {4, 16}})->UseRealTime();
+
+
+/**
+ * Arguments: channels (input and output)
+ */
+static void BM_DeepGEMM(benchmark::State & state) {
+    int chans = (int)state.range(0);
+    auto * bld = new gpu::GPULayerBuilder("deepgemm");
+    bld->type(LayerType::GEMM).shape(chans, 1, 1, chans).deep();
+    runGPU(state, bld, (size_t)chans * chans + chans);
+}
+
+BENCHMARK(BM_DeepGEMM)->ArgNames({"chans"})->Arg(256)->Arg(1024)->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels
+ */
+static void BM_ShallowNonMax(benchmark::State & state) {
+    int size = (int)state.range(0), chans = (int)state.range(1);
+    auto * bld = new gpu::GPULayerBuilder("nonmax");
+    bld->type(LayerType::NONMAX2D).shape(chans, size, size, chans).inputPadding(1);
+    runGPU(state, bld, 0);
+}
+
+BENCHMARK(BM_ShallowNonMax)->ArgNames({"size", "chans"})->ArgsProduct({{64, 128, 224}, {1, 4}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size
+ */
+static void BM_ShallowCompact(benchmark::State & state) {
+    int size = (int)state.range(0);
+    auto * bld = new gpu::CompactLayerBuilder("compact");
+    bld->slots(16, 16).threshold(0.9f).shape(4, size, size, 4);
+    runGPU(state, (gpu::GPULayerBuilder *)bld, 0);
+}
+
+BENCHMARK(BM_ShallowCompact)->ArgNames({"size"})->Arg(64)->Arg(128)->Arg(224)->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels
+ */
+static void BM_ShallowBlur(benchmark::State & state) {
+    int size = (int)state.range(0), chans = (int)state.range(1);
+    auto * bld = new gpu::BlurLayerBuilder("blur");
+    bld->kernel(3).blurType(BlurKernelType::GAUSSIAN).shape(chans, size, size, chans).inputPadding(1);
+    runGPU(state, (gpu::GPULayerBuilder *)bld, 0);
+}
+
+BENCHMARK(BM_ShallowBlur)->ArgNames({"size", "chans"})->ArgsProduct({{64, 128, 224}, {4, 8}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size
+ */
+static void BM_ShallowRGB2BGR(benchmark::State & state) {
+    int size = (int)state.range(0);
+    auto * bld = new gpu::GPULayerBuilder("rgb2bgr");
+    bld->type(LayerType::RGB2BGR).shape(3, size, size, 3);
+    runGPU(state, bld, 0);
+}
+
+BENCHMARK(BM_ShallowRGB2BGR)->ArgNames({"size"})->Arg(64)->Arg(128)->Arg(224)->UseRealTime();
+
+
+/*##################################################################################################
+#                                 S E Q U E N C E   L A Y E R S                                    #
+##################################################################################################*/
+
+/**
+ * Arguments: tokens per run, embedding dimension
+ */
+static void BM_SeqEmbedding(benchmark::State & state) {
+    int tokens = (int)state.range(0), embed = (int)state.range(1);
+    const int rows = 1024;
+    auto * bld = new gpu::EmbeddingLayerBuilder("embedding");
+    bld->sequence(64).outChannels(embed).tableRows(rows);
+    runSequence(state, (gpu::GPULayerBuilder *)bld, tokens, 0, (size_t)rows * embed);
+}
+
+BENCHMARK(BM_SeqEmbedding)->ArgNames({"tokens", "embed"})->ArgsProduct({{1, 64}, {256, 1024}})->UseRealTime();
+
+
+/**
+ * Arguments: tokens per run, embedding dimension
+ */
+static void BM_SeqRMSNorm(benchmark::State & state) {
+    int tokens = (int)state.range(0), embed = (int)state.range(1);
+    auto * bld = new gpu::GPULayerBuilder("rmsnorm");
+    bld->sequence(64).channels(embed).type(LayerType::RMSNORM);
+    runSequence(state, bld, tokens, 0, embed);
+}
+
+BENCHMARK(BM_SeqRMSNorm)->ArgNames({"tokens", "embed"})->ArgsProduct({{1, 64}, {256, 1024}})->UseRealTime();
+
+
+/**
+ * Arguments: tokens per run, input dimension, output dimension
+ */
+static void BM_SeqLinear(benchmark::State & state) {
+    int tokens = (int)state.range(0), in = (int)state.range(1), out = (int)state.range(2);
+    auto * bld = new gpu::LinearLayerBuilder("linear");
+    bld->quantize(qt_type::QT_MIXED_FLOAT, param_type::WGT_INT4).quantGroupSize(128).sequence(64).inChannels(in).outChannels(out);
+    runSequence(state, (gpu::GPULayerBuilder *)bld, tokens, 0, (size_t)in * out, param_type::WGT_INT4);
+}
+
+BENCHMARK(BM_SeqLinear)->ArgNames({"tokens", "in", "out"})->ArgsProduct({{1, 64}, {256, 1024}, {256, 1024}})->UseRealTime();
+
+
+/**
+ * Arguments: tokens per run, embedding dimension, MLP dimension
+ */
+static void BM_SeqGateUp(benchmark::State & state) {
+    using namespace gpu::custom::sequence;
+    int tokens = (int)state.range(0), embed = (int)state.range(1), mlp = (int)state.range(2);
+    auto * bld = LinearGateUpLayer::createBuilder("gateup", "gate", "up", qt_type::QT_MIXED_FLOAT, param_type::WGT_INT4, 128);
+    bld->sequence(64).inChannels(embed).outChannels(mlp);
+    runSequence(state, (gpu::GPULayerBuilder *)bld, tokens, 0, (size_t)embed * mlp, param_type::WGT_INT4);
+}
+
+BENCHMARK(BM_SeqGateUp)->ArgNames({"tokens", "embed", "mlp"})->ArgsProduct({{1, 64}, {256, 1024}, {1024}})->UseRealTime();
+
+
+/**
+ * Arguments: tokens per run, MLP dimension, embedding dimension
+ */
+static void BM_SeqHadamard(benchmark::State & state) {
+    using namespace gpu::custom::sequence;
+    int tokens = (int)state.range(0), mlp = (int)state.range(1), embed = (int)state.range(2);
+    auto * bld = LinearHadamardLayer::createBuilder("down", qt_type::QT_MIXED_FLOAT, param_type::WGT_INT4, 128, false, true);
+    bld->sequence(64).inChannels(mlp).outChannels(embed).prefixAct(ActType::SILU, 1);
+    // gate and up projections arrive interleaved in a single input
+    runSequence(state, (gpu::GPULayerBuilder *)bld, tokens, 0, (size_t)embed * mlp, param_type::WGT_INT4, 2 * mlp);
+}
+
+BENCHMARK(BM_SeqHadamard)->ArgNames({"tokens", "mlp", "embed"})->ArgsProduct({{1, 64}, {1024}, {256, 1024}})->UseRealTime();
+
+
+/**
+ * Arguments: tokens per run, sequence position, embedding dimension
+ */
+static void BM_SeqAttention(benchmark::State & state) {
+    int tokens = (int)state.range(0), position = (int)state.range(1), embed = (int)state.range(2);
+    const int headdim = 64;
+    auto * bld = new gpu::AttentionLayerBuilder("att");
+    bld->sequence(256).channels(embed).heads(embed / headdim).headDim(headdim)
+        .quantize(qt_type::QT_MIXED_FLOAT, param_type::WGT_INT4).quantGroupSize(128)
+        .positionalEncoding(PosEncType::ROTARY).rotaryThetaBase(10000.0f).incremental().causal();
+    runSequence(state, (gpu::GPULayerBuilder *)bld, tokens, position, (size_t)embed * embed, param_type::WGT_INT4);
+}
+
+// decoding single tokens at different positions as well as prompt processing
+BENCHMARK(BM_SeqAttention)->ArgNames({"tokens", "pos", "embed"})->ArgsProduct({{1}, {16, 192}, {256, 1024}})->UseRealTime();
+BENCHMARK(BM_SeqAttention)->ArgNames({"tokens", "pos", "embed"})->ArgsProduct({{64}, {0}, {256, 1024}})->UseRealTime();
+
+
+/**
+ * Arguments: tokens per run, embedding dimension, vocabulary size
+ */
+static void BM_SeqTokenScoring(benchmark::State & state) {
+    int tokens = (int)state.range(0), embed = (int)state.range(1), rows = (int)state.range(2);
+    auto * bld = new gpu::TokenScoringLayerBuilder("tokenscoring");
+    bld->sequence(64).inChannels(embed).outChannels(1).tableRows(rows);
+    runSequence(state, (gpu::GPULayerBuilder *)bld, tokens, 0, (size_t)embed * rows);
+}
+
+BENCHMARK(BM_SeqTokenScoring)->ArgNames({"tokens", "embed", "vocab"})->ArgsProduct({{1}, {256, 1024}, {4096, 32000}})->UseRealTime();
+
+
+/*##################################################################################################
+#                                      C P U   L A Y E R S                                         #
+##################################################################################################*/
+
+/**
+ * Arguments: spatial size, channels, kernel size
+ */
+static void BM_CPUConv(benchmark::State & state) {
+    int size = (int)state.range(0), chans = (int)state.range(1), kernel = (int)state.range(2);
+    auto * bld = new cpu::ConvLayerBuilder(kernel, "cpuconv");
+    bld->type(LayerType::CONVOLUTION2D).shape(chans, size, size, chans).inputPadding(kernel/2);
+    runCPU(state, (LayerBuilder *)bld, (size_t)kernel * kernel * chans * chans + 4 * chans);
+}
+
+BENCHMARK(BM_CPUConv)->ArgNames({"size", "chans", "kernel"})->ArgsProduct({{16, 32}, {4, 16}, {1, 3}})->UseRealTime();
+
+
+/**
+ * Arguments: spatial size, channels
+ */
+static void BM_CPUReduce(benchmark::State & state) {
+    int size = (int)state.range(0), chans = (int)state.range(1);
+    auto * bld = new cpu::ReduceLayerBuilder(cpu::ReduceLayerBuilder::NORM_L2, "cpureduce");
+    bld->type(LayerType::REDUCE).shape(1, size, size, chans);
+    runCPU(state, (LayerBuilder *)bld, 0);
+}
+
+BENCHMARK(BM_CPUReduce)->ArgNames({"size", "chans"})->ArgsProduct({{32, 64, 112}, {16, 64}})->UseRealTime();
+
+
+/*##################################################################################################
+#                                           M A I N                                                #
+##################################################################################################*/
+
+int main(int argc, char **argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    // -------------------------------------------------------
+    // Setup GL context, all layers are run on this thread
+    // -------------------------------------------------------
+    auto glmgr = GfxContextManager::instance();
+    if (!glmgr) {
+        std::cerr<<"Cannot setup GL context\n";
+        return 1;
+    }
+    LayerBench::setContext(glmgr->createMainContext());
+    benchmark::AddCustomContext("gl_renderer", fyusion::opengl::GLInfo::getRendererString());
+#ifdef HIGH_PRECISION
+    benchmark::AddCustomContext("precision", "fp32");
+#else
+    benchmark::AddCustomContext("precision", "fp16");
+#endif
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    // -------------------------------------------------------
+    // Cleanup
+    // -------------------------------------------------------
+    LayerBench::context().reset();
+    glmgr->tearDown();
+    return 0;
+}
+
+// vim: set expandtab ts=4 sw=4:
@@ -0,0 +1,359 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Base Harness for Per-Layer Micro-Benchmarks
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <cassert>
+#include <random>
+#include <set>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include <fyusenet/gl/gl_sys.h>
+#include <fyusenet/cpu/cpubuffer.h>
+#include <fyusenet/cpu/cpulayerinterface.h>
+#include "layerbenchbase.h"
+
+//-------------------------------------- Global Variables ------------------------------------------
+
+fyusion::fyusenet::GfxContextLink LayerBench::context_;
+
+//-------------------------------------- Local Definitions -----------------------------------------
+
+using namespace fyusion::fyusenet;
+
+/*##################################################################################################
+#                                   P U B L I C  F U N C T I O N S                                 #
+##################################################################################################*/
+
+/**
+ * @brief Constructor
+ *
+ * @param elements Number of random elements to provide, must cover the largest parameter set
+ *                 of the layer that is to be initialized from this provider
+ * @param weightType Data type of the weights of the layer under test, use \c WGT_INT4 for
+ *                   4-bit quantized layers
+ * @param seed Seed for the random number generator
+ */
+RandomParameterProvider::RandomParameterProvider(size_t elements, param_type weightType, unsigned int seed) :
+      data_(std::max(elements, (size_t)1)), weightType_(weightType) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    for (float & val : data_) val = dist(rng);
+    wrapper_ = new DefaultDataWrapper<float>(data_.data());
+    byteWrapper_ = new DefaultDataWrapper<uint8_t>(reinterpret_cast<const uint8_t *>(data_.data()));
+}
+
+
+/**
+ * @brief Destructor
+ */
+RandomParameterProvider::~RandomParameterProvider() {
+    delete wrapper_;
+    delete byteWrapper_;
+}
+
+
+/**
+ * @copydoc ParameterProvider::get
+ */
+DataBlob RandomParameterProvider::get(const std::string &name, int layerNo, int subIndex) const {
+    return DataBlob((quantized(name)) ? byteWrapper_ : wrapper_);
+}
+
+
+/**
+ * @copydoc ParameterProvider::dataType
+ */
+param_type RandomParameterProvider::dataType(const std::string &name, int layerNo, int subIndex) const {
+    return (quantized(name)) ? weightType_ : param_type::WGT_FLOAT32;
+}
+
+
+/**
+ * @brief Destructor, releases all layers and buffers
+ *
+ * @pre The GL context that was used to create the layers is current to the calling thread
+ */
+LayerBench::~LayerBench() {
+    layers_.cleanup();
+    if (buffers_) buffers_->cleanup();
+    delete buffers_;
+    for (cpu::CPUBuffer * buf : inputs_) delete buf;
+}
+
+
+/**
+ * @brief Instantiate a GPU layer (and its input producers) for benchmarking
+ *
+ * @param builder Builder for the layer that is to be benchmarked, ownership is transferred to
+ *                the layer factory
+ * @param paramElements Number of random parameter elements that the layer requires
+ * @param inputChannels Number of channels per input port, 0 to use the input channels of the
+ *                      \p builder (only differs for layers with more than one input port)
+ *
+ * The input of the layer is produced by an upload layer, followed by a shallow-to-deep
+ * conversion layer in case the layer under test operates on deep tensors. The producers are
+ * executed once by this function and are not part of the measurement.
+ *
+ * @throws FynException in case the layer cannot be created for the supplied parameters
+ */
+void LayerBench::gpuLayer(gpu::GPULayerBuilder * builder, size_t paramElements, int inputChannels) {
+    gpu_ = true;
+    int chans = (inputChannels > 0) ? inputChannels : builder->in();
+    int pad = builder->inputPadding_;
+    bool deep = deepInput(builder);
+    elements_ = (size_t)builder->in() * builder->width() * builder->height();
+    std::shared_ptr<LayerFactory> factory = LayerFactory::instance(LayerFactory::GPUFactoryType(LayerFactory::GPUFactoryType::SPECIALIZED));
+    auto * up = new gpu::UpDownLayerBuilder(gpu::UpDownLayerBuilder::UPLOAD, "upload");
+    up->shape(chans, builder->height(), builder->width(), chans).context(context()).number(0);
+    if (!deep) up->inputPadding(pad).outputPadding(pad);
+    up->push(factory);
+    if (deep) {
+        auto * s2d = new gpu::GPULayerBuilder("s2d");
+        s2d->type(LayerType::SHALLOW2DEEP).shape(chans, builder->height(), builder->width(), chans).deep().outputPadding(pad).context(context()).number(1);
+        s2d->push(factory);
+    }
+    builder->context_ = context();
+    builder->number_ = TARGET_LAYER;
+    builder->push(factory);
+    layers_ = factory->compileLayers();
+    buffers_ = new BufferManager(context());
+    if (deep) buffers_->connectLayers(layers_[0], layers_[1], 0);
+    connectInputs(layers_[(deep) ? 1 : 0]);
+    // the upload expects padded shallow data, which is just a flat array of random numbers to us
+    BufferShape shape(builder->height() + 2 * up->inputPadding_, builder->width() + 2 * up->inputPadding_, chans, 0, BufferShape::type::FLOAT32, BufferShape::order::GPU_SHALLOW);
+    inputs_.push_back(shape.createCPUBuffer());
+    randomFill(inputs_.back());
+    dynamic_cast<cpu::CPULayerInterface *>(layers_[0])->setCPUInputBuffer(inputs_.back(), 0);
+    setup(paramElements);
+    layers_[0]->forward(0, nullptr);
+    if (deep) layers_[1]->forward(0, nullptr);
+    glFinish();
+}
+
+
+/**
+ * @brief Instantiate a GPU sequence layer (and its input producer) for benchmarking
+ *
+ * @param builder Builder for the sequence layer that is to be benchmarked, ownership is
+ *                transferred to the layer factory
+ * @param tokens Number of tokens that are processed by each measured run
+ * @param position Sequence index of the first token of each measured run, for stateful layers
+ *                 (attention) the sequence is prefilled up to that position before measuring
+ * @param paramElements Number of random parameter elements that the layer requires
+ * @param weightType Data type of the weights of the layer, use \c WGT_INT4 for 4-bit
+ *                   quantized layers
+ * @param inputChannels Number of channels per input token, 0 to use the input channels of the
+ *                      \p builder (differs for layers with interleaved inputs)
+ *
+ * The input sequence is produced by a sequence upload layer which is executed once by this
+ * function. Embedding layers receive token indices in the range [0,15], all other layers
+ * receive random embeddings.
+ *
+ * @throws FynException in case the layer cannot be created for the supplied parameters
+ */
+void LayerBench::sequenceLayer(gpu::GPULayerBuilder * builder, int tokens, int position, size_t paramElements, param_type weightType, int inputChannels) {
+    gpu_ = true;
+    bool indices = (builder->type_ == LayerType::EMBEDDING);
+    int chans = (indices) ? 1 : ((inputChannels > 0) ? inputChannels : builder->in());
+    int maxlen = builder->maxSequenceLen_;
+    assert(position + tokens <= maxlen);
+    elements_ = (size_t)chans * tokens;
+    std::shared_ptr<LayerFactory> factory = LayerFactory::instance(LayerFactory::GPUFactoryType(LayerFactory::GPUFactoryType::SPECIALIZED));
+    auto * up = new gpu::UpDownLayerBuilder(gpu::UpDownLayerBuilder::UPLOAD, "upload");
+    up->context(context()).shape(1, 1, chans).sequence(maxlen).number(0);
+    if (indices) up->dataType(BufferSpec::dtype::UINT32).sequencePacking(1);
+    else up->dataType(BufferSpec::dtype::FLOAT);
+    up->push(factory);
+    builder->context_ = context();
+    builder->number_ = TARGET_LAYER;
+    builder->push(factory);
+    layers_ = factory->compileLayers();
+    buffers_ = new BufferManager(context());
+    connectInputs(layers_[0]);
+    BufferShape shape(chans, maxlen, (indices) ? BufferShape::type::UINT32 : BufferShape::type::FLOAT32, (indices) ? 1 : gpu::PIXEL_PACKING);
+    inputs_.push_back(shape.createCPUBuffer());
+    randomFill(inputs_.back());
+    dynamic_cast<cpu::CPULayerInterface *>(layers_[0])->setCPUInputBuffer(inputs_.back(), 0);
+    setup(paramElements, weightType);
+    token_.seqLength = maxlen;
+    layers_[0]->forward(0, &token_);
+    if (position > 0) {
+        token_.seqIndex = 0;
+        token_.seqLength = position;
+        token_.reset = true;
+        layers_[TARGET_LAYER]->forward(0, &token_);
+    }
+    token_.seqIndex = position;
+    token_.seqLength = tokens;
+    token_.reset = (position == 0);
+    state_ = &token_;
+    glFinish();
+}
+
+
+/**
+ * @brief Instantiate a CPU layer for benchmarking
+ *
+ * @param builder Builder for the layer that is to be benchmarked, ownership is transferred to
+ *                the layer factory
+ * @param paramElements Number of random parameter elements that the layer requires
+ *
+ * @throws FynException in case the layer cannot be created for the supplied parameters
+ */
+void LayerBench::cpuLayer(LayerBuilder * builder, size_t paramElements) {
+    gpu_ = false;
+    elements_ = (size_t)builder->in() * builder->width() * builder->height();
+    std::shared_ptr<LayerFactory> factory = LayerFactory::instance(LayerFactory::GPUFactoryType(LayerFactory::GPUFactoryType::SPECIALIZED));
+    builder->number_ = TARGET_LAYER;
+    builder->push(factory);
+    layers_ = factory->compileLayers();
+    buffers_ = new BufferManager(context());
+    LayerBase * target = layers_[TARGET_LAYER];
+    auto * cpulayer = dynamic_cast<cpu::CPULayerInterface *>(target);
+    for (const BufferSpec & spec : target->getRequiredInputBuffers()) {
+        BufferShape shape(spec.height_, spec.width_, spec.channels_, 0, BufferShape::type::FLOAT32, spec.dataOrder_);
+        inputs_.push_back(shape.createCPUBuffer());
+        randomFill(inputs_.back());
+        cpulayer->setCPUInputBuffer(inputs_.back(), spec.port_);
+    }
+    buffers_->createCPUOutput(target);
+    setup(paramElements);
+}
+
+
+/**
+ * @brief Run measurement loop on the layer under test
+ *
+ * @param state Benchmark state that drives the measurement loop
+ *
+ * For GPU layers, every iteration waits for the GPU to finish, such that each iteration covers
+ * the full execution time of the layer.
+ */
+void LayerBench::run(benchmark::State & state) {
+    LayerBase * target = layers_[TARGET_LAYER];
+    for (int i=0; i < WARMUP_RUNS; i++) target->forward(sequence_++, state_);
+    if (gpu_) glFinish();
+    for (auto _ : state) {
+        target->forward(sequence_++, state_);
+        if (gpu_) glFinish();
+    }
+    state.SetItemsProcessed((int64_t)(state.iterations() * elements_));
+    state.SetLabel(target->getName());
+}
+
+
+/**
+ * @brief Set GL context that is used for all benchmarked layers
+ *
+ * @param ctx Link to the GL context, must be current to the benchmarking thread
+ */
+void LayerBench::setContext(const GfxContextLink & ctx) {
+    context_ = ctx;
+}
+
+
+/**
+ * @brief Get GL context that is used for all benchmarked layers
+ *
+ * @return Reference to context link
+ */
+GfxContextLink & LayerBench::context() {
+    return context_;
+}
+
+
+/*##################################################################################################
+#                               N O N -  P U B L I C  F U N C T I O N S                            #
+##################################################################################################*/
+
+/**
+ * @brief Load random parameters into and set up all compiled layers
+ *
+ * @param paramElements Number of random parameter elements that the layer under test requires
+ * @param weightType Data type of the weights of the layer under test
+ */
+void LayerBench::setup(size_t paramElements, param_type weightType) {
+    RandomParameterProvider params(paramElements, weightType);
+    layers_[TARGET_LAYER]->loadParameters(&params);
+    for (auto it = layers_.begin(); it != layers_.end(); ++it) it.second->setup();
+}
+
+
+/**
+ * @brief Check whether a named parameter set is stored in quantized form
+ *
+ * @param name Name of the parameter set
+ *
+ * @retval true if the parameter set consists of quantized weights or zero-points
+ * @retval false otherwise
+ */
+bool RandomParameterProvider::quantized(const std::string &name) const {
+    if (weightType_ != param_type::WGT_INT4) return false;
+    auto endsWith = [&name](const std::string & suffix) {
+        return (name.size() >= suffix.size()) && (name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0);
+    };
+    return endsWith(".weights") || endsWith(".zeros");
+}
+
+
+/**
+ * @brief Connect the output of the input producer to all input ports of the layer under test
+ *
+ * @param producer Layer that produces the input data for the layer under test
+ *
+ * Also creates the output textures of the layer under test.
+ */
+void LayerBench::connectInputs(LayerBase * producer) {
+    auto * target = dynamic_cast<gpu::GPULayerBase *>(layers_[TARGET_LAYER]);
+    std::set<int> ports;
+    for (const BufferSpec & spec : target->getRequiredInputBuffers()) ports.insert(spec.port_);
+    for (int port : ports) buffers_->connectLayers(producer, target, port);
+    const BufferSpec & outspec = target->getRequiredOutputBuffers().front();
+    buffers_->createGPUOutput(target, outspec.internalFormat_, outspec.format_, outspec.type_);
+}
+
+
+/**
+ * @brief Fill CPU buffer with uniformly distributed random data
+ *
+ * @param buffer Buffer to fill, the whole buffer is filled regardless of its shape. Buffers
+ *               with \c UINT32 data are filled with token indices in the range [0,15]
+ */
+void LayerBench::randomFill(cpu::CPUBuffer * buffer) {
+    std::mt19937 rng(0x4321);
+    size_t elements = buffer->shape().bytes() / sizeof(float);
+    if (buffer->shape().dataType() == BufferShape::type::UINT32) {
+        // token indices
+        auto * ptr = buffer->map<uint32_t>();
+        for (size_t i=0; i < elements; i++) ptr[i] = rng() & 15;
+    } else {
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        auto * ptr = buffer->map<float>();
+        for (size_t i=0; i < elements; i++) ptr[i] = dist(rng);
+    }
+    buffer->unmap();
+}
+
+
+/**
+ * @brief Check whether the layer of the supplied builder operates on a deep-tensor input
+ *
+ * @param builder Builder of the layer under test
+ *
+ * @retval true if the layer requires deep-tensor input data
+ * @retval false otherwise
+ */
+bool LayerBench::deepInput(const gpu::GPULayerBuilder * builder) {
+    if (builder->type_ == LayerType::SHALLOW2DEEP) return false;
+    if (builder->type_ == LayerType::DEEP2SHALLOW) return true;
+    return builder->isDeep();
+}
+
+// vim: set expandtab ts=4 sw=4:
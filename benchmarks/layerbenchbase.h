@@ -0,0 +1,124 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Base Harness for Per-Layer Micro-Benchmarks (Header)
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <vector>
+#include <benchmark/benchmark.h>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include <fyusenet/fyusenet.h>
+#include <fyusenet/base/buffermanager.h>
+
+//------------------------------------- Public Declarations ----------------------------------------
+
+/**
+ * @brief Parameter provider that supplies random data for every parameter request
+ *
+ * As the layers only obtain raw pointers from a parameter provider and read as many elements
+ * as they require, this provider simply hands out the same block of uniformly distributed
+ * random numbers for every request. The block must therefore be at least as large as the
+ * largest parameter set of the benchmarked layer.
+ *
+ * For 4-bit quantized layers, the \c .weights and \c .zeros parameters are handed out as
+ * raw bytes (which are random 4-bit values to the layer), everything else as 32-bit floats.
+ */
+class RandomParameterProvider : public fyusion::fyusenet::ParameterProvider {
+ public:
+    explicit RandomParameterProvider(size_t elements, fyusion::fyusenet::param_type weightType = fyusion::fyusenet::param_type::WGT_FLOAT32, unsigned int seed = 0x1234);
+    ~RandomParameterProvider() override;
+    [[nodiscard]] fyusion::fyusenet::DataBlob get(const std::string &name, int layerNo, int subIndex) const override;
+    [[nodiscard]] fyusion::fyusenet::param_type dataType(const std::string &name, int layerNo, int subIndex) const override;
+
+ private:
+    [[nodiscard]] bool quantized(const std::string &name) const;
+
+    std::vector<float> data_;                                   //!< Random parameter data
+    fyusion::fyusenet::param_type weightType_;                  //!< Data type of the weights of the layer under test
+    fyusion::fyusenet::DataWrapper * wrapper_ = nullptr;        //!< Wrapper around #data_
+    fyusion::fyusenet::DataWrapper * byteWrapper_ = nullptr;    //!< Wrapper around #data_ for quantized parameters
+};
+
+
+/**
+ * @brief Harness that runs a single layer in isolation for micro-benchmarking
+ *
+ * This class instantiates a single layer through the regular LayerFactory (and therefore through
+ * the GPU and CPU layer factory backends), supplies it with random parameters and random input
+ * data, and measures the execution time of the layer's \c forward() call in a warm loop.
+ *
+ * For GPU layers, the input data is produced by an upload layer (followed by a shallow-to-deep
+ * conversion for deep-tensor layers), which is executed once before the measurement starts.
+ * Layers with more than one input port (e.g. concatenation) receive the same input on all
+ * ports. Sequence layers are fed by a sequence upload and are run with a StateToken that
+ * selects the number of tokens and the sequence position of each run. Each measured iteration
+ * is followed by a \c glFinish() such that the measured time reflects the actual GPU
+ * execution time and not only the command submission. For CPU layers, the input
+ * buffers are filled directly.
+ *
+ * @see layerbench.cpp
+ */
+class LayerBench {
+ public:
+    // ------------------------------------------------------------------------
+    // Constructor / Destructor
+    // ------------------------------------------------------------------------
+    LayerBench() = default;
+    ~LayerBench();
+
+    // ------------------------------------------------------------------------
+    // Public methods
+    // ------------------------------------------------------------------------
+    void gpuLayer(fyusion::fyusenet::gpu::GPULayerBuilder * builder, size_t paramElements = 0, int inputChannels = 0);
+    void sequenceLayer(fyusion::fyusenet::gpu::GPULayerBuilder * builder, int tokens, int position, size_t paramElements = 0,
+                       fyusion::fyusenet::param_type weightType = fyusion::fyusenet::param_type::WGT_FLOAT32, int inputChannels = 0);
+    void cpuLayer(fyusion::fyusenet::LayerBuilder * builder, size_t paramElements = 0);
+    void run(benchmark::State & state);
+
+    static void setContext(const fyusion::fyusenet::GfxContextLink & ctx);
+    static fyusion::fyusenet::GfxContextLink & context();
+
+    /**
+     * @brief Layer number that is assigned to the layer under test
+     */
+    constexpr static int TARGET_LAYER = 2;
+
+    /**
+     * @brief Number of unmeasured runs prior to the measurement
+     */
+    constexpr static int WARMUP_RUNS = 3;
+
+ private:
+    // ------------------------------------------------------------------------
+    // Non-public methods
+    // ------------------------------------------------------------------------
+    void setup(size_t paramElements, fyusion::fyusenet::param_type weightType = fyusion::fyusenet::param_type::WGT_FLOAT32);
+    void connectInputs(fyusion::fyusenet::LayerBase * producer);
+    static void randomFill(fyusion::fyusenet::cpu::CPUBuffer * buffer);
+    static bool deepInput(const fyusion::fyusenet::gpu::GPULayerBuilder * builder);
+
+    // ------------------------------------------------------------------------
+    // Member variables
+    // ------------------------------------------------------------------------
+    bool gpu_ = true;                                           //!< Indicator whether the layer under test runs on the GPU
+    size_t elements_ = 0;                                       //!< Number of input tensor elements (for throughput reporting)
+    fyusion::fyusenet::CompiledLayers layers_;                  //!< Layers (producers and layer under test)
+    fyusion::fyusenet::BufferManager * buffers_ = nullptr;      //!< Buffer manager that holds the intermediate textures
+    std::vector<fyusion::fyusenet::cpu::CPUBuffer *> inputs_;   //!< CPU input buffers owned by this object
+    uint64_t sequence_ = 1;                                     //!< Running sequence number for the forward() calls
+    fyusion::fyusenet::StateToken token_;                       //!< State token for sequence layers
+    fyusion::fyusenet::StateToken * state_ = nullptr;           //!< Pointer to #token_ for sequence layers, \c nullptr otherwise
+    static fyusion::fyusenet::GfxContextLink context_;          //!< GL context that all layers are created on
+};
+
+// vim: set expandtab ts=4 sw=4:
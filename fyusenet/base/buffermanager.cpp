@@ -66,7 +66,7 @@ void BufferManager::cleanup() {
         for (auto ti = texturePool_.begin(); ti != texturePool_.end(); ++ti,pi++) {
             textures[pi]=(*ti).id_;
         }
-        glDeleteTextures((int)texturePool_.size(),textures.get());
+        opengl::GLStateCache::deleteTextures((int)texturePool_.size(),textures.get());
         texturePool_.clear();
     }
     bufferPool_.clear();
@@ -85,7 +85,6 @@ void BufferManager::cleanup() {
  * provided \p outputLayer.
  */
 void BufferManager::createCPUOutput(LayerBase *outputLayer, bool lock) {
-    // TODO (mw) support multiple output ports
     auto * cpuout = dynamic_cast<cpu::CPULayerInterface *>(outputLayer);
     if (!cpuout) {
         THROW_EXCEPTION_ARGS(FynException, "Cannot assign CPU output to class that does not implement CPU interface");
@@ -95,8 +94,8 @@ void BufferManager::createCPUOutput(LayerBase *outputLayer, bool lock) {
         if (!cpuout->getCPUOutputBuffer((*it).port_)) {
             Buffer buf = createBuffer((*it).width_, (*it).height_, (*it).channels_, (*it).internalFormat_, (*it).type_,  (*it).dataOrder_);
             buf.locked_ = lock;
-            cpuout->addCPUOutputBuffer(buf.buf_);
-            outputLayer->addOutputConnection(0, nullptr, 0);
+            cpuout->addCPUOutputBuffer(buf.buf_, (*it).port_);
+            outputLayer->addOutputConnection((*it).port_, nullptr, 0);
             bufferPool_.push_back(buf);
         }
     }
@@ -282,6 +281,16 @@ void BufferManager::connectCPULayers(LayerBase *outLayer, LayerBase *inLayer, st
     auto * cpuout = dynamic_cast<cpu::CPULayerInterface *>(outLayer);
     auto * cpuin = dynamic_cast<cpu::CPULayerInterface *>(inLayer);
     if ((!cpuout) || (!cpuin)) THROW_EXCEPTION_ARGS(FynException, "Illegal layers supplied");
+    //---------------------------------------------------------
+    // Asynchronous (download) layers deliver their output in
+    // the background, so the receiving layer has to be added
+    // as dependency...
+    //---------------------------------------------------------
+    auto * asy = dynamic_cast<AsyncLayer *>(outLayer);
+    if (asy && asy->isAsync()) {
+        lock = true;  // asynchronous layers always have locked output buffers
+        asy->addAsyncDependency(inLayer, port);
+    }
     for (auto it = matches.begin(); it != matches.end(); ++it) {
         //---------------------------------------------------------
         // Check if the associated output already has a buffer and
@@ -312,7 +321,7 @@ void BufferManager::connectCPULayers(LayerBase *outLayer, LayerBase *inLayer, st
                     cpuin->setCPUInputBuffer(buf, port);
                 }
                 inLayer->addInputConnection(port, outLayer, it->first.port_);
-                cpuout->addCPUOutputBuffer(buf);
+                cpuout->addCPUOutputBuffer(buf, it->second.port_);
                 outLayer->addOutputConnection(it->second.port_, inLayer, port);
                 updateLayerUse(index, inLayer->getNumber(), lock);
             } else {
@@ -323,7 +332,7 @@ void BufferManager::connectCPULayers(LayerBase *outLayer, LayerBase *inLayer, st
                 nb.lastInputLayer_ = inLayer->getNumber();
                 nb.locked_ = lock;
                 bufferPool_.push_back(nb);
-                cpuout->addCPUOutputBuffer(nb.buf_);
+                cpuout->addCPUOutputBuffer(nb.buf_, it->second.port_);
                 if (it->first.usage_ == BufferSpec::RESIDUAL_SOURCE) {
                     cpuin->setCPUResidualBuffer(nb.buf_);
                 }
@@ -709,7 +718,7 @@ BufferManager::Texture BufferManager::createTexture(int width, int height,
     GLuint texture=0;
     glGenTextures(1, &texture);
     if (texture == 0) THROW_EXCEPTION_ARGS(GLException,"Cannot create texture (err=0x%x)",glGetError());
-    glBindTexture(GL_TEXTURE_2D,texture);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,texture);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     switch (interpolation) {
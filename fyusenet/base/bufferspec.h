@@ -99,7 +99,7 @@ class BufferSpec {
         RG8       = GL_RG8,           //!< 8-bit two-channel unsigned byte elements
         RED8      = GL_R8,            //!< 8-bit single-channel unsigned byte elements
         SINGLE32F = GL_R32F,          //!< 32-bit single-channel floating-point elements (alias for \c RED32F )
-        SINGLE16F = GL_R32F,          //!< 16-bit single-channel floating-point elements (alias for \c RED16F )
+        SINGLE16F = GL_R16F,          //!< 16-bit single-channel floating-point elements (alias for \c RED16F )
 #ifdef GL_R32UI
         SINGLE32UI = GL_R32UI,        //!< 32-bit single-channel integer (unsigned)
         RG32UI     = GL_RG32UI,       //!< 32-bit 2-channel integer (unsigned)
@@ -79,6 +79,7 @@ void Engine::setup(NeuralNetwork *net) {
         net->setContext(exec_.context());
         auto init = [this, net]() { setLayers(net->gpuSetup()); };
         exec_->waitTask(init);
+        reservePBOs();
         setup_ = true;
         exec_->setTask(std::bind(&Engine::looper,this,exec_.context()));
     } else {
@@ -123,6 +124,7 @@ void Engine::cleanup(const std::function<void()> & broom) {
         assert(asyncDownloadDependencies_.empty());
         assert(asyncUploadDeferredDependencies_.empty());
         assert(asyncDownloadWaiters_.empty());
+        assert(asyncDownloadBlocked_.empty());
         asyncStateLock_.unlock();
 #endif
     }
@@ -148,6 +150,8 @@ void Engine::cleanup(const std::function<void()> & broom) {
         setup_ = false;
     }
 #endif
+    for (ScheduleEntry & entry : schedule_) entry.segment = -1;
+    segments_.clear();
 }
 
 
@@ -215,6 +219,39 @@ void Engine::disableTimings() {
 }
 
 
+/**
+ * @brief Enable or disable replay of recorded GL command streams
+ *
+ * @param enable If \c true, runs of consecutive standard GPU layers are executed by replaying
+ *               the GL commands that were recorded in their first execution, if \c false, all
+ *               layers are executed regularly
+ *
+ * For a fixed network and input size, the GL commands that are issued by the standard GPU layers
+ * do not change from one inference run to the next, only the contents of the textures do. With
+ * command replay enabled, the engine records the commands that are issued by each run of
+ * consecutive standard GPU layers (see ReplaySegment) into an opengl::GLCommandBuffer and
+ * re-issues them on subsequent runs, skipping all the CPU work that the layers do when issuing
+ * the commands. Segments are bounded by CPU, upload and download layers as well as layers that
+ * have to synchronize with asynchronous layers.
+ *
+ * Replay is not done for runs that use a StateToken or while timings or intermediate output are
+ * enabled. Calling this function discards all recorded commands, which is also the way to
+ * force a re-recording after changing parameters of layers.
+ *
+ * @warning This function is not thread-safe, do not call it in parallel to forwardLayers()
+ *
+ * @see opengl::GLCommandBuffer
+ */
+void Engine::setCommandReplay(bool enable) {
+    replay_ = enable;
+    for (ReplaySegment & segment : segments_) {
+        segment.commands.reset();
+        segment.inputs.clear();
+        segment.valid = false;
+    }
+}
+
+
 /**
  * @brief Reset timing log data
  *
@@ -309,10 +346,13 @@ Engine::execstate Engine::forwardLayers(StateToken * token) {
         std::lock_guard<std::mutex> guard(runGuard_);
         if (quit_) return execstate::EXEC_STOPPED;
         std::unique_lock<std::mutex> seq(sequenceLock_);
-        while ((engineSequence_ + 2) < sequenceNo_) {
-            sequenceDone_.wait(seq, [this]() { return ((engineSequence_ + 1) >= sequenceNo_);});
+        //-----------------------------------------------------------
+        // Apply back-pressure: do not issue more than the configured
+        // number of runs before the engine thread retires them...
+        //-----------------------------------------------------------
+        while ((engineSequence_ + pipelineDepth_) < sequenceNo_) {
+            sequenceDone_.wait(seq, [this]() { return ((engineSequence_ + pipelineDepth_) >= sequenceNo_);});
         }
-        assert((engineSequence_ + 2) >= sequenceNo_);
         ExecutionState estate(sequenceNo_++, layers_.begin());
         seq.unlock();
         if (newSeqCallback_) newSeqCallback_(sequenceNo_);
@@ -328,7 +368,7 @@ Engine::execstate Engine::forwardLayers(StateToken * token) {
 #endif
     ExecutionState estate(sequenceNo_++, layers_.begin(), token);
     state status = execute(estate, context_);
-    glDisable(GL_BLEND);
+    opengl::GLStateCache::disable(GL_BLEND);
     return (status == state::DONE) ? execstate::EXEC_DONE : execstate::EXEC_ERROR;
 }
 
@@ -338,6 +378,97 @@ Engine::execstate Engine::forwardLayers(StateToken * token) {
 ##################################################################################################*/
 
 
+/**
+ * @brief Compile static execution schedule for the registered layers
+ *
+ * This function precomputes all information that execute() requires on a per-layer basis and
+ * stores it in the flat #schedule_ array, which is indexed by the layer number. This comprises the
+ * type of the layer (CPU, upload, download, standard GPU) as well as the static part of the
+ * dependency structure of the asynchronous layers:
+ *   - the first consumer of an asynchronous layer is flagged with #SCHED_WAIT, as it may have to
+ *     wait for the asynchronous operation to complete
+ *   - the last consumer of an asynchronous upload layer is flagged with #SCHED_FENCE, as it has to
+ *     issue a fence before the upload layer may re-use its textures
+ *
+ * Only layers that carry one of these two flags enter the #asyncStateLock_ during execution, all
+ * other layers run without any locking. In addition, each asynchronous upload layer is assigned a
+ * slot in #uploadSlots_ and the ring buffer of in-flight sequences (#waitingLayers_) is sized
+ * according to the #pipelineDepth_.
+ *
+ * Finally, maximal runs of consecutive standard GPU layers are grouped into replay segments
+ * (see ReplaySegment), which are used when command replay is enabled.
+ *
+ * @throws FynException in case a CPU layer is not derived from cpu::CPULayerBase
+ */
+void Engine::compileSchedule() {
+    using namespace gpu;
+    int maxlayer = -1;
+    for (auto it = layers_.begin(); it != layers_.end(); ++it) maxlayer = std::max(maxlayer, it.first);
+    schedule_.assign(maxlayer + 1, ScheduleEntry());
+#ifdef FYUSENET_MULTITHREADING
+    uploadSlots_.clear();
+#endif
+    for (auto it = layers_.begin(); it != layers_.end(); ++it) {
+        LayerBase * layer = it.second;
+        if (!layer) continue;
+        ScheduleEntry & entry = schedule_[it.first];
+        AsyncLayer * async = nullptr;
+        if (layer->getDevice() == compute_device::DEV_CPU) {
+            if (!dynamic_cast<cpu::CPULayerBase *>(layer)) THROW_EXCEPTION_ARGS(FynException, "Layer %s runs on the CPU but is not a CPU layer", layer->getName().c_str());
+            entry.flags |= SCHED_CPU;
+        } else if (dynamic_cast<UploadLayer *>(layer)) {
+            entry.flags |= SCHED_UPLOAD;
+            async = dynamic_cast<UploadLayer *>(layer);
+        } else if (dynamic_cast<DownloadLayer *>(layer)) {
+            entry.flags |= SCHED_DOWNLOAD;
+            async = dynamic_cast<DownloadLayer *>(layer);
+        } else if (dynamic_cast<deep::DeepDownloadLayer *>(layer)) {
+            entry.flags |= SCHED_DEEP_DOWNLOAD;
+            async = dynamic_cast<deep::DeepDownloadLayer *>(layer);
+        }
+        if ((!async) || (!async->isAsync())) continue;
+        entry.flags |= SCHED_ASYNC;
+#ifdef FYUSENET_MULTITHREADING
+        int first = async->firstAsyncDependency();
+        if ((first >= 0) && (first <= maxlayer)) schedule_[first].flags |= SCHED_WAIT;
+        if (entry.flags & SCHED_UPLOAD) {
+            int last = async->lastAsyncDependency();
+            if ((last >= 0) && (last <= maxlayer)) schedule_[last].flags |= SCHED_FENCE;
+            entry.upload = (int)uploadSlots_.size();
+            UploadSlot slot;
+            slot.layer = static_cast<UploadLayer *>(layer);
+            uploadSlots_.push_back(slot);
+        }
+#endif
+    }
+#ifdef FYUSENET_MULTITHREADING
+    size_t ringsize = 1;
+    while (ringsize < (size_t)(pipelineDepth_ + 1)) ringsize <<= 1;
+    waitingLayers_.assign(ringsize, WaitSlot());
+    waitingMask_ = ringsize - 1;
+#endif
+    //-----------------------------------------------------------
+    // Group runs of standard GPU layers (no flags) into replay
+    // segments...
+    //-----------------------------------------------------------
+    segments_.clear();
+    int current = -1;
+    for (auto it = layers_.begin(); it != layers_.end(); ++it) {
+        auto * gpulayer = (it.second) ? dynamic_cast<GPULayerBase *>(it.second) : nullptr;
+        if ((!gpulayer) || (schedule_[it.first].flags != 0)) {
+            current = -1;
+            continue;
+        }
+        if (current < 0) {
+            current = (int)segments_.size();
+            schedule_[it.first].segment = current;
+            segments_.emplace_back();
+        }
+        segments_[current].layers.push_back(gpulayer);
+    }
+}
+
+
 /**
  * @brief Perform execution of all network layers in ascending order
  *
@@ -370,6 +501,13 @@ Engine::execstate Engine::forwardLayers(StateToken * token) {
  * will check for any pending execution states and upon encountering those, will push that
  * state to the #readyStates_ list for deferred execution.
  *
+ * The type of each layer and its role in the dependency structure is taken from the precomputed
+ * #schedule_. Only layers that are flagged as synchronization points (first consumers of an
+ * asynchronous layer and last consumers of an asynchronous upload) enter the #asyncStateLock_.
+ *
+ * The GL state cache of the calling thread is invalidated on entry, as the embedding application
+ * may have changed GL state (e.g. texture bindings) on the same context since the last run.
+ *
  * On exit, this function returns the last state of the engine, which can take the following values:
  *   - \c DONE : the execution of a single run through all layers is complete (pending GL operations)
  *   - \c UPLOADING : the execution was deferred due to an asynchronous upload operation
@@ -386,6 +524,7 @@ Engine::state Engine::execute(ExecutionState& state, const GfxContextLink & cont
     tstamp start, end;
     std::string fname;
     StateToken * stoken = state.state_;
+    opengl::GLStateCache::invalidate();
     //-----------------------------------------------------------
     // Traverse through layers in ascending order of layer number
     //-----------------------------------------------------------
@@ -394,6 +533,7 @@ Engine::state Engine::execute(ExecutionState& state, const GfxContextLink & cont
         LayerBase * layer = state.current.second;
         assert(layer);
         if (layer) {
+            const ScheduleEntry & sched = schedule_[idx];
             bool masked = stoken && stoken->maskLayers.find(layer->getNumber()) != stoken->maskLayers.end();
             //---------------------------------------------------------------
             // If this layer is dependent on a currently running async
@@ -402,13 +542,11 @@ Engine::state Engine::execute(ExecutionState& state, const GfxContextLink & cont
             //---------------------------------------------------------------
 #ifdef FYUSENET_MULTITHREADING
             // we assume that we don't have direct upload -> download connections
-            asyncStateLock_.lock();
-            if (asyncDependencies_.find(layer->getNumber()) != asyncDependencies_.end()) {
+            if (sched.flags & SCHED_WAIT) {
+                asyncStateLock_.lock();
                 for (auto & dep : asyncDownloadDependencies_) {
                     if (dep.dependency == layer->getNumber() && dep.sequenceNo == state.sequenceNo) {
-                        if (minimumWaitingDependency_.find(state.sequenceNo) != minimumWaitingDependency_.end()) {
-                            minimumWaitingDependency_[state.sequenceNo] = std::min(minimumWaitingDependency_[state.sequenceNo], layer->getNumber());
-                        } else minimumWaitingDependency_[state.sequenceNo] = layer->getNumber();
+                        recordWaitingLayer(state.sequenceNo, layer->getNumber());
                         asyncDownloadWaiters_.emplace_back(layer->getNumber(), (AsyncLayer *)dep.provider, state.sequenceNo, state.clone());
                         asyncStateLock_.unlock();
                         return state::DOWNLOADING;
@@ -416,16 +554,14 @@ Engine::state Engine::execute(ExecutionState& state, const GfxContextLink & cont
                 }
                 for (auto & dep : asyncUploadDependencies_) {
                     if (dep.dependency == layer->getNumber() && dep.sequenceNo == state.sequenceNo) {
-                        if (minimumWaitingDependency_.find(state.sequenceNo) != minimumWaitingDependency_.end()) {
-                            minimumWaitingDependency_[state.sequenceNo] = std::min(minimumWaitingDependency_[state.sequenceNo], layer->getNumber());
-                        } else minimumWaitingDependency_[state.sequenceNo] = layer->getNumber();
+                        recordWaitingLayer(state.sequenceNo, layer->getNumber());
                         asyncUploadWaiters_.emplace_back(layer->getNumber(), (UploadLayer *)dep.provider, state.sequenceNo, state.clone());
                         asyncStateLock_.unlock();
                         return state::UPLOADING;
                     }
                 }
+                asyncStateLock_.unlock();
             }
-            asyncStateLock_.unlock();
 #endif
             //-----------------------------------------------------------
             // Generate output filename if we are supposed to write
@@ -436,11 +572,13 @@ Engine::state Engine::execute(ExecutionState& state, const GfxContextLink & cont
                 if (!outputDir_.empty()) fname = outputDir_ + std::string("/") + layer->getName() + std::string("_") + std::to_string(state.sequenceNo)+ std::string(".bin");
                 else fname = layer->getName() + std::string("_") + std::to_string(state.sequenceNo) + std::string(".bin");
             }
-            //-----------------------------------------------------------
-            // Handle CPU layers...
-            //-----------------------------------------------------------
-            if ((layer->getDevice() == compute_device::DEV_CPU) && (!masked)) {
-                auto * cpulay = dynamic_cast<cpu::CPULayerBase *>(layer);
+            if (masked) {
+                // masked layers are not executed, but still take part in the dependency tracking below
+            } else if (sched.flags & SCHED_CPU) {
+                //-----------------------------------------------------------
+                // Handle CPU layers...
+                //-----------------------------------------------------------
+                auto * cpulay = static_cast<cpu::CPULayerBase *>(layer);
                 if (timings_) start = fy_get_stamp();
                 cpulay->forward(state.sequenceNo, stoken);
                 if (timings_) {
@@ -452,169 +590,158 @@ Engine::state Engine::execute(ExecutionState& state, const GfxContextLink & cont
                     // NOTE (mw) we assume it is floating point data every time
                     cpulay->getCPUOutputBuffer()->write<float>(fname.c_str());
                 }
-            } else {
+            } else if (sched.flags & SCHED_UPLOAD) {
                 //-----------------------------------------------------------
                 // Handle upload layers..
                 //-----------------------------------------------------------
-                if (dynamic_cast<UploadLayer *>(layer) && !masked) {
-                    auto * ul = dynamic_cast<UploadLayer *>(layer);
-                    if ((ul)->getCPUInputBuffer() == nullptr) THROW_EXCEPTION_ARGS(FynException, "No input buffer in upload layer %s", ul->getName().c_str());
-                    if (ul->isAsync()) {
+                auto * ul = static_cast<UploadLayer *>(layer);
+                if (((ul)->getCPUInputBuffer() == nullptr) && (!ul->hasSubmittedInput())) THROW_EXCEPTION_ARGS(FynException, "No input buffer in upload layer %s", ul->getName().c_str());
+                if (sched.flags & SCHED_ASYNC) {
 #ifdef FYUSENET_MULTITHREADING
+                    //-----------------------------------------------------------
+                    // For async upload layers, we register two dependencies:
+                    //  1. an early stage dep which is the _first_ layer that expects
+                    //     an input from the UL
+                    //  2. a deferred dep which is the _last_ layer that expects an
+                    //     input from the UL
+                    // We then invoke async processing on the layer and then
+                    // continue execution. The deferred dependency is important to
+                    // make sure that no texture is overwritten before it has been
+                    // processed by the last dependent layer in the chain. Both
+                    // layers are flagged in the schedule (see compileSchedule())
+                    //-----------------------------------------------------------
+                    upIssueLock_.lock();
+                    bool issueok = ul->asyncForward(state.sequenceNo, stoken, std::bind(&Engine::uploadCallback, this, ul, std::placeholders::_1));
+                    if (issueok) {
+                        // transition to asyncStateLock_
+                        asyncStateLock_.lock();
+                        upIssueLock_.unlock();
+                        UploadSlot & slot = uploadSlots_[sched.upload];
                         //-----------------------------------------------------------
-                        // For async upload layers, we register two dependencies:
-                        //  1. an early stage dep which is the _first_ layer that expects
-                        //     an input from the UL
-                        //  2. a deferred dep which is the _last_ layer that expects an
-                        //     input from the UL
-                        // We then invoke async processing on the layer and then
-                        // continue execution. The deferred dependency is important to
-                        // make sure that no texture is overwritten before it has been
-                        // processed by the last dependent layer in the chain.
+                        // Check if the layer is already used in an upload (from a
+                        // previous run), if not then mark it as being active for
+                        // this run. If it is, the early-stage dependency has to wait
+                        // for the consumers of the most recently issued upload, which
+                        // is not necessarily the active one for pipeline depths > 2
                         //-----------------------------------------------------------
-                        upIssueLock_.lock();
-                        bool issueok = ul->asyncForward(state.sequenceNo, stoken, std::bind(&Engine::uploadCallback, this, ul, std::placeholders::_1));
-                        if (issueok) {
-                            // transition to asyncStateLock_
-                            asyncStateLock_.lock();
-                            upIssueLock_.unlock();
-                            int firstdep = ul->firstAsyncDependency();
-                            int lastdep = ul->lastAsyncDependency();
-                            asyncDependencies_.insert(firstdep);
-                            //-----------------------------------------------------------
-                            // Check if the layer is already used in an upload (from a
-                            // previous run), if not then mark it as being active for
-                            // this run...
-                            //-----------------------------------------------------------
-                            uint8_t depcount = 1;
-                            if (activeUploadDependencies_.find(ul) == activeUploadDependencies_.end()) activeUploadDependencies_[ul] = state.sequenceNo;
-                            else {
-                                if (activeUploadDependencies_[ul] == 0) activeUploadDependencies_[ul] = state.sequenceNo;
-                                else {
-                                    depcount++;
-                                }
-                            }
-                            Dependency<gpu::UploadLayer> early(firstdep, ul, depcount, state.sequenceNo);
-                            Dependency<gpu::UploadLayer> late(lastdep, ul, 1, state.sequenceNo);
-                            if (depcount == 2) early.deferredNo = activeUploadDependencies_[ul];
-                            asyncUploadDependencies_.push_back(early);
-                            asyncUploadDeferredDependencies_.push_back(late);
-                            deferredAsyncDependencies_.insert(lastdep);
-                            numBackgroundTasks_++;           // the async forward above triggers a background upload task
-                        } else {
-                            asyncStateLock_.lock();
-                            upIssueLock_.unlock();
-                            //-------------------------------------------------------
-                            // There are no free PBO slots for the uploads, add a
-                            // self-referential pending state to the upload waiters
-                            // and let waitForUploadFence() unlock that later...
-                            //-------------------------------------------------------
-                            asyncUploadWaiters_.emplace_back(layer->getNumber(), ul, state.sequenceNo, state.clone());
-                        }
-                        asyncStateLock_.unlock();
+                        uint8_t depcount = 1;
+                        if (slot.active == 0) slot.active = state.sequenceNo;
+                        else depcount++;
+                        Dependency<gpu::UploadLayer> early(ul->firstAsyncDependency(), ul, depcount, state.sequenceNo);
+                        Dependency<gpu::UploadLayer> late(ul->lastAsyncDependency(), ul, 1, state.sequenceNo);
+                        if (depcount == 2) early.deferredNo = slot.lastIssued;
+                        slot.lastIssued = state.sequenceNo;
+                        asyncUploadDependencies_.push_back(early);
+                        asyncUploadDeferredDependencies_.push_back(late);
+                        numBackgroundTasks_++;           // the async forward above triggers a background upload task
+                    } else {
+                        asyncStateLock_.lock();
+                        upIssueLock_.unlock();
+                        //-------------------------------------------------------
+                        // There are no free PBO slots for the uploads, add a
+                        // self-referential pending state to the upload waiters
+                        // and let waitForUploadFence() unlock that later...
+                        //-------------------------------------------------------
+                        asyncUploadWaiters_.emplace_back(layer->getNumber(), ul, state.sequenceNo, state.clone());
+                    }
+                    asyncStateLock_.unlock();
 #else
-                        THROW_EXCEPTION_ARGS(FynException,"No multithreading support compiled in");
+                    THROW_EXCEPTION_ARGS(FynException,"No multithreading support compiled in");
 #endif
-                    } else {
-                        ul->forward(state.sequenceNo, stoken);
-                        if (writeResults_) {
-                            (dynamic_cast<GPULayerBase *>(layer))->writeResult(fname.c_str(), false);
-                        }
+                } else {
+                    ul->forward(state.sequenceNo, stoken);
+                    if (writeResults_) {
+                        ul->writeResult(fname.c_str(), false);
                     }
-                } else
+                }
+            } else if (sched.flags & (SCHED_DOWNLOAD | SCHED_DEEP_DOWNLOAD)) {
                 //-------------------------------------------------------
                 // Handle download layers (shallow and deep)...
                 //-------------------------------------------------------
-                if (dynamic_cast<DownloadLayer *>(layer) && !masked) {
-                    auto * dl = dynamic_cast<DownloadLayer *>(layer);
-                    if (timings_) start = fy_get_stamp();
-                    CPUBuffer * buf = dl->getCPUOutputBuffer(0);
-                    if (!buf) THROW_EXCEPTION_ARGS(FynException,"No output buffer in download layer %s", dl->getName().c_str());
-                    if (dl->isAsync()) {
+                LayerBase * dl = layer;
+                AsyncLayer * async = nullptr;
+                cpu::CPULayerInterface * cpuif = nullptr;
+                if (sched.flags & SCHED_DOWNLOAD) {
+                    async = static_cast<DownloadLayer *>(layer);
+                    cpuif = static_cast<DownloadLayer *>(layer);
+                } else {
+                    async = static_cast<deep::DeepDownloadLayer *>(layer);
+                    cpuif = static_cast<deep::DeepDownloadLayer *>(layer);
+                }
 #ifdef FYUSENET_MULTITHREADING
-                        //-----------------------------------------------------------
-                        // For async download layers we enter the layer as a download
-                        // dependency, then invoke async processing on the layer
-                        // before we continue execution...
-                        //-----------------------------------------------------------
-                        int fd = dl->firstAsyncDependency();
-                        asyncStateLock_.lock();
-                        if (fd >= 0) {
-                            asyncDownloadDependencies_.emplace_back(fd, static_cast<AsyncLayer *>(dl), 1, state.sequenceNo);
-                            if (asyncDependencies_.find(fd) != asyncDependencies_.end()) asyncDependencies_.insert(fd);
-                        }
-                        numBackgroundTasks_++;                  // the async forward below generates a new background task
-                        asyncStateLock_.unlock();
-                        dl->asyncForward(state.sequenceNo, stoken, std::bind(&Engine::asyncDownloadDone, this, dl, std::placeholders::_1));
-#else
-                        THROW_EXCEPTION_ARGS(FynException,"No multithreading support compiled in");
+                if ((sched.flags & SCHED_ASYNC) && (async->firstAsyncDependency() >= 0) && (state.sequenceNo > engineSequence_ + 1)) {
+                    //-----------------------------------------------------------
+                    // The previous sequence may still have to consume the output
+                    // of this download, park the state until that sequence has
+                    // completed (see looper())...
+                    //-----------------------------------------------------------
+                    asyncStateLock_.lock();
+                    recordWaitingLayer(state.sequenceNo, layer->getNumber());
+                    asyncDownloadBlocked_.emplace_back(layer->getNumber(), async, state.sequenceNo, state.clone());
+                    asyncStateLock_.unlock();
+                    return state::DOWNLOADING;
+                }
 #endif
-                    } else dl->forward(state.sequenceNo, stoken);
-                    if (timings_) {
-                        end = fy_get_stamp();
-                        if (runs_ == 0) timingData_[idx] = 0;
-                        timingData_[idx] += fy_elapsed_micros(start, end);
-                    }
-                    if ((writeResults_) && (!dl->isAsync())) {
-                        // TODO (mw) also handle write-out for asynchronous layers, currently they are ignored
-                        buf->write<float>(fname.c_str());
-                    }
-                } else
-                if (dynamic_cast<deep::DeepDownloadLayer *>(layer) && !masked) {
-                    auto * dl = dynamic_cast<deep::DeepDownloadLayer *>(layer);
-                    if (timings_) start = fy_get_stamp();
-                    CPUBuffer * buf = dl->getCPUOutputBuffer(0);
-                    if (!buf) THROW_EXCEPTION_ARGS(FynException,"No output buffer in download layer %s", dl->getName().c_str());
-                    if (dl->isAsync()) {
+                if (timings_) start = fy_get_stamp();
+                CPUBuffer * buf = cpuif->getCPUOutputBuffer(0);
+                if (!buf) THROW_EXCEPTION_ARGS(FynException,"No output buffer in download layer %s", dl->getName().c_str());
+                if (sched.flags & SCHED_ASYNC) {
 #ifdef FYUSENET_MULTITHREADING
-                        //-----------------------------------------------------------
-                        // For async download layers we enter the layer as a download
-                        // dependency, then invoke async processing on the layer
-                        // before we continue execution...
-                        //-----------------------------------------------------------
-                        int fd = dl->firstAsyncDependency();
-                        asyncStateLock_.lock();
-                        if (fd >= 0) {
-                            asyncDownloadDependencies_.emplace_back(fd, dynamic_cast<AsyncLayer *>(dl), 1, state.sequenceNo);
-                            if (asyncDependencies_.find(fd) != asyncDependencies_.end()) asyncDependencies_.insert(fd);
-                        }
-                        numBackgroundTasks_++;                      // the async forward below creates a background task
-                        asyncStateLock_.unlock();
-                        dl->asyncForward(state.sequenceNo, stoken, std::bind(&Engine::asyncDownloadDone, this, dl, std::placeholders::_1));
+                    //-----------------------------------------------------------
+                    // For async download layers we enter the layer as a download
+                    // dependency, then invoke async processing on the layer
+                    // before we continue execution...
+                    //-----------------------------------------------------------
+                    int fd = async->firstAsyncDependency();
+                    asyncStateLock_.lock();
+                    if (fd >= 0) asyncDownloadDependencies_.emplace_back(fd, async, 1, state.sequenceNo);
+                    numBackgroundTasks_++;                  // the async forward below generates a new background task
+                    asyncStateLock_.unlock();
+                    auto done = std::bind(&Engine::asyncDownloadDone, this, async, std::placeholders::_1);
+                    if (sched.flags & SCHED_DOWNLOAD) static_cast<DownloadLayer *>(layer)->asyncForward(state.sequenceNo, stoken, done);
+                    else static_cast<deep::DeepDownloadLayer *>(layer)->asyncForward(state.sequenceNo, stoken, done);
 #else
-                        THROW_EXCEPTION_ARGS(FynException,"No multithreading support compiled in");
+                    THROW_EXCEPTION_ARGS(FynException,"No multithreading support compiled in");
 #endif
-                    } else dl->forward(state.sequenceNo, stoken);
-                    if (timings_) {
-                        end = fy_get_stamp();
-                        if (runs_ == 0) timingData_[idx] = 0;
-                        timingData_[idx] += fy_elapsed_micros(start, end);
-                    }
-                    if ((writeResults_) && (!dl->isAsync())) {
-                        // TODO (mw) missing handling of asynchronous stuff elsewhere
-                        buf->write<float>(fname.c_str());
-                    }
-                } else if (!masked) {
-                    //-------------------------------------------------------
-                    // Handle (standard) GPU layers...
-                    //-------------------------------------------------------
-                    if (timings_) start = fy_get_stamp();
-                    layer->forward(state.sequenceNo, stoken);
-                    if (timings_) {
-                        end = fy_get_stamp();
-                        if (runs_ == 0) timingData_[idx] = 0;
-                        timingData_[idx] += fy_elapsed_micros(start, end);
-                    }
-                    if (writeResults_) {
-                        (dynamic_cast<GPULayerBase *>(layer))->writeResult(fname.c_str(), false);
-                    }
+                } else dl->forward(state.sequenceNo, stoken);
+                if (timings_) {
+                    end = fy_get_stamp();
+                    if (runs_ == 0) timingData_[idx] = 0;
+                    timingData_[idx] += fy_elapsed_micros(start, end);
+                }
+                if ((writeResults_) && (!(sched.flags & SCHED_ASYNC))) {
+                    // TODO (mw) also handle write-out for asynchronous layers, currently they are ignored
+                    buf->write<float>(fname.c_str());
+                }
+            } else if ((replay_) && (sched.segment >= 0) && (!stoken) && (!timings_) && (!writeResults_)) {
+                //-------------------------------------------------------
+                // Handle runs of (standard) GPU layers by replaying the
+                // recorded GL commands and skip over the remaining
+                // layers of the segment...
+                //-------------------------------------------------------
+                ReplaySegment & segment = segments_[sched.segment];
+                forwardSegment(segment, state.sequenceNo);
+                for (size_t i=1; i < segment.layers.size(); i++) ++(state.current);
+            } else {
+                //-------------------------------------------------------
+                // Handle (standard) GPU layers...
+                //-------------------------------------------------------
+                if (timings_) start = fy_get_stamp();
+                layer->forward(state.sequenceNo, stoken);
+                if (timings_) {
+                    end = fy_get_stamp();
+                    if (runs_ == 0) timingData_[idx] = 0;
+                    timingData_[idx] += fy_elapsed_micros(start, end);
+                }
+                if (writeResults_) {
+                    (dynamic_cast<GPULayerBase *>(layer))->writeResult(fname.c_str(), false);
                 }
             }
 #ifdef FYUSENET_MULTITHREADING
-            asyncStateLock_.lock();
-            if (deferredAsyncDependencies_.find(layer->getNumber()) != deferredAsyncDependencies_.end()) {
+            if (sched.flags & SCHED_FENCE) {
+                asyncStateLock_.lock();
                 //----------------------------------------------------------------
-                // This layer was the last layer dependent on an upload layer. To
+                // This layer is the last layer dependent on an upload layer. To
                 // make sure that we do not overwrite the texture with a new
                 // upload, we have to make sure that the GL pipeline has fully read
                 // the texture, so we use the built-in fencing mechanism of GL
@@ -662,7 +789,7 @@ Engine::state Engine::execute(ExecutionState& state, const GfxContextLink & cont
                                 break;  // we do not expect more than one dependency in that part of the chain
                             }
                         }
-                        activeUploadDependencies_[ul] = replacementseq;
+                        uploadSlots_[schedule_[ul->getNumber()].upload].active = replacementseq;
                         it = asyncUploadDeferredDependencies_.erase(it);
                         //----------------------------------------------------------------
                         // Issue a fence here and kick-off a task to wait for the fence.
@@ -678,8 +805,8 @@ Engine::state Engine::execute(ExecutionState& state, const GfxContextLink & cont
                         break;
                     } else ++it;
                 }
+                asyncStateLock_.unlock();
             }
-            asyncStateLock_.unlock();
 #endif
         } // if (layer)
         ++(state.current);
@@ -689,6 +816,75 @@ Engine::state Engine::execute(ExecutionState& state, const GfxContextLink & cont
 }
 
 
+/**
+ * @brief Execute a replay segment
+ *
+ * @param segment Segment to execute
+ * @param sequenceNo Sequence number of the current inference run
+ *
+ * @throws FynException in case of errors during the execution of the layers
+ *
+ * In case the segment has a valid recording, the texture slots for input textures that are
+ * produced outside the segment are updated and the recorded GL commands are replayed. Input
+ * textures that were not assigned to a slot (because they are also written inside the segment)
+ * must not change, otherwise the recording is discarded.
+ *
+ * Without a valid recording, the layers of the segment are executed regularly while the GL
+ * commands that they issue are recorded.
+ */
+void Engine::forwardSegment(ReplaySegment & segment, uint64_t sequenceNo) {
+    using namespace gpu;
+    if (segment.valid) {
+        std::vector<GLuint> slots;
+        for (const ReplayInput & input : segment.inputs) {
+            GLuint tex = input.layer->getInputTexture(input.channel);
+            if (input.slot < 0) {
+                if (tex == input.texture) continue;
+                segment.valid = false;
+                break;
+            }
+            if ((int)slots.size() <= input.slot) slots.resize(input.slot + 1, 0);
+            if ((slots[input.slot] != 0) && (slots[input.slot] != tex)) {
+                segment.valid = false;
+                break;
+            }
+            slots[input.slot] = tex;
+            segment.commands.setTextureSlot(input.slot, tex);
+        }
+        if (segment.valid) {
+            segment.commands.replay();
+            return;
+        }
+    }
+    //-----------------------------------------------------------
+    // Register all input textures that are not written inside
+    // the segment as texture slots and record the commands...
+    //-----------------------------------------------------------
+    segment.commands.reset();
+    segment.inputs.clear();
+    std::unordered_set<GLuint> internal;
+    for (const GPULayerBase * layer : segment.layers) {
+        for (int i=0; layer->hasOutputTexture(i); i++) internal.insert(layer->getOutputTexture(i));
+    }
+    for (GPULayerBase * layer : segment.layers) {
+        for (int i=0; layer->hasInputTexture(i); i++) {
+            GLuint tex = layer->getInputTexture(i);
+            int slot = ((tex != 0) && (internal.find(tex) == internal.end())) ? segment.commands.addTextureSlot(tex) : -1;
+            segment.inputs.push_back(ReplayInput{layer, i, tex, slot});
+        }
+    }
+    segment.commands.begin();
+    try {
+        for (GPULayerBase * layer : segment.layers) layer->forward(sequenceNo, nullptr);
+    } catch (...) {
+        segment.commands.reset();
+        throw;
+    }
+    segment.commands.end();
+    segment.valid = true;
+}
+
+
 #ifdef FYUSENET_MULTITHREADING
 /**
  * @brief Callback for asynchronous upload layers
@@ -730,13 +926,13 @@ void Engine::uploadCallback(gpu::UploadLayer * layer, uint64_t sequenceNo) {
                 // for the pending sequence number
                 //-------------------------------------------------------
                 layer->swapOutputTextures(it->sequenceNo);
-                assert(activeUploadDependencies_[it->provider] == it->sequenceNo);
+                assert(uploadSlots_[schedule_[layer->getNumber()].upload].active == it->sequenceNo);
                 //-------------------------------------------------------
                 // Check if there is a pending state for the resolved
                 // dependency and move it to the ready list...
                 //-------------------------------------------------------
                 for (auto ite=asyncUploadWaiters_.begin(); ite != asyncUploadWaiters_.end() ; ++ite) {
-                    if ((ite->provider == layer) && (ite->dependency == it->dependency)) {
+                    if ((ite->provider == layer) && (ite->dependency == it->dependency) && (ite->sequenceNo == it->sequenceNo)) {
                         pushReadyState(ite->state);
                         asyncUploadWaiters_.erase(ite);
                         break;
@@ -839,6 +1035,7 @@ void Engine::asyncDownloadDone(AsyncLayer *download, uint64_t sequenceNo) {
                     ite = asyncDownloadWaiters_.erase(ite);
                 } else ++ite;
             }
+            it = asyncDownloadDependencies_.erase(it);
         }
         else ++it;
     }
@@ -920,8 +1117,50 @@ void Engine::updateWaitingLayers(uint64_t sequence) {
     for (auto it = asyncUploadWaiters_.begin(); it != asyncUploadWaiters_.end(); ++it) {
         if (it->sequenceNo == sequence) minlayer = std::min(it->dependency, minlayer);
     }
-    if (minlayer == 0) minimumWaitingDependency_.erase(sequence);
-    else minimumWaitingDependency_[sequence] = minlayer;
+    for (auto it = asyncDownloadBlocked_.begin(); it != asyncDownloadBlocked_.end(); ++it) {
+        if (it->sequenceNo == sequence) minlayer = std::min(it->dependency, minlayer);
+    }
+    WaitSlot & slot = waitingLayers_[sequence & waitingMask_];
+    if (slot.sequenceNo == sequence) slot.layer = minlayer;
+}
+#endif
+
+
+#ifdef FYUSENET_MULTITHREADING
+/**
+ * @brief Record a layer that waits for an asynchronous dependency in a sequence
+ *
+ * @param sequence Sequence number of the waiting state
+ * @param layer Number of the layer that waits
+ *
+ * @pre #asyncStateLock_ is held by the calling thread
+ *
+ * Updates the lowest waiting layer number for the supplied \p sequence in the #waitingLayers_
+ * ring buffer. A slot that is still occupied by an older sequence is simply taken over, as the
+ * ring buffer is large enough to hold all sequences that can be in flight at the same time.
+ */
+void Engine::recordWaitingLayer(uint64_t sequence, int layer) {
+    WaitSlot & slot = waitingLayers_[sequence & waitingMask_];
+    if ((slot.sequenceNo != sequence) || (slot.layer == 0)) {
+        assert((slot.sequenceNo <= engineSequence_) || (slot.sequenceNo == sequence) || (slot.layer == 0));
+        slot.sequenceNo = sequence;
+        slot.layer = layer;
+    } else slot.layer = std::min(slot.layer, layer);
+}
+
+
+/**
+ * @brief Retrieve the lowest layer number that waits for an asynchronous dependency in a sequence
+ *
+ * @param sequence Sequence number to query
+ *
+ * @return Lowest waiting layer number or 0 if no layer of the \p sequence is waiting
+ *
+ * @pre #asyncStateLock_ is held by the calling thread
+ */
+int Engine::lowestWaitingLayer(uint64_t sequence) const {
+    const WaitSlot & slot = waitingLayers_[sequence & waitingMask_];
+    return (slot.sequenceNo == sequence) ? slot.layer : 0;
 }
 #endif
 
@@ -955,8 +1194,7 @@ void Engine::looper(const GfxContextLink & context) {
         asyncStateLock_.lock();
         ExecutionState estate = readyStates_.front();
         readyStates_.pop_front();
-        auto minit = minimumWaitingDependency_.find(estate.sequenceNo);
-        int lowestwait = (minit != minimumWaitingDependency_.end()) ? minit->second : 0;
+        int lowestwait = lowestWaitingLayer(estate.sequenceNo);
         bool discard = false;
         // NOTE (mw) maybe we should the sequence lock here, also if we discard because of old sequence, we should update the minlist
         if ((estate.sequenceNo <= engineSequence_) || ((lowestwait > 0) && (estate.current.layer() != lowestwait))) {
@@ -974,6 +1212,15 @@ void Engine::looper(const GfxContextLink & context) {
                 engineSequence_ = estate.sequenceNo;
                 sequenceDone_.notify_one();
                 sequenceLock_.unlock();
+                asyncStateLock_.lock();
+                auto it = asyncDownloadBlocked_.begin();
+                while (it != asyncDownloadBlocked_.end()) {
+                    if (it->sequenceNo <= estate.sequenceNo + 1) {
+                        pushReadyState(it->state);      // asyncStateLock_ held
+                        it = asyncDownloadBlocked_.erase(it);
+                    } else ++it;
+                }
+                asyncStateLock_.unlock();
                 if (sequenceCallback_) sequenceCallback_(estate.sequenceNo);
             } else if (rc == state::NET_ERROR) {
                 // TODO (mw) handle error here
@@ -984,6 +1231,37 @@ void Engine::looper(const GfxContextLink & context) {
 }
 #endif
 
+
+#ifdef FYUSENET_MULTITHREADING
+/**
+ * @brief Make sure that the %PBO pools are large enough for the configured pipeline depth
+ *
+ * Each asynchronous upload or download layer requires one %PBO per transfer in flight. This
+ * function counts the asynchronous layers in the current layer set and enlarges the read and
+ * write %PBO pools of the context (if necessary), such that each of these layers is able to keep
+ * #pipelineDepth_ transfers in flight without waiting for a %PBO to become available.
+ *
+ * @note The pools are shared between all networks that run on the same context, therefore this
+ *       function never shrinks the pools.
+ *
+ * @see setPipelineDepth()
+ */
+void Engine::reservePBOs() {
+    using namespace gpu;
+    int uploads = 0, downloads = 0;
+    for (auto it = layers_.begin(); it != layers_.end(); ++it) {
+        auto * async = dynamic_cast<AsyncLayer *>(it.second);
+        if ((!async) || (!async->isAsync())) continue;
+        if (dynamic_cast<UploadLayer *>(it.second)) uploads++;
+        else downloads++;
+    }
+    opengl::PBOPool * wpool = context_.interface()->getWritePBOPool();
+    opengl::PBOPool * rpool = context_.interface()->getReadPBOPool();
+    if ((wpool) && (wpool->maxPBOs() < uploads * pipelineDepth_)) wpool->setMaxPBOs(uploads * pipelineDepth_);
+    if ((rpool) && (rpool->maxPBOs() < downloads * pipelineDepth_)) rpool->setMaxPBOs(downloads * pipelineDepth_);
+}
+#endif
+
 } // fyusion::fyusenet namespace
 
 // vim: set expandtab ts=4 sw=4:
@@ -15,6 +15,7 @@
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 #include <cassert>
 #include <cstdint>
 #include <list>
@@ -30,6 +31,7 @@
 #include "../gpu/gpulayerbase.h"
 #include "../gpu/downloadinterface.h"
 #include "../gpu/gfxcontexttracker.h"
+#include "../gl/glcommandbuffer.h"
 #ifdef FYUSENET_MULTITHREADING
 #include "../gl/asyncpool.h"
 #endif
@@ -94,6 +96,7 @@ class Engine : public fyusenet::GfxContextTracker {
     void disableIntermediateOutput();
     void enableTimings();
     void disableTimings();
+    void setCommandReplay(bool enable);
     void setup(NeuralNetwork *net);
     void cleanup(const std::function<void()> & broom);
 
@@ -147,15 +150,35 @@ class Engine : public fyusenet::GfxContextTracker {
         return sequenceNo_;
     }
 
+    /**
+     * @brief Continue sequence numbering of another engine
+     *
+     * @param next Sequence number to be issued with the next call to forwardLayers()
+     *
+     * This is used when a network switches between engines (e.g. on a resolution change), such
+     * that the sequence numbers remain strictly monotonous from the perspective of the network.
+     * Supplied sequence numbers that are lower than the next sequence number of this engine are
+     * ignored.
+     *
+     * @pre The engine is idle, i.e. there are no pending inference runs
+     */
+    void continueSequence(uint64_t next) {
+        std::lock_guard<std::mutex> lck(sequenceLock_);
+        if (next > sequenceNo_) sequenceNo_ = next;
+    }
+
 
     /**
      * @brief Register network layer set for inference by this engine
      *
      * @param layers Set of layers returned by the LayerFactory instance
      *
+     * Registering a layer set also compiles the static execution schedule for the layers, see
+     * compileSchedule().
      */
     void setLayers(const CompiledLayers& layers) {
         layers_ = layers;
+        compileSchedule();
     }
 
 
@@ -197,6 +220,29 @@ class Engine : public fyusenet::GfxContextTracker {
     void setNewSequenceCallback(const std::function<void(uint64_t)> & callback) {
         newSeqCallback_ = callback;
     }
+
+    /**
+     * @brief Set maximum number of runs that may be in flight in asynchronous operation
+     *
+     * @param depth Number of sequences that may be issued before forwardLayers() blocks (at
+     *              least 1, default is 2)
+     *
+     * In asynchronous mode, forwardLayers() only queues a new run and returns immediately. In
+     * order to not flood the pipeline, it blocks the caller once \p depth runs have been issued
+     * which have not been completed by the engine thread yet. In addition, the %PBO pools of the
+     * context are enlarged (if necessary) on setup() such that each asynchronous upload and download
+     * layer can keep \p depth transfers in flight.
+     *
+     * @note Must be called before setup(), as the ring buffer of in-flight sequences is sized
+     *       when the execution schedule is compiled
+     *
+     * @throws FynException if the engine has already been set up
+     */
+    void setPipelineDepth(int depth) {
+        assert(depth >= 1);
+        if (setup_) THROW_EXCEPTION_ARGS(FynException, "Pipeline depth must be set before engine setup");
+        pipelineDepth_ = depth;
+    }
 #endif
 
  private:
@@ -294,9 +340,93 @@ class Engine : public fyusenet::GfxContextTracker {
         ExecutionState state;                       //!< Actual state that is pending execution
     };
 
+    /**
+     * @brief Static per-layer flags of the execution schedule
+     *
+     * @see ScheduleEntry, compileSchedule()
+     */
+    enum schedflags : uint8_t {
+        SCHED_CPU = 1,                  //!< Layer is a CPU layer
+        SCHED_UPLOAD = 2,               //!< Layer is an upload layer
+        SCHED_DOWNLOAD = 4,             //!< Layer is a (shallow) download layer
+        SCHED_DEEP_DOWNLOAD = 8,        //!< Layer is a deep download layer
+        SCHED_ASYNC = 16,               //!< Layer is an asynchronous upload or download layer
+        SCHED_WAIT = 32,                //!< Layer is the first consumer of an asynchronous layer and may have to wait for it
+        SCHED_FENCE = 64                //!< Layer is the last consumer of an asynchronous upload layer and has to issue a fence
+    };
+
+    /**
+     * @brief Static scheduling information for a single layer
+     *
+     * The execution schedule is a flat array that is indexed by the layer number and compiled once
+     * when the layers are registered. It replaces the per-layer type checks and dependency lookups
+     * in execute(), such that only layers flagged with #SCHED_WAIT or #SCHED_FENCE touch the
+     * #asyncStateLock_.
+     */
+    struct ScheduleEntry {
+        uint8_t flags = 0;                          //!< Combination of #schedflags
+        int upload = -1;                            //!< Index into #uploadSlots_ for upload layers, -1 otherwise
+        int segment = -1;                           //!< Index into #segments_ for the first layer of a replay segment, -1 otherwise
+    };
+
+    /**
+     * @brief Input texture of a layer inside a replay segment
+     *
+     * @see ReplaySegment
+     */
+    struct ReplayInput {
+        gpu::GPULayerBase * layer = nullptr;        //!< Layer that reads the texture
+        int channel = 0;                            //!< Input channel (texture index) of the layer
+        GLuint texture = 0;                         //!< Texture handle that was used for recording
+        int slot = -1;                              //!< Texture slot in the command buffer, -1 if the texture must not change
+    };
+
+    /**
+     * @brief Maximal run of consecutive standard GPU layers that is executed by replaying a
+     *        recorded GL command stream
+     *
+     * The first execution of a segment runs the layers and records the issued GL commands,
+     * subsequent executions only replay the recorded stream. Input textures that are produced
+     * outside the segment (for example by upload layers that cycle through texture sets) are
+     * mapped to texture slots of the command buffer and refreshed prior to each replay.
+     *
+     * @see compileSchedule(), forwardSegment()
+     */
+    struct ReplaySegment {
+        std::vector<gpu::GPULayerBase *> layers;    //!< Layers of the segment in execution order
+        std::vector<ReplayInput> inputs;            //!< Input textures of all layers, as used for recording
+        opengl::GLCommandBuffer commands;           //!< Recorded GL commands of the segment
+        bool valid = false;                         //!< Indicator whether #commands can be replayed
+    };
+
+#ifdef FYUSENET_MULTITHREADING
+    /**
+     * @brief Bookkeeping for a single asynchronous upload layer
+     *
+     * @see #uploadSlots_
+     */
+    struct UploadSlot {
+        gpu::UploadLayer * layer = nullptr;         //!< Upload layer that is tracked by this slot
+        uint64_t active = 0;                        //!< Sequence number the layer is engaged in (0 if not engaged)
+        uint64_t lastIssued = 0;                    //!< Sequence number of the most recently issued upload
+    };
+
+    /**
+     * @brief Entry in the ring buffer of in-flight sequences
+     *
+     * @see #waitingLayers_
+     */
+    struct WaitSlot {
+        uint64_t sequenceNo = 0;                    //!< Sequence number that the slot is currently used for
+        int layer = 0;                              //!< Lowest layer number that is waiting in the sequence (0 if none)
+    };
+#endif
+
     // ------------------------------------------------------------------------
     // Non-public methods
     // ------------------------------------------------------------------------
+    void compileSchedule();
+    void forwardSegment(ReplaySegment & segment, uint64_t sequenceNo);
     state execute(ExecutionState& state, const GfxContextLink & context);
 #ifdef FYUSENET_MULTITHREADING
     void waitForUploadFence(const GfxContextLink& ctx, GLsync sync, gpu::UploadLayer *target, GLuint64 timeout, uint64_t sequenceNo);
@@ -304,7 +434,10 @@ class Engine : public fyusenet::GfxContextTracker {
     void pushReadyState(const ExecutionState& state);
     void asyncDownloadDone(AsyncLayer *target, uint64_t sequenceNo);
     void updateWaitingLayers(uint64_t sequence);
+    void recordWaitingLayer(uint64_t sequence, int layer);
+    [[nodiscard]] int lowestWaitingLayer(uint64_t sequence) const;
     void looper(const GfxContextLink & context);
+    void reservePBOs();
 #endif
 
     // ------------------------------------------------------------------------
@@ -317,8 +450,23 @@ class Engine : public fyusenet::GfxContextTracker {
     bool writeResults_ = false;      //!< Flag that controls if intermediate (layer-by-layer) results should be written to disk for debugging purposes
     bool timings_ = false;           //!< Flag that controls whether or not \b CPU timings should be kept on a layer-by-layer basis
     bool setup_ = false;             //!< Indicator if engine was setup
+    bool replay_ = false;            //!< Flag that controls if runs of standard GPU layers are replayed from recorded GL command streams
     CompiledLayers layers_;          //!< Set of runnable layers generated by the network-specific code
 
+    /**
+     * Static execution schedule, indexed by layer number.
+     *
+     * @see compileSchedule(), ScheduleEntry
+     */
+    std::vector<ScheduleEntry> schedule_;
+
+    /**
+     * Replay segments of the execution schedule, only used when command replay is enabled.
+     *
+     * @see setCommandReplay(), ReplaySegment
+     */
+    std::vector<ReplaySegment> segments_;
+
     /**
      * Timing data on a per-layer basis. Index is the layer number and the values are the timings
      * per layer given in microseconds.
@@ -335,6 +483,7 @@ class Engine : public fyusenet::GfxContextTracker {
     uint64_t engineSequence_ = 0;               //!< Highest sequence number that has been completed by the engine
     bool async_ = false;                        //!< Flag that indicates if the engine shall run asynchronously
     std::mutex upIssueLock_;                    //!< Lock for issueing asynchronous upload operations
+    int pipelineDepth_ = 2;                     //!< Maximum number of sequences in flight, see setPipelineDepth()
 
     /**
      * @brief asyncStateLock_
@@ -416,6 +565,19 @@ class Engine : public fyusenet::GfxContextTracker {
      */
     std::list<WaitingState<AsyncLayer>> asyncDownloadWaiters_;
 
+    /**
+     * @brief States that are blocked from issuing an asynchronous download
+     *
+     * Asynchronous download layers write into the same CPU buffer for every sequence. If such a
+     * download has consumers inside the network, a sequence may only issue the download after the
+     * previous sequence (and thus the consumers of its download) has completed. States that
+     * reach the download too early are parked in this list until the looper() completes the
+     * preceding sequence.
+     *
+     * @see execute(), looper(), #asyncStateLock_
+     */
+    std::list<WaitingState<AsyncLayer>> asyncDownloadBlocked_;
+
     /**
      * @brief States that are waiting for an upload to complete
      *
@@ -432,43 +594,35 @@ class Engine : public fyusenet::GfxContextTracker {
     std::list<WaitingState<gpu::UploadLayer>> asyncUploadWaiters_;
 
     /**
-     * @brief Static set of layer numbers that have a dependency on an asynchronous layer
+     * @brief Bookkeeping for asynchronous upload layers
      *
-     * In order to quickly determine whether or not a layer is subject to waiting, this set
-     * may be queried for the layer number.
-     */
-    std::unordered_set<int> asyncDependencies_;
-
-    /**
-     * @brief Static set of layer numbers that have a deferred dependency on an upload layer
-     *
-     * In order to quickly determine whether or not a layer is subject to waiting, this set
-     * may be queried for the layer number.
+     * Contains one slot per asynchronous upload layer, which keeps track of the sequence number
+     * that the upload layer is \e engaged in (either performing the actual upload or still
+     * providing the uploaded data to subsequent layers) and of the sequence number of the most
+     * recently issued upload on that layer. With more than two runs in flight, a new upload has
+     * to wait for the consumers of the most recently issued upload rather than the consumers of
+     * the currently active upload. The slots are indexed by ScheduleEntry::upload.
      *
-     * @see Dependency
+     * @see #asyncStateLock_, compileSchedule()
      */
-    std::unordered_set<int> deferredAsyncDependencies_;
+    std::vector<UploadSlot> uploadSlots_;
 
     /**
-     * Maps an upload layer to a sequence number whenever the upload layer is \e engaged in either
-     * the actual upload or still providing the uploaded data to subsequent layers. Once an upload
-     * layer has no more dependent layers in a single run, the sequence number it maps to will be
-     * reset to 0 (invalid sequence number).
+     * @brief Ring buffer that maps in-flight sequences to the lowest waiting layer number
      *
-     * @see #asyncStateLock_
+     * This ring buffer keeps track of the lowest layer number within a sequence that is waiting for
+     * an asynchronous dependency to resolve. It is indexed by the sequence number (masked by
+     * #waitingMask_) and sized such that it can hold all sequences that may be in flight given
+     * the #pipelineDepth_.
+     *
+     * @see looper(), recordWaitingLayer(), lowestWaitingLayer(), #asyncStateLock_
      */
-    std::unordered_map<gpu::UploadLayer *, uint64_t> activeUploadDependencies_;
-
+    std::vector<WaitSlot> waitingLayers_;
 
     /**
-     * @brief Maps sequence numbers to the lowest layer number in the waiting queues
-     *
-     * This map keeps track of the lowest layer number within a sequence that is waiting for an
-     * asynchronous dependency to resolve.
-     *
-     * @see looper()
+     * Bit mask to map sequence numbers to entries in #waitingLayers_
      */
-    std::unordered_map<uint64_t, int> minimumWaitingDependency_;
+    uint64_t waitingMask_ = 0;
 
 
     /**
@@ -103,6 +103,15 @@ enum class PosEncType : uint8_t {
     ROTARY                  //!< Use "rotary encoding" as positional encoding
 };
 
+/**
+ * @brief Enumerator for storage types of the key/value cache in attention layers
+ */
+enum class KVCacheType : uint8_t {
+    DEFAULT = 0,            //!< Store keys and values at the precision of the compute buffers
+    FLOAT16,                //!< Store keys and values as half-precision floating-point numbers
+    INT8                    //!< Store keys and values as 8-bit integers with one scale per token and head
+};
+
 /**
  * @brief Enumerator for blur kernel types on blur layers
  *
@@ -179,7 +188,10 @@ enum class LayerType : uint16_t {
     IMGEXTRACT,             //!< ImgExtract / Flatten
     BLUR2D,                 //!< 2D Blur layer
     NONMAX2D,               //!< 2D Non-Maximum Suppression
+    COMPACT2D,              //!< Compaction of sparse 2D results (e.g. after non-maximum suppression) into a small list
+    TOPK,                   //!< Selection of the K highest-scoring channels (e.g. of a classification head)
     RGB2BGR,                //!< Simple RGB -> BGR swapping on 2D images
+    IMGPREPROC,             //!< Image preprocessing (resize, crop, color conversion and normalization) on 2D images
     DEEP2SHALLOW,           //!< Deep -> Shallow conversion layer
     SHALLOW2DEEP,           //!< Shallow -> Deep conversion layer
     DOWNLOAD,               //!< GPU -> CPU download layer
@@ -0,0 +1,331 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Multi-Device Dispatcher for Network Replicas
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <cassert>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "networkdispatcher.h"
+#include "../gpu/gfxcontextmanager.h"
+#include "../gl/glcontextinterface.h"
+#include "../gl/shadercache.h"
+#include "../common/logging.h"
+
+//-------------------------------------- Global Variables ------------------------------------------
+
+#ifdef FYUSENET_MULTITHREADING
+
+namespace fyusion::fyusenet {
+
+//-------------------------------------- Local Definitions -----------------------------------------
+
+/**
+ * Number of PBOs in the read/write pools of context managers that are created by the dispatcher
+ */
+static constexpr int PBO_POOL_SIZE = 4;
+
+/*##################################################################################################
+#                                   P U B L I C  F U N C T I O N S                                 #
+##################################################################################################*/
+
+/**
+ * @brief Constructor
+ *
+ * @param devices List of device indices, one network replica is created for each entry
+ * @param creator Factory function that creates a (not yet set up) network replica for a context
+ * @param queueDepth Maximum number of outstanding requests per replica (at least 1)
+ *
+ * @throws FynException on invalid parameters
+ */
+NetworkDispatcher::NetworkDispatcher(const std::vector<int> & devices, const factory & creator, int queueDepth) :
+      creator_(creator), queueDepth_(queueDepth) {
+    if (devices.empty()) THROW_EXCEPTION_ARGS(FynException, "No devices supplied");
+    if (!creator) THROW_EXCEPTION_ARGS(FynException, "No network factory supplied");
+    if (queueDepth < 1) THROW_EXCEPTION_ARGS(FynException, "Illegal queue depth %d", queueDepth);
+    for (int dev : devices) {
+        if (dev < 0) THROW_EXCEPTION_ARGS(FynException, "Illegal device index %d", dev);
+        auto * rep = new Replica();
+        rep->device = dev;
+        replicas_.push_back(rep);
+    }
+}
+
+
+/**
+ * @brief Destructor
+ *
+ * @note The destructor does not perform any cleanup of the replicas, call cleanup() before
+ *       deleting the dispatcher.
+ */
+NetworkDispatcher::~NetworkDispatcher() {
+    if (setup_) FNLOGW("Please call cleanup() before deleting the dispatcher");
+    for (Replica * rep : replicas_) delete rep;
+    replicas_.clear();
+}
+
+
+/**
+ * @brief Create network replicas and start worker threads
+ *
+ * @throws FynException (or any other exception raised by the network factory or the network setup)
+ *         in case a replica could not be created. Replicas that were already started are shut
+ *         down in that case.
+ *
+ * The replicas are initialized one after another, each one on its own worker thread. This
+ * includes creation of the GL context for the device, creation of the network via the factory
+ * and the network setup.
+ */
+void NetworkDispatcher::setup() {
+    if (setup_) return;
+    quit_ = false;
+    for (int i=0; i < (int)replicas_.size(); i++) {
+        Replica * rep = replicas_[i];
+        std::unique_lock<std::mutex> lck(lock_);
+        initDone_ = false;
+        initError_ = nullptr;
+        rep->thread = new std::thread(&NetworkDispatcher::workerLoop, this, rep, i);
+        ready_.wait(lck, [this]() { return initDone_; });
+        if (initError_) {
+            std::exception_ptr err = initError_;
+            initError_ = nullptr;
+            lck.unlock();
+            rep->thread->join();
+            delete rep->thread;
+            rep->thread = nullptr;
+            setup_ = true;
+            cleanup();
+            std::rethrow_exception(err);
+        }
+    }
+    setup_ = true;
+}
+
+
+/**
+ * @brief Submit inference request to the least busy replica
+ *
+ * @param prepare Callback that prepares the replica network for the run, for example by setting
+ *                the input data. Invoked on the worker thread of the replica.
+ * @param done Optional callback that is invoked on the worker thread of the replica after the run
+ *             has been performed, for example to read out the results
+ *
+ * @return Ticket that was issued for the request
+ *
+ * @throws FynException in case the dispatcher was not set up
+ *
+ * This function blocks in case all replicas have reached their maximum number of outstanding
+ * requests.
+ */
+uint64_t NetworkDispatcher::submit(const preparation & prepare, const completion & done) {
+    if (!setup_) THROW_EXCEPTION_ARGS(FynException, "Dispatcher was not set up");
+    std::unique_lock<std::mutex> lck(lock_);
+    int target = -1;
+    idle_.wait(lck, [this, &target]() {
+        target = pickReplica();
+        return (target >= 0);
+    });
+    Replica * rep = replicas_[target];
+    uint64_t ticket = nextTicket_++;
+    rep->queue.push_back(Request{ticket, prepare, done});
+    roundRobin_ = (target + 1) % (int)replicas_.size();
+    lck.unlock();
+    rep->wakeup.notify_one();
+    return ticket;
+}
+
+
+/**
+ * @brief Wait until all submitted requests have been processed
+ */
+void NetworkDispatcher::finish() {
+    std::unique_lock<std::mutex> lck(lock_);
+    idle_.wait(lck, [this]() {
+        for (const Replica * rep : replicas_) {
+            if ((rep->busy) || (!rep->queue.empty())) return false;
+        }
+        return true;
+    });
+}
+
+
+/**
+ * @brief Process all pending requests, stop worker threads and release the network replicas
+ *
+ * The network replicas are cleaned up and deleted on their worker threads, which then release
+ * their GL contexts.
+ */
+void NetworkDispatcher::cleanup() {
+    if (!setup_) return;
+    finish();
+    lock_.lock();
+    quit_ = true;
+    lock_.unlock();
+    for (Replica * rep : replicas_) {
+        if (rep->thread) {
+            rep->wakeup.notify_all();
+            rep->thread->join();
+            delete rep->thread;
+            rep->thread = nullptr;
+        }
+        rep->context.reset();
+    }
+    setup_ = false;
+}
+
+
+/**
+ * @brief Retrieve number of requests that were processed by a replica
+ *
+ * @param replica Replica index
+ *
+ * @return Number of requests that were run on the replica
+ */
+uint64_t NetworkDispatcher::processed(int replica) const {
+    std::lock_guard<std::mutex> lck(lock_);
+    return replicas_.at(replica)->processed;
+}
+
+
+/*##################################################################################################
+#                               N O N -  P U B L I C  F U N C T I O N S                            #
+##################################################################################################*/
+
+/**
+ * @brief Main loop of a worker thread
+ *
+ * @param replica Replica that is driven by the worker thread
+ * @param index Index of the replica
+ *
+ * Initializes the replica, signals the result of the initialization to setup() and then runs the
+ * requests from the queue of the replica until the dispatcher is cleaned up.
+ */
+void NetworkDispatcher::workerLoop(Replica * replica, int index) {
+    try {
+        initReplica(replica, index);
+    } catch (...) {
+        shutdownReplica(replica);
+        std::lock_guard<std::mutex> lck(lock_);
+        initError_ = std::current_exception();
+        initDone_ = true;
+        ready_.notify_all();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lck(lock_);
+        initDone_ = true;
+    }
+    ready_.notify_all();
+    std::unique_lock<std::mutex> lck(lock_);
+    while (true) {
+        replica->wakeup.wait(lck, [this, replica]() { return (quit_ || !replica->queue.empty()); });
+        if (replica->queue.empty()) break;
+        Request req = std::move(replica->queue.front());
+        replica->queue.pop_front();
+        replica->busy = true;
+        lck.unlock();
+        NeuralNetwork::execstate state{NeuralNetwork::state::EXEC_ERROR, 0};
+        try {
+            if (req.prepare) req.prepare(replica->network, index);
+            state = replica->network->forward();
+        } catch (std::exception & ex) {
+            FNLOGE("Request %ld failed on replica %d (device %d): %s", (long)req.ticket, index, replica->device, ex.what());
+        }
+        if (req.done) req.done(req.ticket, replica->network, index, state);
+        lck.lock();
+        replica->busy = false;
+        replica->processed++;
+        idle_.notify_all();
+    }
+    lck.unlock();
+    shutdownReplica(replica);
+}
+
+
+/**
+ * @brief Create GL context and network for a replica
+ *
+ * @param replica Replica to initialize
+ * @param index Index of the replica
+ *
+ * @pre Called from the worker thread of the \p replica
+ *
+ * If the context manager of the device does not have a main context yet, a main context is
+ * created (and PBO pools are set up for it). Otherwise a context is derived from the main
+ * context of the device. The context is made current to the calling thread.
+ */
+void NetworkDispatcher::initReplica(Replica * replica, int index) {
+    auto mgr = GfxContextManager::instance(replica->device);
+    GfxContextLink main = mgr->context();
+    if (!main.isValid()) {
+        replica->context = mgr->createMainContext(true);
+        if (!mgr->getReadPBOPool()) mgr->setupPBOPools(PBO_POOL_SIZE, PBO_POOL_SIZE);
+    } else {
+        replica->context = mgr->createDerived(main);
+        if (!replica->context.interface()->makeCurrent()) {
+            THROW_EXCEPTION_ARGS(FynException, "Cannot make context current for replica %d", index);
+        }
+    }
+    replica->network = creator_(replica->context, index);
+    if (!replica->network) THROW_EXCEPTION_ARGS(FynException, "Network factory did not return a network for replica %d", index);
+    replica->network->setup();
+}
+
+
+/**
+ * @brief Release network and GL context of a replica
+ *
+ * @param replica Replica to shut down
+ *
+ * @pre Called from the worker thread of the \p replica
+ *
+ * The shader cache of the replica context is released as well, as the context is not bound to
+ * any thread afterwards.
+ */
+void NetworkDispatcher::shutdownReplica(Replica * replica) {
+    if (replica->network) {
+        replica->network->cleanup();
+        delete replica->network;
+        replica->network = nullptr;
+    }
+    if (replica->context.isValid()) {
+        opengl::ShaderCache::release(replica->context);
+        replica->context.interface()->releaseCurrent();
+    }
+}
+
+
+/**
+ * @brief Find replica with the least outstanding work that can accept another request
+ *
+ * @return Index of the replica or -1 if all replicas have reached their queue depth
+ *
+ * @pre #lock_ is held by the caller
+ */
+int NetworkDispatcher::pickReplica() const {
+    int best = -1;
+    int bestload = queueDepth_;
+    int num = (int)replicas_.size();
+    for (int i=0; i < num; i++) {
+        int idx = (roundRobin_ + i) % num;
+        const Replica * rep = replicas_[idx];
+        int load = (int)rep->queue.size() + ((rep->busy) ? 1 : 0);
+        if (load < bestload) {
+            best = idx;
+            bestload = load;
+        }
+    }
+    return best;
+}
+
+} // fyusion::fyusenet namespace
+
+#endif
+
+// vim: set expandtab ts=4 sw=4:
@@ -0,0 +1,187 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Multi-Device Dispatcher for Network Replicas (Header)
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <thread>
+#include <vector>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "neuralnetwork.h"
+#include "../gpu/gfxcontextlink.h"
+
+//------------------------------------- Public Declarations ----------------------------------------
+
+#ifdef FYUSENET_MULTITHREADING
+
+namespace fyusion::fyusenet {
+
+/**
+ * @brief Dispatcher that distributes inference requests over network replicas on several devices
+ *
+ * This class maintains one replica of a neural network per entry in a device list and spreads
+ * the incoming inference requests over these replicas. Each replica is driven by its own worker
+ * thread, which owns a GL context on the GfxContextManager of the respective device:
+ *   - If the manager of the device does not have a main context yet, the worker creates one
+ *   - Otherwise the worker uses a context that is derived from the main context of that device
+ *
+ * Every replica has its own request queue. Requests are submitted to the replica with the least
+ * outstanding work (queued and running requests), ties are broken in a round-robin fashion. Once
+ * all queues are full, submit() blocks until a replica has finished a request, which provides
+ * back-pressure to the caller.
+ *
+ * A request consists of two callbacks that are invoked on the worker thread of the replica with
+ * its GL context being current:
+ *   - a \e prepare callback that sets the input of the replica network prior to forward()
+ *   - a \e completion callback that is invoked after forward() and can read out the results
+ *
+ * Both callbacks receive a globally unique and increasing \e ticket, which is also returned by
+ * submit(). Completions are reported with the execution state (including the sequence number)
+ * of the replica network, such that they can be related to the per-network sequence callbacks.
+ * Completions of different replicas are not ordered with respect to each other.
+ *
+ * Replicas are run synchronously by their worker threads, the parallelism is provided by the
+ * different devices. Listing the same device multiple times creates several replicas on that
+ * device, which share the weights and shaders of the device (provided that the network factory
+ * uses a shared gpu::WeightStore for the replicas).
+ *
+ * On systems with a single GPU, additional device indices are mapped onto the available EGL
+ * devices. Each device index still receives its own GfxContextManager with separate contexts,
+ * which can be used to test the dispatching on a single machine.
+ *
+ * @code
+ * NetworkDispatcher disp({0, 1}, [](const GfxContextLink & ctx, int replica) {
+ *     return new MyNetwork(ctx);
+ * });
+ * disp.setup();
+ * disp.submit([&](NeuralNetwork * net, int replica) { ... set input ... },
+ *             [&](uint64_t ticket, NeuralNetwork * net, int replica, const NeuralNetwork::execstate& st) { ... read output ... });
+ * disp.finish();
+ * disp.cleanup();
+ * @endcode
+ *
+ * @warning The dispatcher must be cleaned up before the GfxContextManager is torn down.
+ */
+class NetworkDispatcher {
+ public:
+    /**
+     * Function that creates a network replica for a given context (the network must not be set up)
+     */
+    using factory = std::function<NeuralNetwork *(const GfxContextLink & context, int replica)>;
+
+    /**
+     * Function that prepares a replica for a run (e.g. sets input data)
+     */
+    using preparation = std::function<void(NeuralNetwork * network, int replica)>;
+
+    /**
+     * Function that is invoked after a run was performed on a replica
+     */
+    using completion = std::function<void(uint64_t ticket, NeuralNetwork * network, int replica, const NeuralNetwork::execstate & state)>;
+
+    // ------------------------------------------------------------------------
+    // Constructor / Destructor
+    // ------------------------------------------------------------------------
+    NetworkDispatcher(const std::vector<int> & devices, const factory & creator, int queueDepth = 2);
+    ~NetworkDispatcher();
+
+    // ------------------------------------------------------------------------
+    // Public methods
+    // ------------------------------------------------------------------------
+    void setup();
+    uint64_t submit(const preparation & prepare, const completion & done = completion());
+    void finish();
+    void cleanup();
+
+    /**
+     * @brief Retrieve number of network replicas
+     *
+     * @return Number of replicas (one per entry in the device list)
+     */
+    [[nodiscard]] int replicas() const {
+        return (int)replicas_.size();
+    }
+
+    /**
+     * @brief Retrieve device that a replica runs on
+     *
+     * @param replica Replica index
+     *
+     * @return Device index of the replica
+     */
+    [[nodiscard]] int device(int replica) const {
+        return replicas_.at(replica)->device;
+    }
+
+    uint64_t processed(int replica) const;
+
+ private:
+    /**
+     * @brief Single inference request
+     */
+    struct Request {
+        uint64_t ticket = 0;                //!< Ticket that was issued for the request
+        preparation prepare;                //!< Callback that prepares the network for the run
+        completion done;                    //!< Callback that is invoked after the run
+    };
+
+    /**
+     * @brief Network replica with its worker thread and request queue
+     */
+    struct Replica {
+        int device = 0;                     //!< Device index the replica runs on
+        GfxContextLink context;             //!< GL context that is current to the worker thread
+        NeuralNetwork * network = nullptr;  //!< Network instance, owned by the replica
+        std::thread * thread = nullptr;     //!< Worker thread
+        std::deque<Request> queue;          //!< Pending requests
+        bool busy = false;                  //!< Indicator that a request is currently being run
+        uint64_t processed = 0;             //!< Number of requests that were run on this replica
+        std::condition_variable wakeup;     //!< Signals new requests (or shutdown) to the worker thread
+    };
+
+    // ------------------------------------------------------------------------
+    // Non-public methods
+    // ------------------------------------------------------------------------
+    void workerLoop(Replica * replica, int index);
+    void initReplica(Replica * replica, int index);
+    void shutdownReplica(Replica * replica);
+    [[nodiscard]] int pickReplica() const;
+
+    // ------------------------------------------------------------------------
+    // Member variables
+    // ------------------------------------------------------------------------
+    factory creator_;                           //!< Factory function for network replicas
+    int queueDepth_ = 2;                        //!< Maximum number of outstanding requests per replica
+    std::vector<Replica *> replicas_;           //!< Network replicas
+    mutable std::mutex lock_;                   //!< Serializes access to the queues and worker states
+    std::condition_variable idle_;              //!< Signals finished requests (for back-pressure and finish())
+    std::condition_variable ready_;             //!< Signals completed initialization of a worker thread
+    std::exception_ptr initError_;              //!< Exception that was raised while initializing a worker thread
+    bool initDone_ = false;                     //!< Indicator that the currently initializing worker is done
+    bool setup_ = false;                        //!< Indicator if the dispatcher was set up
+    bool quit_ = false;                         //!< Indicator that the worker threads should terminate
+    uint64_t nextTicket_ = 1;                   //!< Ticket to be issued for the next request
+    int roundRobin_ = 0;                        //!< Replica to start the search for the least busy one
+};
+
+} // fyusion::fyusenet namespace
+
+#endif
+
+// vim: set expandtab ts=4 sw=4:
@@ -10,10 +10,14 @@
 //--------------------------------------- System Headers -------------------------------------------
 
 #include <cassert>
+#include <algorithm>
 
 //-------------------------------------- Project  Headers ------------------------------------------
 
 #include "neuralnetwork.h"
+#ifdef FYUSENET_GL_BACKEND
+#include "../gpu/weightstore.h"
+#endif
 
 //-------------------------------------- Global Variables ------------------------------------------
 
@@ -39,6 +43,10 @@ NeuralNetwork::NeuralNetwork(const GfxContextLink& ctx) {
 NeuralNetwork::~NeuralNetwork() {
     assert(engine_ == nullptr);
     if (engine_) FNLOGW("Please call cleanup() before deleting network instance");
+#ifdef FYUSENET_GL_BACKEND
+    delete weightStore_;
+    weightStore_ = nullptr;
+#endif
 }
 
 
@@ -51,6 +59,7 @@ NeuralNetwork::~NeuralNetwork() {
  * This function performs a cleanup of most resources consumed by the neural network, in particular
  * it will deallocate GPU resources taken by the net, such as buffers and textures. Note that
  * the GLSL shaders are kept in a central shader cache which will not be cleaned by this function.
+ * The resources of previously used input resolutions (see resize()) are released as well.
  *
  * @see finish, Engine::cleanup
  */
@@ -59,6 +68,7 @@ void NeuralNetwork::cleanup() {
 #ifndef FYUSENET_MULTITHREADING
     assertContext();
 #endif
+    releaseParked();
     auto broom = [this]() {
         if (bufferMgr_) bufferMgr_->cleanup();
         delete bufferMgr_;
@@ -88,12 +98,15 @@ void NeuralNetwork::cleanup() {
 void NeuralNetwork::setup() {
     if (setup_) return;
     assert(engine_ == nullptr);    
+    hostContext_ = context();
 #ifdef FYUSENET_MULTITHREADING
     engine_ = new Engine(context(), async_);
+    if (async_) engine_->setPipelineDepth(asyncCallbacks_.depth_);
 #else
     assertContext();
     engine_ = new Engine(context(), false);
 #endif
+    engine_->setCommandReplay(replay_);
     engine_->setup(this);
     setup_ = true;
 #ifdef FYUSENET_MULTITHREADING
@@ -227,10 +240,155 @@ void NeuralNetwork::asynchronous(const AsyncAdapter & adapter) {
 #endif
 
 
+/**
+ * @brief Change the input resolution of the network
+ *
+ * @param width New input width (pixels)
+ * @param height New input height (pixels)
+ *
+ * @pre Network has been set up and GL context that is associated to this network must be current
+ *      to the calling thread in case of non-multithreaded / synchronous operation.
+ *
+ * @throws FynException if the network implementation does not support resizing. Exceptions that
+ *         occur while building the layers for the new resolution are passed on, in which case
+ *         the network stays at its previous resolution
+ *
+ * This function switches the network to a different input resolution without performing a full
+ * rebuild. Pending operations are flushed and the layers and intermediate buffers of the current
+ * resolution are parked in a small LRU cache (see setResolutionCacheSize()). If the requested
+ * resolution is found in that cache, its layers are re-activated without any further setup.
+ * Otherwise the layers are rebuilt for the new resolution, which only allocates new intermediate
+ * textures and %FBOs:
+ *   - Weight textures are shared with the layers of the other resolutions by means of a
+ *     gpu::WeightStore (see sharedWeights()), so they are neither re-packed nor uploaded again
+ *   - Shader programs are re-used from the ShaderCache
+ *
+ * Sequence numbers continue across resolution changes.
+ *
+ * @warning This function is not re-entrant and must be used from the same thread as forward().
+ *          Data that is tied to the resolution (e.g. input buffers or textures) has to be set
+ *          again after resizing.
+ */
+void NeuralNetwork::resize(int width, int height) {
+    if (!setup_) THROW_EXCEPTION_ARGS(FynException, "Network must be set up before resizing");
+    if ((width <= 0) || (height <= 0)) THROW_EXCEPTION_ARGS(FynException, "Illegal resolution %dx%d", width, height);
+    std::pair<int,int> current = inputResolution();
+    if ((current.first <= 0) || (current.second <= 0)) {
+        THROW_EXCEPTION_ARGS(FynException, "Network does not support dynamic input resolution");
+    }
+    if ((current.first == width) && (current.second == height)) return;
+    finish();
+    uint64_t nextseq = engine_->nextSequenceNo();
+    parked_.push_front(ParkedResolution{current.first, current.second, engine_, bufferMgr_, context()});
+    engine_ = nullptr;
+    bufferMgr_ = nullptr;
+    setup_ = false;
+    try {
+        setInputResolution(width, height);
+        auto it = std::find_if(parked_.begin(), parked_.end(), [width, height](const ParkedResolution& entry) {
+            return (entry.width == width) && (entry.height == height);
+        });
+        if (it != parked_.end()) {
+            engine_ = it->engine;
+            engine_->setCommandReplay(replay_);
+            bufferMgr_ = it->buffers;
+            setContext(it->context);
+            parked_.erase(it);
+            setup_ = true;
+        } else {
+            setContext(hostContext_);
+            setup();
+        }
+    } catch (...) {
+        // ------------------------------------------------------
+        // Discard whatever was built for the new resolution and
+        // re-activate the previous one, such that the network
+        // stays usable
+        // ------------------------------------------------------
+        if (engine_) engine_->cleanup(nullptr);
+        delete engine_;
+        if (bufferMgr_) bufferMgr_->cleanup();
+        delete bufferMgr_;
+        ParkedResolution previous = parked_.front();
+        parked_.pop_front();
+        setInputResolution(previous.width, previous.height);
+        releaseResolution(width, height);
+        engine_ = previous.engine;
+        bufferMgr_ = previous.buffers;
+        setContext(previous.context);
+        setup_ = true;
+        engine_->continueSequence(nextseq);
+        throw;
+    }
+    engine_->continueSequence(nextseq);
+    releaseParked(resolutionCacheSize_);
+}
+
+
 /*##################################################################################################
 #                               N O N -  P U B L I C  F U N C T I O N S                            #
 ##################################################################################################*/
 
+/**
+ * @brief Set input resolution of the network implementation
+ *
+ * @param width New input width (pixels)
+ * @param height New input height (pixels)
+ *
+ * This function is invoked by resize() after the layers of the previous resolution were
+ * parked and before the layers for the new resolution are built (or re-activated). Network
+ * implementations that support dynamic input resolutions must override this function and
+ * update all their resolution-dependent parameters, such that a subsequent call to buildLayers()
+ * generates layers for the new resolution.
+ *
+ * The default implementation throws an exception.
+ *
+ * @see resize(), inputResolution()
+ */
+void NeuralNetwork::setInputResolution(int width, int height) {
+    THROW_EXCEPTION_ARGS(FynException, "Network does not support dynamic input resolution");
+}
+
+
+/**
+ * @brief Release layers and buffers of parked (inactive) input resolutions
+ *
+ * @param keep Number of most recently used resolutions to keep
+ *
+ * @see resize()
+ */
+void NeuralNetwork::releaseParked(int keep) {
+    while ((int)parked_.size() > keep) {
+        ParkedResolution entry = parked_.back();
+        parked_.pop_back();
+        BufferManager * buffers = entry.buffers;
+        entry.engine->cleanup([buffers]() {
+            if (buffers) buffers->cleanup();
+            delete buffers;
+        });
+        delete entry.engine;
+        releaseResolution(entry.width, entry.height);
+    }
+}
+
+
+#ifdef FYUSENET_GL_BACKEND
+/**
+ * @brief Retrieve weight store that is shared by all resolutions of this network
+ *
+ * @return Pointer to weight store owned by this network
+ *
+ * Network implementations that support resize() should attach this store to their parameter
+ * provider (see ParameterProvider::setWeightStore()) in initializeWeights(), such that the layers
+ * for different input resolutions share their weight textures.
+ */
+gpu::WeightStore * NeuralNetwork::sharedWeights() {
+    if (!weightStore_) weightStore_ = new gpu::WeightStore();
+    return weightStore_;
+}
+#endif
+
+
 /**
  * @brief Instantiate layers and initialize GL resources
  *
@@ -12,6 +12,8 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <list>
+#include <utility>
 
 //-------------------------------------- Project  Headers ------------------------------------------
 
@@ -28,6 +30,7 @@ namespace fyusion::fyusenet {
 
 namespace gpu {
     class GPULayerBase;
+    class WeightStore;
 }
 
 namespace cpu {
@@ -91,7 +94,8 @@ class NeuralNetwork : public GfxContextTracker {
      */
     class AsyncAdapter {
      public:
-        AsyncAdapter() = default;
+        AsyncAdapter() : depth_(2) {
+        }
         /**
          * @brief Set callback function to be invoked when a new sequence number has been issued
          *
@@ -168,10 +172,30 @@ class NeuralNetwork : public GfxContextTracker {
             return *this;
         }
 
+        /**
+         * @brief Set the number of runs that may be in flight at the same time
+         *
+         * @param depth Pipeline depth (at least 1, default is 2)
+         *
+         * @return Reference to self (current object)
+         *
+         * Throughput-oriented workloads (e.g. video streams) benefit from having more than one run
+         * in flight, such that uploads of new data and downloads of previous results overlap
+         * with the computation. The forward() call will block once \p depth runs are in flight,
+         * which provides back-pressure to the caller. Networks should build their asynchronous
+         * upload layers with a matching depth, see pipelineDepth() and UpDownLayerBuilder::async().
+         */
+        AsyncAdapter & pipelineDepth(int depth) {
+            if (depth < 1) THROW_EXCEPTION_ARGS(FynException, "Illegal pipeline depth %d", depth);
+            depth_ = depth;
+            return *this;
+        }
+
         std::function<void(uint64_t)> newSeq_;
         std::function<void(uint64_t)> seqDone_;
         std::function<void(const std::string&, uint64_t, cpu::CPUBuffer *)> downReady_;
         std::function<void(const std::string&, uint64_t)> upReady_;
+        int depth_;
     };
 #endif
 
@@ -192,6 +216,42 @@ class NeuralNetwork : public GfxContextTracker {
 #ifdef FYUSENET_MULTITHREADING
     virtual void asynchronous(const AsyncAdapter & adapter = AsyncAdapter());
 #endif
+    void resize(int width, int height);
+
+    /**
+     * @brief Set number of previously used input resolutions to keep
+     *
+     * @param entries Maximum number of inactive resolutions that are kept (in addition to the
+     *                active one)
+     *
+     * When resizing the network, the layers and buffers of the previous resolution are kept in
+     * a small LRU cache, such that switching back to that resolution is instantaneous. Each cached
+     * resolution keeps its own set of intermediate textures (and, for asynchronous operation, its
+     * own engine thread). Set to 0 to release the previous resolution on every resize.
+     *
+     * @see resize()
+     */
+    void setResolutionCacheSize(int entries) {
+        resolutionCacheSize_ = (entries > 0) ? entries : 0;
+    }
+
+    /**
+     * @brief Enable or disable replay of recorded GL command streams
+     *
+     * @param enable If \c true, the GL commands issued by the GPU layers are recorded in the
+     *               first run and replayed in subsequent runs instead of running the layer code
+     *
+     * This reduces the CPU overhead of issuing the GL commands for each inference run, which is
+     * significant for networks with many small layers. Replay is disabled by default, see
+     * Engine::setCommandReplay() for details. Calling this function discards all recordings,
+     * which must be done after changing parameters of layers between runs.
+     *
+     * @warning This function is not thread-safe, do not call it in parallel to forward()
+     */
+    void setCommandReplay(bool enable) {
+        replay_ = enable;
+        if (engine_) engine_->setCommandReplay(enable);
+    }
 
     /**
      * @brief Obtain sequence number that will be issued with the next call to forward()
@@ -216,6 +276,23 @@ class NeuralNetwork : public GfxContextTracker {
         return (engine_) ? engine_->lastSequenceNo() : 0;
     }
 
+    /**
+     * @brief Obtain number of runs that may be in flight at the same time
+     *
+     * @return Pipeline depth for asynchronous operation, 1 for synchronous operation
+     *
+     * Derived networks should use this value when building their asynchronous upload layers.
+     *
+     * @see AsyncAdapter::pipelineDepth()
+     */
+    [[nodiscard]] int pipelineDepth() const {
+#ifdef FYUSENET_MULTITHREADING
+        return (async_) ? asyncCallbacks_.depth_ : 1;
+#else
+        return 1;
+#endif
+    }
+
 
  protected:
     // ------------------------------------------------------------------------
@@ -259,6 +336,40 @@ class NeuralNetwork : public GfxContextTracker {
      */
     virtual void connectLayers(CompiledLayers & layers, BufferManager * buffers) = 0;
 
+    /**
+     * @brief Retrieve the current input resolution of the network
+     *
+     * @return Pair of width and height (in pixels) or (0,0) if the network does not support
+     *         resizing
+     *
+     * Networks that support dynamic input resolutions must override this function as well as
+     * setInputResolution().
+     *
+     * @see resize()
+     */
+    [[nodiscard]] virtual std::pair<int,int> inputResolution() const {
+        return {0, 0};
+    }
+
+    virtual void setInputResolution(int width, int height);
+
+    /**
+     * @brief Release resolution-specific resources of a network implementation
+     *
+     * @param width Width of the resolution that was removed from the resolution cache
+     * @param height Height of the resolution that was removed from the resolution cache
+     *
+     * This function is invoked after the layers of a resolution that was evicted from the
+     * resolution cache have been cleaned up. Network implementations may override this function
+     * to release additional data (e.g. CPU buffers) that they keep for that resolution.
+     */
+    virtual void releaseResolution(int width, int height) {
+    }
+    void releaseParked(int keep = 0);
+#ifdef FYUSENET_GL_BACKEND
+    gpu::WeightStore * sharedWeights();
+#endif
+
 #ifdef FYUSENET_GL_BACKEND
     static fyusion::opengl::FBO * getFBO(const gpu::GPULayerBase * layer, int index=0);
 #endif
@@ -273,6 +384,25 @@ class NeuralNetwork : public GfxContextTracker {
     Engine * engine_ = nullptr;                       //!< Pointer to execution engine
     BufferManager * bufferMgr_ = nullptr;             //!< Texture/buffer manager TODO (mw) move buffermanager out of the network
     bool setup_ = false;                              //!< Indicator if network was set up
+    bool replay_ = false;                             //!< Indicator if GL command replay shall be used, see setCommandReplay()
+
+    /**
+     * @brief Layers and buffers of an inactive input resolution
+     */
+    struct ParkedResolution {
+        int width = 0;                  //!< Input width of the network for this entry
+        int height = 0;                 //!< Input height of the network for this entry
+        Engine * engine = nullptr;      //!< Engine that holds the layers for this resolution
+        BufferManager * buffers = nullptr;  //!< Buffer manager that holds the intermediate buffers for this resolution
+        GfxContextLink context;         //!< Context of the network when running with this engine
+    };
+
+    std::list<ParkedResolution> parked_;                //!< Previously used input resolutions, most recent first
+    int resolutionCacheSize_ = 2;                       //!< Maximum number of entries in #parked_
+    GfxContextLink hostContext_;                        //!< Context that was used to set up the network
+#ifdef FYUSENET_GL_BACKEND
+    gpu::WeightStore * weightStore_ = nullptr;          //!< Weight textures shared between resolutions, see sharedWeights()
+#endif
 };
 
 
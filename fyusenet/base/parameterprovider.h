@@ -26,6 +26,11 @@
 
 namespace fyusion::fyusenet {
 
+namespace gpu {
+    class WeightCache;
+    class WeightStore;
+}
+
 /**
  * @brief Wrapper class that keeps track of reference counts for data blobs (base)
  *
@@ -258,6 +263,69 @@ class ParameterProvider {
     [[nodiscard]] virtual param_type dataType(const std::string& name, int layerNo, int subIndex) const {
         return param_type::WGT_DEFAULT;
     }
+
+    // ------------------------------------------------------------------------
+    // Packed weight cache
+    // ------------------------------------------------------------------------
+    /**
+     * @brief Attach a cache for pre-packed parameter textures
+     *
+     * @param cache Pointer to cache instance, may be \c nullptr to disable caching
+     *
+     * Layers that reshuffle their parameters into textures will query the cache with a key that
+     * is derived from the layer configuration and the raw weight data, and upload the cached
+     * payload directly on a hit. On a miss, the packed payload is stored in the cache.
+     *
+     * @note This class does \b not take ownership over the cache
+     *
+     * @see gpu::WeightCache
+     */
+    void setWeightCache(gpu::WeightCache * cache) {
+        weightCache_ = cache;
+    }
+
+    /**
+     * @brief Retrieve cache for pre-packed parameter textures
+     *
+     * @return Pointer to weight cache or \c nullptr if no cache was attached
+     */
+    [[nodiscard]] gpu::WeightCache * weightCache() const {
+        return weightCache_;
+    }
+
+    // ------------------------------------------------------------------------
+    // Shared weight store
+    // ------------------------------------------------------------------------
+    /**
+     * @brief Attach a store for sharing weight textures between network instances
+     *
+     * @param store Pointer to store instance, may be \c nullptr to disable sharing
+     *
+     * Layers that store their parameters in textures will look up their weights in the store and
+     * bind the existing texture instead of uploading a copy. Attaching the same store to the
+     * providers of multiple networks (in the same GL share group) lets these networks use a single
+     * copy of their weights on the GPU.
+     *
+     * @note This class does \b not take ownership over the store
+     *
+     * @see gpu::WeightStore
+     */
+    void setWeightStore(gpu::WeightStore * store) {
+        weightStore_ = store;
+    }
+
+    /**
+     * @brief Retrieve store for shared weight textures
+     *
+     * @return Pointer to weight store or \c nullptr if no store was attached
+     */
+    [[nodiscard]] gpu::WeightStore * weightStore() const {
+        return weightStore_;
+    }
+
+ protected:
+    gpu::WeightCache * weightCache_ = nullptr;          //!< Optional cache for pre-packed parameter textures (not owned)
+    gpu::WeightStore * weightStore_ = nullptr;          //!< Optional store for weight textures shared between networks (not owned)
 };
 
 
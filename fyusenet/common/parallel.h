@@ -0,0 +1,68 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Simple Parallel Loop Helper (Header)
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <cstddef>
+#include <algorithm>
+#ifdef FYUSENET_MULTITHREADING
+#include <thread>
+#include <vector>
+#endif
+
+//------------------------------------- Public Declarations ----------------------------------------
+
+namespace fyusion::fyusenet {
+
+/**
+ * @brief Execute a range-based function on (up to) all CPU cores
+ *
+ * @tparam F Function type, must be callable as \c func(size_t start, size_t end)
+ *
+ * @param count Total number of items to process
+ * @param minChunk Minimum number of items per chunk, ranges smaller than this will be processed
+ *                 by the calling thread only
+ * @param func Function to invoke on the half-open item ranges <tt>[start, end)</tt>
+ * @param alignment Alignment (in items) for the chunk boundaries, useful for SIMD processing
+ *
+ * This function splits the item range into chunks of roughly equal size and processes them on
+ * a set of short-lived threads, with the first chunk being processed on the calling thread. The
+ * function returns once all chunks have been processed. In builds without multi-threading
+ * support, the full range is processed by the calling thread.
+ *
+ * @note This is meant for coarse-grained CPU-side data shuffling (e.g. format conversion of
+ *       large tensors), the thread creation overhead makes it unsuitable for small workloads.
+ */
+template<typename F>
+void parallelFor(size_t count, size_t minChunk, const F& func, size_t alignment = 1) {
+#ifdef FYUSENET_MULTITHREADING
+    size_t maxthreads = std::max(1u, std::min(8u, std::thread::hardware_concurrency()));
+    size_t numchunks = std::min(maxthreads, count / std::max((size_t)1, minChunk));
+    if (numchunks > 1) {
+        size_t chunk = (count + numchunks - 1) / numchunks;
+        chunk = ((chunk + alignment - 1) / alignment) * alignment;
+        std::vector<std::thread> workers;
+        for (size_t start = chunk; start < count; start += chunk) {
+            size_t end = std::min(count, start + chunk);
+            workers.emplace_back([&func, start, end]() { func(start, end); });
+        }
+        func(0, std::min(count, chunk));
+        for (auto & worker : workers) worker.join();
+        return;
+    }
+#endif
+    if (count > 0) func(0, count);
+}
+
+} // fyusion::fyusenet namespace
+
+// vim: set expandtab ts=4 sw=4:
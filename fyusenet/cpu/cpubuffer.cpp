@@ -13,13 +13,23 @@
 #include <cassert>
 #include <cstring>
 #include <vector>
+#include <algorithm>
+#if defined(__SSE2__) || defined(_M_X64)
+#define FYN_X86_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#define FYN_ARM_NEON
+#include <arm_neon.h>
+#endif
 
 //-------------------------------------- Project  Headers ------------------------------------------
 
 #include "cpubuffer.h"
 #include "../common/miscdefs.h"
+#include "../common/parallel.h"
 #include "../gl/pbo.h"
 #include "../gpu/deep/deeptiler.h"
+#include "../gpu/floatconversion.h"
 #include "../base/layerbase.h"
 
 namespace fyusion::fyusenet::cpu {
@@ -29,6 +39,135 @@ namespace fyusion::fyusenet::cpu {
 
 //-------------------------------------- Local Definitions -----------------------------------------
 
+namespace {
+
+constexpr int PACKING = LayerBase::PIXEL_PACKING;
+constexpr size_t PARALLEL_ELEMENTS = 1 << 16;       // minimum number of elements per conversion thread
+constexpr int FP16_BLOCK = 256;                     // number of pixels per FP16 conversion block
+
+/**
+ * @brief Split 4-channel interleaved 32-bit data into separate planes using SIMD shuffles
+ *
+ * @param src Pointer to interleaved source data
+ * @param planes Pointers to target planes
+ * @param numPlanes Number of target planes to write (1..4), surplus source channels are skipped
+ * @param pixels Number of pixels to process
+ *
+ * @return Number of pixels that were processed, remaining pixels have to be processed by the
+ *         caller
+ */
+int deinterleave4x32(const void *src, void * const *planes, int numPlanes, int pixels) {
+    const auto * in = (const float *)src;
+    float * out[PACKING] = {nullptr, nullptr, nullptr, nullptr};
+    for (int l=0; l < numPlanes; l++) out[l] = (float *)planes[l];
+    int i = 0;
+#if defined(FYN_X86_SSE)
+    for (; i + 4 <= pixels; i += 4) {
+        __m128 r0 = _mm_loadu_ps(in + i*PACKING);
+        __m128 r1 = _mm_loadu_ps(in + i*PACKING + 4);
+        __m128 r2 = _mm_loadu_ps(in + i*PACKING + 8);
+        __m128 r3 = _mm_loadu_ps(in + i*PACKING + 12);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(out[0] + i, r0);
+        if (numPlanes > 1) _mm_storeu_ps(out[1] + i, r1);
+        if (numPlanes > 2) _mm_storeu_ps(out[2] + i, r2);
+        if (numPlanes > 3) _mm_storeu_ps(out[3] + i, r3);
+    }
+#elif defined(FYN_ARM_NEON)
+    for (; i + 4 <= pixels; i += 4) {
+        float32x4x4_t v = vld4q_f32(in + i*PACKING);
+        for (int l=0; l < numPlanes; l++) vst1q_f32(out[l] + i, v.val[l]);
+    }
+#endif
+    return i;
+}
+
+
+/**
+ * @brief Interleave (up to) 4 planes of 32-bit data into 4-channel pixels using SIMD shuffles
+ *
+ * @param planes Pointers to source planes
+ * @param numPlanes Number of source planes (1..4), missing channels are set to zero
+ * @param dest Pointer to interleaved target data
+ * @param pixels Number of pixels to process
+ *
+ * @return Number of pixels that were processed, remaining pixels have to be processed by the
+ *         caller
+ */
+int interleave4x32(const void * const *planes, int numPlanes, void *dest, int pixels) {
+    const float * in[PACKING] = {nullptr, nullptr, nullptr, nullptr};
+    for (int l=0; l < numPlanes; l++) in[l] = (const float *)planes[l];
+    auto * out = (float *)dest;
+    int i = 0;
+#if defined(FYN_X86_SSE)
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= pixels; i += 4) {
+        __m128 r0 = _mm_loadu_ps(in[0] + i);
+        __m128 r1 = (numPlanes > 1) ? _mm_loadu_ps(in[1] + i) : zero;
+        __m128 r2 = (numPlanes > 2) ? _mm_loadu_ps(in[2] + i) : zero;
+        __m128 r3 = (numPlanes > 3) ? _mm_loadu_ps(in[3] + i) : zero;
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(out + i*PACKING, r0);
+        _mm_storeu_ps(out + i*PACKING + 4, r1);
+        _mm_storeu_ps(out + i*PACKING + 8, r2);
+        _mm_storeu_ps(out + i*PACKING + 12, r3);
+    }
+#elif defined(FYN_ARM_NEON)
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    for (; i + 4 <= pixels; i += 4) {
+        float32x4x4_t v;
+        for (int l=0; l < PACKING; l++) v.val[l] = (l < numPlanes) ? vld1q_f32(in[l] + i) : zero;
+        vst4q_f32(out + i*PACKING, v);
+    }
+#endif
+    return i;
+}
+
+
+/**
+ * @brief Split interleaved data into separate planes
+ *
+ * @param src Pointer to interleaved source data
+ * @param packing Number of interleaved channels per pixel in \p src
+ * @param planes Pointers to target planes
+ * @param numPlanes Number of planes to write, must not exceed \p packing
+ * @param pixels Number of pixels to process
+ */
+template<typename T>
+void deinterleave(const T *src, int packing, T * const *planes, int numPlanes, int pixels) {
+    int i = 0;
+    if constexpr (sizeof(T) == sizeof(float)) {
+        if (packing == PACKING) i = deinterleave4x32(src, (void * const *)planes, numPlanes, pixels);
+    }
+    for (; i < pixels; i++) {
+        for (int l=0; l < numPlanes; l++) planes[l][i] = src[i*packing + l];
+    }
+}
+
+
+/**
+ * @brief Interleave separate planes into pixels
+ *
+ * @param planes Pointers to source planes
+ * @param numPlanes Number of source planes, must not exceed \p packing
+ * @param dest Pointer to interleaved target data
+ * @param packing Number of interleaved channels per pixel in \p dest, surplus channels are
+ *                set to zero
+ * @param pixels Number of pixels to process
+ */
+template<typename T>
+void interleave(const T * const *planes, int numPlanes, T *dest, int packing, int pixels) {
+    int i = 0;
+    if constexpr (sizeof(T) == sizeof(float)) {
+        if (packing == PACKING) i = interleave4x32((const void * const *)planes, numPlanes, dest, pixels);
+    }
+    for (; i < pixels; i++) {
+        for (int l=0; l < packing; l++) dest[i*packing + l] = (l < numPlanes) ? planes[l][i] : T(0);
+    }
+}
+
+} // anonymous namespace
+
 
 /*##################################################################################################
 #                                   P U B L I C  F U N C T I O N S                                 #
@@ -133,17 +272,34 @@ CPUBuffer * CPUBuffer::toChannelWise(CPUBuffer *tgt) const {
         unmap();
         tgt->unmap();
         return tgt;
-    } else if (shape_.dataOrder_ == BufferShape::order::GPU_DEEP) {
-        const float * srcdata = map<float>();
-        float * tgtdata = tgt->map<float>();
-        deepToChannelWise<float>(srcdata, tgtdata);
-        unmap();
-        tgt->unmap();
-        return tgt;
-    } else if (shape_.dataOrder_ == BufferShape::order::GPU_SHALLOW) {
-        const float * srcdata = map<float>();
-        float * tgtdata = tgt->map<float>();
-        shallowToChannelWise<float>(srcdata, tgtdata);
+    } else if ((shape_.dataOrder_ == BufferShape::order::GPU_DEEP) ||
+               (shape_.dataOrder_ == BufferShape::order::GPU_SHALLOW)) {
+        bool deep = (shape_.dataOrder_ == BufferShape::order::GPU_DEEP);
+        const void * srcdata = map<uint8_t>();
+        void * tgtdata = tgt->map<uint8_t>();
+        assert(srcdata);
+        assert(tgtdata);
+        // NOTE (mw) we only move data around here, so we can dispatch by element size
+        switch (BufferShape::typeSize(shape_.dataType_)) {
+            case 4:
+                if (deep) deepToChannelWise<float>((const float *)srcdata, (float *)tgtdata);
+                else shallowToChannelWise<float>((const float *)srcdata, (float *)tgtdata);
+                break;
+#ifndef FYUSENET_CPU_FLOAT_ONLY
+            case 2:
+                if (deep) deepToChannelWise<uint16_t>((const uint16_t *)srcdata, (uint16_t *)tgtdata);
+                else shallowToChannelWise<uint16_t>((const uint16_t *)srcdata, (uint16_t *)tgtdata);
+                break;
+            case 1:
+                if (deep) deepToChannelWise<uint8_t>((const uint8_t *)srcdata, (uint8_t *)tgtdata);
+                else shallowToChannelWise<uint8_t>((const uint8_t *)srcdata, (uint8_t *)tgtdata);
+                break;
+#endif
+            default:
+                unmap();
+                tgt->unmap();
+                THROW_EXCEPTION_ARGS(FynException, "Unsupported data type for conversion");
+        }
         unmap();
         tgt->unmap();
         return tgt;
@@ -160,18 +316,21 @@ CPUBuffer * CPUBuffer::toChannelWise(CPUBuffer *tgt) const {
  *
  * @return Target buffer with GPU shallow data representation storage order
  *
+ * Supports GPU shallow-tensor and channel-wise source buffers.
  *
- * @warning This implementation is incomplete, in its current state it can only copy GPU
- *          shallow-tensor ordered CPU buffers
+ * @throws FynException if the target buffer is not compatible or the conversion is not supported
  */
 CPUBuffer * CPUBuffer::toGPUShallow(CPUBuffer *tgt) const {
-    if (shape_.dataOrder_ != BufferShape::order::GPU_SHALLOW) {
+    if ((shape_.dataOrder_ != BufferShape::order::GPU_SHALLOW) &&
+        (shape_.dataOrder_ != BufferShape::order::CHANNELWISE)) {
         // TODO (mw) implement missing conversions
         THROW_EXCEPTION_ARGS(FynException,"Not supported yet");
     }
     if (!tgt) tgt = shape_.createCPUBuffer(BufferShape::order::GPU_SHALLOW);
     else {
-        if (!tgt->shape().sameOrder(shape_)) {
+        auto shape = shape_.asOrder(BufferShape::order::GPU_SHALLOW);
+        if ((tgt->shape_.dataOrder() != BufferShape::order::GPU_SHALLOW) ||
+            !tgt->shape_.sameSize(shape) || !tgt->shape_.sameType(shape)) {
             THROW_EXCEPTION_ARGS(FynException,"Data order of target buffer is not compatible");
         }
     }
@@ -179,7 +338,8 @@ CPUBuffer * CPUBuffer::toGPUShallow(CPUBuffer *tgt) const {
     auto * tgtdata = tgt->map<uint8_t>();
     assert(srcdata);
     assert(tgtdata);
-    memcpy(tgtdata, srcdata, bytes());
+    if (shape_.dataOrder_ == BufferShape::order::GPU_SHALLOW) memcpy(tgtdata, srcdata, bytes());
+    else channelWiseToGPU(srcdata, tgt, tgtdata);
     unmap();
     tgt->unmap();
     return tgt;
@@ -194,30 +354,132 @@ CPUBuffer * CPUBuffer::toGPUShallow(CPUBuffer *tgt) const {
  *
  * @return Target buffer with GPU deep-tensor data storage order
  *
- * @warning This implementation is incomplete, in its current state it can only copy GPU deep-tensor
- *          ordered CPU buffers
+ * Supports GPU deep-tensor and channel-wise source buffers. The spatial padding between the
+ * tiles of the target buffer is set to zero for channel-wise sources.
+ *
+ * @throws FynException if the target buffer is not compatible or the conversion is not supported
  */
 CPUBuffer * CPUBuffer::toGPUDeep(CPUBuffer *tgt) const {
+    if ((shape_.dataOrder_ != BufferShape::order::GPU_DEEP) &&
+        (shape_.dataOrder_ != BufferShape::order::CHANNELWISE)) {
+        // TODO (mw) implement missing conversions
+        THROW_EXCEPTION_ARGS(FynException,"Not supported yet");
+    }
     if (!tgt) tgt = shape_.createCPUBuffer(BufferShape::order::GPU_DEEP);
     else {
-        // TODO (mw) complete the implementation here
-        THROW_EXCEPTION_ARGS(FynException, "Incomplete implementation");
+        auto shape = shape_.asOrder(BufferShape::order::GPU_DEEP);
+        if ((tgt->shape_.dataOrder() != BufferShape::order::GPU_DEEP) ||
+            !tgt->shape_.sameSize(shape) || !tgt->shape_.sameType(shape)) {
+            THROW_EXCEPTION_ARGS(FynException,"Data order of target buffer is not compatible");
+        }
     }
-    if (shape_.dataOrder_ == BufferShape::order::GPU_DEEP) {
-        const auto * srcdata = map<uint8_t>();
-        auto * tgtdata = tgt->map<uint8_t>();
-        assert(srcdata);
-        assert(tgtdata);
-        memcpy(tgtdata, srcdata, bytes());
-        unmap();
-        tgt->unmap();
-        return tgt;
-    } else {
-        THROW_EXCEPTION_ARGS(FynException,"Not supported yet");
+    const auto * srcdata = map<uint8_t>();
+    auto * tgtdata = tgt->map<uint8_t>();
+    assert(srcdata);
+    assert(tgtdata);
+    if (shape_.dataOrder_ == BufferShape::order::GPU_DEEP) memcpy(tgtdata, srcdata, bytes());
+    else channelWiseToGPU(srcdata, tgt, tgtdata);
+    unmap();
+    tgt->unmap();
+    return tgt;
+}
+
+
+/**
+ * @brief Convert floating-point buffer to channel-wise FP16 data
+ *
+ * @param[out] tgt Pointer to target memory which must be able to hold
+ *                 <tt>shape().bytes(BufferShape::order::CHANNELWISE) / 2</tt> bytes
+ *
+ * This performs the data re-ordering and the conversion to half-precision in a single pass over
+ * the data, which is useful for exporting large network outputs in a compact format.
+ *
+ * @throws FynException if this buffer does not store 32-bit floating-point data or uses an
+ *         unsupported data order
+ */
+void CPUBuffer::toChannelWiseFP16(uint16_t *tgt) const {
+    using gpu::FloatConversion;
+    if ((shape_.dataType_ != BufferShape::type::FLOAT32) && (shape_.dataType_ != BufferShape::type::FLOAT16)) {
+        THROW_EXCEPTION_ARGS(FynException, "FP16 conversion requires floating-point buffer");
     }
+    const FloatConversion * conv = FloatConversion::getInstance();
+    const float * src = map<float>();
+    assert(src);
+    switch (shape_.dataOrder_) {
+        case BufferShape::order::CHANNELWISE:
+            conv->toFP16(src, tgt, bytes() / sizeof(float));
+            break;
+        case BufferShape::order::GPU_SHALLOW:
+            // intentional fallthrough
+        case BufferShape::order::GPU_DEEP:
+            forEachGPURow(shape_.dataOrder_, false, 0, [src, tgt, conv](const GPURow& row) {
+                float scratch[PACKING][FP16_BLOCK];
+                float * planes[PACKING] = {scratch[0], scratch[1], scratch[2], scratch[3]};
+                for (int x=0; x < row.pixels; x += FP16_BLOCK) {
+                    int num = std::min(FP16_BLOCK, row.pixels - x);
+                    deinterleave(src + row.offset + (size_t)x * row.packing, row.packing, planes, row.planes, num);
+                    for (int l=0; l < row.planes; l++) {
+                        conv->toFP16(scratch[l], tgt + row.planeOffset + l * row.planeStride + x, num);
+                    }
+                }
+            });
+            break;
+        default:
+            unmap();
+            THROW_EXCEPTION_ARGS(FynException, "Unsupported data order");
+    }
+    unmap();
 }
 
 
+/**
+ * @brief Fill floating-point buffer from channel-wise FP16 data
+ *
+ * @param src Pointer to FP16 data in channel-wise order, must have the same (padded) size as
+ *            this buffer in channel-wise order
+ *
+ * This performs the conversion to single-precision and the data re-ordering to the storage
+ * order of this buffer in a single pass over the data. For GPU-ordered buffers, the spatial
+ * padding is set to zero.
+ *
+ * @throws FynException if this buffer does not store 32-bit floating-point data or uses an
+ *         unsupported data order
+ */
+void CPUBuffer::fromChannelWiseFP16(const uint16_t *src) {
+    using gpu::FloatConversion;
+    if ((shape_.dataType_ != BufferShape::type::FLOAT32) && (shape_.dataType_ != BufferShape::type::FLOAT16)) {
+        THROW_EXCEPTION_ARGS(FynException, "FP16 conversion requires floating-point buffer");
+    }
+    const FloatConversion * conv = FloatConversion::getInstance();
+    float * tgt = map<float>();
+    assert(tgt);
+    switch (shape_.dataOrder_) {
+        case BufferShape::order::CHANNELWISE:
+            conv->toFP32(src, tgt, bytes() / sizeof(float));
+            break;
+        case BufferShape::order::GPU_SHALLOW:
+            // intentional fallthrough
+        case BufferShape::order::GPU_DEEP:
+            memset(tgt, 0, bytes());
+            forEachGPURow(shape_.dataOrder_, true, 0, [src, tgt, conv](const GPURow& row) {
+                float scratch[PACKING][FP16_BLOCK];
+                const float * planes[PACKING] = {scratch[0], scratch[1], scratch[2], scratch[3]};
+                for (int x=0; x < row.pixels; x += FP16_BLOCK) {
+                    int num = std::min(FP16_BLOCK, row.pixels - x);
+                    for (int l=0; l < row.planes; l++) {
+                        conv->toFP32(src + row.planeOffset + l * row.planeStride + x, scratch[l], num);
+                    }
+                    interleave(planes, row.planes, tgt + row.offset + (size_t)x * row.packing, row.packing, num);
+                }
+            });
+            break;
+        default:
+            unmap();
+            THROW_EXCEPTION_ARGS(FynException, "Unsupported data order");
+    }
+    unmap();
+}
+
 
 /**
  * @brief Dump the contents of this CPUBuffer to a file
@@ -317,7 +579,9 @@ void CPUBuffer::write(const char *fileName) const {
  *                   of the content currently in the %PBO)
  *
  * @param bytes (Optional) number of bytes to read from the PBO, if supplied with zero, it will
- *              read the full PBO contents
+ *              read the full PBO contents (starting at \p pboOffset)
+ *
+ * @param pboOffset (Optional) offset (in bytes) within the PBO to start reading from
  *
  * @retval true if read operation was successful
  * @retval false otherwise
@@ -326,7 +590,7 @@ void CPUBuffer::write(const char *fileName) const {
  *
  * @warning This function currently only supports \c FLOAT32 data types
  */
-bool CPUBuffer::readFromPBO(opengl::PBO * pbo, BufferShape::type type, uint64_t sequenceNo, size_t bytes) {
+bool CPUBuffer::readFromPBO(opengl::PBO * pbo, BufferShape::type type, uint64_t sequenceNo, size_t bytes, size_t pboOffset) {
     if (!memory_) return false;
     CLEAR_GFXERR_DEBUG
     pbo->bind(GL_PIXEL_PACK_BUFFER);
@@ -348,14 +612,14 @@ bool CPUBuffer::readFromPBO(opengl::PBO * pbo, BufferShape::type type, uint64_t
         return false;
     }
 #endif
-    size_t sz = (bytes == 0) ? pbo->capacity() : bytes;
-    if (sz > cap) {
+    size_t sz = (bytes == 0) ? pbo->capacity() - pboOffset : bytes;
+    if ((sz > cap) || (pboOffset + sz > pbo->capacity())) {
         pbo->unmapReadBuffer();
         pbo->unbind(GL_PIXEL_PACK_BUFFER);
         unmap();
         THROW_EXCEPTION_ARGS(FynException,"Refusing to read from PBO as this would exceed buffer size");
     }
-    memcpy(tgt, src, sz);
+    memcpy(tgt, (const uint8_t *)src + pboOffset, sz);
     unmap();
     pbo->unmapReadBuffer();
     pbo->unbind();
@@ -372,37 +636,16 @@ bool CPUBuffer::readFromPBO(opengl::PBO * pbo, BufferShape::type type, uint64_t
  * @param tgt Pointer to target (raw) buffer
  *
  * This function reformats the supplied \p src buffer from GPU deep-tensor format into a plain
- * channel-wise format, that represents the tensor as simple 3D array.
+ * channel-wise format, that represents the tensor as simple 3D array. The rows are processed in
+ * parallel, 32-bit data is de-interleaved using SIMD shuffles where available.
  */
 template<typename T>
 void CPUBuffer::deepToChannelWise(const T *src, T *tgt) const {
-    // NOTE (mw) unoptimized code
-    assert(shape_.padding_ <= 1);
-    if (!tiler_) {
-        tiler_ = new gpu::deep::DeepTiler(LayerType::DOWNLOAD,
-                                          shape_.tileWidth_, shape_.tileHeight_, shape_.channels_, shape_.channels_,
-                                          1.0f, 1.0f, 0, shape_.padding_, 1, 1, 1, 1);
-    }
-    int pad = shape_.padding_;
-    int lwidth = shape_.tileWidth_ + 2 * pad;
-    int lheight = shape_.tileHeight_ + 2 * pad;
-    int channeloffset = 0;
-    int srcstride = shape_.width_ * LayerBase::PIXEL_PACKING;
-    for (int ty=0; ty < tiler_->numOutputTiles(gpu::deep::DeepTiler::VERTICAL); ty++) {
-        for (int tx=0; tx < tiler_->numOutputTiles(gpu::deep::DeepTiler::HORIZONTAL); tx++) {
-            int rem = ((shape_.channels_ - channeloffset) > LayerBase::PIXEL_PACKING) ? LayerBase::PIXEL_PACKING : shape_.channels_ - channeloffset;
-            const T * in = src +  (ty * (shape_.tileHeight_ + pad)) * srcstride + (tx * shape_.tileWidth_ + pad) * LayerBase::PIXEL_PACKING;
-            for (int l=0; l < rem; l++) {
-                T * outptr = tgt + channeloffset * (lwidth * lheight);
-                for (int y=0; y < lheight; y++) {
-                    for (int x=0; x < lwidth; x++) {
-                        outptr[x+y*lwidth] = in[(y*srcstride+x)*LayerBase::PIXEL_PACKING+l];
-                    }
-                }
-                channeloffset++;
-            }
-        }
-    }
+    forEachGPURow(BufferShape::order::GPU_DEEP, false, 0, [src, tgt](const GPURow& row) {
+        T * planes[PACKING];
+        for (int l=0; l < row.planes; l++) planes[l] = tgt + row.planeOffset + l * row.planeStride;
+        deinterleave(src + row.offset, row.packing, planes, row.planes, row.pixels);
+    });
 }
 
 
@@ -412,25 +655,136 @@ void CPUBuffer::deepToChannelWise(const T *src, T *tgt) const {
  *
  * @param src Pointer to source (raw) buffer
  * @param tgt Pointer to target (raw) buffer
- * @param channelOffset First channel in the source to start reformatting
+ * @param channelOffset First channel in the source to start reformatting, must be a multiple
+ *                      of 4. The target buffer receives the channels starting at this offset
  *
  * This function reformats the supplied \p src buffer from GPU shallow-tensor format into a plain
- * channel-wise format, that represents the tensor as simple 3D array.
+ * channel-wise format, that represents the tensor as simple 3D array. The rows are processed in
+ * parallel, 32-bit data is de-interleaved using SIMD shuffles where available.
  */
 template<typename T>
 void CPUBuffer::shallowToChannelWise(const T *src, T *tgt, int channelOffset) const {
-    // NOTE (mw) unoptimized code
-    int lwidth = shape_.width_ + 2*shape_.padding_;
-    int lheight = shape_.height_ + 2*shape_.padding_;
-    int rem = shape_.channels_ - channelOffset;
-    if (rem > LayerBase::PIXEL_PACKING) rem = LayerBase::PIXEL_PACKING;
-    for (int l = 0 ; l < rem; l++) {
-        for (int y=0; y < lheight; y++) {
-            for (int x=0; x < lwidth; x++) {
-                tgt[x+y*lwidth]=src[l+channelOffset+y*lwidth+x];
-            }
+    forEachGPURow(BufferShape::order::GPU_SHALLOW, false, channelOffset, [src, tgt](const GPURow& row) {
+        T * planes[PACKING];
+        for (int l=0; l < row.planes; l++) planes[l] = tgt + row.planeOffset + l * row.planeStride;
+        deinterleave(src + row.offset, row.packing, planes, row.planes, row.pixels);
+    });
+}
+
+
+/**
+ * @brief Reformat channel-wise data to the GPU format of a target buffer
+ *
+ * @param src Pointer to source (raw) data of this buffer in channel-wise format
+ * @param tgt Target buffer, which determines the GPU data order
+ * @param dest Pointer to (mapped) raw data of \p tgt
+ *
+ * The spatial padding in the target is set to zero.
+ */
+void CPUBuffer::channelWiseToGPU(const void *src, CPUBuffer *tgt, void *dest) const {
+    assert(shape_.dataOrder_ == BufferShape::order::CHANNELWISE);
+    memset(dest, 0, tgt->bytes());
+    // NOTE (mw) we only move data around here, so we can dispatch by element size
+    switch (BufferShape::typeSize(shape_.dataType_)) {
+        case 4:
+            interleaveToGPU<float>((const float *)src, tgt, (float *)dest);
+            break;
+        case 2:
+            interleaveToGPU<uint16_t>((const uint16_t *)src, tgt, (uint16_t *)dest);
+            break;
+        case 1:
+            interleaveToGPU<uint8_t>((const uint8_t *)src, tgt, (uint8_t *)dest);
+            break;
+        default:
+            THROW_EXCEPTION_ARGS(FynException, "Unsupported data type for conversion");
+    }
+}
+
+
+/**
+ * @brief Interleave channel-wise data into the (GPU) data order of a target buffer
+ *
+ * @param src Pointer to source (raw) data in channel-wise format
+ * @param tgt Target buffer, which determines the GPU data order
+ * @param dest Pointer to (mapped) raw data of \p tgt
+ *
+ * Only the interior (non-padding) part of the tensor is written.
+ */
+template<typename T>
+void CPUBuffer::interleaveToGPU(const T *src, CPUBuffer *tgt, T *dest) {
+    tgt->forEachGPURow(tgt->shape_.dataOrder_, true, 0, [src, dest](const GPURow& row) {
+        const T * planes[PACKING];
+        for (int l=0; l < row.planes; l++) planes[l] = src + row.planeOffset + l * row.planeStride;
+        interleave(planes, row.planes, dest + row.offset, row.packing, row.pixels);
+    });
+}
+
+
+/**
+ * @brief Invoke function on all rows of a GPU-ordered buffer
+ *
+ * @param gpuOrder GPU data order (shallow or deep) to assume for the buffer data, this is not
+ *                 necessarily the order of this buffer, as the raw data may stem from elsewhere
+ *                 (see BufferShape::cpuFromRawBuffer())
+ * @param interior If \c true, skip the spatial padding of the tensor
+ * @param channelOffset First channel to process, must be a multiple of 4
+ * @param func Function to invoke for each row, receives a GPURow instance that contains the
+ *             offsets into the GPU-ordered buffer and into the corresponding channel-wise buffer
+ *
+ * This unifies the addressing for shallow and deep GPU buffers. For deep buffers, the tile
+ * positions follow the conventions of the gpu::deep::DeepTiler. The rows are distributed over
+ * multiple threads (multi-threaded builds only) and \p func must therefore be safe to be
+ * invoked concurrently on different rows.
+ */
+template<typename F>
+void CPUBuffer::forEachGPURow(BufferShape::order gpuOrder, bool interior, int channelOffset, const F& func) const {
+    assert((channelOffset % PACKING) == 0);
+    const bool deep = (gpuOrder == BufferShape::order::GPU_DEEP);
+    const int pad = shape_.padding_;
+    const int border = (interior) ? pad : 0;
+    int lwidth = shape_.width_, lheight = shape_.height_, htiles = 1;
+    if (deep) {
+        assert(pad <= 1);
+        if (!tiler_) {
+            tiler_ = new gpu::deep::DeepTiler(LayerType::DOWNLOAD,
+                                              shape_.tileWidth_, shape_.tileHeight_, shape_.channels_, shape_.channels_,
+                                              1.0f, 1.0f, 0, shape_.padding_, 1, 1, 1, 1);
         }
+        lwidth = shape_.tileWidth_ + 2 * pad;
+        lheight = shape_.tileHeight_ + 2 * pad;
+        htiles = tiler_->numOutputTiles(gpu::deep::DeepTiler::HORIZONTAL);
+    } else {
+        assert(gpuOrder == BufferShape::order::GPU_SHALLOW);
     }
+    const int firstblock = channelOffset / PACKING;
+    const int blocks = (shape_.channels_ + PACKING - 1) / PACKING - firstblock;
+    const int rows = lheight - 2 * border;
+    const size_t planestride = (size_t)lwidth * (size_t)lheight;
+    if ((blocks <= 0) || (rows <= 0)) return;
+    size_t minrows = std::max((size_t)1, PARALLEL_ELEMENTS / (size_t)(lwidth * PACKING));
+    parallelFor((size_t)blocks * rows, minrows, [&](size_t start, size_t end) {
+        GPURow row{};
+        row.planeStride = planestride;
+        row.pixels = lwidth - 2 * border;
+        for (size_t r = start; r < end; r++) {
+            int block = firstblock + (int)(r / rows);
+            int y = border + (int)(r % rows);
+            int chan = block * PACKING;
+            row.planes = std::min(PACKING, shape_.channels_ - chan);
+            if (deep) {
+                int tx = block % htiles;
+                int ty = block / htiles;
+                row.packing = PACKING;
+                row.offset = ((size_t)(ty * (shape_.tileHeight_ + pad) + y) * shape_.width_ + tx * (shape_.tileWidth_ + pad) + border) * PACKING;
+            } else {
+                // shallow buffers store the channels in consecutive blocks of 4, the last block is padded to 4 channels
+                row.packing = PACKING;
+                row.offset = (size_t)chan * planestride + ((size_t)y * lwidth + border) * PACKING;
+            }
+            row.planeOffset = (size_t)(chan - channelOffset) * planestride + (size_t)y * lwidth + border;
+            func(row);
+        }
+    });
 }
 
 
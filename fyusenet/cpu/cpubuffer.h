@@ -91,6 +91,8 @@ class CPUBuffer {
     CPUBuffer * toChannelWise(CPUBuffer *tgt = nullptr) const;
     CPUBuffer * toGPUShallow(CPUBuffer *tgt = nullptr) const;
     CPUBuffer * toGPUDeep(CPUBuffer *tgt = nullptr) const;
+    void toChannelWiseFP16(uint16_t *tgt) const;
+    void fromChannelWiseFP16(const uint16_t *src);
 
     /**
      * @brief Associate CPU buffer content with a sequence ID
@@ -232,13 +234,35 @@ class CPUBuffer {
     // Non-public methods
     // ------------------------------------------------------------------------
 #ifdef FYUSENET_GL_BACKEND
-    bool readFromPBO(opengl::PBO *pbo, BufferShape::type type, uint64_t sequenceNo, size_t bytes=0);
+    bool readFromPBO(opengl::PBO *pbo, BufferShape::type type, uint64_t sequenceNo, size_t bytes=0, size_t pboOffset=0);
 #endif
     template<typename T>
     void shallowToChannelWise(const T *src, T *tgt, int channelOffset=0) const;
     template<typename T>
     void deepToChannelWise(const T *src, T *tgt) const;
 
+    void channelWiseToGPU(const void *src, CPUBuffer *tgt, void *dest) const;
+
+    template<typename T>
+    static void interleaveToGPU(const T *src, CPUBuffer *tgt, T *dest);
+
+    /**
+     * @brief Single row of (up to) 4 interleaved channels in a GPU-ordered buffer
+     *
+     * @see forEachGPURow()
+     */
+    struct GPURow {
+        size_t offset;          //!< Offset (in elements) of the row in the GPU-ordered buffer
+        size_t planeOffset;     //!< Offset (in elements) of the row in the first channel-wise plane
+        size_t planeStride;     //!< Number of elements per channel-wise plane
+        int packing;            //!< Number of interleaved channels per pixel in the GPU-ordered buffer
+        int planes;             //!< Number of (valid) channels in the row
+        int pixels;             //!< Number of pixels in the row
+    };
+
+    template<typename F>
+    void forEachGPURow(BufferShape::order gpuOrder, bool interior, int channelOffset, const F& func) const;
+
     // ------------------------------------------------------------------------
     // Member variables
     // ------------------------------------------------------------------------
@@ -33,6 +33,7 @@
 #include "base/compiledlayers.h"
 #include "base/neuralnetwork.h"
 #include "base/engine.h"
+#include "base/networkdispatcher.h"
 #include "base/layerflags.h"
 #include "base/layerbuilder.h"
 #include "base/layerbase.h"
@@ -50,6 +51,8 @@
 #include "gpu/uploadlayer.h"
 #include "gpu/downloadlayer.h"
 #include "gpu/deep/deepdownloadlayer.h"
+#include "gpu/weightcache.h"
+#include "gpu/weightstore.h"
 
 #include "gpu/argmaxlayerbuilder.h"
 #include "gpu/blurlayerbuilder.h"
@@ -58,6 +61,9 @@
 #include "gpu/convlayerbuilder.h"
 #include "gpu/customlayerbuilder.h"
 #include "gpu/imgextractlayerbuilder.h"
+#include "gpu/imgpreproclayerbuilder.h"
+#include "gpu/compactlayerbuilder.h"
+#include "gpu/topklayerbuilder.h"
 #include "gpu/scalelayerbuilder.h"
 #include "gpu/singleton_arithlayerbuilder.h"
 #include "gpu/poollayerbuilder.h"
@@ -106,7 +106,8 @@ void GLContext::init() {
  * @copydoc GLContextInterface::makeCurrent()
  */
 bool GLContext::makeCurrent() const {
-    CGLSetCurrentContext(context_);
+    if (CGLSetCurrentContext(context_) != kCGLNoError) return false;
+    stateCache_.attach();
     return true;
 }
 
@@ -116,6 +117,7 @@ bool GLContext::makeCurrent() const {
  */
 bool GLContext::releaseCurrent() const {
     if (isCurrent()) {
+        stateCache_.detach();
         CGLSetCurrentContext(nullptr);
         return true;
     } else return false;
@@ -15,6 +15,8 @@
 #endif
 #include <cstring>
 #include <cassert>
+#include <mutex>
+#include <unordered_map>
 
 //-------------------------------------- Project  Headers ------------------------------------------
 
@@ -47,6 +49,15 @@ namespace fyusion::opengl {
 #endif
 
 static bool initEGLExtensions();
+static void acquireDisplay(EGLDisplay display);
+static void releaseDisplay(EGLDisplay display);
+
+/**
+ * Number of main contexts per EGL display. Several context managers (devices) may end up on the
+ * same display, which must only be terminated once the last main context on it is gone.
+ */
+static std::unordered_map<EGLDisplay, int> displayRefs;
+static std::mutex displayLock;
 
 static const EGLint displayConfig16Bit[] = {
     EGL_RENDERABLE_TYPE, ES3BIT,
@@ -141,7 +152,7 @@ GLContext::~GLContext() {
    context_ = nullptr;
    eglDestroySurface(display_, defaultSurface_);
    if (!derivedFrom_) {
-       eglTerminate(display_);
+       releaseDisplay(display_);
    }
    defaultSurface_ = nullptr;
    display_ = nullptr;
@@ -206,17 +217,25 @@ void GLContext::init() {
     } else {
         // ------------------------------------------------------------------
         // Iterate through EGL backends, assuming that the "fastest" ones
-        // are first in the list...
+        // are first in the list. The requested device is tried first, the
+        // remaining devices serve as fallback. Device indices beyond the
+        // number of available devices are wrapped around, such that several
+        // context managers can share a single GPU (or software renderer)
         // ------------------------------------------------------------------
         eglQueryDevicesEXT(MAX_DEVICES, eglDevices, &numdevs);
+        int target = (numdevs > 0) ? device() % numdevs : 0;
+        if ((numdevs > 0) && (target != device())) {
+            FNLOGI("Device %d not available (%d EGL devices), using device %d", device(), numdevs, target);
+        }
         for (EGLint i = 0; i < numdevs ; i++) {
-            display = eglGetPlatformDisplayEXT(EGL_PLATFORM_DEVICE_EXT, eglDevices[i], 0);
+            EGLint dev = (target + i) % numdevs;
+            display = eglGetPlatformDisplayEXT(EGL_PLATFORM_DEVICE_EXT, eglDevices[dev], 0);
             if (display != EGL_NO_DISPLAY) {
-                if (const char *vendor = eglQueryDeviceStringEXT(eglDevices[i], EGL_VENDOR); vendor) {
+                if (const char *vendor = eglQueryDeviceStringEXT(eglDevices[dev], EGL_VENDOR); vendor) {
                     // TODO (mw) filter by vendor
                 }
 #ifdef EGL_RENDERER_EXT
-                if (const char *render = eglQueryDeviceStringEXT(eglDevices[i], EGL_RENDERER_EXT); render) {
+                if (const char *render = eglQueryDeviceStringEXT(eglDevices[dev], EGL_RENDERER_EXT); render) {
                     // TODO (mw) filter by renderer
                 }
 #endif
@@ -225,6 +244,7 @@ void GLContext::init() {
                 // success
                 // --------------------------------------------------------------
                 if (eglInitialize(display, &major, &minor)) {
+                    if (dev != target) FNLOGW("Cannot use EGL device %d, falling back to device %d", target, dev);
                     display_ = display;
                     break;
                 }
@@ -234,6 +254,7 @@ void GLContext::init() {
     if (display_ == EGL_NO_DISPLAY) {
         THROW_EXCEPTION_ARGS(GLException, "Unable to open any EGL display");
     }
+    acquireDisplay(display_);
     bool success = false;
     for (int i=0; i < 3; i++) {
         EGLBoolean rc = eglChooseConfig(display_, EGLConfigs[i], &activeConfig_, 1, &configs);
@@ -284,6 +305,7 @@ bool GLContext::makeCurrent() const {
             return false;
         }
         assert(eglGetCurrentContext() == context_);
+        stateCache_.attach();
         return true;
     }
 }
@@ -294,6 +316,7 @@ bool GLContext::makeCurrent() const {
  */
 bool GLContext::releaseCurrent() const {
     if (isCurrent()) {
+        stateCache_.detach();
         return eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
     } else return false;
 }
@@ -320,7 +343,7 @@ void GLContext::sync() const {
  */
 void GLContext::useDefaultSurface() {
     activeSurface_ = defaultSurface_;
-    eglMakeCurrent(display_, activeSurface_, activeSurface_, context_);
+    if (eglMakeCurrent(display_, activeSurface_, activeSurface_, context_)) stateCache_.attach();
 }
 
 
@@ -438,6 +461,36 @@ GLContext::GLContext(EGLContext ctx, int idx, fyusenet::GfxContextManager * mgr)
     GLContextInterface(idx, 0), context_(ctx), manager_(mgr) {
 }
 
+/**
+ * @brief Register main context on an EGL display
+ *
+ * @param display Display that was initialized for a main context
+ */
+void acquireDisplay(EGLDisplay display) {
+    std::lock_guard<std::mutex> lck(displayLock);
+    displayRefs[display]++;
+}
+
+
+/**
+ * @brief Unregister main context from an EGL display and terminate the display when unused
+ *
+ * @param display Display that the main context was created on
+ *
+ * Displays that were not registered via acquireDisplay() (e.g. for wrapped external contexts)
+ * are terminated right away.
+ */
+void releaseDisplay(EGLDisplay display) {
+    std::lock_guard<std::mutex> lck(displayLock);
+    auto it = displayRefs.find(display);
+    if (it != displayRefs.end()) {
+        if (--(it->second) > 0) return;
+        displayRefs.erase(it);
+    }
+    eglTerminate(display);
+}
+
+
 /**
  * @brief Initialize EGL extensions that are required for operation
  */
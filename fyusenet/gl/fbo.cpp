@@ -144,9 +144,9 @@ FBO::FBO(const fyusenet::GfxContextLink &context, const Texture2D &backingTextur
 FBO::~FBO() {
     if (context_.isCurrent()) {
         if (bound_) unbind();
-        if (handle_) glDeleteFramebuffers(1, &handle_);
+        if (handle_) GLStateCache::deleteFramebuffers(1, &handle_);
         if (numInternalTextures_ > 0) {
-            glDeleteTextures(numInternalTextures_, internalTextures_);
+            GLStateCache::deleteTextures(numInternalTextures_, internalTextures_);
 #ifdef DEBUG
             for (int t=0; t < numInternalTextures_; t++) {
                 textureMemory_.fetch_sub(width_ * height_ * internalChannels_[t] * Texture::channelSize(internalTypes_[t]));
@@ -175,7 +175,7 @@ void FBO::invalidate() {
             attachments[i] = ai->first;
         }
 #ifndef __APPLE__
-        glInvalidateFramebuffer(GL_FRAMEBUFFER, attachments_.size(), attachments);
+        GLCommandBuffer::invalidateFramebuffer(GL_FRAMEBUFFER, attachments_.size(), attachments);
 #endif
     }
     dbDirty_ = true;
@@ -193,7 +193,7 @@ void FBO::invalidate() {
 void FBO::resize(int width, int height) {
     if (numInternalTextures_ > 0) {
         for (int t=0; t < numInternalTextures_; t++) {
-            glBindTexture(internalTargets_[t], internalTextures_[t]);
+            GLStateCache::bindTexture(internalTargets_[t], internalTextures_[t]);
 #ifdef DEBUG
             int diff = width * height - width_ * height_;
             diff *= internalChannels_[t] * Texture::channelSize(internalTypes_[t]);
@@ -356,6 +356,45 @@ size_t FBO::copyToPBO(PBO *target, GLenum dataType, int channels, size_t pboOffs
  * @see GfxContextLink::issueSync(), https://www.khronos.org/opengl/wiki/Pixel_Buffer_Object
  */
 size_t FBO::copyToPBO(PBO *target, int width, int height, GLenum dataType, int channels, size_t pboOffset, bool bindPBO, bool integral) {
+    return copyRegionToPBO(target, 0, 0, width, height, dataType, channels, pboOffset, bindPBO, integral);
+}
+
+
+/**
+ * @brief Copy a rectangular region of the %FBO (color-only) contents to target PBO
+ *
+ * @param target PBO to copy data to (not bound)
+ *
+ * @param x Horizontal offset (in pixels) of the region to copy
+ *
+ * @param y Vertical offset (in pixels) of the region to copy
+ *
+ * @param width Width of the region to copy
+ *
+ * @param height Height of the region to copy
+ *
+ * @param dataType Pixel data type to use, e.g. \c GL_UNSIGNED_BYTE or \c GL_FLOAT
+ *
+ * @param channels Number of channels per color-attachment in the %FBO
+ *
+ * @param pboOffset Offset into the supplied PBO (in bytes) where to start writing the data to
+ *
+ * @param bindPBO Bind %PBO before starting copy (set to \c true if %PBO is not already bound)
+ *
+ * @param integral If set to \c true, will assume a download to an integral data format, default is
+ *                 \c false
+ *
+ * @return Number of bytes read from this %FBO and all its attachments
+ *
+ * @throws GLException on size mismatch, unsupported datatypes, framebuffer-mismatch and GL errors
+ *         for debug builds
+ *
+ * Same as copyToPBO(), but only transfers the supplied region of the color attachments, which
+ * is for example used to split spatially batched tensors into individual images.
+ *
+ * @see copyToPBO()
+ */
+size_t FBO::copyRegionToPBO(PBO *target, int x, int y, int width, int height, GLenum dataType, int channels, size_t pboOffset, bool bindPBO, bool integral) {
     if (numAttachments() > 1) THROW_EXCEPTION_ARGS(GLException,"Too many framebuffer attachments (only 1 is allowed for now)");
     CLEAR_GFXERR_DEBUG
     int mult = 1;
@@ -394,7 +433,7 @@ size_t FBO::copyToPBO(PBO *target, int width, int height, GLenum dataType, int c
     for (int i=0; i < (int)attachments_.size(); i++) {
         if (attachments_.count(GL_COLOR_ATTACHMENT0+i) > 0) {
             glReadBuffer(GL_COLOR_ATTACHMENT0+i);
-            glReadPixels(0, 0 , width, height, format, dataType, (GLvoid *)(attoffset + pboOffset));
+            glReadPixels(x, y, width, height, format, dataType, (GLvoid *)(attoffset + pboOffset));
             attoffset += width * height * channels * mult;
         }
     }
@@ -429,7 +468,7 @@ void FBO::bind(GLenum target, bool statusCheck) {
     }
 #endif
     if (!handle_) THROW_EXCEPTION_ARGS(GLException, "Cannot bind uninitialized framebuffer");
-    glBindFramebuffer(target, handle_);
+    GLStateCache::bindFramebuffer(target, handle_);
     if (statusCheck) {
         GLenum status = glCheckFramebufferStatus(target);
         if (status != GL_FRAMEBUFFER_COMPLETE) {
@@ -447,7 +486,7 @@ void FBO::bind(GLenum target, bool statusCheck) {
  */
 void FBO::bindWithViewport(GLenum target) {
     bind(target, true);
-    glViewport(0, 0, width_, height_);
+    GLStateCache::viewport(0, 0, width_, height_);
 }
 
 
@@ -459,7 +498,7 @@ void FBO::bindWithViewport(GLenum target) {
  * Technically binds a zero framebuffer to the supplied \p target .
  */
 void FBO::unbind(GLenum target) {
-    glBindFramebuffer(target, 0);
+    GLStateCache::bindFramebuffer(target, 0);
     bound_ = false;
 }
 
@@ -487,8 +526,8 @@ bool FBO::hasAttachment(GLenum attachment) const {
  */
 void FBO::bindAttachment(GLenum attachment, GLenum unit, GLenum target) {
     GLuint t = getAttachment(attachment);
-    glActiveTexture(unit);
-    glBindTexture(target, t);
+    GLStateCache::activeTexture(unit);
+    GLStateCache::bindTexture(target, t);
 }
 
 
@@ -517,13 +556,13 @@ bool FBO::isValid() const {
     if (!handle_) return false;
     bool wasbound = bound_;
     if (!wasbound) {
-        glBindFramebuffer(GL_FRAMEBUFFER, handle_);
+        GLStateCache::bindFramebuffer(GL_FRAMEBUFFER, handle_);
         bound_ = true;
     }
     GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
     // NOTE (mw) we silently assume that the default FB was bound before calling this function
     if (!wasbound) {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLStateCache::bindFramebuffer(GL_FRAMEBUFFER, 0);
         bound_ = false;
     }
     if (status == GL_FRAMEBUFFER_COMPLETE) return true;
@@ -564,7 +603,7 @@ void FBO::setWriteMask() const {
     assert(bound_);
     int db = numDrawBuffers();
     CLEAR_GFXERR_DEBUG
-    glDrawBuffers(db, WRITE_BUFFERS);
+    GLCommandBuffer::drawBuffers(db, WRITE_BUFFERS);
 #ifdef DEBUG
     GLenum err = glGetError();
     if (err != GL_NO_ERROR) THROW_EXCEPTION_ARGS(GLException,"Illegal write mask set (err=0x%X, db=%d)",err,db);
@@ -594,7 +633,7 @@ void FBO::updateColorAttachment(GLenum attachment, const Texture2D& texture) {
     }
 #endif
     if (!bound_) {
-        glBindFramebuffer(GL_FRAMEBUFFER, handle_);
+        GLStateCache::bindFramebuffer(GL_FRAMEBUFFER, handle_);
         bound_ = true;
     }
     glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture.getHandle(),0);
@@ -626,7 +665,7 @@ void FBO::updateColorAttachment(GLenum attachment, GLuint texture, int width, in
     }
 #endif
     if (!bound_) {
-        glBindFramebuffer(GL_FRAMEBUFFER,handle_);
+        GLStateCache::bindFramebuffer(GL_FRAMEBUFFER,handle_);
         bound_ = true;
     }
     glFramebufferTexture2D(GL_FRAMEBUFFER,attachment,GL_TEXTURE_2D,texture,0);
@@ -655,7 +694,7 @@ void FBO::updateColorAttachment(GLenum attachment, GLuint texture) {
     glGetError();
 #endif
     if (!bound_) {
-        glBindFramebuffer(GL_FRAMEBUFFER, handle_);
+        GLStateCache::bindFramebuffer(GL_FRAMEBUFFER, handle_);
         bound_ = true;
     }
     glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
@@ -733,7 +772,7 @@ void FBO::addTexture(GLenum attachment, GLuint texture, GLenum target) {
             FNLOGE("Accessing FBO from wrong context");
         }
 #endif
-        glBindFramebuffer(GL_FRAMEBUFFER, handle_);
+        GLStateCache::bindFramebuffer(GL_FRAMEBUFFER, handle_);
         bound_ = true;
     }
     glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, target, texture, 0);
@@ -765,7 +804,7 @@ void FBO::addRenderbuffer(GLenum attachment, GLuint handle) {
 #ifdef DEBUG
         assertContext();
 #endif
-        glBindFramebuffer(GL_FRAMEBUFFER, handle_);
+        GLStateCache::bindFramebuffer(GL_FRAMEBUFFER, handle_);
         bound_ = true;
     }
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, handle);
@@ -818,7 +857,7 @@ GLuint FBO::setupInternalTexture(int width, int height, int channels, Texture::p
     // not matter for the FBO
     // ------------------------------------------------------
     auto ti = Texture::textureInfo(internalTypes_[idx], internalChannels_[idx]);
-    glBindTexture(target, internalTextures_[idx]);
+    GLStateCache::bindTexture(target, internalTextures_[idx]);
     glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -55,6 +55,7 @@ class FBO : public fyusenet::GfxContextTracker {
     void invalidate();
     size_t copyToPBO(PBO *target, GLenum dataType, int channels, size_t pboOffset=0, bool bindPBO=false, bool integral=false);
     size_t copyToPBO(PBO *target, int width, int height, GLenum dataType, int channels, size_t pboOffset=0, bool bindPBO=false, bool integral=false);
+    size_t copyRegionToPBO(PBO *target, int x, int y, int width, int height, GLenum dataType, int channels, size_t pboOffset=0, bool bindPBO=false, bool integral=false);
     void bind(GLenum target = GL_FRAMEBUFFER, bool statusCheck=true);
     void bindWithViewport(GLenum target = GL_FRAMEBUFFER);
     void unbind(GLenum target = GL_FRAMEBUFFER);
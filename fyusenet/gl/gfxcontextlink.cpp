@@ -10,6 +10,7 @@
 
 #include <mutex>
 #include <atomic>
+#include <chrono>
 #include <set>
 
 //-------------------------------------- Project  Headers ------------------------------------------
@@ -28,6 +29,9 @@ namespace fyusion::fyusenet {
 
 const GfxContextLink GfxContextLink::EMPTY = GfxContextLink(true);
 
+static std::atomic<uint64_t> SYNC_WAIT_COUNT{0};         // for statistics, number of client-side sync waits
+static std::atomic<uint64_t> SYNC_WAIT_NANOS{0};         // for statistics, accumulated time spent in client-side sync waits
+
 #ifdef DEBUG
 static std::atomic<uint64_t> CONTEXT_ID_SEQCTR{1};
 static std::atomic<bool> CONTEXT_ID_SPINNER{false};
@@ -210,7 +214,10 @@ bool GfxContextLink::waitClientSync(syncid sync, GLuint64 timeoutNS) const {
     if (!context_) THROW_EXCEPTION_ARGS(opengl::GLException,"No context associated with link");
     assert(isCurrent());
     CLEAR_GFXERR_DEBUG
+    auto start = std::chrono::steady_clock::now();
     GLenum rc = glClientWaitSync(sync,GL_SYNC_FLUSH_COMMANDS_BIT,timeoutNS);
+    SYNC_WAIT_NANOS.fetch_add((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    SYNC_WAIT_COUNT.fetch_add(1);
 #ifdef DEBUG
     int err = glGetError();
     assert(err == GL_NO_ERROR);
@@ -222,6 +229,35 @@ bool GfxContextLink::waitClientSync(syncid sync, GLuint64 timeoutNS) const {
 }
 
 
+/**
+ * @brief Obtain accumulated statistics on client-side sync waits
+ *
+ * @param[out] waits Number of calls to waitClientSync() (on all links) since program start or
+ *                   the last call to resetSyncWaitStatistics()
+ * @param[out] nanos Total time (in nanoseconds) spent inside these calls
+ *
+ * The time spent waiting for fences on the client side is a good indicator whether asynchronous
+ * transfers are stalled by the GPU, e.g. when tuning %PBO pool sizes or the pipeline depth.
+ *
+ * @see waitClientSync(), resetSyncWaitStatistics()
+ */
+void GfxContextLink::syncWaitStatistics(uint64_t & waits, uint64_t & nanos) {
+    waits = SYNC_WAIT_COUNT.load();
+    nanos = SYNC_WAIT_NANOS.load();
+}
+
+
+/**
+ * @brief Reset statistics on client-side sync waits
+ *
+ * @see syncWaitStatistics()
+ */
+void GfxContextLink::resetSyncWaitStatistics() {
+    SYNC_WAIT_COUNT.store(0);
+    SYNC_WAIT_NANOS.store(0);
+}
+
+
 /**
  * @brief Obtain pointer to texture pool usable with the context
  *
@@ -9,6 +9,7 @@
 //--------------------------------------- System Headers -------------------------------------------
 
 #include <cassert>
+#include <mutex>
 
 //-------------------------------------- Project  Headers ------------------------------------------
 
@@ -18,6 +19,7 @@
 #include "glcontext.h"
 #include "pbopool.h"
 #include "shadercache.h"
+#include "programbinarycache.h"
 #include "shadersnippet.h"
 #include "scoped_texturepool.h"
 #ifdef FYUSENET_MULTITHREADING
@@ -32,6 +34,11 @@ namespace fyusion::fyusenet {
 
 std::vector<std::shared_ptr<GfxContextManager>> GfxContextManager::managers_;
 
+/**
+ * Serializes creation and removal of manager instances
+ */
+static std::mutex managerLock;
+
 /*##################################################################################################
 #                                   P U B L I C  F U N C T I O N S                                 #
 ##################################################################################################*/
@@ -293,24 +300,21 @@ fyusenet::GfxContextLink GfxContextManager::getDerived(const fyusenet::GfxContex
  *
  * @return Pointer to instance of the context manager for the specified \p device.
  *
- * @note This function is not thread-safe.
+ * Each device has its own manager instance with its own set of contexts and %PBO pools. Device
+ * indices that exceed the number of GPUs in the system are mapped onto the available GPUs by the
+ * GL backend (EGL only), the managers still maintain separate contexts in that case.
  *
- * @warning We currently support only one GPU/device. Though the context manager has some
- *          preparations for multi-GPU support done already, the tear-down mechanism
- *          currently assumes that the context manager is a singleton. For multi-GPU support,
- *          the teardown of the GL thread pool and the shader cache need to be adjusted for
- *          multi-GPU support.
+ * @note The GL thread pool and the shader cache are process-wide and are torn down together with
+ *       all manager instances, see tearDown().
  */
 std::shared_ptr<GfxContextManager> GfxContextManager::instance(int device) {
     assert(device >= 0);
-    // TODO (mw) thread safety
-    if ((int)managers_.size() <= device) {
-        managers_.resize(device+1, nullptr);
+    std::lock_guard<std::mutex> lck(managerLock);
+    for (auto & mgr : managers_) {
+        if (mgr->deviceID_ == device) return mgr;
     }
-    if (!managers_[device]) {
-        managers_[device] = std::shared_ptr<GfxContextManager>(new GfxContextManager(device));
-    }
-    return managers_[device];
+    managers_.push_back(std::shared_ptr<GfxContextManager>(new GfxContextManager(device)));
+    return managers_.back();
 }
 
 
@@ -318,13 +322,14 @@ std::shared_ptr<GfxContextManager> GfxContextManager::instance(int device) {
  * @brief GfxContextManager::tearDown
  *
  * This function tears down the GL resources with singleton character, including the AsyncPool, the
- * ShaderCache and \e all GfxContextManager instances that have been created. This should be done as
+ * ShaderCache, the ProgramBinaryCache (which is written to disk) and \e all GfxContextManager instances that have been created. This should be done as
  * the very last operation in a program from the main thread.
  *
  * @note This function is not thread-safe. It is recomended to tear down the context manager from
  *       the main thread as last action.
  */
 void GfxContextManager::tearDown() {
+    opengl::ProgramBinaryCache::close();
     opengl::ShaderCache::tearDown();
     opengl::ShaderSnippet::tearDown();
 #ifdef FYUSENET_MULTITHREADING
@@ -353,8 +358,9 @@ void GfxContextManager::tearDown() {
  */
 void GfxContextManager::cleanup() {
     if (mainContext_) {
-        if (!mainContext_->isCurrent()) {
-            bool ctxok = mainContext_->makeCurrent();
+        bool ctxok = mainContext_->isCurrent();
+        if (!ctxok) {
+            ctxok = mainContext_->makeCurrent();
             if (!ctxok) {
 #ifdef DEBUG
                 THROW_EXCEPTION_ARGS(opengl::GLException,"Cannot tear down context manager from outside the main context");
@@ -362,7 +368,8 @@ void GfxContextManager::cleanup() {
                 FNLOGE("Tearing down context manager without context current, expect GL memory leaks");
 #endif
             }
-        } else {
+        }
+        if (ctxok) {
             FNET_DEL_AND_CLEAR(pboReadPool_);
             FNET_DEL_AND_CLEAR(pboWritePool_);
             FNET_DEL_AND_CLEAR(texturePool_);
@@ -383,7 +390,7 @@ void GfxContextManager::cleanup() {
     } else {
         if (!contexts_.empty()) THROW_EXCEPTION_ARGS(opengl::GLException, "No main context set, yet this manager has %ld contexts, canot teardown",contexts_.size());
     }
-    // TODO (mw) thread-safety
+    std::lock_guard<std::mutex> lck(managerLock);
     for (auto it=managers_.begin(); it != managers_.end(); ++it) {
         if (it->get() == this) {
             managers_.erase(it);
@@ -423,6 +430,27 @@ void GfxContextManager::setupTexturePool() {
 }
 
 
+/**
+ * @brief Setup persistent cache for linked shader program binaries
+ *
+ * @param fileName Name of the file that stores the program binaries
+ *
+ * @retval true if the cache was set up
+ * @retval false if the GL implementation does not support program binaries
+ *
+ * Once set up, all shader programs that are linked try to load their binaries from the cache
+ * first, which substantially reduces the setup time of networks on subsequent runs. The cache is
+ * written to disk when the context manager is torn down.
+ *
+ * @pre The main context of this manager is current to the calling thread
+ *
+ * @see opengl::ProgramBinaryCache, tearDown()
+ */
+bool GfxContextManager::setupProgramBinaryCache(const std::string & fileName) {
+    return (opengl::ProgramBinaryCache::open(fileName) != nullptr);
+}
+
+
 /*##################################################################################################
 #                               N O N -  P U B L I C  F U N C T I O N S                            #
 ##################################################################################################*/
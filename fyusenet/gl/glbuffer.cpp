@@ -116,7 +116,7 @@ void GLBuffer::bind(GLenum target) {
     }
 #endif
     if (handle_ == 0) THROW_EXCEPTION_ARGS(GLException,"Trying to bind uninitialized buffer");
-    glBindBuffer(target, handle_);
+    GLCommandBuffer::bindBuffer(target, handle_);
 #ifdef DEBUG
     GLenum err = glGetError();
     if (err != GL_NO_ERROR) THROW_EXCEPTION_ARGS(GLException,"Buffer %d binding to %X failed (glerr=0x%X)",handle_,target,err);
@@ -142,7 +142,7 @@ void GLBuffer::unbind() {
  * @param target GL target to unbind buffer object from
  */
 void GLBuffer::unbind(GLenum target) {
-    glBindBuffer(target,0);
+    GLCommandBuffer::bindBuffer(target,0);
     bound_ = false;
 }
 
@@ -0,0 +1,599 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// GL Command Buffer
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <cassert>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "glcommandbuffer.h"
+#include "glstatecache.h"
+#include "glexception.h"
+
+namespace fyusion::opengl {
+
+//-------------------------------------- Global Variables ------------------------------------------
+
+thread_local GLCommandBuffer * GLCommandBuffer::recorder_ = nullptr;
+
+//-------------------------------------- Local Definitions -----------------------------------------
+
+/**
+ * @brief Reinterpret a recorded word as float value
+ *
+ * @param word Recorded word
+ *
+ * @return Float value that was stored in the word
+ */
+static inline GLfloat asFloat(uint32_t word) {
+    GLfloat result;
+    memcpy(&result, &word, sizeof(result));
+    return result;
+}
+
+
+/*##################################################################################################
+#                                   P U B L I C  F U N C T I O N S                                 #
+##################################################################################################*/
+
+/**
+ * @brief Destructor
+ *
+ * Stops an active recording on the calling thread.
+ */
+GLCommandBuffer::~GLCommandBuffer() {
+    if (recorder_ == this) recorder_ = nullptr;
+}
+
+
+/**
+ * @brief Start recording GL commands on the calling thread
+ *
+ * @throws GLException in case a different command buffer is already recording on the calling thread
+ *
+ * Discards previously recorded commands (the slots are kept) and attaches this buffer to the
+ * calling thread. The state cache of the current context is invalidated, such that the first
+ * change of each tracked state item is recorded and the stream does not depend on the GL state
+ * that was present when the recording started.
+ */
+void GLCommandBuffer::begin() {
+    if ((recorder_) && (recorder_ != this)) THROW_EXCEPTION_ARGS(GLException, "Another command buffer is already recording");
+    words_.clear();
+    numCommands_ = 0;
+    program_ = 0;
+    GLStateCache::invalidate();
+    recorder_ = this;
+}
+
+
+/**
+ * @brief Stop recording GL commands on the calling thread
+ */
+void GLCommandBuffer::end() {
+    if (recorder_ == this) recorder_ = nullptr;
+}
+
+
+/**
+ * @brief Discard all recorded commands and slots
+ */
+void GLCommandBuffer::reset() {
+    end();
+    words_.clear();
+    textureSlots_.clear();
+    uniformSlots_.clear();
+    numCommands_ = 0;
+}
+
+
+/**
+ * @brief Register texture slot
+ *
+ * @param texture Texture handle that is to be replaced by the slot
+ *
+ * @return Slot index to be used with setTextureSlot()
+ *
+ * All texture bindings of the supplied \p texture that are recorded \e after registering the
+ * slot refer to the slot instead, which is initialized with the supplied \p texture.
+ * Registering the same texture twice returns the same slot.
+ */
+int GLCommandBuffer::addTextureSlot(GLuint texture) {
+    for (int i=0; i < (int)textureSlots_.size(); i++) {
+        if (textureSlots_[i].recorded == texture) return i;
+    }
+    textureSlots_.push_back(TextureSlot{texture, texture});
+    return (int)textureSlots_.size() - 1;
+}
+
+
+/**
+ * @brief Register uniform slot
+ *
+ * @param program GL handle of shader program that contains the uniform
+ * @param location Location of the uniform in the \p program
+ *
+ * @return Slot index to be used with setUniformSlot()
+ *
+ * All assignments of the uniform that are recorded \e after registering the slot refer to the
+ * slot instead, the slot is initialized with the recorded value. Only scalar and vector uniforms
+ * (up to 4 components) are supported as slots.
+ */
+int GLCommandBuffer::addUniformSlot(GLuint program, GLint location) {
+    for (int i=0; i < (int)uniformSlots_.size(); i++) {
+        if ((uniformSlots_[i].program == program) && (uniformSlots_[i].location == location)) return i;
+    }
+    UniformSlot slot;
+    slot.program = program;
+    slot.location = location;
+    uniformSlots_.push_back(slot);
+    return (int)uniformSlots_.size() - 1;
+}
+
+
+/**
+ * @brief Set texture to be used for a texture slot on replay
+ *
+ * @param slot Slot index as returned by addTextureSlot()
+ * @param texture Texture handle to bind instead of the recorded one
+ */
+void GLCommandBuffer::setTextureSlot(int slot, GLuint texture) {
+    assert((slot >= 0) && (slot < (int)textureSlots_.size()));
+    textureSlots_[slot].current = texture;
+}
+
+
+/**
+ * @brief Set integer value(s) to be used for a uniform slot on replay
+ *
+ * @param slot Slot index as returned by addUniformSlot()
+ * @param v0 ... v3 Values of the uniform, excess components are ignored
+ */
+void GLCommandBuffer::setUniformSlot(int slot, GLint v0, GLint v1, GLint v2, GLint v3) {
+    assert((slot >= 0) && (slot < (int)uniformSlots_.size()));
+    uint32_t * values = uniformSlots_[slot].values;
+    values[0] = word(v0);
+    values[1] = word(v1);
+    values[2] = word(v2);
+    values[3] = word(v3);
+}
+
+
+/**
+ * @brief Set float value(s) to be used for a uniform slot on replay
+ *
+ * @param slot Slot index as returned by addUniformSlot()
+ * @param v0 ... v3 Values of the uniform, excess components are ignored
+ */
+void GLCommandBuffer::setUniformSlot(int slot, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {
+    assert((slot >= 0) && (slot < (int)uniformSlots_.size()));
+    uint32_t * values = uniformSlots_[slot].values;
+    values[0] = word(v0);
+    values[1] = word(v1);
+    values[2] = word(v2);
+    values[3] = word(v3);
+}
+
+
+/**
+ * @brief Record a texture binding, taking texture slots into account
+ *
+ * @param target Texture target
+ * @param texture GL handle of the bound texture
+ */
+void GLCommandBuffer::bindTexture(GLenum target, GLuint texture) {
+    for (int i=0; i < (int)textureSlots_.size(); i++) {
+        if (textureSlots_[i].recorded == texture) {
+            push(BIND_TEXTURE_SLOT, target, (uint32_t)i);
+            return;
+        }
+    }
+    push(BIND_TEXTURE, target, texture);
+}
+
+
+/**
+ * @brief Re-issue all recorded commands
+ *
+ * @pre The GL context that was used for recording (or a context that is shared with it) is current
+ *      to the calling thread
+ *
+ * The commands are issued directly to GL, bypassing the GLStateCache, which is invalidated
+ * afterwards.
+ */
+void GLCommandBuffer::replay() const {
+    const uint32_t * cmd = words_.data();
+    const uint32_t * end = cmd + words_.size();
+    while (cmd < end) {
+        switch (cmd[0]) {
+            case ENABLE:
+                glEnable(cmd[1]);
+                cmd += 2;
+                break;
+            case DISABLE:
+                glDisable(cmd[1]);
+                cmd += 2;
+                break;
+            case BLEND_EQUATION:
+                glBlendEquationSeparate(cmd[1], cmd[2]);
+                cmd += 3;
+                break;
+            case BLEND_FUNC:
+                glBlendFuncSeparate(cmd[1], cmd[2], cmd[3], cmd[4]);
+                cmd += 5;
+                break;
+            case VIEWPORT:
+                glViewport((GLint)cmd[1], (GLint)cmd[2], (GLsizei)cmd[3], (GLsizei)cmd[4]);
+                cmd += 5;
+                break;
+            case CLEAR_COLOR:
+                glClearColor(asFloat(cmd[1]), asFloat(cmd[2]), asFloat(cmd[3]), asFloat(cmd[4]));
+                cmd += 5;
+                break;
+            case USE_PROGRAM:
+                glUseProgram(cmd[1]);
+                cmd += 2;
+                break;
+            case BIND_VAO:
+                glBindVertexArray(cmd[1]);
+                cmd += 2;
+                break;
+            case BIND_FBO:
+                glBindFramebuffer(cmd[1], cmd[2]);
+                cmd += 3;
+                break;
+            case ACTIVE_TEXTURE:
+                glActiveTexture(cmd[1]);
+                cmd += 2;
+                break;
+            case BIND_TEXTURE:
+                glBindTexture(cmd[1], cmd[2]);
+                cmd += 3;
+                break;
+            case BIND_TEXTURE_SLOT:
+                glBindTexture(cmd[1], textureSlots_[cmd[2]].current);
+                cmd += 3;
+                break;
+            case SCISSOR:
+                glScissor((GLint)cmd[1], (GLint)cmd[2], (GLsizei)cmd[3], (GLsizei)cmd[4]);
+                cmd += 5;
+                break;
+            case CLEAR:
+                glClear(cmd[1]);
+                cmd += 2;
+                break;
+            case CLEAR_BUFFERFV: {
+                GLfloat value[4] = {asFloat(cmd[3]), asFloat(cmd[4]), asFloat(cmd[5]), asFloat(cmd[6])};
+                glClearBufferfv(cmd[1], (GLint)cmd[2], value);
+                cmd += 7;
+                break;
+            }
+            case DRAW_BUFFERS:
+                glDrawBuffers((GLsizei)cmd[1], (const GLenum *)(cmd + 2));
+                cmd += 2 + cmd[1];
+                break;
+            case INVALIDATE_FBO:
+#ifndef __APPLE__
+                glInvalidateFramebuffer(cmd[1], (GLsizei)cmd[2], (const GLenum *)(cmd + 3));
+#endif
+                cmd += 3 + cmd[2];
+                break;
+            case DRAW_ARRAYS:
+                glDrawArrays(cmd[1], (GLint)cmd[2], (GLsizei)cmd[3]);
+                cmd += 4;
+                break;
+            case DRAW_ARRAYS_INSTANCED:
+                glDrawArraysInstanced(cmd[1], (GLint)cmd[2], (GLsizei)cmd[3], (GLsizei)cmd[4]);
+                cmd += 5;
+                break;
+            case DRAW_ELEMENTS:
+                glDrawElements(cmd[1], (GLsizei)cmd[2], cmd[3], (const GLvoid *)(uintptr_t)cmd[4]);
+                cmd += 5;
+                break;
+            case DRAW_ELEMENTS_INSTANCED:
+                glDrawElementsInstanced(cmd[1], (GLsizei)cmd[2], cmd[3], (const GLvoid *)(uintptr_t)cmd[4], (GLsizei)cmd[5]);
+                cmd += 6;
+                break;
+            case DEPTH_FUNC:
+                glDepthFunc(cmd[1]);
+                cmd += 2;
+                break;
+            case DEPTH_MASK:
+                glDepthMask((GLboolean)cmd[1]);
+                cmd += 2;
+                break;
+            case STENCIL_FUNC_SEPARATE:
+                glStencilFuncSeparate(cmd[1], cmd[2], (GLint)cmd[3], cmd[4]);
+                cmd += 5;
+                break;
+            case STENCIL_OP:
+                glStencilOp(cmd[1], cmd[2], cmd[3]);
+                cmd += 4;
+                break;
+            case STENCIL_MASK:
+                glStencilMask(cmd[1]);
+                cmd += 2;
+                break;
+            case LINE_WIDTH:
+                glLineWidth(asFloat(cmd[1]));
+                cmd += 2;
+                break;
+            case BIND_BUFFER:
+                glBindBuffer(cmd[1], cmd[2]);
+                cmd += 3;
+                break;
+            case BIND_BUFFER_BASE:
+                glBindBufferBase(cmd[1], cmd[2], cmd[3]);
+                cmd += 4;
+                break;
+            case BIND_BUFFER_RANGE:
+                glBindBufferRange(cmd[1], cmd[2], cmd[3], (GLintptr)cmd[4], (GLsizeiptr)cmd[5]);
+                cmd += 6;
+                break;
+            case UNIFORM_1I:
+                glUniform1i((GLint)cmd[1], (GLint)cmd[2]);
+                cmd += 3;
+                break;
+            case UNIFORM_2I:
+                glUniform2i((GLint)cmd[1], (GLint)cmd[2], (GLint)cmd[3]);
+                cmd += 4;
+                break;
+            case UNIFORM_3I:
+                glUniform3i((GLint)cmd[1], (GLint)cmd[2], (GLint)cmd[3], (GLint)cmd[4]);
+                cmd += 5;
+                break;
+            case UNIFORM_4I:
+                glUniform4i((GLint)cmd[1], (GLint)cmd[2], (GLint)cmd[3], (GLint)cmd[4], (GLint)cmd[5]);
+                cmd += 6;
+                break;
+            case UNIFORM_1F:
+                glUniform1f((GLint)cmd[1], asFloat(cmd[2]));
+                cmd += 3;
+                break;
+            case UNIFORM_2F:
+                glUniform2f((GLint)cmd[1], asFloat(cmd[2]), asFloat(cmd[3]));
+                cmd += 4;
+                break;
+            case UNIFORM_3F:
+                glUniform3f((GLint)cmd[1], asFloat(cmd[2]), asFloat(cmd[3]), asFloat(cmd[4]));
+                cmd += 5;
+                break;
+            case UNIFORM_4F:
+                glUniform4f((GLint)cmd[1], asFloat(cmd[2]), asFloat(cmd[3]), asFloat(cmd[4]), asFloat(cmd[5]));
+                cmd += 6;
+                break;
+            case UNIFORM_SLOT: {
+                GLint loc = (GLint)cmd[2];
+                const uint32_t * v = uniformSlots_[cmd[3]].values;
+                switch (cmd[1]) {
+                    case UNIFORM_1I: glUniform1i(loc, (GLint)v[0]); break;
+                    case UNIFORM_2I: glUniform2i(loc, (GLint)v[0], (GLint)v[1]); break;
+                    case UNIFORM_3I: glUniform3i(loc, (GLint)v[0], (GLint)v[1], (GLint)v[2]); break;
+                    case UNIFORM_4I: glUniform4i(loc, (GLint)v[0], (GLint)v[1], (GLint)v[2], (GLint)v[3]); break;
+                    case UNIFORM_1F: glUniform1f(loc, asFloat(v[0])); break;
+                    case UNIFORM_2F: glUniform2f(loc, asFloat(v[0]), asFloat(v[1])); break;
+                    case UNIFORM_3F: glUniform3f(loc, asFloat(v[0]), asFloat(v[1]), asFloat(v[2])); break;
+                    case UNIFORM_4F: glUniform4f(loc, asFloat(v[0]), asFloat(v[1]), asFloat(v[2]), asFloat(v[3])); break;
+                    default: assert(false);
+                }
+                cmd += 4;
+                break;
+            }
+            case UNIFORM_1FV:
+                glUniform1fv((GLint)cmd[1], (GLsizei)cmd[2], (const GLfloat *)(cmd + 3));
+                cmd += 3 + cmd[2];
+                break;
+            case UNIFORM_2FV:
+                glUniform2fv((GLint)cmd[1], (GLsizei)cmd[2], (const GLfloat *)(cmd + 3));
+                cmd += 3 + 2 * cmd[2];
+                break;
+            case UNIFORM_3FV:
+                glUniform3fv((GLint)cmd[1], (GLsizei)cmd[2], (const GLfloat *)(cmd + 3));
+                cmd += 3 + 3 * cmd[2];
+                break;
+            case UNIFORM_4FV:
+                glUniform4fv((GLint)cmd[1], (GLsizei)cmd[2], (const GLfloat *)(cmd + 3));
+                cmd += 3 + 4 * cmd[2];
+                break;
+            case UNIFORM_2IV:
+                glUniform2iv((GLint)cmd[1], (GLsizei)cmd[2], (const GLint *)(cmd + 3));
+                cmd += 3 + 2 * cmd[2];
+                break;
+            case UNIFORM_4UIV:
+                glUniform4uiv((GLint)cmd[1], (GLsizei)cmd[2], (const GLuint *)(cmd + 3));
+                cmd += 3 + 4 * cmd[2];
+                break;
+            case UNIFORM_MAT3:
+                glUniformMatrix3fv((GLint)cmd[1], (GLsizei)cmd[2], (GLboolean)cmd[3], (const GLfloat *)(cmd + 4));
+                cmd += 4 + 9 * cmd[2];
+                break;
+            case UNIFORM_MAT4:
+                glUniformMatrix4fv((GLint)cmd[1], (GLsizei)cmd[2], (GLboolean)cmd[3], (const GLfloat *)(cmd + 4));
+                cmd += 4 + 16 * cmd[2];
+                break;
+            default:
+                assert(false);
+                cmd = end;
+                break;
+        }
+    }
+    GLStateCache::invalidate();
+}
+
+
+/**
+ * @brief Specify draw buffers of the bound framebuffer (see \c glDrawBuffers)
+ *
+ * @param count Number of draw buffers
+ * @param buffers Pointer to \p count draw buffer identifiers
+ */
+void GLCommandBuffer::drawBuffers(GLsizei count, const GLenum * buffers) {
+    glDrawBuffers(count, buffers);
+    if (recorder_) {
+        recorder_->push(DRAW_BUFFERS, (uint32_t)count);
+        recorder_->words_.insert(recorder_->words_.end(), buffers, buffers + count);
+    }
+}
+
+
+/**
+ * @brief Invalidate contents of framebuffer attachments (see \c glInvalidateFramebuffer)
+ *
+ * @param target Framebuffer target
+ * @param count Number of attachments
+ * @param attachments Pointer to \p count attachment identifiers
+ *
+ * @note This is a no-op on Apple platforms
+ */
+void GLCommandBuffer::invalidateFramebuffer(GLenum target, GLsizei count, const GLenum * attachments) {
+#ifndef __APPLE__
+    glInvalidateFramebuffer(target, count, attachments);
+    if (recorder_) {
+        recorder_->push(INVALIDATE_FBO, target, (uint32_t)count);
+        recorder_->words_.insert(recorder_->words_.end(), attachments, attachments + count);
+    }
+#endif
+}
+
+
+/**
+ * @brief Set float array uniform (see \c glUniform1fv)
+ *
+ * @param location Uniform location in the bound program
+ * @param count Number of array elements
+ * @param data Pointer to uniform data
+ */
+void GLCommandBuffer::uniform1fv(GLint location, GLsizei count, const GLfloat * data) {
+    glUniform1fv(location, count, data);
+    if (recorder_) recorder_->pushArray(UNIFORM_1FV, location, count, count, data);
+}
+
+
+/**
+ * @brief Set float 2-vector array uniform (see \c glUniform2fv)
+ *
+ * @param location Uniform location in the bound program
+ * @param count Number of array elements
+ * @param data Pointer to uniform data
+ */
+void GLCommandBuffer::uniform2fv(GLint location, GLsizei count, const GLfloat * data) {
+    glUniform2fv(location, count, data);
+    if (recorder_) recorder_->pushArray(UNIFORM_2FV, location, count, 2 * count, data);
+}
+
+
+/**
+ * @brief Set float 3-vector array uniform (see \c glUniform3fv)
+ *
+ * @param location Uniform location in the bound program
+ * @param count Number of array elements
+ * @param data Pointer to uniform data
+ */
+void GLCommandBuffer::uniform3fv(GLint location, GLsizei count, const GLfloat * data) {
+    glUniform3fv(location, count, data);
+    if (recorder_) recorder_->pushArray(UNIFORM_3FV, location, count, 3 * count, data);
+}
+
+
+/**
+ * @brief Set float 4-vector array uniform (see \c glUniform4fv)
+ *
+ * @param location Uniform location in the bound program
+ * @param count Number of array elements
+ * @param data Pointer to uniform data
+ */
+void GLCommandBuffer::uniform4fv(GLint location, GLsizei count, const GLfloat * data) {
+    glUniform4fv(location, count, data);
+    if (recorder_) recorder_->pushArray(UNIFORM_4FV, location, count, 4 * count, data);
+}
+
+
+/**
+ * @brief Set integer 2-vector array uniform (see \c glUniform2iv)
+ *
+ * @param location Uniform location in the bound program
+ * @param count Number of array elements
+ * @param data Pointer to uniform data
+ */
+void GLCommandBuffer::uniform2iv(GLint location, GLsizei count, const GLint * data) {
+    glUniform2iv(location, count, data);
+    if (recorder_) recorder_->pushArray(UNIFORM_2IV, location, count, 2 * count, data);
+}
+
+
+/**
+ * @brief Set unsigned integer 4-vector array uniform (see \c glUniform4uiv)
+ *
+ * @param location Uniform location in the bound program
+ * @param count Number of array elements
+ * @param data Pointer to uniform data
+ */
+void GLCommandBuffer::uniform4uiv(GLint location, GLsizei count, const GLuint * data) {
+    glUniform4uiv(location, count, data);
+    if (recorder_) recorder_->pushArray(UNIFORM_4UIV, location, count, 4 * count, data);
+}
+
+
+/**
+ * @brief Set 3x3 matrix (array) uniform (see \c glUniformMatrix3fv)
+ *
+ * @param location Uniform location in the bound program
+ * @param count Number of matrices
+ * @param transpose Transpose flag
+ * @param data Pointer to matrix data
+ */
+void GLCommandBuffer::uniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat * data) {
+    glUniformMatrix3fv(location, count, transpose, data);
+    if (recorder_) {
+        recorder_->push(UNIFORM_MAT3, location, (uint32_t)count, (uint32_t)transpose);
+        const uint32_t * ptr = (const uint32_t *)data;
+        recorder_->words_.insert(recorder_->words_.end(), ptr, ptr + 9 * count);
+    }
+}
+
+
+/**
+ * @brief Set 4x4 matrix (array) uniform (see \c glUniformMatrix4fv)
+ *
+ * @param location Uniform location in the bound program
+ * @param count Number of matrices
+ * @param transpose Transpose flag
+ * @param data Pointer to matrix data
+ */
+void GLCommandBuffer::uniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat * data) {
+    glUniformMatrix4fv(location, count, transpose, data);
+    if (recorder_) {
+        recorder_->push(UNIFORM_MAT4, location, (uint32_t)count, (uint32_t)transpose);
+        const uint32_t * ptr = (const uint32_t *)data;
+        recorder_->words_.insert(recorder_->words_.end(), ptr, ptr + 16 * count);
+    }
+}
+
+
+/*##################################################################################################
+#                               N O N -  P U B L I C  F U N C T I O N S                            #
+##################################################################################################*/
+
+/**
+ * @brief Append uniform array command to the buffer
+ *
+ * @param op Opcode of the command
+ * @param location Location of the uniform
+ * @param count Number of array elements
+ * @param words Number of 32-bit words in the array data
+ * @param data Pointer to array data, which is copied into the buffer
+ */
+void GLCommandBuffer::pushArray(opcode op, GLint location, GLsizei count, GLsizei words, const void * data) {
+    push(op, location, (uint32_t)count);
+    const auto * ptr = (const uint32_t *)data;
+    words_.insert(words_.end(), ptr, ptr + words);
+}
+
+} // fyusion::opengl namespace
+
+// vim: set expandtab ts=4 sw=4:
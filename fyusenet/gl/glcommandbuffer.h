@@ -0,0 +1,574 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// GL Command Buffer (Header)
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "gl_sys.h"
+
+//------------------------------------- Public Declarations ----------------------------------------
+
+namespace fyusion::opengl {
+
+/**
+ * @brief Recorder and replay engine for a stream of GL commands
+ *
+ * This class captures the GL commands that are issued by the network layers during an inference
+ * run into a compact buffer of 32-bit words and re-issues them later without running the layer
+ * logic again. For a fixed network and input size, the sequence of programs, uniforms, bindings
+ * and draw calls is identical for every run, such that replaying the recorded stream saves the
+ * CPU time that is spent in the \c forward() implementations of the layers.
+ *
+ * Recording works by attaching a command buffer to the calling thread (see begin()). While a
+ * buffer is attached, all GL calls that are issued through the wrappers of this class (draw calls,
+ * clears, uniforms and some auxiliary state) as well as the state changes that are issued by
+ * the GLStateCache are appended to the buffer, in addition to being executed as usual. Only calls
+ * that are routed through these two classes are captured, code that issues GL calls directly
+ * cannot be recorded.
+ *
+ * Recorded values can be turned into \e slots, which may be changed prior to each replay:
+ *   - texture slots replace a texture handle in all recorded texture bindings, which is used to
+ *     supply new input textures to a recorded stream (see addTextureSlot())
+ *   - uniform slots replace the value of a uniform of a specific shader program, which can be
+ *     used for uniforms that change from run to run (see addUniformSlot())
+ *
+ * @code
+ * GLCommandBuffer cmds;
+ * int input = cmds.addTextureSlot(inputTexture);
+ * cmds.begin();
+ * ... issue GL commands (e.g. run layers) ...
+ * cmds.end();
+ * ...
+ * cmds.setTextureSlot(input, otherTexture);
+ * cmds.replay();
+ * @endcode
+ *
+ * @warning The recorded stream refers to GL objects by their handles, which must stay valid for
+ *          the lifetime of the recording. Data that is supplied by pointer (e.g. uniform arrays)
+ *          is copied at recording time.
+ *
+ * @see GLStateCache
+ */
+class GLCommandBuffer {
+ public:
+    /**
+     * @brief Opcodes for the recorded commands
+     */
+    enum opcode : uint32_t {
+        ENABLE = 1,
+        DISABLE,
+        BLEND_EQUATION,
+        BLEND_FUNC,
+        VIEWPORT,
+        CLEAR_COLOR,
+        USE_PROGRAM,
+        BIND_VAO,
+        BIND_FBO,
+        ACTIVE_TEXTURE,
+        BIND_TEXTURE,
+        BIND_TEXTURE_SLOT,
+        SCISSOR,
+        CLEAR,
+        CLEAR_BUFFERFV,
+        DRAW_BUFFERS,
+        INVALIDATE_FBO,
+        DRAW_ARRAYS,
+        DRAW_ARRAYS_INSTANCED,
+        DRAW_ELEMENTS,
+        DRAW_ELEMENTS_INSTANCED,
+        DEPTH_FUNC,
+        DEPTH_MASK,
+        STENCIL_FUNC_SEPARATE,
+        STENCIL_OP,
+        STENCIL_MASK,
+        LINE_WIDTH,
+        BIND_BUFFER,
+        BIND_BUFFER_BASE,
+        BIND_BUFFER_RANGE,
+        UNIFORM_1I,
+        UNIFORM_2I,
+        UNIFORM_3I,
+        UNIFORM_4I,
+        UNIFORM_1F,
+        UNIFORM_2F,
+        UNIFORM_3F,
+        UNIFORM_4F,
+        UNIFORM_SLOT,
+        UNIFORM_1FV,
+        UNIFORM_2FV,
+        UNIFORM_3FV,
+        UNIFORM_4FV,
+        UNIFORM_2IV,
+        UNIFORM_4UIV,
+        UNIFORM_MAT3,
+        UNIFORM_MAT4
+    };
+
+    // ------------------------------------------------------------------------
+    // Constructor / Destructor
+    // ------------------------------------------------------------------------
+    GLCommandBuffer() = default;
+    ~GLCommandBuffer();
+
+    // ------------------------------------------------------------------------
+    // Public methods
+    // ------------------------------------------------------------------------
+    void begin();
+    void end();
+    void replay() const;
+    void reset();
+    int addTextureSlot(GLuint texture);
+    int addUniformSlot(GLuint program, GLint location);
+    void setTextureSlot(int slot, GLuint texture);
+    void setUniformSlot(int slot, GLint v0, GLint v1 = 0, GLint v2 = 0, GLint v3 = 0);
+    void setUniformSlot(int slot, GLfloat v0, GLfloat v1 = 0.f, GLfloat v2 = 0.f, GLfloat v3 = 0.f);
+
+    /**
+     * @brief Check if this command buffer does not contain any commands
+     *
+     * @retval true if no commands were recorded
+     * @retval false otherwise
+     */
+    [[nodiscard]] bool empty() const {
+        return (numCommands_ == 0);
+    }
+
+    /**
+     * @brief Retrieve number of recorded commands
+     *
+     * @return Number of GL commands in this buffer
+     */
+    [[nodiscard]] int commands() const {
+        return numCommands_;
+    }
+
+    /**
+     * @brief Retrieve size of the recorded stream
+     *
+     * @return Number of bytes occupied by the recorded stream
+     */
+    [[nodiscard]] size_t bytes() const {
+        return words_.size() * sizeof(uint32_t);
+    }
+
+    /**
+     * @brief Retrieve command buffer that is currently recording on the calling thread
+     *
+     * @return Pointer to command buffer or \c nullptr if no recording is active on the calling thread
+     */
+    static GLCommandBuffer * recorder() {
+        return recorder_;
+    }
+
+    /**
+     * @brief Append a command to the buffer
+     *
+     * @param op Opcode of the command
+     * @param args Arguments of the command, each one is stored as a 32-bit word
+     *
+     * This is used by the GLStateCache to record state changes, use the static wrapper functions
+     * of this class to issue and record other GL commands.
+     */
+    template<typename ...T>
+    void push(opcode op, T... args) {
+        words_.push_back(op);
+        (words_.push_back(word(args)), ...);
+        numCommands_++;
+    }
+
+    void bindTexture(GLenum target, GLuint texture);
+
+    /**
+     * @brief Note a change of the bound shader program
+     *
+     * @param program GL handle of the shader program that was bound
+     */
+    void useProgram(GLuint program) {
+        program_ = program;
+        push(USE_PROGRAM, program);
+    }
+
+    /**
+     * @brief Clear buffers to preset values (see \c glClear)
+     *
+     * @param mask Bitmask of the buffers to clear
+     */
+    static void clear(GLbitfield mask) {
+        glClear(mask);
+        if (recorder_) recorder_->push(CLEAR, mask);
+    }
+
+    /**
+     * @brief Clear individual buffer of the bound framebuffer (see \c glClearBufferfv)
+     *
+     * @param buffer Buffer to clear (\c GL_COLOR for color attachments)
+     * @param drawBuffer Index of the draw buffer to clear
+     * @param value Pointer to four float values to clear the buffer to
+     */
+    static void clearBufferfv(GLenum buffer, GLint drawBuffer, const GLfloat * value) {
+        glClearBufferfv(buffer, drawBuffer, value);
+        if (recorder_) recorder_->push(CLEAR_BUFFERFV, buffer, drawBuffer, value[0], value[1], value[2], value[3]);
+    }
+
+    /**
+     * @brief Set scissor box (see \c glScissor)
+     *
+     * @param x Left corner of the scissor box
+     * @param y Bottom corner of the scissor box
+     * @param width Width of the scissor box
+     * @param height Height of the scissor box
+     */
+    static void scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+        glScissor(x, y, width, height);
+        if (recorder_) recorder_->push(SCISSOR, x, y, width, height);
+    }
+
+    static void drawBuffers(GLsizei count, const GLenum * buffers);
+    static void invalidateFramebuffer(GLenum target, GLsizei count, const GLenum * attachments);
+
+    /**
+     * @brief Render primitives from array data (see \c glDrawArrays)
+     *
+     * @param mode Primitive type
+     * @param first Starting index in the enabled arrays
+     * @param count Number of indices to render
+     */
+    static void drawArrays(GLenum mode, GLint first, GLsizei count) {
+        glDrawArrays(mode, first, count);
+        if (recorder_) recorder_->push(DRAW_ARRAYS, mode, first, count);
+    }
+
+    /**
+     * @brief Render multiple instances of primitives from array data (see \c glDrawArraysInstanced)
+     *
+     * @param mode Primitive type
+     * @param first Starting index in the enabled arrays
+     * @param count Number of indices to render
+     * @param instances Number of instances to render
+     */
+    static void drawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) {
+        glDrawArraysInstanced(mode, first, count, instances);
+        if (recorder_) recorder_->push(DRAW_ARRAYS_INSTANCED, mode, first, count, instances);
+    }
+
+    /**
+     * @brief Render primitives from indexed array data (see \c glDrawElements)
+     *
+     * @param mode Primitive type
+     * @param count Number of elements to render
+     * @param type Data type of the indices
+     * @param offset Offset into the bound index buffer (client-side index arrays are not supported)
+     */
+    static void drawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid * offset) {
+        glDrawElements(mode, count, type, offset);
+        if (recorder_) recorder_->push(DRAW_ELEMENTS, mode, count, type, (uint32_t)(uintptr_t)offset);
+    }
+
+    /**
+     * @brief Render multiple instances of primitives from indexed array data (see \c glDrawElementsInstanced)
+     *
+     * @param mode Primitive type
+     * @param count Number of elements to render
+     * @param type Data type of the indices
+     * @param offset Offset into the bound index buffer (client-side index arrays are not supported)
+     * @param instances Number of instances to render
+     */
+    static void drawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const GLvoid * offset, GLsizei instances) {
+        glDrawElementsInstanced(mode, count, type, offset, instances);
+        if (recorder_) recorder_->push(DRAW_ELEMENTS_INSTANCED, mode, count, type, (uint32_t)(uintptr_t)offset, instances);
+    }
+
+    /**
+     * @brief Set depth comparison function (see \c glDepthFunc)
+     *
+     * @param func Depth comparison function
+     */
+    static void depthFunc(GLenum func) {
+        glDepthFunc(func);
+        if (recorder_) recorder_->push(DEPTH_FUNC, func);
+    }
+
+    /**
+     * @brief Enable or disable writing to the depth buffer (see \c glDepthMask)
+     *
+     * @param flag Depth write flag
+     */
+    static void depthMask(GLboolean flag) {
+        glDepthMask(flag);
+        if (recorder_) recorder_->push(DEPTH_MASK, (uint32_t)flag);
+    }
+
+    /**
+     * @brief Set stencil test function (see \c glStencilFuncSeparate)
+     *
+     * @param face Faces to set the function for
+     * @param func Stencil comparison function
+     * @param ref Reference value
+     * @param mask Mask that is applied to reference and stencil value
+     */
+    static void stencilFuncSeparate(GLenum face, GLenum func, GLint ref, GLuint mask) {
+        glStencilFuncSeparate(face, func, ref, mask);
+        if (recorder_) recorder_->push(STENCIL_FUNC_SEPARATE, face, func, ref, mask);
+    }
+
+    /**
+     * @brief Set stencil test actions (see \c glStencilOp)
+     *
+     * @param sfail Action on failing stencil test
+     * @param dpfail Action on passing stencil test and failing depth test
+     * @param dppass Action on passing stencil and depth test
+     */
+    static void stencilOp(GLenum sfail, GLenum dpfail, GLenum dppass) {
+        glStencilOp(sfail, dpfail, dppass);
+        if (recorder_) recorder_->push(STENCIL_OP, sfail, dpfail, dppass);
+    }
+
+    /**
+     * @brief Set stencil write mask (see \c glStencilMask)
+     *
+     * @param mask Bitmask for writing to the stencil buffer
+     */
+    static void stencilMask(GLuint mask) {
+        glStencilMask(mask);
+        if (recorder_) recorder_->push(STENCIL_MASK, mask);
+    }
+
+    /**
+     * @brief Set width of rasterized lines (see \c glLineWidth)
+     *
+     * @param width Line width
+     */
+    static void lineWidth(GLfloat width) {
+        glLineWidth(width);
+        if (recorder_) recorder_->push(LINE_WIDTH, width);
+    }
+
+    /**
+     * @brief Bind buffer object (see \c glBindBuffer)
+     *
+     * @param target Buffer target
+     * @param buffer GL handle of the buffer to bind, or 0 to unbind
+     */
+    static void bindBuffer(GLenum target, GLuint buffer) {
+        glBindBuffer(target, buffer);
+        if (recorder_) recorder_->push(BIND_BUFFER, target, buffer);
+    }
+
+    /**
+     * @brief Bind buffer object to indexed target (see \c glBindBufferBase)
+     *
+     * @param target Buffer target
+     * @param index Binding index
+     * @param buffer GL handle of the buffer to bind
+     */
+    static void bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+        glBindBufferBase(target, index, buffer);
+        if (recorder_) recorder_->push(BIND_BUFFER_BASE, target, index, buffer);
+    }
+
+    /**
+     * @brief Bind range of buffer object to indexed target (see \c glBindBufferRange)
+     *
+     * @param target Buffer target
+     * @param index Binding index
+     * @param buffer GL handle of the buffer to bind
+     * @param offset Offset into the buffer (bytes)
+     * @param size Size of the range (bytes)
+     */
+    static void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+        glBindBufferRange(target, index, buffer, offset, size);
+        if (recorder_) recorder_->push(BIND_BUFFER_RANGE, target, index, buffer, (uint32_t)offset, (uint32_t)size);
+    }
+
+    /**
+     * @brief Set integer uniform (see \c glUniform1i)
+     *
+     * @param location Uniform location in the bound program
+     * @param v0 Value
+     */
+    static void uniform1i(GLint location, GLint v0) {
+        glUniform1i(location, v0);
+        if (recorder_) recorder_->pushUniform(UNIFORM_1I, location, word(v0));
+    }
+
+    /**
+     * @brief Set integer 2-vector uniform (see \c glUniform2i)
+     *
+     * @param location Uniform location in the bound program
+     * @param v0 ... v1 Values
+     */
+    static void uniform2i(GLint location, GLint v0, GLint v1) {
+        glUniform2i(location, v0, v1);
+        if (recorder_) recorder_->pushUniform(UNIFORM_2I, location, word(v0), word(v1));
+    }
+
+    /**
+     * @brief Set integer 3-vector uniform (see \c glUniform3i)
+     *
+     * @param location Uniform location in the bound program
+     * @param v0 ... v2 Values
+     */
+    static void uniform3i(GLint location, GLint v0, GLint v1, GLint v2) {
+        glUniform3i(location, v0, v1, v2);
+        if (recorder_) recorder_->pushUniform(UNIFORM_3I, location, word(v0), word(v1), word(v2));
+    }
+
+    /**
+     * @brief Set integer 4-vector uniform (see \c glUniform4i)
+     *
+     * @param location Uniform location in the bound program
+     * @param v0 ... v3 Values
+     */
+    static void uniform4i(GLint location, GLint v0, GLint v1, GLint v2, GLint v3) {
+        glUniform4i(location, v0, v1, v2, v3);
+        if (recorder_) recorder_->pushUniform(UNIFORM_4I, location, word(v0), word(v1), word(v2), word(v3));
+    }
+
+    /**
+     * @brief Set float uniform (see \c glUniform1f)
+     *
+     * @param location Uniform location in the bound program
+     * @param v0 Value
+     */
+    static void uniform1f(GLint location, GLfloat v0) {
+        glUniform1f(location, v0);
+        if (recorder_) recorder_->pushUniform(UNIFORM_1F, location, word(v0));
+    }
+
+    /**
+     * @brief Set float 2-vector uniform (see \c glUniform2f)
+     *
+     * @param location Uniform location in the bound program
+     * @param v0 ... v1 Values
+     */
+    static void uniform2f(GLint location, GLfloat v0, GLfloat v1) {
+        glUniform2f(location, v0, v1);
+        if (recorder_) recorder_->pushUniform(UNIFORM_2F, location, word(v0), word(v1));
+    }
+
+    /**
+     * @brief Set float 3-vector uniform (see \c glUniform3f)
+     *
+     * @param location Uniform location in the bound program
+     * @param v0 ... v2 Values
+     */
+    static void uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+        glUniform3f(location, v0, v1, v2);
+        if (recorder_) recorder_->pushUniform(UNIFORM_3F, location, word(v0), word(v1), word(v2));
+    }
+
+    /**
+     * @brief Set float 4-vector uniform (see \c glUniform4f)
+     *
+     * @param location Uniform location in the bound program
+     * @param v0 ... v3 Values
+     */
+    static void uniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {
+        glUniform4f(location, v0, v1, v2, v3);
+        if (recorder_) recorder_->pushUniform(UNIFORM_4F, location, word(v0), word(v1), word(v2), word(v3));
+    }
+
+    static void uniform1fv(GLint location, GLsizei count, const GLfloat * data);
+    static void uniform2fv(GLint location, GLsizei count, const GLfloat * data);
+    static void uniform3fv(GLint location, GLsizei count, const GLfloat * data);
+    static void uniform4fv(GLint location, GLsizei count, const GLfloat * data);
+    static void uniform2iv(GLint location, GLsizei count, const GLint * data);
+    static void uniform4uiv(GLint location, GLsizei count, const GLuint * data);
+    static void uniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat * data);
+    static void uniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat * data);
+
+ private:
+    /**
+     * @brief Descriptor for a texture slot
+     */
+    struct TextureSlot {
+        GLuint recorded = 0;                //!< Texture handle that is replaced by the slot
+        GLuint current = 0;                 //!< Texture handle to be used on replay
+    };
+
+    /**
+     * @brief Descriptor for a uniform slot
+     */
+    struct UniformSlot {
+        GLuint program = 0;                 //!< Shader program that the uniform belongs to
+        GLint location = -1;                //!< Location of the uniform in the program
+        uint32_t values[4] = {0};           //!< Value(s) to be used on replay
+    };
+
+    // ------------------------------------------------------------------------
+    // Non-public methods
+    // ------------------------------------------------------------------------
+    static uint32_t word(uint32_t value) {
+        return value;
+    }
+
+    static uint32_t word(int32_t value) {
+        return (uint32_t)value;
+    }
+
+    static uint32_t word(float value) {
+        uint32_t result;
+        memcpy(&result, &value, sizeof(result));
+        return result;
+    }
+
+    template<typename ...T>
+    void pushUniform(opcode op, GLint location, T... values);
+    void pushArray(opcode op, GLint location, GLsizei count, GLsizei words, const void * data);
+
+    // ------------------------------------------------------------------------
+    // Member variables
+    // ------------------------------------------------------------------------
+    std::vector<uint32_t> words_;               //!< Recorded command stream
+    std::vector<TextureSlot> textureSlots_;     //!< Texture slots
+    std::vector<UniformSlot> uniformSlots_;     //!< Uniform slots
+    int numCommands_ = 0;                       //!< Number of recorded commands
+    GLuint program_ = 0;                        //!< Shader program that is bound at the current recording position
+
+    /**
+     * Command buffer that is recording on the calling thread
+     */
+    static thread_local GLCommandBuffer * recorder_;
+};
+
+
+/**
+ * @brief Append uniform command to the buffer, taking uniform slots into account
+ *
+ * @param op Opcode of the uniform command
+ * @param location Location of the uniform
+ * @param values Value(s) of the uniform as 32-bit words
+ *
+ * In case the uniform was registered as a slot for the currently bound program, a
+ * #UNIFORM_SLOT command is recorded instead and the recorded values are used as initial
+ * values of the slot.
+ */
+template<typename ...T>
+void GLCommandBuffer::pushUniform(opcode op, GLint location, T... values) {
+    for (int i=0; i < (int)uniformSlots_.size(); i++) {
+        UniformSlot & slot = uniformSlots_[i];
+        if ((slot.program == program_) && (slot.location == location)) {
+            uint32_t tmp[] = {values...};
+            for (int j=0; j < (int)sizeof...(values); j++) slot.values[j] = tmp[j];
+            push(UNIFORM_SLOT, (uint32_t)op, location, (uint32_t)i);
+            return;
+        }
+    }
+    push(op, location, values...);
+}
+
+} // fyusion::opengl namespace
+
+// vim: set expandtab ts=4 sw=4:
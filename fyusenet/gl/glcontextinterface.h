@@ -13,6 +13,10 @@
 #include <cassert>
 #include <atomic>
 
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "glstatecache.h"
+
 //------------------------------------- Public Declarations ----------------------------------------
 namespace fyusion {
 
@@ -221,8 +225,21 @@ class GLContextInterface {
      * @param alpha Alpha component to clear framebuffer to
      */
     void clear(float red=0.0f, float green=0.0f, float blue=0.0f, float alpha=0.0f) {
-        glClearColor(red, green, blue, alpha);
-        glClear(GL_COLOR_BUFFER_BIT);
+        GLStateCache::clearColor(red, green, blue, alpha);
+        GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
+    }
+
+
+    /**
+     * @brief Get GL state cache of this context
+     *
+     * @return Reference to state cache, which is attached to the calling thread while this
+     *         context is current to it
+     *
+     * @see GLStateCache
+     */
+    GLStateCache & stateCache() const {
+        return stateCache_;
     }
 
 
@@ -263,6 +280,7 @@ class GLContextInterface {
     int index_ = 0;                     //!< Index of this context in a globally managed context list (see GfxContextManager)
     int derivedIdx_ = -1;               //!< For derived (=shared) contexts, the index of the context within a derived list
     int deviceID_ = 0;                  //!< Device ID (e.g. GPU index) that this context runs on
+    mutable GLStateCache stateCache_;   //!< Shadow copy of the GL state, attached to the thread this context is current to
 };
 
 } // opengl namespace
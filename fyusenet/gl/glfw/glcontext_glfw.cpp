@@ -86,6 +86,7 @@ bool GLContext::isCurrent() const {
  */
 bool GLContext::makeCurrent() const {
     glfwMakeContextCurrent(context_);
+    stateCache_.attach();
     return true;
 }
 
@@ -95,6 +96,7 @@ bool GLContext::makeCurrent() const {
  */
 bool GLContext::releaseCurrent() const {
     if (isCurrent()) {
+        stateCache_.detach();
         glfwMakeContextCurrent(nullptr);
         return true;
     } else return false;
@@ -0,0 +1,192 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// GL State Cache
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "glstatecache.h"
+
+namespace fyusion::opengl {
+
+//-------------------------------------- Global Variables ------------------------------------------
+
+thread_local GLStateCache * GLStateCache::current_ = nullptr;
+std::atomic<uint32_t> GLStateCache::DELETE_EPOCH{0};
+
+/*##################################################################################################
+#                                   P U B L I C  F U N C T I O N S                                 #
+##################################################################################################*/
+
+/**
+ * @brief Constructor
+ *
+ * Creates a state cache where all tracked state is unknown.
+ */
+GLStateCache::GLStateCache() {
+    reset();
+}
+
+
+/**
+ * @brief Destructor
+ *
+ * Detaches the state cache from the calling thread in case it is still attached.
+ */
+GLStateCache::~GLStateCache() {
+    detach();
+}
+
+
+/**
+ * @brief Attach state cache to the calling thread
+ *
+ * This function is to be called whenever the context that owns this state cache is made current
+ * to the calling thread. It marks all tracked state as unknown, because the state may have been
+ * changed on a different thread or by code that does not use the state cache.
+ */
+void GLStateCache::attach() {
+    reset();
+    current_ = this;
+}
+
+
+/**
+ * @brief Detach state cache from the calling thread
+ *
+ * This function is to be called when the context that owns this state cache is released from
+ * the calling thread. It is a no-op if this state cache is not attached to the calling thread.
+ */
+void GLStateCache::detach() {
+    if (current_ == this) current_ = nullptr;
+}
+
+
+/**
+ * @brief Mark all tracked state as unknown
+ *
+ * The counters are not affected by this function.
+ */
+void GLStateCache::reset() {
+    for (int i=0; i < NUM_CAPS; i++) caps_[i] = 0;
+    for (int i=0; i < 2; i++) blendEq_[i] = UNKNOWN;
+    for (int i=0; i < 4; i++) blendFunc_[i] = UNKNOWN;
+    viewport_[2] = -1;
+    viewport_[3] = -1;
+    clearValid_ = false;
+    vao_ = UNKNOWN;
+    drawFBO_ = UNKNOWN;
+    readFBO_ = UNKNOWN;
+    activeUnit_ = UNKNOWN;
+    epoch_ = DELETE_EPOCH.load(std::memory_order_relaxed);
+    forgetShared();
+}
+
+
+/**
+ * @brief Mark tracked state of the state cache attached to the calling thread as unknown
+ *
+ * Use this function after changing any of the tracked state items directly via GL calls.
+ */
+void GLStateCache::invalidate() {
+    if (current_) current_->reset();
+}
+
+
+/**
+ * @brief Retrieve counters of the state cache attached to the calling thread
+ *
+ * @return Copy of the counters, all zero if no state cache is attached to the calling thread
+ */
+GLStateCache::statistics GLStateCache::getStatistics() {
+    return (current_) ? current_->stats_ : statistics();
+}
+
+
+/**
+ * @brief Delete textures (see \c glDeleteTextures)
+ *
+ * @param count Number of textures to delete
+ * @param textures Pointer to GL handles of the textures to delete
+ *
+ * As textures are shared between contexts, the texture bindings of all state caches are
+ * invalidated.
+ */
+void GLStateCache::deleteTextures(GLsizei count, const GLuint * textures) {
+    glDeleteTextures(count, textures);
+    DELETE_EPOCH.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+/**
+ * @brief Delete shader program (see \c glDeleteProgram)
+ *
+ * @param program GL handle of the program to delete
+ *
+ * As programs are shared between contexts, the program bindings of all state caches are
+ * invalidated.
+ */
+void GLStateCache::deleteProgram(GLuint program) {
+    glDeleteProgram(program);
+    DELETE_EPOCH.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+/**
+ * @brief Delete framebuffer objects (see \c glDeleteFramebuffers)
+ *
+ * @param count Number of framebuffers to delete
+ * @param fbos Pointer to GL handles of the framebuffers to delete
+ *
+ * Framebuffers are not shared between contexts, only the state cache that is attached to the
+ * calling thread is updated.
+ */
+void GLStateCache::deleteFramebuffers(GLsizei count, const GLuint * fbos) {
+    glDeleteFramebuffers(count, fbos);
+    GLStateCache * cache = current_;
+    if (!cache) return;
+    for (GLsizei i=0; i < count; i++) {
+        if (cache->drawFBO_ == fbos[i]) cache->drawFBO_ = UNKNOWN;
+        if (cache->readFBO_ == fbos[i]) cache->readFBO_ = UNKNOWN;
+    }
+}
+
+
+/**
+ * @brief Delete vertex array objects (see \c glDeleteVertexArrays)
+ *
+ * @param count Number of VAOs to delete
+ * @param vaos Pointer to GL handles of the VAOs to delete
+ *
+ * VAOs are not shared between contexts, only the state cache that is attached to the calling
+ * thread is updated.
+ */
+void GLStateCache::deleteVertexArrays(GLsizei count, const GLuint * vaos) {
+    glDeleteVertexArrays(count, vaos);
+    GLStateCache * cache = current_;
+    if (!cache) return;
+    for (GLsizei i=0; i < count; i++) {
+        if (cache->vao_ == vaos[i]) cache->vao_ = UNKNOWN;
+    }
+}
+
+/*##################################################################################################
+#                               N O N -  P U B L I C  F U N C T I O N S                            #
+##################################################################################################*/
+
+/**
+ * @brief Mark bindings of shared objects (textures, programs) as unknown
+ */
+void GLStateCache::forgetShared() {
+    program_ = UNKNOWN;
+    for (GLuint i=0; i < MAX_UNITS; i++) textures_[i] = UNKNOWN;
+}
+
+} // fyusion::opengl namespace
+
+// vim: set expandtab ts=4 sw=4:
@@ -0,0 +1,469 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// GL State Cache (Header)
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <cstdint>
+#include <atomic>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "gl_sys.h"
+#include "glcommandbuffer.h"
+
+//------------------------------------- Public Declarations ----------------------------------------
+
+namespace fyusion::opengl {
+
+/**
+ * @brief Per-context tracker for GL state that elides redundant state changes
+ *
+ * This class keeps a shadow copy of the parts of the GL state that are changed over and over
+ * again by the network layers, namely:
+ *   - the enable state of blending, depth-, stencil- and scissor-test as well as face culling
+ *   - blend equation and blend function
+ *   - viewport and clear color
+ *   - the bound shader program, vertex array object and framebuffers
+ *   - the 2D texture bindings of the texture units and the active texture unit
+ *
+ * Each GL context owns one instance of this class, which is attached to the calling thread when
+ * the context is made current (and detached when the context is released). All state changes
+ * for the items above should be done through the static functions of this class, which mirror
+ * the signatures of the respective GL functions. These functions compare the requested state with
+ * the shadow copy of the context that is current to the calling thread and only issue the GL call
+ * if the state actually changes. If no state cache is attached to the calling thread, the calls
+ * are passed through to GL unconditionally.
+ *
+ * The shadow copy is invalidated whenever a context is made current, such that state changes that
+ * were done on the same context by other means do not lead to wrong results. Deleting textures or
+ * shader programs (which are shared between contexts) invalidates the respective bindings in
+ * \e all contexts, as the GL may re-use the names of deleted objects.
+ *
+ * State changes that are actually issued are also recorded into the GLCommandBuffer that is
+ * recording on the calling thread (if any).
+ *
+ * @warning Code that changes any of the tracked state items directly via GL calls (and not via
+ *          this class) must call invalidate() afterwards.
+ *
+ * @see GLContextInterface
+ */
+class GLStateCache {
+ public:
+    /**
+     * @brief Counters for issued and elided state changes
+     */
+    struct statistics {
+        uint64_t issued = 0;                    //!< Number of state changes that were passed to GL
+        uint64_t elided = 0;                    //!< Number of state changes that were skipped as redundant
+    };
+
+    // ------------------------------------------------------------------------
+    // Constructor / Destructor
+    // ------------------------------------------------------------------------
+    GLStateCache();
+    ~GLStateCache();
+
+    // ------------------------------------------------------------------------
+    // Public methods
+    // ------------------------------------------------------------------------
+    void attach();
+    void detach();
+    void reset();
+
+    /**
+     * @brief Retrieve counters of the state cache
+     *
+     * @return Copy of the counters
+     */
+    [[nodiscard]] statistics counters() const {
+        return stats_;
+    }
+
+    /**
+     * @brief Retrieve state cache that is attached to the calling thread
+     *
+     * @return Pointer to state cache or \c nullptr if no context with a state cache is current
+     *         to the calling thread
+     */
+    static GLStateCache * current() {
+        return current_;
+    }
+
+    static void invalidate();
+    static statistics getStatistics();
+
+    /**
+     * @brief Enable GL capability (see \c glEnable)
+     *
+     * @param cap Capability to enable
+     */
+    static void enable(GLenum cap) {
+        GLStateCache * cache = current_;
+        if (cache) cache->setCapability(cap, true);
+        else {
+            glEnable(cap);
+            if (GLCommandBuffer * rec = GLCommandBuffer::recorder()) rec->push(GLCommandBuffer::ENABLE, cap);
+        }
+    }
+
+    /**
+     * @brief Disable GL capability (see \c glDisable)
+     *
+     * @param cap Capability to disable
+     */
+    static void disable(GLenum cap) {
+        GLStateCache * cache = current_;
+        if (cache) cache->setCapability(cap, false);
+        else {
+            glDisable(cap);
+            if (GLCommandBuffer * rec = GLCommandBuffer::recorder()) rec->push(GLCommandBuffer::DISABLE, cap);
+        }
+    }
+
+    /**
+     * @brief Set blend equation for RGB and alpha (see \c glBlendEquation)
+     *
+     * @param mode Blend equation
+     */
+    static void blendEquation(GLenum mode) {
+        blendEquationSeparate(mode, mode);
+    }
+
+    /**
+     * @brief Set blend equations (see \c glBlendEquationSeparate)
+     *
+     * @param modeRGB Blend equation for the RGB components
+     * @param modeAlpha Blend equation for the alpha component
+     */
+    static void blendEquationSeparate(GLenum modeRGB, GLenum modeAlpha) {
+        GLStateCache * cache = current_;
+        if ((cache) && (cache->blendEq_[0] == modeRGB) && (cache->blendEq_[1] == modeAlpha)) {
+            cache->stats_.elided++;
+            return;
+        }
+        glBlendEquationSeparate(modeRGB, modeAlpha);
+        if (GLCommandBuffer * rec = GLCommandBuffer::recorder()) rec->push(GLCommandBuffer::BLEND_EQUATION, modeRGB, modeAlpha);
+        if (cache) {
+            cache->blendEq_[0] = modeRGB;
+            cache->blendEq_[1] = modeAlpha;
+            cache->stats_.issued++;
+        }
+    }
+
+    /**
+     * @brief Set blend function for RGB and alpha (see \c glBlendFunc)
+     *
+     * @param sfactor Source factor
+     * @param dfactor Destination factor
+     */
+    static void blendFunc(GLenum sfactor, GLenum dfactor) {
+        blendFuncSeparate(sfactor, dfactor, sfactor, dfactor);
+    }
+
+    /**
+     * @brief Set blend functions (see \c glBlendFuncSeparate)
+     *
+     * @param srcRGB Source factor for the RGB components
+     * @param dstRGB Destination factor for the RGB components
+     * @param srcAlpha Source factor for the alpha component
+     * @param dstAlpha Destination factor for the alpha component
+     */
+    static void blendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha) {
+        GLStateCache * cache = current_;
+        if ((cache) && (cache->blendFunc_[0] == srcRGB) && (cache->blendFunc_[1] == dstRGB) &&
+            (cache->blendFunc_[2] == srcAlpha) && (cache->blendFunc_[3] == dstAlpha)) {
+            cache->stats_.elided++;
+            return;
+        }
+        glBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+        if (GLCommandBuffer * rec = GLCommandBuffer::recorder()) rec->push(GLCommandBuffer::BLEND_FUNC, srcRGB, dstRGB, srcAlpha, dstAlpha);
+        if (cache) {
+            cache->blendFunc_[0] = srcRGB;
+            cache->blendFunc_[1] = dstRGB;
+            cache->blendFunc_[2] = srcAlpha;
+            cache->blendFunc_[3] = dstAlpha;
+            cache->stats_.issued++;
+        }
+    }
+
+    /**
+     * @brief Set viewport (see \c glViewport)
+     *
+     * @param x Left corner of the viewport
+     * @param y Bottom corner of the viewport
+     * @param width Width of the viewport
+     * @param height Height of the viewport
+     */
+    static void viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+        GLStateCache * cache = current_;
+        if ((cache) && (cache->viewport_[0] == x) && (cache->viewport_[1] == y) &&
+            (cache->viewport_[2] == width) && (cache->viewport_[3] == height)) {
+            cache->stats_.elided++;
+            return;
+        }
+        glViewport(x, y, width, height);
+        if (GLCommandBuffer * rec = GLCommandBuffer::recorder()) rec->push(GLCommandBuffer::VIEWPORT, x, y, width, height);
+        if (cache) {
+            cache->viewport_[0] = x;
+            cache->viewport_[1] = y;
+            cache->viewport_[2] = width;
+            cache->viewport_[3] = height;
+            cache->stats_.issued++;
+        }
+    }
+
+    /**
+     * @brief Set clear color (see \c glClearColor)
+     *
+     * @param red Red component
+     * @param green Green component
+     * @param blue Blue component
+     * @param alpha Alpha component
+     */
+    static void clearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+        GLStateCache * cache = current_;
+        if ((cache) && (cache->clearValid_) && (cache->clearColor_[0] == red) && (cache->clearColor_[1] == green) &&
+            (cache->clearColor_[2] == blue) && (cache->clearColor_[3] == alpha)) {
+            cache->stats_.elided++;
+            return;
+        }
+        glClearColor(red, green, blue, alpha);
+        if (GLCommandBuffer * rec = GLCommandBuffer::recorder()) rec->push(GLCommandBuffer::CLEAR_COLOR, red, green, blue, alpha);
+        if (cache) {
+            cache->clearColor_[0] = red;
+            cache->clearColor_[1] = green;
+            cache->clearColor_[2] = blue;
+            cache->clearColor_[3] = alpha;
+            cache->clearValid_ = true;
+            cache->stats_.issued++;
+        }
+    }
+
+    /**
+     * @brief Bind shader program (see \c glUseProgram)
+     *
+     * @param program GL handle of the program to bind, or 0 to unbind
+     */
+    static void useProgram(GLuint program) {
+        GLStateCache * cache = current_;
+        if (cache) {
+            cache->checkEpoch();
+            if (cache->program_ == program) {
+                cache->stats_.elided++;
+                return;
+            }
+            cache->program_ = program;
+            cache->stats_.issued++;
+        }
+        glUseProgram(program);
+        if (GLCommandBuffer * rec = GLCommandBuffer::recorder()) rec->useProgram(program);
+    }
+
+    /**
+     * @brief Bind vertex array object (see \c glBindVertexArray)
+     *
+     * @param vao GL handle of the VAO to bind, or 0 to unbind
+     */
+    static void bindVertexArray(GLuint vao) {
+        GLStateCache * cache = current_;
+        if (cache) {
+            if (cache->vao_ == vao) {
+                cache->stats_.elided++;
+                return;
+            }
+            cache->vao_ = vao;
+            cache->stats_.issued++;
+        }
+        glBindVertexArray(vao);
+        if (GLCommandBuffer * rec = GLCommandBuffer::recorder()) rec->push(GLCommandBuffer::BIND_VAO, vao);
+    }
+
+    /**
+     * @brief Bind framebuffer object (see \c glBindFramebuffer)
+     *
+     * @param target Framebuffer target (\c GL_FRAMEBUFFER, \c GL_DRAW_FRAMEBUFFER or \c GL_READ_FRAMEBUFFER)
+     * @param fbo GL handle of the framebuffer to bind, or 0 to bind the default framebuffer
+     */
+    static void bindFramebuffer(GLenum target, GLuint fbo) {
+        GLStateCache * cache = current_;
+        if (cache) {
+            bool draw = (target == GL_FRAMEBUFFER) || (target == GL_DRAW_FRAMEBUFFER);
+            bool read = (target == GL_FRAMEBUFFER) || (target == GL_READ_FRAMEBUFFER);
+            if (((!draw) || (cache->drawFBO_ == fbo)) && ((!read) || (cache->readFBO_ == fbo))) {
+                cache->stats_.elided++;
+                return;
+            }
+            if (draw) cache->drawFBO_ = fbo;
+            if (read) cache->readFBO_ = fbo;
+            cache->stats_.issued++;
+        }
+        glBindFramebuffer(target, fbo);
+        if (GLCommandBuffer * rec = GLCommandBuffer::recorder()) rec->push(GLCommandBuffer::BIND_FBO, target, fbo);
+    }
+
+    /**
+     * @brief Select active texture unit (see \c glActiveTexture)
+     *
+     * @param unit Texture unit to activate (\c GL_TEXTURE0 + n)
+     */
+    static void activeTexture(GLenum unit) {
+        GLStateCache * cache = current_;
+        if (cache) {
+            if (cache->activeUnit_ == unit) {
+                cache->stats_.elided++;
+                return;
+            }
+            cache->activeUnit_ = unit;
+            cache->stats_.issued++;
+        }
+        glActiveTexture(unit);
+        if (GLCommandBuffer * rec = GLCommandBuffer::recorder()) rec->push(GLCommandBuffer::ACTIVE_TEXTURE, unit);
+    }
+
+    /**
+     * @brief Bind texture to the active texture unit (see \c glBindTexture)
+     *
+     * @param target Texture target, only \c GL_TEXTURE_2D bindings are tracked
+     * @param texture GL handle of the texture to bind, or 0 to unbind
+     */
+    static void bindTexture(GLenum target, GLuint texture) {
+        GLStateCache * cache = current_;
+        if ((cache) && (target == GL_TEXTURE_2D)) {
+            cache->checkEpoch();
+            GLuint unit = cache->activeUnit_ - GL_TEXTURE0;
+            if (unit < MAX_UNITS) {
+                if (cache->textures_[unit] == texture) {
+                    cache->stats_.elided++;
+                    return;
+                }
+                cache->textures_[unit] = texture;
+            }
+        }
+        if (cache) cache->stats_.issued++;
+        glBindTexture(target, texture);
+        if (GLCommandBuffer * rec = GLCommandBuffer::recorder()) rec->bindTexture(target, texture);
+    }
+
+    static void deleteTextures(GLsizei count, const GLuint * textures);
+    static void deleteProgram(GLuint program);
+    static void deleteFramebuffers(GLsizei count, const GLuint * fbos);
+    static void deleteVertexArrays(GLsizei count, const GLuint * vaos);
+
+ private:
+    /**
+     * Sentinel for unknown state
+     */
+    constexpr static GLuint UNKNOWN = 0xFFFFFFFF;
+
+    /**
+     * Number of texture units with tracked bindings
+     */
+    constexpr static GLuint MAX_UNITS = 32;
+
+    /**
+     * Number of tracked capabilities
+     */
+    constexpr static int NUM_CAPS = 5;
+
+    // ------------------------------------------------------------------------
+    // Non-public methods
+    // ------------------------------------------------------------------------
+
+    /**
+     * @brief Map GL capability to index in #caps_
+     *
+     * @param cap GL capability
+     *
+     * @return Index in #caps_ or -1 if the capability is not tracked
+     */
+    static int capIndex(GLenum cap) {
+        switch (cap) {
+            case GL_BLEND:
+                return 0;
+            case GL_DEPTH_TEST:
+                return 1;
+            case GL_STENCIL_TEST:
+                return 2;
+            case GL_CULL_FACE:
+                return 3;
+            case GL_SCISSOR_TEST:
+                return 4;
+            default:
+                return -1;
+        }
+    }
+
+    /**
+     * @brief Set enable state of a capability
+     *
+     * @param cap GL capability
+     * @param on Enable state of the capability
+     */
+    void setCapability(GLenum cap, bool on) {
+        int idx = capIndex(cap);
+        uint8_t val = (on) ? 2 : 1;
+        if (idx >= 0) {
+            if (caps_[idx] == val) {
+                stats_.elided++;
+                return;
+            }
+            caps_[idx] = val;
+        }
+        stats_.issued++;
+        if (on) glEnable(cap);
+        else glDisable(cap);
+        if (GLCommandBuffer * rec = GLCommandBuffer::recorder()) rec->push((on) ? GLCommandBuffer::ENABLE : GLCommandBuffer::DISABLE, cap);
+    }
+
+    /**
+     * @brief Forget texture and program bindings if shared objects have been deleted meanwhile
+     */
+    void checkEpoch() {
+        uint32_t epoch = DELETE_EPOCH.load(std::memory_order_relaxed);
+        if (epoch != epoch_) {
+            epoch_ = epoch;
+            forgetShared();
+        }
+    }
+
+    void forgetShared();
+
+    // ------------------------------------------------------------------------
+    // Member variables
+    // ------------------------------------------------------------------------
+    uint8_t caps_[NUM_CAPS] = {0};              //!< Enable state of the tracked capabilities (0: unknown, 1: disabled, 2: enabled)
+    GLenum blendEq_[2] = {UNKNOWN, UNKNOWN};    //!< Blend equations (RGB, alpha)
+    GLenum blendFunc_[4] = {UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN};  //!< Blend functions (src RGB, dst RGB, src alpha, dst alpha)
+    GLint viewport_[4] = {0, 0, -1, -1};        //!< Viewport (x, y, width, height), negative size for unknown
+    GLfloat clearColor_[4] = {0.f, 0.f, 0.f, 0.f};  //!< Clear color
+    bool clearValid_ = false;                   //!< Indicator if #clearColor_ is known
+    GLuint program_ = UNKNOWN;                  //!< Bound shader program
+    GLuint vao_ = UNKNOWN;                      //!< Bound vertex array object
+    GLuint drawFBO_ = UNKNOWN;                  //!< Bound draw framebuffer
+    GLuint readFBO_ = UNKNOWN;                  //!< Bound read framebuffer
+    GLenum activeUnit_ = UNKNOWN;               //!< Active texture unit
+    GLuint textures_[MAX_UNITS];                //!< 2D texture bindings per texture unit
+    uint32_t epoch_ = 0;                        //!< Value of #DELETE_EPOCH that the bindings refer to
+    statistics stats_;                          //!< Counters for issued and elided state changes
+
+    /**
+     * State cache that is attached to the calling thread
+     */
+    static thread_local GLStateCache * current_;
+
+    /**
+     * Global counter that is increased whenever shared objects (textures, programs) are deleted
+     */
+    static std::atomic<uint32_t> DELETE_EPOCH;
+};
+
+} // fyusion::opengl namespace
+
+// vim: set expandtab ts=4 sw=4:
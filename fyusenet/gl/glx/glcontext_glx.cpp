@@ -143,7 +143,9 @@ void GLContext::init() {
  * @copydoc GLContextInterface::makeCurrent()
  */
 bool GLContext::makeCurrent() const {
-    return glXMakeContextCurrentARB(displayPtr_,DefaultRootWindow(displayPtr_),DefaultRootWindow(displayPtr_),context_);
+    if (!glXMakeContextCurrentARB(displayPtr_,DefaultRootWindow(displayPtr_),DefaultRootWindow(displayPtr_),context_)) return false;
+    stateCache_.attach();
+    return true;
 }
 
 
@@ -152,6 +154,7 @@ bool GLContext::makeCurrent() const {
  */
 bool GLContext::releaseCurrent() const {
     if (isCurrent()) {
+        stateCache_.detach();
         return glXMakeContextCurrentARB(displayPtr_, None, None, nullptr);
     } else return false;
 }
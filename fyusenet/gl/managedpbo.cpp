@@ -87,8 +87,9 @@ ManagedPBO::~ManagedPBO() {
  *
  * @return Reference to current object after assignment
  *
- * @post Reference counter of previously wrapped PBO will be decremented, reference counter of
- *       assigned PBO will be incremented.
+ * @post Reference counter of previously wrapped PBO will be decremented (and the %PBO released
+ *       back into its pool if this was the last reference), reference counter of assigned PBO
+ *       will be incremented.
  *
  * This function copies al data from the supplied \p src to the current object before returning
  * a reference to itself.
@@ -96,13 +97,18 @@ ManagedPBO::~ManagedPBO() {
 ManagedPBO & ManagedPBO::operator=(const ManagedPBO & src) {
     if (this == &src) return *this;
     auto oldref = refcount_;
+    PBOPool * oldpool = pool_;
+    PBO * oldpbo = pbo_;
     pool_ = src.pool_;
     pbo_ = src.pbo_;
     pboIndex_ = src.pboIndex_;
     refcount_ = src.refcount_;
     pending_ = src.pending_;
     if (refcount_) refcount_->fetch_add(1);
-    if (oldref) oldref->fetch_sub(1);
+    if (oldref) {
+        // release the previously wrapped PBO back into the pool if this was the last reference
+        if ((oldref->fetch_sub(1) == 1) && (oldpool) && (oldpbo)) oldpool->releasePBO(oldpbo);
+    }
     return *this;
 }
 
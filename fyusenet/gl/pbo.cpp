@@ -17,13 +17,24 @@
 #include "pbo.h"
 #include "pbopool.h"
 #include "glexception.h"
+#include "glinfo.h"
 #include "../common/miscdefs.h"
 
 //-------------------------------------- Global Variables ------------------------------------------
 
+#ifdef FYUSENET_USE_EGL
+// GLES only offers immutable buffer storage via the GL_EXT_buffer_storage extension
+static PFNGLBUFFERSTORAGEEXTPROC glBufferStorageEXT_ = nullptr;
+#endif
 
 //-------------------------------------- Local Definitions -----------------------------------------
 
+#ifdef FYUSENET_USE_EGL
+#define PERSISTENT_WRITE_FLAGS (GL_MAP_WRITE_BIT|GL_MAP_PERSISTENT_BIT_EXT|GL_MAP_COHERENT_BIT_EXT)
+#else
+#define PERSISTENT_WRITE_FLAGS (GL_MAP_WRITE_BIT|GL_MAP_PERSISTENT_BIT|GL_MAP_COHERENT_BIT)
+#endif
+
 namespace fyusion::opengl {
 
 
@@ -213,6 +224,48 @@ void PBO::prepareForWrite(size_t dataSize, bool leaveBound) {
 
 
 
+/**
+ * @brief Setup %PBO for persistent write operation (upload to GPU)
+ *
+ * @param dataSize Number of bytes to allocate for the %PBO
+ *
+ * This function allocates immutable storage for the %PBO which can be mapped into CPU memory on
+ * a permanent/persistent and coherent basis. Data written to the mapped memory is visible to the
+ * GL without explicit flushing, however it is the responsibility of the caller to not overwrite
+ * data that is still used by the GL (e.g. by using fences). To perform the actual mapping (after
+ * this preparatory step) use the mapPersistentWriteBuffer() function.
+ *
+ * @note As the storage is immutable, the %PBO cannot be resized after calling this function
+ *
+ * @see supportsPersistentMapping()
+ * @see https://www.khronos.org/opengl/wiki/Buffer_Object#Persistent_mapping
+ */
+void PBO::prepareForPersistentWrite(size_t dataSize) {
+#if defined(__APPLE__) || defined(FYUSENET_USE_WEBGL)
+    THROW_EXCEPTION_ARGS(GLNotImplException, "Persistent buffers are not implemented on this platform");
+#else
+    if (bufferInit_) THROW_EXCEPTION_ARGS(GLException, "Cannot re-allocate persistent buffer %d", handle_);
+#ifdef FYUSENET_USE_EGL
+    if (!glBufferStorageEXT_) THROW_EXCEPTION_ARGS(GLNotImplException, "Persistent buffers require GL_EXT_buffer_storage");
+#endif
+    bind(GL_PIXEL_UNPACK_BUFFER);
+    CLEAR_GFXERR_DEBUG
+#ifdef FYUSENET_USE_EGL
+    glBufferStorageEXT_(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)dataSize, nullptr, PERSISTENT_WRITE_FLAGS);
+#else
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)dataSize, nullptr, PERSISTENT_WRITE_FLAGS);  // OpenGL 4.4+
+#endif
+#ifdef DEBUG
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR) THROW_EXCEPTION_ARGS(GLException,"Cannot set buffer storage for buffer %d target 0x%X (glerr=0x%X)",handle_,target_,err);
+#endif
+    unbind(GL_PIXEL_UNPACK_BUFFER);
+    bufferInit_ = true;
+    capacity_ = dataSize;
+#endif
+}
+
+
 /**
  * @brief Map %PBO as write target (upload to GPU)
  *
@@ -248,6 +301,60 @@ void * PBO::mapWriteBuffer(size_t dataSize, size_t offset, bool sync) {
 #endif
 }
 
+/**
+ * @brief Map write-only memory of %PBO to CPU memory persistently
+ *
+ * @return Pointer to mapped memory, stays valid (also across threads) until the %PBO is deleted
+ *
+ * @pre prepareForPersistentWrite() has been called on this %PBO
+ *
+ * This function maps the %PBO (coherently) into the processes virtual memory on a permanent basis.
+ * Note that the API user is responsible for making sure that the GL is done reading from the
+ * buffer before overwriting its contents, for example by using fences.
+ *
+ * @see https://www.khronos.org/opengl/wiki/Buffer_Object#Persistent_mapping
+ */
+void * PBO::mapPersistentWriteBuffer() {
+#if defined(__APPLE__) || defined(FYUSENET_USE_WEBGL)
+    THROW_EXCEPTION_ARGS(GLNotImplException, "Persistent buffers are not implemented on this platform");
+#else
+    assert(bufferInit_);
+    if (!persistent_) {
+        bind(GL_PIXEL_UNPACK_BUFFER);
+        mapped_ = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)capacity_, PERSISTENT_WRITE_FLAGS);
+        unbind(GL_PIXEL_UNPACK_BUFFER);
+        if (!mapped_) THROW_EXCEPTION_ARGS(GLException, "Cannot map persistent buffer %d", handle_);
+        persistent_ = true;
+    }
+    return mapped_;
+#endif
+}
+
+
+/**
+ * @brief Check if persistently mapped buffers are supported by the current GL context
+ *
+ * @retval true if persistent mapping is supported
+ * @retval false otherwise
+ *
+ * Persistent mapping requires OpenGL 4.4 (or the \c GL_ARB_buffer_storage extension) on desktop
+ * GL and the \c GL_EXT_buffer_storage extension on GLES (EGL builds). It is not available on
+ * WebGL and macOS builds.
+ */
+bool PBO::supportsPersistentMapping() {
+#if defined(__APPLE__) || defined(FYUSENET_USE_WEBGL)
+    return false;
+#elif defined(FYUSENET_USE_EGL)
+    if (!GLInfo::hasExtension("GL_EXT_buffer_storage")) return false;
+    if (!glBufferStorageEXT_) glBufferStorageEXT_ = (PFNGLBUFFERSTORAGEEXTPROC)eglGetProcAddress("glBufferStorageEXT");
+    return (glBufferStorageEXT_ != nullptr);
+#else
+    if (GLInfo::isGLES()) return false;
+    return (GLInfo::getVersion() >= GLInfo::GL_4_4) || GLInfo::hasExtension("GL_ARB_buffer_storage");
+#endif
+}
+
+
 /**
  * @brief Map read-only memory of %PBO to CPU memory persistently
  *
@@ -58,14 +58,18 @@ class PBO : public GLBuffer {
     void * mapReadBuffer(size_t dataSize, size_t offset=0);
     void * mapReadBuffer();
     void * mapWriteBuffer(size_t dataSize, size_t offset=0, bool sync=true);
+    void * mapPersistentWriteBuffer();
     void unmapReadBuffer();
     void unmapWriteBuffer();
     void prepareForPersistentRead(size_t dataSize);
     void prepareForRead(size_t dataSize, bool leaveBound=false);
     void prepareForWrite(size_t dataSize, bool leaveBound=false);
+    void prepareForPersistentWrite(size_t dataSize);
     void resize(int width, int height, int channels, int bytesPerChan);
 
 
+    static bool supportsPersistentMapping();
+
     [[nodiscard]] bool matches(int width, int height, int channels, int bytesPerChannel) const {
         size_t size = width * height * channels * bytesPerChannel;
         return (size <= capacity_);
@@ -1,15 +1,15 @@
 //--------------------------------------------------------------------------------------------------
 // FyuseNet                                                               (c) Fyusion Inc. 2016-2022
 //--------------------------------------------------------------------------------------------------
-// Simple PBO Pool
+// Size-Class PBO Pool
 // Creator: Martin Wawro
 // SPDX-License-Identifier: MIT
 //--------------------------------------------------------------------------------------------------
 
 //--------------------------------------- System Headers -------------------------------------------
 
-#include <thread>
 #include <cinttypes>
+#include <algorithm>
 
 //-------------------------------------- Project  Headers ------------------------------------------
 
@@ -54,6 +54,8 @@ PBOPool::~PBOPool() {
         delete ent.pbo;
     }
     availablePBOs_.clear();
+    entries_.clear();
+    for (auto & list : freePBOs_) list.clear();
 }
 
 
@@ -70,48 +72,135 @@ PBOPool::~PBOPool() {
  * Retrieve a %PBO for use with either reading or writing. The returned objects are not low-level
  * PBO instances, but ManagedPBO instances that offer full access to the underlying PBO but add
  * transparent management structures to the %PBO to make it easier for this pool to track its
- * resources.
+ * resources. See the class description for the order in which PBOs are handed out. In case no
+ * %PBO can be handed out, this function blocks until a %PBO is released back to the pool.
  *
  * @note The number of \p channels may exceed the maximum number of channels per pixel (4), because
  *       the %PBO here is just treated as a buffer.
  */
  // TODO (mw) switch from geometry (width, height) to pure size instead
 ManagedPBO PBOPool::getAvailablePBO(int width, int height, int channels, int bytesPerChannel) {
-    using namespace std::chrono_literals;
-    bool immediate = true;
+    int sclass = sizeClass(width, height, channels, bytesPerChannel);
+    std::unique_lock<std::mutex> lck(lock_);
+    stats_.requests++;
+    entry * ent = nullptr;
+    tstamp start = 0;
     while (true) {
-        lock_.lock();
-        if (immediate) requests_++;
-        int idx=0;
-        for (int pass=0; pass < 2; pass++) {
-            for (auto ii = availablePBOs_.begin() ; ii != availablePBOs_.end(); ++ii,idx++) {
-                if (!(*ii).busy) {
-                    PBO * pbo = (*ii).pbo;
-                    if ( pbo->matches(width, height, channels, bytesPerChannel) || (pass > 0)) {
-                        (*ii).busy = true;
-                        pbo->resize(width, height, channels, bytesPerChannel);
-                        if (immediate) immediateHits_++;
-                        lock_.unlock();
-                        return {pbo, this, &(*ii).refcount, &(*ii).pending, idx};
-                    }
-                }
+        //-------------------------------------------------------
+        // Matching or larger size class...
+        //-------------------------------------------------------
+        for (int cl=sclass; (cl < NUM_CLASSES) && (!ent); cl++) {
+            ent = takeAvailable(cl, width, height, channels, bytesPerChannel);
+        }
+        //-------------------------------------------------------
+        // ...new PBO...
+        //-------------------------------------------------------
+        if ((!ent) && (currentPBOs_ < maxPBOs_)) {
+            ent = createPBO(sclass, width, height, channels, bytesPerChannel);
+        }
+        //-------------------------------------------------------
+        // ...or grow a PBO from a smaller size class
+        //-------------------------------------------------------
+        if (!ent) {
+            for (int cl=sclass-1; (cl >= 0) && (!ent); cl--) {
+                ent = takeAvailable(cl, width, height, channels, bytesPerChannel);
+            }
+            if (ent) {
+                ent->sizeClass = sclass;
+                stats_.regrown++;
             }
         }
-        if (currentPBOs_ < maxPBOs_) {
-            PBO * pbo = new PBO(width, height, channels, bytesPerChannel, context());
-            idx = (int)availablePBOs_.size();
-            availablePBOs_.emplace_back(pbo, true);
-            entry & last = availablePBOs_.back();
-            currentPBOs_++;
-            if (immediate) immediateHits_++;
-            lock_.unlock();
-            return {pbo, this, &(last.refcount), &(last.pending), idx};
+        if (ent) break;
+        //-------------------------------------------------------
+        // Nothing available, wait for a PBO to be released...
+        //-------------------------------------------------------
+        if (start == 0) {
+            start = fy_get_stamp();
+            stats_.waits++;
         }
-        immediate = false;
-        waitCycles_++;
-        lock_.unlock();
-        std::this_thread::sleep_for(2ms);
+        released_.wait(lck);
+    }
+    if (start != 0) {
+        uint64_t waited = fy_elapsed_micros(start, fy_get_stamp());
+        stats_.waitTime += waited;
+        stats_.maxWaitTime = std::max(stats_.maxWaitTime, waited);
+    } else stats_.immediateHits++;
+    ent->busy = true;
+    stats_.busy++;
+    ent->pbo->resize(width, height, channels, bytesPerChannel);
+    return {ent->pbo, this, &(ent->refcount), &(ent->pending), ent->index};
+}
+
+
+/**
+ * @brief Pre-warm the pool with a number of PBOs of the supplied size
+ *
+ * @param width Width (pixels) of the PBOs to create
+ * @param height Height (pixels) of the PBOs to create
+ * @param channels Number of channels for the PBOs to create
+ * @param bytesPerChannel Number of bytes per channel
+ * @param count Target number of PBOs in the size class of the supplied dimensions
+ * @param access Type of access that the PBOs are used for, determines the storage allocation
+ *
+ * @return Number of PBOs that were created by this call
+ *
+ * @pre The GL context stored with the pool is current to the calling thread
+ *
+ * Creates PBOs (including their storage, which is sized to the upper bound of the size class)
+ * until the size class of the supplied dimensions contains \p count PBOs. The maximum number of
+ * PBOs in the pool is increased if necessary.
+ */
+int PBOPool::prewarm(int width, int height, int channels, int bytesPerChannel, int count, PBO::accesstype access) {
+    assertContext();
+    int sclass = sizeClass(width, height, channels, bytesPerChannel);
+    size_t bytes = (size_t)1 << sclass;
+    std::lock_guard<std::mutex> lck(lock_);
+    int have = 0;
+    for (const entry & ent : availablePBOs_) {
+        if (ent.sizeClass == sclass) have++;
+    }
+    int created = 0;
+    while (have + created < count) {
+        if (currentPBOs_ >= maxPBOs_) maxPBOs_ = currentPBOs_ + 1;
+        entry * ent = createPBO(sclass, width, height, channels, bytesPerChannel);
+        if (access == PBO::READ) ent->pbo->prepareForRead(bytes);
+        else ent->pbo->prepareForWrite(bytes);
+        ent->busy = false;
+        freePBOs_[sclass].push_back(ent);
+        created++;
     }
+    if (created > 0) released_.notify_all();
+    return created;
+}
+
+
+/**
+ * @brief Set the maximum allowed number of PBOs for the pool
+ *
+ * @param mx Maximum number of PBOs maintained by the pool
+ *
+ * Increasing the number of PBOs wakes up requests that are waiting for a %PBO. Decreasing the
+ * number does not delete any PBOs that are already in the pool.
+ */
+void PBOPool::setMaxPBOs(int mx) {
+    assert(mx >= 0);
+    std::lock_guard<std::mutex> lck(lock_);
+    bool grow = (mx > maxPBOs_);
+    maxPBOs_ = mx;
+    if (grow) released_.notify_all();
+}
+
+
+/**
+ * @brief Retrieve access statistics of the pool
+ *
+ * @return Copy of the current statistics
+ */
+PBOPool::statistics PBOPool::getStatistics() const {
+    std::lock_guard<std::mutex> lck(lock_);
+    statistics stats = stats_;
+    stats.current = currentPBOs_;
+    return stats;
 }
 
 
@@ -120,12 +209,14 @@ ManagedPBO PBOPool::getAvailablePBO(int width, int height, int channels, int byt
  */
 void PBOPool::logStatistics() {
 #ifdef DEBUG
-    std::lock_guard<std::mutex> lck(lock_);
+    statistics stats = getStatistics();
     FNLOGD("PBO pool %p access statistics:", this);
-    FNLOGD("  # requests: %" PRIu64, requests_);
-    FNLOGD("  # immhits: %" PRIu64, immediateHits_);
-    FNLOGD("  # wait cycles: %" PRIu64, waitCycles_);
-    FNLOGD("  wait time: %" PRIu64 " ms", waitCycles_*2);
+    FNLOGD("  # requests: %" PRIu64, stats.requests);
+    FNLOGD("  # immhits: %" PRIu64, stats.immediateHits);
+    FNLOGD("  # waits: %" PRIu64, stats.waits);
+    FNLOGD("  wait time: %" PRIu64 " us (max %" PRIu64 " us)", stats.waitTime, stats.maxWaitTime);
+    FNLOGD("  # created: %" PRIu64 " (regrown %" PRIu64 ")", stats.created, stats.regrown);
+    FNLOGD("  # PBOs: %d (busy %d)", stats.current, stats.busy);
 #endif
 }
 
@@ -142,20 +233,99 @@ void PBOPool::logStatistics() {
  * @pre The supplied \p pbo must not be marked as pending
  * @post Corresponding pool entry will have the %PBO marked as not-busy.
  *
- * This function releases a %PBO back to the pool by locating its entry in the list of PBOs
- * and marking the %PBO as not-busy (available).
+ * This function releases a %PBO back to the pool by marking it as not-busy (available), adding it
+ * to the list of available PBOs of its size class and waking up requests that wait for a %PBO.
  */
 void PBOPool::releasePBO(PBO * pbo) {
-    std::lock_guard<std::mutex> lck(lock_);
-    int idx = 0;
-    for (auto ii=availablePBOs_.begin(); ii != availablePBOs_.end(); ++ii,idx++) {
-        if ((*ii).pbo == pbo) {
-            (*ii).busy = false;
-            return;
+    std::unique_lock<std::mutex> lck(lock_);
+    auto it = entries_.find(pbo);
+    if (it == entries_.end()) {
+        // this should not happen
+        assert(false);
+        return;
+    }
+    entry * ent = it->second;
+    assert(ent->busy);
+    ent->busy = false;
+    freePBOs_[ent->sizeClass].push_back(ent);
+    stats_.busy--;
+    lck.unlock();
+    released_.notify_all();
+}
+
+
+/**
+ * @brief Take an available %PBO from a size class
+ *
+ * @param sizeClass Size class to take the %PBO from
+ * @param width Width (pixels) of the requested %PBO
+ * @param height Height (pixels) of the requested %PBO
+ * @param channels Number of channels of the requested %PBO
+ * @param bytesPerChannel Number of bytes per channel of the requested %PBO
+ *
+ * @return Pointer to pool entry or \c nullptr if there is no available %PBO in the size class
+ *
+ * @pre #lock_ is held by the caller
+ *
+ * PBOs that have sufficient capacity for the requested dimensions are preferred, such that the
+ * storage does not have to be re-allocated.
+ */
+PBOPool::entry * PBOPool::takeAvailable(int sizeClass, int width, int height, int channels, int bytesPerChannel) {
+    std::vector<entry *> & list = freePBOs_[sizeClass];
+    if (list.empty()) return nullptr;
+    int sel = (int)list.size() - 1;
+    for (int i = sel; i >= 0; i--) {
+        if (list[i]->pbo->matches(width, height, channels, bytesPerChannel)) {
+            sel = i;
+            break;
         }
     }
-    // this should not happen
-    assert(false);
+    entry * ent = list[sel];
+    list[sel] = list.back();
+    list.pop_back();
+    return ent;
+}
+
+
+/**
+ * @brief Create a new %PBO and add it to the pool
+ *
+ * @param sizeClass Size class to add the %PBO to
+ * @param width Width (pixels) of the %PBO
+ * @param height Height (pixels) of the %PBO
+ * @param channels Number of channels of the %PBO
+ * @param bytesPerChannel Number of bytes per channel of the %PBO
+ *
+ * @return Pointer to pool entry, the %PBO is marked as busy
+ *
+ * @pre #lock_ is held by the caller
+ */
+PBOPool::entry * PBOPool::createPBO(int sizeClass, int width, int height, int channels, int bytesPerChannel) {
+    PBO * pbo = new PBO(width, height, channels, bytesPerChannel, context());
+    availablePBOs_.emplace_back(pbo, true, sizeClass, (int)availablePBOs_.size());
+    entry * ent = &availablePBOs_.back();
+    entries_[pbo] = ent;
+    currentPBOs_++;
+    stats_.created++;
+    return ent;
+}
+
+
+/**
+ * @brief Compute size class for the supplied %PBO dimensions
+ *
+ * @param width Width (pixels) of the %PBO
+ * @param height Height (pixels) of the %PBO
+ * @param channels Number of channels of the %PBO
+ * @param bytesPerChannel Number of bytes per channel of the %PBO
+ *
+ * @return Size class, which is the base-2 logarithm of the %PBO size, rounded up
+ */
+int PBOPool::sizeClass(int width, int height, int channels, int bytesPerChannel) {
+    size_t bytes = (size_t)width * (size_t)height * (size_t)channels * (size_t)bytesPerChannel;
+    int sclass = MIN_CLASS;
+    while ((sclass < NUM_CLASSES - 1) && (((size_t)1 << sclass) < bytes)) sclass++;
+    return sclass;
 }
 
 
@@ -1,7 +1,7 @@
 //--------------------------------------------------------------------------------------------------
 // FyuseNet                                                               (c) Fyusion Inc. 2016-2022
 //--------------------------------------------------------------------------------------------------
-// Simple PBO Pool (Header)
+// Size-Class PBO Pool (Header)
 // Creator: Martin Wawro
 // SPDX-License-Identifier: MIT
 //--------------------------------------------------------------------------------------------------
@@ -14,8 +14,11 @@
 
 #include <cassert>
 #include <mutex>
+#include <condition_variable>
 #include <atomic>
 #include <list>
+#include <vector>
+#include <unordered_map>
 
 //-------------------------------------- Project  Headers ------------------------------------------
 
@@ -33,12 +36,27 @@ namespace fyusion::opengl {
 //------------------------------------- Public Declarations ----------------------------------------
 
 /**
- * @brief Simple PBO pool
+ * @brief Thread-safe PBO pool with size-class buckets
  *
- * This class serves as a simple (and thread-safe) PBO pool. It stores a dynamic list of PBOs
- * with a maximum capacity and provides managed PBO instances for multi-threaded scenarios.
- * All instances are tracked by the pool, which retains the ownership, and are made available
- * without prioritization.
+ * This class serves as a (thread-safe) PBO pool. It stores a dynamic list of PBOs with a maximum
+ * capacity and provides managed PBO instances for multi-threaded scenarios. All instances are
+ * tracked by the pool, which retains the ownership.
+ *
+ * PBOs are sorted into size classes by their byte size (rounded up to the next power of two) and
+ * each size class maintains its own list of available PBOs. A request is served in the following
+ * order:
+ *   1. an available %PBO from the matching size class
+ *   2. an available %PBO from the next larger size class that has one
+ *   3. a newly created %PBO, if the pool has not reached its maximum size yet
+ *   4. an available %PBO from a smaller size class, which is then grown and moved to the matching
+ *      size class
+ *
+ * If none of the above applies, the requesting thread waits on a condition variable which is
+ * signalled whenever a %PBO is released back to the pool (or the pool size is increased). There
+ * is no polling involved.
+ *
+ * For latency-critical applications, the pool can be pre-warmed with a number of PBOs per size
+ * class using prewarm(), such that no %PBO has to be created or grown on the fly.
  *
  * @see ManagedPBO, PBO
  */
@@ -52,11 +70,13 @@ class PBOPool : public fyusenet::GfxContextTracker {
      * state and reference counting.
      */
     struct entry {
-        entry(PBO *p, bool b) : pbo(p), busy(b) {}
+        entry(PBO *p, bool b, int sclass, int idx) : pbo(p), busy(b), sizeClass(sclass), index(idx) {}
         entry(entry && src) noexcept {
             pbo = src.pbo;
             busy = src.busy;
             pending = src.pending;
+            sizeClass = src.sizeClass;
+            index = src.index;
             // NOTE (mw) not atomic
             refcount.store(src.refcount.load());
         }
@@ -66,8 +86,28 @@ class PBOPool : public fyusenet::GfxContextTracker {
         PBO * pbo = nullptr;                    //!< Pointer to underlying PBO
         bool busy = false;                      //!< Indicator if the #pbo is currently busy (i.e. a reference outside of the pool itself is held)
         bool pending = false;                   //!< Indicator if the #pbo is currently in a pending state (an operation was triggered and the result is still pending)
+        int sizeClass = 0;                      //!< Size class that the #pbo is currently assigned to
+        int index = 0;                          //!< Index of the #pbo in the pool (in order of creation)
         std::atomic<uint32_t> refcount{0};      //!< Number of references held to the #pbo, includes a reference by the pool itself
     };
+ public:
+    /**
+     * @brief Access statistics of a pool
+     *
+     * @see getStatistics()
+     */
+    struct statistics {
+        uint64_t requests = 0;                  //!< Number of times a %PBO was requested from the pool
+        uint64_t immediateHits = 0;             //!< Number of times a %PBO was available without waiting
+        uint64_t waits = 0;                     //!< Number of times a request had to wait for a %PBO to be released
+        uint64_t waitTime = 0;                  //!< Total time (microseconds) that requests spent waiting
+        uint64_t maxWaitTime = 0;               //!< Longest time (microseconds) that a single request spent waiting
+        uint64_t created = 0;                   //!< Number of PBOs that were created (including pre-warming)
+        uint64_t regrown = 0;                   //!< Number of PBOs that were moved to a larger size class
+        int current = 0;                        //!< Current number of PBOs in the pool
+        int busy = 0;                           //!< Number of PBOs currently handed out by the pool
+    };
+
  public:
     // ------------------------------------------------------------------------
     // Constructor/Destructor
@@ -79,33 +119,49 @@ class PBOPool : public fyusenet::GfxContextTracker {
     // Public methods
     // ------------------------------------------------------------------------
     ManagedPBO getAvailablePBO(int width, int height, int channels, int bytesPerChannel);
+    int prewarm(int width, int height, int channels, int bytesPerChannel, int count, PBO::accesstype access);
+    void setMaxPBOs(int mx);
+    [[nodiscard]] statistics getStatistics() const;
     void logStatistics();
 
     /**
-     * @brief Set the maximum allowed number of PBOs for the pool
+     * @brief Get the maximum allowed number of PBOs for the pool
      *
-     * @param mx Maximum number of PBOs maintained by the pool
+     * @return Maximum number of PBOs maintained by the pool
      */
-    void setMaxPBOs(int mx) {
-        assert(mx >= 0);
-        maxPBOs_ = mx;
+    [[nodiscard]] int maxPBOs() const {
+        return maxPBOs_;
     }
  private:
+    /**
+     * Number of size classes, PBO sizes are rounded up to the next power of two
+     */
+    constexpr static int NUM_CLASSES = 48;
+
+    /**
+     * Smallest size class (log2 of byte size), smaller PBOs are rounded up to that size
+     */
+    constexpr static int MIN_CLASS = 12;
+
     // ------------------------------------------------------------------------
     // Non-public methods
     // ------------------------------------------------------------------------
     void releasePBO(PBO *pbo);
+    entry * takeAvailable(int sizeClass, int width, int height, int channels, int bytesPerChannel);
+    entry * createPBO(int sizeClass, int width, int height, int channels, int bytesPerChannel);
+    static int sizeClass(int width, int height, int channels, int bytesPerChannel);
 
     // ------------------------------------------------------------------------
     // Member variables
     // ------------------------------------------------------------------------
-    int maxPBOs_ = 1;                       //!< Maximum number of PBOs in the pool
-    int currentPBOs_ = 0;                   //!< Current number of PBOs in the pool
-    std::mutex lock_;                       //!< Serialization to pool resources
-    std::list<entry> availablePBOs_;        //!< List of pool resources
-    uint64_t requests_ = 0;                 //!< For performance measurement, number of times a %PBO was requested from the pool
-    uint64_t immediateHits_ = 0;            //!< For performance measurement, number of times a %PBO was available immediately
-    uint64_t waitCycles_ = 0;               //!< For performance measurement, the number of busy-waiting rounds until a %PBO became available
+    int maxPBOs_ = 1;                                   //!< Maximum number of PBOs in the pool
+    int currentPBOs_ = 0;                               //!< Current number of PBOs in the pool
+    mutable std::mutex lock_;                           //!< Serialization to pool resources
+    std::condition_variable released_;                  //!< Signals the release of a %PBO (or an increased pool size), see #lock_
+    std::list<entry> availablePBOs_;                    //!< List of pool resources (available and busy)
+    std::vector<entry *> freePBOs_[NUM_CLASSES];        //!< Available (non-busy) PBOs per size class
+    std::unordered_map<PBO *, entry *> entries_;        //!< Maps PBOs to their pool entries
+    statistics stats_;                                  //!< Access statistics, see getStatistics()
 };
 
 } // fyusion::opengl namespace
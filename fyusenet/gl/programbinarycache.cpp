@@ -0,0 +1,357 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Persistent Cache for Linked Shader Program Binaries
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <cstdio>
+#include <cstring>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define FYUSENET_MMAP_SUPPORT
+#endif
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "programbinarycache.h"
+#include "../common/logging.h"
+
+//-------------------------------------- Global Variables ------------------------------------------
+namespace fyusion {
+namespace opengl {
+
+//-------------------------------------- Local Definitions -----------------------------------------
+
+ProgramBinaryCache * ProgramBinaryCache::instance_ = nullptr;
+
+/**
+ * Version of the cache file layout
+ */
+static constexpr uint32_t FILE_VERSION = 1;
+
+/**
+ * Round up to next multiple of 8 (all entries in the cache file are 8-byte aligned)
+ */
+static inline size_t align8(size_t val) {
+    return (val + 7) & ~((size_t)7);
+}
+
+/*##################################################################################################
+#                                   P U B L I C  F U N C T I O N S                                 #
+##################################################################################################*/
+
+/**
+ * @brief Destructor
+ *
+ * Releases the file mapping. Changes to the cache are \b not written back by the destructor, use
+ * store() or close() for that.
+ */
+ProgramBinaryCache::~ProgramBinaryCache() {
+    entries_.clear();
+    unmap();
+}
+
+
+/**
+ * @brief Look up program binary in cache
+ *
+ * @param key Content hash of the program (see ShaderProgram::link())
+ * @param[out] format Driver-specific format of the binary
+ * @param[out] data Pointer to binary data, remains valid until the entry is removed or replaced
+ * @param[out] length Length of the binary data (in bytes)
+ *
+ * @retval true if a binary was found for the supplied \p key
+ * @retval false otherwise
+ */
+bool ProgramBinaryCache::find(uint64_t key, GLenum & format, const void *& data, GLsizei & length) const {
+    std::lock_guard<std::mutex> lck(lock_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) return false;
+    format = it->second.format;
+    data = it->second.data;
+    length = it->second.length;
+    return true;
+}
+
+
+/**
+ * @brief Add program binary to cache
+ *
+ * @param key Content hash of the program (see ShaderProgram::link())
+ * @param format Driver-specific format of the binary
+ * @param data Pointer to binary data, a copy of the data is made
+ * @param length Length of the binary data (in bytes)
+ */
+void ProgramBinaryCache::put(uint64_t key, GLenum format, const void *data, GLsizei length) {
+    if ((!data) || (length <= 0)) return;
+    std::lock_guard<std::mutex> lck(lock_);
+    Entry & entry = entries_[key];
+    entry.format = format;
+    entry.owned.assign((const uint8_t *)data, (const uint8_t *)data + length);
+    entry.data = entry.owned.data();
+    entry.length = length;
+    dirty_ = true;
+}
+
+
+/**
+ * @brief Remove program binary from cache
+ *
+ * @param key Content hash of the program to remove
+ *
+ * This is used for binaries that were rejected by the driver.
+ */
+void ProgramBinaryCache::remove(uint64_t key) {
+    std::lock_guard<std::mutex> lck(lock_);
+    if (entries_.erase(key) > 0) dirty_ = true;
+}
+
+
+/**
+ * @brief Write cache contents to the backing file
+ *
+ * @retval true if the cache was written (or there was nothing to write)
+ * @retval false if the file could not be written
+ *
+ * The data is written to a temporary file first, which then replaces the backing file. Existing
+ * mappings of the previous file contents remain valid.
+ */
+bool ProgramBinaryCache::store() {
+    std::lock_guard<std::mutex> lck(lock_);
+    if (!dirty_) return true;
+    std::string tmpname = fileName_ + ".tmp";
+    FILE * out = fopen(tmpname.c_str(), "wb");
+    if (!out) {
+        FNLOGE("Cannot write program binary cache to %s", tmpname.c_str());
+        return false;
+    }
+    static const uint8_t zeros[8] = {0};
+    uint32_t header[2] = {FILE_VERSION, (uint32_t)token_.size()};
+    bool ok = (fwrite(MAGIC, 1, sizeof(MAGIC), out) == sizeof(MAGIC));
+    ok &= (fwrite(header, sizeof(header), 1, out) == 1);
+    ok &= (fwrite(token_.data(), 1, token_.size(), out) == token_.size());
+    ok &= (fwrite(zeros, 1, align8(token_.size()) - token_.size(), out) == align8(token_.size()) - token_.size());
+    uint32_t count[2] = {(uint32_t)entries_.size(), 0};
+    ok &= (fwrite(count, sizeof(count), 1, out) == 1);
+    for (auto it = entries_.begin(); (it != entries_.end()) && (ok); ++it) {
+        uint32_t fmtlen[2] = {(uint32_t)it->second.format, (uint32_t)it->second.length};
+        size_t pad = align8(it->second.length) - it->second.length;
+        ok &= (fwrite(&it->first, sizeof(uint64_t), 1, out) == 1);
+        ok &= (fwrite(fmtlen, sizeof(fmtlen), 1, out) == 1);
+        ok &= (fwrite(it->second.data, 1, it->second.length, out) == (size_t)it->second.length);
+        ok &= (fwrite(zeros, 1, pad, out) == pad);
+    }
+    ok &= (fclose(out) == 0);
+    if ((!ok) || (std::rename(tmpname.c_str(), fileName_.c_str()) != 0)) {
+        FNLOGE("Cannot write program binary cache to %s", fileName_.c_str());
+        std::remove(tmpname.c_str());
+        return false;
+    }
+    dirty_ = false;
+    return true;
+}
+
+
+/**
+ * @brief Set up process-wide program binary cache
+ *
+ * @param fileName Name of the file that backs the cache. If the file exists and was created on
+ *                 the same renderer/driver, its contents are used to populate the cache. If it
+ *                 does not exist, it will be created once the cache is stored.
+ *
+ * @return Pointer to cache instance or \c nullptr if the GL implementation does not support
+ *         program binaries
+ *
+ * @pre A GL context is current to the calling thread
+ *
+ * If a cache was already set up, the existing instance is returned.
+ */
+ProgramBinaryCache * ProgramBinaryCache::open(const std::string & fileName) {
+#ifdef FYUSENET_USE_WEBGL
+    return nullptr;
+#else
+    if (instance_) {
+        if (instance_->fileName_ != fileName) FNLOGW("Program binary cache already set up with file %s", instance_->fileName_.c_str());
+        return instance_;
+    }
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats <= 0) {
+        FNLOGW("GL implementation does not support program binaries, not using program binary cache");
+        return nullptr;
+    }
+    instance_ = new ProgramBinaryCache(fileName);
+    if (instance_->map()) {
+        FNLOGD("Loaded %d program binaries from %s", (int)instance_->entries_.size(), fileName.c_str());
+    }
+    return instance_;
+#endif
+}
+
+
+/**
+ * @brief Get process-wide program binary cache
+ *
+ * @return Pointer to cache instance or \c nullptr if no cache was set up
+ */
+ProgramBinaryCache * ProgramBinaryCache::instance() {
+    return instance_;
+}
+
+
+/**
+ * @brief Write process-wide program binary cache to disk (if changed) and remove it
+ */
+void ProgramBinaryCache::close() {
+    if (instance_) {
+        instance_->store();
+        delete instance_;
+        instance_ = nullptr;
+    }
+}
+
+
+/*##################################################################################################
+#                               N O N -  P U B L I C  F U N C T I O N S                            #
+##################################################################################################*/
+
+/**
+ * @brief Constructor
+ *
+ * @param fileName Name of the file that backs the cache
+ */
+ProgramBinaryCache::ProgramBinaryCache(const std::string & fileName) : fileName_(fileName), token_(systemToken()) {
+}
+
+
+/**
+ * @brief Map backing file into memory and populate cache entries from it
+ *
+ * @retval true if entries were loaded from the file
+ * @retval false if the file does not exist, is corrupt or was created on a different system
+ */
+bool ProgramBinaryCache::map() {
+#ifdef FYUSENET_MMAP_SUPPORT
+    int fd = ::open(fileName_.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st = {};
+    if ((fstat(fd, &st) != 0) || (st.st_size <= 0)) {
+        ::close(fd);
+        return false;
+    }
+    void * ptr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (ptr == MAP_FAILED) return false;
+    mapping_ = (uint8_t *)ptr;
+    mappingSize_ = (size_t)st.st_size;
+    mapped_ = true;
+#else
+    FILE * in = fopen(fileName_.c_str(), "rb");
+    if (!in) return false;
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    if (size <= 0) {
+        fclose(in);
+        return false;
+    }
+    mapping_ = new uint8_t[size];
+    mappingSize_ = (size_t)size;
+    mapped_ = false;
+    size_t read = fread(mapping_, 1, mappingSize_, in);
+    fclose(in);
+    if (read != mappingSize_) {
+        unmap();
+        return false;
+    }
+#endif
+    // -------------------------------------------------------
+    // Check header...
+    // -------------------------------------------------------
+    size_t offset = sizeof(MAGIC) + 2 * sizeof(uint32_t);
+    if ((mappingSize_ < offset) || (memcmp(mapping_, MAGIC, sizeof(MAGIC)) != 0)) {
+        FNLOGW("File %s is not a program binary cache, ignoring contents", fileName_.c_str());
+        unmap();
+        return false;
+    }
+    uint32_t header[2];
+    memcpy(header, mapping_ + sizeof(MAGIC), sizeof(header));
+    if ((header[0] != FILE_VERSION) || (offset + align8(header[1]) + 2 * sizeof(uint32_t) > mappingSize_) ||
+        (std::string((const char *)mapping_ + offset, header[1]) != token_)) {
+        FNLOGI("Program binary cache %s was created on a different system, rebuilding", fileName_.c_str());
+        unmap();
+        return false;
+    }
+    offset += align8(header[1]);
+    uint32_t count[2];
+    memcpy(count, mapping_ + offset, sizeof(count));
+    offset += sizeof(count);
+    // -------------------------------------------------------
+    // Index entries, data stays in the mapping...
+    // -------------------------------------------------------
+    for (uint32_t i=0; i < count[0]; i++) {
+        uint64_t key;
+        uint32_t fmtlen[2];
+        if (offset + sizeof(key) + sizeof(fmtlen) > mappingSize_) break;
+        memcpy(&key, mapping_ + offset, sizeof(key));
+        memcpy(fmtlen, mapping_ + offset + sizeof(key), sizeof(fmtlen));
+        offset += sizeof(key) + sizeof(fmtlen);
+        if (offset + fmtlen[1] > mappingSize_) break;
+        Entry & entry = entries_[key];
+        entry.format = (GLenum)fmtlen[0];
+        entry.data = mapping_ + offset;
+        entry.length = (GLsizei)fmtlen[1];
+        offset += align8(fmtlen[1]);
+    }
+    if (entries_.size() != count[0]) {
+        FNLOGW("Program binary cache %s is truncated", fileName_.c_str());
+        dirty_ = true;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Release file mapping (or heap copy) of the backing file
+ */
+void ProgramBinaryCache::unmap() {
+    if (!mapping_) return;
+#ifdef FYUSENET_MMAP_SUPPORT
+    if (mapped_) munmap(mapping_, mappingSize_);
+    else delete [] mapping_;
+#else
+    delete [] mapping_;
+#endif
+    mapping_ = nullptr;
+    mappingSize_ = 0;
+}
+
+
+/**
+ * @brief Create token that identifies the GL implementation that program binaries are valid for
+ *
+ * @return String that consists of GL vendor, renderer and version strings
+ *
+ * @pre A GL context is current to the calling thread
+ */
+std::string ProgramBinaryCache::systemToken() {
+    std::string token;
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        const char * str = (const char *)glGetString(name);
+        token += (str) ? str : "";
+        token += "\n";
+    }
+    return token;
+}
+
+} // opengl namespace
+} // fyusion namespace
+
+// vim: set expandtab ts=4 sw=4:
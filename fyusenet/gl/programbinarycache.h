@@ -0,0 +1,126 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Persistent Cache for Linked Shader Program Binaries (Header)
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "gl_sys.h"
+
+//------------------------------------- Public Declarations ----------------------------------------
+namespace fyusion {
+namespace opengl {
+
+/**
+ * @brief Persistent file-backed cache for linked shader program binaries
+ *
+ * Compiling and linking the shader programs of all layers is by far the most expensive part of
+ * setting up a network on most GL drivers and can easily take seconds for larger networks. This
+ * cache stores the binaries of linked shader programs (as obtained by \c glGetProgramBinary) in a
+ * single file, such that subsequent process starts on the same system can skip the costly
+ * link step by loading the binaries with \c glProgramBinary instead.
+ *
+ * The cache file is memory-mapped (where supported) and entries are loaded directly from the
+ * mapping. Each entry is addressed by a hash over the full source code of all shaders in a
+ * program (including preamble and preprocessor definitions) as well as the attribute bindings
+ * of the program. The file also records the GL renderer and version strings. A file that was
+ * created on a different renderer or driver version is discarded and rebuilt from scratch.
+ * Binaries that are rejected by the driver are silently replaced by a regular link.
+ *
+ * The cache is a process-wide singleton which is set up by GfxContextManager::setupProgramBinaryCache()
+ * and persisted to disk when the context manager is torn down (or on demand by calling store()).
+ *
+ * @note Program binaries are not available for WebGL, the cache is a no-op there.
+ *
+ * @see ShaderProgram::link(), GfxContextManager::setupProgramBinaryCache()
+ */
+class ProgramBinaryCache {
+ public:
+    // ------------------------------------------------------------------------
+    // Constructor / Destructor
+    // ------------------------------------------------------------------------
+    ~ProgramBinaryCache();
+
+    // ------------------------------------------------------------------------
+    // Public methods
+    // ------------------------------------------------------------------------
+    bool find(uint64_t key, GLenum & format, const void *& data, GLsizei & length) const;
+    void put(uint64_t key, GLenum format, const void *data, GLsizei length);
+    void remove(uint64_t key);
+    bool store();
+
+    /**
+     * @brief Get number of program binaries in the cache
+     *
+     * @return Number of cached program binaries
+     */
+    [[nodiscard]] size_t size() const {
+        std::lock_guard<std::mutex> lck(lock_);
+        return entries_.size();
+    }
+
+    // ------------------------------------------------------------------------
+    // Static functions
+    // ------------------------------------------------------------------------
+    static ProgramBinaryCache * open(const std::string & fileName);
+    static ProgramBinaryCache * instance();
+    static void close();
+
+    /**
+     * File identifier for program binary caches
+     */
+    constexpr static char MAGIC[8] = {'F', 'Y', 'N', 'P', 'B', 'C', '0', '1'};
+
+ private:
+    /**
+     * @brief Single cached program binary
+     */
+    struct Entry {
+        GLenum format = 0;                  //!< Driver-specific binary format
+        const uint8_t * data = nullptr;     //!< Pointer to binary data (either into the mapped file or into #owned)
+        GLsizei length = 0;                 //!< Length of the binary (in bytes)
+        std::vector<uint8_t> owned;         //!< Binary data for entries that were added after loading the file
+    };
+
+    // ------------------------------------------------------------------------
+    // Non-public methods
+    // ------------------------------------------------------------------------
+    explicit ProgramBinaryCache(const std::string & fileName);
+    bool map();
+    void unmap();
+    static std::string systemToken();
+
+    // ------------------------------------------------------------------------
+    // Member variables
+    // ------------------------------------------------------------------------
+    std::string fileName_;                              //!< Name of the backing file
+    std::string token_;                                 //!< Renderer/driver token that binaries are valid for
+    std::unordered_map<uint64_t, Entry> entries_;       //!< Cached program binaries, indexed by content hash
+    uint8_t * mapping_ = nullptr;                       //!< Pointer to (memory-mapped) file contents
+    size_t mappingSize_ = 0;                            //!< Size of #mapping_ (in bytes)
+    bool mapped_ = false;                               //!< Indicator whether #mapping_ is a memory-map (or heap memory)
+    bool dirty_ = false;                                //!< Indicator whether the cache has changed since loading
+    mutable std::mutex lock_;                           //!< Serializes access from multiple GL threads
+    static ProgramBinaryCache * instance_;              //!< Process-wide cache instance (if set up)
+};
+
+} // opengl namespace
+} // fyusion namespace
+
+
+// vim: set expandtab ts=4 sw=4:
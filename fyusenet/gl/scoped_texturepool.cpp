@@ -109,7 +109,7 @@ std::shared_ptr<GLuint> ScopedTexturePool::obtainTexture(int width, int height,
         key k(width, height, channels, type);
         GLuint handle=0;
         glGenTextures(1, &handle);
-        glBindTexture(GL_TEXTURE_2D, handle);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, handle);
         Texture::texinfo info = Texture::textureInfo(type, channels);
         glTexImage2D(GL_TEXTURE_2D, 0, info.intFormat, width, height, 0, info.format, info.dataType, nullptr);
 #ifdef DEBUG
@@ -302,7 +302,7 @@ std::shared_ptr<GLuint> ScopedTexturePool::findTexture(int width, int height, in
 void ScopedTexturePool::textureDel(GLuint * handlePtr) {
     // TODO (mw) check for context ?
     if (handlePtr) {
-        glDeleteTextures(1, handlePtr);
+        GLStateCache::deleteTextures(1, handlePtr);
         delete [] handlePtr;
     }
 }
@@ -248,6 +248,39 @@ void ShaderCache::tearDown() {
 }
 
 
+/**
+ * @brief Remove shader cache of a single context
+ *
+ * @param ctx GL context to remove the shader cache for
+ *
+ * @pre The supplied \p ctx is current to the calling thread
+ *
+ * Clears and removes the cache instance of the supplied context (if there is one). This is used
+ * by threads that own a GL context and release that context before the program ends (for example
+ * the worker threads of the NetworkDispatcher), such that tearDown() does not have to bind the
+ * context again.
+ */
+void ShaderCache::release(const fyusenet::GfxContextLink & ctx) {
+    bool expt = false;
+    while (!cacheLock_.compare_exchange_strong(expt,true)) {
+        expt = false;
+    }
+    ShaderCache * cache = nullptr;
+    for (int i=0; i < (int)shaderCaches_.size(); i++) {
+        if (shaderCaches_[i] && shaderCaches_[i]->context_ == ctx) {
+            cache = shaderCaches_[i];
+            shaderCaches_.erase(shaderCaches_.begin() + i);
+            break;
+        }
+    }
+    cacheLock_.store(false);
+    if (cache) {
+        cache->clear();
+        delete cache;
+    }
+}
+
+
 /**
  * @brief Retrieve shader cache instance for specified context
  *
@@ -72,6 +72,7 @@ class ShaderCache : public fyusenet::GfxContextTracker {
     // Static functions
     // ------------------------------------------------------------------------
     static ShaderCache * getInstance(const fyusenet::GfxContextLink & context);
+    static void release(const fyusenet::GfxContextLink & context);
     static void tearDown();
  private:
     // ------------------------------------------------------------------------
@@ -17,6 +17,8 @@
 #include "shaderprogram.h"
 #include "shaderexception.h"
 #include "uniformstate.h"
+#include "programbinarycache.h"
+#include "xxhash64.h"
 #include "shaderexception.h"
 #include "../gpu/gfxcontextlink.h"
 #include "../common/logging.h"
@@ -50,8 +52,8 @@ ShaderProgram::~ShaderProgram() {
     shaders_.clear();
     if (handle_ != 0) {
         assertContext();
-        glUseProgram(0);
-        glDeleteProgram(handle_);
+        GLStateCache::useProgram(0);
+        GLStateCache::deleteProgram(handle_);
         handle_ = 0;
     }
     hasFragment_ = false;
@@ -159,7 +161,7 @@ void ShaderProgram::bind(UniformState *state) {
     }
     glGetError();                   // clear error state
 #endif    
-    glUseProgram(handle_);
+    GLStateCache::useProgram(handle_);
 #ifdef DEBUG
     int userr = glGetError();
 #endif
@@ -189,7 +191,7 @@ void ShaderProgram::unbind(bool compress) {
     }
 #endif
     bound_ = false;
-    if (!compress) glUseProgram(0);
+    if (!compress) GLStateCache::useProgram(0);
 }
 
 
@@ -595,7 +597,7 @@ void ShaderProgram::setUniformValue(const char *name, GLint value, bool optional
 void ShaderProgram::setUniformValue(GLint location, GLint value) {
     if (location != -1) {
         if (!isLinked()) THROW_EXCEPTION_ARGS(ShaderException,"Shader program not linked");
-        glUniform1i(location,value);
+        GLCommandBuffer::uniform1i(location,value);
     }
 }
 
@@ -636,7 +638,7 @@ void ShaderProgram::setUniformValue(GLint location, GLfloat value) {
     UNIFORM_BOUND_CHECK
     if (location != -1) {
         if (!isLinked()) THROW_EXCEPTION_ARGS(ShaderException,"Shader program not linked");
-        glUniform1f(location,value);
+        GLCommandBuffer::uniform1f(location,value);
     }
 }
 
@@ -680,7 +682,7 @@ void ShaderProgram::setUniformVec2(GLint location, GLint v0, GLint v1) {
     UNIFORM_BOUND_CHECK
     if (location != -1) {
         if (!isLinked()) THROW_EXCEPTION_ARGS(ShaderException, "Shader program not linked");
-        glUniform2i(location, v0, v1);
+        GLCommandBuffer::uniform2i(location, v0, v1);
     }
 }
 
@@ -723,7 +725,7 @@ void ShaderProgram::setUniformVec2(GLint location, GLfloat v0, GLfloat v1) {
     UNIFORM_BOUND_CHECK
     if (location != -1) {
         if (!isLinked()) THROW_EXCEPTION_ARGS(ShaderException,"Shader program not linked");
-        glUniform2f(location, v0, v1);
+        GLCommandBuffer::uniform2f(location, v0, v1);
     }
 }
 
@@ -768,7 +770,7 @@ void ShaderProgram::setUniformVec3(GLint location, GLint v0, GLint v1, GLint v2)
     UNIFORM_BOUND_CHECK
     if (location != -1) {
         if (!isLinked()) THROW_EXCEPTION_ARGS(ShaderException,"Shader program not linked");
-        glUniform3i(location, v0, v1, v2);
+        GLCommandBuffer::uniform3i(location, v0, v1, v2);
     }
 }
 
@@ -814,7 +816,7 @@ void ShaderProgram::setUniformVec3(GLint location, GLfloat v0, GLfloat v1, GLflo
     UNIFORM_BOUND_CHECK
     if (location != -1) {
         if (!isLinked()) THROW_EXCEPTION_ARGS(ShaderException,"Shader program not linked");
-        glUniform3f(location, v0, v1, v2);
+        GLCommandBuffer::uniform3f(location, v0, v1, v2);
     }
 }
 
@@ -862,7 +864,7 @@ void ShaderProgram::setUniformVec4(GLint location, GLint v0, GLint v1, GLint v2,
     UNIFORM_BOUND_CHECK
     if (location != -1) {
         if (!isLinked()) THROW_EXCEPTION_ARGS(ShaderException,"Shader program not linked");
-        glUniform4i(location, v0, v1, v2, v3);
+        GLCommandBuffer::uniform4i(location, v0, v1, v2, v3);
     }
 }
 
@@ -910,7 +912,7 @@ void ShaderProgram::setUniformVec4(GLint location, GLfloat v0, GLfloat v1, GLflo
     UNIFORM_BOUND_CHECK
     if (location != -1) {
         if (!isLinked()) THROW_EXCEPTION_ARGS(ShaderException,"Shader program not linked");
-        glUniform4f(location,v0,v1,v2,v3);
+        GLCommandBuffer::uniform4f(location,v0,v1,v2,v3);
     }
 }
 
@@ -959,7 +961,7 @@ void ShaderProgram::setUniformMat3(const char *name,const GLfloat *matrix, bool
 void ShaderProgram::setUniformMat3(GLint location, const GLfloat *matrix, bool transpose) {
     UNIFORM_BOUND_CHECK
     if (!matrix) THROW_EXCEPTION_ARGS(ShaderException,"Illegal matrix pointer %p supplied",matrix);
-    if (location != -1) glUniformMatrix3fv(location, 1, transpose, matrix);
+    if (location != -1) GLCommandBuffer::uniformMatrix3fv(location, 1, transpose, matrix);
 }
 
 
@@ -1007,7 +1009,7 @@ void ShaderProgram::setUniformMat4(const char *name, const GLfloat *matrix, bool
 void ShaderProgram::setUniformMat4(GLint location, const GLfloat *matrix, bool transpose) {
     UNIFORM_BOUND_CHECK
     if (!matrix) THROW_EXCEPTION_ARGS(ShaderException,"Illegal matrix pointer %p supplied", matrix);
-    if (location != -1) glUniformMatrix4fv(location, 1, transpose, matrix);
+    if (location != -1) GLCommandBuffer::uniformMatrix4fv(location, 1, transpose, matrix);
 }
 
 
@@ -1062,7 +1064,7 @@ void ShaderProgram::setUniformMat4Array(GLint location, const GLfloat *matrices,
     if (!matrices) THROW_EXCEPTION_ARGS(ShaderException,"Illegal matrix pointer %p supplied", matrices);
     if (location != -1) {
         if (!isLinked()) THROW_EXCEPTION_ARGS(ShaderException,"Shader program not linked");
-        glUniformMatrix4fv(location, numMatrices, transpose, matrices);
+        GLCommandBuffer::uniformMatrix4fv(location, numMatrices, transpose, matrices);
     }
 }
 
@@ -1108,7 +1110,7 @@ void ShaderProgram::setUniformVec4Array(const char *name, const GLfloat *data, i
 void ShaderProgram::setUniformVec4Array(GLint location, const GLfloat *data, int num4Entries) {
     UNIFORM_BOUND_CHECK
     if (!data) THROW_EXCEPTION_ARGS(ShaderException,"Illegal data pointer %p supplied",data);
-    if (location != -1) glUniform4fv(location, num4Entries, data);
+    if (location != -1) GLCommandBuffer::uniform4fv(location, num4Entries, data);
 }
 
 
@@ -1155,7 +1157,7 @@ void ShaderProgram::setUniformVec4Array(GLint location, const GLuint *data, int
     if (!data) THROW_EXCEPTION_ARGS(ShaderException,"Illegal data pointer %p supplied",data);
     if (location != -1) {
         if (!isLinked()) THROW_EXCEPTION_ARGS(ShaderException,"Shader program not linked");
-        glUniform4uiv(location, num4Entries, data);
+        GLCommandBuffer::uniform4uiv(location, num4Entries, data);
     }
 }
 
@@ -1202,7 +1204,7 @@ void ShaderProgram::setUniformVec3Array(GLint location, const GLfloat *data, int
     UNIFORM_BOUND_CHECK
     if (location != -1) {
         if (!isLinked()) THROW_EXCEPTION_ARGS(ShaderException,"Shader program not linked");
-        glUniform3fv(location, num3Entries, data);
+        GLCommandBuffer::uniform3fv(location, num3Entries, data);
     }
 }
 
@@ -1249,7 +1251,7 @@ void ShaderProgram::setUniformVec2Array(GLint location, const GLint *data, int n
     UNIFORM_BOUND_CHECK
     if (location != -1) {
         if (!isLinked()) THROW_EXCEPTION_ARGS(ShaderException,"Shader program not linked");
-        glUniform2iv(location, num2Entries, data);
+        GLCommandBuffer::uniform2iv(location, num2Entries, data);
     }
 }
 
@@ -1295,7 +1297,7 @@ void ShaderProgram::setUniformVec2Array(GLint location, const GLfloat *data, int
     UNIFORM_BOUND_CHECK
     if (location != -1) {
         if (!isLinked()) THROW_EXCEPTION_ARGS(ShaderException,"Shader program not linked");
-        glUniform2fv(location, num2Entries, data);
+        GLCommandBuffer::uniform2fv(location, num2Entries, data);
     }
 }
 
@@ -1339,7 +1341,7 @@ void ShaderProgram::setUniformArray(GLint location, const GLfloat *data, int num
     UNIFORM_BOUND_CHECK
     if (location != -1) {
         if (!isLinked()) THROW_EXCEPTION_ARGS(ShaderException,"Shader program not linked");
-        glUniform1fv(location, numEntries, data);
+        GLCommandBuffer::uniform1fv(location, numEntries, data);
     }
 }
 
@@ -1358,6 +1360,7 @@ void ShaderProgram::bindAttributeLocation(const char *name, GLuint index) {
     ensureExistence();
     if (!isLinked()) {
         glBindAttribLocation(handle_,index,name);
+        attribBindings_ += std::string(name) + "=" + std::to_string(index) + ";";
     }
 }
 
@@ -1410,13 +1413,43 @@ void ShaderProgram::compile() {
  * @brief Link shader program
  *
  * This function first checks if the program is already linked and does nothing in that case.
- * Otherwise it
+ * Otherwise it looks up the program in the ProgramBinaryCache (if set up) and loads the cached
+ * binary, in which case the shaders are not compiled at all. If there is no cached binary or the
+ * driver rejects it, the shaders are compiled (if necessary) and linked, the resulting binary is
+ * then added to the cache.
  *
  * @throws ShaderException in case compilation/linking goes wrong
  */
 void ShaderProgram::link() {
     if (isLinked()) return;
     assertContext();
+#ifndef FYUSENET_USE_WEBGL
+    // -------------------------------------------------------
+    // Try to use a cached program binary instead of compiling
+    // and linking, the lookup is done by the shader sources...
+    // -------------------------------------------------------
+    ProgramBinaryCache * binaries = ProgramBinaryCache::instance();
+    uint64_t key = (binaries) ? binaryKey() : 0;
+    if (binaries) {
+        if (!isLinkable()) THROW_EXCEPTION_ARGS(ShaderException,"Not enough shader types for linking");
+        ensureExistence();
+        if (handle_ == 0) THROW_EXCEPTION_ARGS(ShaderException,"Cannot create shader program");
+        GLenum format = 0;
+        const void * data = nullptr;
+        GLsizei length = 0;
+        if (binaries->find(key, format, data, length)) {
+            GLint status = GL_FALSE;
+            glProgramBinary(handle_, format, data, length);
+            glGetProgramiv(handle_, GL_LINK_STATUS, &status);
+            if (status == GL_TRUE) {
+                linked_ = true;
+                return;
+            }
+            glGetError();
+            binaries->remove(key);
+        }
+    }
+#endif
     compile();
     glGetError();
     for (auto ii=shaders_.begin(); ii!=shaders_.end(); ++ii) {
@@ -1424,6 +1457,9 @@ void ShaderProgram::link() {
         GLint err = glGetError();
         if (err != GL_NO_ERROR) THROW_EXCEPTION_ARGS(ShaderException,"Unable to attach shader with handle %d, glerr=0x%x",(*ii)->getHandle(),err);
     }
+#ifndef FYUSENET_USE_WEBGL
+    if (binaries) glProgramParameteri(handle_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
     GLint status=GL_FALSE;
     glLinkProgram(handle_);
     glGetProgramiv(handle_,GL_LINK_STATUS,&status);
@@ -1439,6 +1475,18 @@ void ShaderProgram::link() {
         THROW_EXCEPTION_ARGS(ShaderException,"Unable to link shaders to program, status is 0x%x (expected 0x%X)",status,GL_TRUE);
     }
     linked_ = true;
+#ifndef FYUSENET_USE_WEBGL
+    if (binaries) {
+        GLint length = 0;
+        glGetProgramiv(handle_, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length > 0) {
+            std::vector<uint8_t> data(length);
+            GLenum format = 0;
+            glGetProgramBinary(handle_, length, &length, &format, data.data());
+            if (glGetError() == GL_NO_ERROR) binaries->put(key, format, data.data(), length);
+        }
+    }
+#endif
 }
 
 
@@ -1505,6 +1553,21 @@ std::vector<GLuint> ShaderProgram::getShaderHandles() const {
 }
 
 
+/**
+ * @brief Compute key for looking up this program in the ProgramBinaryCache
+ *
+ * @return 64-bit hash over the source code of all shaders and the attribute bindings
+ */
+uint64_t ShaderProgram::binaryKey() const {
+    std::string content;
+    for (auto ii=shaders_.begin(); ii != shaders_.end(); ++ii) {
+        content += std::to_string((int)(*ii)->getType()) + ":" + (*ii)->getCode() + "\n";
+    }
+    content += attribBindings_;
+    return XXHash64::hash(content, 0);
+}
+
+
 /**
  * @brief Make sure that a program handle exist (create one if not)
  */
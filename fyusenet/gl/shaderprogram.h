@@ -203,6 +203,7 @@ class ShaderProgram : public fyusenet::GfxContextTracker {
     void logError() const;
     void ensureExistence();
     std::vector<GLuint> getShaderHandles() const;
+    uint64_t binaryKey() const;
 
     // ------------------------------------------------------------------------
     // Member variables
@@ -216,6 +217,7 @@ class ShaderProgram : public fyusenet::GfxContextTracker {
     unsigned int userFlags_;                        //!< Storage for user-defined flags
     std::vector<shaderptr> shaders_;                //!< Shaders which are backing the shader program
     std::unordered_map<int, GLint> symbolMap_;      //!< Mapping for symbol lookup
+    std::string attribBindings_;                    //!< Attribute bindings that were set prior to linking (for ProgramBinaryCache)
     mutable uint64_t hash_;                         //!< Hash code, used for content-based addressing / identity check of shader programs
 };
 
@@ -15,6 +15,7 @@
 #include "../common/logging.h"
 #include "shaderresource.h"
 #include "shadercache.h"
+#include "programbinarycache.h"
 #include "vertexshader.h"
 #include "fragmentshader.h"
 
@@ -96,6 +97,10 @@ const char * ShaderRepository::getShader(const char *resourceName) {
  * that is not the case, the shaders are linked and put into the cache, otherwise the cached
  * instance is used.
  *
+ * If a ProgramBinaryCache is set up, the compilation of shaders that are not in the shader cache
+ * is deferred to ShaderProgram::link(), which only compiles them if there is no cached binary for
+ * the program. Programs with deferred shaders are not put into the shader cache.
+ *
  * The main reason for the \p typeInfo parameter is to make sure that shader \e programs are not
  * cached between different types of layer as some static settings on the uniform variables may
  * differ. It is up to the implementation of the actual layers to make sure that uniforms which
@@ -128,6 +133,11 @@ programptr ShaderRepository::compileShaderPair(const char *vertexName, const cha
     fshader->setCode(frag);
     vshader->setPreprocDefs(preprocDefs);
     fshader->setPreprocDefs(preprocDefs);
+#ifndef FYUSENET_USE_WEBGL
+    bool deferred = (ProgramBinaryCache::instance() != nullptr);
+#else
+    bool deferred = false;
+#endif
     ShaderCache *cache = ShaderCache::getInstance(context);
     if (cache) {
         size_t modhash = typeInfo.hash_code();
@@ -143,6 +153,7 @@ programptr ShaderRepository::compileShaderPair(const char *vertexName, const cha
         programptr prog = ShaderProgram::createInstance(context);
         prog->addShader( (vcache) ? vcache : vshader );
         prog->addShader( (fcache) ? fcache : fshader );
+        if ((deferred) && ((!vcache) || (!fcache))) return prog;
         prog->compile();
         if ((!vcache) && (cache)) cache->putShader(vshader);
         if ((!fcache) && (cache)) cache->putShader(fshader);
@@ -152,7 +163,7 @@ programptr ShaderRepository::compileShaderPair(const char *vertexName, const cha
         programptr prog = ShaderProgram::createInstance(context);
         prog->addShader(vshader);
         prog->addShader(fshader);
-        prog->compile();
+        if (!deferred) prog->compile();
         return prog;
     }
 }
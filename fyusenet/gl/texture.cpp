@@ -30,6 +30,7 @@ static const GLint intfmtF32_[4] = {GL_R32F, GL_RG32F, GL_RGB32F, GL_RGBA32F};
 static const GLint intfmtF16_[4] = {GL_R16F, GL_RG16F, GL_RGB16F, GL_RGBA16F};
 static const GLint intfmtU8_[4] = {GL_R8, GL_RG8, GL_RGB8, GL_RGBA8};
 static const GLint intfmtUI8_[4] = {GL_R8UI, GL_RG8UI, GL_RGB8UI, GL_RGBA8UI};
+static const GLint intfmtI8_[4] = {GL_R8I, GL_RG8I, GL_RGB8I, GL_RGBA8I};
 #ifdef GL_R16
 static const GLint intfmtU16_[4] = {GL_R16, GL_RG16, GL_RGB16, GL_RGBA16};
 #endif
@@ -42,6 +43,7 @@ static const GLint intfmtF32_[4] = {GL_R32F, GL_RG32F, GL_RGBA32F, GL_RGBA32F};
 static const GLint intfmtF16_[4] = {GL_R16F, GL_RG16F, GL_RGBA16F, GL_RGBA16F};
 static const GLint intfmtU8_[4] = {GL_R8, GL_RG8, GL_RGBA8, GL_RGBA8};
 static const GLint intfmtUI8_[4] = {GL_R8UI, GL_RG8UI, GL_RGBA8UI, GL_RGBA8UI};
+static const GLint intfmtI8_[4] = {GL_R8I, GL_RG8I, GL_RGBA8I, GL_RGBA8I};
 #ifdef GL_R16
 static const GLint intfmtU16_[4] = {GL_R16, GL_RG16, GL_RGBA16, GL_RGBA16};
 #endif
@@ -106,6 +108,7 @@ bool Texture::isFloat() const {
 bool Texture::isIntegral() const {
     switch (dataType_) {
        case UINT8_INTEGRAL:
+       case INT8_INTEGRAL:
        case UINT16_INTEGRAL:
        case INT16_INTEGRAL:
           return true;
@@ -134,6 +137,11 @@ Texture::texinfo Texture::textureInfo(pixtype type, int channels) {
             ifmt = intfmtUI8_[channels-1];
             fmt = texfmtI_[channels-1];
             break;
+        case INT8_INTEGRAL:
+            ifmt = intfmtI8_[channels-1];
+            fmt = texfmtI_[channels-1];
+            tt = GL_BYTE;
+            break;
         case UINT16:
 #ifdef GL_R16
             ifmt = intfmtU16_[channels-1];
@@ -222,7 +230,7 @@ Texture2D::Texture2D(int width, int height, pixtype type, int channels, bool cle
     assert(channels > 0);
     createHandle();
     assert(*(handle_.get()) != 0);
-    glBindTexture(GL_TEXTURE_2D, *(handle_));
+    GLStateCache::bindTexture(GL_TEXTURE_2D, *(handle_));
     updateParams();
     if (clear) this->clear();
 #ifdef DEBUG
@@ -263,12 +271,12 @@ Texture2D::Texture2D(int width, int height, pixtype type, int channels, ScopedTe
         handle_ = pool->obtainTexture(width, height, channels, type, scope, lock);
         fromPool_ = pool;
         assert(*(handle_) != 0);
-        glBindTexture(GL_TEXTURE_2D, *handle_);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, *handle_);
         updateParams();
     } else {
         createHandle();
         assert(*(handle_) != 0);
-        glBindTexture(GL_TEXTURE_2D, *handle_);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, *handle_);
         updateParams();
         clear();
 #ifdef DEBUG
@@ -384,8 +392,8 @@ void Texture2D::interpolation(intp minIntp, intp magIntp) {
  */
 void Texture2D::unbind(int unit) const {
     assert(unit >= 0);
-    if (unit >= 0) glActiveTexture(GL_TEXTURE0+unit);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    if (unit >= 0) GLStateCache::activeTexture(GL_TEXTURE0+unit);
+    GLStateCache::bindTexture(GL_TEXTURE_2D, 0);
 }
 
 
@@ -398,8 +406,8 @@ void Texture2D::unbind(int unit) const {
  */
 void Texture2D::bind(int unit) const {
     assert(unit >= 0);
-    if (unit >= 0) glActiveTexture(GL_TEXTURE0+unit);
-    glBindTexture(GL_TEXTURE_2D, *(handle_));
+    if (unit >= 0) GLStateCache::activeTexture(GL_TEXTURE0+unit);
+    GLStateCache::bindTexture(GL_TEXTURE_2D, *(handle_));
     if ((paramPending_) || (fromPool_)) {
         updateParams();
         paramPending_ = false;
@@ -507,7 +515,7 @@ void Texture2D::download(T *target) {
 #if !defined(FYUSENET_USE_EGL) && !defined(FYUSENET_USE_WEBGL)
     GLenum tt = (dataType_ == UINT8) ? GL_UNSIGNED_BYTE : GL_FLOAT;
     GLenum fmt = texfmt_[channels_-1];
-    glBindTexture(GL_TEXTURE_2D, *(handle_));
+    GLStateCache::bindTexture(GL_TEXTURE_2D, *(handle_));
     glGetTexImage(GL_TEXTURE_2D, 0, fmt, tt, target);
 #else
     FBO tmp(fyusenet::GfxContextLink(), width_, height_);
@@ -549,7 +557,7 @@ Texture3D::Texture3D(int width, int height, int depth, pixtype type, int channel
     width_(width), height_(height), depth_(depth) {
     createHandle();
     assert(*(handle_.get()) != 0);
-    glBindTexture(GL_TEXTURE_3D, *(handle_));
+    GLStateCache::bindTexture(GL_TEXTURE_3D, *(handle_));
     updateParams();
     if (clear) this->clear();
 }
@@ -670,8 +678,8 @@ uint32_t Texture3D::size() const {
  * @copydoc Texture2D::unbind
  */
 void Texture3D::unbind(int unit) const {
-    if (unit >= 0) glActiveTexture(GL_TEXTURE0+unit);
-    glBindTexture(GL_TEXTURE_3D, 0);
+    if (unit >= 0) GLStateCache::activeTexture(GL_TEXTURE0+unit);
+    GLStateCache::bindTexture(GL_TEXTURE_3D, 0);
 }
 #endif
 
@@ -682,8 +690,8 @@ void Texture3D::unbind(int unit) const {
  * @copydoc Texture2D::bind
  */
 void Texture3D::bind(int unit) const {
-    if (unit >= 0) glActiveTexture(GL_TEXTURE0+unit);
-    glBindTexture(GL_TEXTURE_3D, *(handle_));
+    if (unit >= 0) GLStateCache::activeTexture(GL_TEXTURE0+unit);
+    GLStateCache::bindTexture(GL_TEXTURE_3D, *(handle_));
     if (paramPending_) {
         updateParams();
         paramPending_ = false;
@@ -808,7 +816,7 @@ Texture2DRef::Texture2DRef(GLuint handle, int width, int height, pixtype type,
     dataType_ = type;
     target_ = target;
     handleOwned_ = false;
-    glBindTexture(GL_TEXTURE_2D, *(handle_));
+    GLStateCache::bindTexture(GL_TEXTURE_2D, *(handle_));
     updateParams();
     // NOTE (mw) do not increase alloc count here, since this texture is not ours to track
 }
@@ -828,7 +836,7 @@ Texture2DRef::Texture2DRef(GLuint handle, int width, int height, pixtype type,
  */
 int Texture::channelSize(pixtype type) {
     if (type == INVALID) return 0;
-    if (type <= UINT8_INTEGRAL) return 1;
+    if (type <= INT8_INTEGRAL) return 1;
     if (type <= FLOAT16) return 2;
     return 4;
 }
@@ -20,6 +20,7 @@
 //-------------------------------------- Project  Headers ------------------------------------------
 
 #include "gl_sys.h"
+#include "glstatecache.h"
 
 //------------------------------------------ Constants ---------------------------------------------
 
@@ -62,6 +63,7 @@ class Texture {
         INVALID = 0,                //!< Unsupported/invalid datatype
         UINT8,                      //!< Unsigned 8-bit (normalized)
         UINT8_INTEGRAL,             //!< Unsigned 8-bit (integer)
+        INT8_INTEGRAL,              //!< Signed 8-bit (integer)
         UINT16,                     //!< Unsigned 16-bit (normalized)
         UINT16_INTEGRAL,            //!< Unsigned 16-bit (integer)
         INT16_INTEGRAL,             //!< Signed 16-bit (integer)
@@ -316,7 +318,7 @@ class Texture {
      * memory occupied by the handle.
      */
     static void deleteOwnedHandle(GLuint * handlePtr) {
-        glDeleteTextures(1, handlePtr);
+        GLStateCache::deleteTextures(1, handlePtr);
         delete [] handlePtr;
     }
 
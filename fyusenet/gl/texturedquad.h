@@ -51,7 +51,7 @@ class TexturedQuad : public fyusenet::GfxContextTracker {
      * @pre The %VAO that was used in the initialization is currently active
      */
     void draw() {
-        glDrawArrays(GL_TRIANGLE_FAN,0,4);
+        GLCommandBuffer::drawArrays(GL_TRIANGLE_FAN,0,4);
     }
 
  private:
@@ -63,7 +63,7 @@ void UBO::bindTo(int bindingIndex) {
     glGetError();
 #endif
     bind();
-    glBindBufferBase(target_, bindingIndex, handle_);
+    GLCommandBuffer::bindBufferBase(target_, bindingIndex, handle_);
 #ifdef DEBUG
     int err = glGetError();
     if (err != GL_NO_ERROR) THROW_EXCEPTION_ARGS(GLException,"Error binding buffer (glerr=0x%x)",err);
@@ -84,7 +84,7 @@ void UBO::bindRangeTo(int bindingIndex, int offset, int size) {
     glGetError();
 #endif
     bind();
-    glBindBufferRange(target_, bindingIndex, handle_, offset, size);
+    GLCommandBuffer::bindBufferRange(target_, bindingIndex, handle_, offset, size);
 #ifdef DEBUG
     int err = glGetError();
     if (err != GL_NO_ERROR) THROW_EXCEPTION_ARGS(GLException,"Error binding buffer (glerr=0x%x)",err);
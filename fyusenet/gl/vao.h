@@ -13,6 +13,7 @@
 //-------------------------------------- Project  Headers ------------------------------------------
 
 #include "gl_sys.h"
+#include "glstatecache.h"
 #include "glexception.h"
 #include "../gpu/gfxcontextlink.h"
 #include "../common/logging.h"
@@ -56,7 +57,7 @@ class VAO {
         if (context_.isCurrent()) {
             if (handle_ != 0) {
                 if (bound_) unbind();
-                glDeleteVertexArrays(1,&handle_);
+                GLStateCache::deleteVertexArrays(1,&handle_);
             }
         } else {
             FNLOGE("Trying to destroy VAO from wrong GL context");
@@ -77,7 +78,7 @@ class VAO {
             return false;
         }
 #endif
-        glBindVertexArray(handle_);
+        GLStateCache::bindVertexArray(handle_);
         bound_ = true;
         return true;
     }
@@ -86,8 +87,8 @@ class VAO {
      * @brief Release %VAO binding
      */
     void unbind() {
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER,0);
+        GLStateCache::bindVertexArray(0);
+        GLCommandBuffer::bindBuffer(GL_ARRAY_BUFFER,0);
         bound_ = false;
     }
 
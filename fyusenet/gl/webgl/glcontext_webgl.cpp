@@ -145,6 +145,7 @@ bool GLContext::isDerivedFrom(const GLContextInterface * main) const {
  */
 bool GLContext::makeCurrent() const {
     emscripten_webgl_make_context_current(context_);
+    stateCache_.attach();
     return true;
 }
 
@@ -154,6 +155,7 @@ bool GLContext::makeCurrent() const {
  */
 bool GLContext::releaseCurrent() const {
     if (isCurrent()) {
+        stateCache_.detach();
         return emscripten_webgl_make_context_current(0);
     } else return false;
 }
@@ -198,7 +198,9 @@ bool GLContext::makeCurrent() const {
     if (external_) {
         return false;
     } else {
-        return wglMakeCurrent(device_, context_);
+        if (!wglMakeCurrent(device_, context_)) return false;
+        stateCache_.attach();
+        return true;
     }
 }
 
@@ -208,6 +210,7 @@ bool GLContext::makeCurrent() const {
  */
 bool GLContext::releaseCurrent() const {
     if (isCurrent()) {
+        stateCache_.detach();
         wglMakeCurrent(nullptr, nullptr);
         return true;
     } else return false;
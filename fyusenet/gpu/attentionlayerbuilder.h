@@ -78,6 +78,24 @@ struct AttentionLayerBuilderTempl : GPULayerBuilderTempl<D> {
         return *(D *)this;
     }
 
+    /**
+     * @brief Set number of key/value heads for grouped-query or multi-query attention
+     *
+     * @param num Number of key/value heads, must divide the number of (query) heads
+     *
+     * @return Reference to builder object
+     *
+     * By default, the key and value components of the attention layer have the same number of
+     * heads as the query component. Grouped-query attention uses fewer key/value heads, which are
+     * shared by groups of consecutive query heads (multi-query attention being the special case
+     * of a single key/value head). This reduces the size of the key/value cache by the group
+     * factor.
+     */
+    D & kvHeads(int num) {
+        numKVHeads_ = num;
+        return *(D *)this;
+    }
+
 
     /**
      * @brief Set positional encoding type for query and key matrices
@@ -183,8 +201,46 @@ struct AttentionLayerBuilderTempl : GPULayerBuilderTempl<D> {
         return *(D *)this;
     }
 
+    /**
+     * @brief Set the number of keys per block for tiled attention on multi-token queries
+     *
+     * @param keys Number of keys to process in a single block, or 0 to disable tiling
+     *
+     * @return Reference to builder object
+     *
+     * For queries that consist of more than one token, the attention layer streams over blocks
+     * of keys and computes the softmax in an online fashion, which avoids storing the full
+     * matrix of attention scores (see rudiments::TiledAttention). Setting the block size to 0
+     * reverts to the head-batched computation that materializes the score matrix.
+     */
+    D & keyBlockSize(int keys) {
+        keyBlockSize_ = keys;
+        return *(D *)this;
+    }
+
+    /**
+     * @brief Set the storage type of the key/value cache
+     *
+     * @param type Storage type for the cached keys and values
+     *
+     * @return Reference to builder object
+     *
+     * By default, keys and values are stored at the precision of the compute buffers. As the
+     * cache spans the maximum sequence length and has to be re-read for every new token, its
+     * footprint can be reduced by storing it as half-precision floating-point data (only makes a
+     * difference for \c HIGH_PRECISION builds) or as 8-bit integers. In the latter case, each head
+     * of each token is quantized with its own scale, the dequantization takes place when fetching
+     * the keys and values in the attention computation.
+     */
+    D & kvCache(KVCacheType type) {
+        kvCacheType_ = type;
+        return *(D *)this;
+    }
+
     int numHeads_ = 0;            //!< Number of attention heads
+    int numKVHeads_ = 0;          //!< Number of key/value heads (0 to use the same number as #numHeads_)
     int headDim_ = 0;             //!< Output dimension of each attention head
+    int keyBlockSize_ = 64;       //!< Number of keys per block for tiled attention on multi-token queries (0 to disable tiling)
     int quantGroupSize_ = 0;      //!< For quantized data with quantization grouping, provides the group size for row-wise blocking
     float thetaBase_ = 1.0f;      //!< Base value to compute theta for rotary encoding
     bool autoResidual_ = false;   //!< If set to \c true, the result of the attention layer will be added to its input automatically
@@ -196,6 +252,11 @@ struct AttentionLayerBuilderTempl : GPULayerBuilderTempl<D> {
      */
     PosEncType posEncoding_ = PosEncType::NONE;
 
+    /**
+     * Storage type for the key/value cache
+     */
+    KVCacheType kvCacheType_ = KVCacheType::DEFAULT;
+
     /**
      * Quantization type
      */
@@ -122,8 +122,8 @@ void BatchNormLayer::afterRender() {
  */
 void BatchNormLayer::renderChannelBatch(int outPass, int numRenderTargets, int texOffset) {
     for (int tex = 0; tex < numRenderTargets; tex++) {
-        glActiveTexture(GL_TEXTURE0 + tex);
-        glBindTexture(GL_TEXTURE_2D, inputTextures_.at(tex + texOffset));
+        opengl::GLStateCache::activeTexture(GL_TEXTURE0 + tex);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(tex + texOffset));
     }
     if (currentShader_ != shaders_[numRenderTargets-1].get()) {
         if (currentShader_)
@@ -133,7 +133,7 @@ void BatchNormLayer::renderChannelBatch(int outPass, int numRenderTargets, int t
     }
     BiasScaleBlock *block = blocks_.at(outPass);
     currentShader_->setMappedUniformVec4Array(UNIFORM_BIASSCALE, block->biasScale_, numRenderTargets * 2);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *) 0);
+    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *) 0);
 }
 
 
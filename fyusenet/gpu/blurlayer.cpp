@@ -123,8 +123,8 @@ void BlurLayer::computeAverageWeights() {
  */
 void BlurLayer::renderChannelBatch(int outPass, int numRenderTargets, int texOffset) {
     for (int tex=0; tex < numRenderTargets; tex++) {
-        glActiveTexture(GL_TEXTURE0+tex);
-        glBindTexture(GL_TEXTURE_2D,inputTextures_.at(tex+texOffset));
+        opengl::GLStateCache::activeTexture(GL_TEXTURE0+tex);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputTextures_.at(tex+texOffset));
     }
     if (currentShader_ != shaders_[numRenderTargets-1].get()) {
         if (currentShader_) currentShader_->unbind(true);
@@ -132,7 +132,7 @@ void BlurLayer::renderChannelBatch(int outPass, int numRenderTargets, int texOff
         currentShader_->bind(shaderStates_[numRenderTargets-1].get());
         currentShader_->setMappedUniformVec4Array(SHADER_WEIGHTS,kernelWeights_,kernelSize_*kernelSize_);
     }
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *)0);
+    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *)0);
 }
 
 
@@ -0,0 +1,313 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Sparse Compaction Layer
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <cassert>
+#include <cstring>
+#include <memory>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "../gl/glexception.h"
+#include "../gl/glinfo.h"
+#include "../common/logging.h"
+#include "../common/miscdefs.h"
+#include "deep/deeptiler.h"
+#include "compactlayer.h"
+
+namespace fyusion::fyusenet::gpu {
+
+//-------------------------------------- Global Variables ------------------------------------------
+
+
+//-------------------------------------- Local Definitions -----------------------------------------
+
+
+/*##################################################################################################
+#                                   P U B L I C  F U N C T I O N S                                 #
+##################################################################################################*/
+
+/**
+ * @copydoc GPULayerBase::GPULayerBase(const GPULayerBuilder&, int)
+ */
+CompactLayer::CompactLayer(const CompactLayerBuilder & builder, int layerNumber) : GPULayerBase((const GPULayerBuilder &)builder, layerNumber),
+      threshold_(builder.threshold_), deep_(builder.isDeep() || builder.argmax_), argmax_(builder.argmax_) {
+    if (flags_ & LayerFlags::RESIDUAL_INPUT) THROW_EXCEPTION_ARGS(FynException, "This layer does not support residual input");
+    if ((builder.slots_[0] <= 0) || (builder.slots_[1] <= 0)) THROW_EXCEPTION_ARGS(FynException, "Illegal slot grid %dx%d", builder.slots_[0], builder.slots_[1]);
+    slots_[0] = builder.slots_[0];
+    slots_[1] = builder.slots_[1];
+    if (deep_) {
+        deep::DeepTiler tiler(builder.type_, width_, height_, inputChannels_, inputChannels_, 1.0f, 1.0f, inputPadding_, inputPadding_);
+        inputTiles_[0] = tiler.numInputTiles(deep::DeepTiler::HORIZONTAL);
+        inputTiles_[1] = tiler.numInputTiles(deep::DeepTiler::VERTICAL);
+        inputSize_[0] = tiler.getInputTextureWidth();
+        inputSize_[1] = tiler.getInputTextureHeight();
+    } else {
+        inputSize_[0] = width_ + 2 * inputPadding_;
+        inputSize_[1] = height_ + 2 * inputPadding_;
+    }
+    viewport_[0] = slots_[0];
+    viewport_[1] = slots_[1] + 1;
+    // GLES only supports additive blending into 32-bit floating-point targets with an extension
+    floatBlend_ = (!GLInfo::isGLES()) || GLInfo::hasExtension("EXT_float_blend");
+    if (!floatBlend_) {
+        FNLOGW("No blending support for 32-bit float targets, using half-precision output for layer %s", getName().c_str());
+        // half-precision floats only represent integers exactly up to 2048
+        if ((width_ > 2048) || (height_ > 2048) || (inputChannels_ > 2048)) {
+            THROW_EXCEPTION_ARGS(FynException, "Tensor size %dx%dx%d exceeds exact half-precision coordinate range in layer %s", width_, height_, inputChannels_, getName().c_str());
+        }
+    }
+}
+
+
+/**
+ * @brief Setup layer by allocating and initializing required GL resources
+ *
+ * @pre OpenGL context that is to be used for rendering must be current to the calling thread
+ */
+void CompactLayer::setup() {
+    std::lock_guard<std::recursive_mutex> lck(processingLock_);
+    CLEAR_GFXERR_DEBUG
+    proxyGeometry();
+    setupShaders();
+    setupFBOs();
+    valid_ = true;
+}
+
+
+/**
+ * @copydoc GPULayerBase::cleanup
+ */
+void CompactLayer::cleanup() {
+    std::lock_guard<std::recursive_mutex> lck(processingLock_);
+    FNET_DEL_AND_CLEAR(pointVerts_)
+    FNET_DEL_AND_CLEAR(pointArray_)
+    if (depthBuffer_) glDeleteRenderbuffers(1, &depthBuffer_);
+    depthBuffer_ = 0;
+    shader_.reset();
+    GPULayerBase::cleanup();
+}
+
+
+/**
+ * @copydoc LayerBase::forward
+ */
+void CompactLayer::forward(uint64_t sequenceNo, StateToken *state) {
+    std::lock_guard<std::recursive_mutex> lck(processingLock_);
+    if (!valid_) THROW_EXCEPTION_ARGS(FynException, "Trying to invoke forward() on invalid layer");
+    CLEAR_GFXERR_DEBUG
+    if (outputChanged_) updateFBOs();
+    opengl::GLStateCache::disable(GL_STENCIL_TEST);
+    opengl::GLStateCache::disable(GL_CULL_FACE);
+    opengl::GLStateCache::disable(GL_SCISSOR_TEST);
+    FBO *fbo = framebuffers_.at(0);
+    fbo->bind();
+    fbo->setWriteMask();
+    opengl::GLStateCache::viewport(0, 0, viewport_[0], viewport_[1]);
+    // empty slots are marked by a negative channel index
+    opengl::GLStateCache::clearColor(0.0f, 0.0f, -1.0f, 0.0f);
+    GLboolean depthmask = GL_TRUE;
+    glGetBooleanv(GL_DEPTH_WRITEMASK, &depthmask);
+    opengl::GLCommandBuffer::depthMask(GL_TRUE);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    opengl::GLStateCache::clearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    pointArray_->bind();
+    shader_->bind();
+    scatter(false);
+    scatter(true);
+    shader_->unbind();
+    pointArray_->unbind();
+    fbo->unbind();
+    opengl::GLCommandBuffer::depthMask(depthmask);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, 0);
+}
+
+
+/**
+ * @copydoc LayerBase::getRequiredInputBuffers
+ */
+std::vector<BufferSpec> CompactLayer::getRequiredInputBuffers() const {
+    std::vector<BufferSpec> result;
+    if (deep_) {
+        result.emplace_back(0, 0, inputSize_[0], inputSize_[1],
+                            TEXTURE_IFORMAT_4, TEXTURE_FORMAT_4, TEXTURE_TYPE_DEFAULT,
+                            BufferSpec::FUNCTION_SOURCE);
+        result.back().dataOrder(BufferSpec::order::GPU_DEEP);
+    } else {
+        int channel = 0;
+        for (int i=0; i < inputChannels_; i += PIXEL_PACKING) {
+            result.emplace_back(channel++, 0, inputSize_[0], inputSize_[1],
+                                TEXTURE_IFORMAT_4, TEXTURE_FORMAT_4, TEXTURE_TYPE_DEFAULT,
+                                BufferSpec::FUNCTION_SOURCE, std::min(inputChannels_ - i, PIXEL_PACKING));
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @copydoc LayerBase::getRequiredOutputBuffers
+ *
+ * The output consists of a single 4-channel 32-bit floating-point texture, as positions
+ * and channel indices may not be representable by half-precision numbers. On GL(ES) systems that
+ * cannot blend into 32-bit floating-point targets (no \c EXT_float_blend), a half-precision
+ * texture is used instead.
+ */
+std::vector<BufferSpec> CompactLayer::getRequiredOutputBuffers() const {
+    std::vector<BufferSpec> result;
+    if (floatBlend_) {
+        result.emplace_back(0, 0, viewport_[0], viewport_[1],
+                            BufferSpec::sizedformat::RGBA32F, BufferSpec::genericformat::RGBA, BufferSpec::dtype::FLOAT32,
+                            BufferSpec::FUNCTION_DEST, PIXEL_PACKING);
+    } else {
+        result.emplace_back(0, 0, viewport_[0], viewport_[1],
+                            BufferSpec::sizedformat::RGBA16F, BufferSpec::genericformat::RGBA, BufferSpec::dtype::FLOAT16,
+                            BufferSpec::FUNCTION_DEST, PIXEL_PACKING);
+    }
+    return result;
+}
+
+
+/*##################################################################################################
+#                               N O N -  P U B L I C  F U N C T I O N S                            #
+##################################################################################################*/
+
+/**
+ * @copydoc GPULayerBase::getInputOrder
+ */
+BufferSpec::order CompactLayer::getInputOrder(int port) const {
+    return (deep_) ? BufferSpec::order::GPU_DEEP : BufferSpec::order::GPU_SHALLOW;
+}
+
+
+/**
+ * @copydoc GPULayerBase::getOutputType
+ */
+BufferSpec::dtype CompactLayer::getOutputType(int port) const {
+    return (floatBlend_) ? BufferSpec::dtype::FLOAT32 : BufferSpec::dtype::FLOAT16;
+}
+
+
+/**
+ * @brief Render scatter points for all input textures
+ *
+ * @param count If \c true, all candidates are accumulated into a single pixel in the last row of
+ *              the output by additive blending, otherwise the candidates are scattered into the
+ *              slots with depth-testing enabled
+ *
+ * @pre The shader and the vertex array are bound and the output FBO is the active render target
+ */
+void CompactLayer::scatter(bool count) {
+    if (count) {
+        opengl::GLStateCache::disable(GL_DEPTH_TEST);
+        opengl::GLStateCache::enable(GL_BLEND);
+        opengl::GLStateCache::blendEquation(GL_FUNC_ADD);
+        opengl::GLStateCache::blendFunc(GL_ONE, GL_ONE);
+        opengl::GLStateCache::viewport(0, slots_[1], 1, 1);
+    } else {
+        opengl::GLStateCache::disable(GL_BLEND);
+        opengl::GLStateCache::enable(GL_DEPTH_TEST);
+        opengl::GLCommandBuffer::depthFunc(GL_LESS);
+        opengl::GLStateCache::viewport(0, 0, slots_[0], slots_[1]);
+    }
+    shader_->setUniformValue("countPass", (count) ? 1 : 0);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    if (deep_) {
+        if (!argmax_) shader_->setUniformValue("channelOffset", 0);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
+        opengl::GLCommandBuffer::drawArraysInstanced(GL_POINTS, 0, width_ * height_, (argmax_) ? 1 : inputChannels_);
+    } else {
+        for (int tex=0; tex < (int)inputTextures_.size(); tex++) {
+            shader_->setUniformValue("channelOffset", tex * PIXEL_PACKING);
+            opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(tex));
+            opengl::GLCommandBuffer::drawArraysInstanced(GL_POINTS, 0, width_ * height_, std::min(PIXEL_PACKING, inputChannels_ - tex * PIXEL_PACKING));
+        }
+    }
+    if (count) opengl::GLStateCache::disable(GL_BLEND);
+    else opengl::GLStateCache::disable(GL_DEPTH_TEST);
+}
+
+
+/**
+ * @brief Create proxy geometry for the scatter operation
+ *
+ * The scatter operation renders one point per spatial element of the input tensor, which is
+ * identified by its linear index. Channels are handled by instancing.
+ */
+void CompactLayer::proxyGeometry() {
+    int points = width_ * height_;
+    std::unique_ptr<GLuint[]> indices(new GLuint[points]);
+    for (GLuint i=0, *ptr=indices.get(); i < (GLuint)points; i++) ptr[i] = i;
+    pointArray_ = new VAO(context_);
+    pointArray_->bind();
+    pointVerts_ = new VBO(context_);
+    pointArray_->enableArray(0);
+    pointVerts_->setBufferData((void *)indices.get(), (GLsizei)(points * sizeof(GLuint)), GL_STATIC_DRAW);
+    pointVerts_->bind();
+    pointArray_->setVertexAttributeBuffer(0, 1, GL_UNSIGNED_INT, 0, 0);
+    pointArray_->unbind();
+}
+
+
+/**
+ * @brief Compile shader that performs the scatter operation and set static uniforms
+ */
+void CompactLayer::setupShaders() {
+    char preproc[256] = {0};
+    if (argmax_) strncpy(preproc, "#define ARGMAX_INPUT\n", sizeof(preproc)-1);
+    else if (deep_) strncpy(preproc, "#define DEEP_INPUT\n", sizeof(preproc)-1);
+    shader_ = compileShaderPair("shaders/compact.vert", "shaders/compact.frag", preproc, typeid(this));
+    try {
+        shader_->bindAttributeLocation("attributes0", 0);
+        shader_->link();
+    } catch (GLException& ex) {
+        FNLOGE("Cannot link shader for layer %s", getName().c_str());
+        throw;
+    }
+    shader_->bind();
+    shader_->setUniformValue("inputLayer0", 0);
+    shader_->setUniformVec4("geometry", width_, height_, inputPadding_, inputTiles_[0]);
+    shader_->setUniformVec2("slots", slots_[0], slots_[1]);
+    shader_->setUniformValue("threshold", threshold_);
+    shader_->unbind();
+}
+
+
+/**
+ * @copydoc GPULayerBase::setupFBOs
+ */
+void CompactLayer::setupFBOs() {
+    if (outputTextures_.empty()) THROW_EXCEPTION_ARGS(FynException, "No output texture set in layer %s", getName().c_str());
+    FBO *fbo = new FBO(context_, viewport_[0], viewport_[1], outputTextures_.at(0));
+    glGenRenderbuffers(1, &depthBuffer_);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, viewport_[0], viewport_[1]);
+    fbo->addRenderbuffer(GL_DEPTH_ATTACHMENT, depthBuffer_);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    fbo->unbind();
+    framebuffers_.push_back(fbo);
+    outputChanged_ = false;
+}
+
+
+/**
+ * @copydoc GPULayerBase::updateFBOs
+ */
+void CompactLayer::updateFBOs() {
+    framebuffers_.at(0)->bind();
+    framebuffers_.at(0)->updateColorAttachment(GL_COLOR_ATTACHMENT0, outputTextures_.at(0));
+    framebuffers_.at(0)->unbind();
+    outputChanged_ = false;
+}
+
+} // fyusion::fyusenet::gpu namespace
+
+// vim: set expandtab ts=4 sw=4:
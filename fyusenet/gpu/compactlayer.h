@@ -0,0 +1,109 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Sparse Compaction Layer (Header)
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <vector>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "../gl/gl_sys.h"
+#include "../gl/shaderprogram.h"
+#include "../gl/fbo.h"
+#include "../gl/vao.h"
+#include "../gl/vbo.h"
+#include "../base/bufferspec.h"
+#include "gpulayerbase.h"
+#include "compactlayerbuilder.h"
+
+//------------------------------------- Public Declarations ----------------------------------------
+namespace fyusion::fyusenet::gpu {
+
+/**
+ * @brief Layer that compacts sparse results into a small fixed-size texture before download
+ *
+ * Layers like NonMaxSuppression2D or deep::DeepArgMaxLayer produce dense textures in which only a
+ * handful of elements are of interest. Instead of downloading and scanning the full texture on
+ * the CPU, this layer emits the surviving elements as a list of (x, y, channel, score) tuples,
+ * which only occupies a few hundred bytes.
+ *
+ * Compaction is done by a scatter operation in the vertex shader (similar to the one in
+ * sequence::TokenScoringLayer): one point is rendered per spatial element and channel of the
+ * input. Points with a score below the threshold are discarded, all others are rendered into
+ * a grid of slots, where each slot covers a rectangular cell of the spatial input domain. The
+ * depth-testing hardware is used to retain only the candidate with the highest score per slot.
+ *
+ * The output of this layer is a 4-channel 32-bit floating-point texture (16-bit on GL(ES)
+ * systems without \c EXT_float_blend, see getRequiredOutputBuffers()) with a size of
+ * <tt>columns x (rows+1)</tt> pixels, where the first \c rows rows contain the slots. Each
+ * slot contains (x, y, channel, score) of the retained candidate, empty slots have a negative
+ * channel value. The first pixel of the last row contains the total number of candidates in its
+ * first channel, which is larger than the number of occupied slots if candidates collided.
+ *
+ * @warning The 16-bit fallback only represents integers exactly up to 2048. Coordinates and
+ *          channel indices are therefore only exact for tensors that do not exceed 2048 in any
+ *          dimension (larger tensors are rejected on those systems) and the candidate count is
+ *          only exact up to 2048 candidates, beyond that it is rounded to the nearest
+ *          representable value and saturates at the half-precision maximum.
+ *
+ * The input may either be a shallow or a deep tensor, or the output of an argmax layer, in which
+ * case the class index is reported as channel and the maximum value is reported as score.
+ *
+ * @see CompactLayerBuilder
+ */
+class CompactLayer : public GPULayerBase {
+ public:
+    // ------------------------------------------------------------------------
+    // Constructor / Destructor
+    // ------------------------------------------------------------------------
+    CompactLayer(const CompactLayerBuilder & builder, int layerNumber);
+
+    // ------------------------------------------------------------------------
+    // Public methods
+    // ------------------------------------------------------------------------
+    void setup() override;
+    void cleanup() override;
+    void forward(uint64_t sequenceNo, StateToken *state) override;
+    [[nodiscard]] std::vector<BufferSpec> getRequiredInputBuffers() const override;
+    [[nodiscard]] std::vector<BufferSpec> getRequiredOutputBuffers() const override;
+
+ protected:
+    // ------------------------------------------------------------------------
+    // Non-public methods
+    // ------------------------------------------------------------------------
+    [[nodiscard]] BufferSpec::order getInputOrder(int port) const override;
+    [[nodiscard]] BufferSpec::dtype getOutputType(int port) const override;
+    void setupFBOs() override;
+    void updateFBOs() override;
+    void setupShaders();
+    void proxyGeometry();
+    void scatter(bool count);
+
+    // ------------------------------------------------------------------------
+    // Member variables
+    // ------------------------------------------------------------------------
+    int slots_[2] = {0, 0};                     //!< Number of slots (horizontal, vertical) in the output
+    float threshold_ = 0.0f;                    //!< Minimum score for a candidate to be retained
+    bool deep_ = false;                         //!< Indicator that the input is a deep tensor
+    bool argmax_ = false;                       //!< Indicator that the input is the output of an argmax layer
+    bool floatBlend_ = true;                    //!< Indicator that additive blending into 32-bit floating-point targets is supported
+    int inputTiles_[2] = {1, 1};                //!< Number of tiles (horizontal, vertical) for deep input
+    int inputSize_[2] = {0, 0};                 //!< Size of the input texture(s)
+    GLuint depthBuffer_ = 0;                    //!< Renderbuffer ID for depth-testing in the scatter pass
+    opengl::VAO * pointArray_ = nullptr;        //!< Vertex array object for the scatter points
+    opengl::VBO * pointVerts_ = nullptr;        //!< Element indices for the scatter points
+    opengl::programptr shader_;                 //!< Shader that performs the scatter operation
+};
+
+} // fyusion::fyusenet::gpu namespace
+
+// vim: set expandtab ts=4 sw=4:
@@ -0,0 +1,115 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Sparse Compaction Layer Builder (Header)
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <string>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "gfxcontextlink.h"
+#include "gpulayerbuilder.h"
+#include "../base/layerflags.h"
+
+//------------------------------------- Public Declarations ----------------------------------------
+
+namespace fyusion::fyusenet::gpu {
+
+/**
+ * @brief Templatized anchor for sparse compaction layer builders on the GPU
+ *
+ * @see CompactLayerBuilder
+ */
+template<typename D = GPULayerBuilderTempl<>>
+struct CompactLayerBuilderTempl : GPULayerBuilderTempl<D> {
+
+    /**
+     * @brief Constructor
+     *
+     * @param name Name to be assigned to the built layer
+     */
+    CompactLayerBuilderTempl(const std::string& name) : GPULayerBuilderTempl<D>(name) {
+        LayerBuilderTempl<D>::type_ = LayerType::COMPACT2D;
+    }
+
+    /**
+     * @brief Set size of the slot grid that the compacted results are written to
+     *
+     * @param columns Number of slots in horizontal direction
+     * @param rows Number of slots in vertical direction
+     *
+     * @return Reference to builder object
+     *
+     * The spatial domain of the input tensor is partitioned into \p columns x \p rows cells of
+     * equal size and each cell maps to exactly one slot in the output. Only the candidate with the
+     * highest score in a cell is retained.
+     */
+    D & slots(int columns, int rows) {
+        slots_[0] = columns;
+        slots_[1] = rows;
+        return *(D *)this;
+    }
+
+    /**
+     * @brief Set minimum score for candidates to be retained
+     *
+     * @param thresh Threshold value, only elements with a score strictly larger than the
+     *               threshold are considered candidates
+     *
+     * @return Reference to builder object
+     */
+    D & threshold(float thresh) {
+        threshold_ = thresh;
+        return *(D *)this;
+    }
+
+    /**
+     * @brief Interpret input as output of an argmax layer
+     *
+     * @return Reference to builder object
+     *
+     * When set, the input tensor is expected to be the (deep) output of an argmax layer, where
+     * the first channel contains the class index and the second channel contains the maximum
+     * value. The class index is then reported as channel and the maximum value as score.
+     */
+    D & argmaxInput() {
+        argmax_ = true;
+        return *(D *)this;
+    }
+
+    int slots_[2] = {16, 16};           //!< Number of slots (horizontal, vertical) in the output
+    float threshold_ = 0.0f;            //!< Minimum score for a candidate to be retained
+    bool argmax_ = false;               //!< Indicator that the input is the output of an argmax layer
+};
+
+
+/**
+ * @brief Builder class for sparse compaction layers on the GPU
+ *
+ * This class is to be used to build layers that compact sparse results (like the output of a
+ * non-maximum suppression or argmax layer) into a small fixed-size texture, such that only a
+ * few hundred bytes have to be downloaded to the CPU.
+ *
+ * @see CompactLayer
+ */
+struct CompactLayerBuilder : CompactLayerBuilderTempl<CompactLayerBuilder> {
+    /**
+     * @brief Constructor
+     *
+     * @param name Name to be assigned to the built layer
+     */
+    CompactLayerBuilder(const std::string & name) : CompactLayerBuilderTempl<CompactLayerBuilder>(name) {}
+};
+
+} // fyusion::fyusenet::gpu namespace
+
+// vim: set expandtab ts=4 sw=4:
@@ -167,13 +167,13 @@ void ConcatLayer::forward(uint64_t sequenceNo, StateToken * state) {
         if (err != GL_NO_ERROR) FNLOGD("HINT: glerror on render entry: 0x%x (%s:%d)[%s]",err,__FILE__,__LINE__,getName().c_str());
 #endif
         if (outputChanged_) updateFBOs();
-        glDisable(GL_DEPTH_TEST);
-        glDisable(GL_STENCIL_TEST);
-        glDisable(GL_CULL_FACE);
-        glDisable(GL_BLEND);
-        glDepthFunc(GL_GEQUAL);
-        glDepthMask(GL_FALSE);
-        glViewport(0,0,viewport_[0],viewport_[1]);
+        opengl::GLStateCache::disable(GL_DEPTH_TEST);
+        opengl::GLStateCache::disable(GL_STENCIL_TEST);
+        opengl::GLStateCache::disable(GL_CULL_FACE);
+        opengl::GLStateCache::disable(GL_BLEND);
+        opengl::GLCommandBuffer::depthFunc(GL_GEQUAL);
+        opengl::GLCommandBuffer::depthMask(GL_FALSE);
+        opengl::GLStateCache::viewport(0,0,viewport_[0],viewport_[1]);
         vertexArray_->bind();
         int blockoffset=0;
         int layeroffset=0;
@@ -182,11 +182,11 @@ void ConcatLayer::forward(uint64_t sequenceNo, StateToken * state) {
         int rem = portChannels_.at(blockoffset);
         ShaderProgram * currentshader = defaultShader_.get();
         currentshader->bind(defaultShaderState_.get());
-        glClearColor(0.0f,0.f,0.0f,0.0f);
+        opengl::GLStateCache::clearColor(0.0f,0.f,0.0f,0.0f);
         for (int outpass=0; outpass < (int)framebuffers_.size(); outpass++) {
             framebuffers_.at(outpass)->bind();
             framebuffers_.at(outpass)->setWriteMask();
-            glClear(GL_COLOR_BUFFER_BIT);
+            opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
             if ((rem < trail) && (outpass < (int)framebuffers_.size()-1)) {
                 trail = rem;
                 blockoffset++;
@@ -200,13 +200,13 @@ void ConcatLayer::forward(uint64_t sequenceNo, StateToken * state) {
                     rem = portChannels_.at(blockoffset);
                 }
             }
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D,inputTextures_.at(layeroffset++));
+            opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+            opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputTextures_.at(layeroffset++));
             if ((shift > 0) || (trail < PIXEL_PACKING)) {
                 int shader = (trail-1)+3*shift;
-                glActiveTexture(GL_TEXTURE1);
-                if (rem > 0) glBindTexture(GL_TEXTURE_2D,inputTextures_.at(layeroffset));
-                else glBindTexture(GL_TEXTURE_2D,inputTextures_.at(layeroffset-1));      // TODO (mw) actually bind a zero-texture here to be clean/r
+                opengl::GLStateCache::activeTexture(GL_TEXTURE1);
+                if (rem > 0) opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputTextures_.at(layeroffset));
+                else opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputTextures_.at(layeroffset-1));      // TODO (mw) actually bind a zero-texture here to be clean/r
                 if (concatShaders_[shader].get() != currentshader) {
                     currentshader->unbind(true);
                     currentshader = concatShaders_[shader].get();
@@ -221,7 +221,7 @@ void ConcatLayer::forward(uint64_t sequenceNo, StateToken * state) {
                 }
             }
             shift = PIXEL_PACKING - trail;
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *)0);
+            opengl::GLCommandBuffer::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *)0);
             framebuffers_.at(outpass)->unbind();
         }
         vertexArray_->unbind();
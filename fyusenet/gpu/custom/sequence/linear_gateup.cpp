@@ -0,0 +1,372 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Fused Gate/Up Projection for Gated MLPs                                     (c) Martin Wawro 2023
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "../../../common/miscdefs.h"
+#include "linear_gateup.h"
+
+//-------------------------------------- Global Variables ------------------------------------------
+
+namespace fyusion::fyusenet::gpu::custom::sequence {
+
+//-------------------------------------- Local Definitions -----------------------------------------
+
+/**
+ * @brief Interleave the columns of two row-major matrices in blocks of \p block columns
+ *
+ * @param first Pointer to first matrix
+ * @param second Pointer to second matrix (same shape as the first one)
+ * @param rows Number of rows in each matrix
+ * @param columns Number of columns in each matrix, must be a multiple of \p block
+ * @param block Number of consecutive columns taken from each matrix in turn
+ *
+ * @return Interleaved matrix with \p rows rows and twice the number of \p columns
+ */
+template<typename T>
+static std::vector<T> interleaveColumns(const T * first, const T * second, int rows, int columns, int block) {
+    std::vector<T> result((size_t)rows * columns * 2);
+    T * out = result.data();
+    for (int row=0; row < rows; row++) {
+        const T * f = first + (size_t)row * columns;
+        const T * s = second + (size_t)row * columns;
+        for (int col=0; col < columns; col += block) {
+            memcpy(out, f + col, block * sizeof(T));
+            memcpy(out + block, s + col, block * sizeof(T));
+            out += 2 * block;
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief Interleave two sets of 4-bit quantization zero-points on a per-pixel basis
+ *
+ * @param first Pointer to zero-points of the first matrix, 8 columns per 32-bit word
+ * @param second Pointer to zero-points of the second matrix, 8 columns per 32-bit word
+ * @param groups Number of quantization groups (rows in the zero-point tables)
+ * @param columns Number of columns in each matrix, must be a multiple of 8
+ *
+ * @return Interleaved zero-point table, each word of it holds one pixel (4 columns) of the first
+ *         and one pixel of the second matrix
+ */
+static std::vector<uint32_t> interleaveZeros(const uint32_t * first, const uint32_t * second, int groups, int columns) {
+    int words = columns / 8;
+    std::vector<uint32_t> result((size_t)groups * words * 2);
+    for (int grp=0, tgt=0; grp < groups; grp++) {
+        for (int pix=0; pix < 2 * words; pix++) {
+            int shift = (pix & 1) * 16;
+            uint32_t f = (first[grp * words + pix / 2] >> shift) & 0xFFFF;
+            uint32_t s = (second[grp * words + pix / 2] >> shift) & 0xFFFF;
+            result[tgt++] = f | (s << 16);
+        }
+    }
+    return result;
+}
+
+
+/*##################################################################################################
+#                                   P U B L I C  F U N C T I O N S                                 #
+##################################################################################################*/
+
+
+/**
+ * @copydoc GPULayerBase::GPULayerBase
+ */
+LinearGateUpLayer::LinearGateUpLayer(const CustomLayerBuilder &builder) : GPULayerBase((GPULayerBuilder &) builder) {
+    using namespace gpu::sequence::rudiments;
+    assert(builder.maxSequenceLen_ > 0);
+    if (!builder.privData_.has_value()) THROW_EXCEPTION_ARGS(FynException, "No private data for layer %s (#%d)", builder.name_.c_str(), builder.number_);
+    auto priv = std::any_cast<const BuilderData &>(builder.privData_);
+    dataType_ = priv.dataType_;
+    quantType_ = priv.quantType_;
+    quantGroupSize_ = priv.quantGroupSize_;
+    gateName_ = priv.gateName_;
+    upName_ = priv.upName_;
+    // the builder specifies the width of a single projection, we output both of them interleaved
+    projChannels_ = outputChannels_;
+    if (projChannels_ % (2 * PIXEL_PACKING)) THROW_EXCEPTION_ARGS(FynException, "Projection width (%d) must be a multiple of %d", projChannels_, 2 * PIXEL_PACKING);
+    outputChannels_ = 2 * projChannels_;
+    // For sequence processing, the height corresponds to the sequence length and the width to the
+    // embedding dimension (divided by 4)
+    width_ = (inputChannels_ + PIXEL_PACKING-1) / PIXEL_PACKING;            // input width
+    height_ = builder.maxSequenceLen_;                                      // input height
+    viewport_[0] = outputChannels_ / PIXEL_PACKING;
+    viewport_[1] = height_;
+    matMul_ = new MatMulConst(preprocessor_, inputChannels_, outputChannels_, height_, dataType_, quantGroupSize_,
+                              false, false, false, builder.context_);
+    hasParameters_ = true;
+}
+
+
+/**
+ * @copydoc GPULayerBase::cleanup
+ */
+void LinearGateUpLayer::cleanup() {
+    FNET_DEL_AND_CLEAR(matMul_);
+    GPULayerBase::cleanup();
+}
+
+
+/**
+ * @copydoc GPULayerBase::setup
+ */
+void LinearGateUpLayer::setup() {
+    CLEAR_GFXERR_DEBUG
+    matMul_->setup();
+    setupFBOs();
+    assert(glGetError() == GL_NO_ERROR);
+    valid_ = true;
+}
+
+
+/**
+ * @copydoc LayerBase::forward
+ */
+void LinearGateUpLayer::forward(uint64_t sequenceNo, StateToken * state) {
+    std::lock_guard<std::recursive_mutex> lck(processingLock_);
+    if (!valid_) THROW_EXCEPTION_ARGS(FynException, "Trying to invoke forward() on invalid layer");
+    if (!state) THROW_EXCEPTION_ARGS(FynException, "Trying to invoke forward() without token state");
+    sequenceLength_ = state->seqLength;
+    opengl::GLStateCache::enable(GL_SCISSOR_TEST);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
+    matMul_->forward(sequenceLength_, 0, framebuffers_.at(0));
+    opengl::GLStateCache::disable(GL_SCISSOR_TEST);
+}
+
+
+/**
+ * @brief Obtain buffer specifiers that are required as output for this layer
+ *
+ * @return Vector of buffer specifiers that specify the format for each required buffer
+ *
+ * @see BufferSpec
+ *
+ * @note The output tensor is twice as wide as a single projection, with the gate projection stored
+ *       in the even and the up projection stored in the odd pixels.
+ */
+std::vector<BufferSpec> LinearGateUpLayer::getRequiredOutputBuffers() const {
+    std::vector<BufferSpec> result;
+    result.push_back(BufferSpec(0, 0,
+                                viewport_[0], height_,
+                                TEXTURE_IFORMAT_4, TEXTURE_FORMAT_4, TEXTURE_TYPE_DEFAULT,
+                                BufferSpec::FUNCTION_DEST).dataOrder(BufferSpec::order::GPU_SEQUENCE));
+    return result;
+}
+
+
+/**
+ * @brief Obtain buffer specifiers that are required as input for this layer
+ *
+ * @return Vector of buffer specifiers that specify the format for each required buffer
+ *
+ * @see BufferSpec
+ */
+std::vector<BufferSpec> LinearGateUpLayer::getRequiredInputBuffers() const {
+    std::vector<BufferSpec> result;
+    result.push_back(BufferSpec(0, 0,
+                                width_, height_,
+                                TEXTURE_IFORMAT_4, TEXTURE_FORMAT_4, TEXTURE_TYPE_DEFAULT,
+                                BufferSpec::FUNCTION_SOURCE).dataOrder(BufferSpec::order::GPU_SEQUENCE));
+    return result;
+}
+
+
+/**
+ * @brief Load parameters from a parameter provider
+ *
+ * @param source Parameter provider to load parameters from
+ *
+ * This function loads the parameters of the gate and the up projection from the \p source and
+ * interleaves them on a per-pixel basis, such that a single matrix multiplication computes both
+ * projections. The parameters are accessed in the provider using the same convention as for
+ * regular linear layers:
+ *   - \c gatename.weights / \c upname.weights with a \c subIndex of 0 for the weights
+ *   - \c gatename.scales / \c upname.scales with a \c subIndex of 3 for the quantization scales
+ *   - \c gatename.zeros / \c upname.zeros with a \c subIndex of 4 for the quantization zero-biases
+ *
+ * Where \c gatename and \c upname are the parameter names that were supplied to the builder.
+ */
+void LinearGateUpLayer::loadParameters(const ParameterProvider * source) {
+    std::lock_guard<std::recursive_mutex> lck(processingLock_);
+    assert(matMul_);
+    if ((quantType_ == qt_type::QT_NONE) || (dataType_ != param_type::WGT_INT4)) {
+        THROW_EXCEPTION_ARGS(FynException, "Not supported yet");
+    }
+    if (inputChannels_ % quantGroupSize_) THROW_EXCEPTION_ARGS(FynException, "Input width (%d) must be a multiple of the quantization group size (%d)", inputChannels_, quantGroupSize_);
+    int groups = inputChannels_ / quantGroupSize_;
+    auto gatewgt = source->get(gateName_ + std::string(".weights"), getNumber(), 0);
+    auto upwgt = source->get(upName_ + std::string(".weights"), getNumber(), 0);
+    if (gatewgt.empty() || upwgt.empty()) THROW_EXCEPTION_ARGS(FynException, "Weight data is empty for layer %s", getName().c_str());
+    // 4-bit weights are packed with 8 consecutive rows per 32-bit word, keep whole pixels together
+    auto weights = interleaveColumns<uint32_t>(reinterpret_cast<const uint32_t *>(std::any_cast<const uint8_t *>(gatewgt.get())),
+                                               reinterpret_cast<const uint32_t *>(std::any_cast<const uint8_t *>(upwgt.get())),
+                                               (inputChannels_ + 7) / 8, projChannels_, PIXEL_PACKING);
+    DefaultDataWrapper<uint8_t> wgtwrap(reinterpret_cast<const uint8_t *>(weights.data()));
+    matMul_->loadWeights(DataBlob(&wgtwrap));
+    auto gatescales = source->get(gateName_ + std::string(".scales"), getNumber(), 3);
+    auto upscales = source->get(upName_ + std::string(".scales"), getNumber(), 3);
+    auto gatezeros = source->get(gateName_ + std::string(".zeros"), getNumber(), 4);
+    auto upzeros = source->get(upName_ + std::string(".zeros"), getNumber(), 4);
+    auto zeros = interleaveZeros(reinterpret_cast<const uint32_t *>(std::any_cast<const uint8_t *>(gatezeros.get())),
+                                 reinterpret_cast<const uint32_t *>(std::any_cast<const uint8_t *>(upzeros.get())),
+                                 groups, projChannels_);
+    DefaultDataWrapper<uint8_t> zerowrap(reinterpret_cast<const uint8_t *>(zeros.data()));
+    if (gatescales.get().type() == typeid(const float *)) {
+        auto scales = interleaveColumns<float>(std::any_cast<const float *>(gatescales.get()),
+                                               std::any_cast<const float *>(upscales.get()),
+                                               groups, projChannels_, PIXEL_PACKING);
+        DefaultDataWrapper<float> scalewrap(scales.data());
+        matMul_->loadQuantizationTables(DataBlob(&scalewrap), DataBlob(&zerowrap));
+    } else {
+        auto scales = interleaveColumns<uint16_t>(std::any_cast<const uint16_t *>(gatescales.get()),
+                                                  std::any_cast<const uint16_t *>(upscales.get()),
+                                                  groups, projChannels_, PIXEL_PACKING);
+        DefaultDataWrapper<uint16_t> scalewrap(scales.data());
+        matMul_->loadQuantizationTables(DataBlob(&scalewrap), DataBlob(&zerowrap));
+    }
+}
+
+
+/**
+ * @brief Generate custom builder for this layer
+ *
+ * @param name Name that should be assigned to this layer
+ * @param gateName Name under which the parameters for the gate projection are stored
+ * @param upName Name under which the parameters for the up projection are stored
+ * @param quant Quantization type for the linear weights
+ * @param dataType Data type for the linear weights
+ * @param quantGroupSize Quantization group size for the linear weights
+ *
+ * @return Pointer to builder which can be pushed to the layer factory
+ *
+ * The number of output channels that is set on the builder refers to a \e single projection.
+ */
+CustomLayerBuilder * LinearGateUpLayer::createBuilder(const std::string& name, const std::string& gateName, const std::string& upName,
+                                                      qt_type quant, param_type dataType, int quantGroupSize) {
+    static auto geninstance = [](const CustomLayerBuilder& bld) {
+        return (GPULayerBase * )(new LinearGateUpLayer(bld));
+    };
+    BuilderData priv;
+    priv.dataType_ = dataType;
+    priv.quantType_ = quant;
+    priv.quantGroupSize_ = quantGroupSize;
+    priv.gateName_ = gateName;
+    priv.upName_ = upName;
+    auto * builder = new CustomLayerBuilder(name, geninstance);
+    builder->privData_ = priv;
+    return builder;
+}
+
+
+/**
+ * @copydoc LayerBase::writeResult
+ */
+void LinearGateUpLayer::writeResult(const char *fileName, bool includePadding) {
+#ifdef DEBUG
+    FBO * fbo = getFBO(0);
+    int owidth = fbo->width();
+    int oheight = fbo->height();
+    int chans = PIXEL_PACKING;
+#ifndef FYUSENET_USE_WEBGL
+    FILE *out = fopen(fileName,"wb");
+    if (out) {
+        float * data = new float[owidth * oheight * chans];
+#else
+    uint8_t * download = new uint8_t[owidth * oheight * chans * sizeof(float)];
+    float * data = (float *)download;
+    if (true) {
+#endif
+        fbo->writeToMemory<float,GL_FLOAT>(data, chans, owidth * oheight * chans * sizeof(float));
+#ifndef FYUSENET_USE_WEBGL
+        fwrite(data, 1, owidth * sequenceLength_ * chans * sizeof(float), out);
+        fclose(out);
+        delete [] data;
+#else
+        EM_ASM({window.download($0, $1, $2);}, download, owidth * sequenceLength_ * chans * sizeof(float), fileName);
+        delete [] download;
+#endif
+    }
+#endif
+}
+
+
+/**
+* @copydoc GPULayerBase::getGPUOutputBuffer
+*/
+GPUBuffer * LinearGateUpLayer::getGPUOutputBuffer(int port) const {
+    if (outputTextures_.empty()) return nullptr;
+    auto * out = createGPUBuffer(viewport_[0], height_, PIXEL_PACKING, getOutputOrder(port), getOutputType(port), 0);
+    pushSliceToBuffer(out, outputTextures_[0], viewport_[0], height_, PIXEL_PACKING, getOutputType(port));
+    return out;
+}
+
+
+/**
+ * @copydoc GPULayerBase::getGPUInputBuffer
+ */
+GPUBuffer * LinearGateUpLayer::getGPUInputBuffer(int port) const {
+    if (inputTextures_.empty()) return nullptr;
+    auto * out = createGPUBuffer(width_, height_, PIXEL_PACKING, getInputOrder(port), getInputType(port), 0);
+    pushSliceToBuffer(out, inputTextures_[0], width_, height_, PIXEL_PACKING, getInputType(port));
+    return out;
+}
+
+/*##################################################################################################
+#                               N O N -  P U B L I C  F U N C T I O N S                            #
+##################################################################################################*/
+
+
+/**
+ * @copydoc GPULayerBase::getInputOrder
+ */
+BufferSpec::order LinearGateUpLayer::getInputOrder(int port) const {
+    return BufferSpec::order::GPU_SEQUENCE;
+}
+
+
+/**
+ * @copydoc GPULayerBase::getOutputOrder
+ */
+BufferSpec::order LinearGateUpLayer::getOutputOrder(int port) const {
+    return BufferSpec::order::GPU_SEQUENCE;
+}
+
+
+/**
+ * @copydoc GPULayerBase::updateFBOs
+ */
+void LinearGateUpLayer::updateFBOs() {
+    framebuffers_[0]->bind();
+    framebuffers_[0]->updateColorAttachment(GL_COLOR_ATTACHMENT0, outputTextures_[0]);
+    framebuffers_[0]->unbind();
+    outputChanged_ = false;
+}
+
+
+/**
+ * @copydoc GPULayerBase::setupFBOs
+ */
+void LinearGateUpLayer::setupFBOs() {
+    assert(outputTextures_.size() == 1);
+    framebuffers_.push_back(new FBO(context(), viewport_[0], height_, outputTextures_.at(0)));
+}
+
+
+} //  fyusion::fyusenet::gpu::custom::sequence namespace
+
+// vim: set expandtab ts=4 sw=4:
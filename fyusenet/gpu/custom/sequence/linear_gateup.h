@@ -0,0 +1,134 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Fused Gate/Up Projection for Gated MLPs (Header)                            (c) Martin Wawro 2023
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <mutex>
+#include <string>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "../../gpulayerbase.h"
+#include "../../customlayerbuilder.h"
+#include "../../sequence/rudiments/matmul_const.h"
+
+class SequenceLayerTest;
+
+//------------------------------------- Public Declarations ----------------------------------------
+
+namespace fyusion::fyusenet::gpu::custom::sequence {
+
+/**
+ * @brief Custom layer that computes the gate and up projections of a gated MLP in one go
+ *
+ * Gated MLPs (as used in LLaMa-type networks) project the same input with two different weight
+ * matrices and combine the results in a Hadamard product:
+ *
+ * \f[ \mathbf{Y} = \left( \sigma(\mathbf{X}\mathbf{W}_g) \circledot \mathbf{X}\mathbf{W}_u \right) \mathbf{W}_d \f]
+ *
+ * Instead of running two separate linear layers over the input, this layer interleaves the columns
+ * of \f$ \mathbf{W}_g \f$ and \f$ \mathbf{W}_u \f$ on a per-pixel basis when loading the
+ * parameters and computes both projections with a single matrix multiplication. The result is a
+ * single output tensor of twice the projection width, that contains the gate projection in the
+ * even and the up projection in the odd pixels. This tensor is meant to be consumed by a
+ * LinearHadamardLayer in \e interleaved mode, which applies the activation function to the gate
+ * and computes the Hadamard product while fetching its input for the down projection.
+ *
+ * Because the multiplication accumulates partial products across several render passes, the
+ * (non-linear) activation cannot be applied inside this layer.
+ *
+ * The parameters are read from the provider under the names of the original gate and up layers,
+ * such that existing parameter files can be used unchanged.
+ *
+ * @warning The current implementation only supports 4-bit quantized weight matrices as of now
+ *
+ * @see MatMulConst, LinearHadamardLayer
+ */
+class LinearGateUpLayer : public gpu::GPULayerBase {
+    friend class ::SequenceLayerTest;
+ public:
+
+    struct BuilderData {
+        qt_type quantType_ = qt_type::QT_NONE;
+        param_type dataType_ = param_type::WGT_FLOAT;
+        int quantGroupSize_ = 0;
+        std::string gateName_;
+        std::string upName_;
+    };
+
+    // ------------------------------------------------------------------------
+    // Constructor / Destructor
+    // ------------------------------------------------------------------------
+    explicit LinearGateUpLayer(const CustomLayerBuilder & builder);
+
+    // ------------------------------------------------------------------------
+    // Public methods
+    // ------------------------------------------------------------------------
+    void forward(uint64_t sequenceNo, StateToken * state) override;
+    void setup() override;
+    void cleanup() override;
+    void setupFBOs() override;
+    void updateFBOs() override;
+    void loadParameters(const ParameterProvider * source) override;
+    [[nodiscard]] std::vector<BufferSpec> getRequiredOutputBuffers() const override;
+    [[nodiscard]] std::vector<BufferSpec> getRequiredInputBuffers() const override;
+    [[nodiscard]] GPUBuffer *getGPUOutputBuffer(int port) const override;
+    [[nodiscard]] GPUBuffer *getGPUInputBuffer(int port) const override;
+    static CustomLayerBuilder * createBuilder(const std::string& name, const std::string& gateName, const std::string& upName,
+                                              qt_type quant, param_type dataType, int quantGroupSize);
+    void writeResult(const char *fileName, bool includePadding) override;
+
+    /**
+     * @brief Retrieve width of a single projection
+     *
+     * @return Number of channels in each of the gate and up projections, the output tensor has
+     *         twice as many channels
+     */
+    [[nodiscard]] int projectionChannels() const {
+        return projChannels_;
+    }
+
+ protected:
+    // ------------------------------------------------------------------------
+    // Non-public methods
+    // ------------------------------------------------------------------------
+    [[nodiscard]] BufferSpec::order getInputOrder(int port) const override;
+    [[nodiscard]] BufferSpec::order getOutputOrder(int port) const override;
+
+    // ------------------------------------------------------------------------
+    // Member variables
+    // ------------------------------------------------------------------------
+    int projChannels_ = 0;         //!< Number of output channels of each projection
+    int quantGroupSize_ = 0;       //!< Quantization group size for quantized data
+    int sequenceLength_ = 0;       //!< # of token in last sequence (not necessarily texture height)
+    std::string gateName_;         //!< Parameter name of the gate projection
+    std::string upName_;           //!< Parameter name of the up projection
+
+    /**
+     * Instance of the matrix-multiplication operator that computes both projections
+     */
+    gpu::sequence::rudiments::MatMulConst * matMul_ = nullptr;
+
+    /**
+    * Type of quantization to be used in computation
+    */
+    qt_type quantType_ = qt_type::QT_NONE;
+
+    /**
+     * Data type for the weights supplied to this layer
+     */
+    param_type dataType_ = param_type::WGT_FLOAT;
+};
+
+} // fyusion::fyusenet::gpu::custom::sequence namespace
+
+// vim: set expandtab ts=4 sw=4:
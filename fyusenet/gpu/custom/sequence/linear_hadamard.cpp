@@ -46,6 +46,7 @@ LinearHadamardLayer::LinearHadamardLayer(const CustomLayerBuilder &builder) : GP
     dataType_ = priv.dataType_;
     quantType_ = priv.quantType_;
     hasBias_ = priv.hasBias_;
+    interleaved_ = priv.interleaved_;
     quantGroupSize_ = priv.quantGroupSize_;
     width_ = (inputChannels_ + PIXEL_PACKING-1) / PIXEL_PACKING;            // input width
     height_ = builder.maxSequenceLen_;                                      // input height
@@ -62,6 +63,11 @@ LinearHadamardLayer::LinearHadamardLayer(const CustomLayerBuilder &builder) : GP
 #endif
     matMul_->customShader(MatMulConst::shtype::FRAG_SHORT, "shaders/custom/sequence/seq_hadamard_matmul_4bit_short.frag");
     matMul_->customShaderPostproc(shaderprep);
+    if (interleaved_) {
+        matMul_->customShaderPreproc([](char * preproc, size_t maxChars, MatMulConst::shtype type) {
+            strncat(preproc, "#define INTERLEAVED_INPUT\n", maxChars);
+        });
+    }
 }
 
 
@@ -71,7 +77,7 @@ LinearHadamardLayer::LinearHadamardLayer(const CustomLayerBuilder &builder) : GP
  */
 void LinearHadamardLayer::cleanup() {
     GLuint tex[4] = {weightData_, scaleData_, zeroData_, biasData_};
-    glDeleteTextures(4, tex);
+    opengl::GLStateCache::deleteTextures(4, tex);
     FNET_DEL_AND_CLEAR(matMul_);
     GPULayerBase::cleanup();
 }
@@ -102,18 +108,19 @@ void LinearHadamardLayer::forward(uint64_t sequenceNo, StateToken * state) {
         THROW_EXCEPTION_ARGS(FynException, "No residual texture passed");
     }
     sequenceLength_ = state->seqLength;
-    if (inputTextures_.size() != 2) THROW_EXCEPTION_ARGS(FynException, "Invalid number of input textures (need 2 found %d)", (int)inputTextures_.size());
-    glEnable(GL_SCISSOR_TEST);
-    for (int i=0; i < 2; i++) {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, inputTextures_.at(i));
+    int numinputs = (interleaved_) ? 1 : 2;
+    if ((int)inputTextures_.size() != numinputs) THROW_EXCEPTION_ARGS(FynException, "Invalid number of input textures (need %d found %d)", numinputs, (int)inputTextures_.size());
+    opengl::GLStateCache::enable(GL_SCISSOR_TEST);
+    for (int i=0; i < numinputs; i++) {
+        opengl::GLStateCache::activeTexture(GL_TEXTURE0 + i);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(i));
     }
     if (flags_ & LayerFlags::RESIDUAL_INPUT) {
-        glActiveTexture(GL_TEXTURE0 + mm::RESIDUAL_UNIT);
-        glBindTexture(GL_TEXTURE_2D, residualTextures_.at(0));
+        opengl::GLStateCache::activeTexture(GL_TEXTURE0 + mm::RESIDUAL_UNIT);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, residualTextures_.at(0));
     }
     matMul_->forward(state->seqLength, 0, framebuffers_.at(0));
-    glDisable(GL_SCISSOR_TEST);
+    opengl::GLStateCache::disable(GL_SCISSOR_TEST);
     disableTextureUnits(7);
 }
 
@@ -154,14 +161,16 @@ std::vector<BufferSpec> LinearHadamardLayer::getRequiredOutputBuffers() const {
  */
 std::vector<BufferSpec> LinearHadamardLayer::getRequiredInputBuffers() const {
     std::vector<BufferSpec> result;
-    for (int i=0; i < 2; i++) {
+    int numinputs = (interleaved_) ? 1 : 2;
+    int width = (interleaved_) ? 2 * width_ : width_;
+    for (int i=0; i < numinputs; i++) {
         result.push_back(BufferSpec(0, i,
-                                    width_, height_,
+                                    width, height_,
                                     TEXTURE_IFORMAT_4, TEXTURE_FORMAT_4, TEXTURE_TYPE_DEFAULT,
                                     BufferSpec::FUNCTION_SOURCE).dataOrder(BufferSpec::order::GPU_SEQUENCE));
     }
     if (flags_ & LayerFlags::RESIDUAL_INPUT) {
-        result.push_back(BufferSpec(0, 2,
+        result.push_back(BufferSpec(0, numinputs,
                                     viewport_[0], viewport_[1],
                                     TEXTURE_IFORMAT_4, TEXTURE_FORMAT_4, TEXTURE_TYPE_DEFAULT,
                                     BufferSpec::RESIDUAL_SOURCE).dataOrder(BufferSpec::order::GPU_SEQUENCE));
@@ -230,10 +239,12 @@ CustomLayerBuilder * LinearHadamardLayer::createBuilder(const std::string& name,
  * @param dataType Data type for the linear weights
  * @param quantGroupSize Quantization group size for the linear weights
  * @param bias Whether the operation should apply a bias to the linear part
+ * @param interleaved Whether both operands are supplied as a single interleaved tensor (see
+ *                    LinearGateUpLayer) instead of two separate tensors
  *
  * @return Pointer to builder which can be pushed to the layer factory
  */
-CustomLayerBuilder * LinearHadamardLayer::createBuilder(const std::string& name, qt_type quant, param_type dataType, int quantGroupSize , bool bias) {
+CustomLayerBuilder * LinearHadamardLayer::createBuilder(const std::string& name, qt_type quant, param_type dataType, int quantGroupSize , bool bias, bool interleaved) {
     static auto geninstance = [](const CustomLayerBuilder& bld) {
         return (GPULayerBase * )(new LinearHadamardLayer(bld));
     };
@@ -242,6 +253,7 @@ CustomLayerBuilder * LinearHadamardLayer::createBuilder(const std::string& name,
     priv.dataType_ = dataType;
     priv.quantType_ = quant;
     priv.quantGroupSize_ = quantGroupSize;
+    priv.interleaved_ = interleaved;
     auto * builder = new CustomLayerBuilder(name, geninstance);
     builder->privData_ = priv;
     return builder;
@@ -297,8 +309,9 @@ GPUBuffer * LinearHadamardLayer::getGPUOutputBuffer(int port) const {
  */
 GPUBuffer * LinearHadamardLayer::getGPUInputBuffer(int port) const {
     if (inputTextures_.empty()) return nullptr;
-    auto * out = createGPUBuffer(width_, height_, PIXEL_PACKING, getInputOrder(port), getInputType(port), 0);
-    pushSliceToBuffer(out, inputTextures_[0], width_, height_, PIXEL_PACKING, getInputType(port));
+    int width = (interleaved_) ? 2 * width_ : width_;
+    auto * out = createGPUBuffer(width, height_, PIXEL_PACKING, getInputOrder(port), getInputType(port), 0);
+    pushSliceToBuffer(out, inputTextures_[0], width, height_, PIXEL_PACKING, getInputType(port));
     return out;
 }
 
@@ -336,7 +349,7 @@ void LinearHadamardLayer::postprocShader(opengl::ShaderProgram * shader, gpu::se
     if (!opengl::GLInfo::hasBinding()) {
         assert(shader->isBound());
         shader->setUniformValue("inputLayer0", 0);
-        shader->setUniformValue("inputLayer1", 1);
+        shader->setUniformValue("inputLayer1", 1, true);
         shader->setUniformValue("matrix", 2);
         shader->setUniformValue("scaleData", 3);
         shader->setUniformValue("zeroData", 4);
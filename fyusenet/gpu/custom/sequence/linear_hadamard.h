@@ -40,6 +40,10 @@ namespace fyusion::fyusenet::gpu::custom::sequence {
  *
  * \f[ \mathbf{y} = (\mathbf{x}_1 \circledot \mathbf{x}_2) \mathbf{W} + \mathbf{b} \f]
  *
+ * The two operands are either supplied as two separate input tensors, or as a single \e interleaved
+ * tensor of twice the width, which stores \f$ \mathbf{X}_1 \f$ in the even and \f$ \mathbf{X}_2 \f$
+ * in the odd pixels, as produced by the LinearGateUpLayer.
+ *
  * @warning The current implementation only supports 4-bit quantized weight matrices as of now
  *
  * @see MatMulConst
@@ -53,6 +57,7 @@ class LinearHadamardLayer : public gpu::GPULayerBase {
         param_type dataType_ = param_type::WGT_FLOAT;
         int quantGroupSize_ = 0;
         bool hasBias_ = false;
+        bool interleaved_ = false;
     };
 
     // ------------------------------------------------------------------------
@@ -74,7 +79,7 @@ class LinearHadamardLayer : public gpu::GPULayerBase {
     [[nodiscard]] GPUBuffer *getGPUOutputBuffer(int port) const override;
     [[nodiscard]] GPUBuffer *getGPUInputBuffer(int port) const override;
     static CustomLayerBuilder * createBuilder(const std::string& name, bool bias=false);
-    static CustomLayerBuilder * createBuilder(const std::string& name, qt_type quant=qt_type::QT_NONE, param_type dataType=param_type::WGT_FLOAT, int quantGroupSize=0 , bool bias=false);
+    static CustomLayerBuilder * createBuilder(const std::string& name, qt_type quant=qt_type::QT_NONE, param_type dataType=param_type::WGT_FLOAT, int quantGroupSize=0 , bool bias=false, bool interleaved=false);
     void writeResult(const char *fileName, bool includePadding) override;
 
     /**
@@ -89,7 +94,7 @@ class LinearHadamardLayer : public gpu::GPULayerBase {
      * @copydoc LayerBase::numInputPorts
      */
     [[nodiscard]] int numInputPorts() const override {
-        return 2 + ((flags_ & LayerFlags::RESIDUAL_INPUT) ? 1 : 0);
+        return ((interleaved_) ? 1 : 2) + ((flags_ & LayerFlags::RESIDUAL_INPUT) ? 1 : 0);
     }
 
  protected:
@@ -110,6 +115,7 @@ class LinearHadamardLayer : public gpu::GPULayerBase {
     int quantGroupSize_ = 0;       //!< Quantization group size for quantized data
     int sequenceLength_ = 0;       //!< # of token in last sequence (not necessarily texture height)
     bool hasBias_ = false;         //!< Indicator whether bias data is present
+    bool interleaved_ = false;     //!< Both operands are supplied interleaved in a single input tensor
 
     /**
      *
@@ -97,35 +97,35 @@ void DeepArgMaxLayer::forward(uint64_t sequenceNo, StateToken * state) {
     if (err != GL_NO_ERROR) FNLOGD("HINT: glerror on render entry: 0x%x (%s:%d)[%s]",err,__FILE__,__LINE__,getName().c_str());
 #endif
     if (outputChanged_) updateFBOs();
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_CULL_FACE);
-    glEnable(GL_BLEND);
-    glBlendEquation(GL_MAX);
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_STENCIL_TEST);
+    opengl::GLStateCache::disable(GL_CULL_FACE);
+    opengl::GLStateCache::enable(GL_BLEND);
+    opengl::GLStateCache::blendEquation(GL_MAX);
     float clear = (float)-powf(2,EXPONENT_MAX)-0.5f;
-    glClearColor(clear, clear, clear, clear);
-    glViewport(0, 0, viewport_[0], viewport_[1]);
+    opengl::GLStateCache::clearColor(clear, clear, clear, clear);
+    opengl::GLStateCache::viewport(0, 0, viewport_[0], viewport_[1]);
     pass1FBO_->bind();
     pass1FBO_->setWriteMask();
-    glClear(GL_COLOR_BUFFER_BIT);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
     pass1VAO_->bind();
     pass1Shader_->bind(pass1State_.get());
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D,inputTextures_.at(0));
-    glDrawElements(GL_TRIANGLES,tiler_->numInputTiles()*6,GL_UNSIGNED_SHORT,(const GLvoid *)nullptr);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputTextures_.at(0));
+    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES,tiler_->numInputTiles()*6,GL_UNSIGNED_SHORT,(const GLvoid *)nullptr);
     pass1Shader_->unbind(true);
     pass1VAO_->unbind();
     pass1FBO_->unbind();
-    glDisable(GL_BLEND);
-    glBlendEquation(GL_FUNC_ADD);
+    opengl::GLStateCache::disable(GL_BLEND);
+    opengl::GLStateCache::blendEquation(GL_FUNC_ADD);
     framebuffers_.at(0)->bind();
     framebuffers_.at(0)->setWriteMask();
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    opengl::GLStateCache::clearColor(0.0f, 0.0f, 0.0f, 0.0f);
     pass2VAO_->bind();
     pass2Shader_->bind(pass2State_.get());
-    glClear(GL_COLOR_BUFFER_BIT);
-    glBindTexture(GL_TEXTURE_2D,pass1FBO_->getAttachment());
-    glDrawElements(GL_TRIANGLES,tiler_->numOutputTiles()*6,GL_UNSIGNED_SHORT,(const GLvoid *)nullptr);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,pass1FBO_->getAttachment());
+    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES,tiler_->numOutputTiles()*6,GL_UNSIGNED_SHORT,(const GLvoid *)nullptr);
     pass2VAO_->unbind();
     pass2Shader_->unbind();
 }
@@ -106,10 +106,12 @@ void DeepBatchNormLayer::setupNetworkPolygons(VAO *vao) {
     assert(bnScales_);
     assert(bnBias_);
     DeepFunctionLayer::setupNetworkPolygons(vao);
-    float * attrs1 = new float[tiler_->numOutputTiles() * 4 * PIXEL_PACKING];       // stores scales
-    float * attrs2 = new float[tiler_->numOutputTiles() * 4 * PIXEL_PACKING];       // stores biases
+    const int numtiles = tiler_->numOutputTiles(DeepTiler::BATCH);
+    float * attrs1 = new float[numtiles * 4 * PIXEL_PACKING];       // stores scales
+    float * attrs2 = new float[numtiles * 4 * PIXEL_PACKING];       // stores biases
     int tgtoffset = 0;
-    for (int i=0, chan=0; i < tiler_->numOutputTiles(); i++, chan += PIXEL_PACKING) {
+    for (int i=0; i < numtiles; i++) {
+        int chan = (i % tiler_->numOutputTiles()) * PIXEL_PACKING;
         for (int rep=0; rep < 4; rep++) {
             for (int inner=0; inner < PIXEL_PACKING; inner++) {
                 attrs1[tgtoffset] = bnScales_[chan+inner];
@@ -119,13 +121,13 @@ void DeepBatchNormLayer::setupNetworkPolygons(VAO *vao) {
     }
     vao->enableArray(1);
     scaleAttribs_ = new VBO(context_);
-    scaleAttribs_->setBufferData(attrs1, (GLsizei)(tiler_->numOutputTiles() * 4 * 4 * sizeof(float)), GL_STATIC_DRAW);
+    scaleAttribs_->setBufferData(attrs1, (GLsizei)(numtiles * 4 * 4 * sizeof(float)), GL_STATIC_DRAW);
     scaleAttribs_->bind();
     vao->setVertexAttributeBuffer(1,4,GL_FLOAT,GL_FALSE,0,0);
     delete [] attrs1;
     biasAttribs_ = new VBO(context_);
     vao->enableArray(2);
-    biasAttribs_->setBufferData(attrs2, (GLsizei)(tiler_->numOutputTiles() * 4 * 4 * sizeof(float)), GL_STATIC_DRAW);
+    biasAttribs_->setBufferData(attrs2, (GLsizei)(numtiles * 4 * 4 * sizeof(float)), GL_STATIC_DRAW);
     biasAttribs_->bind();
     vao->setVertexAttributeBuffer(2,4,GL_FLOAT,GL_FALSE,0,0);
     delete [] attrs2;
@@ -136,10 +138,10 @@ void DeepBatchNormLayer::setupNetworkPolygons(VAO *vao) {
  * @copydoc DeepFunctionLayer::renderChannelBatch
  */
 void DeepBatchNormLayer::renderChannelBatch() {
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D,inputTextures_.at(0));
-    int quads = tiler_->numOutputTiles();
-    glDrawElements(GL_TRIANGLES,quads*6,GL_UNSIGNED_SHORT,(const GLvoid *)nullptr);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputTextures_.at(0));
+    int quads = tiler_->numOutputTiles(DeepTiler::BATCH);
+    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES,quads*6,GL_UNSIGNED_SHORT,(const GLvoid *)nullptr);
 }
 
 
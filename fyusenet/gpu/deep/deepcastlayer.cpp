@@ -61,10 +61,10 @@ void DeepCastLayer::cleanup() {
  * @copydoc DeepFunctionLayer::renderChannelBatch
  */
 void DeepCastLayer::renderChannelBatch() {
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D,inputTextures_.at(0));
-    int quads = tiler_->numOutputTiles();
-    glDrawElements(GL_TRIANGLES,quads*6,GL_UNSIGNED_SHORT,(const GLvoid *)0);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputTextures_.at(0));
+    int quads = tiler_->numOutputTiles(DeepTiler::BATCH);
+    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES,quads*6,GL_UNSIGNED_SHORT,(const GLvoid *)0);
 }
 
 
@@ -118,7 +118,7 @@ void DeepCastLayer::setupShaders() {
         default:
             THROW_EXCEPTION_ARGS(FynException,"Illegal cast target supplied");
     }
-    snprintf(preproc, sizeof(preproc), "define CAST_TO_%s\n",tc);
+    snprintf(preproc, sizeof(preproc), "#define CAST_TO_%s\n",tc);
     preprocessor_.generatePreprocessorPreamble(flags_, preproc, sizeof(preproc)-strlen(preproc)-1);
     shader_ = compileShaderPair("shaders/deep/deepdefault.vert","shaders/deep/deepcast.frag",preproc,typeid(this));
     try {
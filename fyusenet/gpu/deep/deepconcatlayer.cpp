@@ -120,26 +120,26 @@ void DeepConcatLayer::forward(uint64_t sequenceNo, StateToken * state) {
     if (err != GL_NO_ERROR) FNLOGD("HINT: glerror on render entry: 0x%x (%s:%d)[%s]",err,__FILE__,__LINE__,getName().c_str());
 #endif
     if (outputChanged_) updateFBOs();
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_BLEND);
-    glClearColor(0.0f,0.0f,0.0f,0.0f);
-    glViewport(0,0,viewport_[0],viewport_[1]);
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_STENCIL_TEST);
+    opengl::GLStateCache::disable(GL_CULL_FACE);
+    opengl::GLStateCache::disable(GL_BLEND);
+    opengl::GLStateCache::clearColor(0.0f,0.0f,0.0f,0.0f);
+    opengl::GLStateCache::viewport(0,0,viewport_[0],viewport_[1]);
     vertexArray_->bind();
     framebuffers_.at(0)->bind();
     framebuffers_.at(0)->setWriteMask();
-    glClear(GL_COLOR_BUFFER_BIT);         // this is to instruct the tile-engine that we don't need the old tile-content
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);         // this is to instruct the tile-engine that we don't need the old tile-content
     shader_->bind(shaderState_.get());
     for (RenderPassTexEnv env : passEnvironments_) {
         for (int i=0; i < env.numTextures_; i++) {
-            glActiveTexture(GL_TEXTURE0+i);
-            glBindTexture(GL_TEXTURE_2D,inputTextures_.at(env.textureIndices_[i]));
+            opengl::GLStateCache::activeTexture(GL_TEXTURE0+i);
+            opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputTextures_.at(env.textureIndices_[i]));
             //FNLOGI("Pass %d: texunit%d = %d",pass,i,env.TextureIndices[i]);
         }
         shader_->setMappedUniformValue(UNIFORM_NUMTEX,env.numTextures_);
         //FNLOGI("Setting %d textures to shader and elemoffset is %d",env.NumTextures,env.ElementOffset);
-        glDrawElements(GL_TRIANGLES,6*env.numElements_,GL_UNSIGNED_SHORT,(const GLvoid *)(env.elementOffset_*sizeof(short)));
+        opengl::GLCommandBuffer::drawElements(GL_TRIANGLES,6*env.numElements_,GL_UNSIGNED_SHORT,(const GLvoid *)(env.elementOffset_*sizeof(short)));
     }
     shader_->unbind();
     framebuffers_.at(0)->unbind();
@@ -127,30 +127,30 @@ void DeepConvLayerNxN::forward(uint64_t sequenceNo, StateToken * state) {
     if (err != GL_NO_ERROR) FNLOGD("HINT: glerror on render entry: 0x%x (%s:%d)[%s]",err,__FILE__,__LINE__,getName().c_str());
 #endif    
     if (outputChanged_) updateFBOs();
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_CULL_FACE);
-    glEnable(GL_BLEND);
-    glBlendEquationSeparate(GL_FUNC_ADD,GL_FUNC_ADD);
-    glBlendFuncSeparate(GL_ONE,GL_ONE,GL_ONE,GL_ONE);
-    glViewport(0, 0, viewport_[0], viewport_[1]);
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_STENCIL_TEST);
+    opengl::GLStateCache::disable(GL_CULL_FACE);
+    opengl::GLStateCache::enable(GL_BLEND);
+    opengl::GLStateCache::blendEquationSeparate(GL_FUNC_ADD,GL_FUNC_ADD);
+    opengl::GLStateCache::blendFuncSeparate(GL_ONE,GL_ONE,GL_ONE,GL_ONE);
+    opengl::GLStateCache::viewport(0, 0, viewport_[0], viewport_[1]);
     vertexArray_->bind();
     framebuffers_.at(0)->bind();
     framebuffers_.at(0)->setWriteMask();
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
-    glActiveTexture(GL_TEXTURE0+DISP_TEXTURE);
-    glBindTexture(GL_TEXTURE_2D, inputCoordTexture_);
-    glActiveTexture(GL_TEXTURE0+WEIGHT_TEXTURE);
-    glBindTexture(GL_TEXTURE_2D, weightTexture_);
-    glActiveTexture(GL_TEXTURE0+BIAS_TEXTURE);
-    glBindTexture(GL_TEXTURE_2D, biasTexture_);
+    opengl::GLStateCache::clearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0+DISP_TEXTURE);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputCoordTexture_);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0+WEIGHT_TEXTURE);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, weightTexture_);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0+BIAS_TEXTURE);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, biasTexture_);
     if (flags_ & LayerFlags::RESIDUAL_INPUT) {
         if (residualTextures_.empty()) THROW_EXCEPTION_ARGS(FynException,"Residual flag configured, but no such texture found.");
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, residualTextures_.at(0));
+        opengl::GLStateCache::activeTexture(GL_TEXTURE1);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, residualTextures_.at(0));
     }
     if (!partialConv_) nonPartialRender();
     else partialRender();
@@ -170,17 +170,17 @@ void DeepConvLayerNxN::forward(uint64_t sequenceNo, StateToken * state) {
  * @brief Execute rendering steps for larger kernel sizes using multiple passes
  */
 void DeepConvLayerNxN::partialRender() {
-    int tris = tiler_->numOutputTiles();
+    int tris = tiler_->numOutputTiles(DeepTiler::BATCH);
     int instances = tiler_->numInputTiles() * kernel_;
     for (int part=0; part <= numSplits_; part++) {
         shaders_[part]->bind(shaderStates_.at(part).get());
-        glDrawElements(GL_TRIANGLES, tris*6, GL_UNSIGNED_SHORT, (const GLvoid *)0);
+        opengl::GLCommandBuffer::drawElements(GL_TRIANGLES, tris*6, GL_UNSIGNED_SHORT, (const GLvoid *)0);
         shaders_[part]->unbind((instances > 1) || (part < numSplits_));
     }
     if (instances > 1) {
         for (int part = 0; part <= numSplits_; part++) {
             noBiasShaders_[part]->bind(noBiasShaderStates_.at(part).get());
-            glDrawElementsInstanced(GL_TRIANGLES, tris * 6, GL_UNSIGNED_SHORT, (const GLvoid *) 0, instances - 1);
+            opengl::GLCommandBuffer::drawElementsInstanced(GL_TRIANGLES, tris * 6, GL_UNSIGNED_SHORT, (const GLvoid *) 0, instances - 1);
             noBiasShaders_[part]->unbind((part != numSplits_));
         }
     }
@@ -194,13 +194,13 @@ void DeepConvLayerNxN::partialRender() {
 void DeepConvLayerNxN::nonPartialRender() {
     assert(shaders_.size() == 1);
     int instances = tiler_->numInputTiles() * kernel_;
-    int tris = tiler_->numOutputTiles();
+    int tris = tiler_->numOutputTiles(DeepTiler::BATCH);
     shaders_[0]->bind(shaderStates_.at(0).get());
-    glDrawElements(GL_TRIANGLES, tris*6, GL_UNSIGNED_SHORT, (const GLvoid *)0);
+    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES, tris*6, GL_UNSIGNED_SHORT, (const GLvoid *)0);
     shaders_[0]->unbind((instances > 1));
     if (instances > 1)  {
         noBiasShaders_.at(0)->bind(noBiasShaderStates_.at(0).get());
-        glDrawElementsInstanced(GL_TRIANGLES, tris*6, GL_UNSIGNED_SHORT, (const GLvoid *)0, instances-1);
+        opengl::GLCommandBuffer::drawElementsInstanced(GL_TRIANGLES, tris*6, GL_UNSIGNED_SHORT, (const GLvoid *)0, instances-1);
         noBiasShaders_[0]->unbind();
     }
 }
@@ -18,7 +18,7 @@
 #include "../gfxcontextlink.h"
 #include "deepconvlayerbase.h"
 #include "deeplayerbase.h"
-#include "../floatconversion.h"
+#include "../weightcache.h"
 
 namespace fyusion::fyusenet::gpu::deep {
 //-------------------------------------- Global Variables ------------------------------------------
@@ -47,7 +47,7 @@ namespace fyusion::fyusenet::gpu::deep {
  * layer with the parsed data.
  */
 DeepConvLayerBase::DeepConvLayerBase(const ConvLayerBuilder & builder, int layerNumber) : ConvLayerBase(builder, layerNumber),
-    tiler_(new DeepTiler(builder.type_,builder.width(),builder.height(),builder.in(),builder.out(),(float)builder.upsample_[0]/(float)(builder.downsample_[0]),(float)builder.upsample_[1]/(float)(builder.downsample_[1]),builder.inputPadding_,builder.outputPadding_,builder.downsample_[0],builder.downsample_[1],builder.upsample_[0],builder.upsample_[1],builder.kernel_)) {
+    tiler_(new DeepTiler(builder.type_,builder.width(),builder.height(),builder.in(),builder.out(),(float)builder.upsample_[0]/(float)(builder.downsample_[0]),(float)builder.upsample_[1]/(float)(builder.downsample_[1]),builder.inputPadding_,builder.outputPadding_,builder.downsample_[0],builder.downsample_[1],builder.upsample_[0],builder.upsample_[1],builder.kernel_,builder.batchSize_)) {
     viewport_[0] = tiler_->getViewportWidth();
     viewport_[1] = tiler_->getViewportHeight();
     if (GLInfo::getGPUType() == GLInfo::ARM_MALI) {
@@ -59,11 +59,11 @@ DeepConvLayerBase::DeepConvLayerBase(const ConvLayerBuilder & builder, int layer
     }
     if (flags_ & LayerFlags::RESIDUAL_INPUT) {
         // we use a temporary instance of the tiler to get the residual texture size right for the connector
-        DeepTiler restiler(LayerType::RESIDUAL,builder.width(),builder.height(),builder.out(),builder.out(),(float)builder.upsample_[0]/(float)builder.downsample_[0],(float)builder.upsample_[1]/(float)builder.downsample_[1],0,builder.residualPadding_,builder.downsample_[0],builder.downsample_[1],builder.upsample_[0],builder.upsample_[1]);
+        DeepTiler restiler(LayerType::RESIDUAL,builder.width(),builder.height(),builder.out(),builder.out(),(float)builder.upsample_[0]/(float)builder.downsample_[0],(float)builder.upsample_[1]/(float)builder.downsample_[1],0,builder.residualPadding_,builder.downsample_[0],builder.downsample_[1],builder.upsample_[0],builder.upsample_[1],1,builder.batchSize_);
         residualViewport_[0] = restiler.getViewportWidth();
         residualViewport_[1] = restiler.getViewportHeight();
         // the actual tiler to be used for generating the polygons
-        residualTiler_ = new DeepTiler(LayerType::RESIDUAL,builder.width(),builder.height(),builder.out(),builder.out(),(float)builder.upsample_[0]/(float)builder.downsample_[0],(float)builder.upsample_[1]/(float)builder.downsample_[1],builder.residualPadding_,builder.outputPadding_,builder.downsample_[0],builder.downsample_[1],builder.upsample_[0],builder.upsample_[1]);
+        residualTiler_ = new DeepTiler(LayerType::RESIDUAL,builder.width(),builder.height(),builder.out(),builder.out(),(float)builder.upsample_[0]/(float)builder.downsample_[0],(float)builder.upsample_[1]/(float)builder.downsample_[1],builder.residualPadding_,builder.outputPadding_,builder.downsample_[0],builder.downsample_[1],builder.upsample_[0],builder.upsample_[1],1,builder.batchSize_);
     }
     assert(dilation_[0] == dilation_[1]);
     largeDilation_ = (std::max(dilation_[0], dilation_[1]) * (kernel_ - 1)/2) > 7;
@@ -92,7 +92,7 @@ DeepConvLayerBase::DeepConvLayerBase(const ConvLayerBuilder & builder, int layer
  * layer with the parsed data.
  */
 DeepConvLayerBase::DeepConvLayerBase(const GPULayerBuilder & builder, int layerNumber) : ConvLayerBase(builder, layerNumber),
-    tiler_(new DeepTiler(builder.type_,builder.width(),builder.height(),builder.in(),builder.out(),(float)builder.upsample_[0]/(float)(builder.downsample_[0]),(float)builder.upsample_[1]/(float)(builder.downsample_[1]),builder.inputPadding_,builder.outputPadding_,1,1,1,1,1)) {
+    tiler_(new DeepTiler(builder.type_,builder.width(),builder.height(),builder.in(),builder.out(),(float)builder.upsample_[0]/(float)(builder.downsample_[0]),(float)builder.upsample_[1]/(float)(builder.downsample_[1]),builder.inputPadding_,builder.outputPadding_,1,1,1,1,1,builder.batchSize_)) {
     viewport_[0] = tiler_->getViewportWidth();
     viewport_[1] = tiler_->getViewportHeight();
     if (GLInfo::getGPUType() == GLInfo::ARM_MALI) {
@@ -104,11 +104,11 @@ DeepConvLayerBase::DeepConvLayerBase(const GPULayerBuilder & builder, int layerN
     }
     if (flags_ & LayerFlags::RESIDUAL_INPUT) {
         // we use a temporary instance of the tiler to get the residual texture size right for the connector
-        DeepTiler restiler(LayerType::RESIDUAL,builder.width(),builder.height(),builder.out(),builder.out(),(float)builder.upsample_[0]/(float)builder.downsample_[0],(float)builder.upsample_[1]/(float)builder.downsample_[1],0,builder.residualPadding_,builder.downsample_[0],builder.downsample_[1],builder.upsample_[0],builder.upsample_[1]);
+        DeepTiler restiler(LayerType::RESIDUAL,builder.width(),builder.height(),builder.out(),builder.out(),(float)builder.upsample_[0]/(float)builder.downsample_[0],(float)builder.upsample_[1]/(float)builder.downsample_[1],0,builder.residualPadding_,builder.downsample_[0],builder.downsample_[1],builder.upsample_[0],builder.upsample_[1],1,builder.batchSize_);
         residualViewport_[0] = restiler.getViewportWidth();
         residualViewport_[1] = restiler.getViewportHeight();
         // the actual tiler to be used for generating the polygons
-        residualTiler_ = new DeepTiler(LayerType::RESIDUAL,builder.width(),builder.height(),builder.out(),builder.out(),(float)builder.upsample_[0]/(float)builder.downsample_[0],(float)builder.upsample_[1]/(float)builder.downsample_[1],builder.residualPadding_,builder.outputPadding_,builder.downsample_[0],builder.downsample_[1],builder.upsample_[0],builder.upsample_[1]);
+        residualTiler_ = new DeepTiler(LayerType::RESIDUAL,builder.width(),builder.height(),builder.out(),builder.out(),(float)builder.upsample_[0]/(float)builder.downsample_[0],(float)builder.upsample_[1]/(float)builder.downsample_[1],builder.residualPadding_,builder.outputPadding_,builder.downsample_[0],builder.downsample_[1],builder.upsample_[0],builder.upsample_[1],1,builder.batchSize_);
     }
 #ifdef HIGH_PRECISION
     halfSupport_ = false;
@@ -179,16 +179,15 @@ void DeepConvLayerBase::cleanup() {
     delete indexBuffer_;
     delete vertexArray_;
     delete textureOffsets_;
-    if (weightTexture_) glDeleteTextures(1, &weightTexture_);
-    if (biasTexture_) glDeleteTextures(1, &biasTexture_);
-    if (inputCoordTexture_) glDeleteTextures(1, &inputCoordTexture_);
+    releaseWeightTexture();
+    if (biasTexture_) opengl::GLStateCache::deleteTextures(1, &biasTexture_);
+    if (inputCoordTexture_) opengl::GLStateCache::deleteTextures(1, &inputCoordTexture_);
     textureOffsets_ = nullptr;
     vertexBuffer_ = nullptr;
     indexBuffer_ = nullptr;
     vertexArray_ = nullptr;
     residualBuffer_ = nullptr;
     inputCoordTexture_ = 0;
-    weightTexture_ = 0;
     biasTexture_ = 0;
     ConvLayerBase::cleanup();
 }
@@ -288,6 +287,10 @@ bool DeepConvLayerBase::isApplicable() const {
  * single channel and can reduce the texture width by 50% . This has to be decoded by the shader
  * later.
  *
+ * If a WeightStore is attached to the parameter provider, the weight texture is shared with other
+ * layers that use identical weights and configuration (e.g. the same layer in another instance
+ * of the same network) instead of being uploaded again.
+ *
  * The parameter provider is called with the following \c name parameters on loading data:
  *   - \c layername.weights for the weight data, \c subIndex set to 0
  *   - \c layername.bias for the bias data, \c subIndex set to 1
@@ -312,52 +315,39 @@ void DeepConvLayerBase::loadParameters(const ParameterProvider *weightSource) {
         THROW_EXCEPTION_ARGS(FynException, "Weights do not fit into GL texture");
     }
     if (auto wgtsrc = weightSource->get(getName()+std::string(".weights"), getNumber(), 0) ; !wgtsrc.empty()) {
-        float * weights = new float[texwidth * texheight * PIXEL_PACKING];
-        memset(weights, 0, texwidth * texheight * PIXEL_PACKING * sizeof(float));
         const float *srcweights = std::any_cast<const float *>(wgtsrc.get());
-        for (int outlayer = 0; outlayer < outputChannels_; outlayer += PIXEL_PACKING) {
-            int orem = ((outputChannels_ - outlayer) >= PIXEL_PACKING) ? PIXEL_PACKING : (outputChannels_ - outlayer);
-            for (int fy = 0; fy < kernel_; fy++) {
-                float *wptr = weights + ((outlayer / PIXEL_PACKING) * kernel_ + fy) * (texwidth * PIXEL_PACKING);
-                // below defines one row in the target texture
-                for (int inlayer = 0; inlayer < inputChannels_; inlayer += PIXEL_PACKING) {
-                    int irem = ((inputChannels_ - inlayer) >= PIXEL_PACKING) ? PIXEL_PACKING : (inputChannels_ - inlayer);
-                    for (int fx = 0; fx < kernel_; fx++) {
-                        for (int ol = outlayer; ol < outlayer + orem; ol++) {
-                            for (int il = inlayer; il < inlayer + irem; il++) {
-                                int srcoffset = ol * (kernel_ * kernel_ * inputChannels_) + ((fy * kernel_ + fx) * inputChannels_) + il;
-                                *wptr = srcweights[srcoffset];
-                                wptr++;
+        char config[128];
+        snprintf(config, sizeof(config), "deepconv:%d:%d:%d:%d:%d:%d", kernel_, inputChannels_, outputChannels_, texwidth, texheight, (int)halfSupport_);
+        releaseWeightTexture();
+        weightTexture_ = WeightCache::obtainTexture(weightSource, getName(), config, srcweights, (size_t)outputChannels_ * kernel_ * kernel_ * inputChannels_,
+                                                    [&](WeightCache::Payload& payload) {
+            float * weights = new float[texwidth * texheight * PIXEL_PACKING];
+            memset(weights, 0, texwidth * texheight * PIXEL_PACKING * sizeof(float));
+            for (int outlayer = 0; outlayer < outputChannels_; outlayer += PIXEL_PACKING) {
+                int orem = ((outputChannels_ - outlayer) >= PIXEL_PACKING) ? PIXEL_PACKING : (outputChannels_ - outlayer);
+                for (int fy = 0; fy < kernel_; fy++) {
+                    float *wptr = weights + ((outlayer / PIXEL_PACKING) * kernel_ + fy) * (texwidth * PIXEL_PACKING);
+                    // below defines one row in the target texture
+                    for (int inlayer = 0; inlayer < inputChannels_; inlayer += PIXEL_PACKING) {
+                        int irem = ((inputChannels_ - inlayer) >= PIXEL_PACKING) ? PIXEL_PACKING : (inputChannels_ - inlayer);
+                        for (int fx = 0; fx < kernel_; fx++) {
+                            for (int ol = outlayer; ol < outlayer + orem; ol++) {
+                                for (int il = inlayer; il < inlayer + irem; il++) {
+                                    int srcoffset = ol * (kernel_ * kernel_ * inputChannels_) + ((fy * kernel_ + fx) * inputChannels_) + il;
+                                    *wptr = srcweights[srcoffset];
+                                    wptr++;
+                                }
+                                wptr += PIXEL_PACKING - irem;
                             }
-                            wptr += PIXEL_PACKING - irem;
+                            wptr += (PIXEL_PACKING - orem) * PIXEL_PACKING;
                         }
-                        wptr += (PIXEL_PACKING - orem) * PIXEL_PACKING;
                     }
                 }
             }
-        }
-        if (!weightTexture_) glGenTextures(1, &weightTexture_);
-        glBindTexture(GL_TEXTURE_2D, weightTexture_);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-#ifndef HIGH_PRECISION
-        if (halfSupport_) {
-            unsigned int *fp16 = FloatConversion::getInstance()->toFP16UI(weights, texwidth * texheight * PIXEL_PACKING);
-#ifdef GL_RGBA32UI
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32UI, texwidth / 2, texheight, 0, GL_RGBA_INTEGER, GL_UNSIGNED_INT, fp16);
-#else
-            glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA32UI_EXT,texwidth/2,texheight,0,GL_RGBA_INTEGER_EXT,GL_UNSIGNED_INT,fp16);
-#endif
-            delete[] fp16;
-        } else {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, texwidth, texheight, 0, GL_RGBA, GL_FLOAT, weights);
-        }
-#else
-        glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA32F,texwidth,texheight,0,GL_RGBA,GL_FLOAT,weights);
-#endif
-        delete[] weights;
+            WeightCache::packRGBA(payload, weights, texwidth, texheight, halfSupport_);
+            delete [] weights;
+        });
+        weightStore_ = weightSource->weightStore();
     }
     //------------------------------------------------------
     // If we have the post-BN flag set, store the batchnorm
@@ -395,7 +385,7 @@ void DeepConvLayerBase::loadParameters(const ParameterProvider *weightSource) {
         }
     }
     if (!biasTexture_) glGenTextures(1,&biasTexture_);
-    glBindTexture(GL_TEXTURE_2D,biasTexture_);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,biasTexture_);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -490,28 +480,32 @@ void DeepConvLayerBase::copyResult(float *memory, bool includePadding) {
             lwidth += 2*inputPadding_;
             lheight += 2*inputPadding_;
         }
-        int layernum=0;
         float * layer = memory;
         for (int fb = 0 ; fb < numFBOs(); fb++ ) {
             memset(data, 0, owidth*oheight*PIXEL_PACKING*sizeof(float));
             FBO *fbo = getFBO(fb);
             assert(fbo->numAttachments() == 1);
             fbo->writeToMemory<float,GL_FLOAT>(data,PIXEL_PACKING,(GLsizei)(owidth * oheight * PIXEL_PACKING * sizeof(float)));
-            for (int ty=0; ty < tiler_->numOutputTiles(DeepTiler::VERTICAL); ty++) {
-                for (int tx=0; tx < tiler_->numOutputTiles(DeepTiler::HORIZONTAL); tx++) {
-                    int rem = ((outputChannels_ - layernum) > PIXEL_PACKING) ? PIXEL_PACKING : outputChannels_ - layernum;
-                    const float * in = data + ((outputPadding_ + ty*(lheight + outputPadding_))*owidth + outputPadding_ + tx*(lwidth + outputPadding_))*PIXEL_PACKING;
-                    float * outptr = (includePadding) ? layer + (outputPadding_ * lwidth) + outputPadding_ : layer;
-                    for (int l=0; l < rem; l++) {
-                        for (int y=0; y < lheight; y++) {
-                            for (int x=0; x < lwidth; x++) {
-                                outptr[x+y*lwidth] = in[(y*owidth+x)*PIXEL_PACKING+l];
+            // batched images are stored consecutively in the target memory
+            for (int img=0; img < tiler_->getBatchSize(); img++) {
+                std::pair<int,int> origin = tiler_->getOutputImageOffset(img);
+                int layernum = 0;
+                for (int ty=0; ty < tiler_->numOutputTiles(DeepTiler::VERTICAL); ty++) {
+                    for (int tx=0; tx < tiler_->numOutputTiles(DeepTiler::HORIZONTAL); tx++) {
+                        int rem = ((outputChannels_ - layernum) > PIXEL_PACKING) ? PIXEL_PACKING : outputChannels_ - layernum;
+                        const float * in = data + ((origin.second + outputPadding_ + ty*(lheight + outputPadding_))*owidth + origin.first + outputPadding_ + tx*(lwidth + outputPadding_))*PIXEL_PACKING;
+                        float * outptr = (includePadding) ? layer + (outputPadding_ * lwidth) + outputPadding_ : layer;
+                        for (int l=0; l < rem; l++) {
+                            for (int y=0; y < lheight; y++) {
+                                for (int x=0; x < lwidth; x++) {
+                                    outptr[x+y*lwidth] = in[(y*owidth+x)*PIXEL_PACKING+l];
+                                }
                             }
+                            layer += lwidth*lheight;
+                            outptr += lwidth*lheight;
                         }
-                        layer += lwidth*lheight;
-                        outptr += lwidth*lheight;
+                        layernum += PIXEL_PACKING;
                     }
-                    layernum += PIXEL_PACKING;
                 }
             }
         }
@@ -606,6 +600,23 @@ void DeepConvLayerBase::shaderPostprocessing(programptr & shader) {
 }
 
 
+/**
+ * @brief Release weight texture of this layer
+ *
+ * Weight textures that were obtained from a WeightStore are handed back to the store, which deletes
+ * them once they are no longer used by any other layer. Textures that are owned by the layer are
+ * deleted directly.
+ */
+void DeepConvLayerBase::releaseWeightTexture() {
+    if (weightTexture_) {
+        if (weightStore_) weightStore_->release(weightTexture_);
+        else opengl::GLStateCache::deleteTextures(1, &weightTexture_);
+    }
+    weightTexture_ = 0;
+    weightStore_ = nullptr;
+}
+
+
 /**
  * @brief Setup a set of proxy polygons that are used to drive the fragment shaders
  *
@@ -615,23 +626,37 @@ void DeepConvLayerBase::shaderPostprocessing(programptr & shader) {
  *
  * As fragment shaders are used to perform the computation, a set of proxy polygons is required
  * to cover the output area of the image set which make up the output tensor.
+ *
+ * For batched tensors, the output tiles of all images are stored in the same set of buffers, such
+ * that a single draw call covers the whole batch. As the input tiles of an image only differ by a
+ * constant offset from the tiles of the first image, the texture coordinates of the output tiles
+ * are shifted by that offset, which leaves the input displacements and the weight/bias indices
+ * unchanged.
  */
 void DeepConvLayerBase::setupNetworkPolygons(VAO *vao) {
+    // vertex indices are 16-bit, 4 vertices per tile
+    if (tiler_->numOutputTiles(DeepTiler::BATCH) * 4 > 65536) {
+        THROW_EXCEPTION_ARGS(FynException, "Too many output tiles (%d) for 16-bit vertex indices in layer %s", tiler_->numOutputTiles(DeepTiler::BATCH), getName().c_str());
+    }
     int offset0=0;
-    float * attrs0 = new float[tiler_->numOutputTiles()*4*4];
-    std::vector<DeepTiler::Tile> tiles = tiler_->createOutputTiles();
-    DeepTiler::Tile deftex = tiler_->getDefaultTextureExtents();
+    const int batch = tiler_->getBatchSize();
+    const int numtiles = tiler_->numOutputTiles(DeepTiler::BATCH);
+    float * attrs0 = new float[numtiles*4*4];
     //---------------------------------------------
     // VBO parts, first the default output tiling
     //---------------------------------------------
-    for (DeepTiler::Tile & tile : tiles) {
-        tile.toFloatVec(attrs0,offset0,4);
-        deftex.toFloatVec(attrs0,offset0+2,4);
-        offset0 += 4*4;
+    for (int img=0; img < batch; img++) {
+        std::vector<DeepTiler::Tile> tiles = tiler_->createOutputTiles(img);
+        DeepTiler::Tile deftex = tiler_->getDefaultTextureExtents(img);
+        for (DeepTiler::Tile & tile : tiles) {
+            tile.toFloatVec(attrs0,offset0,4);
+            deftex.toFloatVec(attrs0,offset0+2,4);
+            offset0 += 4*4;
+        }
     }
     vertexBuffer_ = new VBO(context_);
     vao->enableArray(0);
-    vertexBuffer_->setBufferData(attrs0, (int)(tiler_->numOutputTiles() * 4 * 4 *sizeof(float)),GL_STATIC_DRAW);
+    vertexBuffer_->setBufferData(attrs0, (int)(numtiles * 4 * 4 *sizeof(float)),GL_STATIC_DRAW);
     vertexBuffer_->bind();
     vao->setVertexAttributeBuffer(0,4,GL_FLOAT,GL_FALSE,0,0);
     delete [] attrs0;
@@ -640,17 +665,18 @@ void DeepConvLayerBase::setupNetworkPolygons(VAO *vao) {
     // indices for the convolution coeffs (y-part
     // of the convolution)...
     //---------------------------------------------
-    int * attrs1 = new int[tiler_->numOutputTiles()*2*4];
-    memset(attrs1, 0, tiler_->numOutputTiles()*2*4*sizeof(int));
-    for (int i=0; i < tiler_->numOutputTiles(); i++) {
+    int * attrs1 = new int[numtiles*2*4];
+    memset(attrs1, 0, numtiles*2*4*sizeof(int));
+    for (int i=0; i < numtiles; i++) {
+        int tile = i % tiler_->numOutputTiles();
         for (int j=0; j < 4; j++) {
-            attrs1[(i*4+j) * 2 + 0] = i*kernel_;
-            attrs1[(i*4+j) * 2 + 1] = i;          // to be used for indexing bias texture
+            attrs1[(i*4+j) * 2 + 0] = tile*kernel_;
+            attrs1[(i*4+j) * 2 + 1] = tile;          // to be used for indexing bias texture
         }
     }
     textureOffsets_ = new VBO(context_);
     vao->enableArray(1);
-    textureOffsets_->setBufferData(attrs1, (int)(tiler_->numOutputTiles() * 2 * 4 *sizeof(int)), GL_STATIC_DRAW);
+    textureOffsets_->setBufferData(attrs1, (int)(numtiles * 2 * 4 *sizeof(int)), GL_STATIC_DRAW);
     textureOffsets_->bind();
     vao->setVertexAttributeBuffer(1, 2, GL_INT, 0, 0);
     delete [] attrs1;
@@ -660,16 +686,18 @@ void DeepConvLayerBase::setupNetworkPolygons(VAO *vao) {
     //---------------------------------------------
     if (flags_ & LayerFlags::RESIDUAL_INPUT) {
         assert(residualTiler_->numOutputTiles() == residualTiler_->numInputTiles());
-        float * attrs2 = new float[residualTiler_->numInputTiles()*2*4];
-        std::vector<DeepTiler::Tile> rtiles = residualTiler_->createInputTiles(0,0,0);
+        float * attrs2 = new float[residualTiler_->numInputTiles(DeepTiler::BATCH)*2*4];
         int offset2=0;
-        for (DeepTiler::Tile tile : rtiles) {
-            tile.toFloatVec(attrs2,offset2,2);
-            offset2 += 2*4;
+        for (int img=0; img < batch; img++) {
+            std::vector<DeepTiler::Tile> rtiles = residualTiler_->createInputTiles(0, 0, 0, img);
+            for (DeepTiler::Tile tile : rtiles) {
+                tile.toFloatVec(attrs2,offset2,2);
+                offset2 += 2*4;
+            }
         }
         residualBuffer_ = new VBO(context_);
         vao->enableArray(2);
-        residualBuffer_->setBufferData(attrs2, (int)(residualTiler_->numInputTiles() * 2 * 4 *sizeof(float)),GL_STATIC_DRAW);
+        residualBuffer_->setBufferData(attrs2, (int)(residualTiler_->numInputTiles(DeepTiler::BATCH) * 2 * 4 *sizeof(float)),GL_STATIC_DRAW);
         residualBuffer_->bind();
         vao->setVertexAttributeBuffer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
         delete [] attrs2;
@@ -677,18 +705,18 @@ void DeepConvLayerBase::setupNetworkPolygons(VAO *vao) {
     //---------------------------------------------
     // IBO part
     //---------------------------------------------
-    GLshort * indices = new GLshort[tiler_->numOutputTiles()*6];
+    GLushort * indices = new GLushort[numtiles*6];
     indexBuffer_ = new IBO(context_);
-    for (int i=0; i < tiler_->numOutputTiles(); i++) {
+    for (int i=0; i < numtiles; i++) {
         int offset = i*4;
-        indices[i*6+0] = (GLshort)(offset + 0);
-        indices[i*6+1] = (GLshort)(offset + 1);
-        indices[i*6+2] = (GLshort)(offset + 2);
-        indices[i*6+3] = (GLshort)(offset + 0);
-        indices[i*6+4] = (GLshort)(offset + 2);
-        indices[i*6+5] = (GLshort)(offset + 3);
+        indices[i*6+0] = (GLushort)(offset + 0);
+        indices[i*6+1] = (GLushort)(offset + 1);
+        indices[i*6+2] = (GLushort)(offset + 2);
+        indices[i*6+3] = (GLushort)(offset + 0);
+        indices[i*6+4] = (GLushort)(offset + 2);
+        indices[i*6+5] = (GLushort)(offset + 3);
     }
-    indexBuffer_->setBufferData(indices, (int)(6 * tiler_->numOutputTiles() * sizeof(GLshort)),GL_STATIC_DRAW);
+    indexBuffer_->setBufferData(indices, (int)(6 * numtiles * sizeof(GLushort)),GL_STATIC_DRAW);
     indexBuffer_->bind();
     delete [] indices;
     //---------------------------------------------------------------------------
@@ -701,7 +729,7 @@ void DeepConvLayerBase::setupNetworkPolygons(VAO *vao) {
     // direction...
     //---------------------------------------------------------------------------
     glGenTextures(1,&inputCoordTexture_);
-    glBindTexture(GL_TEXTURE_2D,inputCoordTexture_);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputCoordTexture_);
     glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
@@ -26,6 +26,7 @@
 #include "../../gl/uniformstate.h"
 #include "../../base/bufferspec.h"
 #include "../convlayerbase.h"
+#include "../weightstore.h"
 #include "deeptiler.h"
 #include "deeplayerbase.h"
 
@@ -117,6 +118,7 @@ class DeepConvLayerBase : public ConvLayerBase {
     virtual void setupNetworkPolygons(VAO *vao);
     virtual size_t shaderPreprocessing(char *preproc,size_t maxChars);
     virtual void shaderPostprocessing(programptr & shader);
+    void releaseWeightTexture();
     void setupFBOs() override;
     void updateFBOs() override;
     [[nodiscard]] BufferSpec::order getInputOrder(int port) const override;
@@ -138,6 +140,7 @@ class DeepConvLayerBase : public ConvLayerBase {
     DeepTiler *tiler_ = nullptr;                //!< Pointer to texture tiler for deep tensor format (regular input / output)
     DeepTiler *residualTiler_ = nullptr;        //!< Pointer to texture tiler for deep tensor format (residual input)
     GLuint weightTexture_ = 0;                  //!< Texture handle for the convolution weights
+    WeightStore * weightStore_ = nullptr;       //!< Pointer to store that #weightTexture_ was obtained from (if shared)
     GLuint biasTexture_ = 0;                    //!< Texture handle for the bias data
     GLuint inputCoordTexture_ = 0;              //!< Texture handle for the input coordinates
     VAO * vertexArray_ = nullptr;               //!< Pointer to vertex array object that tracks the buffer objects
@@ -66,9 +66,12 @@ std::vector<BufferSpec> DeepDownloadLayer::getRequiredInputBuffers() const {
  */
 std::vector<BufferSpec> DeepDownloadLayer::getRequiredOutputBuffers() const {
     std::vector<BufferSpec> result;
-    result.push_back(BufferSpec(0, 0, width_, height_,
-                                BufferSpec::sizedformat::SINGLE32F, BufferSpec::genericformat::SINGLE, BufferSpec::dtype::FLOAT,
-                                BufferSpec::CPU_DEST, outputChannels_).device(BufferSpec::csdevice::COMP_STOR_CPU).dataOrder(BufferSpec::order::GPU_DEEP));
+    // one output port per image for batched input
+    for (int port=0; port < tiler_->getBatchSize(); port++) {
+        result.push_back(BufferSpec(0, port, width_, height_,
+                                    BufferSpec::sizedformat::SINGLE32F, BufferSpec::genericformat::SINGLE, BufferSpec::dtype::FLOAT,
+                                    BufferSpec::CPU_DEST, outputChannels_).device(BufferSpec::csdevice::COMP_STOR_CPU).dataOrder(BufferSpec::order::GPU_DEEP));
+    }
     return result;
 }
 
@@ -78,12 +81,12 @@ std::vector<BufferSpec> DeepDownloadLayer::getRequiredOutputBuffers() const {
  */
 void DeepDownloadLayer::addCPUOutputBuffer(CPUBuffer *buf, int port) {
     assert(buf);
-    if (port != 0) THROW_EXCEPTION_ARGS(FynException, "Ports other than 0 are not supported");
+    if ((port < 0) || (port >= tiler_->getBatchSize())) THROW_EXCEPTION_ARGS(FynException, "Illegal port %d supplied", port);
     if (buf->shape().dataOrder() != BufferShape::order::GPU_DEEP) {
         THROW_EXCEPTION_ARGS(FynException, "Buffers supplied to this layer must be in GPU_DEEP order");
     }
-    outputs_.push_back(buf);
-    assert(outputs_.size() <= 1);   // for now we only support one output buffer
+    if ((int)outputs_.size() <= port) outputs_.resize(port+1, nullptr);
+    outputs_[port] = buf;
     outputChanged_ = true;
 }
 
@@ -92,8 +95,8 @@ void DeepDownloadLayer::addCPUOutputBuffer(CPUBuffer *buf, int port) {
  * @copydoc cpu::CPULayerInterface::clearCPUOutputBuffers
  */
 void DeepDownloadLayer::clearCPUOutputBuffers(int port) {
-    assert(port == 0);
-    outputs_.clear();
+    if (port < 0) outputs_.clear();
+    else if (port < (int)outputs_.size()) outputs_[port] = nullptr;
 }
 
 
@@ -101,7 +104,7 @@ void DeepDownloadLayer::clearCPUOutputBuffers(int port) {
  * @copydoc cpu::CPULayerInterface::hasCPUOutputBuffer
  */
 bool DeepDownloadLayer::hasCPUOutputBuffer(int port) const {
-    return (outputs_.size() > 0);
+    return ((port >= 0) && (port < (int)outputs_.size()) && (outputs_.at(port) != nullptr));
 }
 
 
@@ -109,16 +112,15 @@ bool DeepDownloadLayer::hasCPUOutputBuffer(int port) const {
  * @copydoc cpu::CPULayerInterface::getCPUOutputBuffer
  */
 CPUBuffer * DeepDownloadLayer::getCPUOutputBuffer(int port) const {
-    assert(port == 0);
-    if ((int)outputs_.size() <= port) return nullptr;
-    return outputs_.at(0);
+    if ((port < 0) || ((int)outputs_.size() <= port)) return nullptr;
+    return outputs_.at(port);
 }
 
 /**
  * @copydoc DownloadLayerInterface::getOutputShape
  */
 BufferShape DeepDownloadLayer::getOutputShape(int port) const {
-    return {width_, height_, outputChannels_, outputPadding_, BufferShape::type::FLOAT32, BufferShape::order::GPU_DEEP};
+    return {height_, width_, outputChannels_, outputPadding_, BufferShape::type::FLOAT32, BufferShape::order::GPU_DEEP};
 }
 
 /**
@@ -135,7 +137,7 @@ void DeepDownloadLayer::setup() {
  */
 void DeepDownloadLayer::forward(uint64_t sequenceNo, StateToken * state) {
     std::lock_guard<std::recursive_mutex> lck(processingLock_);
-    assert(outputs_.size() == 1);
+    assert((int)outputs_.size() == tiler_->getBatchSize());
     assert(numFBOs() == 1);
     // TODO (mw) implement optional rendering step here (for ReLU)
     ManagedPBO pbo = pboBlit();
@@ -148,7 +150,7 @@ void DeepDownloadLayer::forward(uint64_t sequenceNo, StateToken * state) {
         // Synchronous part, we still use a PBO here though there is no
         // advantage doing that. It just makes the code easier.
         //-------------------------------------------------------------
-        outputs_[0]->readFromPBO(*pbo, BufferShape::type::FLOAT32, sequenceNo);
+        transferPBO(*pbo, outputs_, sequenceNo);
     } else {
 #ifdef FYUSENET_MULTITHREADING
         THROW_EXCEPTION_ARGS(FynException, "Layer is not synchronous");
@@ -175,8 +177,10 @@ void DeepDownloadLayer::asyncForward(uint64_t sequenceNo, StateToken * token, co
     asyncLock_.lock();
     auto thread = AsyncPool::getDerivedContextThread(context());
     threads_[sequenceNo] = thread;
-    thread->setTask(std::bind(&DeepDownloadLayer::readoutPBO, this, thread, pbo, sync, sequenceNo, outputs_[0], callback));
-    if (userCallback_) userCallback_(sequenceNo, outputs_[0], AsyncLayer::DOWNLOAD_COMMENCED);
+    thread->setTask(std::bind(&DeepDownloadLayer::readoutPBO, this, thread, pbo, sync, sequenceNo, outputs_, callback));
+    if (userCallback_) {
+        for (CPUBuffer * buf : outputs_) userCallback_(sequenceNo, buf, AsyncLayer::DOWNLOAD_COMMENCED);
+    }
     asyncLock_.unlock();
 }
 #endif
@@ -205,17 +209,21 @@ void DeepDownloadLayer::wait(uint64_t sequenceNo) {
  *
  * @param buf Pointer to CPUBuffer that is to replace the currently set buffer
  *
- * @param port Output port number, currently only 0 is accepted
+ * @param port Output port number, which is the image index for batched input
  *
  * @note This function does not assume ownership over the supplied \p buf
  */
 void DeepDownloadLayer::updateOutputBuffer(CPUBuffer *buf, int port) {
     assert(buf);
-    if (port != 0) THROW_EXCEPTION_ARGS(FynException, "Ports other than 0 are not supported");
 #ifdef FYUSENET_MULTITHREADING
     asyncLock_.lock();
 #endif
-    if (outputs_.size() != 1) THROW_EXCEPTION_ARGS(FynException, "No buffer position to be updated");
+    if ((port < 0) || (port >= (int)outputs_.size())) {
+#ifdef FYUSENET_MULTITHREADING
+        asyncLock_.unlock();
+#endif
+        THROW_EXCEPTION_ARGS(FynException, "No buffer position to be updated");
+    }
     outputs_[port] = buf;
     outputChanged_ = true;
 #ifdef FYUSENET_MULTITHREADING
@@ -234,18 +242,26 @@ void DeepDownloadLayer::updateOutputBuffer(CPUBuffer *buf, int port) {
  * @return ManagedPBO instance that wraps the %PBO in the operation
  *
  * This function blits the texture data into a %PBO which has sufficient capacity to hold the
- * content.
+ * content. For batched input, the block of each image is read separately and the images are
+ * stored consecutively in the %PBO.
  */
 ManagedPBO DeepDownloadLayer::pboBlit() {
     PBOPool *pool = context_.interface()->getReadPBOPool();
     assert(pool);
-    int paddedwidth = viewport_[0];
-    int paddedheight = viewport_[1];
-    ManagedPBO pbo = pool->getAvailablePBO(paddedwidth, paddedheight, PIXEL_PACKING, bytesPerChan_);
-    pbo->prepareForRead(paddedwidth * paddedheight * PIXEL_PACKING * bytesPerChan_);
+    std::pair<int,int> size = imageSize();
+    const int batch = tiler_->getBatchSize();
+    size_t imgbytes = (size_t)size.first * (size_t)size.second * PIXEL_PACKING * bytesPerChan_;
+    ManagedPBO pbo = pool->getAvailablePBO(size.first, size.second * batch, PIXEL_PACKING, bytesPerChan_);
+    pbo->prepareForRead(imgbytes * batch);
     FBO *fbo = getFBO(0);
     fbo->bind();
-    fbo->copyToPBO(*pbo, (GLenum)GL_FLOAT, PIXEL_PACKING, 0, true);
+    if (batch == 1) fbo->copyToPBO(*pbo, (GLenum)GL_FLOAT, PIXEL_PACKING, 0, true);
+    else {
+        for (int img=0; img < batch; img++) {
+            std::pair<int,int> origin = tiler_->getOutputImageOffset(img);
+            fbo->copyRegionToPBO(*pbo, origin.first, origin.second, size.first, size.second, (GLenum)GL_FLOAT, PIXEL_PACKING, img * imgbytes, true);
+        }
+    }
     fbo->unbind();
     if (async_) pbo.setPending();
     return pbo;
@@ -260,7 +276,7 @@ ManagedPBO DeepDownloadLayer::pboBlit() {
  * @param pbo Reference to a ManagedPBO instance which wraps the PBO to be read out
  * @param sync Handle of the OpenGL fence sync that indicates when the PBO is ready for readout
  * @param sequence Sequence number that refers to the content in the PBO to be read out
- * @param target Pointer to CPUBuffer where the data should be placed in
+ * @param targets CPUBuffer instances where the data should be placed in (one per image)
  * @param callback Callback function in the engine to pass notification about finished download
  *
  * @throw FynException in case the \p sync was not posted on the GL pipeline after less than 5s
@@ -276,16 +292,18 @@ ManagedPBO DeepDownloadLayer::pboBlit() {
  *
  * @see UpDownLayerBuilder, Engine::asyncDownloadDone
  */
-void DeepDownloadLayer::readoutPBO(AsyncPool::GLThread& myThread, opengl::ManagedPBO& pbo, GLsync sync, uint64_t sequence, cpu::CPUBuffer * target, const std::function<void(uint64_t)> & callback) {
+void DeepDownloadLayer::readoutPBO(AsyncPool::GLThread& myThread, opengl::ManagedPBO& pbo, GLsync sync, uint64_t sequence, const std::vector<cpu::CPUBuffer *>& targets, const std::function<void(uint64_t)> & callback) {
     using namespace opengl;
     const GfxContextLink & ctx = myThread.context();
     bool rc = ctx.waitClientSync(sync, 5000000000);        // wait 5s max  (TODO (mw) configurable timeout)
     if (!rc) THROW_EXCEPTION_ARGS(FynException, "Cannot read out texture within 5s for sequence %ld", sequence);
     ctx.removeSync(sync);
-    target->readFromPBO(*pbo, BufferShape::type::FLOAT32, sequence);
+    transferPBO(*pbo, targets, sequence);
     pbo.clearPending();
     if (callback) callback(sequence);
-    if (userCallback_) userCallback_(sequence, target, AsyncLayer::DOWNLOAD_DONE);
+    if (userCallback_) {
+        for (CPUBuffer * target : targets) userCallback_(sequence, target, AsyncLayer::DOWNLOAD_DONE);
+    }
     asyncLock_.lock();
     auto it = threads_.find(sequence);
     assert(it != threads_.end());
@@ -295,6 +313,35 @@ void DeepDownloadLayer::readoutPBO(AsyncPool::GLThread& myThread, opengl::Manage
 #endif
 
 
+/**
+ * @brief Copy %PBO contents to the output buffers
+ *
+ * @param pbo Pointer to %PBO that contains the downloaded data, as written by pboBlit()
+ * @param targets CPUBuffer instances where the data should be placed in (one per image)
+ * @param sequence Sequence number that refers to the content in the PBO
+ */
+void DeepDownloadLayer::transferPBO(opengl::PBO *pbo, const std::vector<cpu::CPUBuffer *>& targets, uint64_t sequence) const {
+    std::pair<int,int> size = imageSize();
+    size_t imgbytes = (size_t)size.first * (size_t)size.second * PIXEL_PACKING * bytesPerChan_;
+    for (int img=0; img < (int)targets.size(); img++) {
+        targets[img]->readFromPBO(pbo, BufferShape::type::FLOAT32, sequence, imgbytes, img * imgbytes);
+    }
+}
+
+
+/**
+ * @brief Retrieve size of the texture data for a single image
+ *
+ * @return Pair of width and height (including padding) of the texture data for a single image
+ *         of the (potentially batched) tensor
+ */
+std::pair<int,int> DeepDownloadLayer::imageSize() const {
+    int width = tiler_->numOutputTiles(DeepTiler::HORIZONTAL) * (tiler_->getOutputWidth() + outputPadding_) + outputPadding_;
+    int height = tiler_->numOutputTiles(DeepTiler::VERTICAL) * (tiler_->getOutputHeight() + outputPadding_) + outputPadding_;
+    return {width, height};
+}
+
+
 /**
  * @copydoc GPULayerBase::setupFBOs()
  */
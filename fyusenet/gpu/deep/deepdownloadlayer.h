@@ -83,6 +83,10 @@ namespace fyusenet::gpu::deep {
  * to be performed on the buffer, those should be relayed to a different thread if performance
  * is of the essence.
  *
+ * For spatially batched input tensors (see DeepTiler), the layer splits the batch into individual
+ * images during the download. Each image is written to its own output port, in the same layout
+ * as an unbatched tensor, the callback is invoked for each image buffer separately.
+ *
  * @see Engine::asyncDownloadDone, UpDownLayerBuilder
  */
 class DeepDownloadLayer : public DeepLayerBase, public cpu::CPULayerInterface, public DownloadLayerInterface, public AsyncLayer {
@@ -169,9 +173,11 @@ class DeepDownloadLayer : public DeepLayerBase, public cpu::CPULayerInterface, p
     virtual void setupFBOs() override;
     virtual void updateFBOs() override;
 #ifdef FYUSENET_MULTITHREADING
-    void readoutPBO(AsyncPool::GLThread& myThread, opengl::ManagedPBO& pbo, GLsync sync, uint64_t sequence, cpu::CPUBuffer *target, const std::function<void(uint64_t)> & callback);
+    void readoutPBO(AsyncPool::GLThread& myThread, opengl::ManagedPBO& pbo, GLsync sync, uint64_t sequence, const std::vector<cpu::CPUBuffer *>& targets, const std::function<void(uint64_t)> & callback);
 #endif
     ManagedPBO pboBlit();
+    void transferPBO(opengl::PBO *pbo, const std::vector<cpu::CPUBuffer *>& targets, uint64_t sequence) const;
+    [[nodiscard]] std::pair<int,int> imageSize() const;
     // ------------------------------------------------------------------------
     // Member variables
     // ------------------------------------------------------------------------
@@ -72,30 +72,30 @@ void DeepDepthwiseConvLayer3x3::forward(uint64_t sequenceNo, StateToken * state)
     if (err != GL_NO_ERROR) FNLOGD("HINT: glerror on render entry: 0x%x (%s:%d)[%s]",err,__FILE__,__LINE__,getName().c_str());
 #endif    
     if (outputChanged_) updateFBOs();
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_BLEND);
-    glViewport(0,0,viewport_[0],viewport_[1]);
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_STENCIL_TEST);
+    opengl::GLStateCache::disable(GL_CULL_FACE);
+    opengl::GLStateCache::disable(GL_BLEND);
+    opengl::GLStateCache::viewport(0,0,viewport_[0],viewport_[1]);
     vertexArray_->bind();
     framebuffers_.at(0)->bind();
     framebuffers_.at(0)->setWriteMask();
-    glClearColor(0.0f,0.0f,0.0f,0.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D,inputTextures_.at(0));
-    glActiveTexture(GL_TEXTURE0+WEIGHT_TEXTURE);
-    glBindTexture(GL_TEXTURE_2D,weightTexture_);
-    glActiveTexture(GL_TEXTURE0+BIAS_TEXTURE);
-    glBindTexture(GL_TEXTURE_2D,biasTexture_);
+    opengl::GLStateCache::clearColor(0.0f,0.0f,0.0f,0.0f);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputTextures_.at(0));
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0+WEIGHT_TEXTURE);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,weightTexture_);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0+BIAS_TEXTURE);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,biasTexture_);
     if (flags_ & LayerFlags::RESIDUAL_INPUT) {
         if (residualTextures_.empty()) THROW_EXCEPTION_ARGS(FynException,"Residual flag configured, but no such texture found.");
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D,residualTextures_.at(0));
+        opengl::GLStateCache::activeTexture(GL_TEXTURE1);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,residualTextures_.at(0));
     }
     int tris = tiler_->numOutputTiles();
     shader_->bind(shaderState_.get());
-    glDrawElements(GL_TRIANGLES,tris*6,GL_UNSIGNED_SHORT,(const GLvoid *)0);
+    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES,tris*6,GL_UNSIGNED_SHORT,(const GLvoid *)0);
     shader_->unbind();
     framebuffers_.at(0)->unbind();
     vertexArray_->unbind();
@@ -9,6 +9,7 @@
 
 //--------------------------------------- System Headers -------------------------------------------
 
+#include <cstdio>
 #include <cstring>
 #include <cassert>
 
@@ -18,7 +19,7 @@
 #include "../gfxcontextlink.h"
 #include "deepdwconvlayerbase.h"
 #include "deeplayerbase.h"
-#include "../floatconversion.h"
+#include "../weightcache.h"
 
 namespace fyusion {
 namespace fyusenet {
@@ -102,11 +103,16 @@ DeepDepthwiseConvLayerBase::DeepDepthwiseConvLayerBase(const ConvLayerBuilder &
  */
 void DeepDepthwiseConvLayerBase::loadParameters(const ParameterProvider *weights) {
     std::lock_guard<std::recursive_mutex> lck(processingLock_);
-    if (!weightTexture_) glGenTextures(1,&weightTexture_);
-    glBindTexture(GL_TEXTURE_2D,weightTexture_);
     if (auto wgtsrc = weights->get(getName() + std::string(".weights"), getNumber(), 0) ; !wgtsrc.empty()) {
         const float *srcweights = std::any_cast<const float *>(wgtsrc.get());
-        createWeightTextureMatrix(srcweights, 0, weightTexture_);
+        char config[128];
+        snprintf(config, sizeof(config), "deepdwconv:%d:%d:%d:%d", kernel_, inputChannels_, channelMultiplier_, (int)halfSupport_);
+        releaseWeightTexture();
+        weightTexture_ = WeightCache::obtainTexture(weights, getName(), config, srcweights, (size_t)inputChannels_ * kernel_ * kernel_ * channelMultiplier_,
+                                                    [&](WeightCache::Payload& payload) {
+            packWeightTextureMatrix(payload, srcweights, 0);
+        });
+        weightStore_ = weights->weightStore();
     }
     // TODO (mw) put into own function -> promote
     //------------------------------------------------------
@@ -141,7 +147,7 @@ void DeepDepthwiseConvLayerBase::loadParameters(const ParameterProvider *weights
         }
     }
     if (!biasTexture_) glGenTextures(1,&biasTexture_);
-    glBindTexture(GL_TEXTURE_2D,biasTexture_);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,biasTexture_);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -171,11 +177,11 @@ void DeepDepthwiseConvLayerBase::setupShaders() {
 
 
 /**
- * @brief Create
+ * @brief Pack weight data into texture payload
  *
+ * @param payload Texture payload that receives the packed (and format-converted) weights
  * @param srcWeights
  * @param winOffset
- * @param weightTexture GL texture handle to store weight data to
  *
  * This function parses the weights stored in the \p srcWeights parameter for usage with the GPU.
  * For \e m channels and a kernel of size \e k (i.e. a \f$ k \times  k \f$ kernel), this function
@@ -217,7 +223,7 @@ void DeepDepthwiseConvLayerBase::setupShaders() {
  * @warning Values of #channelMultiplier_ other than 1 have not been tested (yet), also there is no
  *          implementation for kernel sizes > \c PIXEL_PACKING in the derived classes (yet).
  */
-void DeepDepthwiseConvLayerBase::createWeightTextureMatrix(const float *srcWeights, int winOffset, GLuint weightTexture) {
+void DeepDepthwiseConvLayerBase::packWeightTextureMatrix(WeightCache::Payload& payload, const float *srcWeights, int winOffset) {
     // TODO (mw) check for matrix size here (we should support 4x1, 4x2 and 4x4 for simplicity in the shader)
     // as we are storing 4x4 matrices (with one row padded w/ zeros), we are not dividing by PIXEL_PACKING here
     int winmax = std::min(PIXEL_PACKING,kernel_ - winOffset);
@@ -261,26 +267,7 @@ void DeepDepthwiseConvLayerBase::createWeightTextureMatrix(const float *srcWeigh
             }
         }
     }
-    glBindTexture(GL_TEXTURE_2D,weightTexture);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-#ifndef HIGH_PRECISION
-    if (halfSupport_) {
-        unsigned int * fp16 = FloatConversion::getInstance()->toFP16UI(weights,texwidth*texheight*PIXEL_PACKING);
-#ifdef GL_RGBA32UI
-        glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA32UI,texwidth/2,texheight,0,GL_RGBA_INTEGER,GL_UNSIGNED_INT,fp16);
-#else
-        glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA32UI_EXT,texwidth/2,texheight,0,GL_RGBA_INTEGER_EXT,GL_UNSIGNED_INT,fp16);
-#endif
-        delete [] fp16;
-    } else {
-        glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA16F,texwidth,texheight,0,GL_RGBA,GL_FLOAT,weights);
-    }
-#else
-    glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA32F,texwidth,texheight,0,GL_RGBA,GL_FLOAT,weights);
-#endif
+    WeightCache::packRGBA(payload, weights, texwidth, texheight, halfSupport_);
     delete [] weights;
 }
 
@@ -23,6 +23,7 @@
 #include "../../gl/vao.h"
 #include "../../base/bufferspec.h"
 #include "../convlayerbase.h"
+#include "../weightcache.h"
 #include "deeptiler.h"
 #include "deepconvlayerbase.h"
 
@@ -56,7 +57,7 @@ class DeepDepthwiseConvLayerBase : public DeepConvLayerBase {
     // ------------------------------------------------------------------------
     // Non-public methods
     // ------------------------------------------------------------------------
-    void createWeightTextureMatrix(const float *srcweights, int winOffset, GLuint weightTexture);
+    void packWeightTextureMatrix(WeightCache::Payload& payload, const float *srcweights, int winOffset);
     void setupNetworkPolygons(VAO *vao) override;
     void setupShaders() override;
 
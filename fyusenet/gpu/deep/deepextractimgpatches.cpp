@@ -92,19 +92,19 @@ void DeepExtractImagePatches::forward(uint64_t sequenceNo, StateToken * state) {
     if (err != GL_NO_ERROR) FNLOGD("HINT: glerror on render entry: 0x%x (%s:%d)[%s]",err,__FILE__,__LINE__,getName().c_str());
 #endif
     if (outputChanged_) updateFBOs();
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_BLEND);
-    glViewport(0, 0, viewport_[0], viewport_[1]);
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_STENCIL_TEST);
+    opengl::GLStateCache::disable(GL_CULL_FACE);
+    opengl::GLStateCache::disable(GL_BLEND);
+    opengl::GLStateCache::viewport(0, 0, viewport_[0], viewport_[1]);
     vertexArray_->bind();
     framebuffers_.at(0)->bind();
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    glClear(GL_COLOR_BUFFER_BIT);         // this is to instruct the tile-engine that we don't need the old tile-content
+    opengl::GLStateCache::clearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);         // this is to instruct the tile-engine that we don't need the old tile-content
     shader_->bind(shaderState_.get());
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D,inputTextures_.at(0));
-    glDrawElements(GL_TRIANGLES,6*tiler_->numOutputTiles(),GL_UNSIGNED_SHORT,(const GLvoid *)0);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputTextures_.at(0));
+    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES,6*tiler_->numOutputTiles(),GL_UNSIGNED_SHORT,(const GLvoid *)0);
     framebuffers_.at(0)->unbind();
     vertexArray_->unbind();
     shader_->unbind();
@@ -68,45 +68,45 @@ void DeepGEMMLayer::forward(uint64_t sequenceNo, StateToken * state) {
     if (err != GL_NO_ERROR) FNLOGD("HINT: glerror on render entry: 0x%x (%s:%d)[%s]",err,__FILE__,__LINE__,getName().c_str());
 #endif
     if (outputChanged_) updateFBOs();
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_CULL_FACE);
-    if (tiler_->numInputTiles() <= 1) glDisable(GL_BLEND);
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_STENCIL_TEST);
+    opengl::GLStateCache::disable(GL_CULL_FACE);
+    if (tiler_->numInputTiles() <= 1) opengl::GLStateCache::disable(GL_BLEND);
     else {
-        glEnable(GL_BLEND);
-        glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-        glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
+        opengl::GLStateCache::enable(GL_BLEND);
+        opengl::GLStateCache::blendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+        opengl::GLStateCache::blendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
     }
-    glViewport(0, 0, viewport_[0], viewport_[1]);
+    opengl::GLStateCache::viewport(0, 0, viewport_[0], viewport_[1]);
     vertexArray_->bind();
     framebuffers_.at(0)->bind();
     framebuffers_.at(0)->setWriteMask();
-    glClearColor(0.0f,0.0f,0.0f,0.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D,inputTextures_.at(0));
-    glActiveTexture(GL_TEXTURE0+DISP_TEXTURE);
-    glBindTexture(GL_TEXTURE_2D,inputCoordTexture_);
-    glActiveTexture(GL_TEXTURE0+WEIGHT_TEXTURE);
-    glBindTexture(GL_TEXTURE_2D,weightTexture_);
-    glActiveTexture(GL_TEXTURE0+BIAS_TEXTURE);
-    glBindTexture(GL_TEXTURE_2D,biasTexture_);
+    opengl::GLStateCache::clearColor(0.0f,0.0f,0.0f,0.0f);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputTextures_.at(0));
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0+DISP_TEXTURE);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputCoordTexture_);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0+WEIGHT_TEXTURE);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,weightTexture_);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0+BIAS_TEXTURE);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,biasTexture_);
     if (flags_ & LayerFlags::RESIDUAL_INPUT) {
         if (residualTextures_.empty()) THROW_EXCEPTION_ARGS(FynException,"Residual flag configured, but no such texture found.");
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D,residualTextures_.at(0));
+        opengl::GLStateCache::activeTexture(GL_TEXTURE1);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,residualTextures_.at(0));
     }
     if (usePoints_) {
         int instances = tiler_->numInputTiles();
         int points = tiler_->numOutputTiles();
         shader_->bind(shaderState_.get());
         shader_->setUniformValue("numInputTiles", tiler_->numInputTiles());
-        glDrawArrays(GL_POINTS, 0, points);
+        opengl::GLCommandBuffer::drawArrays(GL_POINTS, 0, points);
         shader_->unbind((instances > 1) ? true : false);
         if (instances > 1) {
             noBiasShader_->bind(noBiasShaderState_.get());
             noBiasShader_->setUniformValue("numInputTiles", tiler_->numInputTiles());
-            glDrawArraysInstanced(GL_POINTS, 0, points, instances-1);
+            opengl::GLCommandBuffer::drawArraysInstanced(GL_POINTS, 0, points, instances-1);
             noBiasShader_->unbind();
         }
     } else {
@@ -114,12 +114,12 @@ void DeepGEMMLayer::forward(uint64_t sequenceNo, StateToken * state) {
         int tris = tiler_->numOutputTiles();
         shader_->bind(shaderState_.get());
         shader_->setUniformValue("numInputTiles", tiler_->numInputTiles());
-        glDrawElements(GL_TRIANGLES, tris*6, GL_UNSIGNED_SHORT, (const GLvoid *)0);
+        opengl::GLCommandBuffer::drawElements(GL_TRIANGLES, tris*6, GL_UNSIGNED_SHORT, (const GLvoid *)0);
         shader_->unbind((instances > 1) ? true : false);
         if (instances > 1) {
             noBiasShader_->bind(noBiasShaderState_.get());
             noBiasShader_->setUniformValue("numInputTiles", tiler_->numInputTiles());
-            glDrawElementsInstanced(GL_TRIANGLES, tris*6, GL_UNSIGNED_SHORT, (const GLvoid *)0,instances-1);
+            opengl::GLCommandBuffer::drawElementsInstanced(GL_TRIANGLES, tris*6, GL_UNSIGNED_SHORT, (const GLvoid *)0,instances-1);
             noBiasShader_->unbind();
         }
     }
@@ -208,7 +208,7 @@ void DeepGEMMLayer::setupNetworkPolygons(VAO *vao) {
         // direction...
         //---------------------------------------------------------------------------
         glGenTextures(1,&inputCoordTexture_);
-        glBindTexture(GL_TEXTURE_2D,inputCoordTexture_);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputCoordTexture_);
         glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
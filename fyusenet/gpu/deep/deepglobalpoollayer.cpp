@@ -65,7 +65,7 @@ void DeepGlobalPoolLayer::cleanup() {
  */
 void DeepGlobalPoolLayer::beforeRender() {
     shader_->bind(shaderState_.get());
-    glDisable(GL_BLEND);
+    opengl::GLStateCache::disable(GL_BLEND);
 }
 
 
@@ -73,10 +73,10 @@ void DeepGlobalPoolLayer::beforeRender() {
  * @copydoc DeepPoolingLayer::renderChannelBatch
  */
 void DeepGlobalPoolLayer::renderChannelBatch() {
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D,inputTextures_.at(0));
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputTextures_.at(0));
     int points = tiler_->numOutputTiles();
-    glDrawArrays(GL_POINTS, 0, points);
+    opengl::GLCommandBuffer::drawArrays(GL_POINTS, 0, points);
 }
 
 
@@ -85,7 +85,7 @@ void DeepGlobalPoolLayer::renderChannelBatch() {
  */
 void DeepGlobalPoolLayer::afterRender() {
     shader_->unbind();
-    glDisable(GL_BLEND);
+    opengl::GLStateCache::disable(GL_BLEND);
 }
 
 
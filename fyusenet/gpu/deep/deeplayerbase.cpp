@@ -45,7 +45,7 @@ DeepLayerBase::DeepLayerBase(const GPULayerBuilder& builder) : DeepLayerBase(bui
  * @copydoc GPULayerBase::GPULayerBase(const GPULayerBuilder&, int)
  */
 DeepLayerBase::DeepLayerBase(const GPULayerBuilder& builder, int layerNumber) : GPULayerBase(builder,layerNumber),
-    tiler_(new DeepTiler(builder.type_, builder.width(), builder.height(), builder.in(), builder.out(), (float)builder.upsample_[0]/(float)builder.downsample_[0], (float)builder.upsample_[1]/(float)builder.downsample_[1] ,builder.inputPadding_, builder.outputPadding_, builder.downsample_[0], builder.downsample_[1], builder.upsample_[0], builder.upsample_[1])) {
+    tiler_(new DeepTiler(builder.type_, builder.width(), builder.height(), builder.in(), builder.out(), (float)builder.upsample_[0]/(float)builder.downsample_[0], (float)builder.upsample_[1]/(float)builder.downsample_[1] ,builder.inputPadding_, builder.outputPadding_, builder.downsample_[0], builder.downsample_[1], builder.upsample_[0], builder.upsample_[1], 1, builder.batchSize_)) {
     viewport_[0] = tiler_->getViewportWidth();
     viewport_[1] = tiler_->getViewportHeight();
     if (GLInfo::getGPUType() == GLInfo::ARM_MALI) {
@@ -56,7 +56,7 @@ DeepLayerBase::DeepLayerBase(const GPULayerBuilder& builder, int layerNumber) :
         }
     }
     if (flags_ & LayerFlags::RESIDUAL_INPUT) {
-        DeepTiler restiler(LayerType::RESIDUAL,builder.width(),builder.height(),builder.in(),builder.out(),(float)builder.upsample_[0]/(float)builder.downsample_[0],(float)builder.upsample_[1]/(float)builder.downsample_[1],0,builder.residualPadding_,builder.downsample_[0],builder.downsample_[1],builder.upsample_[0],builder.upsample_[1]);
+        DeepTiler restiler(LayerType::RESIDUAL,builder.width(),builder.height(),builder.in(),builder.out(),(float)builder.upsample_[0]/(float)builder.downsample_[0],(float)builder.upsample_[1]/(float)builder.downsample_[1],0,builder.residualPadding_,builder.downsample_[0],builder.downsample_[1],builder.upsample_[0],builder.upsample_[1],1,builder.batchSize_);
         residualViewport_[0] = restiler.getViewportWidth();
         residualViewport_[1] = restiler.getViewportHeight();
     }
@@ -151,28 +151,32 @@ void DeepLayerBase::copyResult(float *memory, bool includePadding) {
             lwidth += 2*inputPadding_;
             lheight += 2*inputPadding_;
         }
-        int layernum=0;
         float * layer = memory;
         for (int fb = 0 ; fb < numFBOs(); fb++ ) {
             memset(data, 0, owidth*oheight*PIXEL_PACKING*sizeof(float));
             FBO *fbo = getFBO(fb);
             assert(fbo->numAttachments() == 1);
             fbo->writeToMemory<float,GL_FLOAT>(data,PIXEL_PACKING,owidth*oheight*PIXEL_PACKING*sizeof(float));
-            for (int ty=0; ty < tiler_->numOutputTiles(DeepTiler::VERTICAL); ty++) {
-                for (int tx=0; tx < tiler_->numOutputTiles(DeepTiler::HORIZONTAL); tx++) {
-                    int rem = ((outputChannels_ - layernum) > PIXEL_PACKING) ? PIXEL_PACKING : outputChannels_ - layernum;
-                    const float * in = data + ((outputPadding_ + ty*(lheight + outputPadding_))*owidth + outputPadding_ + tx*(lwidth + outputPadding_))*PIXEL_PACKING;
-                    float * outptr = (includePadding) ? layer + (outputPadding_ * lwidth) + outputPadding_ : layer;
-                    for (int l=0; l < rem; l++) {
-                        for (int y=0; y < lheight; y++) {
-                            for (int x=0; x < lwidth; x++) {
-                                outptr[x+y*lwidth] = in[(y*owidth+x)*PIXEL_PACKING+l];
+            // batched images are stored consecutively in the target memory
+            for (int img=0; img < tiler_->getBatchSize(); img++) {
+                std::pair<int,int> origin = tiler_->getOutputImageOffset(img);
+                int layernum = 0;
+                for (int ty=0; ty < tiler_->numOutputTiles(DeepTiler::VERTICAL); ty++) {
+                    for (int tx=0; tx < tiler_->numOutputTiles(DeepTiler::HORIZONTAL); tx++) {
+                        int rem = ((outputChannels_ - layernum) > PIXEL_PACKING) ? PIXEL_PACKING : outputChannels_ - layernum;
+                        const float * in = data + ((origin.second + outputPadding_ + ty*(lheight + outputPadding_))*owidth + origin.first + outputPadding_ + tx*(lwidth + outputPadding_))*PIXEL_PACKING;
+                        float * outptr = (includePadding) ? layer + (outputPadding_ * lwidth) + outputPadding_ : layer;
+                        for (int l=0; l < rem; l++) {
+                            for (int y=0; y < lheight; y++) {
+                                for (int x=0; x < lwidth; x++) {
+                                    outptr[x+y*lwidth] = in[(y*owidth+x)*PIXEL_PACKING+l];
+                                }
                             }
+                            layer += lwidth*lheight;
+                            outptr += lwidth*lheight;
                         }
-                        layer += lwidth*lheight;
-                        outptr += lwidth*lheight;
+                        layernum += PIXEL_PACKING;
                     }
-                    layernum += PIXEL_PACKING;
                 }
             }
         }
@@ -62,10 +62,10 @@ void DeepMaxPoolLayer::beforeRender() {
  * @copydoc DeepPoolingLayer::renderChannelBatch
  */
 void DeepMaxPoolLayer::renderChannelBatch() {
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D,inputTextures_.at(0));
-    int tris = tiler_->numOutputTiles();
-    glDrawElements(GL_TRIANGLES,tris*6,GL_UNSIGNED_SHORT,(const GLvoid *)0);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputTextures_.at(0));
+    int tris = tiler_->numOutputTiles(DeepTiler::BATCH);
+    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES,tris*6,GL_UNSIGNED_SHORT,(const GLvoid *)0);
 }
 
 
@@ -114,15 +114,15 @@ void DeepPoolingLayer::forward(uint64_t sequenceNo, StateToken * state) {
     if (err != GL_NO_ERROR) FNLOGD("HINT: glerror on render entry: 0x%x (%s:%d)[%s]",err,__FILE__,__LINE__,getName().c_str());
 #endif
     if (outputChanged_) updateFBOs();
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_BLEND);
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    glViewport(0,0,viewport_[0],viewport_[1]);
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_STENCIL_TEST);
+    opengl::GLStateCache::disable(GL_CULL_FACE);
+    opengl::GLStateCache::disable(GL_BLEND);
+    opengl::GLStateCache::clearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    opengl::GLStateCache::viewport(0,0,viewport_[0],viewport_[1]);
     framebuffers_.at(0)->bind();
     framebuffers_.at(0)->setWriteMask();
-    glClear(GL_COLOR_BUFFER_BIT);         // this is to instruct the tile-engine that we don't need the old tile-content
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);         // this is to instruct the tile-engine that we don't need the old tile-content
     vertexArray_->bind();
     beforeRender();
     renderChannelBatch();
@@ -149,33 +149,39 @@ void DeepPoolingLayer::forward(uint64_t sequenceNo, StateToken * state) {
  * to cover the output area of the image set which make up the output tensor.
  */
 void DeepPoolingLayer::setupNetworkPolygons(VAO *vao) {
+    // vertex indices are 16-bit, 4 vertices per tile
+    if (tiler_->numOutputTiles(DeepTiler::BATCH) * 4 > 65536) {
+        THROW_EXCEPTION_ARGS(FynException, "Too many output tiles (%d) for 16-bit vertex indices in layer %s", tiler_->numOutputTiles(DeepTiler::BATCH), getName().c_str());
+    }
     int offset0 = 0;
-    float * attrs0 = new float[tiler_->numOutputTiles()*4*4];
+    float * attrs0 = new float[tiler_->numOutputTiles(DeepTiler::BATCH)*4*4];
     //---------------------------------------------
     // VBO part
     //---------------------------------------------
-    std::vector<DeepTiler::Tile> otiles = tiler_->createOutputTiles();
-    std::vector<DeepTiler::Tile> itiles = tiler_->createInputTiles(0,0);
-    assert(otiles.size() == itiles.size());
-    for (int i=0; i < (int)itiles.size(); i++) {
-        DeepTiler::Tile & ot = otiles.at(i);
-        DeepTiler::Tile & it = itiles.at(i);
-        ot.toFloatVec(attrs0, offset0, 4);
-        it.toFloatVec(attrs0, offset0+2, 4);
-        offset0 += 4*4;
+    for (int img=0; img < tiler_->getBatchSize(); img++) {
+        std::vector<DeepTiler::Tile> otiles = tiler_->createOutputTiles(img);
+        std::vector<DeepTiler::Tile> itiles = tiler_->createInputTiles(0, 0, 0, img);
+        assert(otiles.size() == itiles.size());
+        for (int i=0; i < (int)itiles.size(); i++) {
+            DeepTiler::Tile & ot = otiles.at(i);
+            DeepTiler::Tile & it = itiles.at(i);
+            ot.toFloatVec(attrs0, offset0, 4);
+            it.toFloatVec(attrs0, offset0+2, 4);
+            offset0 += 4*4;
+        }
     }
     vertexBuffer_ = new VBO(context_);
     vao->enableArray(0);
-    vertexBuffer_->setBufferData(attrs0,tiler_->numOutputTiles()*4*4*sizeof(float),GL_STATIC_DRAW);
+    vertexBuffer_->setBufferData(attrs0,tiler_->numOutputTiles(DeepTiler::BATCH)*4*4*sizeof(float),GL_STATIC_DRAW);
     vertexBuffer_->bind();
     vao->setVertexAttributeBuffer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
     delete [] attrs0;
     //---------------------------------------------
     // IBO part
     //---------------------------------------------
-    GLshort * indices = new GLshort[tiler_->numOutputTiles()*6];
+    GLushort * indices = new GLushort[tiler_->numOutputTiles(DeepTiler::BATCH)*6];
     indexBuffer_ = new IBO(context_);
-    for (int i=0; i < tiler_->numOutputTiles(); i++) {
+    for (int i=0; i < tiler_->numOutputTiles(DeepTiler::BATCH); i++) {
         int offset = i*4;
         indices[i*6+0] = offset+0;
         indices[i*6+1] = offset+1;
@@ -184,7 +190,7 @@ void DeepPoolingLayer::setupNetworkPolygons(VAO *vao) {
         indices[i*6+4] = offset+2;
         indices[i*6+5] = offset+3;
     }
-    indexBuffer_->setBufferData(indices, 6 * tiler_->numOutputTiles()*sizeof(GLshort), GL_STATIC_DRAW);
+    indexBuffer_->setBufferData(indices, 6 * tiler_->numOutputTiles(DeepTiler::BATCH)*sizeof(GLushort), GL_STATIC_DRAW);
     indexBuffer_->bind();
     delete [] indices;
 }
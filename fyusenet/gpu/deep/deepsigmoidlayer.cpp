@@ -59,10 +59,10 @@ void DeepSigmoidLayer::cleanup() {
  * @copydoc DeepFunctionLayer::renderChannelBatch
  */
 void DeepSigmoidLayer::renderChannelBatch() {
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
-    int quads = tiler_->numOutputTiles();
-    glDrawElements(GL_TRIANGLES, quads * 6, GL_UNSIGNED_SHORT, (const GLvoid *) 0);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
+    int quads = tiler_->numOutputTiles(DeepTiler::BATCH);
+    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES, quads * 6, GL_UNSIGNED_SHORT, (const GLvoid *) 0);
 }
 
 /**
@@ -18,6 +18,7 @@
 #include "../gpulayerbase.h"
 #include "deeptiler.h"
 #include "../gpubuffer.h"
+#include "../../common/fynexception.h"
 
 namespace fyusion::fyusenet::gpu::deep {
 
@@ -48,13 +49,16 @@ namespace fyusion::fyusenet::gpu::deep {
  * @param horizUp Horizontal up-scaling factor
  * @param vertUp Vertical up-scaling factor
  * @param kernel Kernel size (isotropic) for convolution-type layers
+ * @param batch Number of images to (spatially) batch on a single texture
  *
  * Initializes a tiler object with the supplied parameters, performs tiling and viewport
- * computations.
+ * computations. For a \p batch size larger than 1, the tile layout of a single image is
+ * replicated in a grid of image blocks, which is arranged to maintain a decent aspect ratio of the
+ * resulting texture.
  */
 DeepTiler::DeepTiler(LayerType ltype, int width, int height, int inputChannels, int outputChannels,
                      float hscale, float vscale, int inputPadding, int outputPadding,
-                     int horizDown, int vertDown, int horizUp, int vertUp, int kernel) :
+                     int horizDown, int vertDown, int horizUp, int vertUp, int kernel, int batch) :
     width_(width), height_(height), inputChannels_(inputChannels),
     outputChannels_(outputChannels), kernel_(kernel), layer_(ltype) {
     outputWidth_ = (int)((float)width_ * hscale);
@@ -80,10 +84,14 @@ DeepTiler::DeepTiler(LayerType ltype, int width, int height, int inputChannels,
     outputTiling_[0] = outtile.first;
     outputTiling_[1] = outtile.second;
     outputTiling_[2] = 1;
-    viewport_[0] = outputTiling_[0] * (outputWidth_ + outputPadding_) + outputPadding_;
-    viewport_[1] = outputTiling_[1] * (outputHeight_ + outputPadding_) + outputPadding_;
-    inputSize_[0] = inputTiling_[0] * (width_ + inputPadding_) + inputPadding_;
-    inputSize_[1] = inputTiling_[1] * (height_ + inputPadding_) + inputPadding_;
+    if (batch < 1) THROW_EXCEPTION_ARGS(FynException, "Illegal batch size %d", batch);
+    batch_ = batch;
+    batchTiling_[0] = (int)std::ceil(std::sqrt((float)batch_));
+    batchTiling_[1] = (batch_ + batchTiling_[0] - 1) / batchTiling_[0];
+    viewport_[0] = batchTiling_[0] * outputTiling_[0] * (outputWidth_ + outputPadding_) + outputPadding_;
+    viewport_[1] = batchTiling_[1] * outputTiling_[1] * (outputHeight_ + outputPadding_) + outputPadding_;
+    inputSize_[0] = batchTiling_[0] * inputTiling_[0] * (width_ + inputPadding_) + inputPadding_;
+    inputSize_[1] = batchTiling_[1] * inputTiling_[1] * (height_ + inputPadding_) + inputPadding_;
 }
 
 
@@ -91,6 +99,8 @@ DeepTiler::DeepTiler(LayerType ltype, int width, int height, int inputChannels,
 /**
  * @brief Compute a set of tiles for the output tensor configuration
  *
+ * @param image Index of the image within the batch to compute the tiles for
+ *
  * @return Array (vector) of DeepTiler::Tile objects which represent the output tiles to be
  *         rendered to the output texture
  *
@@ -98,7 +108,7 @@ DeepTiler::DeepTiler(LayerType ltype, int width, int height, int inputChannels,
  * usually represented by a single quadrilateral (actually a pair of triangles). The resulting
  * tiles feature image and device coordinates that can be used for polygon setup.
  */
-std::vector<DeepTiler::Tile> DeepTiler::createOutputTiles() const {
+std::vector<DeepTiler::Tile> DeepTiler::createOutputTiles(int image) const {
     std::vector<Tile> result;
     float tilewidth = (float)outputWidth_;
     float tileheight = (float)outputHeight_;
@@ -106,12 +116,13 @@ std::vector<DeepTiler::Tile> DeepTiler::createOutputTiles() const {
     int itileheight = outputHeight_;
     float xextent = (2.0f*tilewidth) / (float)viewport_[0];
     float yextent = (2.0f*tileheight) / (float)viewport_[1];
+    std::pair<int,int> origin = getOutputImageOffset(image);
     int tilenum=0;
     for (int y=0; y < outputTiling_[1]; y++) {
-        float by = ((2.0f*((y * (tileheight + (float)outputPadding_)) + (float)outputPadding_)) / (float)viewport_[1])-1.0f;
+        float by = ((2.0f*((y * (tileheight + (float)outputPadding_)) + (float)(outputPadding_ + origin.second))) / (float)viewport_[1])-1.0f;
         for (int x=0; x < outputTiling_[0]; x++) {
             Tile t;
-            float bx = ((2.0f*((x * (tilewidth + (float)outputPadding_)) + (float)outputPadding_)) / (float)viewport_[0])-1.0f;
+            float bx = ((2.0f*((x * (tilewidth + (float)outputPadding_)) + (float)(outputPadding_ + origin.first))) / (float)viewport_[0])-1.0f;
             t.quad_[0*2+0] = bx;
             t.quad_[0*2+1] = by;
             t.quad_[1*2+0] = bx;
@@ -120,8 +131,8 @@ std::vector<DeepTiler::Tile> DeepTiler::createOutputTiles() const {
             t.quad_[2*2+1] = by+yextent;
             t.quad_[3*2+0] = bx+xextent;
             t.quad_[3*2+1] = by;
-            t.imageCoords_[0] = x*(itilewidth + outputPadding_) + outputPadding_;
-            t.imageCoords_[1] = y*(itileheight + outputPadding_) + outputPadding_;
+            t.imageCoords_[0] = x*(itilewidth + outputPadding_) + outputPadding_ + origin.first;
+            t.imageCoords_[1] = y*(itileheight + outputPadding_) + outputPadding_ + origin.second;
             t.imageExtents_[0] = itilewidth;
             t.imageExtents_[1] = itileheight;
             t.textureID_ = 0;
@@ -142,6 +153,7 @@ std::vector<DeepTiler::Tile> DeepTiler::createOutputTiles() const {
  * @param xPixelOffset For convolution layers, provides the convolution offset along the x-axis
  * @param yPixelOffset For convolution layers, provides the convolution offset along the y-axis
  * @param texID GL texture ID/handle to write into the resulting tiles
+ * @param image Index of the image within the batch to compute the tiles for
  *
  * @return Array (vector) of DeepTiler::Tile objects which represent the input tiles to be mapped
  *         to the output polygons
@@ -151,7 +163,7 @@ std::vector<DeepTiler::Tile> DeepTiler::createOutputTiles() const {
  *
  * @todo Fractional step convolution support
  */
-std::vector<DeepTiler::Tile> DeepTiler::createInputTiles(int xPixelOffset, int yPixelOffset, int texID) const {
+std::vector<DeepTiler::Tile> DeepTiler::createInputTiles(int xPixelOffset, int yPixelOffset, int texID, int image) const {
     std::vector<Tile> result;
     float tilewidth = (float)width_;
     float tileheight = (float)height_;
@@ -159,13 +171,14 @@ std::vector<DeepTiler::Tile> DeepTiler::createInputTiles(int xPixelOffset, int y
     float yextent = tileheight / (float)inputSize_[1];
     float dx = (globalPooling_) ? 0.0f : 0.5f * (float)(downsample_[0]-1);
     float dy = (globalPooling_) ? 0.0f : 0.5f * (float)(downsample_[1]-1);
+    std::pair<int,int> origin = getInputImageOffset(image);
     int tilenum=0;
     int remchannels = inputChannels_;
     for (int y=0; y < inputTiling_[1]; y++) {
-        float by = (y * (tileheight + (float)inputPadding_) + (float)(inputPadding_ + yPixelOffset) - dy) / (float) inputSize_[1];
+        float by = (y * (tileheight + (float)inputPadding_) + (float)(inputPadding_ + yPixelOffset + origin.second) - dy) / (float) inputSize_[1];
         for (int x=0; x < inputTiling_[0]; x++) {
             Tile t;
-            float bx = (x * (tilewidth + (float)inputPadding_) + (float)(inputPadding_ + xPixelOffset) - dx) / (float) inputSize_[0];
+            float bx = (x * (tilewidth + (float)inputPadding_) + (float)(inputPadding_ + xPixelOffset + origin.first) - dx) / (float) inputSize_[0];
             t.textureID_ = texID;
             t.quad_[0*2+0] = bx;
             t.quad_[0*2+1] = by;
@@ -175,8 +188,8 @@ std::vector<DeepTiler::Tile> DeepTiler::createInputTiles(int xPixelOffset, int y
             t.quad_[2*2+1] = by+yextent;
             t.quad_[3*2+0] = bx+xextent;
             t.quad_[3*2+1] = by;
-            t.imageCoords_[0] = x*(width_+inputPadding_)+inputPadding_;
-            t.imageCoords_[1] = y*(height_+inputPadding_)+inputPadding_;
+            t.imageCoords_[0] = x*(width_+inputPadding_)+inputPadding_+origin.first;
+            t.imageCoords_[1] = y*(height_+inputPadding_)+inputPadding_+origin.second;
             t.imageExtents_[0] = width_;
             t.imageExtents_[1] = height_;
             t.lowClamp_[0] = bx;
@@ -215,6 +228,40 @@ float DeepTiler::getTextureStepY() const {
 }
 
 
+/**
+ * @brief Retrieve pixel offset of an image block on the input texture
+ *
+ * @param image Index of the image within the batch
+ *
+ * @return Pair of x/y offsets (in pixels) of the block that stores the supplied \p image on the
+ *         input texture, relative to the block of the first image
+ */
+std::pair<int,int> DeepTiler::getInputImageOffset(int image) const {
+    assert((image >= 0) && (image < batch_));
+    return {(image % batchTiling_[0]) * inputTiling_[0] * (width_ + inputPadding_),
+            (image / batchTiling_[0]) * inputTiling_[1] * (height_ + inputPadding_)};
+}
+
+
+/**
+ * @brief Retrieve pixel offset of an image block on the output texture
+ *
+ * @param image Index of the image within the batch
+ *
+ * @return Pair of x/y offsets (in pixels) of the block that stores the supplied \p image on the
+ *         output texture, relative to the block of the first image
+ *
+ * The block of each image has the same layout as the texture of an unbatched tensor, when
+ * reading an area of the size of an unbatched tensor starting at the returned offset, the
+ * data for a single image is obtained.
+ */
+std::pair<int,int> DeepTiler::getOutputImageOffset(int image) const {
+    assert((image >= 0) && (image < batch_));
+    return {(image % batchTiling_[0]) * outputTiling_[0] * (outputWidth_ + outputPadding_),
+            (image / batchTiling_[0]) * outputTiling_[1] * (outputHeight_ + outputPadding_)};
+}
+
+
 /**
  * @brief Retrieve total viewport width for output rendering
  *
@@ -332,6 +379,9 @@ int DeepTiler::getInputHeight() const {
  *   - \c HORIZONTAL for horizontal number of tiles (# columns)
  *   - \c VERTICAL for vertical number of tiles (# rows)
  *   - \c ALL for cartesian product of horizontal/vertical tiles
+ *   - \c BATCH for the total number of tiles over all images in the batch
+ *
+ * With the exception of \c BATCH, all modes refer to a single image.
  */
 int DeepTiler::numInputTiles(tx mode) const {
     switch (mode) {
@@ -339,6 +389,8 @@ int DeepTiler::numInputTiles(tx mode) const {
             return inputTiling_[0];
         case VERTICAL:
             return inputTiling_[1];
+        case BATCH:
+            return inputTiles_ * batch_;
         default:
             return inputTiles_;
     }
@@ -356,6 +408,9 @@ int DeepTiler::numInputTiles(tx mode) const {
  *   - \c HORIZONTAL for horizontal number of tiles (# columns)
  *   - \c VERTICAL for vertical number of tiles (# rows)
  *   - \c ALL for cartesian product of horizontal/vertical tiles
+ *   - \c BATCH for the total number of tiles over all images in the batch
+ *
+ * With the exception of \c BATCH, all modes refer to a single image.
  */
 int DeepTiler::numOutputTiles(tx mode) const {
     switch (mode) {
@@ -363,6 +418,8 @@ int DeepTiler::numOutputTiles(tx mode) const {
             return outputTiling_[0];
         case VERTICAL:
             return outputTiling_[1];
+        case BATCH:
+            return outputTiles_ * batch_;
         default:
             return outputTiles_;
     }
@@ -459,10 +516,12 @@ DeepTiler::Tile DeepTiler::getUnitTextureExtents() {
 /**
  * @brief Create an input tile with texture extents according to stored tensor parameters
  *
+ * @param image Index of the image within the batch to compute the extents for
+ *
  * @return Tile object with default texture extents for a single input tile according to the
  *         wrapped input/output tensor combination
  */
-DeepTiler::Tile DeepTiler::getDefaultTextureExtents() const {
+DeepTiler::Tile DeepTiler::getDefaultTextureExtents(int image) const {
     Tile result;
     float tilewidth = (float)width_;
     float tileheight = (float)height_;
@@ -470,8 +529,9 @@ DeepTiler::Tile DeepTiler::getDefaultTextureExtents() const {
     float yextent = tileheight / (float)inputSize_[1];
     float dx = (globalPooling_) ? 0.0f : 0.5f * (float)(downsample_[0]-1);
     float dy = (globalPooling_) ? 0.0f : 0.5f * (float)(downsample_[1]-1);
-    float bx = ((float)inputPadding_ - dx) / (float) inputSize_[0];
-    float by = ((float)inputPadding_ - dy) / (float) inputSize_[1];
+    std::pair<int,int> origin = getInputImageOffset(image);
+    float bx = ((float)(inputPadding_ + origin.first) - dx) / (float) inputSize_[0];
+    float by = ((float)(inputPadding_ + origin.second) - dy) / (float) inputSize_[1];
     result.quad_[0*2+0] = bx;
     result.quad_[0*2+1] = by;
     result.quad_[1*2+0] = bx;
@@ -33,6 +33,13 @@ namespace fyusion::fyusenet::gpu::deep {
  * Tiles are laid out based on the number of total channels and the tiler tries to maintain a
  * decent aspect ratio of the resulting texture while fitting the tiles.
  *
+ * For spatial batching, the tiler can replicate the tile layout of a single tensor for multiple
+ * images, arranged as a grid of \e blocks on the same texture. Each block is laid out exactly like
+ * the texture of a single (unbatched) tensor, adjacent blocks share their padding borders in the
+ * same way that adjacent tiles do. As the blocks are offset by a constant amount, tiles of
+ * different images only differ by a translation, which makes it possible to cover the whole batch
+ * with a single draw call.
+ *
  * @todo Support fractional-step convolution
  */
 class DeepTiler {
@@ -44,9 +51,10 @@ class DeepTiler {
      * @see #numInputTiles, #numOutputTiles
      */
     enum tx {
-        ALL,                //!< Query total amount of tiles (width * height)
-        HORIZONTAL,         //!< Query only horizontal amount of tiles (tile columns)
-        VERTICAL            //!< Query only vertical amount of tiles (tile rows)
+        ALL,                //!< Query total amount of tiles (width * height) for a single image
+        HORIZONTAL,         //!< Query only horizontal amount of tiles (tile columns) for a single image
+        VERTICAL,           //!< Query only vertical amount of tiles (tile rows) for a single image
+        BATCH               //!< Query total amount of tiles for all images in the batch
     };
 
      /**
@@ -81,14 +89,14 @@ class DeepTiler {
     DeepTiler() = default;
     DeepTiler(LayerType ltype, int width, int height, int inputChannels, int outputChannels,
               float hscale=1.0f, float vscale=1.0f, int inputPadding=0, int outputPadding=0,
-              int horizDown=1, int vertDown=1, int horizUp=1, int vertUp=1, int kernel=1);
+              int horizDown=1, int vertDown=1, int horizUp=1, int vertUp=1, int kernel=1, int batch=1);
 
     // ------------------------------------------------------------------------
     // Public methods
     // ------------------------------------------------------------------------
-    [[nodiscard]] std::vector<Tile> createOutputTiles() const;
-    [[nodiscard]] std::vector<Tile> createInputTiles(int xPixelOffset,int yPixelOffset,int texID=0) const;
-    [[nodiscard]] Tile getDefaultTextureExtents() const;
+    [[nodiscard]] std::vector<Tile> createOutputTiles(int image=0) const;
+    [[nodiscard]] std::vector<Tile> createInputTiles(int xPixelOffset,int yPixelOffset,int texID=0, int image=0) const;
+    [[nodiscard]] Tile getDefaultTextureExtents(int image=0) const;
     [[nodiscard]] static Tile getUnitTextureExtents();
     [[nodiscard]] int getViewportWidth() const;
     [[nodiscard]] int getViewportHeight() const;
@@ -104,6 +112,17 @@ class DeepTiler {
     [[nodiscard]] int getOutputHeight() const;
     [[nodiscard]] float getTextureStepX() const;
     [[nodiscard]] float getTextureStepY() const;
+    [[nodiscard]] std::pair<int,int> getInputImageOffset(int image) const;
+    [[nodiscard]] std::pair<int,int> getOutputImageOffset(int image) const;
+
+    /**
+     * @brief Retrieve number of images that are spatially batched by this tiler
+     *
+     * @return Batch size, which is 1 for unbatched tensors
+     */
+    [[nodiscard]] int getBatchSize() const {
+        return batch_;
+    }
 
     /**
      * @brief Set global pooling mode on tiler
@@ -138,6 +157,8 @@ class DeepTiler {
     int outputTiles_ = 0;           //!< Total number of tiles (output side), each tile represents 4 channels
     int inputTiling_[3];            //!< Number of input tiles in x/y direction + potential multi-texture dimension
     int outputTiling_[3];           //!< Number of output tiles in x/y direction + potential MRT dimension
+    int batch_ = 1;                 //!< Number of images in the (spatial) batch
+    int batchTiling_[2] = {1, 1};   //!< Number of image blocks in x/y direction for batched tensors
     int kernel_ = 1;                //!< For convolution-type layers, defines the (isotropic) convolution kernel size
     int viewport_[2];               //!< Viewport size to use for rendering (per render-target)
     int inputSize_[2];              //!< Total input texture size (per render-target)
@@ -0,0 +1,206 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Deep Top-K Layer
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <cstring>
+#include <cassert>
+#include <memory>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "../../gl/glexception.h"
+#include "../../common/logging.h"
+#include "../../common/miscdefs.h"
+#include "deeptopklayer.h"
+#include "deeptiler.h"
+
+namespace fyusion::fyusenet::gpu::deep {
+
+//-------------------------------------- Global Variables ------------------------------------------
+
+
+//-------------------------------------- Local Definitions -----------------------------------------
+
+
+/*##################################################################################################
+#                                   P U B L I C  F U N C T I O N S                                 #
+##################################################################################################*/
+
+/**
+ * @copydoc GPULayerBase::GPULayerBase(const GPULayerBuilder&, int)
+ */
+DeepTopKLayer::DeepTopKLayer(const TopKLayerBuilder & builder, int layerNumber) :
+    DeepLayerBase((const GPULayerBuilder &)builder, layerNumber), k_(builder.k_), softmax_(builder.softmax_) {
+    if (flags_ & LayerFlags::RESIDUAL_INPUT) THROW_EXCEPTION_ARGS(FynException, "This layer does not support residual inputs");
+    if ((width_ != 1) || (height_ != 1)) THROW_EXCEPTION_ARGS(FynException, "Top-K layer %s only supports 1x1 spatial size", getName().c_str());
+    if ((k_ < 1) || (k_ > inputChannels_)) THROW_EXCEPTION_ARGS(FynException, "Illegal K=%d for %d channels", k_, inputChannels_);
+    viewport_[0] = k_;
+    viewport_[1] = 1;
+}
+
+
+/**
+ * @copydoc LayerBase::setup
+ */
+void DeepTopKLayer::setup() {
+    std::lock_guard<std::recursive_mutex> lck(processingLock_);
+    CLEAR_GFXERR_DEBUG
+    proxyGeometry();
+    setupShaders();
+    setupFBOs();
+    valid_ = true;
+}
+
+
+/**
+ * @copydoc LayerBase::cleanup
+ */
+void DeepTopKLayer::cleanup() {
+    std::lock_guard<std::recursive_mutex> lck(processingLock_);
+    FNET_DEL_AND_CLEAR(pointVerts_)
+    FNET_DEL_AND_CLEAR(pointArray_)
+    shader_.reset();
+    DeepLayerBase::cleanup();
+}
+
+
+/**
+ * @copydoc LayerBase::forward
+ */
+void DeepTopKLayer::forward(uint64_t sequenceNo, StateToken * state) {
+    std::lock_guard<std::recursive_mutex> lck(processingLock_);
+    if (!valid_) THROW_EXCEPTION_ARGS(FynException,"Trying to invoke forward() on invalid layer");
+    CLEAR_GFXERR_DEBUG
+    if (outputChanged_) updateFBOs();
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_STENCIL_TEST);
+    opengl::GLStateCache::disable(GL_CULL_FACE);
+    opengl::GLStateCache::disable(GL_BLEND);
+    opengl::GLStateCache::clearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    opengl::GLStateCache::viewport(0, 0, viewport_[0], viewport_[1]);
+    framebuffers_.at(0)->bind();
+    framebuffers_.at(0)->setWriteMask();
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
+    pointArray_->bind();
+    shader_->bind();
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
+    opengl::GLCommandBuffer::drawArrays(GL_POINTS, 0, inputChannels_);
+    shader_->unbind();
+    pointArray_->unbind();
+    framebuffers_.at(0)->unbind();
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, 0);
+}
+
+
+/**
+ * @brief Copy the selected entries to CPU memory
+ *
+ * @param memory Pointer to memory that is able to hold K x 4 floating-point values
+ * @param includePadding Ignored, this layer has no padding on the output
+ *
+ * @note This function is only available in debug builds
+ */
+void DeepTopKLayer::copyResult(float *memory, bool includePadding) {
+#ifdef DEBUG
+    if (memory) {
+        framebuffers_.at(0)->writeToMemory<float, GL_FLOAT>(memory, PIXEL_PACKING, (GLsizei)(k_ * PIXEL_PACKING * sizeof(float)));
+    }
+#endif
+}
+
+
+/**
+ * @copydoc LayerBase::getRequiredInputBuffers
+ */
+std::vector<BufferSpec> DeepTopKLayer::getRequiredInputBuffers() const {
+    std::vector<BufferSpec> result;
+    result.push_back(BufferSpec(0, 0, tiler_->getInputTextureWidth(), tiler_->getInputTextureHeight(),
+                                TEXTURE_IFORMAT_4, TEXTURE_FORMAT_4, TEXTURE_TYPE_DEFAULT,
+                                BufferSpec::FUNCTION_SOURCE).dataOrder(BufferSpec::order::GPU_DEEP));
+    return result;
+}
+
+
+/**
+ * @copydoc LayerBase::getRequiredOutputBuffers
+ *
+ * The output always consists of a single K x 1 texture with 32-bit floating-point precision,
+ * as channel indices may not be representable by half-precision numbers.
+ */
+std::vector<BufferSpec> DeepTopKLayer::getRequiredOutputBuffers() const {
+    std::vector<BufferSpec> result;
+    result.push_back(BufferSpec(0, 0, viewport_[0], viewport_[1],
+                                BufferSpec::sizedformat::RGBA32F, BufferSpec::genericformat::RGBA, BufferSpec::dtype::FLOAT32,
+                                BufferSpec::FUNCTION_DEST).dataOrder(BufferSpec::order::GPU_SHALLOW));
+    return result;
+}
+
+
+/*##################################################################################################
+#                               N O N -  P U B L I C  F U N C T I O N S                            #
+##################################################################################################*/
+
+/**
+ * @copydoc GPULayerBase::getOutputOrder
+ */
+BufferSpec::order DeepTopKLayer::getOutputOrder(int port) const {
+    return BufferSpec::order::GPU_SHALLOW;
+}
+
+
+/**
+ * @copydoc GPULayerBase::getOutputType
+ */
+BufferSpec::dtype DeepTopKLayer::getOutputType(int port) const {
+    return BufferSpec::dtype::FLOAT32;
+}
+
+
+/**
+ * @brief Create proxy geometry for the selection, which consists of one point per channel
+ */
+void DeepTopKLayer::proxyGeometry() {
+    std::unique_ptr<GLuint[]> indices(new GLuint[inputChannels_]);
+    for (GLuint i=0, *ptr=indices.get(); i < (GLuint)inputChannels_; i++) ptr[i] = i;
+    pointArray_ = new VAO(context_);
+    pointArray_->bind();
+    pointVerts_ = new VBO(context_);
+    pointArray_->enableArray(0);
+    pointVerts_->setBufferData((void *)indices.get(), (GLsizei)(inputChannels_ * sizeof(GLuint)), GL_STATIC_DRAW);
+    pointVerts_->bind();
+    pointArray_->setVertexAttributeBuffer(0, 1, GL_UNSIGNED_INT, 0, 0);
+    pointArray_->unbind();
+}
+
+
+/**
+ * @brief Compile selection shader and set static uniforms
+ */
+void DeepTopKLayer::setupShaders() {
+    char preproc[256] = {0};
+    if (softmax_) strncpy(preproc, "#define SOFTMAX\n", sizeof(preproc)-1);
+    shader_ = compileShaderPair("shaders/deep/deeptopk.vert", "shaders/deep/deeptopk.frag", preproc, typeid(this));
+    try {
+        shader_->bindAttributeLocation("attributes0", 0);
+        shader_->link();
+    } catch (GLException& ex) {
+        FNLOGE("Cannot link shader for layer %s", getName().c_str());
+        throw;
+    }
+    shader_->bind();
+    shader_->setUniformValue("inputLayer0", 0);
+    shader_->setUniformVec4("geometry", inputChannels_, inputPadding_, tiler_->numInputTiles(DeepTiler::HORIZONTAL), k_);
+    shader_->unbind();
+}
+
+} // fyusion::fyusenet::gpu::deep namespace
+
+// vim: set expandtab ts=4 sw=4:
@@ -0,0 +1,93 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Deep Top-K Layer (Header)
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <vector>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "../../gl/gl_sys.h"
+#include "../../gl/fbo.h"
+#include "../../gl/vbo.h"
+#include "../../gl/vao.h"
+#include "../../gl/shaderprogram.h"
+#include "../../base/bufferspec.h"
+#include "deeplayerbase.h"
+#include "../topklayerbuilder.h"
+
+//------------------------------------- Public Declarations ----------------------------------------
+namespace fyusion::fyusenet::gpu::deep {
+
+/**
+ * @brief Top-K selection layer for classification outputs in deep tensor format
+ *
+ * This layer selects the K channels with the highest values from a deep tensor with a spatial
+ * size of 1x1, which is the typical output of a classification head (e.g. the 1000 logits of
+ * a ResNet-50). Instead of downloading the full score vector and sorting it on the CPU, only
+ * the K selected entries have to be downloaded.
+ *
+ * Similar to the scatter step in sequence::TokenScoringLayer, the selection is done in the
+ * vertex shader: one point is rendered per channel and each point computes the rank of its
+ * value among all channels. Points with a rank below K are rendered at the pixel that corresponds
+ * to their rank, all others are discarded. Ties are resolved by the channel index, which makes
+ * the selection exact (unlike the approximate DeepArgMaxLayer). The quadratic cost is negligible
+ * for the channel counts of typical classification heads.
+ *
+ * The output of this layer is a single 4-channel 32-bit floating-point texture with a size of
+ * K x 1 pixels, sorted by descending score. Each pixel contains the following data:
+ *   - channel index
+ *   - score (input value)
+ *   - softmax probability over all channels (if enabled, otherwise 0)
+ *   - unused
+ *
+ * @see TopKLayerBuilder
+ */
+class DeepTopKLayer : public DeepLayerBase {
+ public:
+    // ------------------------------------------------------------------------
+    // Constructor / Destructor
+    // ------------------------------------------------------------------------
+    DeepTopKLayer(const TopKLayerBuilder & builder, int layerNumber);
+
+    // ------------------------------------------------------------------------
+    // Public methods
+    // ------------------------------------------------------------------------
+    void setup() override;
+    void cleanup() override;
+    void forward(uint64_t sequenceNo, StateToken *state) override;
+    void copyResult(float *memory, bool includePadding) override;
+    [[nodiscard]] std::vector<BufferSpec> getRequiredInputBuffers() const override;
+    [[nodiscard]] std::vector<BufferSpec> getRequiredOutputBuffers() const override;
+
+ protected:
+    // ------------------------------------------------------------------------
+    // Non-public methods
+    // ------------------------------------------------------------------------
+    [[nodiscard]] BufferSpec::order getOutputOrder(int port) const override;
+    [[nodiscard]] BufferSpec::dtype getOutputType(int port) const override;
+    void setupShaders();
+    void proxyGeometry();
+
+    // ------------------------------------------------------------------------
+    // Member variables
+    // ------------------------------------------------------------------------
+    int k_ = 0;                                 //!< Number of highest-scoring channels to select
+    bool softmax_ = false;                      //!< Indicator whether softmax probabilities are computed
+    opengl::VAO * pointArray_ = nullptr;        //!< Vertex array object for the selection points
+    opengl::VBO * pointVerts_ = nullptr;        //!< Channel indices for the selection points
+    opengl::programptr shader_;                 //!< Shader that performs the selection
+};
+
+} // fyusion::fyusenet::gpu::deep namespace
+
+// vim: set expandtab ts=4 sw=4:
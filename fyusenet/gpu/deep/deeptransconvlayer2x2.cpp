@@ -77,15 +77,15 @@ void DeepTransConvLayer2x2::cleanup() {
 void DeepTransConvLayer2x2::renderPass(int pass) {
     int instances = tiler_->numInputTiles();
     int tris = tiler_->numOutputTiles();
-    glStencilFuncSeparate(GL_FRONT_AND_BACK, GL_EQUAL, pass+1, 0xFF);
+    opengl::GLCommandBuffer::stencilFuncSeparate(GL_FRONT_AND_BACK, GL_EQUAL, pass+1, 0xFF);
     shader_->bind(shaderState_.get());
     shader_->setMappedUniformValue(PASS,pass);
-    glDrawElements(GL_TRIANGLES,tris*6,GL_UNSIGNED_SHORT,(const GLvoid *)0);
+    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES,tris*6,GL_UNSIGNED_SHORT,(const GLvoid *)0);
     shader_->unbind((instances > 1) ? true : false);
     if (instances > 1) {
         noBiasShader_->bind(noBiasShaderState_.get());
         noBiasShader_->setMappedUniformValue(PASS,pass);
-        glDrawElementsInstanced(GL_TRIANGLES,tris*6,GL_UNSIGNED_SHORT,(const GLvoid *)0,instances-1);
+        opengl::GLCommandBuffer::drawElementsInstanced(GL_TRIANGLES,tris*6,GL_UNSIGNED_SHORT,(const GLvoid *)0,instances-1);
         noBiasShader_->unbind();
     }
 }
@@ -22,7 +22,7 @@
 #include "../../gl/glinfo.h"
 #include "../gfxcontextlink.h"
 #include "../uniformweightarray.h"
-#include "../floatconversion.h"
+#include "../weightcache.h"
 
 #include "deeptransconvlayerbase.h"
 #include "deeplayerbase.h"
@@ -88,32 +88,32 @@ void DeepTransConvLayerBase::forward(uint64_t sequenceNo, StateToken * state) {
     if (err != GL_NO_ERROR) FNLOGD("HINT: glerror on render entry: 0x%x (%s:%d)[%s]",err,__FILE__,__LINE__,getName().c_str());
 #endif
     if (outputChanged_) updateFBOs();
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_CULL_FACE);
-    glEnable(GL_BLEND);
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_STENCIL_TEST);
-    glDepthFunc(GL_ALWAYS);
-    glDepthMask(GL_FALSE);
-    glStencilOp(GL_KEEP,GL_KEEP,GL_KEEP);
-    glBlendEquationSeparate(GL_FUNC_ADD,GL_FUNC_ADD);
-    glBlendFuncSeparate(GL_ONE,GL_ONE,GL_ONE,GL_ONE);
-    glStencilMask(0xFF);
-    glClearColor(0,0,0,0);
-    glViewport(0,0,viewport_[0],viewport_[1]);
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_STENCIL_TEST);
+    opengl::GLStateCache::disable(GL_CULL_FACE);
+    opengl::GLStateCache::enable(GL_BLEND);
+    opengl::GLStateCache::enable(GL_DEPTH_TEST);
+    opengl::GLStateCache::enable(GL_STENCIL_TEST);
+    opengl::GLCommandBuffer::depthFunc(GL_ALWAYS);
+    opengl::GLCommandBuffer::depthMask(GL_FALSE);
+    opengl::GLCommandBuffer::stencilOp(GL_KEEP,GL_KEEP,GL_KEEP);
+    opengl::GLStateCache::blendEquationSeparate(GL_FUNC_ADD,GL_FUNC_ADD);
+    opengl::GLStateCache::blendFuncSeparate(GL_ONE,GL_ONE,GL_ONE,GL_ONE);
+    opengl::GLCommandBuffer::stencilMask(0xFF);
+    opengl::GLStateCache::clearColor(0,0,0,0);
+    opengl::GLStateCache::viewport(0,0,viewport_[0],viewport_[1]);
     vertexArray_->bind();
     framebuffers_.at(0)->bind();
     framebuffers_.at(0)->setWriteMask();
-    glClear(GL_COLOR_BUFFER_BIT);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D,inputTextures_.at(0));
-    glActiveTexture(GL_TEXTURE4);
-    glBindTexture(GL_TEXTURE_2D,inputCoordTexture_);
-    glActiveTexture(GL_TEXTURE5);
-    glBindTexture(GL_TEXTURE_2D,weightTexture_);
-    glActiveTexture(GL_TEXTURE6);
-    glBindTexture(GL_TEXTURE_2D,biasTexture_);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputTextures_.at(0));
+    opengl::GLStateCache::activeTexture(GL_TEXTURE4);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputCoordTexture_);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE5);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,weightTexture_);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE6);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,biasTexture_);
 
     if (flags_ & LayerFlags::RESIDUAL_INPUT) {
         // TODO (mw) residual code here
@@ -125,8 +125,8 @@ void DeepTransConvLayerBase::forward(uint64_t sequenceNo, StateToken * state) {
 
     framebuffers_.at(0)->unbind();
     vertexArray_->unbind();
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_STENCIL_TEST);
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_STENCIL_TEST);
 }
 
 
@@ -143,52 +143,39 @@ void DeepTransConvLayerBase::loadParameters(const ParameterProvider *weightSourc
         THROW_EXCEPTION_ARGS(FynException,"Weights do not fit into GL texture");
     }
     if (auto wgtsrc = weightSource->get(getName()+std::string(".weights"), getNumber(), 0) ; !wgtsrc.empty()) {
-        float *weights = new float[texwidth * texheight * PIXEL_PACKING];
-        memset(weights, 0, texwidth * texheight * PIXEL_PACKING * sizeof(float));
         const float *srcweights = std::any_cast<const float *>(wgtsrc.get());
-        for (int outlayer = 0; outlayer < outputChannels_; outlayer += PIXEL_PACKING) {
-            int orem = ((outputChannels_ - outlayer) >= PIXEL_PACKING) ? PIXEL_PACKING : (outputChannels_ - outlayer);
-            for (int fy = 0; fy < kernel_; fy++) {
-                float *wptr = weights + ((outlayer / PIXEL_PACKING) * kernel_ + fy) * (texwidth * PIXEL_PACKING);
-                // below defines one row in the target texture
-                for (int inlayer = 0; inlayer < inputChannels_; inlayer += PIXEL_PACKING) {
-                    int irem = ((inputChannels_ - inlayer) >= PIXEL_PACKING) ? PIXEL_PACKING : (inputChannels_ - inlayer);
-                    for (int fx = 0; fx < kernel_; fx++) {
-                        for (int ol = outlayer; ol < outlayer + orem; ol++) {
-                            for (int il = inlayer; il < inlayer + irem; il++) {
-                                int srcoffset = ol * (kernel_ * kernel_ * inputChannels_) + ((fy * kernel_ + fx) * inputChannels_) + il;
-                                *wptr = srcweights[srcoffset];
-                                wptr++;
+        char config[128];
+        snprintf(config, sizeof(config), "deeptransconv:%d:%d:%d:%d:%d:%d", kernel_, inputChannels_, outputChannels_, texwidth, texheight, (int)halfSupport_);
+        releaseWeightTexture();
+        weightTexture_ = WeightCache::obtainTexture(weightSource, getName(), config, srcweights, (size_t)outputChannels_ * kernel_ * kernel_ * inputChannels_,
+                                                    [&](WeightCache::Payload& payload) {
+            float * weights = new float[texwidth * texheight * PIXEL_PACKING];
+            memset(weights, 0, texwidth * texheight * PIXEL_PACKING * sizeof(float));
+            for (int outlayer = 0; outlayer < outputChannels_; outlayer += PIXEL_PACKING) {
+                int orem = ((outputChannels_ - outlayer) >= PIXEL_PACKING) ? PIXEL_PACKING : (outputChannels_ - outlayer);
+                for (int fy = 0; fy < kernel_; fy++) {
+                    float *wptr = weights + ((outlayer / PIXEL_PACKING) * kernel_ + fy) * (texwidth * PIXEL_PACKING);
+                    // below defines one row in the target texture
+                    for (int inlayer = 0; inlayer < inputChannels_; inlayer += PIXEL_PACKING) {
+                        int irem = ((inputChannels_ - inlayer) >= PIXEL_PACKING) ? PIXEL_PACKING : (inputChannels_ - inlayer);
+                        for (int fx = 0; fx < kernel_; fx++) {
+                            for (int ol = outlayer; ol < outlayer + orem; ol++) {
+                                for (int il = inlayer; il < inlayer + irem; il++) {
+                                    int srcoffset = ol * (kernel_ * kernel_ * inputChannels_) + ((fy * kernel_ + fx) * inputChannels_) + il;
+                                    *wptr = srcweights[srcoffset];
+                                    wptr++;
+                                }
+                                wptr += PIXEL_PACKING - irem;
                             }
-                            wptr += PIXEL_PACKING - irem;
+                            wptr += (PIXEL_PACKING - orem) * PIXEL_PACKING;
                         }
-                        wptr += (PIXEL_PACKING - orem) * PIXEL_PACKING;
                     }
                 }
             }
-        }
-        if (!weightTexture_) glGenTextures(1, &weightTexture_);
-        glBindTexture(GL_TEXTURE_2D, weightTexture_);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-#ifndef HIGH_PRECISION
-        if (halfSupport_) {
-            unsigned int *fp16 = FloatConversion::getInstance()->toFP16UI(weights, texwidth * texheight * PIXEL_PACKING);
-#ifdef GL_RGBA32UI
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32UI, texwidth / 2, texheight, 0, GL_RGBA_INTEGER, GL_UNSIGNED_INT, fp16);
-#else
-            glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA32UI_EXT,texwidth/2,texheight,0,GL_RGBA_INTEGER_EXT,GL_UNSIGNED_INT,fp16);
-#endif
-            delete[] fp16;
-        } else {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, texwidth, texheight, 0, GL_RGBA, GL_FLOAT, weights);
-        }
-#else
-        glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA32F,texwidth,texheight,0,GL_RGBA,GL_FLOAT,weights);
-#endif
-        delete[] weights;
+            WeightCache::packRGBA(payload, weights, texwidth, texheight, halfSupport_);
+            delete [] weights;
+        });
+        weightStore_ = weightSource->weightStore();
     }
     //------------------------------------------------------
     // If we have the post-BN flag set, store the batchnorm
@@ -221,7 +208,7 @@ void DeepTransConvLayerBase::loadParameters(const ParameterProvider *weightSourc
         }
     }
     if (!biasTexture_) glGenTextures(1,&biasTexture_);
-    glBindTexture(GL_TEXTURE_2D,biasTexture_);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,biasTexture_);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -320,7 +307,7 @@ void DeepTransConvLayerBase::setupNetworkPolygons(VAO *vao) {
     // in vertex shader...
     //---------------------------------------------
     glGenTextures(1,&inputCoordTexture_);
-    glBindTexture(GL_TEXTURE_2D,inputCoordTexture_);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputCoordTexture_);
     glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
@@ -367,7 +354,8 @@ void DeepTransConvLayerBase::setupStencilBuffer() {
     // Setup renderbuffer that will hold the stencil
     //-----------------------------------------------
     glBindRenderbuffer(GL_RENDERBUFFER,stencilBuffer_);
-#ifndef ANDROID
+#if !defined(ANDROID) && !defined(FYUSENET_USE_EGL) && !defined(FYUSENET_USE_WEBGL)
+    // GL ES only accepts the sized depth/stencil format
     glRenderbufferStorage(GL_RENDERBUFFER,GL_DEPTH_STENCIL,viewport_[0],viewport_[1]);
 #else
     glRenderbufferStorage(GL_RENDERBUFFER,GL_DEPTH24_STENCIL8,viewport_[0],viewport_[1]);
@@ -383,9 +371,9 @@ void DeepTransConvLayerBase::setupStencilBuffer() {
     // setup...
     //-----------------------------------------------
     GLuint helptex=0;
-    glActiveTexture(GL_TEXTURE0);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
     glGenTextures(1,&helptex);
-    glBindTexture(GL_TEXTURE_2D,helptex);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,helptex);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -498,20 +486,20 @@ void DeepTransConvLayerBase::setupStencilBuffer() {
     //-----------------------------------------------
     //-----------------------------------------------
     fbo->bind();
-    glViewport(0, 0, viewport_[0], viewport_[1]);
-    glStencilFuncSeparate(GL_FRONT_AND_BACK,GL_ALWAYS,0,0xFF);
-    glStencilMask(0xFF);
-    glClearColor(0, 0, 0, 0);
-    glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT|GL_STENCIL_BUFFER_BIT);
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_STENCIL_TEST);
-    glDepthFunc(GL_ALWAYS);
-    glStencilOp(GL_KEEP,GL_KEEP,GL_INCR);
+    opengl::GLStateCache::viewport(0, 0, viewport_[0], viewport_[1]);
+    opengl::GLCommandBuffer::stencilFuncSeparate(GL_FRONT_AND_BACK,GL_ALWAYS,0,0xFF);
+    opengl::GLCommandBuffer::stencilMask(0xFF);
+    opengl::GLStateCache::clearColor(0, 0, 0, 0);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT|GL_STENCIL_BUFFER_BIT);
+    opengl::GLStateCache::enable(GL_DEPTH_TEST);
+    opengl::GLStateCache::enable(GL_STENCIL_TEST);
+    opengl::GLCommandBuffer::depthFunc(GL_ALWAYS);
+    opengl::GLCommandBuffer::stencilOp(GL_KEEP,GL_KEEP,GL_INCR);
     for (int pass=0; pass < 4; pass++) {
         shader->setUniformValue("pass",pass);
-        glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+        opengl::GLCommandBuffer::drawArrays(GL_TRIANGLE_FAN, 0, 4);
     }
-    glDisable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
     //-----------------------------------------------
     // ...and cleanup
     //-----------------------------------------------
@@ -519,7 +507,7 @@ void DeepTransConvLayerBase::setupStencilBuffer() {
     fbo->unbind();
     vao->unbind();
     vbo->unbind();
-    glDeleteTextures(1, &helptex);
+    opengl::GLStateCache::deleteTextures(1, &helptex);
     delete vbo;
     delete vao;
     delete fbo;
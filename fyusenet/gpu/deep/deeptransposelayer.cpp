@@ -83,21 +83,21 @@ void DeepTransposeLayer::forward(uint64_t sequence, StateToken * token) {
     if (err != GL_NO_ERROR) FNLOGD("HINT: glerror on render entry: 0x%x (%s:%d)[%s]",err,__FILE__,__LINE__,getName().c_str());
 #endif
     if (outputChanged_) updateFBOs();
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_BLEND);
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    glViewport(0,0,viewport_[0],viewport_[1]);
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_STENCIL_TEST);
+    opengl::GLStateCache::disable(GL_CULL_FACE);
+    opengl::GLStateCache::disable(GL_BLEND);
+    opengl::GLStateCache::clearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    opengl::GLStateCache::viewport(0,0,viewport_[0],viewport_[1]);
     framebuffers_.at(0)->bind();
     framebuffers_.at(0)->setWriteMask();
-    glClear(GL_COLOR_BUFFER_BIT);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
     vertexArray_->bind();
     shader_->bind(shaderState_.get());
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
     int quads = outTiler_->numOutputTiles();
-    glDrawElements(GL_TRIANGLES, quads*6, GL_UNSIGNED_SHORT, (const GLvoid *)0);
+    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES, quads*6, GL_UNSIGNED_SHORT, (const GLvoid *)0);
     shader_->unbind();
     framebuffers_.at(0)->unbind();
     vertexArray_->unbind();
@@ -89,22 +89,22 @@ void Deep2ShallowLayer::forward(uint64_t sequenceNo, StateToken * state) {
 #endif
     std::lock_guard<std::recursive_mutex> lck(processingLock_);
     if (outputChanged_) updateFBOs();
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_BLEND);
-    glClearColor(0.0f,0.0f,0.0f,0.0f);
-    glViewport(0,0,viewport_[0],viewport_[1]);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D,inputTextures_.at(0));
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_STENCIL_TEST);
+    opengl::GLStateCache::disable(GL_CULL_FACE);
+    opengl::GLStateCache::disable(GL_BLEND);
+    opengl::GLStateCache::clearColor(0.0f,0.0f,0.0f,0.0f);
+    opengl::GLStateCache::viewport(0,0,viewport_[0],viewport_[1]);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputTextures_.at(0));
     shader_->bind();
     vertexArray_->bind();
     for (int pass=0; pass < (int)MRT_.size(); pass++) {
         framebuffers_.at(pass)->bind();
         framebuffers_.at(pass)->setWriteMask();
-        glClear(GL_COLOR_BUFFER_BIT);
+        opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
         shader_->setMappedUniformValue(UNIFORM_MRT,MRT_.at(pass));
-        glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_SHORT,(const GLvoid *)(pass*6*sizeof(short)));
+        opengl::GLCommandBuffer::drawElements(GL_TRIANGLES,6,GL_UNSIGNED_SHORT,(const GLvoid *)(pass*6*sizeof(short)));
         framebuffers_.at(pass)->unbind();
     }
     shader_->unbind();
@@ -60,7 +60,7 @@ BufferShape DownloadLayer::getOutputShape(int port) const {
     if (maxSequence_> 0) {
         return {width_, maxSequence_, dataType_, chanPacking_};
     } else {
-        return {width_, height_, inputChannels_, inputPadding_, dataType_, BufferShape::order::GPU_SHALLOW};
+        return {height_, width_, inputChannels_, inputPadding_, dataType_, BufferShape::order::GPU_SHALLOW};
     }
 }
 
@@ -162,7 +162,7 @@ void DownloadLayer::forward(uint64_t sequenceNo, StateToken * state) {
         // advantage doing that. It just makes the code easier.
         //-------------------------------------------------------------
         // FIXME (mw) we actually don't need to download all tokens here, just one, make this a builder flag
-        size_t read = (maxSequence_ > 0) ? sequenceLen_ * width_ * chanPacking_ * bytesPerChan_: 0;
+        size_t read = (maxSequence_ > 0) ? sequenceLen_ * width_ * chanPacking_ * bytesPerChan_: pboBytes();
         outputs_[0]->readFromPBO(*pbo, dataType_, sequenceNo, read);
     } else {
 #ifdef FYUSENET_MULTITHREADING
@@ -187,7 +187,7 @@ void DownloadLayer::asyncForward(uint64_t sequenceNo, StateToken * token, const
     asyncLock_.lock();
     auto thread = AsyncPool::getDerivedContextThread(context());
     threads_[sequenceNo] = thread;
-    thread->setTask(std::bind(&DownloadLayer::readoutPBO, this, thread, pbo, sync, sequenceNo, outputs_[0], callback));
+    thread->setTask(std::bind(&DownloadLayer::readoutPBO, this, thread, pbo, sync, sequenceNo, pboBytes(), outputs_[0], callback));
     if (userCallback_) userCallback_(sequenceNo, outputs_[0], AsyncLayer::DOWNLOAD_COMMENCED);
     asyncLock_.unlock();
 }
@@ -300,7 +300,7 @@ ManagedPBO DownloadLayer::pboBlit() {
     int paddedheight = (seq) ? maxSequence_ : height_ + 2*inputPadding_;
     int paddedchannels = (seq) ? chanPacking_ : LayerBase::PIXEL_PACKING * ((outputChannels_ + LayerBase::PIXEL_PACKING - 1) / LayerBase::PIXEL_PACKING);
     ManagedPBO pbo = pool->getAvailablePBO(paddedwidth, paddedheight, paddedchannels, bytesPerChan_);
-    pbo->prepareForRead(paddedwidth * paddedheight * paddedchannels * bytesPerChan_);
+    pbo->prepareForRead(pboBytes());
     int readchans = 0;
     pbo->bind(GL_PIXEL_PACK_BUFFER);
     for (int fb = 0 ; fb < numFBOs(); fb++) {
@@ -322,6 +322,24 @@ ManagedPBO DownloadLayer::pboBlit() {
     return pbo;
 }
 
+/**
+ * @brief Compute number of bytes that are transferred into the %PBO by pboBlit()
+ *
+ * @return Number of bytes written by a single blit
+ *
+ * %PBOs are taken from a shared pool and may have a larger capacity than required by this layer
+ * (for example after running a network on different resolutions). Readouts must therefore be
+ * limited to the size returned by this function instead of the %PBO capacity.
+ */
+size_t DownloadLayer::pboBytes() const {
+    bool seq = (maxSequence_ > 0);
+    int paddedwidth = (seq) ? width_ : width_ + 2*inputPadding_;
+    int paddedheight = (seq) ? maxSequence_ : height_ + 2*inputPadding_;
+    int paddedchannels = (seq) ? chanPacking_ : LayerBase::PIXEL_PACKING * ((outputChannels_ + LayerBase::PIXEL_PACKING - 1) / LayerBase::PIXEL_PACKING);
+    return (size_t)paddedwidth * paddedheight * paddedchannels * bytesPerChan_;
+}
+
+
 #ifdef FYUSENET_MULTITHREADING
 /**
  * @brief Perform readout of PBO memory buffer into destination CPUBuffer instance
@@ -330,6 +348,7 @@ ManagedPBO DownloadLayer::pboBlit() {
  * @param pbo Reference to a ManagedPBO instance which wraps the PBO to be read out
  * @param sync Handle of the OpenGL fence sync that indicates when the PBO is ready for readout
  * @param sequence Sequence number that refers to the content in the PBO to be read out
+ * @param bytes Number of bytes to read from the PBO (pooled PBOs may be larger than the content)
  * @param target Pointer to CPUBuffer where the data should be placed in
  * @param callback Callback function in the engine to pass notification about finished download
  *
@@ -346,13 +365,13 @@ ManagedPBO DownloadLayer::pboBlit() {
  *
  * @see UpDownLayerBuilder, Engine::asyncDownloadDone
  */
-void DownloadLayer::readoutPBO(AsyncPool::GLThread& myThread, opengl::ManagedPBO& pbo, GLsync sync, uint64_t sequence, cpu::CPUBuffer * target, const std::function<void(uint64_t)> & callback) {
+void DownloadLayer::readoutPBO(AsyncPool::GLThread& myThread, opengl::ManagedPBO& pbo, GLsync sync, uint64_t sequence, size_t bytes, cpu::CPUBuffer * target, const std::function<void(uint64_t)> & callback) {
     using namespace opengl;
     const GfxContextLink & ctx = myThread.context();
     bool rc = ctx.waitClientSync(sync, 5000000000);        // wait 5s max  (TODO (mw) configurable timeout)
     if (!rc) THROW_EXCEPTION_ARGS(FynException, "Cannot read out texture within 5s for sequence %ld", sequence);
     ctx.removeSync(sync);
-    target->readFromPBO(*pbo, BufferShape::type::FLOAT32, sequence);
+    target->readFromPBO(*pbo, BufferShape::type::FLOAT32, sequence, bytes);
     pbo.clearPending();
     if (callback) callback(sequence);
     if (userCallback_) userCallback_(sequence, target, AsyncLayer::DOWNLOAD_DONE);
@@ -172,10 +172,11 @@ class DownloadLayer : public GPULayerBase, public cpu::CPULayerInterface, public
     // ------------------------------------------------------------------------
     void setupFBOs() override;
     ManagedPBO pboBlit();
+    [[nodiscard]] size_t pboBytes() const;
     static BufferSpec::sizedformat bufferFormat(BufferSpec::dtype type, int packing);
     static bool isInt(BufferSpec::dtype type);
 #ifdef FYUSENET_MULTITHREADING
-    void readoutPBO(opengl::AsyncPool::GLThread& myThread, opengl::ManagedPBO& pbo, GLsync sync, uint64_t sequence, cpu::CPUBuffer * target, const std::function<void(uint64_t)> & callback);
+    void readoutPBO(opengl::AsyncPool::GLThread& myThread, opengl::ManagedPBO& pbo, GLsync sync, uint64_t sequence, size_t bytes, cpu::CPUBuffer * target, const std::function<void(uint64_t)> & callback);
 #endif
     // ------------------------------------------------------------------------
     // Member variables
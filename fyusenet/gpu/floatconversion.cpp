@@ -9,8 +9,17 @@
 
 //--------------------------------------- System Headers -------------------------------------------
 
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__)) && !defined(__EMSCRIPTEN__)
+#define FYN_X86_F16C
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define FYN_ARM_NEON_FP16
+#include <arm_neon.h>
+#endif
+
 //-------------------------------------- Project  Headers ------------------------------------------
 
+#include "../common/parallel.h"
 #include "floatconversion.h"
 
 namespace fyusion::fyusenet::gpu {
@@ -24,62 +33,201 @@ unsigned char FloatConversion::seed_[12] = {0xB2, 0x9E, 0x8D, 0x8B, 0x96, 0x91,
 
 //-------------------------------------- Local Definitions -----------------------------------------
 
+#ifdef FYN_X86_F16C
+/**
+ * @brief Convert FP32 to FP16 using F16C instructions
+ *
+ * @param input Pointer to input data
+ * @param[out] output Pointer to output data
+ * @param entries Number of elements to convert
+ *
+ * @return Number of elements that were converted, which is \p entries rounded down to a
+ *         multiple of 8
+ */
+__attribute__((target("avx,f16c")))
+static size_t f16cToFP16(const float *input, uint16_t *output, size_t entries) {
+    size_t i = 0;
+    for (; i + 8 <= entries; i += 8) {
+        __m128i half = _mm256_cvtps_ph(_mm256_loadu_ps(input + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128((__m128i *)(output + i), half);
+    }
+    return i;
+}
+
+/**
+ * @brief Convert FP16 to FP32 using F16C instructions
+ *
+ * @param input Pointer to input data
+ * @param[out] output Pointer to output data
+ * @param entries Number of elements to convert
+ *
+ * @return Number of elements that were converted, which is \p entries rounded down to a
+ *         multiple of 8
+ */
+__attribute__((target("avx,f16c")))
+static size_t f16cToFP32(const uint16_t *input, float *output, size_t entries) {
+    size_t i = 0;
+    for (; i + 8 <= entries; i += 8) {
+        __m256 full = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(input + i)));
+        _mm256_storeu_ps(output + i, full);
+    }
+    return i;
+}
+#endif
+
 
 /*##################################################################################################
 #                                   P U B L I C  F U N C T I O N S                                 #
 ##################################################################################################*/
 
 /**
- * @brief FloatConversion::toFP16UInt
- * @param input
- * @param entries
- * @return
+ * @brief Convert array of 32-bit floating-point numbers to packed pairs of FP16 numbers
+ *
+ * @param input Pointer to input data
+ * @param entries Number of elements in \p input, must be even
+ *
+ * @return Pointer to array of 32-bit integers with \p entries / 2 elements, where each element
+ *         contains two FP16 numbers (the lower 16 bits store the first number)
  *
  * @note Ownership is transferred to caller
+ *
+ * @see toFP16(const float*, uint16_t*, size_t)
  */
-unsigned int * FloatConversion::toFP16UI(float *input,int entries) const {
+unsigned int * FloatConversion::toFP16UI(const float *input,int entries) const {
     if (entries & 1) THROW_EXCEPTION_ARGS(FynException,"Requies even number of entries");
     unsigned int *result = new unsigned int[entries/2];
-    int out=0;
-    for (int i=0; i < entries; i+=2) {
-        unsigned int f1,f2;
-        *((float *)&f1) = input[i];
-        *((float *)&f2) = input[i+1];
-        unsigned short fp16_1 = baseTable_[(f1>>23) & 0x1ff]+((f1 & 0x007fffff) >> shiftTable_[(f1>>23) & 0x1ff]);
-        unsigned short fp16_2 = baseTable_[(f2>>23) & 0x1ff]+((f2 & 0x007fffff) >> shiftTable_[(f2>>23) & 0x1ff]);
-        result[out++] = ((unsigned int)fp16_2<<16) | (unsigned int)fp16_1;
-    }
+    // NOTE (mw) this assumes a little-endian CPU
+    toFP16(input, (uint16_t *)result, entries);
     return result;
 }
 
 
 /**
- * @brief FloatConversion::toFP16UInt
- * @param input
- * @param entries
- * @return
+ * @brief Convert array of 32-bit floating-point numbers to FP16 numbers
+ *
+ * @param input Pointer to input data
+ * @param entries Number of elements in \p input
+ *
+ * @return Pointer to array of FP16 numbers with \p entries elements
  *
  * @note Ownership is transferred to caller
+ *
+ * @see toFP16(const float*, uint16_t*, size_t)
  */
-unsigned short * FloatConversion::toFP16US(float *input, int entries) const {
+unsigned short * FloatConversion::toFP16US(const float *input, int entries) const {
     unsigned short *result = new unsigned short[entries];
-    int out=0;
-    for (int i=0; i < entries; i++) {
-        unsigned int f;
-        *((float *)&f) = input[i];
-        unsigned short fp16 = baseTable_[(f>>23) & 0x1ff] + ((f & 0x007fffff) >> shiftTable_[(f>>23) & 0x1ff]);
-        result[out++] = fp16;
-    }
+    toFP16(input, result, entries);
     return result;
 }
 
 
+/**
+ * @brief Convert array of 32-bit floating-point numbers to FP16 into caller-supplied memory
+ *
+ * @param input Pointer to input data
+ * @param[out] output Pointer to output data, must have space for \p entries FP16 numbers
+ * @param entries Number of elements to convert
+ *
+ * Uses hardware conversion where supported and splits large arrays into chunks that are
+ * converted in parallel (multi-threaded builds only).
+ */
+void FloatConversion::toFP16(const float *input, uint16_t *output, size_t entries) const {
+    parallelFor(entries, PARALLEL_THRESHOLD, [&](size_t start, size_t end) {
+        chunkToFP16(input + start, output + start, end - start);
+    }, 8);
+}
+
+
+/**
+ * @brief Convert array of FP16 numbers to 32-bit floating-point numbers
+ *
+ * @param input Pointer to FP16 input data
+ * @param[out] output Pointer to output data, must have space for \p entries numbers
+ * @param entries Number of elements to convert
+ *
+ * This is the reverse direction of toFP16(const float*, uint16_t*, size_t) and is meant for
+ * converting half-precision data that was downloaded from the GPU.
+ */
+void FloatConversion::toFP32(const uint16_t *input, float *output, size_t entries) const {
+    parallelFor(entries, PARALLEL_THRESHOLD, [&](size_t start, size_t end) {
+        chunkToFP32(input + start, output + start, end - start);
+    }, 8);
+}
+
+
 /*##################################################################################################
 #                               N O N -  P U B L I C  F U N C T I O N S                            #
 ##################################################################################################*/
 
+/**
+ * @brief Table-based conversion from FP32 to FP16
+ *
+ * @param input Pointer to input data
+ * @param[out] output Pointer to output data
+ * @param entries Number of elements to convert
+ */
+void FloatConversion::tableToFP16(const float *input, uint16_t *output, size_t entries) const {
+    for (size_t i=0; i < entries; i++) output[i] = toFP16(input[i]);
+}
+
+
+/**
+ * @brief Convert a chunk of FP32 data to FP16 using the fastest available method
+ *
+ * @param input Pointer to input data
+ * @param[out] output Pointer to output data
+ * @param entries Number of elements to convert
+ */
+void FloatConversion::chunkToFP16(const float *input, uint16_t *output, size_t entries) const {
+#if defined(FYN_X86_F16C)
+    if (hwSupport_) {
+        size_t done = f16cToFP16(input, output, entries);
+        tableToFP16(input + done, output + done, entries - done);
+        return;
+    }
+#elif defined(FYN_ARM_NEON_FP16)
+    size_t i = 0;
+    for (; i + 4 <= entries; i += 4) {
+        vst1_u16(output + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(input + i))));
+    }
+    tableToFP16(input + i, output + i, entries - i);
+    return;
+#endif
+    tableToFP16(input, output, entries);
+}
+
 
+/**
+ * @brief Convert a chunk of FP16 data to FP32 using the fastest available method
+ *
+ * @param input Pointer to input data
+ * @param[out] output Pointer to output data
+ * @param entries Number of elements to convert
+ */
+void FloatConversion::chunkToFP32(const uint16_t *input, float *output, size_t entries) const {
+    size_t i = 0;
+#if defined(FYN_X86_F16C)
+    if (hwSupport_) i = f16cToFP32(input, output, entries);
+#elif defined(FYN_ARM_NEON_FP16)
+    for (; i + 4 <= entries; i += 4) {
+        vst1q_f32(output + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(input + i))));
+    }
+#endif
+    for (; i < entries; i++) output[i] = toFP32(input[i]);
+}
+
+
+/**
+ * @brief Constructor
+ *
+ * Sets up the conversion tables and checks for hardware conversion support.
+ */
 FloatConversion::FloatConversion() {
+#if defined(FYN_X86_F16C)
+    hwSupport_ = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+#elif defined(FYN_ARM_NEON_FP16)
+    hwSupport_ = true;
+#endif
     // ftp://www.fox-toolkit.org/pub/fasthalffloatconversion.pdf
     for (int i=0; i < 256; i++) {
         int e = i-127;
@@ -13,6 +13,8 @@
 //--------------------------------------- System Headers -------------------------------------------
 
 #include <vector>
+#include <cstdint>
+#include <cstddef>
 
 //-------------------------------------- Project  Headers ------------------------------------------
 
@@ -31,12 +33,22 @@ namespace gpu {
  *
  * Based on paper "Fast Half Float Conversion" by Jeroen van der Zijp
  * ftp://ftp.fox-toolkit.org/pub/fasthalffloatconversion.pdf
+ *
+ * The bulk conversion functions toFP16() and toFP32() use hardware conversion instructions
+ * where available (F16C on x86, NEON on 64-bit ARM) and fall back to the table-based conversion
+ * otherwise. For large arrays and multi-threaded builds, the conversion is split into chunks
+ * that are processed in parallel.
+ *
+ * @note The hardware conversion rounds to the nearest representable value, whereas the
+ *       table-based conversion truncates. Results may therefore differ in the last bit.
  */
 class FloatConversion {
  public:
 
-    unsigned int * toFP16UI(float *input,int entries) const;
-    unsigned short * toFP16US(float *input,int entries) const;
+    unsigned int * toFP16UI(const float *input, int entries) const;
+    unsigned short * toFP16US(const float *input, int entries) const;
+    void toFP16(const float *input, uint16_t *output, size_t entries) const;
+    void toFP32(const uint16_t *input, float *output, size_t entries) const;
 
     inline unsigned short toFP16(float fp) const {
         unsigned int f;
@@ -54,6 +66,20 @@ class FloatConversion {
         return (fp16_1<<16) | fp16_2;
     }
 
+    static inline float toFP32(uint16_t fp16) {
+        uint32_t sign = ((uint32_t)fp16 & 0x8000) << 16;
+        uint32_t exponent = (fp16 >> 10) & 0x1f;
+        uint32_t mantissa = fp16 & 0x3ff;
+        uint32_t f;
+        if (exponent == 0) {
+            // zero or denormalized number
+            float denorm = (float)mantissa * (1.0f / 16777216.0f);
+            return (sign) ? -denorm : denorm;
+        } else if (exponent == 31) f = sign | 0x7f800000 | (mantissa << 13);
+        else f = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        return *((float *)&f);
+    }
+
     static inline FloatConversion * getInstance() {
         static FloatConversion singleton;
         return &singleton;
@@ -61,9 +87,15 @@ class FloatConversion {
 
  private:
     FloatConversion();
+    void tableToFP16(const float *input, uint16_t *output, size_t entries) const;
+    void chunkToFP16(const float *input, uint16_t *output, size_t entries) const;
+    void chunkToFP32(const uint16_t *input, float *output, size_t entries) const;
+
     static unsigned short baseTable_[512];
     static unsigned short shiftTable_[512];
     static unsigned char seed_[12];
+    bool hwSupport_ = false;                        //!< Indicator if hardware conversion is available on the CPU
+    constexpr static size_t PARALLEL_THRESHOLD = 1 << 18;   //!< Minimum number of elements for multi-threaded conversion
 };
 
 } // gpu namespace
@@ -170,12 +170,12 @@ void FunctionLayer::forward(uint64_t sequence, StateToken * state) {
     beforeRender();
     int totaltex = (inputChannels_ / PIXEL_PACKING) + (((inputChannels_ % PIXEL_PACKING) > 0) ? 1 : 0);
     if (isSequence_) {
-        glEnable(GL_SCISSOR_TEST);
+        opengl::GLStateCache::enable(GL_SCISSOR_TEST);
         totaltex = 1;
-        glScissor(0, 0, viewport_[0], state->seqLength);
-        glViewport(0, 0, viewport_[0], state->seqLength);
+        opengl::GLCommandBuffer::scissor(0, 0, viewport_[0], state->seqLength);
+        opengl::GLStateCache::viewport(0, 0, viewport_[0], state->seqLength);
     } else {
-        glViewport(0, 0, viewport_[0], viewport_[1]);
+        opengl::GLStateCache::viewport(0, 0, viewport_[0], viewport_[1]);
     }
     int texoffset = 0;
     vertexArray_->bind();
@@ -183,12 +183,12 @@ void FunctionLayer::forward(uint64_t sequence, StateToken * state) {
         framebuffers_.at(opass)->bind();
         framebuffers_.at(opass)->setWriteMask();
         if (totaltex >= maxRenderTargets_) {
-            glClear(GL_COLOR_BUFFER_BIT); // this is to instruct the tile-engine that we don't need the old tile-content
+            opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT); // this is to instruct the tile-engine that we don't need the old tile-content
             renderChannelBatch(opass, maxRenderTargets_, texoffset);
             texoffset += maxRenderTargets_;
             totaltex -= maxRenderTargets_;
         } else if (totaltex > 0) {
-            glClear(GL_COLOR_BUFFER_BIT); // this is to instruct the tile-engine that we don't need the old tile-content
+            opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT); // this is to instruct the tile-engine that we don't need the old tile-content
             renderChannelBatch(opass, totaltex, texoffset);
             texoffset += totaltex;
             totaltex = 0;
@@ -197,7 +197,7 @@ void FunctionLayer::forward(uint64_t sequence, StateToken * state) {
     }
     afterRender();
     vertexArray_->unbind();
-    if (isSequence_) glDisable(GL_SCISSOR_TEST);
+    if (isSequence_) opengl::GLStateCache::disable(GL_SCISSOR_TEST);
 }
 
 
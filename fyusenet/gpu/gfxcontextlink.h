@@ -12,6 +12,8 @@
 
 //--------------------------------------- System Headers -------------------------------------------
 
+#include <cstdint>
+
 //-------------------------------------- Project  Headers ------------------------------------------
 
 #include "../gl/gl_sys.h"
@@ -87,6 +89,8 @@ class GfxContextLink {
     bool waitClientSync(syncid sync, GLuint64 timeout) const;    
     void removeSync(syncid sync) const;
     [[nodiscard]] opengl::ScopedTexturePool * texturePool() const;
+    static void syncWaitStatistics(uint64_t & waits, uint64_t & nanos);
+    static void resetSyncWaitStatistics();
 
     /**
      * @brief Check if this link points to a valid context
@@ -15,6 +15,7 @@
 #include <cassert>
 #include <vector>
 #include <memory>
+#include <string>
 
 //-------------------------------------- Project  Headers ------------------------------------------
 
@@ -47,11 +48,9 @@ namespace fyusenet {
  *       addition, the class resides within the fyusenet namespace. This is done for extension
  *       reasons (change of backend) and not by accident. Not very clean though.
  *
- * @warning We currently support only one GPU/device. Though the context manager has some
- *          preparations for multi-GPU support done already, the tear-down mechanism
- *          currently assumes that the context manager is a singleton. For multi-GPU support,
- *          the teardown of the GL thread pool and the shader cache need to be adjusted for
- *          multi-GPU support.
+ * Multiple devices are supported by using one manager instance per device (see instance()). The
+ * GL thread pool and the shader cache are shared by all devices and are torn down with all
+ * managers in tearDown(). To distribute inference over several devices, see NetworkDispatcher.
  *
  * @see GfxContextLink
  */
@@ -83,6 +82,7 @@ class GfxContextManager {
     fyusenet::GfxContextLink getDerived(const fyusenet::GfxContextLink& ctx, int derivedIndex) const;
     void setupPBOPools(int readPoolSize, int writePoolSize);
     void setupTexturePool();
+    bool setupProgramBinaryCache(const std::string & fileName);
     static std::shared_ptr<GfxContextManager> instance(int device=0);
     static void tearDown();
     void cleanup();
@@ -149,7 +149,7 @@ class GfxContextManager {
     opengl::ScopedTexturePool * texturePool_ = nullptr;   //!< Pointer to optional texture pool
 
     /**
-     * List of manager singletons, indexed by device ID (starting at 0)
+     * List of manager singletons, one per device ID
      */
     static std::vector<std::shared_ptr<GfxContextManager>> managers_;
 };
@@ -871,19 +871,19 @@ programptr GPULayerBase::compileShaderPair(const char *vertexName, const char *f
  */
 void GPULayerBase::prepareRender(bool blend, bool depth, bool ignoreVP) {
     if (outputChanged_) updateFBOs();
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_CULL_FACE);
-    if (blend) glEnable(GL_BLEND);
-    else glDisable(GL_BLEND);
-    if (depth) glEnable(GL_DEPTH_TEST);
-    else glDisable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_STENCIL_TEST);
+    opengl::GLStateCache::disable(GL_CULL_FACE);
+    if (blend) opengl::GLStateCache::enable(GL_BLEND);
+    else opengl::GLStateCache::disable(GL_BLEND);
+    if (depth) opengl::GLStateCache::enable(GL_DEPTH_TEST);
+    else opengl::GLStateCache::disable(GL_DEPTH_TEST);
     if (blend) {
-        glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-        glBlendFuncSeparate(GL_ONE,GL_ONE, GL_ONE,GL_ONE);
+        opengl::GLStateCache::blendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+        opengl::GLStateCache::blendFuncSeparate(GL_ONE,GL_ONE, GL_ONE,GL_ONE);
     }
-    glClearColor(0, 0, 0, 0);
-    if (ignoreVP) glViewport(0, 0, viewport_[0], viewport_[1]);
+    opengl::GLStateCache::clearColor(0, 0, 0, 0);
+    if (ignoreVP) opengl::GLStateCache::viewport(0, 0, viewport_[0], viewport_[1]);
 }
 
 /**
@@ -894,8 +894,8 @@ void GPULayerBase::prepareRender(bool blend, bool depth, bool ignoreVP) {
  */
 void GPULayerBase::disableTextureUnits(int numUnits, int startUnit) {
     for (int i = startUnit; i < numUnits + startUnit; i++) {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        opengl::GLStateCache::activeTexture(GL_TEXTURE0 + i);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, 0);
     }
 }
 
@@ -47,6 +47,7 @@ namespace opengl {
 namespace fyusenet {
 class NeuralNetwork;
 class BufferManager;
+class Engine;
 
 namespace gpu {
 
@@ -114,6 +115,7 @@ class GPULayerBase : public LayerBase, public GfxContextTracker {
     friend class ::LayerTestBase;
     friend class fyusion::fyusenet::BufferManager;
     friend class fyusion::fyusenet::NeuralNetwork;
+    friend class fyusion::fyusenet::Engine;
     friend class GPUAsyncLayer;
  public:
 
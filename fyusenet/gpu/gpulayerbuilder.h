@@ -49,6 +49,7 @@ struct GPULayerBuilderTempl : LayerBuilderTempl<D> {
      */
     GPULayerBuilderTempl(const D& src) : LayerBuilderTempl<D>(src) {
       context_ = src.context_;
+      batchSize_ = src.batchSize_;
     }
 
     /**
@@ -63,7 +64,27 @@ struct GPULayerBuilderTempl : LayerBuilderTempl<D> {
       return *(D *)this;
     }
 
+    /**
+     * @brief Set number of images that are spatially batched in the tensors of the layer
+     *
+     * @param images Number of images in the batch
+     *
+     * @return Reference to builder object
+     *
+     * Deep-format layers support processing multiple images of the same size in a single pass.
+     * For this purpose, the tiles of all images are placed on the same texture, such that every
+     * draw call covers the whole batch, see DeepTiler for details. All layers that operate on
+     * a batched tensor must be configured with the same batch size.
+     *
+     * @note Not all layer types support batching, see GPULayerFactory for the supported types.
+     */
+    D & batch(int images) {
+      batchSize_ = images;
+      return *(D *)this;
+    }
+
     GfxContextLink context_;                     //!< GL context to use for the newly-built layer
+    int batchSize_ = 1;                          //!< Number of (spatially) batched images
 };
 
 /**
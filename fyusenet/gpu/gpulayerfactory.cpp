@@ -23,6 +23,7 @@
 #include "deep/deeptransconvlayer3x3.h"
 #include "deep/deepdownloadlayer.h"
 #include "deep/deepargmaxlayer.h"
+#include "deep/deeptopklayer.h"
 #include "deep/deepconvlayer1x1.h"
 #include "deep/deepgemmlayer.h"
 #include "deep/deepconvlayerNxN.h"
@@ -39,6 +40,8 @@
 #include "downloadlayer.h"
 #include "uploadlayer.h"
 #include "rgb2bgrlayer.h"
+#include "imgpreproclayer.h"
+#include "compactlayer.h"
 #include "nonmaxsuppression2d.h"
 #include "blurlayer.h"
 #include "scalelayer.h"
@@ -74,6 +77,45 @@ namespace fyusion::fyusenet::gpu {
 
 //-------------------------------------- Local Definitions -----------------------------------------
 
+/**
+ * @brief Check if a layer supports spatial batching of multiple images
+ *
+ * @param type Layer type to check
+ * @param builder Builder that contains the parameters for the layer
+ *
+ * @retval true if the layer that would be created from the supplied parameters supports batching
+ * @retval false otherwise
+ *
+ * Spatial batching is only supported on deep-format layers that place their proxy polygons via
+ * the DeepTiler on a per-image basis, plus the layers that enter/leave the deep-format part of the
+ * network (Shallow2DeepLayer and DeepDownloadLayer).
+ */
+static bool supportsBatching(LayerType type, LayerBuilder * builder) {
+    if (type == LayerType::SHALLOW2DEEP) return true;
+    if (!builder->isDeep()) return false;
+    switch (type) {
+        case LayerType::CONVOLUTION2D: {
+            auto * conv = (ConvLayerBuilder *)builder;
+            return !((conv->groupSize_ != 1) && (conv->groupSize_ == conv->in()));
+        }
+        case LayerType::MAXPOOL2D:
+        case LayerType::AVGPOOL2D:
+            return !((PoolLayerBuilder *)builder)->global_;
+        case LayerType::RELU:
+        case LayerType::CLIP:
+        case LayerType::SCALE2D:
+        case LayerType::SIGMOID:
+        case LayerType::TANH:
+        case LayerType::SINGLETON_ARITH:
+        case LayerType::CAST:
+        case LayerType::BATCHNORM:
+        case LayerType::DOWNLOAD:
+            return true;
+        default:
+            return false;
+    }
+}
+
 
 /*##################################################################################################
 #                                   P U B L I C  F U N C T I O N S                                 #
@@ -111,6 +153,9 @@ std::string GPULayerFactoryBackend::getName() const {
  */
 fyusenet::LayerBase * GPULayerFactoryBackend::createLayer(LayerType type,LayerBuilder * builder, int layerNumber) {
     if (!builder) THROW_EXCEPTION_ARGS(FynException,"No builder supplied to layer factory line");
+    if ((((GPULayerBuilder *)builder)->batchSize_ > 1) && (!supportsBatching(type, builder))) {
+        THROW_EXCEPTION_ARGS(FynException,"Layer %s does not support batching", builder->name_.c_str());
+    }
     switch (type) {
         case LayerType::OESCONV:
 #ifdef FYUSENET_USE_EGL
@@ -164,10 +209,16 @@ fyusenet::LayerBase * GPULayerFactoryBackend::createLayer(LayerType type,LayerBu
             return (fyusenet::LayerBase *)createImgExtractLayer((ImgExtractLayerBuilder *)builder, layerNumber);
         case LayerType::NONMAX2D:
             return (fyusenet::LayerBase *)createNonMax2DLayer((GPULayerBuilder *)builder, layerNumber);
+        case LayerType::COMPACT2D:
+            return (fyusenet::LayerBase *)createCompactLayer((CompactLayerBuilder *)builder, layerNumber);
+        case LayerType::TOPK:
+            return (fyusenet::LayerBase *)createTopKLayer((TopKLayerBuilder *)builder, layerNumber);
         case LayerType::BLUR2D:
             return (fyusenet::LayerBase *)createBlur2DLayer((BlurLayerBuilder *)builder, layerNumber);
         case LayerType::RGB2BGR:
             return (fyusenet::LayerBase *)createRGB2BGRLayer((GPULayerBuilder *)builder, layerNumber);
+        case LayerType::IMGPREPROC:
+            return (fyusenet::LayerBase *)createImgPreprocLayer((ImgPreprocLayerBuilder *)builder, layerNumber);
         case LayerType::TANH:
             return (fyusenet::LayerBase *)createTanhLayer((GPULayerBuilder *)builder, layerNumber);
         case LayerType::SINGLETON_ARITH:
@@ -767,6 +818,64 @@ GPULayerBase * GPULayerFactoryBackend::createRGB2BGRLayer(GPULayerBuilder *build
 }
 
 
+/**
+ * @brief Create an image preprocessing layer
+ *
+ * @param builder Instance of ImgPreprocLayerBuilder that contains the parameters for the layer
+ *
+ * @param layerNumber Layer number to be assigned to the created layer, must be unique
+ *
+ * @return Raw pointer to created layer
+ *
+ * @see ImgPreprocLayer
+ *
+ * @warning This is only implemented for shallow format tensors
+ */
+GPULayerBase * GPULayerFactoryBackend::createImgPreprocLayer(ImgPreprocLayerBuilder *builder, int layerNumber) {
+    if (builder->isDeep()) {
+        THROW_EXCEPTION_ARGS(FynException,"Deep image preprocessing currently not supported");
+    }
+    return new ImgPreprocLayer(*builder, layerNumber);
+}
+
+
+/**
+ * @brief Create a sparse compaction layer
+ *
+ * @param builder Instance of CompactLayerBuilder that contains the parameters for the layer
+ *
+ * @param layerNumber Layer number to be assigned to the created layer, must be unique
+ *
+ * @return Raw pointer to created layer
+ *
+ * @see CompactLayer
+ */
+GPULayerBase * GPULayerFactoryBackend::createCompactLayer(CompactLayerBuilder *builder, int layerNumber) {
+    return new CompactLayer(*builder, layerNumber);
+}
+
+
+/**
+ * @brief Create a top-K selection layer
+ *
+ * @param builder Instance of TopKLayerBuilder that contains the parameters for the layer
+ *
+ * @param layerNumber Layer number to be assigned to the created layer, must be unique
+ *
+ * @return Raw pointer to created layer
+ *
+ * @see deep::DeepTopKLayer
+ *
+ * @warning This layer is currently only implemented for deep-tensor format
+ */
+GPULayerBase * GPULayerFactoryBackend::createTopKLayer(TopKLayerBuilder *builder, int layerNumber) {
+    if (builder->isDeep()) {
+        return new deep::DeepTopKLayer(*builder, layerNumber);
+    }
+    THROW_EXCEPTION_ARGS(FynException, "Top-K layer is only supported for deep tensor format");
+}
+
+
 /**
  * @brief Create a singleton arithmetic layer where a singleton is arithmetically combined with a tensor
  *
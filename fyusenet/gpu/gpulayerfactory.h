@@ -26,6 +26,9 @@
 #include "argmaxlayerbuilder.h"
 #include "blurlayerbuilder.h"
 #include "imgextractlayerbuilder.h"
+#include "imgpreproclayerbuilder.h"
+#include "compactlayerbuilder.h"
+#include "topklayerbuilder.h"
 #include "singleton_arithlayerbuilder.h"
 #include "castlayerbuilder.h"
 #include "customlayerbuilder.h"
@@ -87,6 +90,9 @@ class GPULayerFactoryBackend : public LayerFactoryBackend {
     [[nodiscard]] GPULayerBase * createNonMax2DLayer(GPULayerBuilder *builder, int layerNumber);
     [[nodiscard]] GPULayerBase * createBlur2DLayer(BlurLayerBuilder *builder, int layerNumber);
     [[nodiscard]] GPULayerBase * createRGB2BGRLayer(GPULayerBuilder *builder, int layerNumber);
+    [[nodiscard]] GPULayerBase * createImgPreprocLayer(ImgPreprocLayerBuilder *builder, int layerNumber);
+    [[nodiscard]] GPULayerBase * createCompactLayer(CompactLayerBuilder *builder, int layerNumber);
+    [[nodiscard]] GPULayerBase * createTopKLayer(TopKLayerBuilder *builder, int layerNumber);
     [[nodiscard]] GPULayerBase * createSingletonArithLayer(SingletonArithLayerBuilder *builder, int layerNumber);
     [[nodiscard]] GPULayerBase * createCastLayer(CastLayerBuilder *builder, int layerNumber);
     [[nodiscard]] GPULayerBase * createTransposeLayer(TransposeLayerBuilder * builder, int layerNumber);
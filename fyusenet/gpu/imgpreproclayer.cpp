@@ -0,0 +1,189 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Image Preprocessing Layer
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <cstring>
+#include <algorithm>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "imgpreproclayer.h"
+#include "../gl/glexception.h"
+
+namespace fyusion::fyusenet::gpu {
+
+//-------------------------------------- Global Variables ------------------------------------------
+
+
+//-------------------------------------- Local Definitions -----------------------------------------
+
+
+/*##################################################################################################
+#                                   P U B L I C  F U N C T I O N S                                 #
+##################################################################################################*/
+
+/**
+ * @copydoc GPULayerBase::GPULayerBase(const GPULayerBuilder&,int)
+ */
+ImgPreprocLayer::ImgPreprocLayer(const ImgPreprocLayerBuilder & builder, int layerNumber) :
+      RGB2BGRLayer((const GPULayerBuilder &)builder, layerNumber) {
+    if (inputPadding_ != 0) THROW_EXCEPTION_ARGS(FynException, "Image preprocessing does not support input padding (%s)", getName().c_str());
+    if (outputChannels_ != 3) THROW_EXCEPTION_ARGS(FynException, "Image preprocessing requires 3 output channels (%s)", getName().c_str());
+    srcWidth_ = (builder.srcWidth_ > 0) ? builder.srcWidth_ : width_;
+    srcHeight_ = (builder.srcHeight_ > 0) ? builder.srcHeight_ : height_;
+    format_ = builder.srcFormat_;
+    swapRB_ = builder.swapRB_;
+    if ((format_ == ImgPreprocLayerBuilder::NV12) && ((srcWidth_ & 1) || (srcHeight_ & 1))) {
+        THROW_EXCEPTION_ARGS(FynException, "NV12 images require even dimensions (%s)", getName().c_str());
+    }
+    // ------------------------------------------------------------
+    // Compute the region of the source image (in normalized texture
+    // coordinates) that is mapped to the output...
+    // ------------------------------------------------------------
+    cropRect_[0] = 0.0f;
+    cropRect_[1] = 0.0f;
+    cropRect_[2] = 1.0f;
+    cropRect_[3] = 1.0f;
+    if (builder.cropResize_ > 0) {
+        float scale = (float)builder.cropResize_ / (float)std::min(srcWidth_, srcHeight_);
+        cropRect_[2] = std::min(1.0f, (float)width_ / ((float)srcWidth_ * scale));
+        cropRect_[3] = std::min(1.0f, (float)height_ / ((float)srcHeight_ * scale));
+        cropRect_[0] = 0.5f * (1.0f - cropRect_[2]);
+        cropRect_[1] = 0.5f * (1.0f - cropRect_[3]);
+    }
+    for (int i=0; i < 3; i++) {
+        if (builder.std_[i] == 0.0f) THROW_EXCEPTION_ARGS(FynException, "Zero standard deviation supplied (%s)", getName().c_str());
+        mean_[i] = builder.mean_[i];
+        invStd_[i] = 1.0f / builder.std_[i];
+    }
+}
+
+
+/**
+ * @copydoc FunctionLayer::setup
+ *
+ * In addition to the default setup, this creates a sampler object that performs bilinear
+ * filtering on the source image(s), which leaves the filter state of the input textures as is.
+ */
+void ImgPreprocLayer::setup() {
+    RGB2BGRLayer::setup();
+    glGenSamplers(1, &sampler_);
+    glSamplerParameteri(sampler_, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glSamplerParameteri(sampler_, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glSamplerParameteri(sampler_, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(sampler_, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+
+/**
+ * @copydoc RGB2BGRLayer::cleanup
+ */
+void ImgPreprocLayer::cleanup() {
+    if (sampler_ != 0) glDeleteSamplers(1, &sampler_);
+    sampler_ = 0;
+    RGB2BGRLayer::cleanup();
+}
+
+
+/**
+ * @brief Obtain buffer specifiers that are required as input for this layer
+ *
+ * @return Vector of buffer specifiers that specify the format for each required buffer
+ *
+ * The input of this layer has the size of the source image. RGB and RGBA images are expected
+ * as single 8-bit texture, NV12 images as 8-bit luminance texture (channel index 0) and 8-bit
+ * two-channel chrominance texture with half the resolution (channel index 1), as produced by
+ * the UploadLayer.
+ */
+std::vector<BufferSpec> ImgPreprocLayer::getRequiredInputBuffers() const {
+    std::vector<BufferSpec> result;
+    auto addspec = [&](int channelIndex, int width, int height, int channels) {
+        auto format = BufferSpec::formatByChannels(channels, BufferSpec::dtype::UBYTE);
+        result.push_back(BufferSpec(channelIndex, 0, width, height, format.first, format.second, BufferSpec::dtype::UBYTE,
+                                    BufferSpec::FUNCTION_SOURCE, channels).interpolation(BufferSpec::interp::ANY));
+    };
+    switch (format_) {
+        case ImgPreprocLayerBuilder::NV12:
+            addspec(0, srcWidth_, srcHeight_, 1);
+            addspec(1, srcWidth_ / 2, srcHeight_ / 2, 2);
+            break;
+        case ImgPreprocLayerBuilder::RGBA:
+            addspec(0, srcWidth_, srcHeight_, 4);
+            break;
+        default:
+            addspec(0, srcWidth_, srcHeight_, 3);
+            break;
+    }
+    return result;
+}
+
+
+/*##################################################################################################
+#                               N O N -  P U B L I C  F U N C T I O N S                            #
+##################################################################################################*/
+
+/**
+ * @copydoc FunctionLayer::renderChannelBatch
+ */
+void ImgPreprocLayer::renderChannelBatch(int outPass, int numRenderTargets, int texOffset) {
+    int numtex = (format_ == ImgPreprocLayerBuilder::NV12) ? 2 : 1;
+    for (int tex=0; tex < numtex; tex++) {
+        opengl::GLStateCache::activeTexture(GL_TEXTURE0 + tex);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(tex));
+        // resizing requires bilinear interpolation on the source image
+        glBindSampler(tex, sampler_);
+    }
+    if (currentShader_ != shaders_[0].get()) {
+        if (currentShader_) currentShader_->unbind(true);
+        currentShader_ = shaders_[0].get();
+        currentShader_->bind(shaderStates_[0].get());
+    }
+    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *)0);
+}
+
+
+/**
+ * @copydoc FunctionLayer::afterRender
+ */
+void ImgPreprocLayer::afterRender() {
+    int numtex = (format_ == ImgPreprocLayerBuilder::NV12) ? 2 : 1;
+    for (int tex=0; tex < numtex; tex++) glBindSampler(tex, 0);
+    RGB2BGRLayer::afterRender();
+}
+
+
+/**
+ * @copydoc FunctionLayer::setupShaders
+ */
+void ImgPreprocLayer::setupShaders() {
+    char preproc[128] = {0};
+    snprintf(preproc, sizeof(preproc), "#define NV12 %d\n#define SWAP_RB %d\n",
+             (format_ == ImgPreprocLayerBuilder::NV12) ? 1 : 0, (swapRB_) ? 1 : 0);
+    programptr shader = compileShaderPair("shaders/default.vert", "shaders/imgpreproc.frag", preproc, typeid(this));
+    try {
+        shader->bindAttributeLocation("attributes0", 0);
+        shader->link();
+    } catch (GLException& ex) {
+        FNLOGE("Cannot link shader for layer %s", getName().c_str());
+        throw;
+    }
+    unistateptr state = UniformState::makeShared(shader);
+    state->setUniformValue("inputLayer0", 0);
+    state->setUniformValue("inputLayer1", 1, true);
+    state->setUniformVec4("cropRect", cropRect_[0], cropRect_[1], cropRect_[2], cropRect_[3]);
+    state->setUniformVec3("mean", mean_[0], mean_[1], mean_[2]);
+    state->setUniformVec3("invStd", invStd_[0], invStd_[1], invStd_[2]);
+    shaders_[0] = shader;
+    shaderStates_[0] = state;
+}
+
+} // fyusion::fyusenet::gpu namespace
+
+// vim: set expandtab ts=4 sw=4:
@@ -0,0 +1,87 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Image Preprocessing Layer (Header)
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <vector>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "../gl/gl_sys.h"
+#include "../gl/uniformstate.h"
+#include "../gl/shaderprogram.h"
+#include "rgb2bgrlayer.h"
+#include "imgpreproclayerbuilder.h"
+
+//------------------------------------- Public Declarations ----------------------------------------
+namespace fyusion::fyusenet::gpu {
+
+/**
+ * @brief Fused image preprocessing layer
+ *
+ * This layer converts images which were uploaded as 8-bit data (RGB, RGBA or NV12, see
+ * UploadLayer) into floating-point RGB tensors for consumption by the network. In a single pass,
+ * it performs:
+ *   - bilinear resizing from the source image size to the output size of the layer
+ *   - optional center crop (after resizing the shorter side of the image to a specified size)
+ *   - YUV to RGB conversion for NV12 input (BT.601, limited range)
+ *   - optional red/blue channel swap
+ *   - per-channel mean/std normalization
+ *
+ * Doing this on the GPU allows to upload images at their original size and in 8-bit format,
+ * which reduces the upload bandwidth and removes the conversion pass on the CPU.
+ *
+ * @note Bilinear filtering is done with a sampler object, the filter settings of the input
+ *       textures themselves are not changed by this layer. Floating-point textures may not
+ *       support filtering on some GL(ES) implementations, the input of this layer should
+ *       therefore be 8-bit data.
+ *
+ * @see ImgPreprocLayerBuilder
+ */
+class ImgPreprocLayer : public RGB2BGRLayer {
+ public:
+    // ------------------------------------------------------------------------
+    // Constructor / Destructor
+    // ------------------------------------------------------------------------
+    ImgPreprocLayer(const ImgPreprocLayerBuilder & builder, int layerNumber);
+
+    // ------------------------------------------------------------------------
+    // Public methods
+    // ------------------------------------------------------------------------
+    void setup() override;
+    void cleanup() override;
+    [[nodiscard]] std::vector<BufferSpec> getRequiredInputBuffers() const override;
+
+ protected:
+    // ------------------------------------------------------------------------
+    // Non-public methods
+    // ------------------------------------------------------------------------
+    void renderChannelBatch(int outPass, int numRenderTargets, int texOffset) override;
+    void afterRender() override;
+    void setupShaders() override;
+
+    // ------------------------------------------------------------------------
+    // Member variables
+    // ------------------------------------------------------------------------
+    int srcWidth_;                              //!< Width of the source image
+    int srcHeight_;                             //!< Height of the source image
+    ImgPreprocLayerBuilder::pixformat format_;  //!< Pixel format of the source image
+    bool swapRB_;                               //!< Indicator whether to swap red and blue channels
+    float cropRect_[4];                         //!< Offset (x,y) and extent (x,y) of the sampled region in normalized texture coordinates
+    float mean_[3];                             //!< Per-channel mean for normalization
+    float invStd_[3];                           //!< Reciprocal per-channel standard deviation for normalization
+    GLuint sampler_ = 0;                        //!< Sampler object that performs bilinear filtering on the source image(s)
+};
+
+} // fyusion::fyusenet::gpu namespace
+
+// vim: set expandtab ts=4 sw=4:
@@ -0,0 +1,156 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Image Preprocessing Layer Builder (Header)
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <string>
+#include <cstdint>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "gfxcontextlink.h"
+#include "gpulayerbuilder.h"
+#include "../base/layerflags.h"
+
+//------------------------------------- Public Declarations ----------------------------------------
+
+namespace fyusion::fyusenet::gpu {
+
+/**
+ * @brief Templatized anchor for image preprocessing layer builders on the GPU
+ *
+ * @see ImgPreprocLayerBuilder
+ */
+template<typename D = GPULayerBuilderTempl<>>
+struct ImgPreprocLayerBuilderTempl : GPULayerBuilderTempl<D> {
+
+    /**
+     * @brief Pixel formats of the source images
+     */
+    enum pixformat : uint8_t {
+        RGB = 0,            //!< 8-bit RGB data, stored in a single 3-channel texture
+        RGBA,               //!< 8-bit RGBA data, stored in a single 4-channel texture
+        NV12                //!< YUV 4:2:0 data, stored as luminance texture and half-resolution chrominance texture
+    };
+
+    /**
+     * @brief Constructor
+     *
+     * @param name Name to be assigned to the built layer
+     */
+    ImgPreprocLayerBuilderTempl(const std::string& name) : GPULayerBuilderTempl<D>(name) {
+        LayerBuilderTempl<D>::type_ = LayerType::IMGPREPROC;
+        for (int i=0; i < 3; i++) {
+            mean_[i] = 0.0f;
+            std_[i] = 1.0f;
+        }
+    }
+
+    /**
+     * @brief Set dimensions and format of the source image
+     *
+     * @param width Width of the source image (in pixels)
+     * @param height Height of the source image (in pixels)
+     * @param format Pixel format of the source image
+     *
+     * @return Reference to builder object
+     *
+     * The source image may have a different size than the output of the layer, which is set by
+     * the regular shape() function. If no source size is set, the source is assumed to have the
+     * same size as the output.
+     */
+    D & source(int width, int height, pixformat format = RGB) {
+        srcWidth_ = width;
+        srcHeight_ = height;
+        srcFormat_ = format;
+        return *(D *)this;
+    }
+
+    /**
+     * @brief Perform a center crop after resizing the image
+     *
+     * @param shortSide Size (in pixels) that the shorter side of the source image is resized to
+     *                  before cropping the center region, which has the output size of the layer
+     *
+     * @return Reference to builder object
+     *
+     * This implements the common "resize and center crop" preprocessing for classification
+     * networks (e.g. resize to 256 and crop 224x224). By default, no cropping is done and the
+     * source image is resized to the output size without maintaining the aspect ratio.
+     */
+    D & centerCrop(int shortSide) {
+        cropResize_ = shortSide;
+        return *(D *)this;
+    }
+
+    /**
+     * @brief Swap red and blue channels on the output
+     *
+     * @param swap If \c true, the layer outputs BGR data instead of RGB data
+     *
+     * @return Reference to builder object
+     */
+    D & swapRB(bool swap = true) {
+        swapRB_ = swap;
+        return *(D *)this;
+    }
+
+    /**
+     * @brief Set per-channel normalization for the output
+     *
+     * @param mean Pointer to 3 mean values (in RGB order)
+     * @param std Pointer to 3 standard deviation values (in RGB order)
+     *
+     * @return Reference to builder object
+     *
+     * The output of the layer is computed as <tt>(v - mean) / std</tt>, where \c v is the color
+     * value in the range [0,1]. Normalization parameters are given in RGB order, regardless of
+     * the channel swapping. By default, no normalization is done.
+     */
+    D & normalize(const float *mean, const float *std) {
+        for (int i=0; i < 3; i++) {
+            mean_[i] = mean[i];
+            std_[i] = std[i];
+        }
+        return *(D *)this;
+    }
+
+    int srcWidth_ = 0;                  //!< Width of source image (0 for same as output)
+    int srcHeight_ = 0;                 //!< Height of source image (0 for same as output)
+    pixformat srcFormat_ = RGB;         //!< Pixel format of source image
+    int cropResize_ = 0;                //!< Size of shorter side before center-cropping (0 for no cropping)
+    bool swapRB_ = false;               //!< Indicator whether to swap red and blue channels
+    float mean_[3];                     //!< Per-channel mean for normalization
+    float std_[3];                      //!< Per-channel standard deviation for normalization
+};
+
+
+/**
+ * @brief Builder class for image preprocessing layers on the GPU
+ *
+ * This class is to be used to build layers that convert 8-bit (or NV12) images into normalized
+ * floating-point tensors, including resizing, cropping and channel swapping.
+ *
+ * @see ImgPreprocLayer
+ */
+struct ImgPreprocLayerBuilder : ImgPreprocLayerBuilderTempl<ImgPreprocLayerBuilder> {
+    /**
+     * @brief Constructor
+     *
+     * @param name Name to be assigned to the built layer
+     */
+    ImgPreprocLayerBuilder(const std::string & name) : ImgPreprocLayerBuilderTempl<ImgPreprocLayerBuilder>(name) {}
+};
+
+} // fyusion::fyusenet::gpu namespace
+
+// vim: set expandtab ts=4 sw=4:
@@ -75,9 +75,9 @@ void OESConverter::beforeRender() {
  * @copydoc FunctionLayer::renderChannelBatch
  */
 void OESConverter::renderChannelBatch(int outPass, int numRenderTargets, int texOffset) {
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_EXTERNAL_OES, inputTextures_.at(texOffset));
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *)0);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_EXTERNAL_OES, inputTextures_.at(texOffset));
+    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *)0);
 }
 
 
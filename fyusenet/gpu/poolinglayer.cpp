@@ -133,12 +133,12 @@ void PoolingLayer::forward(uint64_t sequenceNo, StateToken * state) {
     if (err != GL_NO_ERROR) FNLOGD("HINT: glerror on render entry: 0x%x (%s:%d)[%s]", err, __FILE__, __LINE__, getName().c_str());
 #endif
     if (outputChanged_) updateFBOs();
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_BLEND);
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    glViewport(0, 0, viewport_[0], viewport_[1]);
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_STENCIL_TEST);
+    opengl::GLStateCache::disable(GL_CULL_FACE);
+    opengl::GLStateCache::disable(GL_BLEND);
+    opengl::GLStateCache::clearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    opengl::GLStateCache::viewport(0, 0, viewport_[0], viewport_[1]);
     int totaltex = (inputChannels_ / PIXEL_PACKING) + (((inputChannels_ % PIXEL_PACKING) > 0) ? 1 : 0);
     int outputpasses = (totaltex / maxRenderTargets_) + (((totaltex % maxRenderTargets_) > 0) ? 1 : 0);
     int texoffset = 0;
@@ -155,12 +155,12 @@ void PoolingLayer::forward(uint64_t sequenceNo, StateToken * state) {
         framebuffers_.at(opass)->bind();
         framebuffers_.at(opass)->setWriteMask();
         if (totaltex >= maxRenderTargets_) {
-            glClear(GL_COLOR_BUFFER_BIT);
+            opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
             renderChannelBatch(opass, maxRenderTargets_, texoffset);
             texoffset += maxRenderTargets_;
             totaltex -= maxRenderTargets_;
         } else if (totaltex > 0) {
-            glClear(GL_COLOR_BUFFER_BIT);
+            opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
             renderChannelBatch(opass, totaltex, texoffset);
             texoffset += totaltex;
             totaltex = 0;
@@ -16,6 +16,7 @@
 
 #include "../../gl/gl_sys.h"
 #include "../../gl/glinfo.h"
+#include "../../gl/glstatecache.h"
 #include "linear_texture_loader.h"
 #include "../../common/miscdefs.h"
 
@@ -185,7 +186,7 @@ void LinearTextureLoader::load4BitQuantizationTables(const T * scales, const uin
  * @param texture GL texture ID to bind and parameterize
  */
 void LinearTextureLoader::bindTexture(GLuint texture) {
-    glBindTexture(GL_TEXTURE_2D, texture);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, texture);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
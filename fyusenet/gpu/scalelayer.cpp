@@ -109,7 +109,7 @@ void ScaleLayer::setRotation(int degrees) {
 void ScaleLayer::beforeRender() {
     currentShader_ = nullptr;
     for (int i=0; i < (int)inputTextures_.size(); i++) {
-        glBindTexture(GL_TEXTURE_2D,inputTextures_.at(i));
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputTextures_.at(i));
         if (type_ == ScalingType::LINEAR) {
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -130,7 +130,7 @@ void ScaleLayer::afterRender() {
     if (currentShader_) currentShader_->unbind();
     currentShader_ = nullptr;
     for (int i = 0; i < (int)inputTextures_.size(); i++) {
-        glBindTexture(GL_TEXTURE_2D, inputTextures_.at(i));
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(i));
         if (type_ == ScalingType::LINEAR) {
             // reset interpolation to nearest -> default
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -145,8 +145,8 @@ void ScaleLayer::afterRender() {
  */
 void ScaleLayer::renderChannelBatch(int outPass, int numRenderTargets, int texOffset) {
     for (int tex = 0; tex < numRenderTargets; tex++) {
-        glActiveTexture(GL_TEXTURE0 + tex);
-        glBindTexture(GL_TEXTURE_2D, inputTextures_.at(tex + texOffset));
+        opengl::GLStateCache::activeTexture(GL_TEXTURE0 + tex);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(tex + texOffset));
     }
     if (currentShader_ != shaders_[numRenderTargets - 1].get()) {
         if (currentShader_) currentShader_->unbind(true);
@@ -154,7 +154,7 @@ void ScaleLayer::renderChannelBatch(int outPass, int numRenderTargets, int texOf
         currentShader_->bind(shaderStates_[numRenderTargets - 1].get());
         currentShader_->setMappedUniformMat4(TEXTRANS, textureMatrix_);
     }
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *) 0);
+    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *) 0);
 }
 
 
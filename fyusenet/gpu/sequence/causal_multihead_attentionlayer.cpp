@@ -10,6 +10,8 @@
 //--------------------------------------- System Headers -------------------------------------------
 
 #include <cassert>
+#include <cstring>
+#include <vector>
 
 //-------------------------------------- Project  Headers ------------------------------------------
 
@@ -17,6 +19,7 @@
 #include "../../gl/vertexshader.h"
 #include "../../gl/fragmentshader.h"
 #include "../../gl/scoped_texturepool.h"
+#include "../../gl/glinfo.h"
 #include "../floatconversion.h"
 #include "../../common/miscdefs.h"
 #include "../rudiments/proxygenerator.h"
@@ -28,6 +31,29 @@ namespace fyusion::fyusenet::gpu::sequence {
 
 //-------------------------------------- Local Definitions -----------------------------------------
 
+/**
+ * @brief Concatenate row-major matrices column-wise
+ *
+ * @param parts Pointers to the matrices to concatenate, all of the same shape
+ * @param numParts Number of matrices in \p parts
+ * @param rows Number of rows in each matrix
+ * @param columns Number of columns in each matrix
+ *
+ * @return Concatenated matrix with \p rows rows and \p numParts times the number of \p columns
+ */
+template<typename T>
+static std::vector<T> concatColumns(const T * const * parts, int numParts, int rows, int columns) {
+    std::vector<T> result((size_t)rows * columns * numParts);
+    T * out = result.data();
+    for (int row=0; row < rows; row++) {
+        for (int part=0; part < numParts; part++) {
+            memcpy(out, parts[part] + (size_t)row * columns, columns * sizeof(T));
+            out += columns;
+        }
+    }
+    return result;
+}
+
 
 /*##################################################################################################
 #                                   P U B L I C  F U N C T I O N S                                 #
@@ -44,6 +70,7 @@ CausalMultiHeadAttentionLayer::CausalMultiHeadAttentionLayer(const AttentionLaye
     assert((builder.headDim_ % PIXEL_PACKING) == 0);
     assert(builder.numHeads_ > 0);
     assert((builder.numHeads_ % PIXEL_PACKING) == 0);
+    assert(builder.numKVHeads_ >= 0);
     assert(builder.in() > 0);
     assert(builder.out() > 0);
     assert(builder.maxSequenceLen_ > 0);
@@ -56,6 +83,8 @@ CausalMultiHeadAttentionLayer::CausalMultiHeadAttentionLayer(const AttentionLaye
     height_ = builder.maxSequenceLen_;
     headDim_ = builder.headDim_;
     numHeads_ = builder.numHeads_;
+    numKVHeads_ = (builder.numKVHeads_ > 0) ? builder.numKVHeads_ : builder.numHeads_;
+    if ((numHeads_ % numKVHeads_) != 0) THROW_EXCEPTION_ARGS(FynException, "Number of heads (%d) must be a multiple of the number of KV heads (%d)", numHeads_, numKVHeads_);
     headDim_ = builder.headDim_;
     embedDim_ = builder.in();
     quantType_ = builder.quantType_;
@@ -65,6 +94,7 @@ CausalMultiHeadAttentionLayer::CausalMultiHeadAttentionLayer(const AttentionLaye
     incremental_ = builder.incremental_;
     maxSequenceLength_ = builder.maxSequenceLen_;
     autoResidual_ = builder.autoResidual_;
+    kvCacheType_ = builder.kvCacheType_;
     viewport_[0] = width_;
     viewport_[1] = height_;
     // ------------------------------------------------
@@ -72,15 +102,46 @@ CausalMultiHeadAttentionLayer::CausalMultiHeadAttentionLayer(const AttentionLaye
     // ------------------------------------------------
     bool inres = (builder.getFlags() & LayerFlags::RESIDUAL_INPUT);
     rotaryEncoder_ = new rudiments::RotaryEncoder(width_, headDim_, builder.thetaBase_, builder.context_);
-    softMaxBatched_ = new rudiments::MaskedSoftMaxBatched(height_, MAX_DP_BATCH, builder.context_);
+    if (numKVHeads_ != numHeads_) {
+        rotaryKeyEncoder_ = new rudiments::RotaryEncoder((numKVHeads_ * headDim_) / PIXEL_PACKING, headDim_, builder.thetaBase_, builder.context_);
+    }
     softMaxSingle_ = new rudiments::MaskedSoftMaxSingle(numHeads_, headDim_, builder.context_);
-    attMulBatched_ = new rudiments::AttentionMulBatched(numHeads_, headDim_, builder.maxSequenceLen_, builder.context_);
-    attMulSingle_ = new rudiments::AttentionMulSingle(width_, numHeads_, headDim_, builder.context_);
-    dotProdBatched_ = new rudiments::DotProductBatched(numHeads_, headDim_, MAX_DP_BATCH, builder.context_);
-    dotProdSingle_ = new rudiments::DotProductSingle(width_, numHeads_, headDim_, builder.context_);
-    queryMul_ = new rudiments::MatMulConst(PreambleGenerator(), embedDim_, numHeads_ * headDim_, maxSequenceLength_, dataType_, quantGroupSize_, false, false, false, builder.context_);
-    keyMul_ = new rudiments::MatMulConst(PreambleGenerator(), embedDim_, numHeads_ * headDim_, maxSequenceLength_, dataType_, quantGroupSize_, false, false, false, builder.context_);
-    valueMul_ = new rudiments::MatMulConst(PreambleGenerator(), embedDim_, numHeads_ * headDim_, maxSequenceLength_, dataType_, quantGroupSize_, false, false, false, builder.context_);
+    attMulSingle_ = new rudiments::AttentionMulSingle(width_, numHeads_, numKVHeads_, headDim_, builder.context_);
+    dotProdSingle_ = new rudiments::DotProductSingle(width_, numHeads_, numKVHeads_, headDim_, builder.context_);
+    if (builder.keyBlockSize_ > 0) {
+        tiledAttention_ = new rudiments::TiledAttention(numHeads_, numKVHeads_, headDim_, builder.keyBlockSize_, height_, builder.context_);
+    } else {
+        softMaxBatched_ = new rudiments::MaskedSoftMaxBatched(height_, MAX_DP_BATCH, builder.context_);
+        attMulBatched_ = new rudiments::AttentionMulBatched(numHeads_, numKVHeads_, headDim_, builder.maxSequenceLen_, builder.context_);
+        dotProdBatched_ = new rudiments::DotProductBatched(numHeads_, numKVHeads_, headDim_, MAX_DP_BATCH, builder.context_);
+    }
+    if (kvCacheType_ == KVCacheType::INT8) {
+        kvQuantizer_ = new rudiments::KVQuantizer(numKVHeads_, headDim_, builder.context_);
+        attMulSingle_->quantizedCache();
+        dotProdSingle_->quantizedCache();
+        if (tiledAttention_) tiledAttention_->quantizedCache();
+        if (attMulBatched_) attMulBatched_->quantizedCache();
+        if (dotProdBatched_) dotProdBatched_->quantizedCache();
+    }
+    // ------------------------------------------------
+    // Fuse the Q/K/V projections into a single multi-
+    // output multiplication if the concatenated weight
+    // matrix fits into a texture (the split into equally
+    // sized outputs requires the same number of heads
+    // for all of Q, K and V and multi-output products
+    // do not support biases)...
+    // ------------------------------------------------
+    bool fuse = (posEnc_ == PosEncType::ROTARY) && (dataType_ != param_type::WGT_FLOAT) && (numKVHeads_ == numHeads_) && (!hasBias_) &&
+                (3 * numHeads_ * headDim_ <= opengl::GLInfo::getMaximumTextureSize()) &&
+                (opengl::GLInfo::getMaximumDrawBuffers() >= 3);
+    if (fuse) {
+        qkvMul_ = new rudiments::MatMulConst(PreambleGenerator(), embedDim_, 3 * numHeads_ * headDim_, maxSequenceLength_, dataType_, quantGroupSize_, false, false, false, builder.context_);
+        qkvMul_->multiOutput(3);
+    } else {
+        queryMul_ = new rudiments::MatMulConst(PreambleGenerator(), embedDim_, numHeads_ * headDim_, maxSequenceLength_, dataType_, quantGroupSize_, false, false, false, builder.context_);
+        keyMul_ = new rudiments::MatMulConst(PreambleGenerator(), embedDim_, numKVHeads_ * headDim_, maxSequenceLength_, dataType_, quantGroupSize_, false, false, false, builder.context_);
+        valueMul_ = new rudiments::MatMulConst(PreambleGenerator(), embedDim_, numKVHeads_ * headDim_, maxSequenceLength_, dataType_, quantGroupSize_, false, false, false, builder.context_);
+    }
     outMul_ = new rudiments::MatMulConst(PreambleGenerator(), numHeads_ * headDim_, embedDim_, maxSequenceLength_, dataType_, quantGroupSize_, false, inres, builder.autoResidual_, builder.context_);
 }
 
@@ -93,15 +154,19 @@ void CausalMultiHeadAttentionLayer::cleanup() {
     // Clear rudiments...
     // ------------------------------------------------
     FNET_DEL_AND_CLEAR(rotaryEncoder_);
+    FNET_DEL_AND_CLEAR(rotaryKeyEncoder_);
     FNET_DEL_AND_CLEAR(softMaxBatched_);
     FNET_DEL_AND_CLEAR(softMaxSingle_);
     FNET_DEL_AND_CLEAR(attMulBatched_);
     FNET_DEL_AND_CLEAR(attMulSingle_);
     FNET_DEL_AND_CLEAR(dotProdBatched_);
     FNET_DEL_AND_CLEAR(dotProdSingle_);
+    FNET_DEL_AND_CLEAR(tiledAttention_);
+    FNET_DEL_AND_CLEAR(kvQuantizer_);
     FNET_DEL_AND_CLEAR(queryMul_);
     FNET_DEL_AND_CLEAR(keyMul_);
     FNET_DEL_AND_CLEAR(valueMul_);
+    FNET_DEL_AND_CLEAR(qkvMul_);
     FNET_DEL_AND_CLEAR(outMul_);
     // ------------------------------------------------
     // Clear FBOs...
@@ -111,6 +176,10 @@ void CausalMultiHeadAttentionLayer::cleanup() {
     FNET_DEL_AND_CLEAR(peKeyFBO_);
     FNET_DEL_AND_CLEAR(dotProdFBO_);
     FNET_DEL_AND_CLEAR(smPass2BatchFBO_);
+    FNET_DEL_AND_CLEAR(keyCacheFBO_);
+    FNET_DEL_AND_CLEAR(valueCacheFBO_);
+    FNET_DEL_AND_CLEAR(keyScaleFBO_);
+    FNET_DEL_AND_CLEAR(valueScaleFBO_);
     for (auto *fbo: qkvFBOs_) delete fbo;
     qkvFBOs_.clear();
     GPULayerBase::cleanup();
@@ -123,13 +192,19 @@ void CausalMultiHeadAttentionLayer::cleanup() {
  */
 void CausalMultiHeadAttentionLayer::setup() {
     if (rotaryEncoder_) rotaryEncoder_->setup();
-    attMulBatched_->setup();
+    if (rotaryKeyEncoder_) rotaryKeyEncoder_->setup();
+    if (attMulBatched_) attMulBatched_->setup();
     attMulSingle_->setup();
-    dotProdBatched_->setup();
+    if (dotProdBatched_) dotProdBatched_->setup();
     dotProdSingle_->setup();
-    queryMul_->setup();
-    keyMul_->setup();
-    valueMul_->setup();
+    if (kvQuantizer_) kvQuantizer_->setup();
+    if (qkvMul_) {
+        qkvMul_->setup();
+    } else {
+        queryMul_->setup();
+        keyMul_->setup();
+        valueMul_->setup();
+    }
     outMul_->setup();
     // NOTE (mw) some auxiliary functions are set up in setupFBOs()
     setupFBOs();
@@ -153,9 +228,9 @@ void CausalMultiHeadAttentionLayer::forward(uint64_t sequenceNo, StateToken * st
     queryLength_ = (int)state->seqLength;
     tokenIndex_ = state->seqIndex;
     prepareRender();
-    glEnable(GL_SCISSOR_TEST);
+    opengl::GLStateCache::enable(GL_SCISSOR_TEST);
     compute();
-    glDisable(GL_SCISSOR_TEST);
+    opengl::GLStateCache::disable(GL_SCISSOR_TEST);
 }
 
 
@@ -255,7 +330,9 @@ std::vector<BufferSpec> CausalMultiHeadAttentionLayer::getRequiredInputBuffers()
  *   - \c layername.out.scales (\c subIndex = 14) for the output matrix quantization scales
  *   - \c layername.out.zeros (\c subIndex = 15) for the quantized output matrix quantization zero-biases
  *
- * Where \c layername is the name that was assigned to this layer by the builder.
+ * Where \c layername is the name that was assigned to this layer by the builder. In case the
+ * query, key and value projections are fused, their parameters are concatenated after loading,
+ * see loadFusedQKV().
  *
  * @warning See storage order assumption in the long description
  */
@@ -263,7 +340,12 @@ void CausalMultiHeadAttentionLayer::loadParameters(const ParameterProvider * wei
     std::lock_guard<std::recursive_mutex> lck(processingLock_);
     std::string suffix[4] = {".query", ".key", ".value", ".out"};
     rudiments::MatMulConst * mul[4] = {queryMul_, keyMul_, valueMul_, outMul_};
-    for (int sub = QUERY; sub <= OUTPUT; sub++) {
+    int first = QUERY;
+    if (qkvMul_) {
+        loadFusedQKV(weights);
+        first = OUTPUT;
+    }
+    for (int sub = first; sub <= OUTPUT; sub++) {
         int sidx = sub * 4;
         DataBlob wgtblob = weights->get(getName()+suffix[sub]+std::string(".weights"), getNumber(), sidx);
         mul[sub]->loadWeights(wgtblob);
@@ -372,40 +454,75 @@ void CausalMultiHeadAttentionLayer::updateFBOs() {
 void CausalMultiHeadAttentionLayer::setupFBOs() {
     int fullqkvwidth = embedDim_ / PIXEL_PACKING;
     int fullqkvheight = height_;
+    int kvwidth = (numKVHeads_ * headDim_) / PIXEL_PACKING;
+    // with an 8-bit cache, the floating-point keys/values are only staged for quantization
+    Texture::pixtype kvtype = (kvCacheType_ == KVCacheType::FLOAT16) ? Texture::FLOAT16 : TEXTURE_PIXTYPE;
     uint32_t scope1 = (context().texturePool()) ? context().texturePool()->scopeID() : 0;
     uint32_t scope2 = (context().texturePool()) ? context().texturePool()->scopeID() : 0;
     // ----------------------------------------------------------------
     // Textures and FBOs for Q, K and V computation. In case we have no
     // positional encoding step, we skip the textures and FBOs for
-    // query and key and write them directly into the PE-stage buffers
+    // query and key and write them directly into the PE-stage buffers.
+    // Keys and values only have numKVHeads_ heads, which is less than
+    // the number of query heads for grouped-query attention
     // ----------------------------------------------------------------
-    if (posEnc_ != PosEncType::NONE) {
-        keyTexture_ = Texture2D(fullqkvwidth, fullqkvheight, TEXTURE_PIXTYPE, 4, context().texturePool(), scope1, false);
+    if (qkvMul_) {
+        // fused computation writes Q and K in the same pass, make sure that they are not aliased
+        keyTexture_ = Texture2D(fullqkvwidth, fullqkvheight, TEXTURE_PIXTYPE, 4, context().texturePool(), scope1, true);
+        queryTexture_ = Texture2D(fullqkvwidth, fullqkvheight, TEXTURE_PIXTYPE, 4, context().texturePool(), scope2, false);
+    } else if (posEnc_ != PosEncType::NONE) {
+        keyTexture_ = Texture2D(kvwidth, fullqkvheight, TEXTURE_PIXTYPE, 4, context().texturePool(), scope1, false);
         queryTexture_ = Texture2D(fullqkvwidth, fullqkvheight, TEXTURE_PIXTYPE, 4, context().texturePool(), scope2, false);     // NOTE (mw) this might be mapped to the same as keyTexture
     }
-    valueTexture_ = Texture2D(fullqkvwidth, fullqkvheight, TEXTURE_PIXTYPE, 4, context().texturePool(), scope1, true);  // 32-bit
-    qkvFBOs_.push_back((posEnc_ == PosEncType::NONE) ? nullptr : new FBO(context(), queryTexture_));
-    qkvFBOs_.push_back((posEnc_ == PosEncType::NONE) ? nullptr : new FBO(context(), keyTexture_));
-    qkvFBOs_.push_back(new FBO(context(), valueTexture_));
+    valueTexture_ = Texture2D(kvwidth, fullqkvheight, kvtype, 4, context().texturePool(), scope1, true);  // 32-bit
+    if (qkvMul_) {
+        auto * fbo = new FBO(context(), queryTexture_);
+        fbo->addTexture(GL_COLOR_ATTACHMENT1, keyTexture_);
+        fbo->addTexture(GL_COLOR_ATTACHMENT2, valueTexture_);
+        fbo->setWriteMask();
+        fbo->unbind();
+        qkvFBOs_.push_back(fbo);
+    } else {
+        qkvFBOs_.push_back((posEnc_ == PosEncType::NONE) ? nullptr : new FBO(context(), queryTexture_));
+        qkvFBOs_.push_back((posEnc_ == PosEncType::NONE) ? nullptr : new FBO(context(), keyTexture_));
+        qkvFBOs_.push_back(new FBO(context(), valueTexture_));
+    }
     // ----------------------------------------------------------------
     // Two FBOs for positional encoding, where the key FBO/texture is
     // used as cache when incremental mode is switched on
     // ----------------------------------------------------------------
     peQueryTexture_ = Texture2D(fullqkvwidth, fullqkvheight, TEXTURE_PIXTYPE, 4, context().texturePool(), scope2,  false);  // NOTE (mw) this might be mapped to the same as keyTexture
     peQueryFBO_ = new FBO(context(), peQueryTexture_);
-    peKeyTexture_ = Texture2D(fullqkvwidth, fullqkvheight, TEXTURE_PIXTYPE, 4, context().texturePool(), scope1, true);
+    peKeyTexture_ = Texture2D(kvwidth, fullqkvheight, kvtype, 4, context().texturePool(), scope1, true);
     peKeyFBO_ = new FBO(context(), peKeyTexture_);
     // ----------------------------------------------------------------
+    // For an 8-bit key/value cache, the cache consists of the quantized
+    // data and a scale texture that stores the scales of 4 heads per
+    // pixel. Those replace the key/value textures above as cache
+    // ----------------------------------------------------------------
+    if (kvQuantizer_) {
+        int scalewidth = (numKVHeads_ + PIXEL_PACKING - 1) / PIXEL_PACKING;
+        keyCacheTexture_ = Texture2D(kvwidth, fullqkvheight, Texture::INT8_INTEGRAL, 4, context().texturePool(), scope1, true);
+        valueCacheTexture_ = Texture2D(kvwidth, fullqkvheight, Texture::INT8_INTEGRAL, 4, context().texturePool(), scope1, true);
+        keyScaleTexture_ = Texture2D(scalewidth, fullqkvheight, Texture::FLOAT32, 4, context().texturePool(), scope1, true);
+        valueScaleTexture_ = Texture2D(scalewidth, fullqkvheight, Texture::FLOAT32, 4, context().texturePool(), scope1, true);
+        keyCacheFBO_ = new FBO(context(), keyCacheTexture_);
+        valueCacheFBO_ = new FBO(context(), valueCacheTexture_);
+        keyScaleFBO_ = new FBO(context(), keyScaleTexture_);
+        valueScaleFBO_ = new FBO(context(), valueScaleTexture_);
+    }
+    // ----------------------------------------------------------------
     // FBO for dot product implementations. Batched version will use a
     // single FBO with texture size defined by the maximum number of
     // sequence tokens. Note that usually the query length is not really
     // exhaustive, so on standard runs we may be able to stuff in multiple
     // batches (depending on the query length) in this texture. We use
     // the same texture for the single token version, as the max height
-    // for that would be defined by the number of heads
+    // for that would be defined by the number of heads. With tiled
+    // attention, only the single token version uses this texture
     // ----------------------------------------------------------------
     int batcheddpwidth = height_;
-    int batcheddpheight = std::max(height_, numHeads_ / PIXEL_PACKING);
+    int batcheddpheight = (tiledAttention_) ? numHeads_ / PIXEL_PACKING : std::max(height_, numHeads_ / PIXEL_PACKING);
     dotProdTexture_ = Texture2D(batcheddpwidth, batcheddpheight, TEXTURE_PIXTYPE, 4, context().texturePool(), scope2, false);
     dotProdFBO_ = new FBO(context(), dotProdTexture_);
     // ----------------------------------------------------------------
@@ -429,15 +546,23 @@ void CausalMultiHeadAttentionLayer::setupFBOs() {
     // Setup some of the auxiliary functions here, some of them need the
     // scope ID
     // ----------------------------------------------------------------
-    softMaxBatched_->setup(scope2);
+    if (softMaxBatched_) softMaxBatched_->setup(scope2);
     softMaxSingle_->setup(scope2);
+    if (tiledAttention_) tiledAttention_->setup(scope2);
     // ----------------------------------------------------------------
     // If we are not caching, unlock the textures here again
     // ----------------------------------------------------------------
-    if (auto * pool = context().texturePool() ; (pool) && (!incremental_)) {
+    if (auto * pool = context().texturePool() ; (pool) && ((!incremental_) || (kvQuantizer_))) {
         pool->unlockTexture(peKeyTexture_);
         pool->unlockTexture(valueTexture_);
     }
+    if (auto * pool = context().texturePool() ; (pool) && (!incremental_) && (kvQuantizer_)) {
+        pool->unlockTexture(keyCacheTexture_);
+        pool->unlockTexture(valueCacheTexture_);
+        pool->unlockTexture(keyScaleTexture_);
+        pool->unlockTexture(valueScaleTexture_);
+    }
+    if (auto * pool = context().texturePool() ; (pool) && (qkvMul_)) pool->unlockTexture(keyTexture_);
 }
 
 
@@ -452,6 +577,15 @@ void CausalMultiHeadAttentionLayer::compute() {
     // Initial computation of query, key and value matrices...
     // --------------------------------------------------------
     computeQKV();
+    if (kvQuantizer_) quantizeKV();
+    GLuint keys = (kvQuantizer_) ? keyCacheTexture_.getHandle() : peKeyFBO_->getAttachment();
+    GLuint values = (kvQuantizer_) ? valueCacheTexture_.getHandle() : valueTexture_.getHandle();
+    if (kvQuantizer_) {
+        opengl::GLStateCache::activeTexture(GL_TEXTURE0 + KVQuantizer::KEY_SCALE_UNIT);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, keyScaleTexture_.getHandle());
+        opengl::GLStateCache::activeTexture(GL_TEXTURE0 + KVQuantizer::VALUE_SCALE_UNIT);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, valueScaleTexture_.getHandle());
+    }
     // --------------------------------------------------------
     // Dot-product (special case for single tokens and a batch
     // mode for multiple tokens)...
@@ -460,9 +594,14 @@ void CausalMultiHeadAttentionLayer::compute() {
         // ----------------------------------------------------
         // Single stuff
         // ----------------------------------------------------
-        dotProdSingle_->forward(peQueryFBO_->getAttachment(), peKeyFBO_->getAttachment(), keyLength_, dotProdFBO_);
+        dotProdSingle_->forward(peQueryFBO_->getAttachment(), keys, keyLength_, dotProdFBO_);
         softMaxSingle_->forward(dotProdFBO_->getAttachment(), tokenIndex_, keyLength_, smPass2BatchFBO_);
-        attMulSingle_->forward(qkvFBOs_.at(2)->getAttachment(), smPass2BatchFBO_->getAttachment(), tokenIndex_, keyLength_, attValFBO_);
+        attMulSingle_->forward(values, smPass2BatchFBO_->getAttachment(), tokenIndex_, keyLength_, attValFBO_);
+    } else if (tiledAttention_) {
+        // ----------------------------------------------------
+        // Tiled stuff (online softmax over key blocks)
+        // ----------------------------------------------------
+        tiledAttention_->forward(peQueryFBO_->getAttachment(), keys, values, tokenIndex_, queryLength_, keyLength_, attValFBO_);
     } else {
         // ----------------------------------------------------
         // Batched stuff
@@ -470,9 +609,9 @@ void CausalMultiHeadAttentionLayer::compute() {
         int head = 0;
         int batchsize = std::min(numHeads_ / PIXEL_PACKING, dpMaxHeadBatchSize_);
         do {
-            dotProdBatched_->forward(peQueryFBO_->getAttachment(), peKeyFBO_->getAttachment(), queryLength_, keyLength_, head, batchsize, dotProdFBO_);
+            dotProdBatched_->forward(peQueryFBO_->getAttachment(), keys, queryLength_, keyLength_, head, batchsize, dotProdFBO_);
             softMaxBatched_->forward(dotProdFBO_->getAttachment(), tokenIndex_, queryLength_, keyLength_, batchsize, smPass2BatchFBO_);
-            attMulBatched_->forward(qkvFBOs_[2]->getAttachment(), smPass2BatchFBO_->getAttachment(), queryLength_, tokenIndex_, head, batchsize, attValFBO_);
+            attMulBatched_->forward(values, smPass2BatchFBO_->getAttachment(), queryLength_, tokenIndex_, head, batchsize, attValFBO_);
             int newhead = head + batchsize * PIXEL_PACKING;
             if (newhead > numHeads_) batchsize -= (newhead - numHeads_) / PIXEL_PACKING;
             head = newhead;
@@ -483,11 +622,11 @@ void CausalMultiHeadAttentionLayer::compute() {
     // --------------------------------------------------------
     assert(outMul_);
     assert(!framebuffers_.empty());
-    glActiveTexture(GL_TEXTURE0 + mm::INPUT0_UNIT);
-    glBindTexture(GL_TEXTURE_2D, attValFBO_->getAttachment());
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0 + mm::INPUT0_UNIT);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, attValFBO_->getAttachment());
     if (flags_ & LayerFlags::RESIDUAL_INPUT) {
-        glActiveTexture(GL_TEXTURE0 + mm::RESIDUAL_UNIT);
-        glBindTexture(GL_TEXTURE_2D, residualTextures_.at(0));
+        opengl::GLStateCache::activeTexture(GL_TEXTURE0 + mm::RESIDUAL_UNIT);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, residualTextures_.at(0));
     }
     outMul_->forward(queryLength_, 0, framebuffers_.at(0));
 }
@@ -503,14 +642,21 @@ void CausalMultiHeadAttentionLayer::computeQKV() {
     // -> it might be a better idea to do the wraparound in the engine by splitting the
     //    query appropriately
     using mm = rudiments::MatMulConst;
+    if (qkvMul_) {
+        computeFusedQKV();
+        return;
+    }
     assert(queryMul_);
     assert(keyMul_);
     assert(valueMul_);
+    // keys and values for an 8-bit cache are staged from row 0 on and quantized afterwards
+    int keyrow = (kvQuantizer_) ? 0 : tokenIndex_;
+    int valuerow = ((incremental_) && (!kvQuantizer_)) ? tokenIndex_ : 0;
     // --------------------------------------------------------
     // Compute query items, note that those are never cached
     // --------------------------------------------------------
-    glActiveTexture(GL_TEXTURE0 + mm::INPUT0_UNIT);
-    glBindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0 + mm::INPUT0_UNIT);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
     queryMul_->forward(queryLength_, 0, (posEnc_ == PosEncType::NONE) ? peQueryFBO_ : qkvFBOs_.at(0));
     if (posEnc_ == PosEncType::ROTARY) {
         rotaryEncoder_->forward(qkvFBOs_.at(0)->getAttachment(), tokenIndex_, queryLength_, 0, peQueryFBO_);
@@ -519,28 +665,117 @@ void CausalMultiHeadAttentionLayer::computeQKV() {
     // Compute key items, these will be cached in an incremental
     // decoding scenario...
     // --------------------------------------------------------
-    glActiveTexture(GL_TEXTURE0 + mm::INPUT0_UNIT);
-    glBindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0 + mm::INPUT0_UNIT);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
     if (posEnc_ == PosEncType::NONE) {
-        keyMul_->forward(queryLength_, tokenIndex_, peKeyFBO_);
+        keyMul_->forward(queryLength_, keyrow, peKeyFBO_);
     } else {
         keyMul_->forward(queryLength_, 0, qkvFBOs_.at(1));
     }
     if (posEnc_ == PosEncType::ROTARY) {
-        rotaryEncoder_->forward(qkvFBOs_.at(1)->getAttachment(), tokenIndex_, queryLength_,
-                                tokenIndex_, peKeyFBO_);
+        RotaryEncoder * encoder = (rotaryKeyEncoder_) ? rotaryKeyEncoder_ : rotaryEncoder_;
+        encoder->forward(qkvFBOs_.at(1)->getAttachment(), tokenIndex_, queryLength_, keyrow, peKeyFBO_);
     }
     // --------------------------------------------------------
     // Compute value items, these will be cached in an incremental
     // decoding scenario...
     // --------------------------------------------------------
-    glActiveTexture(GL_TEXTURE0 + mm::INPUT0_UNIT);
-    glBindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
-    valueMul_->forward(queryLength_, (incremental_) ? tokenIndex_ : 0,  qkvFBOs_.at(2));
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0 + mm::INPUT0_UNIT);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
+    valueMul_->forward(queryLength_, valuerow, qkvFBOs_.at(2));
     keyLength_ = (incremental_) ? (tokenIndex_ + queryLength_) : queryLength_;
 }
 
 
+/**
+ * @brief Compute Q, K and V tensors using a single (fused) matrix multiplication
+ *
+ * All three tensors are written to the same row offset, which is dictated by the value tensor
+ * that is cached in incremental mode. The raw query and key tensors are then read from that row
+ * offset by the rotary encoder. For an 8-bit key/value cache, the tensors are written to row 0
+ * instead, as they are quantized into the cache afterwards.
+ */
+void CausalMultiHeadAttentionLayer::computeFusedQKV() {
+    using mm = rudiments::MatMulConst;
+    assert(qkvMul_);
+    assert(posEnc_ == PosEncType::ROTARY);
+    int row = ((incremental_) && (!kvQuantizer_)) ? tokenIndex_ : 0;
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0 + mm::INPUT0_UNIT);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
+    qkvMul_->forward(queryLength_, row, qkvFBOs_.at(0));
+    rotaryEncoder_->forward(queryTexture_.getHandle(), tokenIndex_, queryLength_, 0, peQueryFBO_, row);
+    rotaryEncoder_->forward(keyTexture_.getHandle(), tokenIndex_, queryLength_, (kvQuantizer_) ? 0 : tokenIndex_, peKeyFBO_, row);
+    keyLength_ = (incremental_) ? (tokenIndex_ + queryLength_) : queryLength_;
+}
+
+
+/**
+ * @brief Quantize the keys and values of the current tokens into the 8-bit key/value cache
+ *
+ * The (position-encoded) keys and values were computed into the first rows of #peKeyTexture_
+ * and #valueTexture_, they are written into the cache at the same rows that the floating-point
+ * cache would use.
+ *
+ * @see KVQuantizer
+ */
+void CausalMultiHeadAttentionLayer::quantizeKV() {
+    assert(kvQuantizer_);
+    kvQuantizer_->forward(peKeyTexture_.getHandle(), queryLength_, tokenIndex_, keyCacheFBO_, keyScaleFBO_);
+    kvQuantizer_->forward(valueTexture_.getHandle(), queryLength_, (incremental_) ? tokenIndex_ : 0, valueCacheFBO_, valueScaleFBO_);
+}
+
+
+/**
+ * @brief Load parameters for the fused query, key and value projection
+ *
+ * @param weights Parameter data provider
+ *
+ * Reads the query, key and value parameters using the same names and sub-indices as
+ * loadParameters() and concatenates them column-wise, such that the fused multiplication writes
+ * the query projection to the first, the key projection to the second and the value projection
+ * to the third render target. Layers with biases are never fused.
+ */
+void CausalMultiHeadAttentionLayer::loadFusedQKV(const ParameterProvider * weights) {
+    assert(qkvMul_);
+    assert(!hasBias_);
+    const std::string suffix[3] = {".query", ".key", ".value"};
+    int columns = numHeads_ * headDim_;
+    int groups = embedDim_ / quantGroupSize_;
+    DataBlob wgtblobs[3], scaleblobs[3], zeroblobs[3];
+    const uint32_t * wgts[3], * zeros[3];
+    for (int sub = QUERY; sub <= VALUE; sub++) {
+        int sidx = sub * 4;
+        wgtblobs[sub] = weights->get(getName()+suffix[sub]+std::string(".weights"), getNumber(), sidx);
+        scaleblobs[sub] = weights->get(getName()+suffix[sub]+std::string(".scales"), getNumber(), sidx+2);
+        zeroblobs[sub] = weights->get(getName()+suffix[sub]+std::string(".zeros"), getNumber(), sidx+3);
+        if (wgtblobs[sub].empty() || scaleblobs[sub].empty() || zeroblobs[sub].empty()) {
+            THROW_EXCEPTION_ARGS(FynException, "Missing parameters for %s%s", getName().c_str(), suffix[sub].c_str());
+        }
+        wgts[sub] = reinterpret_cast<const uint32_t *>(std::any_cast<const uint8_t *>(wgtblobs[sub].get()));
+        zeros[sub] = reinterpret_cast<const uint32_t *>(std::any_cast<const uint8_t *>(zeroblobs[sub].get()));
+    }
+    // 4-bit weights are packed with 8 consecutive rows per 32-bit word, zeros with 8 columns per word
+    auto wgtcat = concatColumns<uint32_t>(wgts, 3, embedDim_ / 8, columns);
+    auto zerocat = concatColumns<uint32_t>(zeros, 3, groups, columns / 8);
+    DefaultDataWrapper<uint8_t> wgtwrap(reinterpret_cast<const uint8_t *>(wgtcat.data()));
+    DefaultDataWrapper<uint8_t> zerowrap(reinterpret_cast<const uint8_t *>(zerocat.data()));
+    qkvMul_->loadWeights(DataBlob(&wgtwrap));
+    if (scaleblobs[0].get().type() == typeid(const float *)) {
+        const float * scales[3];
+        for (int i=0; i < 3; i++) scales[i] = std::any_cast<const float *>(scaleblobs[i].get());
+        auto scalecat = concatColumns<float>(scales, 3, groups, columns);
+        DefaultDataWrapper<float> scalewrap(scalecat.data());
+        qkvMul_->loadQuantizationTables(DataBlob(&scalewrap), DataBlob(&zerowrap));
+    } else {
+        const uint16_t * scales[3];
+        for (int i=0; i < 3; i++) scales[i] = std::any_cast<const uint16_t *>(scaleblobs[i].get());
+        auto scalecat = concatColumns<uint16_t>(scales, 3, groups, columns);
+        DefaultDataWrapper<uint16_t> scalewrap(scalecat.data());
+        qkvMul_->loadQuantizationTables(DataBlob(&scalewrap), DataBlob(&zerowrap));
+    }
+}
+
+
 } // fyusion::fyusenet::gpu::sequence namespace
 
 // vim: set expandtab ts=4 sw=4:
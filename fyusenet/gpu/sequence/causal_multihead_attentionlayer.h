@@ -35,6 +35,8 @@
 #include "../sequence/rudiments/dotprod_batched.h"
 #include "../sequence/rudiments/dotprod_single.h"
 #include "../sequence/rudiments/matmul_const.h"
+#include "../sequence/rudiments/tiled_attention.h"
+#include "../sequence/rudiments/kv_quantizer.h"
 
 class AttentionTest;
 
@@ -106,6 +108,30 @@ namespace fyusion::fyusenet::gpu::sequence {
  * \f$ \mathbf{Q}, \mathbf{K}, \mathbf{V} \f$ which is applied to the query tensor \f$ \mathbf{Q} \f$
  * and the key tensor \f$ \mathbf{K} \f$ only prior to the dot-product computation.
  *
+ * When rotary encoding is used and the GL implementation supports it, the query, key and value
+ * projections are fused into a single matrix multiplication. For this, the three weight matrices
+ * are concatenated column-wise when loading the parameters and the multiplication writes the
+ * three result tensors into separate render targets (see MatMulConst::multiOutput()). The rotary
+ * encoding itself cannot be folded into that multiplication, as the rotation pairs elements that
+ * reside in different pixels and the multiplication accumulates its results over multiple passes.
+ *
+ * For grouped-query and multi-query attention, the key and value tensors consist of fewer heads
+ * than the query tensor, where each key/value head is shared by a group of consecutive query
+ * heads. The key/value cache as well as the corresponding projections shrink accordingly, the
+ * mapping of query heads onto the shared key/value heads is done when fetching the keys and values
+ * in the attention computation.
+ *
+ * For queries with more than one token, the attention itself is computed by streaming over blocks
+ * of keys with an online softmax (see rudiments::TiledAttention), such that the full matrix of
+ * attention scores is never stored. This can be switched back to the head-batched computation
+ * via AttentionLayerBuilder::keyBlockSize().
+ *
+ * The key/value cache may be stored at a reduced precision (see AttentionLayerBuilder::kvCache()).
+ * For 8-bit storage, the keys and values of the current tokens are computed into transient
+ * floating-point textures and then quantized into the cache with one scale per token and head
+ * (see rudiments::KVQuantizer). The dot-product and attention-multiplication rudiments read the
+ * integer data and apply the scales on the fly.
+ *
  * @warning This layer only supports 4-bit quantized weights as of now. It is also largely untested
  *          \e without the positional encoding step.
  */
@@ -119,6 +145,8 @@ class CausalMultiHeadAttentionLayer : public gpu::GPULayerBase {
     using DotProductBatched = rudiments::DotProductBatched;
     using DotProductSingle = rudiments::DotProductSingle;
     using MatMulConst = rudiments::MatMulConst;
+    using TiledAttention = rudiments::TiledAttention;
+    using KVQuantizer = rudiments::KVQuantizer;
 
  public:
 
@@ -159,6 +187,9 @@ class CausalMultiHeadAttentionLayer : public gpu::GPULayerBase {
     void updateFBOs() override;
     void compute();
     void computeQKV();
+    void computeFusedQKV();
+    void quantizeKV();
+    void loadFusedQKV(const ParameterProvider * weights);
 
     // ------------------------------------------------------------------------
     // Member variables
@@ -171,14 +202,23 @@ class CausalMultiHeadAttentionLayer : public gpu::GPULayerBase {
     Texture2D attValTexture_;                           //!< Texture that holds the result of the attention-weighted projection of the values
     Texture2D peQueryTexture_;                          //!< Non-caching texture for the positions-encoded queries
     Texture2D peKeyTexture_;                            //!< (Possibly) caching texture for the position-encoded keys
+    Texture2D keyCacheTexture_;                         //!< Caching texture for the 8-bit quantized (position-encoded) keys
+    Texture2D valueCacheTexture_;                       //!< Caching texture for the 8-bit quantized values
+    Texture2D keyScaleTexture_;                         //!< Quantization scales for #keyCacheTexture_ (one per token and head)
+    Texture2D valueScaleTexture_;                       //!< Quantization scales for #valueCacheTexture_ (one per token and head)
     FBO * peQueryFBO_ = nullptr;                        //!< FBO that wraps the positional encoding of the query
     FBO * peKeyFBO_ = nullptr;                          //!< FBO that wraps the positional encoding of the key (cached for autoregressive / incremental use), see #keyTexture_
     FBO * dotProdFBO_ = nullptr;                        //!< FBO that wraps the result of the dot-product computation (see #dotProdTexture_)
     FBO * smPass2BatchFBO_ = nullptr;                   //!< FBO that wraps the batched softmax computation results (see #smPass2BatchTexture_)
     FBO * attValFBO_ = nullptr;                         //!< FBO that wraps the attention-weighted projection of the values (see #attValTexture_)
-    std::vector<FBO *> qkvFBOs_;                        //!< FBOs that hold the Q, K and V tensors
+    FBO * keyCacheFBO_ = nullptr;                       //!< FBO that wraps the quantized key cache (see #keyCacheTexture_)
+    FBO * valueCacheFBO_ = nullptr;                     //!< FBO that wraps the quantized value cache (see #valueCacheTexture_)
+    FBO * keyScaleFBO_ = nullptr;                       //!< FBO that wraps the scales of the quantized key cache (see #keyScaleTexture_)
+    FBO * valueScaleFBO_ = nullptr;                     //!< FBO that wraps the scales of the quantized value cache (see #valueScaleTexture_)
+    std::vector<FBO *> qkvFBOs_;                        //!< FBOs that hold the Q, K and V tensors (single FBO with 3 attachments for fused computation)
     int dpMaxHeadBatchSize_ = MAX_DP_BATCH;             //!< Maximum batch size for the dot-product computation
     int numHeads_ = 0;                                  //!< Total number of attention heads
+    int numKVHeads_ = 0;                                //!< Number of key/value heads (smaller than #numHeads_ for grouped-query attention)
     int headDim_ = 0;                                   //!< Dimension of a single attention head
     uint16_t embedDim_ = 0;                             //!< Dimension of the embedding space
     uint16_t maxSequenceLength_ = 0;                    //!< Maximum sequence length supported by the model
@@ -189,18 +229,23 @@ class CausalMultiHeadAttentionLayer : public gpu::GPULayerBase {
     bool incremental_ = false;                          //!< Whether the layer is operating in incremental mode
     bool autoResidual_ = false;                         //!< Whether the layer operates in a mode where it adds its output to the input automatically
     PosEncType posEnc_ = PosEncType::NONE;              //!< Type of positional encoding used by the layer
+    KVCacheType kvCacheType_ = KVCacheType::DEFAULT;    //!< Storage type of the key/value cache
     MatMulConst * queryMul_ = nullptr;                  //!< Pointer to query multiplication instance
     MatMulConst * keyMul_ = nullptr;                    //!< Pointer to key computation instance
     MatMulConst * valueMul_ = nullptr;                  //!< Pointer to value computation instance
+    MatMulConst * qkvMul_ = nullptr;                    //!< Pointer to fused query/key/value computation instance (replaces the individual instances if set)
     MatMulConst * outMul_ = nullptr;                    //!< Pointer to final output projection instance
     bool hasBias_ = false;                              //!< Indicator whether any projection used inside the layer has a bias / is affine  (TODO support this)
     RotaryEncoder * rotaryEncoder_ = nullptr;           //!< Pointer to rotary encoder instance
+    RotaryEncoder * rotaryKeyEncoder_ = nullptr;        //!< Pointer to rotary encoder instance for the keys (only set if there are fewer key/value heads than query heads)
     MaskedSoftMaxBatched * softMaxBatched_ = nullptr;   //!< Pointer to batched softmax instance
     MaskedSoftMaxSingle * softMaxSingle_ = nullptr;     //!< Pointer to single softmax instance
     AttentionMulBatched * attMulBatched_ = nullptr;     //!< Pointer to batched attention multiplication instance
     AttentionMulSingle * attMulSingle_ = nullptr;       //!< Pointer to single attention multiplication instance
     DotProductBatched * dotProdBatched_ = nullptr;      //!< Pointer to batched dot-product instance
     DotProductSingle * dotProdSingle_ = nullptr;        //!< Pointer to single dot-product instance
+    TiledAttention * tiledAttention_ = nullptr;         //!< Pointer to tiled attention instance for multiple tokens (replaces the batched instances if set)
+    KVQuantizer * kvQuantizer_ = nullptr;               //!< Pointer to key/value quantization instance (only set for 8-bit key/value caches)
 
     /**
      * Type of quantization to be used in computation
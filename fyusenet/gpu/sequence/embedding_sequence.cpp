@@ -93,28 +93,28 @@ void EmbeddingLayer::forward(uint64_t sequenceNo, StateToken * state) {
     if (!shader_) compileShader();
     sequenceLength_ = state->seqLength;
     CLEAR_GFXERR_DEBUG
-    glDisable(GL_BLEND);
-    glLineWidth(1.0f);
-    glEnable(GL_SCISSOR_TEST);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
+    opengl::GLStateCache::disable(GL_BLEND);
+    opengl::GLCommandBuffer::lineWidth(1.0f);
+    opengl::GLStateCache::enable(GL_SCISSOR_TEST);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
     for (size_t segment=0; segment < embeddingTextures_.size(); segment++) {
-        glActiveTexture(GL_TEXTURE1+segment);
-        glBindTexture(GL_TEXTURE_2D, embeddingTextures_[segment].getHandle());
+        opengl::GLStateCache::activeTexture(GL_TEXTURE1+segment);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, embeddingTextures_[segment].getHandle());
     }
     array_->bind();
-    glViewport(0, 0, viewport_[0], state->seqLength);
-    glScissor(0, 0, viewport_[0], state->seqLength);
+    opengl::GLStateCache::viewport(0, 0, viewport_[0], state->seqLength);
+    opengl::GLCommandBuffer::scissor(0, 0, viewport_[0], state->seqLength);
     framebuffers_.at(0)->bind();
-    glClear(GL_COLOR_BUFFER_BIT);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
     shader_->bind();
     shader_->setUniformVec2("viewport", viewport_[0], state->seqLength);
     shader_->setUniformValue("textureHeight", embeddingTextures_[0].height());
-    glDrawArrays(GL_LINES, 0, 2 * state->seqLength);
+    opengl::GLCommandBuffer::drawArrays(GL_LINES, 0, 2 * state->seqLength);
     framebuffers_.at(0)->unbind();
     shader_->unbind();
     array_->unbind();
-    glDisable(GL_SCISSOR_TEST);
+    opengl::GLStateCache::disable(GL_SCISSOR_TEST);
     disableTextureUnits((int)(embeddingTextures_.size() + 1));
     assert(glGetError() == GL_NO_ERROR);
 }
@@ -207,7 +207,7 @@ void EmbeddingLayer::loadParameters(const ParameterProvider *source) {
     const uint8_t * ptr = nullptr;
     switch (source->dataType(getName()+".embed", getNumber(), 0)) {
         case param_type::WGT_FLOAT32:
-            ptr = reinterpret_cast<const uint8_t *>(std::any_cast<const uint16_t *>(table.get()));
+            ptr = reinterpret_cast<const uint8_t *>(std::any_cast<const float *>(table.get()));
             break;
         case param_type::WGT_FLOAT16:
             dtype = Texture::FLOAT16;
@@ -88,11 +88,11 @@ void LinearLayer::forward(uint64_t sequenceNo, StateToken * state) {
     if (!state) THROW_EXCEPTION_ARGS(FynException, "Trying to invoke forward() without token state");
     sequenceLength_ = state->seqLength;
     assert(glGetError() == GL_NO_ERROR);
-    glEnable(GL_SCISSOR_TEST);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
+    opengl::GLStateCache::enable(GL_SCISSOR_TEST);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
     matMul_->forward(sequenceLength_, 0, framebuffers_.at(0));
-    glDisable(GL_SCISSOR_TEST);
+    opengl::GLStateCache::disable(GL_SCISSOR_TEST);
 }
 
 
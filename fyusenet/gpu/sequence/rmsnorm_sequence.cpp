@@ -17,10 +17,8 @@
 //-------------------------------------- Project  Headers ------------------------------------------
 
 #include "../../gl/gl_sys.h"
-#include "../../gl/scoped_texturepool.h"
 #include "../../gl/vertexshader.h"
 #include "../floatconversion.h"
-#include "../rudiments/proxygenerator.h"
 #include "../../common/miscdefs.h"
 #include "rmsnorm_sequence.h"
 
@@ -48,14 +46,6 @@ RMSNormLayer::RMSNormLayer(const GPULayerBuilder &builder, int layerNumber)
     embedDim_ = inputChannels_;
     width_ = (embedDim_ + PIXEL_PACKING-1) / PIXEL_PACKING;
     height_ = builder.maxSequenceLen_;
-    const int maxcon = 16;          // TODO (mw) make this parameter dependent on the GPU type
-    for (int con = maxcon; con >= 1; con--) {
-        if (width_ % con == 0) {
-            contraction_ = con;
-            instances_ = width_ / contraction_;
-            break;
-        }
-    }
     viewport_[0] = width_;
     viewport_[1] = height_;
 }
@@ -65,17 +55,11 @@ RMSNormLayer::RMSNormLayer(const GPULayerBuilder &builder, int layerNumber)
  * @copydoc GPULayerBase::cleanup
  */
 void RMSNormLayer::cleanup() {
-    FNET_DEL_AND_CLEAR(pass1ArrayLong_);
-    FNET_DEL_AND_CLEAR(pass1VerticesLong_);
-    FNET_DEL_AND_CLEAR(pass2ArrayLong_);
-    FNET_DEL_AND_CLEAR(pass2VerticesLong_);
-    FNET_DEL_AND_CLEAR(quadIndices_);
-    FNET_DEL_AND_CLEAR(normFBO_);
-    if (weightTexture_) glDeleteTextures(1, &weightTexture_);
+    FNET_DEL_AND_CLEAR(lineArray_);
+    FNET_DEL_AND_CLEAR(lineVertices_);
+    if (weightTexture_) opengl::GLStateCache::deleteTextures(1, &weightTexture_);
     weightTexture_ = 0;
-    pass1ShaderLong_.reset();
-    pass2ShaderLong_.reset();
-    shortShader_.reset();
+    shader_.reset();
     GPULayerBase::cleanup();
 }
 
@@ -100,14 +84,11 @@ void RMSNormLayer::forward(uint64_t sequenceNo, StateToken * state) {
     if (!state) THROW_EXCEPTION_ARGS(FynException, "Sequence layers require state tokens");
     if (!weightTexture_) THROW_EXCEPTION_ARGS(FynException, "Trying to invoke forward() on layer without weights, run loadParameters() first");
     sequenceLength_ = state->seqLength;
-    glEnable(GL_SCISSOR_TEST);
-    if (sequenceLength_ <= 1) {
-        computeShortSequence();
-    } else {
-        prepareRender();
-        computeLongSequence();
-    }
-    glDisable(GL_SCISSOR_TEST);
+    if ((sequenceLength_ <= 0) || (sequenceLength_ > height_)) THROW_EXCEPTION_ARGS(FynException, "Illegal sequence length %d (max %d)", sequenceLength_, height_);
+    prepareRender();
+    opengl::GLStateCache::enable(GL_SCISSOR_TEST);
+    normalize();
+    opengl::GLStateCache::disable(GL_SCISSOR_TEST);
 }
 
 
@@ -128,7 +109,7 @@ void RMSNormLayer::forward(uint64_t sequenceNo, StateToken * state) {
     CLEAR_GFXERR_DEBUG
     if (!weightTexture_) glGenTextures(1, &weightTexture_);
     if (!weightTexture_) THROW_EXCEPTION_ARGS(FynException, "Unable to create texture for weight texture (err 0x%x)", glGetError());
-    glBindTexture(GL_TEXTURE_2D, weightTexture_);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, weightTexture_);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     std::string myname = getName()+std::string(".weights");
@@ -269,90 +250,39 @@ BufferSpec::order RMSNormLayer::getOutputOrder(int port) const {
 
 
 /**
- * @brief Compute RMS norm for single token (single matrix row)
+ * @brief Compute RMS norm for all tokens (matrix rows) in a single pass
  *
- * This executes a single render pass where the shader computes the norm (denominator) for the
- * normalization inside the vertex shader which is then passed to the fragment shader that
- * performs the actual weighting/normalization.
+ * This executes a single render pass which draws one line per row by means of instanced
+ * rendering. The vertex shader computes the norm (denominator) for the row of its instance, which
+ * is then passed to the fragment shader that performs the actual weighting/normalization. The
+ * norms are therefore never written to a texture and no additional %FBO is required.
  *
- * A drawback of this approach is that the vertex shader will not scale to SMs, but this should
- * be negligible for the small amount of data we are processing here.
+ * A drawback of this approach is that the norm computation per row does not scale to SMs, as it
+ * runs in a single vertex shader invocation. This is outweighed by saving a 2nd render pass and
+ * the intermediate texture for the norms, in particular for short sequences.
  */
-void RMSNormLayer::computeShortSequence() {
+void RMSNormLayer::normalize() {
     assert(embedDim_ > 0);
-    assert(sequenceLength_ == 1);
-    glDisable(GL_BLEND);
-    glViewport(0, 0, width_, sequenceLength_);
-    glScissor(0, 0, width_, sequenceLength_);
-    pass1ArrayLong_->bind();
+    opengl::GLStateCache::viewport(0, 0, width_, sequenceLength_);
+    opengl::GLCommandBuffer::scissor(0, 0, width_, sequenceLength_);
+    opengl::GLCommandBuffer::lineWidth(1.0f);
+    lineArray_->bind();
     framebuffers_.at(0)->bind();
-    glClear(GL_COLOR_BUFFER_BIT);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, weightTexture_);
-    shortShader_->bind();
-    shortShader_->setUniformVec2("embedWidth", width_, embedDim_);
-    shortShader_->setUniformValue("row", (int)0);
-    glDrawArrays(GL_LINES, 0, 2);
-    pass1ArrayLong_->unbind();
-    shortShader_->unbind();
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
+    opengl::GLStateCache::activeTexture(GL_TEXTURE1);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, weightTexture_);
+    shader_->bind();
+    shader_->setUniformVec2("embedWidth", width_, embedDim_);
+    shader_->setUniformValue("rows", sequenceLength_);
+    opengl::GLCommandBuffer::drawArraysInstanced(GL_LINES, 0, 2, sequenceLength_);
+    lineArray_->unbind();
+    shader_->unbind();
     framebuffers_.at(0)->unbind();
 }
 
 
-
-/**
- * @brief Compute RMS norm for multiple tokens
- *
- * This executes two shader passes for the norm computation. The first pass computes the norm
- * (denominator) for each row using instanced rendering. The second pass uses the previously
- * computed norms - stored in a texture - and applies them to each row together with the
- * weighting.
- */
-void RMSNormLayer::computeLongSequence() {
-    assert(embedDim_ > 0);
-    glLineWidth(1.0f);
-    // --------------------------------------------------------
-    // Pass 1: compute normalizer
-    // --------------------------------------------------------
-    glViewport(0, 0, sequenceLength_, 1);
-    glScissor(0, 0, sequenceLength_, 1);
-    pass1ArrayLong_->bind();
-    pass1ShaderLong_->bind();
-    pass1ShaderLong_->setUniformValue("contraction", contraction_);
-    pass1ShaderLong_->setUniformVec2("inputSize", (float)width_, (float)sequenceLength_);
-    normFBO_->bind();
-    glClear(GL_COLOR_BUFFER_BIT);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
-    glDrawArraysInstanced(GL_LINES, 0, 2, instances_);
-    normFBO_->unbind();
-    pass1ShaderLong_->unbind(true);
-    pass1ArrayLong_->unbind();
-    // --------------------------------------------------------
-    // Pass 2: normalize
-    // --------------------------------------------------------
-    glDisable(GL_BLEND);
-    glViewport(0, 0, width_, sequenceLength_);
-    glScissor(0, 0, width_, sequenceLength_);
-    framebuffers_.at(0)->bind();
-    glClear(GL_COLOR_BUFFER_BIT);
-    pass2ArrayLong_->bind();
-    pass2ShaderLong_->bind();
-    pass2ShaderLong_->setUniformVec2("viewport", (float)width_, (float)sequenceLength_);
-    pass2ShaderLong_->setUniformValue("scale", 1.0f / (float)embedDim_);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, normFBO_->getAttachment(GL_COLOR_ATTACHMENT0));
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, weightTexture_);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *) nullptr);
-    pass2ShaderLong_->unbind();
-    framebuffers_.at(0)->unbind();
-    pass2ArrayLong_->unbind();
-}
-
-
 /**
  * @copydoc GPULayerBase::updateFBOs
  */
@@ -368,9 +298,6 @@ void RMSNormLayer::updateFBOs() {
  * @copydoc GPULayerBase::updateFBOs
  */
 void RMSNormLayer::setupFBOs() {
-    uint32_t scope = (context().texturePool()) ? context().texturePool()->scopeID() : 0;
-    normTex_ = Texture2D(embedDim_, 1, opengl::Texture::FLOAT32, 1, context().texturePool(), scope, false);
-    normFBO_ = new FBO(context(), normTex_);
     assert(outputTextures_.size() == 1);
     framebuffers_.push_back(new FBO(context(), width_, height_, outputTextures_.at(0)));
 }
@@ -379,72 +306,37 @@ void RMSNormLayer::setupFBOs() {
 /**
  * @brief Generate proxy geometry for computing RMS norm(s)
  *
- * Generates a simple line that is used as instance template for the 1st pass targeted at long
- * sequences (also used for the single pass for 1-token sequences) and a simple quad for the 2nd
- * pass for long sequences.
+ * Generates a simple line, defined via the texture coordinates, that is used as instance
+ * template (one instance per row).
  */
 void RMSNormLayer::proxyGeometry() {
-    pass1ArrayLong_ = new VAO(context());
-    pass1ArrayLong_->bind();
-    // ------------------------------------------------------
-    // Pass 1 proxy geometry data, for multiple tokens, we
-    // use a simple line as instance template and define
-    // it via the texture coordinates. This is also used for
-    // the single-token version..
-    // ------------------------------------------------------
-    float p1lverts[] = {0.f, 0.f, 0.f, 1.f};
-    pass1VerticesLong_ = new VBO(context());
-    pass1ArrayLong_->enableArray(0);
-    pass1VerticesLong_->setBufferData(p1lverts, sizeof(p1lverts), GL_STATIC_DRAW);
-    pass1VerticesLong_->bind();
-    pass1ArrayLong_->setVertexAttributeBuffer(0, 2, GL_FLOAT, false, 0, 0);
-    pass1ArrayLong_->unbind();
-    // ------------------------------------------------------
-    // Pass 2 proxy geometry, this renders a simple quad
-    // ------------------------------------------------------
-    const auto [p2arr, p2verts, p2inds] = rudiments::ProxyGenerator::simpleQuad(context());
-    pass2ArrayLong_ = p2arr;
-    pass2VerticesLong_ = p2verts;
-    quadIndices_ = p2inds;
+    lineArray_ = new VAO(context());
+    lineArray_->bind();
+    float verts[] = {0.f, 0.f, 0.f, 1.f};
+    lineVertices_ = new VBO(context());
+    lineArray_->enableArray(0);
+    lineVertices_->setBufferData(verts, sizeof(verts), GL_STATIC_DRAW);
+    lineVertices_->bind();
+    lineArray_->setVertexAttributeBuffer(0, 2, GL_FLOAT, false, 0, 0);
+    lineArray_->unbind();
 }
 
 
 
 /**
- * @brief Compile shaders for RMSNormLayer computation
- *
- * Compiles a total of 3 shaders (1 for short sequences, 2 for long sequences).
+ * @brief Compile shader for RMSNormLayer computation
  */
 void RMSNormLayer::compileShaders() {
     char preproc[256] = {0};
-    auto texbind = [](ShaderProgram * shader) {
-        shader->bind();
-        shader->setUniformValue("inputLayer0", 0);
-        shader->unbind();
-    };
-    pass1ShaderLong_ = compileShaderPair("shaders/sequence/rmsnorm_long_pass1.vert", "shaders/sequence/rmsnorm_long_pass1.frag", preproc, typeid(this));
-    pass1ShaderLong_->bindAttributeLocation("attributes0", 0);
-    pass1ShaderLong_->link();
-    assert(pass1ShaderLong_->isLinked());
-    pass2ShaderLong_ = compileShaderPair("shaders/sequence/rmsnorm_long_pass2.vert", "shaders/sequence/rmsnorm_long_pass2.frag", preproc, typeid(this));
-    pass2ShaderLong_->bindAttributeLocation("attributes0", 0);
-    pass2ShaderLong_->link();
-    assert(pass2ShaderLong_->isLinked());
-    shortShader_ = compileShaderPair("shaders/sequence/rmsnorm_short.vert", "shaders/sequence/rmsnorm_short.frag", preproc, typeid(this));
-    shortShader_->bindAttributeLocation("attributes0", 0);
-    shortShader_->link();
-    assert(shortShader_->isLinked());
+    shader_ = compileShaderPair("shaders/sequence/rmsnorm.vert", "shaders/sequence/rmsnorm.frag", preproc, typeid(this));
+    shader_->bindAttributeLocation("attributes0", 0);
+    shader_->link();
+    assert(shader_->isLinked());
     if (!GLInfo::hasBinding()) {
-        texbind(pass1ShaderLong_.get());
-        texbind(shortShader_.get());
-        pass2ShaderLong_->bind();
-        pass2ShaderLong_->setUniformValue("inputLayer0", 0);
-        pass2ShaderLong_->setUniformValue("normData", 1);
-        pass2ShaderLong_->setUniformValue("weights", 2);
-        pass2ShaderLong_->unbind();
-        shortShader_->bind();
-        shortShader_->setUniformValue("weights", 1);
-        shortShader_->unbind();
+        shader_->bind();
+        shader_->setUniformValue("inputLayer0", 0);
+        shader_->setUniformValue("weights", 1);
+        shader_->unbind();
     }
 }
 
@@ -49,15 +49,10 @@ namespace fyusion::fyusenet::gpu::sequence {
  * where each row in the texture represents a token and each pixel in a row represents 4 consecutive
  * entries in each embedding vector (RGBA-format texture).
  *
- * The output texture format will be identical to the input format. Depending on the number of
- * rows of the input matrix, either a \e short shader will be used or a \e long shader. The
- * short shader is meant for single row inputs only, as they often occur during the autoregressive
- * prediction of single (output) tokens. For a single token, this layer only requires one shader
- * pass.
- *
- * The long shader is meant for inputs with multiple rows and employs a two-pass approach which
- * first computes the norm for each row and then performs the actual normalization in a 2nd
- * pass.
+ * The output texture format will be identical to the input format. The normalization is done in
+ * a single shader pass for any number of rows, which renders one (instanced) line per row. The
+ * vertex shader computes the norm for each row and passes it on to the fragment shader, which
+ * performs the weighting/normalization, such that the norms are never written to a texture.
  */
 class RMSNormLayer : public gpu::GPULayerBase {
     friend class ::AttentionTest;
@@ -87,8 +82,7 @@ class RMSNormLayer : public gpu::GPULayerBase {
     // ------------------------------------------------------------------------
     [[nodiscard]] BufferSpec::order getInputOrder(int port) const override;
     [[nodiscard]] BufferSpec::order getOutputOrder(int port) const override;
-    void computeShortSequence();
-    void computeLongSequence();
+    void normalize();
     void proxyGeometry();
     void compileShaders();
 
@@ -97,18 +91,9 @@ class RMSNormLayer : public gpu::GPULayerBase {
     // ------------------------------------------------------------------------
     int embedDim_ = 0;                      //!< Embedding dimension of the input tensor (width, not necessarily the texture width)
     int sequenceLength_ = 0;                //!< Number of rows of the input tensor (not necessarily the texture height)
-    int contraction_ = 0;                   //!< Number of items to contract per instance for the 1st pass norm computation
-    int instances_ = 0;                     //!< Number of instances to use for the 1st pass norm computation
-    opengl::Texture2D normTex_;             //!< Backing texture for long shader 1st pass (norm computation)
-    VAO * pass1ArrayLong_ = nullptr;        //!< VAO for 1st pass of long shader (and also the only pass of the short shader)
-    VBO * pass1VerticesLong_ = nullptr;     //!< VBO for 1st pass of long shader
-    VAO * pass2ArrayLong_ = nullptr;        //!< VAO for 2nd pass of long shader
-    VBO * pass2VerticesLong_ = nullptr;     //!< VBO for 2nd pass of long shader
-    IBO * quadIndices_ = nullptr;           //!< IBO for quad geometry/indices
-    programptr pass1ShaderLong_;            //!< Shader program for 1st pass of long shader
-    programptr pass2ShaderLong_;            //!< Shader program for 2nd pass of long shader
-    programptr shortShader_;                //!< Shader program for short shader
-    FBO * normFBO_ = nullptr;               //!< Pointer to %FBO that stores the norm
+    VAO * lineArray_ = nullptr;             //!< VAO for the line that is used as instance template (one instance per row)
+    VBO * lineVertices_ = nullptr;          //!< VBO for the line that is used as instance template
+    programptr shader_;                     //!< Shader program that computes the norm and normalizes the rows
     GLuint weightTexture_ = 0;              //!< GL texture ID for the weights used by this layer
 };
 
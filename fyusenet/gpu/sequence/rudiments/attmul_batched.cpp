@@ -17,6 +17,7 @@
 #include "../../../base/layerbase.h"
 #include "../../../common/miscdefs.h"
 #include "attmul_batched.h"
+#include "kv_quantizer.h"
 
 //-------------------------------------- Global Variables ------------------------------------------
 
@@ -33,12 +34,13 @@ namespace fyusion::fyusenet::gpu::sequence::rudiments {
  * @brief Constructor
  *
  * @param numHeads Number of attention heads
+ * @param numKVHeads Number of key/value heads, each one is shared by \c numHeads / \c numKVHeads query heads
  * @param headDim Dimensionality (in atoms, not pixels) of each head
  * @param maxSeq Maximum number of tokens that can be processed
  * @param ctx OpenGL context to use
  */
-AttentionMulBatched::AttentionMulBatched(int numHeads, int headDim, int maxSeq, const GfxContextLink &ctx) :
-        GfxContextTracker(ctx), numHeads_(numHeads), headDim_(headDim), maxSequenceLength_(maxSeq) {
+AttentionMulBatched::AttentionMulBatched(int numHeads, int numKVHeads, int headDim, int maxSeq, const GfxContextLink &ctx) :
+        GfxContextTracker(ctx), numHeads_(numHeads), numKVHeads_(numKVHeads), headDim_(headDim), maxSequenceLength_(maxSeq) {
     maxBatchedWeights_ = opengl::GLInfo::getMaxVaryingVectors() - USED_VARYINGS;
 }
 
@@ -52,6 +54,20 @@ AttentionMulBatched::~AttentionMulBatched() {
     shader_.reset();
 }
 
+/**
+ * @brief Read the values from an 8-bit quantized cache
+ *
+ * Instructs the multiplication to expect a signed integer value texture in forward(), which is dequantized
+ * on the fly. The scales for each token and head must be bound to KVQuantizer::VALUE_SCALE_UNIT when
+ * running forward().
+ *
+ * @pre Must be called before setup()
+ */
+void AttentionMulBatched::quantizedCache() {
+    quantizedCache_ = true;
+}
+
+
 /**
  * @brief Generate proxy geometry and setup shaders
  */
@@ -82,24 +98,24 @@ void AttentionMulBatched::forward(GLuint valueTexture, GLuint smTexture, int num
     array_->bind();
     shader_->bind();
     shader_->setUniformVec2("viewport", (int)vpwidth, numTokens);
-    glEnable(GL_BLEND);
-    glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-    glBlendFuncSeparate(GL_ONE,GL_ONE, GL_ONE,GL_ONE);
-    glLineWidth(1.0f);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, valueTexture);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, smTexture);
+    opengl::GLStateCache::enable(GL_BLEND);
+    opengl::GLStateCache::blendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+    opengl::GLStateCache::blendFuncSeparate(GL_ONE,GL_ONE, GL_ONE,GL_ONE);
+    opengl::GLCommandBuffer::lineWidth(1.0f);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, valueTexture);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE1);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, smTexture);
     targetFBO->bind();
     for (int batch=0; batch < batchSize; batch++) {
         int vpxoffset = (fullwidth / numHeads_) * headOffset;
-        glViewport(vpxoffset, 0, vpwidth, numTokens);
-        glScissor(vpxoffset, 0, vpwidth, numTokens);
-        glClear(GL_COLOR_BUFFER_BIT);
+        opengl::GLStateCache::viewport(vpxoffset, 0, vpwidth, numTokens);
+        opengl::GLCommandBuffer::scissor(vpxoffset, 0, vpwidth, numTokens);
+        opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
         int offset = (tokenIndex == 0) ? 0 : lines_.at(tokenIndex-1);
         int nlines = (tokenIndex == 0) ? lines_.at(numTokens - 1) : lines_.at(tokenIndex + numTokens - 1) - lines_.at(tokenIndex - 1);
         shader_->setUniformVec4("tileParams", (int)vpxoffset, (int)headDim_, batch * numTokens, tokenIndex);
-        glDrawArrays(GL_LINES, offset * 2, nlines * 2);
+        opengl::GLCommandBuffer::drawArrays(GL_LINES, offset * 2, nlines * 2);
         headOffset += PIXEL_PACKING;
     }
     targetFBO->unbind();
@@ -119,7 +135,8 @@ void AttentionMulBatched::forward(GLuint valueTexture, GLuint smTexture, int num
 void AttentionMulBatched::compileShaders() {
     using namespace opengl;
     char preproc[256] = {0};
-    snprintf(preproc, sizeof(preproc) - 1, "#define MATRIX_WEIGHTS %d\n", maxBatchedWeights_);
+    snprintf(preproc, sizeof(preproc) - 1, "#define MATRIX_WEIGHTS %d\n#define KV_GROUP %d\n#define HEAD_PIXELS %d\n", maxBatchedWeights_, numHeads_ / numKVHeads_, headDim_ / PIXEL_PACKING);
+    if (quantizedCache_) KVQuantizer::dequantizationPreproc(preproc, sizeof(preproc));
     shader_ = ShaderRepository::compileShaderPair("shaders/sequence/att_matmul_headbatch_masked.vert", "shaders/sequence/att_matmul_headbatch_masked.frag", preproc, typeid(this), context());
     shader_->bindAttributeLocation("attributes0", 0);
     shader_->link();
@@ -128,6 +145,7 @@ void AttentionMulBatched::compileShaders() {
         shader_->bind();
         shader_->setUniformValue("inputLayer0", 0);
         shader_->setUniformValue("attWeights", 1);
+        if (quantizedCache_) shader_->setUniformValue("valueScales", KVQuantizer::VALUE_SCALE_UNIT);
         shader_->unbind();
     }
 }
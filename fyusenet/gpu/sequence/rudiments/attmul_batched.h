@@ -50,12 +50,13 @@ class AttentionMulBatched : public GfxContextTracker {
     // ------------------------------------------------------------------------
     // Constructor / Destructor
     // ------------------------------------------------------------------------
-    AttentionMulBatched(int numHeads, int headDim, int maxSeq, const GfxContextLink& ctx);
+    AttentionMulBatched(int numHeads, int numKVHeads, int headDim, int maxSeq, const GfxContextLink& ctx);
     ~AttentionMulBatched() override;
 
     // ------------------------------------------------------------------------
     // Public methods
     // ------------------------------------------------------------------------
+    void quantizedCache();
     void setup();
     void forward(GLuint valueTexture, GLuint smTexture, int numTokens, int tokenIndex, int headOffset, int batchSize, opengl::FBO *targetFBO);
 
@@ -70,9 +71,11 @@ class AttentionMulBatched : public GfxContextTracker {
     // Member variables
     // ------------------------------------------------------------------------
     int numHeads_ = 0;                      //!< Number of heads in the multi-head attention
+    int numKVHeads_ = 0;                    //!< Number of (shared) key/value heads in the multi-head attention
     int headDim_ = 0;                       //!< Dimension of the attention heads
     int maxSequenceLength_ = 0;             //!< Maximum supported sequence length (must be allocated in the textures already)
     int maxBatchedWeights_ = 0;             //!< Maximum number of weights that can be batched in a single pass
+    bool quantizedCache_ = false;           //!< Indicator whether the values are read from an 8-bit quantized cache (see KVQuantizer)
     opengl::VAO * array_ = nullptr;         //!< Proxy geometry VAO
     opengl::VBO * vertices_ = nullptr;      //!< Proxy geometry VBO
     opengl::programptr shader_;             //!< Shader program that performs the computation
@@ -14,6 +14,7 @@
 //-------------------------------------- Project  Headers ------------------------------------------
 
 #include "attmul_single.h"
+#include "kv_quantizer.h"
 #include "../../../gl/shaderresource.h"
 #include "../../../gl/glinfo.h"
 #include "../../../base/layerbase.h"
@@ -35,11 +36,12 @@ namespace fyusion::fyusenet::gpu::sequence::rudiments {
  *
  * @param width Width of the token embedding (in pixels)
  * @param numHeads Number of attention heads
+ * @param numKVHeads Number of key/value heads, each one is shared by \c numHeads / \c numKVHeads query heads
  * @param headDim Dimensionality (in atoms, not pixels) of each head
  * @param ctx OpenGL context to use
  */
-AttentionMulSingle::AttentionMulSingle(int width, int numHeads, int headDim, const GfxContextLink& ctx) :
-  GfxContextTracker(ctx) , width_(width), numHeads_(numHeads), headDim_(headDim) {
+AttentionMulSingle::AttentionMulSingle(int width, int numHeads, int numKVHeads, int headDim, const GfxContextLink& ctx) :
+  GfxContextTracker(ctx) , width_(width), numHeads_(numHeads), numKVHeads_(numKVHeads), headDim_(headDim) {
     maxSingleWeights_ = opengl::GLInfo::getMaxVaryingVectors() - USED_VARYINGS;
 }
 
@@ -54,6 +56,20 @@ AttentionMulSingle::~AttentionMulSingle() {
 }
 
 
+/**
+ * @brief Read the values from an 8-bit quantized cache
+ *
+ * Instructs the multiplication to expect a signed integer value texture in forward(), which is dequantized
+ * on the fly. The scales for each token and head must be bound to KVQuantizer::VALUE_SCALE_UNIT when
+ * running forward().
+ *
+ * @pre Must be called before setup()
+ */
+void AttentionMulSingle::quantizedCache() {
+    quantizedCache_ = true;
+}
+
+
 /**
  * @brief Generate proxy geometry and setup shaders
  */
@@ -79,24 +95,24 @@ void AttentionMulSingle::forward(GLuint valueTexture, GLuint smTexture, int toke
     assert(keyLength > 0);
     int maxweights = maxSingleWeights_ * PIXEL_PACKING;
     int instances = (tokenIndex+1 + maxweights - 1) / maxweights;
-    glEnable(GL_BLEND);
-    glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-    glBlendFuncSeparate(GL_ONE,GL_ONE, GL_ONE,GL_ONE);
-    glLineWidth(1.0f);
-    glViewport(0, 0, width_, 1);
-    glScissor(0, 0, width_, 1);
+    opengl::GLStateCache::enable(GL_BLEND);
+    opengl::GLStateCache::blendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+    opengl::GLStateCache::blendFuncSeparate(GL_ONE,GL_ONE, GL_ONE,GL_ONE);
+    opengl::GLCommandBuffer::lineWidth(1.0f);
+    opengl::GLStateCache::viewport(0, 0, width_, 1);
+    opengl::GLCommandBuffer::scissor(0, 0, width_, 1);
     array_->bind();
     shader_->bind();
     shader_->setUniformVec2("viewport", width_, 1);
     shader_->setUniformValue("tokenIdx", tokenIndex);
     targetFBO->bind();
     targetFBO->setWriteMask();
-    glClear(GL_COLOR_BUFFER_BIT);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, valueTexture);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, smTexture);
-    glDrawArraysInstanced(GL_LINES, 0, numHeads_ * 2, instances);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, valueTexture);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE1);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, smTexture);
+    opengl::GLCommandBuffer::drawArraysInstanced(GL_LINES, 0, numHeads_ * 2, instances);
     targetFBO->unbind();
     shader_->unbind();
     array_->unbind();
@@ -113,7 +129,8 @@ void AttentionMulSingle::forward(GLuint valueTexture, GLuint smTexture, int toke
 void AttentionMulSingle::compileShaders() {
     using namespace opengl;
     char preproc[256] = {0};
-    snprintf(preproc, sizeof(preproc) - 1, "#define MATRIX_WEIGHTS %d\n", maxSingleWeights_);
+    snprintf(preproc, sizeof(preproc) - 1, "#define MATRIX_WEIGHTS %d\n#define KV_GROUP %d\n#define HEAD_PIXELS %d\n", maxSingleWeights_, numHeads_ / numKVHeads_, headDim_ / PIXEL_PACKING);
+    if (quantizedCache_) KVQuantizer::dequantizationPreproc(preproc, sizeof(preproc));
     shader_ = ShaderRepository::compileShaderPair("shaders/sequence/att_matmul_single_masked.vert", "shaders/sequence/att_matmul_single_masked.frag", preproc, typeid(this), context());
     shader_->bindAttributeLocation("attributes0", 0);
     shader_->link();
@@ -121,6 +138,7 @@ void AttentionMulSingle::compileShaders() {
     shader_->bind();
     shader_->setUniformValue("inputLayer0", 0);
     shader_->setUniformValue("attWeights", 1);
+    if (quantizedCache_) shader_->setUniformValue("valueScales", KVQuantizer::VALUE_SCALE_UNIT);
     shader_->unbind();
 }
 
@@ -46,12 +46,13 @@ class AttentionMulSingle : public GfxContextTracker {
     // ------------------------------------------------------------------------
     // Constructor / Destructor
     // ------------------------------------------------------------------------
-    AttentionMulSingle(int width, int numHeads, int headDim, const GfxContextLink& ctx);
+    AttentionMulSingle(int width, int numHeads, int numKVHeads, int headDim, const GfxContextLink& ctx);
     ~AttentionMulSingle() override;
 
     // ------------------------------------------------------------------------
     // Public methods
     // ------------------------------------------------------------------------
+    void quantizedCache();
     void setup();
     void forward(GLuint valueTexture, GLuint smTexture, int tokenIndex, int keyLength, opengl::FBO *targetFBO);
 
@@ -67,8 +68,10 @@ class AttentionMulSingle : public GfxContextTracker {
     // ------------------------------------------------------------------------
     int width_;                               //!< Pixel width of the embedding dimension of a sequence
     int numHeads_ = 0;                        //!< Number of attention heads
+    int numKVHeads_ = 0;                      //!< Number of (shared) key/value heads
     int headDim_ = 0;                         //!< Dimensionality of each attention head (in atoms)
     int maxSingleWeights_ = 0;                //!< Maximum weights that can be processed in a single pass
+    bool quantizedCache_ = false;             //!< Indicator whether the values are read from an 8-bit quantized cache (see KVQuantizer)
     opengl::VAO * array_ = nullptr;           //!< Vertex array object for proxy geometry
     opengl::VBO * vertices_ = nullptr;        //!< Vertex buffer for proxy geometry
     opengl::programptr shader_;               //!< Shader program that performs the computation
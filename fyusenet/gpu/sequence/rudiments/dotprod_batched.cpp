@@ -15,6 +15,7 @@
 //-------------------------------------- Project  Headers ------------------------------------------
 
 #include "dotprod_batched.h"
+#include "kv_quantizer.h"
 #include "../../../gl/shaderresource.h"
 #include "../../../base/layerbase.h"
 #include "../../../common/miscdefs.h"
@@ -34,12 +35,13 @@ namespace fyusion::fyusenet::gpu::sequence::rudiments {
  * @brief Constructor
  *
  * @param numHeads Number of heads in the multi-head attention layer
+ * @param numKVHeads Number of key/value heads, each one is shared by \c numHeads / \c numKVHeads query heads
  * @param maxBatch Maximum allowed batch size
  * @param headDim Dimension (in elements) of each head
  * @param ctx GL context to work with
  */
-DotProductBatched::DotProductBatched(int numHeads, int headDim, int maxBatch, const GfxContextLink &ctx) :
-        GfxContextTracker(ctx), numHeads_(numHeads), headDim_(headDim), maxBatch_(maxBatch) {
+DotProductBatched::DotProductBatched(int numHeads, int numKVHeads, int headDim, int maxBatch, const GfxContextLink &ctx) :
+        GfxContextTracker(ctx), numHeads_(numHeads), numKVHeads_(numKVHeads), headDim_(headDim), maxBatch_(maxBatch) {
 }
 
 
@@ -53,6 +55,20 @@ DotProductBatched::~DotProductBatched() {
     shader_.reset();
 }
 
+/**
+ * @brief Read the keys from an 8-bit quantized cache
+ *
+ * Instructs the dot-product to expect a signed integer key texture in forward(), which is dequantized
+ * on the fly. The scales for each token and head must be bound to KVQuantizer::KEY_SCALE_UNIT when
+ * running forward().
+ *
+ * @pre Must be called before setup()
+ */
+void DotProductBatched::quantizedCache() {
+    quantizedCache_ = true;
+}
+
+
 /**
  * @brief Setup GL resources for this operation (proxy geometry and shaders)
  */
@@ -80,28 +96,28 @@ void DotProductBatched::setup() {
  * @pre \c GL_SCISSOR_TEST test is enabled
  */
 void DotProductBatched::forward(GLuint queryTexture, GLuint keyTexture, int numTokens, int keyLength, int headOffset, int batchSize, opengl::FBO *targetFBO) {
-    glEnable(GL_BLEND);
-    glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-    glBlendFuncSeparate(GL_ONE,GL_ONE, GL_ONE,GL_ONE);
+    opengl::GLStateCache::enable(GL_BLEND);
+    opengl::GLStateCache::blendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+    opengl::GLStateCache::blendFuncSeparate(GL_ONE,GL_ONE, GL_ONE,GL_ONE);
     int numinstances = (headDim_ / PIXEL_PACKING) / innerBatchSize_;
     int viewportwidth = keyLength;
     int viewportheight = numTokens * batchSize;
-    glViewport(0, 0, viewportwidth, viewportheight);
-    glScissor(0, 0, viewportwidth, viewportheight);
+    opengl::GLStateCache::viewport(0, 0, viewportwidth, viewportheight);
+    opengl::GLCommandBuffer::scissor(0, 0, viewportwidth, viewportheight);
     array_->bind();
     shader_->bind();
     shader_->setUniformVec4("viewport", (float)viewportwidth, (float)viewportheight, 1.0f, (float)maxBatch_ / (float)batchSize);
     shader_->setUniformVec4("sizeParams", headDim_ / PIXEL_PACKING, numHeads_, keyLength, numTokens);
     shader_->setUniformValue("headOffset", headOffset);
     shader_->setUniformValue("scaling", 1.0f / sqrtf((float)headDim_));
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, queryTexture);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, keyTexture);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, queryTexture);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE1);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, keyTexture);
     targetFBO->bind();
     targetFBO->setWriteMask();
-    glClear(GL_COLOR_BUFFER_BIT);
-    glDrawElementsInstanced(GL_TRIANGLES, batchSize * 6, GL_UNSIGNED_SHORT, (const GLvoid *) nullptr, numinstances);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
+    opengl::GLCommandBuffer::drawElementsInstanced(GL_TRIANGLES, batchSize * 6, GL_UNSIGNED_SHORT, (const GLvoid *) nullptr, numinstances);
     targetFBO->unbind();
     shader_->unbind();
     array_->unbind();
@@ -118,7 +134,8 @@ void DotProductBatched::forward(GLuint queryTexture, GLuint keyTexture, int numT
 void DotProductBatched::compileShaders() {
     using namespace opengl;
     char preproc[256] = {0};
-    snprintf(preproc, sizeof(preproc) - 1, "#define INNER_BATCH_SIZE %d\n", innerBatchSize_);
+    snprintf(preproc, sizeof(preproc) - 1, "#define INNER_BATCH_SIZE %d\n#define KV_GROUP %d\n", innerBatchSize_, numHeads_ / numKVHeads_);
+    if (quantizedCache_) KVQuantizer::dequantizationPreproc(preproc, sizeof(preproc));
     shader_ = ShaderRepository::compileShaderPair("shaders/sequence/qk_dotprod_headbatch.vert", "shaders/sequence/qk_dotprod_headbatch.frag", preproc, typeid(this), context());
     shader_->bindAttributeLocation("attributes0", 0);
     shader_->link();
@@ -127,6 +144,7 @@ void DotProductBatched::compileShaders() {
         shader_->bind();
         shader_->setUniformValue("inputLayer0", 0);
         shader_->setUniformValue("inputLayer1", 1);
+        if (quantizedCache_) shader_->setUniformValue("keyScales", KVQuantizer::KEY_SCALE_UNIT);
         shader_->unbind();
     }
 }
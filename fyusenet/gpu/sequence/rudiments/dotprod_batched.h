@@ -61,12 +61,13 @@ class DotProductBatched : public GfxContextTracker {
     // ------------------------------------------------------------------------
     // Constructor / Destructor
     // ------------------------------------------------------------------------
-    DotProductBatched(int numHeads, int headDim, int maxBatch, const GfxContextLink& ctx);
+    DotProductBatched(int numHeads, int numKVHeads, int headDim, int maxBatch, const GfxContextLink& ctx);
     ~DotProductBatched() override;
 
     // ------------------------------------------------------------------------
     // Public methods
     // ------------------------------------------------------------------------
+    void quantizedCache();
     void setup();
     void forward(GLuint queryTexture, GLuint keyTexture, int numTokens, int keyLength, int headOffset, int batchSize, opengl::FBO *targetFBO);
 
@@ -81,9 +82,11 @@ class DotProductBatched : public GfxContextTracker {
     // Member variables
     // ------------------------------------------------------------------------
     int numHeads_ = 0;
+    int numKVHeads_ = 0;
     int headDim_ = 0;
     int innerBatchSize_ = 4;
     int maxBatch_ = 0;
+    bool quantizedCache_ = false;
     opengl::VAO * array_ = nullptr;
     opengl::VBO * vertices_ = nullptr;
     opengl::IBO * indices_ = nullptr;
@@ -19,6 +19,7 @@
 #include "../../../common/miscdefs.h"
 #include "../../rudiments/proxygenerator.h"
 #include "dotprod_single.h"
+#include "kv_quantizer.h"
 
 //-------------------------------------- Global Variables ------------------------------------------
 
@@ -36,15 +37,30 @@ namespace fyusion::fyusenet::gpu::sequence::rudiments {
  *
  * @param width Full dimension (heads x head_dim) (divided by 4 and rounded up) for each token
  * @param numHeads Number of heads in the multi-head attention layer
+ * @param numKVHeads Number of key/value heads, each one is shared by \c numHeads / \c numKVHeads query heads
  * @param headDim Dimension (in elements) of each head
  * @param ctx GL context to work with
  */
-DotProductSingle::DotProductSingle(int width, int numHeads, int headDim, const GfxContextLink& ctx) :
-  GfxContextTracker(ctx) , width_(width), numHeads_(numHeads), headDim_(headDim) {
+DotProductSingle::DotProductSingle(int width, int numHeads, int numKVHeads, int headDim, const GfxContextLink& ctx) :
+  GfxContextTracker(ctx) , width_(width), numHeads_(numHeads), numKVHeads_(numKVHeads), headDim_(headDim) {
     // TODO (mw) adjust inner batch size depending on GPU type
 }
 
 
+/**
+ * @brief Read the keys from an 8-bit quantized cache
+ *
+ * Instructs the dot-product to expect a signed integer key texture in forward(), which is dequantized
+ * on the fly. The scales for each token and head must be bound to KVQuantizer::KEY_SCALE_UNIT when
+ * running forward().
+ *
+ * @pre Must be called before setup()
+ */
+void DotProductSingle::quantizedCache() {
+    quantizedCache_ = true;
+}
+
+
 /**
  * @brief Setup GL resources for this operation
  */
@@ -65,25 +81,25 @@ void DotProductSingle::setup() {
  * @pre \c GL_SCISSOR_TEST is enabled
  */
 void DotProductSingle::forward(GLuint queryTexture, GLuint keyTexture, int keyLength, opengl::FBO *targetFBO) {
-    glEnable(GL_BLEND);
-    glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-    glBlendFuncSeparate(GL_ONE,GL_ONE, GL_ONE,GL_ONE);
+    opengl::GLStateCache::enable(GL_BLEND);
+    opengl::GLStateCache::blendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+    opengl::GLStateCache::blendFuncSeparate(GL_ONE,GL_ONE, GL_ONE,GL_ONE);
     int instances = (headDim_ / innerBatchSize_) / PIXEL_PACKING;
     int viewportheight = (numHeads_ + PIXEL_PACKING - 1) / PIXEL_PACKING;
-    glViewport(0, 0, keyLength, viewportheight);
-    glScissor(0, 0, keyLength, viewportheight);
+    opengl::GLStateCache::viewport(0, 0, keyLength, viewportheight);
+    opengl::GLCommandBuffer::scissor(0, 0, keyLength, viewportheight);
     array_->bind();
     shader_->bind();
     shader_->setUniformVec4("inputParams", headDim_ / PIXEL_PACKING, numHeads_ / PIXEL_PACKING, keyLength, 1);
     shader_->setUniformValue("scaling", 1.0f / sqrtf((float)headDim_));
     targetFBO->bind();
     targetFBO->setWriteMask();
-    glClear(GL_COLOR_BUFFER_BIT);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, queryTexture);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, keyTexture);
-    glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *) nullptr, instances);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, queryTexture);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE1);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, keyTexture);
+    opengl::GLCommandBuffer::drawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *) nullptr, instances);
     targetFBO->unbind();
     shader_->unbind(true);
     array_->unbind();
@@ -101,7 +117,8 @@ void DotProductSingle::forward(GLuint queryTexture, GLuint keyTexture, int keyLe
 void DotProductSingle::compileShaders() {
     using namespace opengl;
     char preproc[256] = {0};
-    snprintf(preproc, sizeof(preproc) - 1, "#define INNER_BATCH_SIZE %d\n", innerBatchSize_);
+    snprintf(preproc, sizeof(preproc) - 1, "#define INNER_BATCH_SIZE %d\n#define KV_GROUP %d\n", innerBatchSize_, numHeads_ / numKVHeads_);
+    if (quantizedCache_) KVQuantizer::dequantizationPreproc(preproc, sizeof(preproc));
     shader_ = ShaderRepository::compileShaderPair("shaders/sequence/qk_dotprod_single.vert", "shaders/sequence/qk_dotprod_single.frag", preproc, typeid(this), context());
     shader_->bindAttributeLocation("attributes0", 0);
     shader_->bindAttributeLocation("attributes1", 1);
@@ -111,6 +128,7 @@ void DotProductSingle::compileShaders() {
         shader_->bind();
         shader_->setUniformValue("inputLayer0", 0);
         shader_->setUniformValue("inputLayer1", 1);
+        if (quantizedCache_) shader_->setUniformValue("keyScales", KVQuantizer::KEY_SCALE_UNIT);
         shader_->unbind();
     }
 }
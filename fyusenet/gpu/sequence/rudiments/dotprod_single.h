@@ -53,11 +53,12 @@ class DotProductSingle : public GfxContextTracker {
     // ------------------------------------------------------------------------
     // Constructor / Destructor
     // ------------------------------------------------------------------------
-    DotProductSingle(int width, int numHeads, int headDim, const GfxContextLink& ctx);
+    DotProductSingle(int width, int numHeads, int numKVHeads, int headDim, const GfxContextLink& ctx);
 
     // ------------------------------------------------------------------------
     // Public methods
     // ------------------------------------------------------------------------
+    void quantizedCache();
     void setup();
     void forward(GLuint queryTexture, GLuint keyTexture, int keyLength, opengl::FBO *targetFBO);
 
@@ -73,8 +74,10 @@ class DotProductSingle : public GfxContextTracker {
     // ------------------------------------------------------------------------
     int width_ = 0;                           //!< Width of the input query and key textures
     int numHeads_ = 0;                        //!< Number of heads in the multi-head attention
+    int numKVHeads_ = 0;                      //!< Number of (shared) key/value heads in the multi-head attention
     int headDim_ = 0;                         //!< Dimension of the attention heads
     int innerBatchSize_ = 4;                  //!< Parameter that controls the amount of computation per instance pass in the fragment shader
+    bool quantizedCache_ = false;             //!< Indicator whether the keys are read from an 8-bit quantized cache (see KVQuantizer)
     std::unique_ptr<opengl::VAO> array_;      //!< Proxy geometry VAO
     std::unique_ptr<opengl::VBO> vertices_;   //!< Proxy geometry VBO
     std::unique_ptr<opengl::IBO> indices_;    //!< Proxy geometry IBO
@@ -0,0 +1,158 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Key/Value Cache Quantization                                                (c) Martin Wawro 2023
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <cassert>
+#include <cstring>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "kv_quantizer.h"
+#include "../../rudiments/proxygenerator.h"
+#include "../../../gl/shaderresource.h"
+#include "../../../gl/glinfo.h"
+#include "../../../base/layerbase.h"
+
+//-------------------------------------- Global Variables ------------------------------------------
+
+namespace fyusion::fyusenet::gpu::sequence::rudiments {
+
+//-------------------------------------- Local Definitions -----------------------------------------
+
+/*##################################################################################################
+#                                   P U B L I C  F U N C T I O N S                                 #
+##################################################################################################*/
+
+
+/**
+ * @brief Constructor
+ *
+ * @param numKVHeads Number of key/value heads in the tensors to quantize
+ * @param headDim Dimension of a single head (must be divisible by 4)
+ * @param ctx GL context to work with
+ */
+KVQuantizer::KVQuantizer(int numKVHeads, int headDim, const GfxContextLink& ctx) :
+        GfxContextTracker(ctx), numKVHeads_(numKVHeads), headDim_(headDim) {
+    assert((headDim_ % LayerBase::PIXEL_PACKING) == 0);
+}
+
+
+/**
+ * @brief Destructor, releases GL resources
+ */
+KVQuantizer::~KVQuantizer() {
+    scaleShader_.reset();
+    quantShader_.reset();
+}
+
+
+/**
+ * @brief Setup GL resources (proxy geometry and shaders)
+ */
+void KVQuantizer::setup() {
+    const auto [arr, verts, inds] = gpu::rudiments::ProxyGenerator::simpleQuad(context());
+    array_.reset(arr);
+    vertices_.reset(verts);
+    indices_.reset(inds);
+    compileShaders();
+}
+
+
+/**
+ * @brief Quantize a set of tokens into the key/value cache
+ *
+ * @param srcTexture GL handle for the texture that contains the (floating-point) keys or values,
+ *                   starting at the first row
+ * @param numTokens Number of tokens to quantize
+ * @param targetRow Row offset in the cache to write the quantized tokens to
+ * @param dataFBO FBO that wraps the 8-bit integer texture of the cache
+ * @param scaleFBO FBO that wraps the scale texture of the cache
+ *
+ * The quantization is done in two passes, the first one computes the scales for each token
+ * and head, the second one uses those to convert the data into integers.
+ *
+ * @pre \c GL_SCISSOR_TEST is enabled
+ */
+void KVQuantizer::forward(GLuint srcTexture, int numTokens, int targetRow, opengl::FBO *dataFBO, opengl::FBO *scaleFBO) {
+    using namespace opengl;
+    int headpixels = headDim_ / LayerBase::PIXEL_PACKING;
+    int scalewidth = (numKVHeads_ + LayerBase::PIXEL_PACKING - 1) / LayerBase::PIXEL_PACKING;
+    array_->bind();
+    GLStateCache::disable(GL_BLEND);
+    GLStateCache::activeTexture(GL_TEXTURE0);
+    GLStateCache::bindTexture(GL_TEXTURE_2D, srcTexture);
+    // scales per token and head
+    GLStateCache::viewport(0, targetRow, scalewidth, numTokens);
+    GLCommandBuffer::scissor(0, targetRow, scalewidth, numTokens);
+    scaleShader_->bind();
+    scaleShader_->setUniformVec4("quantParams", headpixels, numKVHeads_, targetRow, 0);
+    scaleFBO->bind();
+    GLCommandBuffer::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *) nullptr);
+    scaleFBO->unbind();
+    scaleShader_->unbind(true);
+    // quantized data
+    GLStateCache::viewport(0, targetRow, numKVHeads_ * headpixels, numTokens);
+    GLCommandBuffer::scissor(0, targetRow, numKVHeads_ * headpixels, numTokens);
+    quantShader_->bind();
+    quantShader_->setUniformVec4("quantParams", headpixels, numKVHeads_, targetRow, 0);
+    GLStateCache::activeTexture(GL_TEXTURE1);
+    GLStateCache::bindTexture(GL_TEXTURE_2D, scaleFBO->getAttachment());
+    dataFBO->bind();
+    GLCommandBuffer::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *) nullptr);
+    dataFBO->unbind();
+    quantShader_->unbind(true);
+    array_->unbind();
+}
+
+
+/**
+ * @brief Append preprocessor definitions for shaders that read from a quantized cache
+ *
+ * @param preproc Pointer to preprocessor string to append the definitions to
+ * @param maxChars Total capacity of the \p preproc buffer
+ *
+ * This defines \c QUANTIZED_KV as well as the texture units that the scale textures for the keys
+ * and values are bound to, see \c shaders/sequence/kvcache.inc for the shader side.
+ */
+void KVQuantizer::dequantizationPreproc(char *preproc, size_t maxChars) {
+    char extra[128] = {0};
+    snprintf(extra, sizeof(extra) - 1, "#define QUANTIZED_KV\n#define KEY_SCALE_UNIT %d\n#define VALUE_SCALE_UNIT %d\n", KEY_SCALE_UNIT, VALUE_SCALE_UNIT);
+    strncat(preproc, extra, maxChars - strlen(preproc) - 1);
+}
+
+/*##################################################################################################
+#                               N O N -  P U B L I C  F U N C T I O N S                            #
+##################################################################################################*/
+
+
+/**
+ * @brief Compile GLSL shaders to perform operation on GPU
+ */
+void KVQuantizer::compileShaders() {
+    using namespace opengl;
+    scaleShader_ = ShaderRepository::compileShaderPair("shaders/sequence/kv_quantize.vert", "shaders/sequence/kv_quantize_scales.frag", nullptr, typeid(this), context());
+    quantShader_ = ShaderRepository::compileShaderPair("shaders/sequence/kv_quantize.vert", "shaders/sequence/kv_quantize.frag", nullptr, typeid(this), context());
+    for (auto * shader : {scaleShader_.get(), quantShader_.get()}) {
+        shader->bindAttributeLocation("attributes0", 0);
+        shader->link();
+        assert(shader->isLinked());
+        if (!GLInfo::hasBinding()) {
+            shader->bind();
+            shader->setUniformValue("inputLayer0", 0);
+            if (shader == quantShader_.get()) shader->setUniformValue("scaleData", 1);
+            shader->unbind();
+        }
+    }
+}
+
+
+} // fyusion::fyusenet::gpu::sequence::rudiments namespace
+
+// vim: set expandtab ts=4 sw=4:
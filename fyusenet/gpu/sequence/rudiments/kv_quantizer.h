@@ -0,0 +1,91 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Key/Value Cache Quantization (Header)                                       (c) Martin Wawro 2023
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <memory>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "../../../gl/gl_sys.h"
+#include "../../../gl/shaderprogram.h"
+#include "../../../gl/fbo.h"
+#include "../../../gl/vao.h"
+#include "../../../gl/vbo.h"
+#include "../../../gl/ibo.h"
+
+class AttentionTest;
+
+//------------------------------------- Public Declarations ----------------------------------------
+
+namespace fyusion::fyusenet::gpu::sequence::rudiments {
+
+/**
+ * @brief Quantize keys or values into an 8-bit key/value cache
+ *
+ * This class converts a (floating-point) key or value tensor into signed 8-bit integers for
+ * storage in a key/value cache. Each head of each token is quantized symmetrically with its own
+ * scale:
+ *
+ * \f[ s = \frac{\max_i |x_i|}{127} \qquad q_i = \text{round} \left( \frac{x_i}{s} \right) \f]
+ *
+ * The quantized data has the same layout as the input tensor, i.e. one token per row and
+ * \c headDim/4 pixels per head. The scales are stored in a separate (floating-point) texture
+ * that has one row per token and stores the scales of 4 consecutive heads in a single pixel.
+ *
+ * The attention rudiments dequantize the data when they fetch the keys and values. For that, they
+ * have to be configured accordingly before their setup (see for example
+ * DotProductSingle::quantizedCache()) and the scale textures have to be bound to the texture units
+ * #KEY_SCALE_UNIT and #VALUE_SCALE_UNIT before running them.
+ *
+ * @see CausalMultiHeadAttentionLayer
+ */
+class KVQuantizer : public GfxContextTracker {
+    friend class ::AttentionTest;
+ public:
+    constexpr static int KEY_SCALE_UNIT = 8;
+    constexpr static int VALUE_SCALE_UNIT = 9;
+
+    // ------------------------------------------------------------------------
+    // Constructor / Destructor
+    // ------------------------------------------------------------------------
+    KVQuantizer(int numKVHeads, int headDim, const GfxContextLink& ctx);
+    ~KVQuantizer() override;
+
+    // ------------------------------------------------------------------------
+    // Public methods
+    // ------------------------------------------------------------------------
+    void setup();
+    void forward(GLuint srcTexture, int numTokens, int targetRow, opengl::FBO *dataFBO, opengl::FBO *scaleFBO);
+    static void dequantizationPreproc(char *preproc, size_t maxChars);
+
+ private:
+    // ------------------------------------------------------------------------
+    // Non-public methods
+    // ------------------------------------------------------------------------
+    void compileShaders();
+
+    // ------------------------------------------------------------------------
+    // Member variables
+    // ------------------------------------------------------------------------
+    int numKVHeads_ = 0;                      //!< Number of key/value heads
+    int headDim_ = 0;                         //!< Dimension of a single head
+    std::unique_ptr<opengl::VAO> array_;      //!< Vertex array for proxy geometry
+    std::unique_ptr<opengl::VBO> vertices_;   //!< Vertex buffer for proxy geometry
+    std::unique_ptr<opengl::IBO> indices_;    //!< Index buffer for proxy geometry
+    opengl::programptr scaleShader_;          //!< Shader that computes the quantization scale per token and head
+    opengl::programptr quantShader_;          //!< Shader that quantizes the data using the scales
+};
+
+} // fyusion::fyusenet::gpu::sequence::rudiments namespace
+
+// vim: set expandtab ts=4 sw=4:
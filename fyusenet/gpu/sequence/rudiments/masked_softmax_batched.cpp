@@ -94,17 +94,17 @@ void MaskedSoftMaxBatched::setup(uint32_t texturePoolScope) {
  * @pre \c GL_SCISSOR_TEST is enabled
  */
 void MaskedSoftMaxBatched::forward(GLuint srcTexture, int tokenIndex, int numTokens, int keyLength, int batchSize, opengl::FBO *targetFBO) {
-    glEnable(GL_BLEND);
-    glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-    glBlendFuncSeparate(GL_ONE,GL_ONE, GL_ONE,GL_ONE);
+    opengl::GLStateCache::enable(GL_BLEND);
+    opengl::GLStateCache::blendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+    opengl::GLStateCache::blendFuncSeparate(GL_ONE,GL_ONE, GL_ONE,GL_ONE);
     int numinstances = 1 + keyLength / innerBatchSize_;
     int vpheight = numTokens * batchSize;
-    glViewport(0, 0, 1, vpheight);
-    glScissor(0, 0, 1, vpheight);
+    opengl::GLStateCache::viewport(0, 0, 1, vpheight);
+    opengl::GLCommandBuffer::scissor(0, 0, 1, vpheight);
     // ---------------------------------------------------------------
     // Pass 1: compute denominator with implied masking..
     // ---------------------------------------------------------------
-    glLineWidth(1.0f);
+    opengl::GLCommandBuffer::lineWidth(1.0f);
     pass1Array_->bind();
     pass1Shader_->bind();
     pass1Shader_->setUniformVec2("viewport", 1.0f, (float)vpheight);
@@ -112,34 +112,34 @@ void MaskedSoftMaxBatched::forward(GLuint srcTexture, int tokenIndex, int numTok
     pass1Shader_->setUniformValue("baseTokenIdx", tokenIndex);
     pass1FBO_->bind();
     pass1FBO_->setWriteMask();
-    glClear(GL_COLOR_BUFFER_BIT);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, srcTexture);
-    glDrawArraysInstanced(GL_LINES, 0, batchSize*2, numinstances);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, srcTexture);
+    opengl::GLCommandBuffer::drawArraysInstanced(GL_LINES, 0, batchSize*2, numinstances);
     pass1FBO_->unbind();
     pass1Shader_->unbind(true);
     pass1Array_->unbind();
     // ---------------------------------------------------------------
     // Pass 2: compute (masked) softmax...
     // ---------------------------------------------------------------
-    glDisable(GL_BLEND);
+    opengl::GLStateCache::disable(GL_BLEND);
     int vpwidth = keyLength;
-    glViewport(0, 0, vpwidth, vpheight);
-    glScissor(0, 0, vpwidth, vpheight);
+    opengl::GLStateCache::viewport(0, 0, vpwidth, vpheight);
+    opengl::GLCommandBuffer::scissor(0, 0, vpwidth, vpheight);
     targetFBO->bind();
-    glClear(GL_COLOR_BUFFER_BIT);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
     pass2Array_->bind();
     pass2Shader_->bind();
     pass2Shader_->setUniformVec4("viewport", (float) vpwidth, (float) vpheight, 1.0f, (float)maxBatch_ / (float)batchSize);
     pass2Shader_->setUniformVec2("inputParams", keyLength, numTokens);
     pass2Shader_->setUniformValue("baseTokenIdx", (int)tokenIndex, true);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, pass1FBO_->getAttachment());
-    glDrawElements(GL_TRIANGLES, batchSize * 6, GL_UNSIGNED_SHORT, (const GLvoid *) nullptr);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE1);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, pass1FBO_->getAttachment());
+    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES, batchSize * 6, GL_UNSIGNED_SHORT, (const GLvoid *) nullptr);
     pass2Shader_->unbind();
     pass2Array_->unbind();
     targetFBO->unbind();
-    glEnable(GL_BLEND);
+    opengl::GLStateCache::enable(GL_BLEND);
 }
 
 /*##################################################################################################
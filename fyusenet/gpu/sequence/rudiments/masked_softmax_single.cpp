@@ -90,16 +90,16 @@ void MaskedSoftMaxSingle::setup(uint32_t texturePoolScope) {
 void MaskedSoftMaxSingle::forward(GLuint srcTexture, int tokenIndex, int keyLength, opengl::FBO *targetFBO) {
     int instances = 1 + tokenIndex / innerBatchSize_;
     int vpheight = (numHeads_ + LayerBase::PIXEL_PACKING - 1) / PIXEL_PACKING;
-    glEnable(GL_BLEND);
-    glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-    glBlendFuncSeparate(GL_ONE,GL_ONE, GL_ONE,GL_ONE);
-    glLineWidth(1.0f);
+    opengl::GLStateCache::enable(GL_BLEND);
+    opengl::GLStateCache::blendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+    opengl::GLStateCache::blendFuncSeparate(GL_ONE,GL_ONE, GL_ONE,GL_ONE);
+    opengl::GLCommandBuffer::lineWidth(1.0f);
     // ------------------------------------------------
     // Pass 1: compute (masked) denominators for the
     //         softmax computation...
     // ------------------------------------------------
-    glViewport(0, 0, 1, vpheight);
-    glScissor(0, 0, 1, vpheight);
+    opengl::GLStateCache::viewport(0, 0, 1, vpheight);
+    opengl::GLCommandBuffer::scissor(0, 0, 1, vpheight);
     pass1Array_->bind();
     pass1Shader_->bind();
     pass1Shader_->setUniformVec2("viewport", 1.0f, (float)vpheight);
@@ -107,28 +107,28 @@ void MaskedSoftMaxSingle::forward(GLuint srcTexture, int tokenIndex, int keyLeng
     pass1Shader_->setUniformValue("keyLength", keyLength);
     pass1FBO_->bind();
     pass1FBO_->setWriteMask();
-    glClear(GL_COLOR_BUFFER_BIT);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, srcTexture);
-    glDrawArraysInstanced(GL_LINES, 0, 2, instances);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, srcTexture);
+    opengl::GLCommandBuffer::drawArraysInstanced(GL_LINES, 0, 2, instances);
     pass1FBO_->unbind();
     pass1Shader_->unbind(true);
     pass1Array_->unbind();
     // ------------------------------------------------
     // Pass 2: actual (masked) softmax computation...
     // ------------------------------------------------
-    glDisable(GL_BLEND);
-    glViewport(0, 0, keyLength, vpheight);
-    glScissor(0, 0, keyLength, vpheight);
+    opengl::GLStateCache::disable(GL_BLEND);
+    opengl::GLStateCache::viewport(0, 0, keyLength, vpheight);
+    opengl::GLCommandBuffer::scissor(0, 0, keyLength, vpheight);
     pass2Array_->bind();
     pass2Shader_->bind();
     pass2Shader_->setUniformVec2("viewport", (float)keyLength, (float)vpheight);
     pass2Shader_->setUniformValue("tokenIdx", tokenIndex);
     targetFBO->bind();
     targetFBO->setWriteMask();
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, pass1FBO_->getAttachment());
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *) nullptr);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE1);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, pass1FBO_->getAttachment());
+    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *) nullptr);
     targetFBO->unbind();
     pass2Shader_->unbind();
     pass2Array_->unbind();
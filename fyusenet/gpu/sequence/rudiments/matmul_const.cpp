@@ -9,6 +9,7 @@
 
 //--------------------------------------- System Headers -------------------------------------------
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 
@@ -76,7 +77,7 @@ MatMulConst::MatMulConst(const gpu::rudiments::PreambleGenerator& preamble,
  */
 MatMulConst::~MatMulConst() {
     GLuint tex[4] = {weightData_, scaleData_, zeroData_, biasData_};
-    glDeleteTextures(4, tex);
+    opengl::GLStateCache::deleteTextures(4, tex);
 }
 
 /**
@@ -112,25 +113,25 @@ void MatMulConst::setup() {
  */
 void MatMulConst::forward(int dataRows, int outputRowOffset, opengl::FBO *targetFBO) {
     CLEAR_GFXERR_DEBUG
-    glLineWidth(1.0f);
-    glEnable(GL_BLEND);
-    glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-    glBlendFuncSeparate(GL_ONE,GL_ONE, GL_ONE,GL_ONE);
+    opengl::GLCommandBuffer::lineWidth(1.0f);
+    opengl::GLStateCache::enable(GL_BLEND);
+    opengl::GLStateCache::blendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+    opengl::GLStateCache::blendFuncSeparate(GL_ONE,GL_ONE, GL_ONE,GL_ONE);
     array_->bind();
     if (isQuantized_) {
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, weightData_);
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, scaleData_);
-        glActiveTexture(GL_TEXTURE4);
-        glBindTexture(GL_TEXTURE_2D, zeroData_);
+        opengl::GLStateCache::activeTexture(GL_TEXTURE2);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, weightData_);
+        opengl::GLStateCache::activeTexture(GL_TEXTURE3);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, scaleData_);
+        opengl::GLStateCache::activeTexture(GL_TEXTURE4);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, zeroData_);
     }
     if (hasBias_) {
-        glActiveTexture(GL_TEXTURE5);
-        glBindTexture(GL_TEXTURE_2D, biasData_);
+        opengl::GLStateCache::activeTexture(GL_TEXTURE5);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, biasData_);
     }
-    glViewport(0, outputRowOffset, outputWidth_, dataRows);
-    glScissor(0, outputRowOffset, outputWidth_, dataRows);
+    opengl::GLStateCache::viewport(0, outputRowOffset, outputWidth_, dataRows);
+    opengl::GLCommandBuffer::scissor(0, outputRowOffset, outputWidth_, dataRows);
     if (dataRows >= MATMUL_LONG_THRESHOLD) {
         weightMatMulLong4Bit(targetFBO, dataRows);
     } else {
@@ -185,6 +186,39 @@ void MatMulConst::customShaderPostproc(const std::function<void(opengl::ShaderPr
 }
 
 
+/**
+ * @brief Split the output of the multiplication into multiple tensors
+ *
+ * @param outputs Number of output tensors to split the columns of the weight matrix into
+ *
+ * @throws FynException if the number of outputs cannot be supported
+ *
+ * This splits the columns of the weight matrix into \p outputs blocks of equal size and writes
+ * each block to a separate color attachment of the target FBO, i.e. the first block goes to
+ * \c GL_COLOR_ATTACHMENT0, the second one to \c GL_COLOR_ATTACHMENT1 and so on. The output width
+ * of this operation is reduced accordingly. This is useful to compute several projections of the
+ * same input with a single (concatenated) weight matrix. For short sequences, all outputs are
+ * computed in the same pass, which fetches the input only once. For long sequences, the weights
+ * are unpacked in the vertex shader and the varying budget does not allow for more than one
+ * output per pass, in that case this class renders each output in a separate pass with the draw
+ * buffers restricted to the respective color attachment.
+ *
+ * @pre This function must be called before setup() and the target FBO must have the appropriate
+ *      number of color attachments, all with the same size
+ *
+ * @note Multiple outputs cannot be combined with biases or residuals
+ */
+void MatMulConst::multiOutput(int outputs) {
+    if ((outputs < 1) || (outputs > std::min(MAX_OUTPUTS, opengl::GLInfo::getMaximumDrawBuffers()))) {
+        THROW_EXCEPTION_ARGS(FynException, "Unsupported number of outputs (%d)", outputs);
+    }
+    if (columns_ % (outputs * PIXEL_PACKING)) THROW_EXCEPTION_ARGS(FynException, "Number of columns (%d) must be a multiple of %d", columns_, outputs * PIXEL_PACKING);
+    if ((outputs > 1) && ((hasBias_) || (inResidual_) || (outResidual_))) THROW_EXCEPTION_ARGS(FynException, "Multiple outputs are not supported with bias or residual");
+    numOutputs_ = outputs;
+    outputWidth_ = (columns_ / outputs) / PIXEL_PACKING;
+}
+
+
 
 /**
  * @brief Load matrix bias for this layer
@@ -214,7 +248,7 @@ void MatMulConst::loadBiases(const DataBlob & data) {
         auto * ptr = std::any_cast<const float *>(data.get());
         glGenTextures(1, &biasData_);
         assert(biasData_ != 0);
-        glBindTexture(GL_TEXTURE_2D, biasData_);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, biasData_);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -343,23 +377,37 @@ void MatMulConst::weightMatMulLong4Bit(opengl::FBO *target, int dataRows) {
     if (rows_ % MMUL_WEIGHTS_PER_PASS) THROW_EXCEPTION_ARGS(FynException, "Number of rows (%d) must be a multiple of %d", rows_, MMUL_WEIGHTS_PER_PASS);
     int instances = ((PIXEL_PACKING / weightLanes_) * rows_) / MMUL_WEIGHTS_PER_PASS;
     target->bind();
-    if (!outResidual_) glClear(GL_COLOR_BUFFER_BIT);
+    if (numOutputs_ > 1) target->setWriteMask();
+    if (!outResidual_) opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
     if ((hasBias_) || (inResidual_)) {
         shaderLongPrime_->bind();
         shaderLongPrime_->setUniformVec2("viewport", outputWidth_, dataRows);
         shaderLongPrime_->setUniformValue("quantGroupSize", quantGroupSize_);
-        glDrawArrays(GL_LINES, 0, outputWidth_ * 2);
+        opengl::GLCommandBuffer::drawArrays(GL_LINES, 0, outputWidth_ * 2);
         shaderLongPrime_->unbind(true);
         instances -= 1;
-        glActiveTexture(GL_TEXTURE0 + BIAS_UNIT);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glActiveTexture(GL_TEXTURE0 + RESIDUAL_UNIT);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        opengl::GLStateCache::activeTexture(GL_TEXTURE0 + BIAS_UNIT);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, 0);
+        opengl::GLStateCache::activeTexture(GL_TEXTURE0 + RESIDUAL_UNIT);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, 0);
     }
     shaderLong_->bind();
     shaderLong_->setUniformVec2("viewport", outputWidth_, dataRows);
     shaderLong_->setUniformValue("quantGroupSize", quantGroupSize_);
-    glDrawArraysInstanced(GL_LINES, 0, outputWidth_ * 2, instances);
+    if (numOutputs_ > 1) {
+        // one pass per output, with only the respective color attachment being written to
+        GLenum buffers[MAX_OUTPUTS] = {GL_NONE};
+        for (int out=0; out < numOutputs_; out++) {
+            buffers[out] = GL_COLOR_ATTACHMENT0 + out;
+            opengl::GLCommandBuffer::drawBuffers(out + 1, buffers);
+            shaderLong_->setUniformValue("columnOffset", out * (columns_ / numOutputs_));
+            opengl::GLCommandBuffer::drawArraysInstanced(GL_LINES, 0, outputWidth_ * 2, instances);
+            buffers[out] = GL_NONE;
+        }
+        target->setWriteMask();
+    } else {
+        opengl::GLCommandBuffer::drawArraysInstanced(GL_LINES, 0, outputWidth_ * 2, instances);
+    }
     target->unbind();
     shaderLong_->unbind();
 }
@@ -380,23 +428,24 @@ void MatMulConst::weightMatMulShort4Bit(opengl::FBO *target, int dataRows) {
     if (rows_ % div) THROW_EXCEPTION_ARGS(FynException, "Number of rows (%d) must be a multiple of %d", rows_, div);
     int instances = rows_  / div;
     target->bind();
-    if (!outResidual_) glClear(GL_COLOR_BUFFER_BIT);
+    if (numOutputs_ > 1) target->setWriteMask();
+    if (!outResidual_) opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
     if ((hasBias_) || (inResidual_)) {
         shaderShortPrime_->bind();
         shaderShortPrime_->setUniformVec2("viewport", outputWidth_, dataRows);
         shaderShortPrime_->setUniformValue("quantGroupSize", quantGroupSize_);
-        glDrawArrays(GL_LINES, 0, dataRows * 2);
+        opengl::GLCommandBuffer::drawArrays(GL_LINES, 0, dataRows * 2);
         shaderShortPrime_->unbind(true);
         instances -= 1;
-        glActiveTexture(GL_TEXTURE0 + BIAS_UNIT);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glActiveTexture(GL_TEXTURE0 + RESIDUAL_UNIT);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        opengl::GLStateCache::activeTexture(GL_TEXTURE0 + BIAS_UNIT);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, 0);
+        opengl::GLStateCache::activeTexture(GL_TEXTURE0 + RESIDUAL_UNIT);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, 0);
     }
     shaderShort_->bind();
     shaderShort_->setUniformVec2("viewport", outputWidth_, dataRows);
     shaderShort_->setUniformValue("quantGroupSize", quantGroupSize_);
-    glDrawArraysInstanced(GL_LINES, 0, dataRows * 2, instances);
+    opengl::GLCommandBuffer::drawArraysInstanced(GL_LINES, 0, dataRows * 2, instances);
     target->unbind();
     shaderShort_->unbind();
 }
@@ -413,6 +462,10 @@ void MatMulConst::compileShaders() {
     const char * shortvert = (customShaders_[VERT_SHORT]) ? customShaders_[VERT_SHORT] : "shaders/sequence/seq_matmul_4bit_short.vert";
     const char * shortfrag = (customShaders_[FRAG_SHORT]) ? customShaders_[FRAG_SHORT] : "shaders/sequence/seq_matmul_4bit_short.frag";
     snprintf(preproc, sizeof(preproc) - 1,"#define MATRIX_WEIGHTS %d\n#define MATRIX_PACKS %d\n#define INSTANCE_OFFSET %d\n", MMUL_WEIGHTS_PER_PASS / PIXEL_PACKING, smallMWPacks_, (isprimed) ? 1 : 0);
+    if (numOutputs_ > 1) {
+        size_t len = strlen(preproc);
+        snprintf(preproc + len, sizeof(preproc) - len - 1, "#define NUM_OUTPUTS %d\n#define OUTPUT_COLUMNS %d\n", numOutputs_, columns_ / numOutputs_);
+    }
     if (customShaderPreproc_) customShaderPreproc_(preproc, sizeof(preproc) - strlen(preproc) - 1, shtype::ANY_SHORT);
     preamble_.generatePreprocessorPreamble(preproc, sizeof(preproc) - strlen(preproc)-1, LayerFlags::RESIDUAL_INPUT);
     shaderShort_ = ShaderRepository::compileShaderPair(shortvert, shortfrag,preproc, typeid(this), context());
@@ -423,6 +476,7 @@ void MatMulConst::compileShaders() {
         snprintf(preproc, sizeof(preproc) - 1, "#define MATRIX_WEIGHTS %d\n#define MATRIX_PACKS %d\n", MMUL_WEIGHTS_PER_PASS / PIXEL_PACKING, smallMWPacks_);
         if (hasBias_) strncat(preproc, "#define USE_BIAS\n", sizeof(preproc)-1);
         if (inResidual_) strncat(preproc, "#define USE_RESIDUAL\n", sizeof(preproc)-1);
+        if (customShaderPreproc_) customShaderPreproc_(preproc, sizeof(preproc) - strlen(preproc) - 1, shtype::ANY_SHORT);
         preamble_.generatePreprocessorPreamble(preproc, sizeof(preproc) - strlen(preproc)-1, LayerFlags::RESIDUAL_INPUT);
         shaderShortPrime_ = ShaderRepository::compileShaderPair(shortvert, shortfrag, preproc, typeid(this), context());
         shaderShortPrime_->bindAttributeLocation("attributes0", 0);
@@ -440,6 +494,10 @@ void MatMulConst::compileShaders() {
     const char * longfrag = (customShaders_[FRAG_LONG]) ? customShaders_[FRAG_LONG] : "shaders/sequence/seq_matmul_4bit_long_half.frag";
 #endif
     snprintf(preproc, sizeof(preproc) - 1, "#define MATRIX_WEIGHTS %d\n#define NUM_LANES %d\n#define INSTANCE_OFFSET %d\n", MMUL_WEIGHTS_PER_PASS / PIXEL_PACKING, weightLanes_, (isprimed) ? 1: 0);
+    if (numOutputs_ > 1) {
+        size_t len = strlen(preproc);
+        snprintf(preproc + len, sizeof(preproc) - len - 1, "#define NUM_OUTPUTS %d\n", numOutputs_);
+    }
     if (customShaderPreproc_) customShaderPreproc_(preproc, sizeof(preproc) - strlen(preproc) - 1, ANY_LONG);
     preamble_.generatePreprocessorPreamble(preproc, sizeof(preproc) - strlen(preproc)-1, LayerFlags::RESIDUAL_INPUT);
     shaderLong_ = ShaderRepository::compileShaderPair(longvert, longfrag,preproc, typeid(this), context());
@@ -449,6 +507,7 @@ void MatMulConst::compileShaders() {
         snprintf(preproc, sizeof(preproc) - 1, "#define MATRIX_WEIGHTS %d\n#define NUM_LANES %d\n", MMUL_WEIGHTS_PER_PASS / PIXEL_PACKING, weightLanes_);
         if (hasBias_) strncat(preproc, "#define USE_BIAS\n", sizeof(preproc)-1);
         if (inResidual_) strncat(preproc, "#define USE_RESIDUAL\n", sizeof(preproc)-1);
+        if (customShaderPreproc_) customShaderPreproc_(preproc, sizeof(preproc) - strlen(preproc) - 1, ANY_LONG);
         preamble_.generatePreprocessorPreamble(preproc, sizeof(preproc) - strlen(preproc)-1, LayerFlags::RESIDUAL_INPUT);
         shaderLongPrime_ = ShaderRepository::compileShaderPair(longvert, longfrag, preproc, typeid(this), context());
         shaderLongPrime_->bindAttributeLocation("attributes0", 0);
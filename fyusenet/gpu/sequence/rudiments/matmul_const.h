@@ -66,6 +66,11 @@ namespace fyusion::fyusenet::gpu::sequence::rudiments {
  * of the multiplication into the existing residual. Which one of those options (yielding the
  * same results) is used, depends on the underlying use-case.
  *
+ * Last but not least, this class can split the columns of the weight matrix into a set of equally
+ * sized blocks that are written to different color attachments of the target FBO (see
+ * multiOutput()). This allows to compute several projections of the same input, for example
+ * the query, key and value projections of an attention layer, using a single weight matrix.
+ *
  * \include{doc} seq_matmul_appendix.inc
  *
  * @warning The current implementation only handles 4-bit quantized data as of now.
@@ -99,6 +104,7 @@ class MatMulConst : public GfxContextTracker {
     constexpr static int INPUT1_UNIT = 1;
     constexpr static int BIAS_UNIT = 5;
     constexpr static int RESIDUAL_UNIT = 6;
+    constexpr static int MAX_OUTPUTS = 4;
 
     // ------------------------------------------------------------------------
     // Constructor / Destructor
@@ -116,6 +122,7 @@ class MatMulConst : public GfxContextTracker {
     void customShader(shtype shaderType, const char * resource);
     void customShaderPreproc(const std::function<void(char *, size_t, shtype)> & preprocFunc);
     void customShaderPostproc(const std::function<void(opengl::ShaderProgram *, shtype)>& postFunc);
+    void multiOutput(int outputs);
     void setup();
     void forward(int dataRows, int outputRowOffset, opengl::FBO *targetFBO);
     void loadWeights(const DataBlob & weights);
@@ -155,6 +162,7 @@ class MatMulConst : public GfxContextTracker {
     GLuint biasData_ = 0;                     //!< OpenGL texture handle for the bias vector
     int quantGroupSize_ = 0;                  //!< For quantized weight matrices, defines the quantization group size
     int smallMWPacks_ = 1;                    //!< Number of internal matrix-weight packs to be used for short matrix multiplications
+    int numOutputs_ = 1;                      //!< Number of output tensors (color attachments) the columns are split into
 
     /**
      * Optional override for shader preparation (post compilation / link)
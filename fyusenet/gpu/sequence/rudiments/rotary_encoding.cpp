@@ -59,25 +59,27 @@ void RotaryEncoder::setup() {
  * @param numTokens Number of tokens to compute the encoding for
  * @param targetRow Row offset to write the results into the target FBO
  * @param targetFBO FBO that takes the results
+ * @param sourceRow Row offset to read the input tokens from in the \p srcTexture
  *
  * @pre \c GL_SCISSOR_TEST is enabled
  */
-void RotaryEncoder::forward(GLuint srcTexture, int tokenIndex, int numTokens, int targetRow, opengl::FBO *targetFBO) {
-    glDisable(GL_BLEND);
-    glViewport(0, targetRow, width_, numTokens);
-    glScissor(0, targetRow, width_, numTokens);
+void RotaryEncoder::forward(GLuint srcTexture, int tokenIndex, int numTokens, int targetRow, opengl::FBO *targetFBO, int sourceRow) {
+    opengl::GLStateCache::disable(GL_BLEND);
+    opengl::GLStateCache::viewport(0, targetRow, width_, numTokens);
+    opengl::GLCommandBuffer::scissor(0, targetRow, width_, numTokens);
     peArray_->bind();
     posEncShader_->bind();
     posEncShader_->setUniformValue("tokenIdx", tokenIndex);
+    posEncShader_->setUniformValue("srcRow", sourceRow);
     posEncShader_->setUniformVec2("viewport", width_, numTokens);
     posEncShader_->setUniformVec2("headDim", headDim_ / LayerBase::PIXEL_PACKING, headDim_);
     posEncShader_->setUniformValue("thetaBase", thetaBase_);
     targetFBO->bind();
     targetFBO->setWriteMask();
-    glClear(GL_COLOR_BUFFER_BIT);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, srcTexture);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *) nullptr);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, srcTexture);
+    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *) nullptr);
     // TODO (mw) use lines for single queries
     targetFBO->unbind();
     posEncShader_->unbind(true);
@@ -77,7 +77,7 @@ class RotaryEncoder : public GfxContextTracker {
     // Public methods
     // ------------------------------------------------------------------------
     void setup();
-    void forward(GLuint srcTexture, int tokenIndex, int numTokens, int targetRow, opengl::FBO *targetFBO);
+    void forward(GLuint srcTexture, int tokenIndex, int numTokens, int targetRow, opengl::FBO *targetFBO, int sourceRow=0);
 
  private:
     // ------------------------------------------------------------------------
@@ -0,0 +1,281 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Tiled Causal Attention w/ Online Softmax                                    (c) Martin Wawro 2023
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "tiled_attention.h"
+#include "kv_quantizer.h"
+#include "../../rudiments/proxygenerator.h"
+#include "../../../gl/shaderresource.h"
+#include "../../../gl/scoped_texturepool.h"
+#include "../../../gl/glinfo.h"
+#include "../../gpulayerbase.h"
+#include "../../../common/miscdefs.h"
+
+//-------------------------------------- Global Variables ------------------------------------------
+
+namespace fyusion::fyusenet::gpu::sequence::rudiments {
+
+//-------------------------------------- Local Definitions -----------------------------------------
+
+/*##################################################################################################
+#                                   P U B L I C  F U N C T I O N S                                 #
+##################################################################################################*/
+
+
+/**
+ * @brief Constructor
+ *
+ * @param numHeads Number of attention heads (must be divisible by 4)
+ * @param numKVHeads Number of key/value heads, each one is shared by \c numHeads / \c numKVHeads query heads
+ * @param headDim Dimension of a single attention head (must be divisible by 4)
+ * @param blockSize Number of keys to process in a single block
+ * @param maxSeq Maximum sequence length
+ * @param ctx GL context to work with
+ *
+ * The \p blockSize is reduced if the texture that holds the attention weights for a single block
+ * would exceed the maximum texture size.
+ */
+TiledAttention::TiledAttention(int numHeads, int numKVHeads, int headDim, int blockSize, int maxSeq, const GfxContextLink& ctx) :
+        GfxContextTracker(ctx), numHeads_(numHeads), numKVHeads_(numKVHeads), headDim_(headDim), blockSize_(blockSize), maxSeqLen_(maxSeq) {
+    assert((numHeads_ % LayerBase::PIXEL_PACKING) == 0);
+    assert((headDim_ % LayerBase::PIXEL_PACKING) == 0);
+    assert((numKVHeads_ > 0) && ((numHeads_ % numKVHeads_) == 0));
+    if (blockSize_ <= 0) THROW_EXCEPTION_ARGS(FynException, "Illegal block size %d supplied", blockSize);
+    int batches = numHeads_ / LayerBase::PIXEL_PACKING;
+    blockSize_ = std::min(blockSize_, opengl::GLInfo::getMaximumTextureSize() / batches);
+}
+
+
+/**
+ * @brief Destructor, releases GL resources
+ */
+TiledAttention::~TiledAttention() {
+    FNET_DEL_AND_CLEAR(statsFBOs_[0]);
+    FNET_DEL_AND_CLEAR(statsFBOs_[1]);
+    FNET_DEL_AND_CLEAR(probFBO_);
+    statsShader_.reset();
+    probShader_.reset();
+    accumShader_.reset();
+    for (int i=0; i < 2; i++) {
+        maxTextures_[i].reset();
+        sumTextures_[i].reset();
+    }
+    probTexture_.reset();
+}
+
+
+/**
+ * @brief Read keys and values from an 8-bit quantized cache
+ *
+ * Once set, forward() expects signed integer textures for the keys and values, which are
+ * dequantized when being fetched. The corresponding scale textures must be bound to the texture
+ * units KVQuantizer::KEY_SCALE_UNIT and KVQuantizer::VALUE_SCALE_UNIT prior to forward().
+ *
+ * @pre Must be called before setup()
+ */
+void TiledAttention::quantizedCache() {
+    quantizedCache_ = true;
+}
+
+
+/**
+ * @brief Setup GL resources
+ *
+ * @param texturePoolScope Scope ID of the texture pool to use
+ *
+ * This sets up internal GL resources, like proxy geometry and shaders. In addition, it requires
+ * internal buffer textures for the softmax statistics and the attention weights of a single key
+ * block. These textures may be taken from the texture pool if it is enabled and to avoid clashes
+ * with the owning layer, a scope has to be supplied that ensures that there is no double-use of
+ * the textures.
+ */
+void TiledAttention::setup(uint32_t texturePoolScope) {
+    using namespace opengl;
+    const auto [arr, verts, inds] = gpu::rudiments::ProxyGenerator::simpleQuad(context());
+    array_.reset(arr);
+    vertices_.reset(verts);
+    indices_.reset(inds);
+    compileShaders();
+    int batches = numHeads_ / LayerBase::PIXEL_PACKING;
+    auto * pool = context().texturePool();
+    for (int i=0; i < 2; i++) {
+        maxTextures_[i] = Texture2D(batches, maxSeqLen_, Texture::FLOAT32, 4, pool, texturePoolScope, false);
+        sumTextures_[i] = Texture2D(batches, maxSeqLen_, Texture::FLOAT32, 4, pool, texturePoolScope, false);
+        statsFBOs_[i] = new FBO(context(), maxTextures_[i]);
+        statsFBOs_[i]->addTexture(GL_COLOR_ATTACHMENT1, sumTextures_[i]);
+        statsFBOs_[i]->setWriteMask();
+        statsFBOs_[i]->unbind();
+    }
+    probTexture_ = Texture2D(batches * blockSize_, maxSeqLen_, GPULayerBase::TEXTURE_PIXTYPE, 4, pool, texturePoolScope, false);
+    probFBO_ = new FBO(context(), probTexture_);
+    probFBO_->unbind();
+}
+
+
+/**
+ * @brief Compute causally-masked attention
+ *
+ * @param queryTexture GL handle for the texture that contains the (position-encoded) queries
+ * @param keyTexture GL handle for the texture that contains the (position-encoded) keys
+ * @param valueTexture GL handle for the texture that contains the values
+ * @param tokenIndex Index of the first query token (used for masking)
+ * @param numTokens Number of query tokens to process
+ * @param keyLength Number of tokens in the key/value buffers
+ * @param targetFBO Pointer to target FBO to render the attention-weighted values to
+ *
+ * This function first streams over all key blocks to compute the maximum score and the sum
+ * of exponentials for each query token and head, ping-ponging between two sets of statistics
+ * textures. Afterwards it runs over the key blocks again, computes the attention weights for
+ * each block and accumulates the product of those weights with the values into the target.
+ * Query tokens that are fully masked for a key block (i.e. precede all keys in the block) are
+ * skipped in the second stage.
+ *
+ * @pre \c GL_SCISSOR_TEST is enabled
+ */
+void TiledAttention::forward(GLuint queryTexture, GLuint keyTexture, GLuint valueTexture, int tokenIndex, int numTokens, int keyLength, opengl::FBO *targetFBO) {
+    using namespace opengl;
+    assert(numTokens <= maxSeqLen_);
+    int batches = numHeads_ / LayerBase::PIXEL_PACKING;
+    int headpixels = headDim_ / LayerBase::PIXEL_PACKING;
+    int fullwidth = numHeads_ * headpixels;
+    int numblocks = (keyLength + blockSize_ - 1) / blockSize_;
+    float scaling = 1.0f / sqrtf((float)headDim_);
+    array_->bind();
+    GLStateCache::disable(GL_BLEND);
+    // ---------------------------------------------------------------
+    // Stage 1: running maximum and sum over all key blocks. All query
+    // rows are rendered in every pass, such that the final statistics
+    // always end up in the same ping-pong buffer...
+    // ---------------------------------------------------------------
+    GLStateCache::viewport(0, 0, batches, numTokens);
+    GLCommandBuffer::scissor(0, 0, batches, numTokens);
+    statsShader_->bind();
+    statsShader_->setUniformValue("scaling", scaling);
+    GLStateCache::activeTexture(GL_TEXTURE0 + QUERY_UNIT);
+    GLStateCache::bindTexture(GL_TEXTURE_2D, queryTexture);
+    GLStateCache::activeTexture(GL_TEXTURE0 + KEY_UNIT);
+    GLStateCache::bindTexture(GL_TEXTURE_2D, keyTexture);
+    for (int block=0; block < numblocks; block++) {
+        int src = (block + 1) & 1;
+        int first = block * blockSize_;
+        statsShader_->setUniformVec4("blockParams", headpixels, first, std::min(keyLength, first + blockSize_), tokenIndex);
+        statsShader_->setUniformValue("firstBlock", (block == 0) ? 1 : 0);
+        GLStateCache::activeTexture(GL_TEXTURE0 + MAX_UNIT);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, maxTextures_[src].getHandle());
+        GLStateCache::activeTexture(GL_TEXTURE0 + SUM_UNIT);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, sumTextures_[src].getHandle());
+        statsFBOs_[block & 1]->bind();
+        GLCommandBuffer::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *) nullptr);
+        statsFBOs_[block & 1]->unbind();
+    }
+    statsShader_->unbind(true);
+    int stats = (numblocks - 1) & 1;
+    // ---------------------------------------------------------------
+    // Stage 2: attention weights per key block and accumulation of
+    // the weighted values into the (cleared) target...
+    // ---------------------------------------------------------------
+    GLStateCache::viewport(0, 0, fullwidth, numTokens);
+    GLCommandBuffer::scissor(0, 0, fullwidth, numTokens);
+    targetFBO->bind();
+    GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
+    targetFBO->unbind();
+    GLStateCache::blendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+    GLStateCache::blendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
+    for (int block=0; block < numblocks; block++) {
+        int first = block * blockSize_;
+        int last = std::min(keyLength, first + blockSize_);
+        int startrow = std::max(0, first - tokenIndex);
+        if (startrow >= numTokens) break;
+        int rows = numTokens - startrow;
+        // attention weights for the block (causal masking inside)
+        GLStateCache::disable(GL_BLEND);
+        GLStateCache::viewport(0, startrow, batches * blockSize_, rows);
+        GLCommandBuffer::scissor(0, startrow, batches * blockSize_, rows);
+        probShader_->bind();
+        probShader_->setUniformValue("scaling", scaling);
+        probShader_->setUniformVec4("blockParams", headpixels, first, last, tokenIndex);
+        GLStateCache::activeTexture(GL_TEXTURE0 + QUERY_UNIT);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, queryTexture);
+        GLStateCache::activeTexture(GL_TEXTURE0 + KEY_UNIT);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, keyTexture);
+        GLStateCache::activeTexture(GL_TEXTURE0 + MAX_UNIT);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, maxTextures_[stats].getHandle());
+        GLStateCache::activeTexture(GL_TEXTURE0 + SUM_UNIT);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, sumTextures_[stats].getHandle());
+        probFBO_->bind();
+        GLCommandBuffer::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *) nullptr);
+        probFBO_->unbind();
+        probShader_->unbind(true);
+        // weighted values, added to the target
+        GLStateCache::enable(GL_BLEND);
+        GLStateCache::viewport(0, startrow, fullwidth, rows);
+        GLCommandBuffer::scissor(0, startrow, fullwidth, rows);
+        accumShader_->bind();
+        accumShader_->setUniformVec4("blockParams", headpixels, first, last, tokenIndex);
+        GLStateCache::activeTexture(GL_TEXTURE0);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, probTexture_.getHandle());
+        GLStateCache::activeTexture(GL_TEXTURE1);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, valueTexture);
+        targetFBO->bind();
+        GLCommandBuffer::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *) nullptr);
+        targetFBO->unbind();
+        accumShader_->unbind(true);
+    }
+    array_->unbind();
+}
+
+/*##################################################################################################
+#                               N O N -  P U B L I C  F U N C T I O N S                            #
+##################################################################################################*/
+
+
+/**
+ * @brief Compile GLSL shaders to perform operation on GPU
+ */
+void TiledAttention::compileShaders() {
+    using namespace opengl;
+    char preproc[256] = {0};
+    float fmax = std::numeric_limits<float>::max() - 1.0f;
+    snprintf(preproc, sizeof(preproc) - 1, "#define FLT_MAX %.10e\n#define BLOCK_SIZE %d\n#define KV_GROUP %d\n", fmax, blockSize_, numHeads_ / numKVHeads_);
+    if (quantizedCache_) KVQuantizer::dequantizationPreproc(preproc, sizeof(preproc));
+    statsShader_ = ShaderRepository::compileShaderPair("shaders/sequence/tiled_attention.vert", "shaders/sequence/tiled_attention_stats.frag", preproc, typeid(this), context());
+    probShader_ = ShaderRepository::compileShaderPair("shaders/sequence/tiled_attention.vert", "shaders/sequence/tiled_attention_probs.frag", preproc, typeid(this), context());
+    accumShader_ = ShaderRepository::compileShaderPair("shaders/sequence/tiled_attention.vert", "shaders/sequence/tiled_attention_accum.frag", preproc, typeid(this), context());
+    for (auto * shader : {statsShader_.get(), probShader_.get(), accumShader_.get()}) {
+        shader->bindAttributeLocation("attributes0", 0);
+        shader->link();
+        assert(shader->isLinked());
+        if (!GLInfo::hasBinding()) {
+            shader->bind();
+            shader->setUniformValue("inputLayer0", 0);
+            shader->setUniformValue("inputLayer1", 1);
+            if (shader != accumShader_.get()) {
+                shader->setUniformValue("maxData", MAX_UNIT);
+                shader->setUniformValue("sumData", SUM_UNIT);
+                if (quantizedCache_) shader->setUniformValue("keyScales", KVQuantizer::KEY_SCALE_UNIT);
+            } else if (quantizedCache_) {
+                shader->setUniformValue("valueScales", KVQuantizer::VALUE_SCALE_UNIT);
+            }
+            shader->unbind();
+        }
+    }
+}
+
+
+} // fyusion::fyusenet::gpu::sequence::rudiments namespace
+
+// vim: set expandtab ts=4 sw=4:
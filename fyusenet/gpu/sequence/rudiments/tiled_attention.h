@@ -0,0 +1,134 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Tiled Causal Attention w/ Online Softmax (Header)                           (c) Martin Wawro 2023
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <memory>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "../../../gl/gl_sys.h"
+#include "../../../gl/shaderprogram.h"
+#include "../../../gl/fbo.h"
+#include "../../../gl/vao.h"
+#include "../../../gl/vbo.h"
+#include "../../../gl/ibo.h"
+#include "../../../gl/texture.h"
+
+class AttentionTest;
+
+//------------------------------------- Public Declarations ----------------------------------------
+
+namespace fyusion::fyusenet::gpu::sequence::rudiments {
+
+/**
+ * @brief Causally-masked attention for multiple query tokens that streams over blocks of keys
+ *
+ * This class computes the complete (causally-masked) scaled dot-product attention
+ *
+ * \f[ \mathbf{O} = \text{softmax} \left( \frac{\mathbf{Q} \mathbf{K}^T}{\sqrt{d_k}} \right) \mathbf{V} \f]
+ *
+ * for all heads and a set of query tokens, without materializing the full matrix of attention
+ * scores. Instead, the key sequence is partitioned into blocks of a fixed size and the computation
+ * proceeds block by block:
+ *   1. For every query token and head, a running maximum \f$ m \f$ and a running sum of
+ *      exponentials \f$ l \f$ is maintained over all key blocks (online softmax). For each
+ *      new score \f$ s \f$, those are updated by \f$ m' = \max(m, s) \f$ and
+ *      \f$ l' = l e^{m-m'} + e^{s-m'} \f$.
+ *   2. With the final statistics at hand, the (normalized and masked) attention weights of a
+ *      single key block are computed into a small tile of only \e blockSize keys.
+ *   3. The product of that tile with the corresponding rows of the value matrix is blended
+ *      (added) into the output tensor.
+ *
+ * The memory requirements for the intermediate data are therefore linear in the sequence length,
+ * whereas the batched head-wise approach (DotProductBatched, MaskedSoftMaxBatched and
+ * AttentionMulBatched) requires a score texture that is quadratic in the maximum sequence length.
+ * In addition, subtracting the running maximum keeps the exponentials in range, which the
+ * batched softmax does not do.
+ *
+ * As fragment shaders do not have any shared memory that could hold intermediate results of a
+ * tile, the scores of a key block are computed twice: once for the statistics and once for the
+ * attention weights. Rescaling a running output accumulator per block instead would require
+ * ping-ponging a full-size output texture for every block, which is more expensive on the
+ * fragment/ROP pipeline than recomputing the (rather cheap) dot-products.
+ *
+ * The layout of the query, key and value tensors is the same as for the other attention rudiments,
+ * i.e. one token per row and \c headDim/4 pixels per head, with the heads being concatenated
+ * horizontally. Each fragment processes a batch of 4 heads at once, one head per color channel.
+ * The key and value tensors may have fewer heads than the query tensor (grouped-query attention),
+ * in which case consecutive query heads share the same key/value head. Keys and values may also
+ * be supplied as 8-bit quantized data (see quantizedCache()).
+ *
+ * @see CausalMultiHeadAttentionLayer
+ */
+class TiledAttention : public GfxContextTracker {
+    friend class ::AttentionTest;
+ public:
+    constexpr static int QUERY_UNIT = 0;
+    constexpr static int KEY_UNIT = 1;
+    constexpr static int MAX_UNIT = 2;
+    constexpr static int SUM_UNIT = 3;
+    constexpr static int DEFAULT_BLOCK_SIZE = 64;
+
+    // ------------------------------------------------------------------------
+    // Constructor / Destructor
+    // ------------------------------------------------------------------------
+    TiledAttention(int numHeads, int numKVHeads, int headDim, int blockSize, int maxSeq, const GfxContextLink& ctx);
+    ~TiledAttention() override;
+
+    // ------------------------------------------------------------------------
+    // Public methods
+    // ------------------------------------------------------------------------
+    void quantizedCache();
+    void setup(uint32_t texturePoolScope);
+    void forward(GLuint queryTexture, GLuint keyTexture, GLuint valueTexture, int tokenIndex, int numTokens, int keyLength, opengl::FBO *targetFBO);
+
+    /**
+     * @brief Retrieve number of keys that are processed in a single block
+     *
+     * @return Number of keys per block
+     */
+    [[nodiscard]] int blockSize() const {
+        return blockSize_;
+    }
+
+ private:
+    // ------------------------------------------------------------------------
+    // Non-public methods
+    // ------------------------------------------------------------------------
+    void compileShaders();
+
+    // ------------------------------------------------------------------------
+    // Member variables
+    // ------------------------------------------------------------------------
+    int numHeads_ = 0;                        //!< Number of attention heads
+    int numKVHeads_ = 0;                      //!< Number of (shared) key/value heads
+    int headDim_ = 0;                         //!< Dimension of a single attention head
+    int blockSize_ = DEFAULT_BLOCK_SIZE;      //!< Number of keys processed in a single block
+    int maxSeqLen_ = 0;                       //!< Maximum sequence length (determines texture heights)
+    bool quantizedCache_ = false;             //!< Indicator whether keys and values are read from an 8-bit quantized cache (see KVQuantizer)
+    std::unique_ptr<opengl::VAO> array_;      //!< Vertex array for proxy geometry
+    std::unique_ptr<opengl::VBO> vertices_;   //!< Vertex buffer for proxy geometry
+    std::unique_ptr<opengl::IBO> indices_;    //!< Index buffer for proxy geometry
+    opengl::programptr statsShader_;          //!< Shader that updates the running maximum / sum per key block
+    opengl::programptr probShader_;           //!< Shader that computes the attention weights for a key block
+    opengl::programptr accumShader_;          //!< Shader that multiplies the attention weights with the values
+    opengl::FBO * statsFBOs_[2] = {nullptr};  //!< Ping-pong FBOs for the softmax statistics (maximum and sum as two attachments)
+    opengl::FBO * probFBO_ = nullptr;         //!< FBO that wraps the attention weights of a single key block
+    opengl::Texture2D maxTextures_[2];        //!< Running maxima (one channel per head in a batch of 4 heads)
+    opengl::Texture2D sumTextures_[2];        //!< Running sums of exponentials (one channel per head in a batch of 4 heads)
+    opengl::Texture2D probTexture_;           //!< Attention weights for a single key block
+};
+
+} // fyusion::fyusenet::gpu::sequence::rudiments namespace
+
+// vim: set expandtab ts=4 sw=4:
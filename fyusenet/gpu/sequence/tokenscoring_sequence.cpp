@@ -148,15 +148,15 @@ void TokenScoringLayer::forward(uint64_t sequenceNo, StateToken * state) {
     if (!valid_) THROW_EXCEPTION_ARGS(FynException, "Trying to invoke forward() on invalid layer");
     if (!state) THROW_EXCEPTION_ARGS(FynException, "Trying to invoke forward() without token state");
     CLEAR_GFXERR_DEBUG
-    glDisable(GL_SCISSOR_TEST);
+    opengl::GLStateCache::disable(GL_SCISSOR_TEST);
     prepareRender(true, false, true);
     projectToken(state->seqLength - 1);
     flatten();
     scatter();
     selection();
     for (int i=0; i < (int)embeddingTextures_.size(); i++) {
-        glActiveTexture(GL_TEXTURE1+i);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        opengl::GLStateCache::activeTexture(GL_TEXTURE1+i);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, 0);
     }
 }
 
@@ -434,19 +434,19 @@ void TokenScoringLayer::projectToken(int token) {
     projectionFBO_->bind();
     proArray_->bind();
     int instances = (width_ + proInstanceWidth_ - 1)/ proInstanceWidth_;
-    glViewport(0, 0, projectionSize_[0], projectionSize_[1]);
-    glClear(GL_COLOR_BUFFER_BIT);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
+    opengl::GLStateCache::viewport(0, 0, projectionSize_[0], projectionSize_[1]);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(0));
     int ywindow = 0;
     proShader_->bind();
     proShader_->setUniformValue("token", token);
     for (size_t segment=0; segment < embeddingTextures_.size(); segment++) {
         proShader_->setUniformVec2("viewport", projectionSize_[0], projectionSegments_[segment]);
-        glViewport(0, ywindow, projectionSize_[0], projectionSegments_[segment]);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, embeddingTextures_[segment].getHandle());
-        glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *) nullptr, instances);
+        opengl::GLStateCache::viewport(0, ywindow, projectionSize_[0], projectionSegments_[segment]);
+        opengl::GLStateCache::activeTexture(GL_TEXTURE1);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, embeddingTextures_[segment].getHandle());
+        opengl::GLCommandBuffer::drawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const GLvoid *) nullptr, instances);
         ywindow += projectionSegments_[segment];
     }
     proShader_->unbind(true);
@@ -472,23 +472,23 @@ void TokenScoringLayer::projectToken(int token) {
 void TokenScoringLayer::flatten() {
     assert(pass1FlatArray_);
     CLEAR_GFXERR_DEBUG
-    glDisable(GL_BLEND);
+    opengl::GLStateCache::disable(GL_BLEND);
     // --------------------------------------------------------
     // Pass 1: perform some pre-aggregation and compute some
     // basic stats about the output distributions
     // --------------------------------------------------------
     flatFBOs_[0]->bind();
     flatFBOs_[0]->setWriteMask();
-    glViewport(0, 0, flatFBOs_[0]->width(), flatFBOs_[0]->height());
-    glClear(GL_COLOR_BUFFER_BIT);
+    opengl::GLStateCache::viewport(0, 0, flatFBOs_[0]->width(), flatFBOs_[0]->height());
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
     pass1FlatArray_->bind();
     pass1FlatShader_->bind();
     pass1FlatShader_->setUniformVec2("textSize", projectionSize_[0], projectionSize_[1]);
     pass1FlatShader_->setUniformVec2("shift", 0.5f/(float)flatFBOs_[0]->width(), 0.5f/(float)flatFBOs_[0]->height());
     pass1FlatShader_->setUniformVec2("contractionRange", flatSubsampling_[0], flatSubsampling_[1]);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, projectionTexture_.getHandle());
-    glDrawArrays(GL_POINTS, 0, flatFBOs_[0]->width() * flatFBOs_[0]->height());
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, projectionTexture_.getHandle());
+    opengl::GLCommandBuffer::drawArrays(GL_POINTS, 0, flatFBOs_[0]->width() * flatFBOs_[0]->height());
     pass1FlatShader_->unbind(true);
     flatFBOs_[0]->unbind();
     pass1FlatArray_->unbind();
@@ -500,14 +500,14 @@ void TokenScoringLayer::flatten() {
     flatFBOs_[1]->bind();
     pass2FlatShader_->bind();
     scatterArray_->bind();
-    glViewport(0, 0, 2, 1);
-    glClear(GL_COLOR_BUFFER_BIT);
+    opengl::GLStateCache::viewport(0, 0, 2, 1);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
     pass2FlatShader_->setUniformVec2("contractionRange", flatFBOs_[0]->width(), flatFBOs_[0]->height());
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, flatFBOs_[0]->getAttachment(GL_COLOR_ATTACHMENT0));
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, flatFBOs_[0]->getAttachment(GL_COLOR_ATTACHMENT1));
-    glDrawArrays(GL_POINTS, 0, 2);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, flatFBOs_[0]->getAttachment(GL_COLOR_ATTACHMENT0));
+    opengl::GLStateCache::activeTexture(GL_TEXTURE1);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, flatFBOs_[0]->getAttachment(GL_COLOR_ATTACHMENT1));
+    opengl::GLCommandBuffer::drawArrays(GL_POINTS, 0, 2);
     pass2FlatShader_->unbind(true);
     scatterArray_->unbind();
     flatFBOs_[1]->unbind();
@@ -538,30 +538,30 @@ void TokenScoringLayer::flatten() {
  * @see selection()
  */
 void TokenScoringLayer::scatter() {
-    glDisable(GL_BLEND);
+    opengl::GLStateCache::disable(GL_BLEND);
     CLEAR_GFXERR_DEBUG
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(GL_TRUE);
+    opengl::GLStateCache::enable(GL_DEPTH_TEST);
+    opengl::GLCommandBuffer::depthMask(GL_TRUE);
     assert(glGetError() == GL_NO_ERROR);
-    glDepthFunc(GL_LESS);
+    opengl::GLCommandBuffer::depthFunc(GL_LESS);
     assert(glGetError() == GL_NO_ERROR);
     scatterFBO_->bind();
     scatterFBO_->setWriteMask();
-    glViewport(0, 0, SCATTER_WIDTH, 2);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    opengl::GLStateCache::viewport(0, 0, SCATTER_WIDTH, 2);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     scatterArray_->bind();
     scatterShader_->bind();
     scatterShader_->setUniformVec2("projSize", projectionSize_[0], projectionSize_[1]);
     scatterShader_->setUniformVec2("scatterShift", 0.5f/(float)SCATTER_WIDTH, 0.5f/2.0f);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, projectionFBO_->getAttachment());
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, flatFBOs_[1]->getAttachment());
-    glDrawArraysInstanced(GL_POINTS, 0, tableRows_, 2);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, projectionFBO_->getAttachment());
+    opengl::GLStateCache::activeTexture(GL_TEXTURE1);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, flatFBOs_[1]->getAttachment());
+    opengl::GLCommandBuffer::drawArraysInstanced(GL_POINTS, 0, tableRows_, 2);
     scatterArray_->unbind();
     scatterFBO_->unbind();
     scatterShader_->unbind(true);
-    glDisable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
 }
 
 
@@ -577,18 +577,18 @@ void TokenScoringLayer::scatter() {
  */
 void TokenScoringLayer::selection() {
     framebuffers_.at(0)->bind();
-    glEnable(GL_SCISSOR_TEST);
-    glViewport(0, 0, 1, 1);
-    glScissor(0, 0, 1, 1);
-    glClear(GL_COLOR_BUFFER_BIT);
+    opengl::GLStateCache::enable(GL_SCISSOR_TEST);
+    opengl::GLStateCache::viewport(0, 0, 1, 1);
+    opengl::GLCommandBuffer::scissor(0, 0, 1, 1);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
     scatterArray_->bind();
     selectionShader_->bind();
     selectionShader_->setUniformValue("seed", 0, true);       // FIXME (mw) use something random here
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, scatterFBO_->getAttachment(GL_COLOR_ATTACHMENT0));
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, scatterFBO_->getAttachment(GL_COLOR_ATTACHMENT1));
-    glDrawArrays(GL_POINTS, 0, 1);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, scatterFBO_->getAttachment(GL_COLOR_ATTACHMENT0));
+    opengl::GLStateCache::activeTexture(GL_TEXTURE1);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, scatterFBO_->getAttachment(GL_COLOR_ATTACHMENT1));
+    opengl::GLCommandBuffer::drawArrays(GL_POINTS, 0, 1);
     framebuffers_.at(0)->unbind();
 #if 0   // multi-buffering extension
     // ---------------------------------------------------------------------
@@ -598,10 +598,10 @@ void TokenScoringLayer::selection() {
     // results..
     // ---------------------------------------------------------------------
     // bind other stuff
-    glDrawArrays(GL_POINTS, 0, 1);
+    opengl::GLCommandBuffer::drawArrays(GL_POINTS, 0, 1);
     // unbind other stuff
 #endif
-    glDisable(GL_SCISSOR_TEST);
+    opengl::GLStateCache::disable(GL_SCISSOR_TEST);
     selectionShader_->unbind();
     scatterArray_->unbind();
 }
@@ -0,0 +1,61 @@
+/* -------------------------------------------------------------------------------------------------
+ * Sparse Compaction Scatter Step
+ * Creator: Martin Wawro
+ * SPDX-License-Identifier: MIT
+ * ---------------------------------------------------------------------------------------------- */
+
+precision highp float;
+precision highp int;
+precision highp sampler2D;
+
+#ifdef BINDING_SUPPORT
+layout(binding=0) uniform sampler2D inputLayer0;
+#else
+uniform sampler2D inputLayer0;
+#endif
+
+in highp uint attributes0;
+
+flat out highp vec4 match;
+
+uniform highp ivec4 geometry;       // width, height, padding, number of horizontal tiles (deep input)
+uniform highp ivec2 slots;          // number of slots (horizontal, vertical)
+uniform highp int channelOffset;    // channel index of first channel in the input texture
+uniform highp float threshold;      // minimum score for a candidate
+uniform highp int countPass;        // non-zero if candidates are counted instead of scattered
+
+void main(void) {
+    int x = int(attributes0) % geometry.x;
+    int y = int(attributes0) / geometry.x;
+#ifdef ARGMAX_INPUT
+    vec4 data = texelFetch(inputLayer0, ivec2(x + geometry.z, y + geometry.z), 0);
+    float channel = data.r;
+    float score = data.g;
+#else
+    int chan = channelOffset + gl_InstanceID;
+#ifdef DEEP_INPUT
+    int tile = chan / 4;
+    ivec2 pos = ivec2(geometry.z + (tile % geometry.w) * (geometry.x + geometry.z) + x,
+                      geometry.z + (tile / geometry.w) * (geometry.y + geometry.z) + y);
+#else
+    ivec2 pos = ivec2(x + geometry.z, y + geometry.z);
+#endif
+    float score = texelFetch(inputLayer0, pos, 0)[chan % 4];
+    float channel = float(chan);
+#endif
+    if (score <= threshold) {
+        // move non-candidates outside of the clip volume
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        match = vec4(0.0);
+    } else if (countPass != 0) {
+        gl_Position = vec4(0.0, 0.0, 0.0, 1.0);
+        match = vec4(1.0, 0.0, 0.0, 0.0);
+    } else {
+        vec2 cell = vec2((x * slots.x) / geometry.x, (y * slots.y) / geometry.y);
+        // higher scores are closer to the viewer, depth-testing retains the maximum per slot
+        float depth = -score / (1.0 + abs(score));
+        gl_Position = vec4(((cell + 0.5) / vec2(slots)) * 2.0 - 1.0, depth, 1.0);
+        match = vec4(float(x), float(y), channel, score);
+    }
+    gl_PointSize = 1.0;
+}
@@ -16,7 +16,9 @@ precision highp sampler2D;
 
 #ifdef BINDING_SUPPORT
 layout(binding=0) uniform sampler2D inputLayer0;
+#ifndef INTERLEAVED_INPUT
 layout(binding=1) uniform sampler2D inputLayer1;
+#endif
 #ifdef USE_BIAS
 layout(binding=5) uniform sampler2D biasData;
 #endif
@@ -25,7 +27,9 @@ layout(binding=6) uniform sampler2D residual;
 #endif
 #else
 uniform sampler2D inputLayer0;
+#ifndef INTERLEAVED_INPUT
 uniform sampler2D inputLayer1;
+#endif
 #ifdef USE_BIAS
 uniform sampler2D biasData;
 #endif
@@ -49,18 +53,27 @@ const mat2x4 masks[2] = mat2x4[2](
 
 #include "shaders/activation.inc"
 
+// Interleaved input carries both operands in one texture, alternating on a per-pixel basis
+#ifdef INTERLEAVED_INPUT
+#define FETCH0(pos) texelFetch(inputLayer0, ivec2((pos).x * 2, (pos).y), 0)
+#define FETCH1(pos) texelFetch(inputLayer0, ivec2((pos).x * 2 + 1, (pos).y), 0)
+#else
+#define FETCH0(pos) texelFetch(inputLayer0, pos, 0)
+#define FETCH1(pos) texelFetch(inputLayer1, pos, 0)
+#endif
+
 vec4 fetch(in ivec2 pos) {
 #if (ACTIVATION_MASK & 3) == 0
-     vec4 src = texelFetch(inputLayer0, pos, 0) * texelFetch(inputLayer1, pos, 0);
+     vec4 src = FETCH0(pos) * FETCH1(pos);
 #endif
 #if (ACTIVATION_MASK & 3) == 1
-     vec4 src = activate(texelFetch(inputLayer0, pos, 0)) * texelFetch(inputLayer1, pos, 0);
+     vec4 src = activate(FETCH0(pos)) * FETCH1(pos);
 #endif
 #if (ACTIVATION_MASK & 3) == 2
-     vec4 src = texelFetch(inputLayer0, pos, 0) * activate(texelFetch(inputLayer1, pos, 0));
+     vec4 src = FETCH0(pos) * activate(FETCH1(pos));
 #endif
 #if (ACTIVATION_MASK & 3) == 3
-     vec4 src = activate(texelFetch(inputLayer0, pos, 0)) * activate(texelFetch(inputLayer1, pos, 0));
+     vec4 src = activate(FETCH0(pos)) * activate(FETCH1(pos));
 #endif
     return src; 
 }
@@ -16,6 +16,6 @@ void main(void) {
     // and stay in the floating-point world by casting back to an FP type
     fragmentColor0 = vec4(castTo(data));
 #else
-    return vec4(data);
+    fragmentColor0 = data;
 #endif
 }
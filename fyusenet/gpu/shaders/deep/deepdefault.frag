@@ -10,5 +10,4 @@
 
 void main(void) {
     fragmentColor0 = activate(texture(inputLayer0,texCoord.xy));
-    gl_PointSize = 1.0;
 }
@@ -0,0 +1,15 @@
+/* -------------------------------------------------------------------------------------------------
+ * Top-K Selection (Deep Tensors)
+ * Creator: Martin Wawro
+ * SPDX-License-Identifier: MIT
+ * ---------------------------------------------------------------------------------------------- */
+
+precision highp float;
+
+layout(location=0) out vec4 fragmentColor0;
+
+flat in highp vec4 result;
+
+void main(void) {
+    fragmentColor0 = result;
+}
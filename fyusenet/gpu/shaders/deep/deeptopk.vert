@@ -0,0 +1,65 @@
+/* -------------------------------------------------------------------------------------------------
+ * Top-K Selection (Deep Tensors)
+ * Creator: Martin Wawro
+ * SPDX-License-Identifier: MIT
+ * ---------------------------------------------------------------------------------------------- */
+
+precision highp float;
+precision highp int;
+precision highp sampler2D;
+
+#ifdef BINDING_SUPPORT
+layout(binding=0) uniform sampler2D inputLayer0;
+#else
+uniform sampler2D inputLayer0;
+#endif
+
+in highp uint attributes0;
+
+flat out highp vec4 result;
+
+uniform highp ivec4 geometry;       // channels, padding, number of horizontal tiles, K
+
+vec4 fetchTile(int tile) {
+    int stride = 1 + geometry.y;
+    return texelFetch(inputLayer0, ivec2(geometry.y + (tile % geometry.z) * stride, geometry.y + (tile / geometry.z) * stride), 0);
+}
+
+void main(void) {
+    int chan = int(attributes0);
+    int tiles = (geometry.x + 3) / 4;
+    float value = fetchTile(chan / 4)[chan % 4];
+    float maxval = value;
+    // rank of the element among all channels, ties are resolved by the channel index
+    int rank = 0;
+    for (int t=0; t < tiles; t++) {
+        vec4 data = fetchTile(t);
+        for (int c=0; c < 4; c++) {
+            int other = t * 4 + c;
+            if (other >= geometry.x) break;
+            if ((data[c] > value) || ((data[c] == value) && (other < chan))) rank++;
+            maxval = max(maxval, data[c]);
+        }
+    }
+    if (rank >= geometry.w) {
+        // move unselected elements outside of the clip volume
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        result = vec4(0.0);
+    } else {
+        float prob = 0.0;
+#ifdef SOFTMAX
+        float sum = 0.0;
+        for (int t=0; t < tiles; t++) {
+            vec4 data = fetchTile(t);
+            for (int c=0; c < 4; c++) {
+                if (t * 4 + c >= geometry.x) break;
+                sum += exp(data[c] - maxval);
+            }
+        }
+        prob = exp(value - maxval) / sum;
+#endif
+        gl_Position = vec4(((float(rank) + 0.5) / float(geometry.w)) * 2.0 - 1.0, 0.0, 0.0, 1.0);
+        result = vec4(float(chan), value, prob, 0.0);
+    }
+    gl_PointSize = 1.0;
+}
@@ -0,0 +1,50 @@
+/* ----------------------------------------------------------------------------
+ * Image Preprocessing Layer
+ * Creator: Martin Wawro
+ * SPDX-License-Identifier: MIT
+ * ------------------------------------------------------------------------- */
+
+precision mediump float;
+precision lowp int;
+precision mediump sampler2D;
+
+#ifdef BINDING_SUPPORT
+layout(binding=0) uniform sampler2D inputLayer0;
+#if NV12 != 0
+layout(binding=1) uniform sampler2D inputLayer1;
+#endif
+#else
+uniform sampler2D inputLayer0;
+#if NV12 != 0
+uniform sampler2D inputLayer1;
+#endif
+#endif
+
+// offset (xy) and extent (zw) of the sampled region in normalized texture coordinates
+uniform highp vec4 cropRect;
+uniform vec3 mean;
+uniform vec3 invStd;
+
+layout(location=0) out vec4 fragmentColor0;
+
+in highp vec2 texCoord;
+
+void main(void) {
+  highp vec2 tc = cropRect.xy + texCoord * cropRect.zw;
+#if NV12 != 0
+  // BT.601 limited range YUV -> RGB
+  float y = 1.164383 * (texture(inputLayer0, tc).r - 0.0627451);
+  vec2 uv = texture(inputLayer1, tc).rg - vec2(0.5);
+  vec3 rgb = clamp(vec3(y + 1.596027 * uv.y,
+                        y - 0.391762 * uv.x - 0.812968 * uv.y,
+                        y + 2.017232 * uv.x), 0.0, 1.0);
+#else
+  vec3 rgb = texture(inputLayer0, tc).rgb;
+#endif
+  vec3 result = (rgb - mean) * invStd;
+#if SWAP_RB != 0
+  fragmentColor0 = vec4(result.bgr, 0.0);
+#else
+  fragmentColor0 = vec4(result, 0.0);
+#endif
+}
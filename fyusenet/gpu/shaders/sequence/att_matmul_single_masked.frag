@@ -14,10 +14,22 @@ precision highp int;
 precision highp sampler2D;
 #endif
 
+#ifndef KV_GROUP
+#define KV_GROUP 1
+#endif
+
+#include "shaders/sequence/kvcache.inc"
+
 #ifdef BINDING_SUPPORT
-layout(binding=0) uniform sampler2D inputLayer0;
+layout(binding=0) uniform KV_SAMPLER inputLayer0;
+#ifdef QUANTIZED_KV
+layout(binding=VALUE_SCALE_UNIT) uniform highp sampler2D valueScales;
+#endif
 #else
-uniform sampler2D inputLayer0;
+uniform KV_SAMPLER inputLayer0;
+#ifdef QUANTIZED_KV
+uniform highp sampler2D valueScales;
+#endif
 #endif
 
 layout(location=0) out vec4 fragmentColor0;
@@ -28,10 +40,17 @@ flat in highp ivec2 weightData;        // x: #weights to use, y: row-offset in v
 
 void main(void) {
     highp int xpos = int(valPos);
+#if KV_GROUP > 1
+    // consecutive groups of KV_GROUP query heads share the same value head
+    xpos = ((xpos / HEAD_PIXELS) / KV_GROUP) * HEAD_PIXELS + (xpos % HEAD_PIXELS);
+#endif
     highp vec4 accu = vec4(0.0);
     for (int i=0,subscript=0; i < weightData.x; i++) {
         int j = i >> 2;
-        vec4 val = texelFetch(inputLayer0, ivec2(xpos, weightData.y + i), 0);
+        vec4 val = kvFetch(inputLayer0, ivec2(xpos, weightData.y + i));
+#ifdef QUANTIZED_KV
+        val *= kvScale(valueScales, xpos / HEAD_PIXELS, weightData.y + i);
+#endif
         accu += weights[j][subscript] * val;
         subscript = (subscript + 1) & 3;
     }
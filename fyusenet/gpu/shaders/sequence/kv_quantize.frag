@@ -0,0 +1,29 @@
+/* -------------------------------------------------------------------------------------------------
+ * Key/Value Cache Quantization - 8-bit Conversion                             (c) Martin Wawro 2023
+ * Creator: Martin Wawro
+ * SPDX-License-Identifier: MIT
+ * ---------------------------------------------------------------------------------------------- */
+
+precision highp float;
+precision highp int;
+precision highp sampler2D;
+
+#ifdef BINDING_SUPPORT
+layout(binding=0) uniform sampler2D inputLayer0;
+layout(binding=1) uniform sampler2D scaleData;
+#else
+uniform sampler2D inputLayer0;
+uniform sampler2D scaleData;
+#endif
+
+layout(location=0) out highp ivec4 fragmentColor0;
+
+uniform highp ivec4 quantParams;    // x: head-size (pixels), y: #heads, z: row offset of the target, w: unused
+
+void main(void) {
+    ivec2 pos = ivec2(gl_FragCoord.xy);                   // x: column in data, y: token (in target)
+    int head = pos.x / quantParams.x;
+    highp float scale = texelFetch(scaleData, ivec2(head / 4, pos.y), 0)[head % 4];
+    highp vec4 data = texelFetch(inputLayer0, ivec2(pos.x, pos.y - quantParams.z), 0);
+    fragmentColor0 = ivec4(clamp(round(data / scale), vec4(-127.0), vec4(127.0)));
+}
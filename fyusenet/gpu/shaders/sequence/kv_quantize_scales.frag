@@ -0,0 +1,39 @@
+/* -------------------------------------------------------------------------------------------------
+ * Key/Value Cache Quantization - Scales per Token and Head                    (c) Martin Wawro 2023
+ * Creator: Martin Wawro
+ * SPDX-License-Identifier: MIT
+ * ---------------------------------------------------------------------------------------------- */
+
+precision highp float;
+precision highp int;
+precision highp sampler2D;
+
+#ifdef BINDING_SUPPORT
+layout(binding=0) uniform sampler2D inputLayer0;
+#else
+uniform sampler2D inputLayer0;
+#endif
+
+layout(location=0) out highp vec4 fragmentColor0;
+
+uniform highp ivec4 quantParams;    // x: head-size (pixels), y: #heads, z: row offset of the target, w: unused
+
+void main(void) {
+    ivec2 pos = ivec2(gl_FragCoord.xy);                   // x: batch of 4 heads, y: token (in target)
+    int row = pos.y - quantParams.z;
+    highp vec4 absmax = vec4(0.0);
+    for (int h=0; h < 4; h++) {
+        int head = pos.x * 4 + h;
+        if (head < quantParams.y) {
+            ivec2 srcpos = ivec2(head * quantParams.x, row);
+            highp vec4 hmax = vec4(0.0);
+            for (int d=0; d < quantParams.x; d++) {
+                hmax = max(hmax, abs(texelFetch(inputLayer0, srcpos, 0)));
+                srcpos.x++;
+            }
+            absmax[h] = max(max(hmax.x, hmax.y), max(hmax.z, hmax.w));
+        }
+    }
+    // all-zero heads would end up with a zero scale otherwise
+    fragmentColor0 = max(absmax / 127.0, vec4(1.0e-10));
+}
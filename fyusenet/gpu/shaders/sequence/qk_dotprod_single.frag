@@ -12,12 +12,24 @@ precision highp sampler2D;
 precision mediump sampler2D;
 #endif
 
+#ifndef KV_GROUP
+#define KV_GROUP 1
+#endif
+
+#include "shaders/sequence/kvcache.inc"
+
 #ifdef BINDING_SUPPORT
 layout(binding=0) uniform sampler2D inputLayer0;
-layout(binding=1) uniform sampler2D inputLayer1;
+layout(binding=1) uniform KV_SAMPLER inputLayer1;
+#ifdef QUANTIZED_KV
+layout(binding=KEY_SCALE_UNIT) uniform highp sampler2D keyScales;
+#endif
 #else
 uniform sampler2D inputLayer0;
-uniform sampler2D inputLayer1;
+uniform KV_SAMPLER inputLayer1;
+#ifdef QUANTIZED_KV
+uniform highp sampler2D keyScales;
+#endif
 #endif
 
 layout(location=0) out vec4 fragmentColor0;
@@ -32,20 +44,25 @@ void main(void) {
     int headidx = int(keyHeadPos.y) * 4;
     int keyidx = int(keyHeadPos.x);
     ivec2 lhspos = ivec2(headidx * inputParams.x + innerBatch * INNER_BATCH_SIZE, 0);
-    ivec2 rhspos = ivec2(headidx * inputParams.x + innerBatch * INNER_BATCH_SIZE, keyidx);
+    // consecutive groups of KV_GROUP query heads share the same key head
+    ivec4 rhscols = ((ivec4(headidx) + ivec4(0, 1, 2, 3)) / KV_GROUP) * inputParams.x + innerBatch * INNER_BATCH_SIZE;
+    ivec2 rhspos = ivec2(0, keyidx);
     vec4 accu = vec4(0.0);
     for (int b=0; b < INNER_BATCH_SIZE; b++) {
         highp vec4 lhs0 = texelFetch(inputLayer0, lhspos, 0);
         highp vec4 lhs1 = texelFetch(inputLayer0, lhspos+ivec2(inputParams.x,0), 0);
         highp vec4 lhs2 = texelFetch(inputLayer0, lhspos+ivec2(2*inputParams.x,0), 0);
         highp vec4 lhs3 = texelFetch(inputLayer0, lhspos+ivec2(3*inputParams.x,0), 0);
-        highp vec4 rhs0 = texelFetch(inputLayer1, rhspos, 0);
-        highp vec4 rhs1 = texelFetch(inputLayer1, rhspos+ivec2(inputParams.x,0), 0);
-        highp vec4 rhs2 = texelFetch(inputLayer1, rhspos+ivec2(2*inputParams.x,0), 0);
-        highp vec4 rhs3 = texelFetch(inputLayer1, rhspos+ivec2(3*inputParams.x,0), 0);
+        highp vec4 rhs0 = kvFetch(inputLayer1, rhspos+ivec2(rhscols.x,0));
+        highp vec4 rhs1 = kvFetch(inputLayer1, rhspos+ivec2(rhscols.y,0));
+        highp vec4 rhs2 = kvFetch(inputLayer1, rhspos+ivec2(rhscols.z,0));
+        highp vec4 rhs3 = kvFetch(inputLayer1, rhspos+ivec2(rhscols.w,0));
         accu += vec4(dot(lhs0, rhs0), dot(lhs1, rhs1), dot(lhs2, rhs2), dot(lhs3, rhs3));
         lhspos.x++;
         rhspos.x++;
     }
+#ifdef QUANTIZED_KV
+    accu *= kvScales(keyScales, (ivec4(headidx) + ivec4(0, 1, 2, 3)) / KV_GROUP, keyidx);
+#endif
     fragmentColor0 = accu * scaling;
 }
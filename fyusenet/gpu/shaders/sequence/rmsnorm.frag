@@ -1,5 +1,5 @@
 /* -------------------------------------------------------------------------------------------------
- * RMSNormLayer for Sequence Layouts for single tokens                         (c) Martin Wawro 2023
+ * RMSNormLayer for Sequence Layouts (single pass)                             (c) Martin Wawro 2023
  * Creator: Martin Wawro
  * SPDX-License-Identifier: MIT
  * ---------------------------------------------------------------------------------------------- */
@@ -24,8 +24,7 @@ layout(location=0) out vec4 fragmentColor0;
 
 in highp vec2 texCoord;
 flat in highp float scale;
-
-uniform highp int row;
+flat in highp int row;
 
 void main(void) {
     vec4 val = texelFetch(inputLayer0, ivec2(texCoord.x, row), 0);
@@ -1,5 +1,5 @@
 /* -------------------------------------------------------------------------------------------------
- * RMSNormLayer for Sequence Layouts for single tokens                         (c) Martin Wawro 2023
+ * RMSNormLayer for Sequence Layouts (single pass)                             (c) Martin Wawro 2023
  * Creator: Martin Wawro
  * SPDX-License-Identifier: MIT
  * ---------------------------------------------------------------------------------------------- */
@@ -22,22 +22,26 @@ in highp vec2 attributes0;
 
 out highp vec2 texCoord;
 flat out highp float scale;
+flat out highp int row;
 
 uniform highp ivec2 embedWidth;         // x: pixels, y: elements
-uniform highp int row;
+uniform highp int rows;
 
+// One line instance per token (row), the provoking (2nd) vertex of each line computes the norm
+// of the row and passes it on to the fragment shader, no intermediate storage required
 void main(void) {
     float fuzz = (attributes0.y * 0.25) / float(embedWidth.x);
-    gl_Position = vec4((attributes0.yx + vec2(fuzz, 0.5)) * 2.0 - vec2(1.0), 0.0, 1.0);  // see "diamond-exit" rule in GL spec section 3.4.1
-    texCoord = vec2(embedWidth.x, 1) * attributes0.yx;
+    float ypos = (float(gl_InstanceID) + 0.5) / float(rows);
+    gl_Position = vec4(vec2(attributes0.y + fuzz, ypos) * 2.0 - vec2(1.0), 0.0, 1.0);  // see "diamond-exit" rule in GL spec section 3.4.1
+    texCoord = vec2(float(embedWidth.x) * attributes0.y, 0.0);
+    row = gl_InstanceID;
     highp vec4 accu = vec4(1.0);
     if (gl_VertexID == 1) {
         accu = vec4(0.0);
         for (int i=0; i < embedWidth.x; i++) {
-            vec4 val = texelFetch(inputLayer0, ivec2(i, row), 0);
+            vec4 val = texelFetch(inputLayer0, ivec2(i, gl_InstanceID), 0);
             accu += val * val;
         }
     }
     scale = inversesqrt(1.0e-6 + dot(accu, vec4(1.0)) / float(embedWidth.y));
 }
-
@@ -21,14 +21,15 @@ in highp vec2 inputPos;
 uniform highp float thetaBase;     // base value for computing theta as defined in the RoPE paper
 uniform highp ivec2 headDim;       // x: pixel head_dim, y: actual head_dim
 uniform highp int tokenIdx;        // token index
+uniform highp int srcRow;          // row offset in the input texture
 
 void main(void) {
     int head = int(inputPos.x) / headDim.x;
     int headoffset = int(inputPos.x) % headDim.x;
     int y = int(inputPos.y);
     int headbase = head * headDim.x;
-    ivec2 unrotated = ivec2(headbase + headoffset, y);
-    ivec2 rotated = ivec2(headbase + ((headoffset + headDim.x/2) % headDim.x), y);
+    ivec2 unrotated = ivec2(headbase + headoffset, y + srcRow);
+    ivec2 rotated = ivec2(headbase + ((headoffset + headDim.x/2) % headDim.x), y + srcRow);
     vec4 data = texelFetch(inputLayer0, unrotated, 0);
     vec4 datar = texelFetch(inputLayer0, rotated, 0);
     float sg = float(sign(headbase + headoffset - rotated.x));
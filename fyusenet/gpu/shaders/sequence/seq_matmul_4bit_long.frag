@@ -32,7 +32,20 @@ uniform sampler2D residual;
 #endif
 #endif
 
+#ifndef NUM_OUTPUTS
+#define NUM_OUTPUTS 1
+#endif
+
 layout(location=0) out vec4 fragmentColor0;
+#if NUM_OUTPUTS > 1
+layout(location=1) out vec4 fragmentColor1;
+#endif
+#if NUM_OUTPUTS > 2
+layout(location=2) out vec4 fragmentColor2;
+#endif
+#if NUM_OUTPUTS > 3
+layout(location=3) out vec4 fragmentColor3;
+#endif
 
 in highp vec2 inputPos;
 flat in highp int colOffset;
@@ -81,5 +94,15 @@ void main(void) {
 #endif
 #ifdef USE_BIAS
     fragmentColor0 += texelFetch(biasData, ivec2(inputPos.x, 0), 0);
+#endif
+    // only one of the outputs is enabled as draw buffer on multi-output runs
+#if NUM_OUTPUTS > 1
+    fragmentColor1 = fragmentColor0;
+#endif
+#if NUM_OUTPUTS > 2
+    fragmentColor2 = fragmentColor0;
+#endif
+#if NUM_OUTPUTS > 3
+    fragmentColor3 = fragmentColor0;
 #endif
 }
@@ -39,6 +39,7 @@ out highp vec2 inputPos;
 
 uniform ivec2 viewport;        // viewport
 uniform int quantGroupSize;    // quantization group size
+uniform int columnOffset;      // offset into the weight matrix columns (multi-output only)
 
 void unpackMatrix(in ivec2 pos,
                   out vec4 wgt0, out vec4 wgt1, out vec4 wgt2, out vec4 wgt3,
@@ -74,14 +75,14 @@ void main(void) {
     instanceMod = (gl_InstanceID + INSTANCE_OFFSET) % 4;
     colOffset = ((gl_InstanceID + INSTANCE_OFFSET) / 4) * MATRIX_WEIGHTS;
     // compute column/row position in quantized matrix
-    highp int weightcol = column*4 + instanceMod;                     // column in weight matrix, mtx itself is stored in CM order, so that actually is the y-coordinate of the texture
+    highp int weightcol = columnOffset + column*4 + instanceMod;                     // column in weight matrix, mtx itself is stored in CM order, so that actually is the y-coordinate of the texture
     highp int weightrow = ((gl_InstanceID + INSTANCE_OFFSET) / 4);    // row in weight matrix (compensated for packing), actually consistutes the x-coordinate of the texture (32x packing applied internally)
     inputPos = vec2(column, row);
 #endif
 #if NUM_LANES == 2
     instanceMod = (gl_InstanceID + INSTANCE_OFFSET) % 2;
     colOffset = ((gl_InstanceID + INSTANCE_OFFSET) / 2) * MATRIX_WEIGHTS;
-    highp int weightcol = column*4 + 2*instanceMod;
+    highp int weightcol = columnOffset + column*4 + 2*instanceMod;
     highp int weightrow = ((gl_InstanceID + INSTANCE_OFFSET) / 2);
     inputPos = vec2(column, row);
 #endif
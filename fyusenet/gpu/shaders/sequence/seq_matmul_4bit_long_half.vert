@@ -39,6 +39,7 @@ out highp vec2 inputPos;
 
 uniform ivec2 viewport;        // viewport
 uniform int quantGroupSize;    // quantization group size
+uniform int columnOffset;      // offset into the weight matrix columns (multi-output only)
 
 // the weight matrix is in column-major format, pos.x is the row, pos.y is the column
 void unpackMatrix(in ivec2 pos,
@@ -78,14 +79,14 @@ void main(void) {
 #if NUM_LANES == 2
     instanceMod = (gl_InstanceID + INSTANCE_OFFSET) % 2;
     colOffset = ((gl_InstanceID + INSTANCE_OFFSET) / 2) * MATRIX_WEIGHTS;
-    highp int weightcol = column*4 + 2*instanceMod;
+    highp int weightcol = columnOffset + column*4 + 2*instanceMod;
     highp int weightrow = (gl_InstanceID + INSTANCE_OFFSET) / 2;
     inputPos = vec2(column, row);
 #endif
 #if NUM_LANES == 4
     instanceMod = 0;
     colOffset = (gl_InstanceID + INSTANCE_OFFSET) * MATRIX_WEIGHTS;
-    highp int weightcol = column * 4;
+    highp int weightcol = columnOffset + column * 4;
     highp int weightrow = gl_InstanceID + INSTANCE_OFFSET;
     inputPos = vec2(column, row);
 #endif
@@ -6,6 +6,14 @@
 
 #define ZERO_WIDTH 8
 
+#ifndef NUM_OUTPUTS
+#define NUM_OUTPUTS 1
+#endif
+
+#ifndef OUTPUT_COLUMNS
+#define OUTPUT_COLUMNS 0
+#endif
+
 #ifndef HIGH_PRECISION
 precision mediump float;
 precision mediump int;
@@ -41,6 +49,15 @@ uniform sampler2D residual;
 #endif
 
 layout(location=0) out vec4 fragmentColor0;
+#if NUM_OUTPUTS > 1
+layout(location=1) out vec4 fragmentColor1;
+#endif
+#if NUM_OUTPUTS > 2
+layout(location=2) out vec4 fragmentColor2;
+#endif
+#if NUM_OUTPUTS > 3
+layout(location=3) out vec4 fragmentColor3;
+#endif
 
 in highp vec2 inputPos;
 flat in highp ivec2 colOffset;
@@ -73,28 +90,44 @@ void unpackMatrix(in ivec2 pos, out vec4 wgt[MATRIX_WEIGHTS*4]) {
 
 void main(void) {
     vec4 weights[MATRIX_WEIGHTS*4];
-    highp vec4 accu = vec4(0.0);
+    vec4 src[MATRIX_WEIGHTS];
+    highp vec4 accu[NUM_OUTPUTS];
+    for (int o=0; o < NUM_OUTPUTS; o++) accu[o] = vec4(0.0);
     highp ivec2 ipos = ivec2(colOffset.x, inputPos.y);
     for (int pack=0; pack < MATRIX_PACKS; pack++) {
-        // NOTE (mw) weight matrix is in column-major order
-        //                     matrix row         matrix column
-        unpackMatrix(ivec2(colOffset.y + pack, int(inputPos.x) * 4), weights);
-        // Multiply MATRIX_WEIGHTS*4 rows and 4 columns of the matrix with the input vector
+        // fetch the input once and re-use it for all outputs
         for (int w=0; w < MATRIX_WEIGHTS; w++) {
-            vec4 wgt0 = weights[w];
-            vec4 wgt1 = weights[w+MATRIX_WEIGHTS];
-            vec4 wgt2 = weights[w+2*MATRIX_WEIGHTS];
-            vec4 wgt3 = weights[w+3*MATRIX_WEIGHTS];
-            vec4 src = activate(texelFetch(inputLayer0, ipos+ivec2(w, 0), 0));
-            accu += vec4(dot(src, wgt0), dot(src, wgt1), dot(src, wgt2), dot(src, wgt3));
+            src[w] = activate(texelFetch(inputLayer0, ipos+ivec2(w, 0), 0));
+        }
+        for (int o=0; o < NUM_OUTPUTS; o++) {
+            // NOTE (mw) weight matrix is in column-major order
+            //                     matrix row         matrix column
+            unpackMatrix(ivec2(colOffset.y + pack, int(inputPos.x) * 4 + o * OUTPUT_COLUMNS), weights);
+            // Multiply MATRIX_WEIGHTS*4 rows and 4 columns of the matrix with the input vector
+            for (int w=0; w < MATRIX_WEIGHTS; w++) {
+                vec4 wgt0 = weights[w];
+                vec4 wgt1 = weights[w+MATRIX_WEIGHTS];
+                vec4 wgt2 = weights[w+2*MATRIX_WEIGHTS];
+                vec4 wgt3 = weights[w+3*MATRIX_WEIGHTS];
+                accu[o] += vec4(dot(src[w], wgt0), dot(src[w], wgt1), dot(src[w], wgt2), dot(src[w], wgt3));
+            }
         }
     }
 #ifdef USE_BIAS
-    accu += texelFetch(biasData, ivec2(inputPos.x, 0), 0);
+    accu[0] += texelFetch(biasData, ivec2(inputPos.x, 0), 0);
 #endif
 #ifdef USE_RESIDUAL
-    fragmentColor0 = accu + texelFetch(residual, ivec2(inputPos.xy), 0);
+    fragmentColor0 = accu[0] + texelFetch(residual, ivec2(inputPos.xy), 0);
 #else
-    fragmentColor0 = accu;
+    fragmentColor0 = accu[0];
+#endif
+#if NUM_OUTPUTS > 1
+    fragmentColor1 = accu[1];
+#endif
+#if NUM_OUTPUTS > 2
+    fragmentColor2 = accu[2];
+#endif
+#if NUM_OUTPUTS > 3
+    fragmentColor3 = accu[3];
 #endif
 }
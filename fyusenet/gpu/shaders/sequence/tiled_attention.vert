@@ -0,0 +1,14 @@
+/* -------------------------------------------------------------------------------------------------
+ * Tiled Attention (shared vertex shader)                                      (c) Martin Wawro 2023
+ * Creator: Martin Wawro
+ * SPDX-License-Identifier: MIT
+ * ---------------------------------------------------------------------------------------------- */
+
+precision highp float;
+precision highp int;
+
+in highp vec2 attributes0;
+
+void main(void) {
+    gl_Position = vec4(attributes0.xy, 0.0, 1.0);
+}
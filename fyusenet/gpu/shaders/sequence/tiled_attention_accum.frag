@@ -0,0 +1,56 @@
+/* -------------------------------------------------------------------------------------------------
+ * Tiled Attention - Attention-Weighted Value Accumulation                     (c) Martin Wawro 2023
+ * Creator: Martin Wawro
+ * SPDX-License-Identifier: MIT
+ * ---------------------------------------------------------------------------------------------- */
+
+precision highp float;
+precision highp int;
+#ifdef HIGH_PRECISION
+precision highp sampler2D;
+#else
+precision mediump sampler2D;
+#endif
+
+#ifndef KV_GROUP
+#define KV_GROUP 1
+#endif
+
+#include "shaders/sequence/kvcache.inc"
+
+#ifdef BINDING_SUPPORT
+layout(binding=0) uniform sampler2D inputLayer0;
+layout(binding=1) uniform KV_SAMPLER inputLayer1;
+#ifdef QUANTIZED_KV
+layout(binding=VALUE_SCALE_UNIT) uniform highp sampler2D valueScales;
+#endif
+#else
+uniform sampler2D inputLayer0;
+uniform KV_SAMPLER inputLayer1;
+#ifdef QUANTIZED_KV
+uniform highp sampler2D valueScales;
+#endif
+#endif
+
+layout(location=0) out vec4 fragmentColor0;
+
+uniform highp ivec4 blockParams;    // x: head-size (pixels), y: first key in block, z: end key in block (exclusive), w: token index of first query
+
+void main(void) {
+    ivec2 pos = ivec2(gl_FragCoord.xy);                   // x: column in value matrix, y: query token
+    int head = pos.x / blockParams.x;
+    int subscript = head % 4;
+    int weightx = (head / 4) * BLOCK_SIZE;
+    int count = min(blockParams.z, blockParams.w + pos.y + 1) - blockParams.y;
+    // consecutive groups of KV_GROUP query heads share the same value head
+    int valuex = (head / KV_GROUP) * blockParams.x + pos.x - head * blockParams.x;
+    highp vec4 accu = vec4(0.0);
+    for (int j=0; j < count; j++) {
+        float weight = texelFetch(inputLayer0, ivec2(weightx + j, pos.y), 0)[subscript];
+#ifdef QUANTIZED_KV
+        weight *= kvScale(valueScales, head / KV_GROUP, blockParams.y + j);
+#endif
+        accu += weight * kvFetch(inputLayer1, ivec2(valuex, blockParams.y + j));
+    }
+    fragmentColor0 = accu;
+}
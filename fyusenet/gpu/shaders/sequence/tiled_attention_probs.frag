@@ -0,0 +1,53 @@
+/* -------------------------------------------------------------------------------------------------
+ * Tiled Attention - Attention Weights for a Key Block                         (c) Martin Wawro 2023
+ * Creator: Martin Wawro
+ * SPDX-License-Identifier: MIT
+ * ---------------------------------------------------------------------------------------------- */
+
+precision highp float;
+precision highp int;
+#ifdef HIGH_PRECISION
+precision highp sampler2D;
+#else
+precision mediump sampler2D;
+#endif
+
+#include "shaders/sequence/kvcache.inc"
+
+#ifdef BINDING_SUPPORT
+layout(binding=0) uniform sampler2D inputLayer0;
+layout(binding=1) uniform KV_SAMPLER inputLayer1;
+layout(binding=2) uniform highp sampler2D maxData;
+layout(binding=3) uniform highp sampler2D sumData;
+#ifdef QUANTIZED_KV
+layout(binding=KEY_SCALE_UNIT) uniform highp sampler2D keyScales;
+#endif
+#else
+uniform sampler2D inputLayer0;
+uniform KV_SAMPLER inputLayer1;
+uniform highp sampler2D maxData;
+uniform highp sampler2D sumData;
+#ifdef QUANTIZED_KV
+uniform highp sampler2D keyScales;
+#endif
+#endif
+
+layout(location=0) out vec4 fragmentColor0;
+
+uniform highp ivec4 blockParams;    // x: head-size (pixels), y: first key in block, z: end key in block (exclusive), w: token index of first query
+uniform highp float scaling;        // scaling value for "scaled" dot-product
+
+#include "shaders/sequence/tiled_attention.inc"
+
+void main(void) {
+    ivec2 pos = ivec2(gl_FragCoord.xy);                   // x: key in block (for each batch of 4 heads), y: query token
+    int batch = pos.x / BLOCK_SIZE;
+    int key = blockParams.y + pos.x - batch * BLOCK_SIZE;
+    if ((key >= blockParams.z) || (key > blockParams.w + pos.y)) {
+        fragmentColor0 = vec4(0.0);
+    } else {
+        ivec2 statpos = ivec2(batch, pos.y);
+        highp vec4 score = attentionScores(pos.y, key, batch * 4 * blockParams.x, blockParams.x);
+        fragmentColor0 = exp(score - texelFetch(maxData, statpos, 0)) / texelFetch(sumData, statpos, 0);
+    }
+}
@@ -0,0 +1,61 @@
+/* -------------------------------------------------------------------------------------------------
+ * Tiled Attention - Online Softmax Statistics                                 (c) Martin Wawro 2023
+ * Creator: Martin Wawro
+ * SPDX-License-Identifier: MIT
+ * ---------------------------------------------------------------------------------------------- */
+
+precision highp float;
+precision highp int;
+#ifdef HIGH_PRECISION
+precision highp sampler2D;
+#else
+precision mediump sampler2D;
+#endif
+
+#include "shaders/sequence/kvcache.inc"
+
+#ifdef BINDING_SUPPORT
+layout(binding=0) uniform sampler2D inputLayer0;
+layout(binding=1) uniform KV_SAMPLER inputLayer1;
+layout(binding=2) uniform highp sampler2D maxData;
+layout(binding=3) uniform highp sampler2D sumData;
+#ifdef QUANTIZED_KV
+layout(binding=KEY_SCALE_UNIT) uniform highp sampler2D keyScales;
+#endif
+#else
+uniform sampler2D inputLayer0;
+uniform KV_SAMPLER inputLayer1;
+uniform highp sampler2D maxData;
+uniform highp sampler2D sumData;
+#ifdef QUANTIZED_KV
+uniform highp sampler2D keyScales;
+#endif
+#endif
+
+layout(location=0) out highp vec4 fragmentColor0;     // running maximum
+layout(location=1) out highp vec4 fragmentColor1;     // running sum of exponentials
+
+uniform highp ivec4 blockParams;    // x: head-size (pixels), y: first key in block, z: end key in block (exclusive), w: token index of first query
+uniform highp float scaling;        // scaling value for "scaled" dot-product
+uniform int firstBlock;             // set to non-zero for the first block, which does not have any previous statistics
+
+#include "shaders/sequence/tiled_attention.inc"
+
+void main(void) {
+    ivec2 pos = ivec2(gl_FragCoord.xy);                   // x: batch of 4 heads, y: query token
+    int last = min(blockParams.z, blockParams.w + pos.y + 1);
+    highp vec4 runmax = vec4(-FLT_MAX);
+    highp vec4 runsum = vec4(0.0);
+    if (firstBlock == 0) {
+        runmax = texelFetch(maxData, pos, 0);
+        runsum = texelFetch(sumData, pos, 0);
+    }
+    for (int key=blockParams.y; key < last; key++) {
+        highp vec4 score = attentionScores(pos.y, key, pos.x * 4 * blockParams.x, blockParams.x);
+        highp vec4 newmax = max(runmax, score);
+        runsum = runsum * exp(runmax - newmax) + exp(score - newmax);
+        runmax = newmax;
+    }
+    fragmentColor0 = runmax;
+    fragmentColor1 = runsum;
+}
@@ -36,7 +36,7 @@ Shallow2DeepLayer::Shallow2DeepLayer(const GPULayerBuilder& builder, int layerNu
     DeepLayerBase(builder, layerNumber) {
     if (flags_ & LayerFlags::RESIDUAL_INPUT) THROW_EXCEPTION_ARGS(FynException, "This layer does not support residual input");
     maxInputTextures_ = std::min(maxInputTextures_, GLInfo::getMaximumTextureUnits());
-    int numintex = (builder.in()+PIXEL_PACKING-1) / PIXEL_PACKING;
+    int numintex = tiler_->getBatchSize() * ((builder.in()+PIXEL_PACKING-1) / PIXEL_PACKING);
     numRenderPasses_ = (numintex+maxInputTextures_-1) / maxInputTextures_;
 }
 
@@ -61,13 +61,13 @@ void Shallow2DeepLayer::setup() {
 void Shallow2DeepLayer::forward(uint64_t sequenceNo, StateToken * state) {
     std::lock_guard<std::recursive_mutex> lck(processingLock_);
     if (outputChanged_) updateFBOs();
-    glDisable(GL_BLEND);
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_DEPTH_TEST);
-    glClearColor(0.0f, 0.0f ,0.0f, 0.0f);
-    glViewport(0, 0, viewport_[0], viewport_[1]);
+    opengl::GLStateCache::disable(GL_BLEND);
+    opengl::GLStateCache::disable(GL_CULL_FACE);
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
+    opengl::GLStateCache::clearColor(0.0f, 0.0f ,0.0f, 0.0f);
+    opengl::GLStateCache::viewport(0, 0, viewport_[0], viewport_[1]);
     framebuffers_.at(0)->bind();
-    glClear(GL_COLOR_BUFFER_BIT);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
     vertexArray_->bind();
     shader_->bind();
     int intexoffset = 0;
@@ -76,11 +76,11 @@ void Shallow2DeepLayer::forward(uint64_t sequenceNo, StateToken * state) {
         int quads=0;
         for (int it = 0; it < maxInputTextures_; it++) {
             if (intexoffset >= (int)inputTextures_.size()) break;
-            glActiveTexture(GL_TEXTURE0 + it);
-            glBindTexture(GL_TEXTURE_2D, inputTextures_.at(intexoffset++));
+            opengl::GLStateCache::activeTexture(GL_TEXTURE0 + it);
+            opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, inputTextures_.at(intexoffset++));
             quads++;
         }
-        glDrawElements(GL_TRIANGLES,quads*6,GL_UNSIGNED_SHORT,(const GLvoid *)(quadoffset*6*sizeof(short)));
+        opengl::GLCommandBuffer::drawElements(GL_TRIANGLES,quads*6,GL_UNSIGNED_SHORT,(const GLvoid *)(quadoffset*6*sizeof(short)));
         quadoffset += quads;
     }
     shader_->unbind();
@@ -109,23 +109,26 @@ void Shallow2DeepLayer::cleanup() {
  */
 std::vector<BufferSpec> Shallow2DeepLayer::getRequiredInputBuffers() const {
     std::vector<BufferSpec> result;
-    int channel = 0;
-    if (inputChannels_ <= PIXEL_PACKING) {
-        // NOTE (mw) technically this type of layer is not needed for this case, as deep format
-        // and shallow format are the same here, exception would be if padding has to be added
-        // for input textures, we support textures with less than 4 channels (might be from upload)
-        auto format = BufferSpec::formatByChannels(inputChannels_, TEXTURE_TYPE_DEFAULT);
-        result.emplace_back(channel++, 0, width_ + 2*inputPadding_, height_ + 2*inputPadding_,
-                            format.first, format.second, TEXTURE_TYPE_DEFAULT,
-                            BufferSpec::FUNCTION_SOURCE, inputChannels_);
-    } else {
-        int rem = inputChannels_;
-        while (rem > 0) {
-            result.emplace_back(channel++, 0,
-                                width_ + 2*inputPadding_, height_ + 2*inputPadding_,
-                                TEXTURE_IFORMAT_4,TEXTURE_FORMAT_4,TEXTURE_TYPE_DEFAULT,
-                                BufferSpec::FUNCTION_SOURCE, std::min(rem, PIXEL_PACKING));
-            rem -= PIXEL_PACKING;
+    // for batched output, each image is supplied on its own port
+    for (int port=0; port < tiler_->getBatchSize(); port++) {
+        int channel = 0;
+        if (inputChannels_ <= PIXEL_PACKING) {
+            // NOTE (mw) technically this type of layer is not needed for this case, as deep format
+            // and shallow format are the same here, exception would be if padding has to be added
+            // for input textures, we support textures with less than 4 channels (might be from upload)
+            auto format = BufferSpec::formatByChannels(inputChannels_, TEXTURE_TYPE_DEFAULT);
+            result.emplace_back(channel++, port, width_ + 2*inputPadding_, height_ + 2*inputPadding_,
+                                format.first, format.second, TEXTURE_TYPE_DEFAULT,
+                                BufferSpec::FUNCTION_SOURCE, inputChannels_);
+        } else {
+            int rem = inputChannels_;
+            while (rem > 0) {
+                result.emplace_back(channel++, port,
+                                    width_ + 2*inputPadding_, height_ + 2*inputPadding_,
+                                    TEXTURE_IFORMAT_4,TEXTURE_FORMAT_4,TEXTURE_TYPE_DEFAULT,
+                                    BufferSpec::FUNCTION_SOURCE, std::min(rem, PIXEL_PACKING));
+                rem -= PIXEL_PACKING;
+            }
         }
     }
     return result;
@@ -171,43 +174,46 @@ void Shallow2DeepLayer::setupNetworkPolygons(VAO *vao) {
     inputquad[2*2+1] = inputquad[1*2+1];
     inputquad[3*2+0] = inputquad[2*2+0];
     inputquad[3*2+1] = inputquad[0*2+1];
-    float * attrs0 = new float[tiler_->numOutputTiles()*4*4];
-    std::vector<deep::DeepTiler::Tile> otiles = tiler_->createOutputTiles();
+    const int numtiles = tiler_->numOutputTiles(deep::DeepTiler::BATCH);
+    float * attrs0 = new float[numtiles*4*4];
     int offset0=0;
-    for (deep::DeepTiler::Tile tile : otiles) {
-        tile.toFloatVec(attrs0,offset0,4);
-        for (int i=0;i<4;i++) {
-            attrs0[offset0+i*4+2] = inputquad[i*2];
-            attrs0[offset0+i*4+3] = inputquad[i*2+1];
+    for (int img=0; img < tiler_->getBatchSize(); img++) {
+        std::vector<deep::DeepTiler::Tile> otiles = tiler_->createOutputTiles(img);
+        for (deep::DeepTiler::Tile tile : otiles) {
+            tile.toFloatVec(attrs0,offset0,4);
+            for (int i=0;i<4;i++) {
+                attrs0[offset0+i*4+2] = inputquad[i*2];
+                attrs0[offset0+i*4+3] = inputquad[i*2+1];
+            }
+            offset0+=4*4;
         }
-        offset0+=4*4;
     }
     vertexBuffer_ = new VBO(context_);
     vao->enableArray(0);
-    vertexBuffer_->setBufferData(attrs0,tiler_->numOutputTiles()*4*4*sizeof(float),GL_STATIC_DRAW);
+    vertexBuffer_->setBufferData(attrs0,numtiles*4*4*sizeof(float),GL_STATIC_DRAW);
     vertexBuffer_->bind();
     vao->setVertexAttributeBuffer(0,4,GL_FLOAT,GL_FALSE,0,0);
     delete [] attrs0;
     //
-    int *attrs1 = new int[tiler_->numOutputTiles()*4];
+    int *attrs1 = new int[numtiles*4];
     int offset1=0;
     int texunit=0;
-    for (int i=0;i<tiler_->numOutputTiles();i++) {
+    for (int i=0;i<numtiles;i++) {
         for (int j=0;j<4;j++) attrs1[offset1++]=texunit;
         if (++texunit >= maxInputTextures_) texunit=0;
     }
     texUnitBuffer_ = new VBO(context_);
     vao->enableArray(1);
-    texUnitBuffer_->setBufferData(attrs1, (int)(tiler_->numOutputTiles() * 4 * sizeof(int)), GL_STATIC_DRAW);
+    texUnitBuffer_->setBufferData(attrs1, (int)(numtiles * 4 * sizeof(int)), GL_STATIC_DRAW);
     texUnitBuffer_->bind();
     vao->setVertexAttributeBuffer(1,1,GL_INT,0,0);
     delete [] attrs1;
     //---------------------------------------------
     // IBO part
     //---------------------------------------------
-    GLshort * indices = new GLshort[tiler_->numOutputTiles()*6];
+    GLshort * indices = new GLshort[numtiles*6];
     indexBuffer_ = new IBO(context_);
-    for (int i=0;i<tiler_->numOutputTiles();i++) {
+    for (int i=0;i<numtiles;i++) {
         int offset=i*4;
         indices[i*6+0]= (GLshort)(offset+0);
         indices[i*6+1]= (GLshort)(offset+1);
@@ -216,7 +222,7 @@ void Shallow2DeepLayer::setupNetworkPolygons(VAO *vao) {
         indices[i*6+4]= (GLshort)(offset+2);
         indices[i*6+5]= (GLshort)(offset+3);
     }
-    indexBuffer_->setBufferData(indices, (int)(6 * tiler_->numOutputTiles() * sizeof(GLshort)), GL_STATIC_DRAW);
+    indexBuffer_->setBufferData(indices, (int)(6 * numtiles * sizeof(GLshort)), GL_STATIC_DRAW);
     indexBuffer_->bind();
     delete [] indices;
 }
@@ -37,6 +37,10 @@ namespace fyusion::fyusenet::gpu {
  * and tensors with a high channel count, which we call \e deep tensors. The specifics for those
  * are laid out @ref GPULayerBase "here". The purpose of this class it so convert the tensor data from
  * the \e shallow representation to the \e deep representation format.
+ *
+ * When a batch size larger than 1 is set on the builder, this layer expects one shallow input
+ * tensor per image, where the input port number equals the image index. All images are then
+ * arranged as blocks in a single deep output tensor, see DeepTiler for details.
  */
 class Shallow2DeepLayer : public deep::DeepLayerBase {
  public:
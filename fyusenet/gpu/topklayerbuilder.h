@@ -0,0 +1,94 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Top-K Layer Builder (Header)
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <string>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "gfxcontextlink.h"
+#include "gpulayerbuilder.h"
+#include "../base/layerflags.h"
+
+//------------------------------------- Public Declarations ----------------------------------------
+
+namespace fyusion::fyusenet::gpu {
+
+/**
+ * @brief Templatized anchor for top-K layer builders on the GPU
+ *
+ * @see TopKLayerBuilder
+ */
+template<typename D = GPULayerBuilderTempl<>>
+struct TopKLayerBuilderTempl : GPULayerBuilderTempl<D> {
+
+    /**
+     * @brief Constructor
+     *
+     * @param name Name to be assigned to the built layer
+     */
+    TopKLayerBuilderTempl(const std::string& name) : GPULayerBuilderTempl<D>(name) {
+        LayerBuilderTempl<D>::type_ = LayerType::TOPK;
+    }
+
+    /**
+     * @brief Set number of highest-scoring elements to select
+     *
+     * @param k Number of elements to select, must be in the range [1, #channels]
+     *
+     * @return Reference to builder object
+     */
+    D & topK(int k) {
+        k_ = k;
+        return *(D *)this;
+    }
+
+    /**
+     * @brief Compute softmax probabilities for the selected elements
+     *
+     * @param enable If \c true, the softmax over \e all channels is computed and reported for the
+     *               selected elements
+     *
+     * @return Reference to builder object
+     */
+    D & softmax(bool enable = true) {
+        softmax_ = enable;
+        return *(D *)this;
+    }
+
+    int k_ = 5;                 //!< Number of highest-scoring elements to select
+    bool softmax_ = false;      //!< Indicator whether softmax probabilities shall be computed
+};
+
+
+/**
+ * @brief Builder class for top-K layers on the GPU
+ *
+ * This class is to be used to build layers that select the K highest-scoring channels of a
+ * classification output (e.g. the logits of a CNN head), such that only K index/score pairs
+ * have to be downloaded instead of the full score vector.
+ *
+ * @see deep::DeepTopKLayer
+ */
+struct TopKLayerBuilder : TopKLayerBuilderTempl<TopKLayerBuilder> {
+    /**
+     * @brief Constructor
+     *
+     * @param name Name to be assigned to the built layer
+     */
+    TopKLayerBuilder(const std::string & name) : TopKLayerBuilderTempl<TopKLayerBuilder>(name) {}
+};
+
+} // fyusion::fyusenet::gpu namespace
+
+// vim: set expandtab ts=4 sw=4:
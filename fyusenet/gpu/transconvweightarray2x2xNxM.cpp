@@ -235,7 +235,8 @@ void TransConvWeightArray2x2xNxM::extractWeightData(const float *input) {
     }
 
     dstoffs = extractStratum4(input, 0, dstoffs);
-    if (dstoffs >= fullsize) {
+    // the last stratum may fill the array completely
+    if (dstoffs > fullsize) {
         THROW_EXCEPTION_ARGS(FynException,"Overflow at weight array computation");
     }
 }
@@ -60,10 +60,20 @@ struct UpDownLayerBuilderTempl : GPULayerBuilderTempl<D> {
     /**
      * @brief Build a layer that runs asynchronously to maximize throughput
      *
+     * @param depth Pipeline depth, which is the number of buffer sets that the layer uses to
+     *              keep multiple transfers in flight (at least 2)
+     *
      * @return Reference to builder after assignment
+     *
+     * For upload layers, the pipeline depth determines the number of texture sets that are used
+     * in a round-robin fashion, such that uploads for subsequent runs can commence while previous
+     * runs are still consuming their input. For best throughput, the depth should match the
+     * pipeline depth of the network, see NeuralNetwork::AsyncAdapter::pipelineDepth().
      */
-    D & async()  {
+    D & async(int depth = 2)  {
+        if (depth < 2) THROW_EXCEPTION_ARGS(FynException,"Asynchronous layers require a pipeline depth of at least 2");
         async_ = true;
+        asyncDepth_ = depth;
         return *(D *)this;
     }
 #endif
@@ -98,6 +108,45 @@ struct UpDownLayerBuilderTempl : GPULayerBuilderTempl<D> {
         return *(D *)this;
     }
 
+    /**
+     * @brief Build an upload layer that supports zero-copy uploads from caller memory
+     *
+     * @param slots Number of slots in the ring of upload buffers (at least 2)
+     *
+     * @return Reference to builder after assignment
+     *
+     * Zero-copy upload layers maintain a ring of (where supported persistently mapped) pixel
+     * buffers which can be written to directly by the caller, for example by a video decoder,
+     * which removes the intermediate copy from a CPUBuffer.
+     *
+     * @see UploadLayer::acquireInputSlot(), UploadLayer::submitInputSlot()
+     */
+    D & zeroCopy(int slots = 3) {
+        if (slots < 2) THROW_EXCEPTION_ARGS(FynException,"Zero-copy uploads require at least 2 slots");
+        zeroCopySlots_ = slots;
+        return *(D *)this;
+    }
+
+    /**
+     * @brief Build an upload layer that ingests NV12 (YUV 4:2:0) frames
+     *
+     * @return Reference to builder after assignment
+     *
+     * NV12 upload layers take a CPU buffer of 8-bit data which consists of the full-resolution
+     * luminance (Y) plane, directly followed by the half-resolution plane of interleaved chroma
+     * (UV) values, as delivered by most video decoders and camera pipelines. The planes are
+     * uploaded as-is into a single-channel texture (channel index 0) and a two-channel texture of
+     * half the width and height (channel index 1), the conversion to RGB is left to the consumer
+     * of the textures (see ImgPreprocLayerBuilder).
+     *
+     * The layer shape must be set to 3 channels and even image dimensions without padding.
+     */
+    D & nv12() {
+        nv12_ = true;
+        dataType_ = BufferSpec::dtype::UBYTE;
+        return *(D *)this;
+    }
+
 #ifdef FYUSENET_MULTITHREADING
     /**
      * @brief Assign callback for asynchronous uploads and downloads
@@ -130,8 +179,11 @@ struct UpDownLayerBuilderTempl : GPULayerBuilderTempl<D> {
 
     dir direction_;                                 //!< Data direction (either upload to GPU or download from GPU)
     int seqPacking_ = LayerBase::PIXEL_PACKING;     //!< Number of sequence elements to pack into a single vector (default is 4)
+    int zeroCopySlots_ = 0;                         //!< Number of ring slots for zero-copy uploads (0 disables zero-copy uploads)
+    bool nv12_ = false;                             //!< Indicator that NV12 (YUV 4:2:0) frames are uploaded
 #ifdef FYUSENET_MULTITHREADING
     bool async_ = false;            //!< Whether or not the layer should be working asynchronously (default is synchronous)
+    int asyncDepth_ = 2;            //!< Number of buffer sets for asynchronous operation (pipeline depth)
 
     /**
      * Callback function for asynchronous upload and download layers, will be called on various
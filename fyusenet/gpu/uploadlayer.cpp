@@ -11,10 +11,12 @@
 
 #include <cassert>
 #include <cstring>
+#include <cinttypes>
 
 //-------------------------------------- Project  Headers ------------------------------------------
 
 #include "uploadlayer.h"
+#include "floatconversion.h"
 #ifdef FYUSENET_MULTITHREADING
 #include "../gl/asyncpool.h"
 #endif
@@ -53,14 +55,28 @@ UploadLayer::UploadLayer(const UpDownLayerBuilder& builder, int layerNumber) :
         assert(inputChannels_ == outputChannels_);
     }
 #ifdef FYUSENET_MULTITHREADING
-    memset(inFlight_, 0, ASYNC_BUFFERS * sizeof(uint64_t));
     async_ = builder.async_;
+    inFlight_.assign((async_) ? builder.asyncDepth_ : 1, 0);
+    if (async_) shadowTextures_.resize(builder.asyncDepth_ - 1);
     userCallback_ = builder.callback_;
 #endif
+    numSlots_ = builder.zeroCopySlots_;
+    if ((numSlots_ > 0) && (async_ || builder.isSequence())) {
+        THROW_EXCEPTION_ARGS(FynException, "Zero-copy uploads are only supported on synchronous non-sequence layers (%s)", getName().c_str());
+    }
+    nv12_ = builder.nv12_;
+    if (nv12_) {
+        if ((inputChannels_ != 3) || (builder.isSequence()) || (inputPadding_ != 0) || (width_ & 1) || (height_ & 1)) {
+            THROW_EXCEPTION_ARGS(FynException, "NV12 uploads require 3 channels, even dimensions and no padding (%s)", getName().c_str());
+        }
+    }
     dataType_ = builder.dataType_;
     switch (dataType_) {
         case BufferSpec::dtype::FLOAT16:
-            // intentional fallthrough (we do not yet upload half-float data and let the driver do the conversion
+            // CPU buffer is in FP32, we convert to FP16 on the CPU prior to the upload
+            bytesPerChan_ = 4;
+            gpuBytesPerChan_ = 2;
+            return;
         case BufferSpec::dtype::FLOAT:
             // intentional fallthrough
         case BufferSpec::dtype::INT32:
@@ -77,6 +93,7 @@ UploadLayer::UploadLayer(const UpDownLayerBuilder& builder, int layerNumber) :
             bytesPerChan_ = 1;
             break;
     }
+    gpuBytesPerChan_ = bytesPerChan_;
 }
 
 
@@ -84,7 +101,7 @@ UploadLayer::UploadLayer(const UpDownLayerBuilder& builder, int layerNumber) :
  * @copydoc LayerBase::setup
  */
 void UploadLayer::setup() {
-    // empty on purpose
+    if (numSlots_ > 0) setupInputSlots();
 }
 
 
@@ -92,7 +109,7 @@ void UploadLayer::setup() {
  * @copydoc LayerBase::cleanup
  */
 void UploadLayer::cleanup() {
-    // empty on purpose
+    cleanupInputSlots();
 }
 
 
@@ -100,6 +117,10 @@ void UploadLayer::cleanup() {
  * @copydoc LayerBase::forward
  */
 void UploadLayer::forward(uint64_t sequenceNo, StateToken * state) {
+    if (!submitted_.empty()) {
+        slotUpload();
+        return;
+    }
     if (!input_) THROW_EXCEPTION_ARGS(FynException,"No input buffer set for upload");
 #ifndef FYUSENET_MULTITHREADING
     if (true) {
@@ -136,8 +157,8 @@ void UploadLayer::forward(uint64_t sequenceNo, StateToken * state) {
  */
 bool UploadLayer::asyncForward(uint64_t sequence, StateToken * token, const std::function<void (uint64_t)> &engineCallback) {
     if (!input_) THROW_EXCEPTION_ARGS(FynException,"No input buffer set for upload");
-    if ((dataType_ != BufferSpec::dtype::FLOAT) && (dataType_ != BufferSpec::dtype::UBYTE)) {
-        THROW_EXCEPTION_ARGS(FynException, "Currently only 32-bit float and 8-bit uint are supported");
+    if ((dataType_ != BufferSpec::dtype::FLOAT) && (dataType_ != BufferSpec::dtype::FLOAT16) && (dataType_ != BufferSpec::dtype::UBYTE)) {
+        THROW_EXCEPTION_ARGS(FynException, "Currently only 32/16-bit float and 8-bit uint are supported");
     }
     if (!async_) THROW_EXCEPTION_ARGS(FynException, "Layer %s is not asynchronous", getName().c_str());
     return asyncUpload(sequence, token, engineCallback);
@@ -196,6 +217,85 @@ void UploadLayer::setCPUInputBuffer(CPUBuffer *buf, int port) {
 
 
 
+/**
+ * @brief Acquire a slot for zero-copy upload
+ *
+ * @param[out] slot Index of the acquired slot, to be passed to submitInputSlot()
+ *
+ * @return Pointer to writable memory of inputSlotBytes() bytes, which receives the input data in
+ *         the same format as it would be stored in the CPU input buffer (for \c FLOAT16 layers,
+ *         the data has to be supplied as 16-bit floating-point numbers)
+ *
+ * @pre The GL context of this layer must be current to the calling thread. The returned pointer
+ *      itself may be written to from any thread.
+ *
+ * This function obtains the next free slot in the ring of pixel buffers. If the GPU has not yet
+ * finished reading the data previously uploaded from that slot, this function blocks until it
+ * has done so.
+ *
+ * @throws FynException if zero-copy uploads are not enabled, all slots are acquired/submitted or
+ *         the GPU did not finish reading the slot within 5s
+ *
+ * @see submitInputSlot(), UpDownLayerBuilder::zeroCopy()
+ */
+void * UploadLayer::acquireInputSlot(int & slot) {
+    if (slots_.empty()) THROW_EXCEPTION_ARGS(FynException, "Zero-copy uploads not enabled for layer %s", getName().c_str());
+    int idx = -1;
+    for (int i=0; i < numSlots_; i++) {
+        int cand = (nextSlot_ + i) % numSlots_;
+        if (slots_[cand].status == InputSlot::FREE) {
+            idx = cand;
+            break;
+        }
+    }
+    if (idx < 0) THROW_EXCEPTION_ARGS(FynException, "No free upload slot available on layer %s", getName().c_str());
+    InputSlot & target = slots_[idx];
+    if (target.fence) {
+        bool rc = context_.waitClientSync(target.fence, 5000000000);    // wait 5s max
+        if (!rc) THROW_EXCEPTION_ARGS(FynException, "Upload slot %d of layer %s not released by GL within 5s", idx, getName().c_str());
+        context_.removeSync(target.fence);
+        target.fence = nullptr;
+    }
+    if (!persistentSlots_) {
+        target.pbo->bind(GL_PIXEL_UNPACK_BUFFER);
+        target.mapped = target.pbo->mapWriteBuffer(slotBytes_);
+        target.pbo->unbind(GL_PIXEL_UNPACK_BUFFER);
+        if (!target.mapped) THROW_EXCEPTION_ARGS(FynException, "Cannot map upload slot on layer %s", getName().c_str());
+    }
+    target.status = InputSlot::ACQUIRED;
+    nextSlot_ = (idx + 1) % numSlots_;
+    slot = idx;
+    return target.mapped;
+}
+
+
+/**
+ * @brief Submit a previously acquired slot for upload
+ *
+ * @param slot Slot index as returned by acquireInputSlot()
+ *
+ * @pre The GL context of this layer must be current to the calling thread and the data in the
+ *      slot must be completely written
+ *
+ * Marks the slot as input for the next call to forward(). Submitted slots are consumed in the
+ * order of submission and take precedence over the CPU input buffer.
+ */
+void UploadLayer::submitInputSlot(int slot) {
+    if ((slot < 0) || (slot >= (int)slots_.size()) || (slots_[slot].status != InputSlot::ACQUIRED)) {
+        THROW_EXCEPTION_ARGS(FynException, "Invalid upload slot %d submitted to layer %s", slot, getName().c_str());
+    }
+    InputSlot & target = slots_[slot];
+    if (!persistentSlots_) {
+        target.pbo->bind(GL_PIXEL_UNPACK_BUFFER);
+        target.pbo->unmapWriteBuffer();
+        target.pbo->unbind(GL_PIXEL_UNPACK_BUFFER);
+        target.mapped = nullptr;
+    }
+    target.status = InputSlot::SUBMITTED;
+    submitted_.push_back(slot);
+}
+
+
 /**
  * @brief Obtain buffer specifiers that are required as input for this layer
  *
@@ -207,11 +307,20 @@ void UploadLayer::setCPUInputBuffer(CPUBuffer *buf, int port) {
  * buffer shapes. In particular that means that if you want to upload a buffer that has more than
  * 4 channels, the data will have to be arranged in \e shallow GPU order, which in cases of
  * channels >=4 aggregates 4 channels in a single element (think of it as RGBA, which it is).
+ * For NV12 uploads, the buffer is a single-channel 8-bit buffer which has 1.5 times the height of
+ * the image, as the chrominance plane is appended to the luminance plane.
  *
  * @see BufferSpec
  */
 std::vector<BufferSpec> UploadLayer::getRequiredInputBuffers() const {
     std::vector<BufferSpec> result;
+    if (nv12_) {
+        // NV12 frames are stored as luminance plane with the half-height chrominance plane below it
+        result.push_back(BufferSpec(0, 0, width_, height_ + height_ / 2,
+                                    bufferFormat(dataType_, 1), BufferSpec::genericformat::SINGLE, dataType_, BufferSpec::CPU_SOURCE, 1)
+                                    .device(BufferSpec::csdevice::COMP_STOR_CPU).dataOrder(getInputOrder(0)));
+        return result;
+    }
     // NOTE (mw) if we have output padding, it needs to be present in the input buffer already
     auto spec = BufferSpec(0, 0, width_ + 2*outputPadding_, height_ + 2*outputPadding_,
                            bufferFormat(dataType_, 1), BufferSpec::genericformat::SINGLE, dataType_, BufferSpec::CPU_SOURCE,
@@ -238,21 +347,33 @@ std::vector<BufferSpec> UploadLayer::getRequiredOutputBuffers() const {
         auto spec = BufferSpec(0, 0, viewport_[0], viewport_[1], bufferFormat(dataType_, seqPacking_), genfmt, dataType_, BufferSpec::GPU_DEST,
                                inputChannels_).device(BufferSpec::csdevice::COMP_STOR_GPU).dataOrder(BufferSpec::order::GPU_SEQUENCE);
         result.push_back(spec);
+    } else if (nv12_) {
+        int channelidx = 0;
+        for (const Plane & plane : planes()) {
+            auto format = BufferSpec::formatByChannels(plane.channels, dataType_);
+            result.push_back(BufferSpec(channelidx++, 0, plane.width, plane.height,
+                                        format.first, format.second, dataType_,
+                                        BufferSpec::GPU_DEST, plane.channels).async(async_).multi(pipelineDepth()));
+        }
     } else {
         int channelidx = 0;
+        // 8-bit data is stored in normalized 8-bit textures, everything else in floating-point textures
+        BufferSpec::dtype textype = (dataType_ == BufferSpec::dtype::UBYTE) ? dataType_ : TEXTURE_TYPE_DEFAULT;
         // FIXME (mw) this function will create problems when uploading channel data that is >4 and not a multiple of 4
         if (inputChannels_ < PIXEL_PACKING) {
-            auto format = BufferSpec::formatByChannels(inputChannels_, TEXTURE_TYPE_DEFAULT);
+            auto format = BufferSpec::formatByChannels(inputChannels_, textype);
             result.push_back(BufferSpec(channelidx++, 0, width_ + 2 * inputPadding_, height_ + 2 * inputPadding_,
-                                        format.first, format.second, TEXTURE_TYPE_DEFAULT,
-                                        BufferSpec::GPU_DEST, inputChannels_).async(async_).multi((async_) ? ASYNC_BUFFERS : 1));
+                                        format.first, format.second, textype,
+                                        BufferSpec::GPU_DEST, inputChannels_).async(async_).multi(pipelineDepth()));
         } else {
             int rem = inputChannels_;
             while (rem > 0) {
+                auto format = (textype == BufferSpec::dtype::UBYTE) ? BufferSpec::formatByChannels(std::min(rem, PIXEL_PACKING), textype) :
+                                                                      std::make_pair(TEXTURE_IFORMAT_4, TEXTURE_FORMAT_4);
                 result.push_back(BufferSpec(channelidx++, 0,
                                             width_ + 2 * inputPadding_, height_ + 2 * inputPadding_,
-                                            TEXTURE_IFORMAT_4, TEXTURE_FORMAT_4, TEXTURE_TYPE_DEFAULT,
-                                            BufferSpec::GPU_DEST, std::min(rem, PIXEL_PACKING)).async(async_).multi((async_) ? ASYNC_BUFFERS : 1));
+                                            format.first, format.second, textype,
+                                            BufferSpec::GPU_DEST, std::min(rem, PIXEL_PACKING)).async(async_).multi(pipelineDepth()));
                 rem -= LayerBase::PIXEL_PACKING;
             }
         }
@@ -272,7 +393,7 @@ bool UploadLayer::isLocked() const {
     if (!async_) return false;
     else {
         std::lock_guard<std::mutex> lck(asyncLock_);
-        return (locked_ >= ASYNC_BUFFERS);
+        return (locked_ >= (int)inFlight_.size());
     }
 }
 #endif
@@ -293,7 +414,7 @@ void UploadLayer::unlock(uint64_t sequenceNo) {
     if (async_) {
         std::lock_guard<std::mutex> lck(asyncLock_);
         int initial = locked_;
-        for (int i=0; i < ASYNC_BUFFERS; i++) {
+        for (int i=0; i < (int)inFlight_.size(); i++) {
             if (inFlight_[i] == sequenceNo) {
                 inFlight_[i] = 0;
                 locked_--;
@@ -375,7 +496,7 @@ void UploadLayer::addOutputTexture(GLuint textureID, int channelIndex, int shado
     if (shadowIndex != 0) THROW_EXCEPTION_ARGS(FynException,"Illegal shadow index %d supplied, no multithreading support", shadowIndex);
 #else
     if (shadowIndex != 0) {
-        if (shadowIndex >= ASYNC_BUFFERS) THROW_EXCEPTION_ARGS(FynException, "Shadow index %d out of bounds", shadowIndex);
+        if (shadowIndex > (int)shadowTextures_.size()) THROW_EXCEPTION_ARGS(FynException, "Shadow index %d out of bounds", shadowIndex);
         while ((int)shadowTextures_[shadowIndex-1].size() < channelIndex) shadowTextures_[shadowIndex-1].push_back(0);
         if (channelIndex == (int)shadowTextures_[shadowIndex-1].size()) shadowTextures_[shadowIndex-1].push_back(textureID);
         else shadowTextures_[shadowIndex-1][channelIndex] = textureID;
@@ -410,6 +531,7 @@ BufferSpec::sizedformat UploadLayer::bufferFormat(BufferSpec::dtype type, int pa
     static fmt fmtfp32[4] = {fmt::SINGLE32F, fmt::RG32F, fmt::RGBA32F, fmt::RGBA32F};
     static fmt fmtui32[4] = {fmt::SINGLE32UI, fmt::RG32UI, fmt::RGBA32UI, fmt::RGBA32UI};
 #endif
+    static fmt fmtui8[4] = {fmt::RED8, fmt::RG8, fmt::RGB8, fmt::RGBA8};
     switch (type) {
         case BufferSpec::dtype::FLOAT16:
             // currently not supported, fallback to float
@@ -419,6 +541,8 @@ BufferSpec::sizedformat UploadLayer::bufferFormat(BufferSpec::dtype type, int pa
             // currently not supported, fallback to uint32
         case BufferSpec::dtype::UINT32:
             return fmtui32[packing-1];
+        case BufferSpec::dtype::UBYTE:
+            return fmtui8[packing-1];
         default:
             THROW_EXCEPTION_ARGS(FynException,"Unsupported combination of datatype %d and packing %d", (int)type, packing);
     }
@@ -440,7 +564,6 @@ void UploadLayer::setupFBOs() {
  * directly on the CPU buffers to (synchronously) update texture data to the GPU.
  */
 void UploadLayer::syncUpload(StateToken * state) {
-    int rem = inputChannels_;
     int texoffs = 0;
     auto * srcptr = (const uint8_t *)input_->map<uint8_t>();
     if (!srcptr) {
@@ -449,23 +572,155 @@ void UploadLayer::syncUpload(StateToken * state) {
     if (maxSequenceLength_ > 0) {
         assert(state);
         // NOTE (mw) this code will have trouble uploading embeddings, revisit it
-        glBindTexture(GL_TEXTURE_2D, outputTextures_.at(0));
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, outputTextures_.at(0));
         auto format = BufferSpec::formatByChannels(std::min(PIXEL_PACKING, inputChannels_), dataType_);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, viewport_[0], state->seqLength, (GLenum) format.second, (GLenum) dataType_, srcptr);
+        const void * data = convertForUpload(srcptr, (size_t)viewport_[0] * state->seqLength * seqPacking_);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, viewport_[0], state->seqLength, (GLenum) format.second, (GLenum) dataType_, data);
+    } else {
+        // rows of 8-bit and 16-bit data are not necessarily aligned to 4 bytes
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (const Plane & plane : planes()) {
+            size_t entries = (size_t)plane.channels * plane.width * plane.height;
+            auto format = BufferSpec::formatByChannels(plane.channels, dataType_);
+            opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, outputTextures_.at(texoffs++));
+            const void * data = convertForUpload(srcptr, entries);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, plane.width, plane.height, (GLenum) format.second, (GLenum) dataType_, data);
+            srcptr += entries * bytesPerChan_;
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+    input_->unmap();
+}
+
+
+/**
+ * @brief Upload texture(s) from the oldest submitted zero-copy slot
+ *
+ * Issues the texture upload(s) directly from the pixel buffer of the slot and places a fence
+ * into the command stream, such that the slot is not overwritten before the GPU has read it.
+ */
+void UploadLayer::slotUpload() {
+    assert(!submitted_.empty());
+    InputSlot & source = slots_[submitted_.front()];
+    submitted_.pop_front();
+    int texoffs = 0;
+    size_t offset = 0;
+    source.pbo->bind(GL_PIXEL_UNPACK_BUFFER);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (const Plane & plane : planes()) {
+        auto format = BufferSpec::formatByChannels(plane.channels, dataType_);
+        opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, outputTextures_.at(texoffs++));
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, plane.width, plane.height, (GLenum) format.second, (GLenum) dataType_, (const GLvoid *)(uintptr_t)offset);
+        offset += (size_t)plane.channels * plane.width * plane.height * gpuBytesPerChan_;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    source.pbo->unbind(GL_PIXEL_UNPACK_BUFFER);
+    source.fence = context_.issueSync();
+    source.status = InputSlot::FREE;
+}
+
+
+/**
+ * @brief Allocate ring of pixel buffers for zero-copy uploads
+ *
+ * Uses persistently (and coherently) mapped buffers where supported, regular pixel buffers that
+ * are mapped on acquisition otherwise.
+ */
+void UploadLayer::setupInputSlots() {
+    using namespace opengl;
+    cleanupInputSlots();
+    int width = width_ + 2 * inputPadding_;
+    int height = height_ + 2 * inputPadding_;
+    slotBytes_ = uploadBytes();
+    persistentSlots_ = PBO::supportsPersistentMapping();
+    slots_.resize(numSlots_);
+    for (InputSlot & slot : slots_) {
+        slot.pbo = new PBO(width, height, inputChannels_, gpuBytesPerChan_, context_);
+        if (persistentSlots_) {
+            slot.pbo->prepareForPersistentWrite(slotBytes_);
+            slot.mapped = slot.pbo->mapPersistentWriteBuffer();
+        } else {
+            slot.pbo->prepareForWrite(slotBytes_);
+        }
+    }
+    nextSlot_ = 0;
+}
+
+
+/**
+ * @brief Release ring of pixel buffers for zero-copy uploads (if any)
+ */
+void UploadLayer::cleanupInputSlots() {
+    for (InputSlot & slot : slots_) {
+        if (slot.fence) context_.removeSync(slot.fence);
+        if ((!persistentSlots_) && (slot.mapped)) {
+            slot.pbo->bind(GL_PIXEL_UNPACK_BUFFER);
+            slot.pbo->unmapWriteBuffer();
+            slot.pbo->unbind(GL_PIXEL_UNPACK_BUFFER);
+        }
+        FNET_DEL_AND_CLEAR(slot.pbo);
+    }
+    slots_.clear();
+    submitted_.clear();
+}
+
+
+/**
+ * @brief Convert CPU data to the GPU-side data type for upload (if necessary)
+ *
+ * @param srcData Pointer to CPU-side data
+ * @param entries Number of (channel) elements in \p srcData
+ *
+ * @return Pointer to data that can be handed to the GL upload functions, which is either
+ *         \p srcData itself or a pointer to an internal conversion buffer
+ *
+ * For half-precision uploads, this converts the 32-bit floating-point data in the CPU buffer
+ * to 16-bit data, which halves the amount of data to be transferred to the GPU. All other data
+ * types are passed through unchanged.
+ */
+const void * UploadLayer::convertForUpload(const void *srcData, size_t entries) {
+    if (dataType_ != BufferSpec::dtype::FLOAT16) return srcData;
+    if (halfBuffer_.size() < entries) halfBuffer_.resize(entries);
+    FloatConversion::getInstance()->toFP16((const float *)srcData, halfBuffer_.data(), entries);
+    return halfBuffer_.data();
+}
+
+
+/**
+ * @brief Get dimensions of the textures written by a (non-sequence) upload
+ *
+ * @return Vector of texture dimensions, in the order in which the texture data is stored in the
+ *         input buffer
+ *
+ * For regular uploads, each texture holds (up to) 4 channels of the full (padded) image. NV12
+ * uploads write a single-channel luminance texture at full resolution and a two-channel
+ * chrominance texture at half the resolution.
+ */
+std::vector<UploadLayer::Plane> UploadLayer::planes() const {
+    std::vector<Plane> result;
+    if (nv12_) {
+        result.push_back({width_, height_, 1});
+        result.push_back({width_ / 2, height_ / 2, 2});
     } else {
         int width = width_ + 2 * inputPadding_;
         int height = height_ + 2 * inputPadding_;
-        while (rem > 0) {
-            GLuint tex = outputTextures_.at(texoffs++);
-            int chans = std::min(rem, LayerBase::PIXEL_PACKING);
-            auto format = BufferSpec::formatByChannels(chans, dataType_);
-            glBindTexture(GL_TEXTURE_2D, tex);
-            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, (GLenum) format.second, (GLenum) dataType_, srcptr);
-            srcptr += chans * width * height * bytesPerChan_;
-            rem -= LayerBase::PIXEL_PACKING;
+        for (int rem = inputChannels_; rem > 0; rem -= PIXEL_PACKING) {
+            result.push_back({width, height, std::min(rem, PIXEL_PACKING)});
         }
     }
-    input_->unmap();
+    return result;
+}
+
+
+/**
+ * @brief Get total number of bytes transferred to the GPU by a (non-sequence) upload
+ *
+ * @return Number of bytes to transfer, based on the GPU-side data type
+ */
+size_t UploadLayer::uploadBytes() const {
+    size_t bytes = 0;
+    for (const Plane & plane : planes()) bytes += (size_t)plane.width * plane.height * plane.channels * gpuBytesPerChan_;
+    return bytes;
 }
 
 
@@ -493,8 +748,8 @@ bool UploadLayer::asyncUpload(uint64_t sequenceNo, StateToken * token, const std
     {
         std::unique_lock<std::mutex> asy(asyncLock_);
         int bufferidx = -1;
-        if (locked_ < ASYNC_BUFFERS) {
-            for (int i=0; i < ASYNC_BUFFERS; i++) {
+        if (locked_ < (int)inFlight_.size()) {
+            for (int i=0; i < (int)inFlight_.size(); i++) {
                 if (!inFlight_[i]) {
                     bufferidx = i;
                     break;
@@ -512,7 +767,9 @@ bool UploadLayer::asyncUpload(uint64_t sequenceNo, StateToken * token, const std
         // Get PBO to buffer the CPU-side data for the upload and
         // schedule thread to handle the async upload...
         //------------------------------------------------------------
-        const GLvoid * srcptr = input_->map<GLvoid>();
+        // NOTE (mw) with more than one upload in flight, the previous upload task may still hold the
+        // mapping of the input buffer, wait for it to be released (see asyncUploadTask())
+        const GLvoid * srcptr = input_->map<GLvoid>(true);
         if (!srcptr) {
             THROW_EXCEPTION_ARGS(FynException,"Cannot map source CPU buffer for (async) texture upload");
         }
@@ -520,15 +777,15 @@ bool UploadLayer::asyncUpload(uint64_t sequenceNo, StateToken * token, const std
         PBOPool * pool = context_.interface()->getWritePBOPool();
         assert(pool);
         if (maxSequenceLength_ > 0) {
-            ManagedPBO pbo = pool->getAvailablePBO(viewport_[0], token->seqLength, seqPacking_, bytesPerChan_);
+            ManagedPBO pbo = pool->getAvailablePBO(viewport_[0], token->seqLength, seqPacking_, gpuBytesPerChan_);
             assert(!pbo.isPending());
-            size_t size = viewport_[0] * token->seqLength * seqPacking_ * bytesPerChan_;
+            size_t size = viewport_[0] * token->seqLength * seqPacking_ * gpuBytesPerChan_;
             thread->setTask(std::bind(&UploadLayer::asyncUploadTask, this, pbo, srcptr, sequenceNo, input_, bufferidx,
                                       viewport_[0], token->seqLength, size, callback));
         } else {
-            ManagedPBO pbo = pool->getAvailablePBO(width_, height_, inputChannels_, bytesPerChan_);
+            ManagedPBO pbo = pool->getAvailablePBO(width_, height_, inputChannels_, gpuBytesPerChan_);
             assert(!pbo.isPending());
-            size_t size = width_ * height_ * inputChannels_ * bytesPerChan_;
+            size_t size = uploadBytes();
             thread->setTask(std::bind(&UploadLayer::asyncUploadTask, this, pbo, srcptr, sequenceNo, input_, bufferidx,
                                       width_, height_, size, callback));
         }
@@ -544,11 +801,21 @@ bool UploadLayer::asyncUpload(uint64_t sequenceNo, StateToken * token, const std
  * @brief Swap/set output textures to dependent layers based on sequence number
  *
  * @param sequence Sequence number of the sequence that is running with the next upload
+ *
+ * @throws FynException if there is no texture set associated with the supplied \p sequence
+ *
+ * Looks up the texture set that was used to upload the data for the supplied \p sequence and
+ * connects it to the dependent layers.
  */
 void UploadLayer::swapOutputTextures(uint64_t sequence) {
     std::unique_lock<std::mutex> asy(asyncLock_);
-    const std::vector<GLuint> & textures = ((inFlight_[0] == sequence) ? outputTextures_ : shadowTextures_[0]);
-    updateDependencies(textures);
+    for (int i=0; i < (int)inFlight_.size(); i++) {
+        if (inFlight_[i] == sequence) {
+            updateDependencies((i == 0) ? outputTextures_ : shadowTextures_[i-1]);
+            return;
+        }
+    }
+    THROW_EXCEPTION_ARGS(FynException, "No texture set for sequence %" PRIu64 " in layer %s", sequence, getName().c_str());
 }
 #endif
 
@@ -606,7 +873,12 @@ void UploadLayer::asyncUploadTask(opengl::ManagedPBO& pbo, const void *srcData,
         pbo->prepareForWrite(totalSize, true);
         void * pbobuffer = pbo->mapWriteBuffer(totalSize);
         assert(pbobuffer);
-        memcpy(pbobuffer, srcData, totalSize);
+        if (dataType_ == BufferSpec::dtype::FLOAT16) {
+            // convert directly into the PBO, which halves the amount of data to be transferred
+            FloatConversion::getInstance()->toFP16((const float *)srcData, (uint16_t *)pbobuffer, totalSize / sizeof(uint16_t));
+        } else {
+            memcpy(pbobuffer, srcData, totalSize);
+        }
         buffer->unmap();
         // ------------------------------------------------
         // The input buffer can be re-used now, if we have
@@ -617,19 +889,18 @@ void UploadLayer::asyncUploadTask(opengl::ManagedPBO& pbo, const void *srcData,
         // Upload PBO to textures...
         // ------------------------------------------------
         pbo->unmapWriteBuffer();
-        int rem = inputChannels_;
-        int texoffset = 0;
-        uint32_t offset = 0;
+        size_t offset = 0;
         const std::vector<GLuint>& textures =  (texIdx == 0) ? outputTextures_ : shadowTextures_[texIdx-1];
-        while (rem > 0) {
-            int chans = std::min(rem, LayerBase::PIXEL_PACKING);
-            auto format = BufferSpec::formatByChannels(chans, dataType_);
-            GLuint tex = textures.at(texoffset);
-            glBindTexture(GL_TEXTURE_2D, tex);
-            glTexImage2D(GL_TEXTURE_2D, 0, (GLint)format.first, width, height, 0, (GLenum)format.second, (GLenum)dataType_, (const GLvoid *)(uintptr_t)offset);
-            rem -= LayerBase::PIXEL_PACKING;        // we don't care about underflows
-            offset += width * height * bytesPerChan_ * LayerBase::PIXEL_PACKING;
+        std::vector<Plane> targets = (maxSequenceLength_ > 0) ? std::vector<Plane>{{width, height, seqPacking_}} : planes();
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (int t=0; t < (int)targets.size(); t++) {
+            const Plane & plane = targets[t];
+            auto format = BufferSpec::formatByChannels(plane.channels, dataType_);
+            opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, textures.at(t));
+            glTexImage2D(GL_TEXTURE_2D, 0, (GLint)format.first, plane.width, plane.height, 0, (GLenum)format.second, (GLenum)dataType_, (const GLvoid *)(uintptr_t)offset);
+            offset += (size_t)plane.width * plane.height * plane.channels * gpuBytesPerChan_;
         }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
         pbo->unbind(GL_PIXEL_UNPACK_BUFFER);
         // ------------------------------------------------
         // The texture generation is complete, notify the
@@ -16,6 +16,8 @@
 #include <atomic>
 #include <functional>
 #include <condition_variable>
+#include <vector>
+#include <deque>
 
 //-------------------------------------- Project  Headers ------------------------------------------
 
@@ -28,6 +30,7 @@
 #include "../cpu/cpubuffer.h"
 #include "../gl/pbopool.h"
 #include "../gl/managedpbo.h"
+#include "../gl/pbo.h"
 
 //------------------------------------- Public Declarations ----------------------------------------
 namespace fyusion::fyusenet::gpu {
@@ -60,16 +63,30 @@ namespace fyusion::fyusenet::gpu {
  *
  * In order to make sure not to overwrite %PBO buffer data \e before it was actually set up as
  * texture (due to asynchronicity between the CPU and the GPU), the individual texture set
- * (currently 2) of this layer has to be "unlocked" before the next (asynchronous) upload on the
+ * (the number of sets is given by the pipeline depth, see UpDownLayerBuilder::async()) of this
+ * layer has to be "unlocked" before the next (asynchronous) upload on the
  * same set can start. The unlocking must happen \e after \e all layers that consume the texture(s)
  * written by this layer have read the data and written their own output. The only way to ensure
  * that, is by using appropriate fences which is handled by the Engine class.
  *
+ * For high-bandwidth inputs (e.g. video streams), synchronous upload layers can be built with
+ * zero-copy support (see UpDownLayerBuilder::zeroCopy()). In that mode, the caller acquires a
+ * writable pointer into a ring of pixel buffers using acquireInputSlot(), writes the data in the
+ * same format as it would be stored in the CPU buffer and submits it using submitInputSlot(). The
+ * next forward() call then uploads the texture(s) directly from the pixel buffer. Where
+ * supported, the pixel buffers are persistently mapped, otherwise they are mapped between
+ * acquisition and submission.
+ *
+ * Image data can be uploaded as 8-bit data by setting the data type to \c UBYTE, in which case
+ * the data is stored in normalized 8-bit textures that yield values in [0,1] when sampled. This
+ * reduces the upload bandwidth to a quarter compared to floating-point data and removes the
+ * conversion pass on the CPU. In addition, the layer can ingest NV12 frames (see
+ * UpDownLayerBuilder::nv12()), which are stored as a luminance and a chrominance texture. Use an
+ * ImgPreprocLayer to convert those to normalized floating-point RGB tensors.
+ *
  * @see Engine::waitForUploadFence(), Engine::execute()
  */
 class UploadLayer : public GPULayerBase, public cpu::CPULayerInterface, public GPUAsyncLayer {
-    // NOTE (mw) a lot of assumptions in the code rely on this number to be 2, refactor the code if you change this to higher numbers
-    constexpr static int ASYNC_BUFFERS = 2;
  public:
     // ------------------------------------------------------------------------
     // Constructor / Destructor
@@ -93,6 +110,41 @@ class UploadLayer : public GPULayerBase, public cpu::CPULayerInterface, public G
     void unlock(uint64_t sequenceNo);
 #endif
     void clearCPUInputBuffers(int port = -1) override;
+    void * acquireInputSlot(int & slot);
+    void submitInputSlot(int slot);
+
+    /**
+     * @brief Get number of texture sets used for asynchronous uploads
+     *
+     * @return Pipeline depth of the layer, which is 1 for synchronous layers
+     */
+    [[nodiscard]] int pipelineDepth() const {
+#ifdef FYUSENET_MULTITHREADING
+        return (async_) ? (int)inFlight_.size() : 1;
+#else
+        return 1;
+#endif
+    }
+
+    /**
+     * @brief Check if a zero-copy input slot has been submitted and awaits upload
+     *
+     * @retval true if there is at least one submitted slot that will be used by the next forward()
+     * @retval false otherwise
+     */
+    [[nodiscard]] bool hasSubmittedInput() const {
+        return !submitted_.empty();
+    }
+
+    /**
+     * @brief Get size of a zero-copy input slot
+     *
+     * @return Number of bytes that a zero-copy input slot holds, or 0 if zero-copy uploads are
+     *         not enabled
+     */
+    [[nodiscard]] size_t inputSlotBytes() const {
+        return (slots_.empty()) ? 0 : slotBytes_;
+    }
 
     /**
      * @brief Get input buffer
@@ -195,6 +247,21 @@ class UploadLayer : public GPULayerBase, public cpu::CPULayerInterface, public G
     void setupFBOs() override;
     void updateFBOs() override;
     void syncUpload(StateToken * state);
+    void slotUpload();
+    void setupInputSlots();
+    void cleanupInputSlots();
+    const void * convertForUpload(const void *srcData, size_t entries);
+
+    /**
+     * @brief Dimensions of a single texture that is written by this layer
+     */
+    struct Plane {
+        int width;          //!< Width of the texture (in pixels)
+        int height;         //!< Height of the texture (in pixels)
+        int channels;       //!< Number of channels stored in the texture
+    };
+    [[nodiscard]] std::vector<Plane> planes() const;
+    [[nodiscard]] size_t uploadBytes() const;
 #ifdef FYUSENET_MULTITHREADING
     bool asyncUpload(uint64_t sequence, StateToken * token, const std::function<void(uint64_t)> & callback);
     void asyncUploadTask(opengl::ManagedPBO& pbo, const void *srcData, uint64_t sequence, CPUBuffer * buffer,
@@ -207,12 +274,37 @@ class UploadLayer : public GPULayerBase, public cpu::CPULayerInterface, public G
     BufferSpec::dtype dataType_;            //!< Data type for this layer
     CPUBuffer * input_ = nullptr;           //!< Pointer to assigned input CPU buffer
     bool async_ = false;                    //!< Synchronous/Asynchronous upload mode toggle
-    uint8_t bytesPerChan_ = 0;              //!< Bytes per channel
+    uint8_t bytesPerChan_ = 0;              //!< Bytes per channel (CPU side)
+    uint8_t gpuBytesPerChan_ = 0;           //!< Bytes per channel as transferred to the GPU (differs from #bytesPerChan_ for FP16 uploads)
+    std::vector<uint16_t> halfBuffer_;      //!< Conversion buffer for synchronous FP16 uploads
     int maxSequenceLength_ = 0;             //!< Maximum sequence length and indicator if sequence data is to be uploaded
     int seqPacking_ = PIXEL_PACKING;        //!< Packing factor for sequence items
+    bool nv12_ = false;                     //!< Indicator that NV12 frames (Y plane followed by interleaved UV plane) are uploaded
+
+    /**
+     * @brief Slot in the ring of pixel buffers for zero-copy uploads
+     */
+    struct InputSlot {
+        enum state {
+            FREE = 0,           //!< Slot may be acquired (after waiting for the #fence)
+            ACQUIRED,           //!< Slot is being written to by the caller
+            SUBMITTED           //!< Slot was submitted and waits for the next forward()
+        };
+        opengl::PBO * pbo = nullptr;                //!< Pixel buffer that backs the slot
+        void * mapped = nullptr;                    //!< Pointer to mapped memory (persistent or while acquired)
+        GfxContextLink::syncid fence = nullptr;     //!< Fence after last upload from this slot, \c nullptr if none
+        state status = FREE;                        //!< Current state of the slot
+    };
+
+    int numSlots_ = 0;                      //!< Number of slots for zero-copy uploads (0 if disabled)
+    std::vector<InputSlot> slots_;          //!< Ring of slots for zero-copy uploads
+    std::deque<int> submitted_;             //!< Indices of submitted slots in order of submission
+    int nextSlot_ = 0;                      //!< Next slot index to try on acquireInputSlot()
+    size_t slotBytes_ = 0;                  //!< Number of bytes per zero-copy upload slot
+    bool persistentSlots_ = false;          //!< Indicator whether slots are persistently mapped
 #ifdef FYUSENET_MULTITHREADING
     mutable std::mutex asyncLock_;          //!< Locks access to members used for asynchronous uploads
-    uint64_t inFlight_[ASYNC_BUFFERS];      //!< Stores sequence numbers of in-flight uploads, the index in the array relates to the texture set
+    std::vector<uint64_t> inFlight_;        //!< Stores sequence numbers of in-flight uploads, the index in the array relates to the texture set
     int locked_ = 0;                        //!< Number of locked texture sets, also see #asyncLock_
 
     /**
@@ -223,7 +315,7 @@ class UploadLayer : public GPULayerBase, public cpu::CPULayerInterface, public G
     /**
      * Multi-buffer shadow texture IDs
      */
-    std::vector<GLuint> shadowTextures_[ASYNC_BUFFERS-1];
+    std::vector<std::vector<GLuint>> shadowTextures_;
 #endif
 };
 
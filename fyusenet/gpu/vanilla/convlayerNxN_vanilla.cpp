@@ -74,13 +74,13 @@ void ConvLayerNxN::forward(uint64_t sequenceNo, StateToken * state) {
     if (err != GL_NO_ERROR) FNLOGD("HINT: glerror on render entry: 0x%x (%s:%d)[%s]",err,__FILE__,__LINE__,getName().c_str());
 #endif
     if (outputChanged_) updateFBOs();
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_CULL_FACE);
-    glEnable(GL_BLEND);
-    glBlendEquationSeparate(GL_FUNC_ADD,GL_FUNC_ADD);
-    glBlendFuncSeparate(GL_ONE,GL_ONE,GL_ONE,GL_ONE);
-    glViewport(0, 0, viewport_[0], viewport_[1]);
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_STENCIL_TEST);
+    opengl::GLStateCache::disable(GL_CULL_FACE);
+    opengl::GLStateCache::enable(GL_BLEND);
+    opengl::GLStateCache::blendEquationSeparate(GL_FUNC_ADD,GL_FUNC_ADD);
+    opengl::GLStateCache::blendFuncSeparate(GL_ONE,GL_ONE,GL_ONE,GL_ONE);
+    opengl::GLStateCache::viewport(0, 0, viewport_[0], viewport_[1]);
     ShaderProgram *shader = nullptr;
     if (!vertexArray_->bind()) {
         FNLOGE("Cannot render layer %s",getName().c_str());
@@ -96,16 +96,16 @@ void ConvLayerNxN::forward(uint64_t sequenceNo, StateToken * state) {
         if (flags_ & LayerFlags::RESIDUAL_INPUT) {
             for (int i=0;i<weights_->numRenderTargets(outfield);i++) {
                 int texindex = i+weights_->outputTextureOffset(outfield);
-                glActiveTexture(RESIDUAL_START_UNIT+i);
-                glBindTexture(GL_TEXTURE_2D,residualTextures_.at(texindex));
+                opengl::GLStateCache::activeTexture(RESIDUAL_START_UNIT+i);
+                opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,residualTextures_.at(texindex));
             }
         }
         int nummatrices = kernel_*weights_->numRenderTargets(outfield);
         framebuffers_.at(outfield)->bind();
         setBias(outfield,weights_);
-        glActiveTexture(GL_TEXTURE0);
+        opengl::GLStateCache::activeTexture(GL_TEXTURE0);
         for (int infield = 0; infield < weights_->numInputRenderPasses(); infield++) {
-            glBindTexture(GL_TEXTURE_2D,inputTextures_.at(infield));
+            opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputTextures_.at(infield));
             if (flags_ & LayerFlags::POST_BATCHNORM) {
                 shader->setMappedUniformVec4Array(BATCHNORM_DATA,weights_->getPackageBNScale(outfield),weights_->numRenderTargets(outfield));
             }
@@ -117,13 +117,13 @@ void ConvLayerNxN::forward(uint64_t sequenceNo, StateToken * state) {
                     if (outputPadding_ > 0) {
                         shader->setMappedUniformVec4Array(BIAS, weights_->getPackageBias(outfield), weights_->numRenderTargets(outfield));
                     }
-                    glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_SHORT,(const GLvoid *)(conv*6*sizeof(short)));
+                    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES,6,GL_UNSIGNED_SHORT,(const GLvoid *)(conv*6*sizeof(short)));
                     if (outputPadding_ > 0) {
                         shader->setMappedUniformVec4Array(BIAS,zeroBias_,weights_->numRenderTargets(outfield));
                     }
                     if (flags_ & LayerFlags::RESIDUAL_INPUT) shader->setMappedUniformValue(RESIDUAL_SWITCH,(GLint)0);
                 } else {
-                    glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_SHORT,(const GLvoid *)(conv*6*sizeof(short)));
+                    opengl::GLCommandBuffer::drawElements(GL_TRIANGLES,6,GL_UNSIGNED_SHORT,(const GLvoid *)(conv*6*sizeof(short)));
                 }
             }
         }
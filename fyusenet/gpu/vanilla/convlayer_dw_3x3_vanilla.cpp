@@ -94,13 +94,13 @@ void DepthwiseConvLayer3x3::forward(uint64_t sequenceNo, StateToken * state) {
     if (err != GL_NO_ERROR) FNLOGD("HINT: glerror on render entry: 0x%x (%s:%d)[%s]",err,__FILE__,__LINE__,getName().c_str());
 #endif
     if (outputChanged_) updateFBOs();
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_CULL_FACE);
-    glEnable(GL_BLEND);
-    glBlendEquationSeparate(GL_FUNC_ADD,GL_FUNC_ADD);
-    glBlendFuncSeparate(GL_ONE,GL_ONE,GL_ONE,GL_ONE);
-    glViewport(0,0,viewport_[0],viewport_[1]);
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_STENCIL_TEST);
+    opengl::GLStateCache::disable(GL_CULL_FACE);
+    opengl::GLStateCache::enable(GL_BLEND);
+    opengl::GLStateCache::blendEquationSeparate(GL_FUNC_ADD,GL_FUNC_ADD);
+    opengl::GLStateCache::blendFuncSeparate(GL_ONE,GL_ONE,GL_ONE,GL_ONE);
+    opengl::GLStateCache::viewport(0,0,viewport_[0],viewport_[1]);
     ShaderProgram *shader = nullptr;
     vertexArray_->bind();
     int textureoffset = 0;
@@ -114,8 +114,8 @@ void DepthwiseConvLayer3x3::forward(uint64_t sequenceNo, StateToken * state) {
         if (flags_ & LayerFlags::RESIDUAL_INPUT) {
             for (int i=0;i<weights_->numRenderTargets(outfield);i++) {
                 int texindex = i+weights_->outputTextureOffset(outfield);
-                glActiveTexture(GL_TEXTURE8+i);
-                glBindTexture(GL_TEXTURE_2D,residualTextures_.at(texindex));
+                opengl::GLStateCache::activeTexture(GL_TEXTURE8+i);
+                opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,residualTextures_.at(texindex));
             }
         }
         int numcvecs = kernel_ * kernel_ * weights_->numRenderTargets(outfield);
@@ -127,8 +127,8 @@ void DepthwiseConvLayer3x3::forward(uint64_t sequenceNo, StateToken * state) {
         }
         for (int infield = 0; infield < weights_->numInputRenderPasses(); infield++) {
             for (int t=0; t < weights_->numRenderTargets(outfield) ; t++) {
-                glActiveTexture(GL_TEXTURE0+t);
-                glBindTexture(GL_TEXTURE_2D,inputTextures_.at(t+textureoffset));
+                opengl::GLStateCache::activeTexture(GL_TEXTURE0+t);
+                opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputTextures_.at(t+textureoffset));
             }
 
             const float *cvecs = weights_->getPackageWeights(infield,outfield,0,0);
@@ -137,7 +137,7 @@ void DepthwiseConvLayer3x3::forward(uint64_t sequenceNo, StateToken * state) {
             if (outputPadding_ > 0) {
                 shader->setMappedUniformVec4Array(BIAS,weights_->getPackageBias(outfield),weights_->numRenderTargets(outfield));
             }
-            glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_SHORT,(const GLvoid *)nullptr);
+            opengl::GLCommandBuffer::drawElements(GL_TRIANGLES,6,GL_UNSIGNED_SHORT,(const GLvoid *)nullptr);
             if (outputPadding_ > 0) {
                 shader->setMappedUniformVec4Array(BIAS,zeroBias_,weights_->numRenderTargets(outfield));
             }
@@ -167,12 +167,12 @@ void DepthwiseConvLayer3x3::forward(uint64_t sequenceNo, StateToken * state) {
  */
 void DepthwiseConvLayer3x3::setBias(int outPass,const UniformWeightArray *bias) {
     if (outputPadding_ > 0) {
-        glClearColor(0.0f,0.0f,0.0f,0.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+        opengl::GLStateCache::clearColor(0.0f,0.0f,0.0f,0.0f);
+        opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
     } else {
         const float *data = bias->getPackageBias(outPass);
         for (int i=0; i < bias->numRenderTargets(outPass);i++) {
-            glClearBufferfv(GL_COLOR,i,data + i*PIXEL_PACKING);
+            opengl::GLCommandBuffer::clearBufferfv(GL_COLOR,i,data + i*PIXEL_PACKING);
         }
     }
 }
@@ -295,13 +295,13 @@ void ConvLayerBase::loadParameters(const ParameterProvider *weights) {
 void ConvLayerBase::setBias(int outPass, const UniformWeightArray *bias) {
     if (outputPadding_ > 0) {
         // if we have padding, the shader takes care, just clear the target FB here
-        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+        opengl::GLStateCache::clearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
     } else {
         // clear the target FB to the bias value
         const float * data = bias->getPackageBias(outPass);
         for (int i=0; i < bias->numRenderTargets(outPass); i++) {
-            glClearBufferfv(GL_COLOR, i, data + i * PIXEL_PACKING);
+            opengl::GLCommandBuffer::clearBufferfv(GL_COLOR, i, data + i * PIXEL_PACKING);
         }
     }
 }
@@ -43,8 +43,10 @@ namespace vanilla {
 FractionalConvLayerNxN::FractionalConvLayerNxN(const ConvLayerBuilder & builder, int layerNumber):ConvLayerNxN(builder, layerNumber) {
     if (builder.dilation_[0] > 1 || builder.dilation_[1] > 1) THROW_EXCEPTION_ARGS(FynException,"Dilations not supported for fractional convolution");
     sourceStep_ = builder.sourceStep_;
-    int tgtwidth = (int)((float)width_/(sourceStep_ * (float)downsample_[0]));
-    int tgtheight = (int)((float)height_/(sourceStep_ * (float)downsample_[1]));
+    // NOTE (mw) truncate with a small tolerance, -ffast-math may turn the division into a slightly off reciprocal multiplication
+    constexpr double EPSILON = 1e-4;
+    int tgtwidth = (int)((double)width_ / ((double)sourceStep_ * (double)downsample_[0]) + EPSILON);
+    int tgtheight = (int)((double)height_ / ((double)sourceStep_ * (double)downsample_[1]) + EPSILON);
     viewport_[0] = tgtwidth + 2*outputPadding_;
     viewport_[1] = tgtheight + 2*outputPadding_;
 }
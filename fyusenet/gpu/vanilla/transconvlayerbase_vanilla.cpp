@@ -76,7 +76,7 @@ void TransConvLayerBase::cleanup() {
     FNET_DEL_AND_CLEAR(indexBuffer_);
     FNET_DEL_AND_CLEAR(vertexArray_);
     if ((context_.isCurrent()) && (stencilBuffer_ != 0)) {
-        glDeleteTextures(1, &stencilBuffer_);
+        opengl::GLStateCache::deleteTextures(1, &stencilBuffer_);
     }
     stencilBuffer_ = 0;
     for (int i=0; i < NUM_STRATA; i++) {
@@ -132,18 +132,18 @@ void TransConvLayerBase::forward(uint64_t sequenceNo, StateToken * state) {
     if (err != GL_NO_ERROR) FNLOGD("HINT: glerror on render entry: 0x%x (%s:%d)[%s]",err,__FILE__,__LINE__,getName().c_str());
 #endif
     if (outputChanged_) updateFBOs();
-    glDisable(GL_CULL_FACE);
-    glEnable(GL_BLEND);
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_STENCIL_TEST);
-    glDepthFunc(GL_ALWAYS);
-    glDepthMask(GL_FALSE);
-    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
-    glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-    glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
-    glViewport(0, 0, viewport_[0], viewport_[1]);
-    glStencilMask(0xFF);
-    glClearColor(0,0,0,0);
+    opengl::GLStateCache::disable(GL_CULL_FACE);
+    opengl::GLStateCache::enable(GL_BLEND);
+    opengl::GLStateCache::enable(GL_DEPTH_TEST);
+    opengl::GLStateCache::enable(GL_STENCIL_TEST);
+    opengl::GLCommandBuffer::depthFunc(GL_ALWAYS);
+    opengl::GLCommandBuffer::depthMask(GL_FALSE);
+    opengl::GLCommandBuffer::stencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    opengl::GLStateCache::blendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+    opengl::GLStateCache::blendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
+    opengl::GLStateCache::viewport(0, 0, viewport_[0], viewport_[1]);
+    opengl::GLCommandBuffer::stencilMask(0xFF);
+    opengl::GLStateCache::clearColor(0,0,0,0);
     if (vertexArray_->bind()) {
         for (int outpass=0; outpass < weights_->numOutputRenderPasses(); outpass++) {
             framebuffers_.at(outpass)->bind();
@@ -156,8 +156,8 @@ void TransConvLayerBase::forward(uint64_t sequenceNo, StateToken * state) {
     } else {
         FNLOGE("Cannot render layer %s",getName().c_str());
     }
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_STENCIL_TEST);
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_STENCIL_TEST);
 }
 
 
@@ -221,18 +221,18 @@ void TransConvLayerBase::performInputPasses(UniformWeightArray *weights, int out
 #endif
     int ibooffset=0;
     for (int stratum=0; stratum < NUM_STRATA; stratum++) {
-        glStencilFuncSeparate(GL_FRONT_AND_BACK, GL_EQUAL, stratum+1, 0xFF);
+        opengl::GLCommandBuffer::stencilFuncSeparate(GL_FRONT_AND_BACK, GL_EQUAL, stratum+1, 0xFF);
         int xindex = stratum & 1;
         int yindex= (stratum & 2)>>1;
         ibooffset = (int)(stratum * 6 * sizeof(GLshort));
         shader = shaders_[stratum].at(weights->numRenderTargets(outputPass)).get();
         shader->bind(shaderStates_[stratum].at(weights->numRenderTargets(outputPass)).get());
-        glActiveTexture(GL_TEXTURE0);
+        opengl::GLStateCache::activeTexture(GL_TEXTURE0);
         for (int inpass=0; inpass < weights->numInputRenderPasses(); inpass++) {
-            glBindTexture(GL_TEXTURE_2D,inputTextures_.at(inpass));
+            opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,inputTextures_.at(inpass));
             const float *coeffs = weights->getPackageWeights(inpass,outputPass,xindex,yindex);
             shader->setMappedUniformMat4Array(COEFFICIENTS, coeffs, weights->numRenderTargets(outputPass));
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const char *)nullptr + ibooffset);
+            opengl::GLCommandBuffer::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (const char *)nullptr + ibooffset);
         }
     }
     if (shader) shader->unbind();
@@ -250,12 +250,12 @@ void TransConvLayerBase::performInputPasses(UniformWeightArray *weights, int out
  */
 void TransConvLayerBase::setBias(int outPass, const UniformWeightArray *bias) {
     if (outputPadding_ > 0) {
-        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+        opengl::GLStateCache::clearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
     } else {
         const float *data = bias->getPackageBias(outPass);
         for (int i = 0; i < bias->numRenderTargets(outPass); i++) {
-            glClearBufferfv(GL_COLOR, i, data + i * PIXEL_PACKING);
+            opengl::GLCommandBuffer::clearBufferfv(GL_COLOR, i, data + i * PIXEL_PACKING);
         }
     }
 }
@@ -472,7 +472,8 @@ void TransConvLayerBase::setupStencilBuffer() {
     // Setup renderbuffer that will hold the stencil
     //-----------------------------------------------
     glBindRenderbuffer(GL_RENDERBUFFER,stencilBuffer_);
-#ifndef ANDROID
+#if !defined(ANDROID) && !defined(FYUSENET_USE_EGL) && !defined(FYUSENET_USE_WEBGL)
+    // GL ES only accepts the sized depth/stencil format
     glRenderbufferStorage(GL_RENDERBUFFER,GL_DEPTH_STENCIL,viewport_[0],viewport_[1]);
 #else
     glRenderbufferStorage(GL_RENDERBUFFER,GL_DEPTH24_STENCIL8,viewport_[0],viewport_[1]);
@@ -488,9 +489,9 @@ void TransConvLayerBase::setupStencilBuffer() {
     // setup...
     //-----------------------------------------------
     GLuint helptex=0;
-    glActiveTexture(GL_TEXTURE0);
+    opengl::GLStateCache::activeTexture(GL_TEXTURE0);
     glGenTextures(1,&helptex);
-    glBindTexture(GL_TEXTURE_2D,helptex);
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D,helptex);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -596,20 +597,20 @@ void TransConvLayerBase::setupStencilBuffer() {
     //-----------------------------------------------
     //-----------------------------------------------
     fbo->bind();
-    glViewport(0,0,viewport_[0],viewport_[1]);
-    glStencilFuncSeparate(GL_FRONT_AND_BACK,GL_ALWAYS,0,0xFF);
-    glStencilMask(0xFF);
-    glClearColor(0,0,0,0);
-    glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT|GL_STENCIL_BUFFER_BIT);
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_STENCIL_TEST);
-    glDepthFunc(GL_ALWAYS);
-    glStencilOp(GL_KEEP,GL_KEEP,GL_INCR);
+    opengl::GLStateCache::viewport(0,0,viewport_[0],viewport_[1]);
+    opengl::GLCommandBuffer::stencilFuncSeparate(GL_FRONT_AND_BACK,GL_ALWAYS,0,0xFF);
+    opengl::GLCommandBuffer::stencilMask(0xFF);
+    opengl::GLStateCache::clearColor(0,0,0,0);
+    opengl::GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT|GL_STENCIL_BUFFER_BIT);
+    opengl::GLStateCache::enable(GL_DEPTH_TEST);
+    opengl::GLStateCache::enable(GL_STENCIL_TEST);
+    opengl::GLCommandBuffer::depthFunc(GL_ALWAYS);
+    opengl::GLCommandBuffer::stencilOp(GL_KEEP,GL_KEEP,GL_INCR);
     for (int pass=0;pass<4;pass++) {
         shader->setUniformValue("pass",pass);
-        glDrawArrays(GL_TRIANGLE_FAN,0,4);
+        opengl::GLCommandBuffer::drawArrays(GL_TRIANGLE_FAN,0,4);
     }
-    glDisable(GL_DEPTH_TEST);
+    opengl::GLStateCache::disable(GL_DEPTH_TEST);
     //-----------------------------------------------
     // ...and cleanup
     //-----------------------------------------------
@@ -617,7 +618,7 @@ void TransConvLayerBase::setupStencilBuffer() {
     fbo->unbind();
     vao->unbind();
     vbo->unbind();
-    glDeleteTextures(1,&helptex);
+    opengl::GLStateCache::deleteTextures(1,&helptex);
     delete vbo;
     delete vao;
     delete fbo;
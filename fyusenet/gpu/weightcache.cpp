@@ -0,0 +1,283 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Cache for Pre-Packed Weight Textures
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <cstdio>
+#include <cstring>
+#include <cinttypes>
+#include <cassert>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "../gl/xxhash64.h"
+#include "../common/logging.h"
+#include "../common/fynexception.h"
+#include "../base/parameterprovider.h"
+#include "floatconversion.h"
+#include "weightstore.h"
+#include "weightcache.h"
+
+namespace fyusion::fyusenet::gpu {
+
+//-------------------------------------- Local Definitions -----------------------------------------
+
+namespace {
+/**
+ * @brief On-disk header for a single cache entry
+ */
+struct EntryHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    int32_t width;
+    int32_t height;
+    int32_t internalFormat;
+    uint32_t format;
+    uint32_t dataType;
+    uint32_t reserved;
+    uint64_t bytes;
+};
+}
+
+/*##################################################################################################
+#                                   P U B L I C  F U N C T I O N S                                 #
+##################################################################################################*/
+
+/**
+ * @brief Constructor
+ *
+ * @param directory Path to (existing) directory that shall be used to store the cache files in
+ */
+WeightCache::WeightCache(const std::string& directory) : directory_(directory) {
+    if (directory_.empty()) THROW_EXCEPTION_ARGS(FynException, "Empty cache directory supplied");
+}
+
+
+/**
+ * @brief Load texture payload from cache
+ *
+ * @param key Cache key as computed by computeKey()
+ * @param[out] payload Payload object that receives the data
+ *
+ * @retval true if the payload was found in the cache and loaded
+ * @retval false otherwise
+ *
+ * Truncated or otherwise invalid cache files are treated as cache misses.
+ */
+bool WeightCache::load(uint64_t key, Payload& payload) const {
+    std::lock_guard<std::mutex> lck(lock_);
+    FILE *in = fopen(fileName(key).c_str(), "rb");
+    if (!in) {
+        misses_++;
+        return false;
+    }
+    EntryHeader hdr{};
+    bool ok = (fread(&hdr, sizeof(hdr), 1, in) == 1);
+    ok = ok && (hdr.magic == MAGIC) && (hdr.version == VERSION) && (hdr.key == key);
+    if (ok) {
+        payload.width = hdr.width;
+        payload.height = hdr.height;
+        payload.internalFormat = hdr.internalFormat;
+        payload.format = hdr.format;
+        payload.dataType = hdr.dataType;
+        payload.data.resize(hdr.bytes);
+        ok = (fread(payload.data.data(), 1, hdr.bytes, in) == hdr.bytes);
+    }
+    fclose(in);
+    if (ok) hits_++;
+    else {
+        FNLOGW("Invalid weight cache entry for key %016" PRIx64 ", ignoring", key);
+        misses_++;
+    }
+    return ok;
+}
+
+
+/**
+ * @brief Store texture payload in the cache
+ *
+ * @param key Cache key as computed by computeKey()
+ * @param payload Payload that shall be stored
+ *
+ * The payload is first written to a temporary file which is renamed to the final name once it
+ * has been completely written, such that concurrent readers never see partial entries. Failure
+ * to write to the cache is not considered an error and will only produce a warning.
+ */
+void WeightCache::store(uint64_t key, const Payload& payload) {
+    std::lock_guard<std::mutex> lck(lock_);
+    std::string target = fileName(key);
+    std::string temp = target + ".tmp";
+    FILE *out = fopen(temp.c_str(), "wb");
+    if (!out) {
+        FNLOGW("Cannot write weight cache file %s", temp.c_str());
+        return;
+    }
+    EntryHeader hdr{MAGIC, VERSION, key, payload.width, payload.height, payload.internalFormat,
+                    (uint32_t)payload.format, (uint32_t)payload.dataType, 0, (uint64_t)payload.data.size()};
+    bool ok = (fwrite(&hdr, sizeof(hdr), 1, out) == 1);
+    ok = ok && (fwrite(payload.data.data(), 1, payload.data.size(), out) == payload.data.size());
+    fclose(out);
+    if ((!ok) || (std::rename(temp.c_str(), target.c_str()) != 0)) {
+        FNLOGW("Cannot write weight cache file %s", target.c_str());
+        std::remove(temp.c_str());
+    }
+}
+
+
+/**
+ * @brief Upload payload to a texture
+ *
+ * @param texture GL texture handle to upload the payload to
+ *
+ * @pre The GL context that owns the \p texture must be current to the calling thread
+ *
+ * Binds the supplied \p texture, sets nearest-neighbor sampling with edge clamping (as expected
+ * by the layers that use parameter textures) and uploads the payload.
+ */
+void WeightCache::Payload::upload(GLuint texture) const {
+    opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, dataType, data.data());
+}
+
+
+/**
+ * @brief Compute cache key for a set of weights
+ *
+ * @param layerName Name of the layer that the weights belong to
+ * @param config Layer-specific string that encodes all parameters which influence the packed
+ *               data layout (e.g. kernel size, channel counts, precision)
+ * @param weights Pointer to raw (unpacked) weight data
+ * @param numWeights Number of elements in \p weights
+ *
+ * @return 64-bit key that identifies the packed payload
+ */
+uint64_t WeightCache::computeKey(const std::string& layerName, const std::string& config, const float *weights, size_t numWeights) {
+    using namespace opengl;
+    XXHash64 hash(VERSION);
+    hash.add(layerName.c_str(), layerName.size());
+    hash.add(config.c_str(), config.size());
+    if (weights) hash.add(weights, numWeights * sizeof(float));
+    return hash.hash();
+}
+
+
+/**
+ * @brief Pack RGBA float data into payload, performing FP16 conversion if requested
+ *
+ * @param[out] payload Payload object to write the data to
+ * @param weights Pointer to RGBA data, must be of size \p width x \p height x 4
+ * @param width Width of the data (in RGBA pixels)
+ * @param height Height of the data
+ * @param half If \c true, pack pairs of values as 16-bit floating-point numbers into a single
+ *             32-bit integer channel, which halves the width of the resulting texture
+ *
+ * This implements the common texture formats used by the deep-tensor layers for their parameter
+ * textures, see DeepConvLayerBase::loadParameters() for details.
+ */
+void WeightCache::packRGBA(Payload& payload, const float *weights, int width, int height, bool half) {
+    size_t entries = (size_t)width * (size_t)height * 4;
+#ifndef HIGH_PRECISION
+    if (half) {
+        if (width & 1) THROW_EXCEPTION_ARGS(FynException, "Requires even texture width for FP16 packing");
+        payload.width = width / 2;
+        payload.height = height;
+#ifdef GL_RGBA32UI
+        payload.internalFormat = GL_RGBA32UI;
+        payload.format = GL_RGBA_INTEGER;
+#else
+        payload.internalFormat = GL_RGBA32UI_EXT;
+        payload.format = GL_RGBA_INTEGER_EXT;
+#endif
+        payload.dataType = GL_UNSIGNED_INT;
+        payload.data.resize(entries * sizeof(uint16_t));
+        FloatConversion::getInstance()->toFP16(weights, (uint16_t *)payload.data.data(), entries);
+        return;
+    }
+    payload.internalFormat = GL_RGBA16F;
+#else
+    payload.internalFormat = GL_RGBA32F;
+#endif
+    payload.width = width;
+    payload.height = height;
+    payload.format = GL_RGBA;
+    payload.dataType = GL_FLOAT;
+    payload.data.resize(entries * sizeof(float));
+    memcpy(payload.data.data(), weights, payload.data.size());
+}
+
+
+/**
+ * @brief Obtain weight texture for a layer, using the cache and the store of a parameter provider
+ *
+ * @param provider Parameter provider that (optionally) carries a WeightCache and/or a WeightStore
+ * @param layerName Name of the layer that the weights belong to
+ * @param config Layer-specific string that encodes all parameters which influence the packed
+ *               data layout, see computeKey()
+ * @param weights Pointer to raw (unpacked) weight data
+ * @param numWeights Number of elements in \p weights
+ * @param pack Function that packs the raw weights into a texture payload
+ *
+ * @return GL handle of the weight texture
+ *
+ * @pre The GL context of the calling layer is current to the calling thread
+ *
+ * Looks up the texture in the WeightStore of the \p provider first. If it is not found there,
+ * the payload is loaded from the WeightCache of the \p provider or, failing that, packed using
+ * the supplied \p pack function (and stored in the cache). The payload is then uploaded to a new
+ * texture, which is handed over to the store. The key is only computed if the \p provider has a
+ * cache or a store attached.
+ *
+ * If the provider has a store attached, the caller must hand the texture back to the store via
+ * WeightStore::release() once it is no longer used, otherwise the caller owns the texture.
+ */
+GLuint WeightCache::obtainTexture(const ParameterProvider *provider, const std::string& layerName, const std::string& config,
+                                  const float *weights, size_t numWeights, const std::function<void(Payload&)>& pack) {
+    assert(provider);
+    WeightCache *cache = provider->weightCache();
+    WeightStore *store = provider->weightStore();
+    uint64_t key = ((cache) || (store)) ? computeKey(layerName, config, weights, numWeights) : 0;
+    GLuint texture = (store) ? store->acquire(key) : 0;
+    if (texture) return texture;
+    Payload payload;
+    if ((!cache) || (!cache->load(key, payload))) {
+        pack(payload);
+        if (cache) cache->store(key, payload);
+    }
+    glGenTextures(1, &texture);
+    payload.upload(texture);
+    if (store) texture = store->adopt(key, texture);
+    return texture;
+}
+
+
+/*##################################################################################################
+#                               N O N -  P U B L I C  F U N C T I O N S                            #
+##################################################################################################*/
+
+/**
+ * @brief Compose cache file name for a key
+ *
+ * @param key Cache key
+ *
+ * @return Full path to the cache file
+ */
+std::string WeightCache::fileName(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016" PRIx64 ".fwc", key);
+    return directory_ + "/" + name;
+}
+
+} // fyusion::fyusenet::gpu namespace
+
+// vim: set expandtab ts=4 sw=4:
@@ -0,0 +1,134 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Cache for Pre-Packed Weight Textures (Header)
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <functional>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "../gl/gl_sys.h"
+
+//------------------------------------- Public Declarations ----------------------------------------
+
+namespace fyusion::fyusenet {
+    class ParameterProvider;
+}
+
+namespace fyusion::fyusenet::gpu {
+
+/**
+ * @brief File-based cache for packed and format-converted weight textures
+ *
+ * Layers that store their parameters in textures (e.g. the deep convolution layers) have to
+ * reshuffle the raw weights into a tiled layout and convert them to the target precision on every
+ * startup. For larger networks, this consumes the majority of the CPU time spent in the setup.
+ *
+ * This class allows to store the final texture payload (the data that is handed over to
+ * \c glTexImage2D) in a directory, such that subsequent starts can skip the reshuffling and
+ * directly upload the payload to the GPU. Each entry is keyed by a 64-bit hash that is computed
+ * over the layer name, a layer-specific configuration string and the raw weight data, see
+ * computeKey(). Changing the weights or the layer configuration therefore automatically leads to
+ * a cache miss.
+ *
+ * To use the cache, attach it to a ParameterProvider instance prior to network setup:
+ * @code
+ * WeightCache cache("/tmp/weightcache");
+ * provider->setWeightCache(&cache);
+ * network->setup();
+ * @endcode
+ *
+ * @note The cache file format is not endian-aware and is not supposed to be shared between
+ *       different platforms.
+ *
+ * @see ParameterProvider::setWeightCache
+ */
+class WeightCache {
+ public:
+
+    /**
+     * @brief Texture payload as stored in the cache
+     */
+    struct Payload {
+        int width = 0;                      //!< Width of the texture (pixels)
+        int height = 0;                     //!< Height of the texture (pixels)
+        GLint internalFormat = 0;           //!< Internal (GPU) format of the texture
+        GLenum format = 0;                  //!< Pixel format of the payload
+        GLenum dataType = 0;                //!< Data type of the payload
+        std::vector<uint8_t> data;          //!< Raw payload data
+        void upload(GLuint texture) const;
+    };
+
+    // ------------------------------------------------------------------------
+    // Constructor / Destructor
+    // ------------------------------------------------------------------------
+    explicit WeightCache(const std::string& directory);
+
+    // ------------------------------------------------------------------------
+    // Public methods
+    // ------------------------------------------------------------------------
+    bool load(uint64_t key, Payload& payload) const;
+    void store(uint64_t key, const Payload& payload);
+
+    /**
+     * @brief Retrieve number of cache hits since construction
+     *
+     * @return Number of successful load() operations
+     */
+    [[nodiscard]] uint32_t hits() const {
+        std::lock_guard<std::mutex> lck(lock_);
+        return hits_;
+    }
+
+    /**
+     * @brief Retrieve number of cache misses since construction
+     *
+     * @return Number of unsuccessful load() operations
+     */
+    [[nodiscard]] uint32_t misses() const {
+        std::lock_guard<std::mutex> lck(lock_);
+        return misses_;
+    }
+
+    // ------------------------------------------------------------------------
+    // Static functions
+    // ------------------------------------------------------------------------
+    static uint64_t computeKey(const std::string& layerName, const std::string& config, const float *weights, size_t numWeights);
+    static void packRGBA(Payload& payload, const float *weights, int width, int height, bool half);
+    static GLuint obtainTexture(const ParameterProvider *provider, const std::string& layerName, const std::string& config,
+                                const float *weights, size_t numWeights, const std::function<void(Payload&)>& pack);
+
+ private:
+    // ------------------------------------------------------------------------
+    // Non-public methods
+    // ------------------------------------------------------------------------
+    [[nodiscard]] std::string fileName(uint64_t key) const;
+
+    // ------------------------------------------------------------------------
+    // Member variables
+    // ------------------------------------------------------------------------
+    std::string directory_;                 //!< Directory that stores the cache files
+    mutable std::mutex lock_;               //!< Lock for cache file access
+    mutable uint32_t hits_ = 0;             //!< Number of cache hits
+    mutable uint32_t misses_ = 0;           //!< Number of cache misses
+
+    constexpr static uint32_t MAGIC = 0x43574E46;          // 'FNWC'
+    constexpr static uint32_t VERSION = 1;
+};
+
+} // fyusion::fyusenet::gpu namespace
+
+// vim: set expandtab ts=4 sw=4:
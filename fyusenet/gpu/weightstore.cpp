@@ -0,0 +1,117 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Shared Store for Read-Only Weight Textures
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+
+//--------------------------------------- System Headers -------------------------------------------
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "../common/logging.h"
+#include "weightstore.h"
+#include "../gl/glstatecache.h"
+
+namespace fyusion::fyusenet::gpu {
+
+//-------------------------------------- Local Definitions -----------------------------------------
+
+
+/*##################################################################################################
+#                                   P U B L I C  F U N C T I O N S                                 #
+##################################################################################################*/
+
+/**
+ * @brief Destructor
+ *
+ * @note The destructor does not delete any GL textures, as there is no guarantee that a GL context
+ *       is current at this point. All layers that use textures from this store should be
+ *       cleaned up before the store is destroyed.
+ */
+WeightStore::~WeightStore() {
+    if (!entries_.empty()) {
+        FNLOGW("Destroying weight store with %d textures still in use", (int)entries_.size());
+    }
+}
+
+
+/**
+ * @brief Acquire shared weight texture
+ *
+ * @param key Key of the weight texture, see WeightCache::computeKey()
+ *
+ * @return GL handle of the shared texture or 0 if there is no texture for the supplied \p key
+ *
+ * On success, the reference count of the texture is increased and the caller must call release()
+ * once the texture is no longer used.
+ */
+GLuint WeightStore::acquire(uint64_t key) {
+    std::lock_guard<std::mutex> lck(lock_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) return 0;
+    it->second.refs++;
+    hits_++;
+    return it->second.texture;
+}
+
+
+/**
+ * @brief Hand over ownership of a weight texture to the store
+ *
+ * @param key Key of the weight texture, see WeightCache::computeKey()
+ * @param texture GL handle of the (fully uploaded) weight texture
+ *
+ * @return GL handle of the texture that should be used by the caller
+ *
+ * This adds the supplied \p texture to the store with a reference count of 1. In case another
+ * thread already added a texture for the same \p key in the meantime, the supplied \p texture
+ * is deleted and the existing texture is returned instead (with its reference count increased).
+ * In both cases, the caller must call release() once the texture is no longer used.
+ *
+ * @pre The GL context that created \p texture is current to the calling thread
+ */
+GLuint WeightStore::adopt(uint64_t key, GLuint texture) {
+    std::lock_guard<std::mutex> lck(lock_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        opengl::GLStateCache::deleteTextures(1, &texture);
+        it->second.refs++;
+        return it->second.texture;
+    }
+    entries_[key] = Entry{texture, 1};
+    keys_[texture] = key;
+    return texture;
+}
+
+
+/**
+ * @brief Release shared weight texture
+ *
+ * @param texture GL handle of the texture that was obtained by acquire() or adopt()
+ *
+ * Decreases the reference count of the supplied \p texture and deletes the texture once it is no
+ * longer used by any layer.
+ *
+ * @pre A GL context from the share group of the texture is current to the calling thread
+ */
+void WeightStore::release(GLuint texture) {
+    std::lock_guard<std::mutex> lck(lock_);
+    auto kit = keys_.find(texture);
+    if (kit == keys_.end()) {
+        FNLOGW("Texture %d is not part of the weight store", texture);
+        return;
+    }
+    auto it = entries_.find(kit->second);
+    if (--(it->second.refs) <= 0) {
+        opengl::GLStateCache::deleteTextures(1, &texture);
+        entries_.erase(it);
+        keys_.erase(kit);
+    }
+}
+
+} // fyusion::fyusenet::gpu namespace
+
+// vim: set expandtab ts=4 sw=4:
@@ -0,0 +1,113 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet
+//--------------------------------------------------------------------------------------------------
+// Shared Store for Read-Only Weight Textures (Header)
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include "../gl/gl_sys.h"
+
+//------------------------------------- Public Declarations ----------------------------------------
+
+namespace fyusion::fyusenet::gpu {
+
+/**
+ * @brief Reference-counted store for weight textures that are shared between network instances
+ *
+ * Each layer that stores its parameters in textures usually uploads its own copy of the weights
+ * during loadParameters(). When running multiple instances of the same network in one process
+ * (for example to process several streams concurrently or to run the same model on different
+ * input sizes), the GPU memory for the weights is multiplied by the number of instances.
+ *
+ * This class keeps track of weight textures by a 64-bit key that is computed over the layer name,
+ * the layer configuration and the raw weight data (see WeightCache::computeKey()). Layers that
+ * find their key in the store bind the existing texture instead of uploading their own copy. The
+ * textures are reference-counted and deleted once the last layer that uses them is cleaned up.
+ *
+ * Textures in the store are treated as read-only. In order to share the store between different
+ * GL contexts, the contexts must be in the same share group (e.g. created via
+ * GfxContextManager::createDerived()).
+ *
+ * To use the store, attach it to the ParameterProvider instances of all networks that should share
+ * their weights prior to network setup:
+ * @code
+ * WeightStore store;
+ * provider1->setWeightStore(&store);
+ * provider2->setWeightStore(&store);
+ * network1->setup();
+ * network2->setup();
+ * @endcode
+ *
+ * @warning The store must outlive all layers that acquired textures from it.
+ *
+ * @see ParameterProvider::setWeightStore, WeightCache
+ */
+class WeightStore {
+ public:
+    // ------------------------------------------------------------------------
+    // Constructor / Destructor
+    // ------------------------------------------------------------------------
+    WeightStore() = default;
+    ~WeightStore();
+
+    // ------------------------------------------------------------------------
+    // Public methods
+    // ------------------------------------------------------------------------
+    GLuint acquire(uint64_t key);
+    GLuint adopt(uint64_t key, GLuint texture);
+    void release(GLuint texture);
+
+    /**
+     * @brief Retrieve number of textures in the store
+     *
+     * @return Number of (distinct) weight textures currently held by the store
+     */
+    [[nodiscard]] size_t textures() const {
+        std::lock_guard<std::mutex> lck(lock_);
+        return entries_.size();
+    }
+
+    /**
+     * @brief Retrieve number of texture uploads that were avoided by the store
+     *
+     * @return Number of successful acquire() calls since construction
+     */
+    [[nodiscard]] uint32_t hits() const {
+        std::lock_guard<std::mutex> lck(lock_);
+        return hits_;
+    }
+
+ private:
+    /**
+     * @brief Single shared texture
+     */
+    struct Entry {
+        GLuint texture = 0;     //!< GL handle of the weight texture
+        int refs = 0;           //!< Number of layers that currently use the texture
+    };
+
+    // ------------------------------------------------------------------------
+    // Member variables
+    // ------------------------------------------------------------------------
+    std::unordered_map<uint64_t, Entry> entries_;       //!< Shared textures, indexed by weight key
+    std::unordered_map<GLuint, uint64_t> keys_;         //!< Reverse lookup from texture handle to weight key
+    mutable std::mutex lock_;                           //!< Serializes access from multiple (GL) threads
+    uint32_t hits_ = 0;                                 //!< Number of successful acquire() calls
+};
+
+} // fyusion::fyusenet::gpu namespace
+
+// vim: set expandtab ts=4 sw=4:
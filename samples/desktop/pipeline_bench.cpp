@@ -0,0 +1,344 @@
+//--------------------------------------------------------------------------------------------------
+// FyuseNet Samples                                                            (c) Fyusion Inc. 2023
+//--------------------------------------------------------------------------------------------------
+// End-to-End Latency/Throughput Benchmark Driver for (Asynchronous) Network Pipelines
+// Creator: Martin Wawro
+// SPDX-License-Identifier: MIT
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------- System Headers -------------------------------------------
+
+#include <cstdio>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <unordered_map>
+#include <condition_variable>
+
+//-------------------------------------- Project  Headers ------------------------------------------
+
+#include <fyusenet/fyusenet.h>
+#include "../samplenetworks/stylenet3x3.h"
+#include "../samplenetworks/stylenet9x9.h"
+#include "../samplenetworks/resnet50.h"
+#include "../helpers/stylenet_provider.h"
+#include "../helpers/resnet_provider.h"
+#include "cxxopts.hpp"
+
+//-------------------------------------- Global Variables ------------------------------------------
+
+/**
+ * Number of distinct synthetic frames that are cycled through
+ */
+constexpr int SYNTHETIC_FRAMES = 4;
+
+/**
+ * Frames that are submitted later than this after their scheduled arrival are counted as late
+ */
+constexpr std::chrono::milliseconds LATE_TOLERANCE{1};
+
+//-------------------------------------- Local Definitions -----------------------------------------
+
+using clk = std::chrono::steady_clock;
+using namespace fyusion::fyusenet;
+
+/**
+ * @brief Bookkeeping for all frames that were pushed into the network
+ *
+ * The submitting thread registers the arrival time of each frame under the sequence number
+ * that the network will issue for it. The completion time is either registered by the submitting
+ * thread (synchronous operation) or by the download callback (asynchronous operation).
+ */
+struct FrameLog {
+    std::mutex lock;
+    std::condition_variable done;
+    std::unordered_map<uint64_t, std::pair<clk::time_point, bool>> arrivals;   //!< Arrival (scheduled) time and measurement flag per sequence number
+    std::vector<double> latencies;                              //!< End-to-end latencies (ms) of completed frames
+    std::vector<double> blocked;                                //!< Time (ms) the submitting thread was blocked per frame
+    std::vector<int> depths;                                    //!< Number of frames in flight when a frame was submitted
+    uint64_t submitted = 0;
+    uint64_t completed = 0;
+    bool record = false;                                        //!< Set to \c true once the warmup is over
+
+    void arrive(uint64_t seq, clk::time_point when) {
+        std::lock_guard<std::mutex> lck(lock);
+        arrivals[seq] = std::make_pair(when, record);
+        if (record) depths.push_back((int)(submitted - completed));
+        submitted++;
+    }
+
+    void complete(uint64_t seq, clk::time_point when) {
+        std::lock_guard<std::mutex> lck(lock);
+        auto it = arrivals.find(seq);
+        if (it != arrivals.end()) {
+            if (it->second.second) latencies.push_back(std::chrono::duration<double, std::milli>(when - it->second.first).count());
+            arrivals.erase(it);
+        }
+        completed++;
+        done.notify_all();
+    }
+
+    bool drain(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lck(lock);
+        return done.wait_for(lck, timeout, [this]() { return completed >= submitted; });
+    }
+};
+
+
+/**
+ * @brief Compute percentile from sorted data (nearest-rank)
+ */
+static double percentile(const std::vector<double> & sorted, double pct) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = (size_t)std::ceil(pct / 100.0 * (double)sorted.size());
+    return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+}
+
+
+static double mean(const std::vector<double> & data) {
+    double accu = 0.0;
+    for (double val : data) accu += val;
+    return (data.empty()) ? 0.0 : accu / (double)data.size();
+}
+
+
+/**
+ * @brief Create random weight block for running networks without a weight file
+ */
+static std::vector<uint8_t> randomWeights(size_t bytes) {
+    std::vector<uint8_t> data(bytes);
+    std::mt19937 rng(0x1234);
+    std::uniform_real_distribution<float> dist(-0.05f, 0.05f);
+    auto * ptr = (float *)data.data();
+    for (size_t i=0; i < bytes / sizeof(float); i++) ptr[i] = dist(rng);
+    return data;
+}
+
+
+int main(int argc, char **argv) {
+    cxxopts::Options options(argv[0],"End-to-end latency/throughput benchmark for network pipelines");
+    options.add_options()("h,help","Get program help")
+                         ("n,network", "Network to run, one of stylenet3x3, stylenet9x9 or resnet50", cxxopts::value<std::string>()->default_value("stylenet3x3"))
+                         ("w,weights", "Weight file for the network (optional, random weights are used if not supplied)", cxxopts::value<std::string>())
+                         ("width", "Width of the synthetic input frames", cxxopts::value<int>()->default_value("256"))
+                         ("height", "Height of the synthetic input frames", cxxopts::value<int>()->default_value("256"))
+                         ("f,frames", "Number of frames to measure", cxxopts::value<int>()->default_value("100"))
+                         ("warmup", "Number of warmup frames before taking measurements", cxxopts::value<int>()->default_value("5"))
+                         ("fps", "Rate at which frames are fed into the network, 0 feeds frames as fast as possible", cxxopts::value<double>()->default_value("0"))
+                         ("read-pbos", "Size of the PBO pool for reading (downloads)", cxxopts::value<int>()->default_value("2"))
+                         ("write-pbos", "Size of the PBO pool for writing (uploads)", cxxopts::value<int>()->default_value("2"))
+                         ("program-cache", "File for caching linked shader program binaries across runs", cxxopts::value<std::string>())
+#ifdef FYUSENET_MULTITHREADING
+                         ("sync", "Use synchronous operation", cxxopts::value<bool>())
+                         ("depth", "Pipeline depth (number of frames in flight) for asynchronous operation", cxxopts::value<int>()->default_value("2"))
+                         ("threads", "Maximum number of GL background threads", cxxopts::value<int>()->default_value("4"))
+#endif
+                         ("csv", "Print results as single CSV line (with header) for comparing configurations", cxxopts::value<bool>());
+    auto opts = options.parse(argc, argv);
+
+    if (opts.count("help") > 0) {
+        std::cout<<options.help()<<std::endl;
+        return 0;
+    }
+    std::string netname = opts["network"].as<std::string>();
+    int width = opts["width"].as<int>();
+    int height = opts["height"].as<int>();
+    int frames = opts["frames"].as<int>();
+    int warmups = opts["warmup"].as<int>();
+    double fps = opts["fps"].as<double>();
+#ifdef FYUSENET_MULTITHREADING
+    bool sync = opts["sync"].as<bool>();
+    int depth = (sync) ? 1 : opts["depth"].as<int>();
+#else
+    bool sync = true;
+    int depth = 1;
+#endif
+    if ((netname != "stylenet3x3") && (netname != "stylenet9x9") && (netname != "resnet50")) {
+        std::cerr<<"Unsupported network "<<netname<<"\n";
+        return 1;
+    }
+    if ((width % 4) || (height % 4) || (frames <= 0)) {
+        std::cerr<<"Frame dimensions must be a multiple of 4 and at least one frame must be measured\n";
+        return 1;
+    }
+    // -------------------------------------------------------
+    // Setup GL context and thread/PBO pool...
+    // -------------------------------------------------------
+    auto glmgr = GfxContextManager::instance();
+    if (!glmgr) {
+        std::cerr<<"Cannot setup GL context\n";
+        return 1;
+    }
+    GfxContextLink ctx = glmgr->createMainContext();
+#ifdef FYUSENET_MULTITHREADING
+    fyusion::opengl::AsyncPool::setMaxGLThreads(opts["threads"].as<int>());
+#endif
+    glmgr->setupPBOPools(opts["read-pbos"].as<int>(), opts["write-pbos"].as<int>());
+    if (opts.count("program-cache") > 0) {
+        if (!glmgr->setupProgramBinaryCache(opts["program-cache"].as<std::string>())) {
+            std::cerr<<"WARNING: Program binaries not supported, ignoring program cache\n";
+        }
+    }
+    // -------------------------------------------------------
+    // Create synthetic input frames...
+    // -------------------------------------------------------
+    std::mt19937 rng(0x4321);
+    std::uniform_int_distribution<int> dist(0, 255);
+    std::vector<std::vector<uint8_t>> rgb(SYNTHETIC_FRAMES, std::vector<uint8_t>(width * height * 3));
+    std::vector<std::vector<float>> rgbf(SYNTHETIC_FRAMES, std::vector<float>(width * height * 3));
+    for (int f=0; f < SYNTHETIC_FRAMES; f++) {
+        for (size_t i=0; i < rgb[f].size(); i++) {
+            rgb[f][i] = (uint8_t)dist(rng);
+            rgbf[f][i] = (float)rgb[f][i] / 255.f;
+        }
+    }
+    // -------------------------------------------------------
+    // Instantiate network...
+    // -------------------------------------------------------
+    FrameLog log;
+    NeuralNetwork * net = nullptr;
+    std::function<void(int)> setinput;
+    auto setupstart = clk::now();
+    try {
+        bool weights = (opts.count("weights") > 0);
+        if (netname == "resnet50") {
+            auto * resnet = new ResNet50(true, true, ctx);
+            auto wgt = (weights) ? std::vector<uint8_t>() : randomWeights(ResNet50Provider::WEIGHT_BYTES);
+            resnet->setParameters((weights) ? new ResNet50Provider(opts["weights"].as<std::string>()) : new ResNet50Provider(wgt.data(), wgt.size()));
+            resnet->setInputSize(width, height);
+            setinput = [resnet, &rgb](int frame) { resnet->setInputBuffer(rgb[frame % SYNTHETIC_FRAMES].data()); };
+            net = resnet;
+        } else {
+            StyleNetBase * style = nullptr;
+            StyleNetProvider * params = nullptr;
+            if (netname == "stylenet3x3") {
+                style = new StyleNet3x3(width, height, true, true, ctx);
+                auto wgt = (weights) ? std::vector<uint8_t>() : randomWeights(StyleNet3x3Provider::STYLENET_SIZE * sizeof(float));
+                params = (weights) ? new StyleNet3x3Provider(opts["weights"].as<std::string>()) : new StyleNet3x3Provider(wgt.data(), wgt.size());
+            } else {
+                style = new StyleNet9x9(width, height, true, true, ctx);
+                auto wgt = (weights) ? std::vector<uint8_t>() : randomWeights(StyleNet9x9Provider::STYLENET_SIZE * sizeof(float));
+                params = (weights) ? new StyleNet9x9Provider(opts["weights"].as<std::string>()) : new StyleNet9x9Provider(wgt.data(), wgt.size());
+            }
+            style->setParameters(params);
+            setinput = [style, &rgbf](int frame) { style->setInputBuffer(rgbf[frame % SYNTHETIC_FRAMES].data()); };
+            net = style;
+        }
+#ifdef FYUSENET_MULTITHREADING
+        if (!sync) {
+            NeuralNetwork::AsyncAdapter callbacks;
+            callbacks.pipelineDepth(depth).downloadReady([&log](const std::string&, uint64_t seq, cpu::CPUBuffer *) {
+                log.complete(seq, clk::now());
+            });
+            net->asynchronous(callbacks);
+        }
+#endif
+        net->setup();
+        glFinish();
+    } catch (std::exception & ex) {
+        std::cerr<<"Cannot setup network: "<<ex.what()<<"\n";
+        return 1;
+    }
+    auto setupdone = clk::now();
+    // -------------------------------------------------------
+    // Feed frames at the requested rate. Frames that are
+    // late (because the submission was blocked) are pushed
+    // immediately, their latency includes the queueing
+    // delay...
+    // -------------------------------------------------------
+    auto period = (fps > 0.0) ? std::chrono::duration_cast<clk::duration>(std::chrono::duration<double>(1.0 / fps)) : clk::duration::zero();
+    int late = 0;
+    clk::time_point start, schedule;
+    for (int f=0; f < warmups + frames; f++) {
+        if (f == warmups) {
+            if (!log.drain(std::chrono::seconds(60))) std::cerr<<"WARNING: Warmup frames did not complete\n";
+            std::lock_guard<std::mutex> lck(log.lock);
+            log.record = true;
+            GfxContextLink::resetSyncWaitStatistics();
+            start = clk::now();
+            schedule = start;
+        }
+        if (log.record) {
+            if (period > clk::duration::zero()) {
+                if (clk::now() > schedule + LATE_TOLERANCE) late++;
+                std::this_thread::sleep_until(schedule);
+            } else schedule = clk::now();
+        }
+        clk::time_point arrival = (log.record) ? schedule : clk::now();
+        clk::time_point submit = clk::now();
+        uint64_t seq = net->nextSequenceNo();
+        log.arrive(seq, arrival);
+        setinput(f);
+        net->forward();
+        clk::time_point ret = clk::now();
+        if (log.record) log.blocked.push_back(std::chrono::duration<double, std::milli>(ret - submit).count());
+        if (sync) log.complete(seq, ret);
+        schedule += period;
+    }
+    if (!log.drain(std::chrono::seconds(60))) std::cerr<<"WARNING: Not all frames completed\n";
+    clk::time_point stop = clk::now();
+    uint64_t fencewaits, fencenanos;
+    GfxContextLink::syncWaitStatistics(fencewaits, fencenanos);
+    // -------------------------------------------------------
+    // Report...
+    // -------------------------------------------------------
+    std::vector<double> lat = log.latencies;
+    std::sort(lat.begin(), lat.end());
+    std::vector<double> blk = log.blocked;
+    std::sort(blk.begin(), blk.end());
+    double seconds = std::chrono::duration<double>(stop - start).count();
+    double setupms = std::chrono::duration<double, std::milli>(setupdone - setupstart).count();
+    double avgdepth = 0.0;
+    int maxdepth = 0;
+    for (int d : log.depths) {
+        avgdepth += (double)d;
+        maxdepth = std::max(maxdepth, d);
+    }
+    if (!log.depths.empty()) avgdepth /= (double)log.depths.size();
+#ifdef FYUSENET_MULTITHREADING
+    const char * mt = "on";
+#else
+    const char * mt = "off";
+#endif
+    if (opts["csv"].as<bool>()) {
+        std::cout<<"network,width,height,multithreading,mode,depth,read_pbos,write_pbos,fps,frames,late,throughput,lat_mean,lat_p50,lat_p95,lat_p99,lat_max,block_mean,block_p99,depth_mean,depth_max,fence_waits,fence_ms,setup_ms\n";
+        std::cout<<netname<<","<<width<<","<<height<<","<<mt<<","<<((sync) ? "sync" : "async")<<","<<depth<<","
+                 <<opts["read-pbos"].as<int>()<<","<<opts["write-pbos"].as<int>()<<","<<fps<<","<<lat.size()<<","<<late<<","
+                 <<(double)lat.size() / seconds<<","<<mean(lat)<<","<<percentile(lat, 50)<<","<<percentile(lat, 95)<<","
+                 <<percentile(lat, 99)<<","<<percentile(lat, 100)<<","<<mean(blk)<<","<<percentile(blk, 99)<<","
+                 <<avgdepth<<","<<maxdepth<<","<<fencewaits<<","<<(double)fencenanos / 1.0e6<<","<<setupms<<"\n";
+    } else {
+        std::cout<<std::fixed<<std::setprecision(3);
+        std::cout<<"Network:        "<<netname<<" ("<<width<<"x"<<height<<")\n";
+        std::cout<<"Configuration:  multithreading="<<mt<<" mode="<<((sync) ? "sync" : "async")<<" depth="<<depth
+                 <<" PBOs(read/write)="<<opts["read-pbos"].as<int>()<<"/"<<opts["write-pbos"].as<int>()<<"\n";
+        std::cout<<"Setup:          "<<setupms<<"ms (network construction and setup)\n";
+        std::cout<<"Frames:         "<<lat.size()<<" measured ("<<late<<" submitted late)";
+        if (fps > 0.0) std::cout<<" at "<<fps<<" fps target rate";
+        std::cout<<"\n";
+        std::cout<<"Throughput:     "<<(double)lat.size() / seconds<<" frames/s\n";
+        std::cout<<"Latency (ms):   mean="<<mean(lat)<<" p50="<<percentile(lat, 50)<<" p95="<<percentile(lat, 95)
+                 <<" p99="<<percentile(lat, 99)<<" max="<<percentile(lat, 100)<<"\n";
+        std::cout<<"Submit (ms):    mean="<<mean(blk)<<" p99="<<percentile(blk, 99)<<" (time blocked in setInputBuffer() + forward())\n";
+        std::cout<<"Queue depth:    mean="<<avgdepth<<" max="<<maxdepth<<" (frames in flight at submission)\n";
+        std::cout<<"Fence waits:    "<<fencewaits<<" waits, "<<(double)fencenanos / 1.0e6<<"ms total";
+        if (fencewaits > 0) std::cout<<", "<<(double)fencenanos / (1.0e3 * (double)fencewaits)<<"us per wait";
+        std::cout<<"\n";
+    }
+    // -------------------------------------------------------
+    // Cleanup
+    // -------------------------------------------------------
+    net->cleanup();
+    delete net;
+    ctx.reset();
+    glmgr->tearDown();
+    return 0;
+}
+
+
+// vim: set expandtab ts=4 sw=4:
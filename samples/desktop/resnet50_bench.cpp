@@ -36,7 +36,7 @@ constexpr int IMAGENET_CLASS_COUNT = 1000;
 //-------------------------------------- Local Definitions -----------------------------------------
 
 
-static float * readImage(const std::string& imageFile, int & width, int & height) {
+static uint8_t * readImage(const std::string& imageFile, int & width, int & height) {
     if (!JPEGIO::isJPEG(imageFile)) {
         std::cerr<<"File "<<imageFile<<" is not a JPEG file\n";
         return nullptr;
@@ -46,12 +46,7 @@ static float * readImage(const std::string& imageFile, int & width, int & height
         std::cerr<<"Cannot read "<<imageFile<<" make sure it is an RGB image\n";
         return nullptr;
     }
-    float * image = new float[width * height * 3];
-    for (int i=0; i < width*height*3; i++) {
-        image[i] = ((float)rgb[i]) / 255.f;
-    }
-    delete [] rgb;
-    return image;
+    return rgb;
 }
 
 
@@ -104,12 +99,8 @@ int main(int argc, char **argv) {
     // Read JPEG image that is to be processed
     // -------------------------------------------------------
     int width, height;
-    float * rgb = readImage(opts["input"].as<std::string>(), width, height);
+    uint8_t * rgb = readImage(opts["input"].as<std::string>(), width, height);
     if (!rgb) return 1;
-    if ((width != 224) || (height != 224)) {
-        std::cerr<<"Input image must be 224x224 pixels\n";
-        return 1;
-    }
     fyusion::fyusenet::cpu::CPUBuffer * download = nullptr;
 #ifdef FYUSENET_MULTITHREADING
     std::mutex waitlock;
@@ -139,6 +130,7 @@ int main(int argc, char **argv) {
     // Load weights, setup and run network...
     // -------------------------------------------------------
     net->setParameters(params);
+    net->setInputSize(width, height);
     net->setup();
     if (sync) net->setInputBuffer(rgb);
     for (int w=0 ; w < warmups; w++) {
@@ -61,7 +61,7 @@ ResNet50Provider::ResNet50Provider(const std::string& fileName) : ResNet50Provid
  * supplied memory block or file.
  */
 ResNet50Provider::ResNet50Provider() : fyusion::fyusenet::ParameterProvider() {
-    totalWeightBytes_ = 102304184;
+    totalWeightBytes_ = WEIGHT_BYTES;
     wbData_ = new float[totalWeightBytes_ / sizeof(float)];
     weightBlocks_.emplace(2, wrapper(wbData_ + 0));         // BN
     weightBlocks_.emplace(3, wrapper(wbData_ + 70));
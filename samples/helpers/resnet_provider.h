@@ -33,6 +33,8 @@ public:
     using param_type = fyusion::fyusenet::param_type;
     using wrapper = fyusion::fyusenet::DefaultDataWrapper<float>;
 
+    constexpr static size_t WEIGHT_BYTES = 102304184;   // number of bytes per network weights/biases
+
     ResNet50Provider(const uint8_t *memory, size_t bytes);
     explicit ResNet50Provider(const std::string& fileName);
 
@@ -85,8 +85,9 @@ class StyleNetProvider : public fyusion::fyusenet::ParameterProvider {
  * @brief Parameter provider for sample 3x3-conv-based Style-Transfer network(s)
  */
 class StyleNet3x3Provider : public StyleNetProvider {
-    constexpr static int STYLENET_SIZE = 77235;   // number of floats per network weights/biases
  public:
+    constexpr static int STYLENET_SIZE = 77235;   // number of floats per network weights/biases
+
     /**
      * Indices for the layer numbers
      */
@@ -118,8 +119,9 @@ class StyleNet3x3Provider : public StyleNetProvider {
  * @brief Parameter provider for sample 9x9-conv-based Style-Transfer network(s)
  */
 class StyleNet9x9Provider : public StyleNetProvider {
-    constexpr static int STYLENET_SIZE = 169059;   // number of floats per network weights/biases
 public:
+    constexpr static int STYLENET_SIZE = 169059;   // number of floats per network weights/biases
+
     /**
      * Indices for the layer numbers
      */
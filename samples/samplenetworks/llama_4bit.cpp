@@ -21,6 +21,7 @@
 #include "../helpers/llama_4bit_params.h"
 #include <fyusenet/common/miscdefs.h>
 #include <fyusenet/gpu/custom/sequence/linear_hadamard.h>
+#include <fyusenet/gpu/custom/sequence/linear_gateup.h>
 
 //-------------------------------------- Global Variables ------------------------------------------
 
@@ -249,12 +250,10 @@ int LlaMa4Bit::connectDecoderBlock(fyusion::fyusenet::CompiledLayers& layers, fy
     buffers->connectLayers(layers[startIndex + 1], layers[startIndex + 2], 0);   // ln0 -> att
     buffers->connectLayers(layers[startIndex], layers[startIndex + 2], 1);       // in -> att (residual)
     buffers->connectLayers(layers[startIndex + 2], layers[startIndex + 3], 0);   // att -> ln1
-    buffers->connectLayers(layers[startIndex + 3], layers[startIndex + 4], 0);   // ln1 -> gate
-    buffers->connectLayers(layers[startIndex + 3], layers[startIndex + 5], 0);   // ln1 -> up
-    buffers->connectLayers(layers[startIndex + 4], layers[startIndex + 6], 0);   // gate -> down
-    buffers->connectLayers(layers[startIndex + 5], layers[startIndex + 6], 1);   // up -> down
-    buffers->connectLayers(layers[startIndex + 2], layers[startIndex + 6], 2);   // att -> down (residual)
-    return startIndex + 6;
+    buffers->connectLayers(layers[startIndex + 3], layers[startIndex + 4], 0);   // ln1 -> gate/up
+    buffers->connectLayers(layers[startIndex + 4], layers[startIndex + 5], 0);   // gate/up -> down
+    buffers->connectLayers(layers[startIndex + 2], layers[startIndex + 5], 1);   // att -> down (residual)
+    return startIndex + 5;
 }
 
 
@@ -269,7 +268,7 @@ int LlaMa4Bit::connectDecoderBlock(fyusion::fyusenet::CompiledLayers& layers, fy
  *  1. Input layer-norm (RMS)
  *  2. Causally-masked multi-head attention
  *  3. Post-attention layer-norm (RMS)
- *  4. MLP part, consisting of gate layer, up and down layer
+ *  4. MLP part, consisting of a fused gate/up layer and the down layer
  */
 void LlaMa4Bit::buildDecoderBlock(std::shared_ptr<fyusion::fyusenet::LayerFactory> & factory, int blockNum) {
     using namespace fyusion::fyusenet;
@@ -299,28 +298,23 @@ void LlaMa4Bit::buildDecoderBlock(std::shared_ptr<fyusion::fyusenet::LayerFactor
     ln1bld->sequence(maxSequenceLen_).channels(embedDim_).type(LayerType::RMSNORM).context(context()).number(layerNo_++);
     ln1bld->push(factory);
     //-------------------------------------------------
-    // MLP part, gate layer...
+    // MLP part, gate and up projection in one layer
+    // (interleaved output, parameters are read from
+    // the separate gate/up entries)...
     //-------------------------------------------------
-    snprintf(name, sizeof(name), "dec%dgate", blockNum);
-    auto * gatebld = new gpu::LinearLayerBuilder(name);
-    gatebld->context(context()).quantize(qt_type::QT_MIXED_FLOAT, param_type::WGT_INT4).
-        quantGroupSize(quantGroupSize_).sequence(maxSequenceLen_).
-        inChannels(embedDim_).outChannels(mlpIntermediate_).number(layerNo_++);
-    gatebld->push(factory);
+    char gatename[256], upname[256];
+    snprintf(name, sizeof(name), "dec%dgateup", blockNum);
+    snprintf(gatename, sizeof(gatename), "dec%dgate", blockNum);
+    snprintf(upname, sizeof(upname), "dec%dup", blockNum);
+    auto * gateupbld = gpu::custom::sequence::LinearGateUpLayer::createBuilder(name, gatename, upname, qt_type::QT_MIXED_FLOAT, param_type::WGT_INT4, quantGroupSize_);
+    gateupbld->context(context()).sequence(maxSequenceLen_).inChannels(embedDim_).outChannels(mlpIntermediate_).number(layerNo_++);
+    gateupbld->push(factory);
     //-------------------------------------------------
-    // Up projection
-    //-------------------------------------------------
-    snprintf(name, sizeof(name), "dec%dup", blockNum);
-    auto * upbld = new gpu::LinearLayerBuilder(name);
-    upbld->context(context()).quantize(qt_type::QT_MIXED_FLOAT, param_type::WGT_INT4).
-            quantGroupSize(quantGroupSize_).sequence(maxSequenceLen_).
-            inChannels(embedDim_).outChannels(mlpIntermediate_).number(layerNo_++);
-    upbld->push(factory);
-    //-------------------------------------------------
-    // Down projection (w/ Hadamard product)
+    // Down projection (w/ SiLU on the gate and the
+    // Hadamard product applied on the input fetch)
     //-------------------------------------------------
     snprintf(name, sizeof(name), "dec%ddown", blockNum);
-    auto * dwnbld = gpu::custom::sequence::LinearHadamardLayer::createBuilder(name, qt_type::QT_MIXED_FLOAT, param_type::WGT_INT4, quantGroupSize_, false);
+    auto * dwnbld = gpu::custom::sequence::LinearHadamardLayer::createBuilder(name, qt_type::QT_MIXED_FLOAT, param_type::WGT_INT4, quantGroupSize_, false, true);
     dwnbld->context(context()).sequence(maxSequenceLen_).inChannels(mlpIntermediate_).outChannels(embedDim_).
     prefixAct(ActType::SILU, 1).residual().number(layerNo_++);
     dwnbld->push(factory);
@@ -104,9 +104,9 @@ fyusion::fyusenet::NeuralNetwork::execstate ResNet50::forward(fyusion::fyusenet:
 /**
  * @brief Try to set input CPU buffer to network by copying the supplied buffer contents
  *
- * @param data Pointer to 32-bit single-precision FP buffer. Must be the same dimensions as the
- *             network processing size and must be 3-channel RGB floats in [0,1] in shallow GPU
- *             order (i.e. triplets of RGB)
+ * @param data Pointer to 8-bit RGB buffer. Must have the dimensions set by setInputSize() (which
+ *             defaults to the network processing size) and must be in shallow GPU order (i.e.
+ *             triplets of RGB)
  *
  * @pre Network has been set up already
  *
@@ -125,7 +125,7 @@ fyusion::fyusenet::NeuralNetwork::execstate ResNet50::forward(fyusion::fyusenet:
  *          the input buffer to push the buffer through the pipeline, otherwise deadlocks will
  *          occur.
  */
-void ResNet50::setInputBuffer(const float *data) {
+void ResNet50::setInputBuffer(const uint8_t *data) {
     using namespace fyusion::fyusenet;
     assert(setup_);
 #ifdef FYUSENET_MULTITHREADING
@@ -139,7 +139,7 @@ void ResNet50::setInputBuffer(const float *data) {
     // -------------------------------------------------------
     for (int i=0; i < numbuffers; i++) {
         if (!inBuffers_[i]) {
-            inBuffers_[i] = new cpu::CPUBuffer(BufferShape(IMAGE_SIZE, IMAGE_SIZE, 3, 0, BufferShape::type::FLOAT32, BufferSpec::order::GPU_SHALLOW));
+            inBuffers_[i] = new cpu::CPUBuffer(BufferShape(inputHeight_, inputWidth_, 3, 0, BufferShape::type::UINT8, BufferSpec::order::GPU_SHALLOW));
         }
     }
     gpu::UploadLayer * upload = dynamic_cast<gpu::UploadLayer *>(engine_->getLayers()["upload"]);
@@ -147,26 +147,27 @@ void ResNet50::setInputBuffer(const float *data) {
     CPUBuffer * buf = nullptr;
     {
 #ifdef FYUSENET_MULTITHREADING
-        assert(usedUploadBuffers_ <= ASYNC_BUFFERS);
-        // -------------------------------------------------------
-        // For async uploads, we employ multiple upload buffers
-        // which we just cycle through.
-        // -------------------------------------------------------
-        std::unique_lock<std::mutex> lck(uploadBufferLock_);
-        uploadBufferAvail_.wait(lck, [this]() { return (uploadBusy_ == false) && (usedUploadBuffers_ < ASYNC_BUFFERS); });
-        if (upload->getCPUInputBuffer()) {
-            buf = (upload->getCPUInputBuffer() == inBuffers_[0]) ? inBuffers_[1] : inBuffers_[0];
+        if (async_) {
+            assert(usedUploadBuffers_ <= ASYNC_BUFFERS);
+            // -------------------------------------------------------
+            // For async uploads, we employ multiple upload buffers
+            // which we just cycle through.
+            // -------------------------------------------------------
+            std::unique_lock<std::mutex> lck(uploadBufferLock_);
+            uploadBufferAvail_.wait(lck, [this]() { return (uploadBusy_ == false) && (usedUploadBuffers_ < ASYNC_BUFFERS); });
+            if (upload->getCPUInputBuffer()) {
+                buf = (upload->getCPUInputBuffer() == inBuffers_[0]) ? inBuffers_[1] : inBuffers_[0];
+            } else buf = inBuffers_[0];
+            usedUploadBuffers_++;
+            uploadBusy_ = true;
         } else buf = inBuffers_[0];
-        usedUploadBuffers_++;
-        uploadBusy_ = true;
 #else
         buf = inBuffers_[0];
 #endif
     }
     // one deep-copy operation too many
-    float * tgt = buf->map<float>();
+    auto * tgt = buf->map<uint8_t>();
     assert(tgt);
-    // NOTE (mw) it would be cleaner to supply 4-channel data (RGBA) here
     memcpy(tgt, data, buf->shape().bytes(BufferShape::order::CHANNELWISE));
     buf->unmap();
     upload->setCPUInputBuffer(buf, 0);
@@ -207,12 +208,16 @@ fyusion::fyusenet::CompiledLayers ResNet50::buildLayers() {
     using namespace fyusion::fyusenet::gpu;
     std::shared_ptr<LayerFactory> factory = getLayerFactory();;
     if (upload_) {
+        // upload the 8-bit image as-is and convert/resize it on the GPU
         auto * up = new gpu::UpDownLayerBuilder(gpu::UpDownLayerBuilder::UPLOAD, "upload");
-        up->shape(3, 224, 224, 3).context(context()).number(0);
+        up->shape(3, inputHeight_, inputWidth_, 3).dataType(BufferSpec::dtype::UBYTE).context(context()).number(0);
 #ifdef FYUSENET_MULTITHREADING
         if (async_) up->async().callback(std::bind(&ResNet50::internalULCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
 #endif
         up->push(factory);
+        auto * prep = new gpu::ImgPreprocLayerBuilder("preproc");
+        prep->source(inputWidth_, inputHeight_).centerCrop(IMAGE_SIZE).shape(3, IMAGE_SIZE, IMAGE_SIZE, 3).context(context()).number(1);
+        prep->push(factory);
     }
     auto * bn2 = new GPULayerBuilder("BN2");
     bn2->type(LayerType::BATCHNORM).number(2).shape(3,224,224,3).outputPadding(1).context(context_);
@@ -439,7 +444,8 @@ fyusion::fyusenet::CompiledLayers ResNet50::buildLayers() {
 void ResNet50::connectLayers(fyusion::fyusenet::CompiledLayers & layers, fyusion::fyusenet::BufferManager * bufMgr) {
     using namespace fyusion::fyusenet;
     if (upload_) {
-        bufMgr->connectLayers(layers[0], layers[2],0);             // upload -> BN2
+        bufMgr->connectLayers(layers[0], layers[1],0);             // upload -> preproc
+        bufMgr->connectLayers(layers[1], layers[2],0);             // preproc -> BN2
     }
     bufMgr->connectLayers(layers[2], layers[3],0);                 // BN2 -> Conv3
     bufMgr->connectLayers(layers[3], layers[4],0);                 // Conv3 -> MaxPool4
@@ -42,9 +42,26 @@ class ResNet50 : public fyusion::fyusenet::NeuralNetwork {
     ~ResNet50() override;
 
     execstate forward(fyusion::fyusenet::StateToken * token) override;
-    void setInputBuffer(const float *data);
+    void setInputBuffer(const uint8_t *data);
     CPUBuffer * getOutputBuffer();
 
+    /**
+     * @brief Set size of the input images for buffer-driven networks
+     *
+     * @param width Width of the input images (in pixels)
+     * @param height Height of the input images (in pixels)
+     *
+     * @pre Network has not been set up yet
+     *
+     * Input images of arbitrary size are resized on the GPU such that the shorter side has the
+     * processing size of the network, followed by a center crop. The default input size is the
+     * processing size of the network.
+     */
+    void setInputSize(int width, int height) {
+        inputWidth_ = width;
+        inputHeight_ = height;
+    }
+
     /**
      * @brief Set raw input texture for the network
      *
@@ -84,6 +101,8 @@ class ResNet50 : public fyusion::fyusenet::NeuralNetwork {
     bool download_ = false;                         //!< Indicator that the network should end with a GPU->CPU download layer
     ResNet50Provider * parameters_ = nullptr;       //!< Pointer to instance that provides the weights/biases
     GLuint inputTexture_ = 0;                       //!< GL handle of input texture
+    int inputWidth_ = IMAGE_SIZE;                   //!< Width of the images supplied to setInputBuffer()
+    int inputHeight_ = IMAGE_SIZE;                  //!< Height of the images supplied to setInputBuffer()
     volatile bool inputTextureChanged_ = false;     //!< Indicator that the input texture has changed and needs to be re-bound
     std::string logDir_;
 
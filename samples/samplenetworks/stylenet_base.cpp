@@ -58,6 +58,7 @@ StyleNetBase::~StyleNetBase() {
         delete asyncDLBuffers_[i];
         asyncDLBuffers_[i] = nullptr;
     }
+    while (!parkedBuffers_.empty()) releaseResolution(parkedBuffers_.begin()->first.first, parkedBuffers_.begin()->first.second);
     delete parameters_;
     parameters_ = nullptr;
 }
@@ -131,18 +132,20 @@ void StyleNetBase::setInputBuffer(const float *data) {
     CPUBuffer * buf = nullptr;
     {
 #ifdef FYUSENET_MULTITHREADING
-        assert(usedUploadBuffers_ <= ASYNC_BUFFERS);
-        // -------------------------------------------------------
-        // For async uploads, we employ multiple upload buffers
-        // which we just cycle through.
-        // -------------------------------------------------------
-        std::unique_lock<std::mutex> lck(uploadBufferLock_);
-        uploadBufferAvail_.wait(lck, [this]() { return (uploadBusy_ == false) && (usedUploadBuffers_ < ASYNC_BUFFERS); });
-        if (upload->getCPUInputBuffer()) {
-            buf = (upload->getCPUInputBuffer() == inBuffers_[0]) ? inBuffers_[1] : inBuffers_[0];
+        if (async_) {
+            assert(usedUploadBuffers_ <= ASYNC_BUFFERS);
+            // -------------------------------------------------------
+            // For async uploads, we employ multiple upload buffers
+            // which we just cycle through.
+            // -------------------------------------------------------
+            std::unique_lock<std::mutex> lck(uploadBufferLock_);
+            uploadBufferAvail_.wait(lck, [this]() { return (uploadBusy_ == false) && (usedUploadBuffers_ < ASYNC_BUFFERS); });
+            if (upload->getCPUInputBuffer()) {
+                buf = (upload->getCPUInputBuffer() == inBuffers_[0]) ? inBuffers_[1] : inBuffers_[0];
+            } else buf = inBuffers_[0];
+            usedUploadBuffers_++;
+            uploadBusy_ = true;
         } else buf = inBuffers_[0];
-        usedUploadBuffers_++;
-        uploadBusy_ = true;
 #else
         buf = inBuffers_[0];
 #endif
@@ -228,6 +231,8 @@ GLuint StyleNetBase::getOutputTexture() const {
 void StyleNetBase::initializeWeights(fyusion::fyusenet::CompiledLayers & layers) {
     using namespace fyusion::fyusenet;
     assert(parameters_);
+    // share weight textures between the resolutions of this network (see resize())
+    if (!parameters_->weightStore()) parameters_->setWeightStore(sharedWeights());
     for (auto it = layers.begin(); it != layers.end(); ++it) {
         it.second->loadParameters(parameters_);
     }
@@ -235,6 +240,62 @@ void StyleNetBase::initializeWeights(fyusion::fyusenet::CompiledLayers & layers)
 
 
 
+/**
+ * @copydoc fyusion::fyusenet::NeuralNetwork::inputResolution
+ */
+std::pair<int,int> StyleNetBase::inputResolution() const {
+    return {width_, height_};
+}
+
+
+/**
+ * @brief Switch network to a different processing resolution
+ *
+ * @param width New processing width (pixels)
+ * @param height New processing height (pixels)
+ *
+ * Parks the CPU buffers of the current resolution and restores the buffers for the new resolution,
+ * in case that resolution was used before and is still in the resolution cache of the network.
+ * Input buffers for a new resolution are allocated on the next call to setInputBuffer() and
+ * download buffers are allocated by connectLayers().
+ *
+ * @see NeuralNetwork::resize()
+ */
+void StyleNetBase::setInputResolution(int width, int height) {
+    ResolutionBuffers & park = parkedBuffers_[{width_, height_}];
+    for (int i=0; i < ASYNC_BUFFERS; i++) {
+        park.in[i] = inBuffers_[i];
+        park.out[i] = asyncDLBuffers_[i];
+        inBuffers_[i] = nullptr;
+        asyncDLBuffers_[i] = nullptr;
+    }
+    width_ = width;
+    height_ = height;
+    auto it = parkedBuffers_.find({width, height});
+    if (it != parkedBuffers_.end()) {
+        for (int i=0; i < ASYNC_BUFFERS; i++) {
+            inBuffers_[i] = it->second.in[i];
+            asyncDLBuffers_[i] = it->second.out[i];
+        }
+        parkedBuffers_.erase(it);
+    }
+}
+
+
+/**
+ * @copydoc fyusion::fyusenet::NeuralNetwork::releaseResolution
+ */
+void StyleNetBase::releaseResolution(int width, int height) {
+    auto it = parkedBuffers_.find({width, height});
+    if (it == parkedBuffers_.end()) return;
+    for (int i=0; i < ASYNC_BUFFERS; i++) {
+        delete it->second.in[i];
+        delete it->second.out[i];
+    }
+    parkedBuffers_.erase(it);
+}
+
+
 #ifdef FYUSENET_MULTITHREADING
 /**
  * @brief Callback that is invoked when the pipeline completes an asynchronous download
@@ -12,6 +12,7 @@
 
 //--------------------------------------- System Headers -------------------------------------------
 
+#include <map>
 #include <unordered_map>
 #include <functional>
 #include <atomic>
@@ -138,6 +139,9 @@ class StyleNetBase : public fyusion::fyusenet::NeuralNetwork {
     // Non-public methods
     // ------------------------------------------------------------------------
     void initializeWeights(fyusion::fyusenet::CompiledLayers & layers) override;
+    [[nodiscard]] std::pair<int,int> inputResolution() const override;
+    void setInputResolution(int width, int height) override;
+    void releaseResolution(int width, int height) override;
 #ifdef FYUSENET_MULTITHREADING
     void internalDLCallback(uint64_t seqNo, fyusion::fyusenet::cpu::CPUBuffer *buffer, fyusion::fyusenet::AsyncLayer::state state);
     void internalULCallback(uint64_t seqNo, fyusion::fyusenet::cpu::CPUBuffer *buffer, fyusion::fyusenet::AsyncLayer::state state);
@@ -176,6 +180,22 @@ class StyleNetBase : public fyusion::fyusenet::NeuralNetwork {
      */
     fyusion::fyusenet::cpu::CPUBuffer * inBuffers_[ASYNC_BUFFERS] = {0};
 
+    /**
+     * @brief CPU buffers that are tied to an inactive resolution
+     *
+     * @see setInputResolution(), NeuralNetwork::resize()
+     */
+    struct ResolutionBuffers {
+        CPUBuffer * in[ASYNC_BUFFERS] = {nullptr};      //!< Input buffers, see #inBuffers_
+        CPUBuffer * out[ASYNC_BUFFERS] = {nullptr};     //!< Download buffers, see #asyncDLBuffers_
+    };
+
+    /**
+     * Stores the CPU buffers of input resolutions that are parked in the resolution cache of the
+     * network, indexed by width and height.
+     */
+    std::map<std::pair<int,int>, ResolutionBuffers> parkedBuffers_;
+
 #ifdef FYUSENET_MULTITHREADING
     std::mutex downloadBufferLock_;                     //!< Lock for use with #usedDownloadBuffers_ and #downloadBufferAvail_
     int usedDownloadBuffers_ = 0;                       //!< Number of currently used download buffers
@@ -61,10 +61,22 @@ class ResNetWrapper {
     /**
      * @brief Initialize / create ResNet network
      *
-     * This creates the underlying ResNet network
+     * @param width Width of the images that will be supplied to the network
+     * @param height Height of the images that will be supplied to the network
+     *
+     * This creates the underlying ResNet network for input images of the supplied size. Images
+     * of arbitrary size are resized on the GPU such that the shorter side matches the processing
+     * size of the network, followed by a center crop (same as the desktop sample).
      */
-    void init() {
+    void init(int width, int height) {
+        if (network_) {
+            network_->cleanup();
+            delete network_;
+        }
         network_ = new ResNet50(true, true, context_);
+        network_->setInputSize(width, height);
+        inputWidth_ = width;
+        inputHeight_ = height;
     }
 
     /**
@@ -75,11 +87,15 @@ class ResNetWrapper {
      *
      * @retval true if loading was successful
      * @retval false otherwise
+     *
+     * The supplied data must stay valid for the lifetime of the wrapper, as the network is
+     * re-created whenever the size of the input images changes.
      */
     bool loadWeights(void *dataPtr, size_t dataSize) {
+        weights_ = reinterpret_cast<uint8_t *>(dataPtr);
+        weightBytes_ = dataSize;
         try {
-            uint8_t * weights = reinterpret_cast<uint8_t *>(dataPtr);
-            auto * params = new ResNet50Provider(weights, dataSize);
+            auto * params = new ResNet50Provider(weights_, weightBytes_);
             network_->setParameters(params);
             network_->setup();
             delete params;
@@ -90,12 +106,22 @@ class ResNetWrapper {
         return true;
     }
 
+    /**
+     * @brief Run network on supplied RGB image
+     *
+     * @param rgb Pointer to interleaved 8-bit RGB data
+     * @param width Width of the image (in pixels)
+     * @param height Height of the image (in pixels)
+     *
+     * In case the image size differs from the input size the network was set up for, the network
+     * is re-created for the new size before running it.
+     */
     void runWithImage(const uint8_t * rgb, int width, int height) {
-        // slow conversion of image
-        float * rgbf = new float[width * height * 3];
-        for (int i=0; i < width*height*3; i++) rgbf[i] = (float)rgb[i] / 255.0f;
-        network_->setInputBuffer(rgbf);
-        delete [] rgbf;
+        if ((width != inputWidth_) || (height != inputHeight_)) {
+            init(width, height);
+            if (!loadWeights(weights_, weightBytes_)) return;
+        }
+        network_->setInputBuffer(rgb);
         network_->forward();
     }
 
@@ -103,6 +129,10 @@ class ResNetWrapper {
 
     fyusion::fyusenet::GfxContextLink context_;
     ResNet50 * network_ = nullptr;
+    uint8_t * weights_ = nullptr;              //!< Weight/bias data supplied by the host (not owned by this object)
+    size_t weightBytes_ = 0;                   //!< Number of bytes in #weights_
+    int inputWidth_ = 0;                       //!< Width of the input images the network is set up for
+    int inputHeight_ = 0;                      //!< Height of the input images the network is set up for
 };
 
 static ResNetWrapper * wrapper = nullptr;
@@ -136,31 +166,40 @@ extern "C" bool EMSCRIPTEN_KEEPALIVE initContext(char *canvas, int canvasWidth,
 }
 
 /**
- * @brief Create style-transfer net and initialize it with weights
+ * @brief Create ResNet and initialize it with weights
  *
+ * @param width Width of the images that will be supplied to the network
+ * @param height Height of the images that will be supplied to the network
  * @param dataPtr Pointer to weight/bias data
  * @param dataSize Number of bytes in the dataPtr buffer
  *
  * @retval true if initialization was successful
  * @retval false otherwise
  */
-extern "C" bool EMSCRIPTEN_KEEPALIVE createNetwork(void * dataPtr, size_t dataSize) {
+extern "C" bool EMSCRIPTEN_KEEPALIVE createNetwork(int width, int height, void * dataPtr, size_t dataSize) {
     if (wrapper) {
         try {
-            wrapper->init();
-            wrapper->loadWeights(dataPtr, dataSize);
+            wrapper->init(width, height);
+            return wrapper->loadWeights(dataPtr, dataSize);
         } catch (std::exception& ex) {
             return false;
         }
-        return true;
     }
     return false;
 }
 
 
-extern "C" void EMSCRIPTEN_KEEPALIVE setImage(void *ptr, size_t dataSize) {
-    // FIXME (mw) wrong
-    wrapper->runWithImage((const uint8_t *)ptr, 224, 224);
+/**
+ * @brief Run network on an RGB image
+ *
+ * @param ptr Pointer to interleaved 8-bit RGB data
+ * @param width Width of the image (in pixels)
+ * @param height Height of the image (in pixels)
+ *
+ * The image is resized and center-cropped to the processing size of the network on the GPU.
+ */
+extern "C" void EMSCRIPTEN_KEEPALIVE setImage(void *ptr, int width, int height) {
+    if (wrapper) wrapper->runWithImage((const uint8_t *)ptr, width, height);
 }
 
 
@@ -182,7 +221,7 @@ extern "C" void EMSCRIPTEN_KEEPALIVE tearDown() {
 extern "C" GLuint EMSCRIPTEN_KEEPALIVE createInputTexture() {
     GLuint tex=0;
     glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
+    fyusion::opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, tex);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -170,11 +170,11 @@ class StyleNetWrapper {
      */
     void blit(GLuint texID) {
         program_->bind();
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texID);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glViewport(0, 0, outputSize_[0], outputSize_[1]);
-        glDisable(GL_BLEND);
+        fyusion::opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+        fyusion::opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, texID);
+        fyusion::opengl::GLStateCache::bindFramebuffer(GL_FRAMEBUFFER, 0);
+        fyusion::opengl::GLStateCache::viewport(0, 0, outputSize_[0], outputSize_[1]);
+        fyusion::opengl::GLStateCache::disable(GL_BLEND);
         vao_->bind();
         quad_->draw();
         program_->unbind();
@@ -276,7 +276,7 @@ extern "C" void EMSCRIPTEN_KEEPALIVE forward(int texID) {
 extern "C" GLuint EMSCRIPTEN_KEEPALIVE createInputTexture() {
     GLuint tex=0;
     glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
+    fyusion::opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, tex);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -9,8 +9,10 @@
 //--------------------------------------- System Headers -------------------------------------------
 
 #include <cstdint>
+#include <cstdlib>
 #include <cmath>
 #include <fstream>
+#include <filesystem>
 #include <atomic>
 #include <memory>
 #include <thread>
@@ -24,6 +26,9 @@
 #include <fyusenet/gpu/vanilla/convlayerNxN_vanilla.h>
 #include <fyusenet/gpu/deep/deepconvlayer1x1.h>
 #include <fyusenet/gpu/deep/deepconvlayerNxN.h>
+#include <fyusenet/gpu/deep/deepdwconvlayer3x3.h>
+#include <fyusenet/gpu/weightcache.h>
+#include <fyusenet/gpu/weightstore.h>
 #include <fyusenet/base/layerfactory.h>
 #include <fyusenet/common/performance.h>
 #include "layertestbase.h"
@@ -427,6 +432,214 @@ TEST_F(ConvLayerTest, DeepConv3x3) {
     }
 }
 
+TEST_F(ConvLayerTest, DeepConv3x3Batched) {
+    const int kernel = 3;
+    const int width = 64;
+    const int height = 32;
+    const int inchans = 12;
+    const int outchans = 8;
+    const int batch = 3;
+    gpu::ConvLayerBuilder bld(kernel, "conv");
+    bld.context(context()).shape(outchans, height, width, inchans).type(LayerType::CONVOLUTION2D).number(1).deep().inputPadding((kernel-1)/2);
+    bld.batch(batch);
+    gpu::deep::DeepConvLayerNxN layer(bld, 1);
+    ASSERT_EQ(layer.getTiler()->getBatchSize(), batch);
+    int pwidth = width + layer.getInputPadding()*2;
+    int pheight = height + layer.getInputPadding()*2;
+    int insize = pwidth * pheight * inchans;
+    int outsize = width * height * outchans;
+    std::unique_ptr<float[]> input(new float[batch * insize]);
+    for (int img=0; img < batch; img++) {
+        std::unique_ptr<float[]> data(generateRandomData(inchans, width, height, -1.0f, 1.0f, layer.getInputPadding()));
+        memcpy(input.get() + img * insize, data.get(), insize * sizeof(float));
+    }
+    std::vector<const float *> inputs{input.get()};
+    generateTextures(&layer, inputs, nullptr, true);
+    std::unique_ptr<float[]> ckernel(new float[kernel * kernel]);
+    for (int i=0; i < kernel * kernel; i++) ckernel[i] = (float)(i - kernel) * 0.1f;
+    std::unique_ptr<float[]> wandb(stackConvolution(0.5f, ckernel.get(), kernel, kernel, inchans, outchans));
+    SingleWeightProvider wsrc(wandb.get() + outchans, wandb.get());
+    layer.loadParameters(&wsrc);
+    layer.setup();
+    layer.forward(1, nullptr);
+    std::unique_ptr<float[]> result(new float[batch * outsize]);
+    layer.copyResult(result.get(), false);
+    layer.cleanup();
+    for (int img=0; img < batch; img++) {
+        std::unique_ptr<float[]> ref(paddedConvolution(input.get() + img * insize, wandb.get(), outchans, kernel, kernel, inchans, pwidth, pheight));
+        const float * resptr = result.get() + img * outsize;
+        for (int i=0; i < outsize; i++) {
+            // random input data does not survive the half-precision textures unchanged
+            ASSERT_NEAR(resptr[i], ref[i], 2e-2f);
+        }
+    }
+}
+
+TEST_F(ConvLayerTest, BatchedFactoryRejection) {
+    const int width = 32, height = 16, chans = 8;
+    // shallow and depthwise convolutions do not support batching
+    {
+        std::shared_ptr<LayerFactory> factory = LayerFactory::instance(LayerFactory::GPUFactoryType(LayerFactory::GPUFactoryType::VANILLA));
+        gpu::ConvLayerBuilder * bld = new gpu::ConvLayerBuilder(3, "conv");
+        bld->context(context()).shape(chans, height, width, chans).type(LayerType::CONVOLUTION2D).number(1).batch(2);
+        bld->push(factory);
+        EXPECT_THROW(factory->compileLayers(), fyusion::FynException);
+    }
+    {
+        std::shared_ptr<LayerFactory> factory = LayerFactory::instance(LayerFactory::GPUFactoryType(LayerFactory::GPUFactoryType::VANILLA));
+        gpu::ConvLayerBuilder * bld = new gpu::ConvLayerBuilder(3, "conv");
+        bld->context(context()).shape(chans, height, width, chans).type(LayerType::CONVOLUTION2D).number(1).deep().inputPadding(1).groupSize(chans).batch(2);
+        bld->push(factory);
+        EXPECT_THROW(factory->compileLayers(), fyusion::FynException);
+    }
+    // batch size 1 is always accepted, deep (non-depthwise) convolutions support batching
+    for (int batch : {1, 2}) {
+        std::shared_ptr<LayerFactory> factory = LayerFactory::instance(LayerFactory::GPUFactoryType(LayerFactory::GPUFactoryType::VANILLA));
+        gpu::ConvLayerBuilder * bld = new gpu::ConvLayerBuilder(3, "conv");
+        bld->context(context()).shape(chans, height, width, chans).type(LayerType::CONVOLUTION2D).number(1).deep().inputPadding(1).batch(batch);
+        bld->push(factory);
+        CompiledLayers layers = factory->compileLayers();
+        ASSERT_NE(layers["conv"], nullptr);
+    }
+}
+
+TEST_F(ConvLayerTest, DeepConv3x3WeightCache) {
+    const int kernel = 3;
+    const int width = 64;
+    const int height = 32;
+    const int inchans = 12;
+    const int outchans = 8;
+    gpu::ConvLayerBuilder bld(kernel, "conv");
+    bld.context(context()).shape(outchans, height, width, inchans).type(LayerType::CONVOLUTION2D).number(1).deep().inputPadding((kernel-1)/2);
+    std::unique_ptr<float[]> ckernel(new float[kernel * kernel]);
+    for (int i=0; i < kernel * kernel; i++) ckernel[i] = (float)(i - kernel);
+    std::unique_ptr<float[]> wandb(stackConvolution(0.5f, ckernel.get(), kernel, kernel, inchans, outchans));
+    SingleWeightProvider wsrc(wandb.get() + outchans, wandb.get());
+    char cachedir[] = "/tmp/fyn_wcacheXXXXXX";
+    ASSERT_NE(mkdtemp(cachedir), nullptr);
+    // removes the cache directory and the files in it, also when an assertion bails out early
+    struct DirCleanup {
+        const char * path;
+        ~DirCleanup() {
+            std::error_code err;
+            std::filesystem::remove_all(path, err);
+        }
+    } dircleanup{cachedir};
+    WeightCache cache(cachedir);
+    wsrc.setWeightCache(&cache);
+    std::unique_ptr<float[]> results[2];
+    for (int run=0; run < 2; run++) {
+        gpu::deep::DeepConvLayerNxN layer(bld, 1);
+        std::unique_ptr<float[]> input(generateConstantData(1.0f, inchans, width, height, layer.getInputPadding()));
+        std::vector<const float *> inputs{input.get()};
+        generateTextures(&layer, inputs, nullptr, true);
+        layer.loadParameters(&wsrc);
+        layer.setup();
+        layer.forward(1, nullptr);
+        results[run].reset(new float[width * height * outchans]);
+        layer.copyResult(results[run].get(), false);
+        layer.cleanup();
+        LayerTestBase::cleanup();
+    }
+    EXPECT_EQ(cache.misses(), 1u);
+    EXPECT_EQ(cache.hits(), 1u);
+    for (int i=0; i < width * height * outchans; i++) {
+        ASSERT_EQ(results[0][i], results[1][i]);
+    }
+}
+
+TEST_F(ConvLayerTest, DeepDepthwiseConv3x3WeightCache) {
+    const int kernel = 3;
+    const int width = 64;
+    const int height = 32;
+    const int chans = 12;
+    gpu::ConvLayerBuilder bld(kernel, "dwconv");
+    bld.context(context()).shape(chans, height, width, chans).type(LayerType::CONVOLUTION2D).number(1).deep().groupSize(chans).inputPadding((kernel-1)/2);
+    std::unique_ptr<float[]> weights(new float[chans * kernel * kernel]);
+    for (int i=0; i < chans * kernel * kernel; i++) weights[i] = (float)((i % 7) - 3) * 0.25f;
+    std::unique_ptr<float[]> bias(new float[chans]);
+    for (int i=0; i < chans; i++) bias[i] = (float)i * 0.1f;
+    SingleWeightProvider wsrc(weights.get(), bias.get());
+    char cachedir[] = "/tmp/fyn_wcacheXXXXXX";
+    ASSERT_NE(mkdtemp(cachedir), nullptr);
+    struct DirCleanup {
+        const char * path;
+        ~DirCleanup() {
+            std::error_code err;
+            std::filesystem::remove_all(path, err);
+        }
+    } dircleanup{cachedir};
+    WeightCache cache(cachedir);
+    std::unique_ptr<float[]> results[3];
+    // first run without cache (reference), second run populates the cache, third one reads from it
+    for (int run=0; run < 3; run++) {
+        if (run == 1) wsrc.setWeightCache(&cache);
+        gpu::deep::DeepDepthwiseConvLayer3x3 layer(bld, 1);
+        std::unique_ptr<float[]> input(generateConstantData(1.0f, chans, width, height, layer.getInputPadding()));
+        std::vector<const float *> inputs{input.get()};
+        generateTextures(&layer, inputs, nullptr, true);
+        layer.loadParameters(&wsrc);
+        layer.setup();
+        layer.forward(1, nullptr);
+        results[run].reset(new float[width * height * chans]);
+        layer.copyResult(results[run].get(), false);
+        layer.cleanup();
+        LayerTestBase::cleanup();
+        if (run == 1) {
+            EXPECT_EQ(cache.misses(), 1u);
+            EXPECT_EQ(cache.hits(), 0u);
+        }
+    }
+    EXPECT_EQ(cache.misses(), 1u);
+    EXPECT_EQ(cache.hits(), 1u);
+    int mismatches = 0;
+    for (int i=0; i < width * height * chans; i++) {
+        if ((results[0][i] != results[1][i]) || (results[0][i] != results[2][i])) mismatches++;
+    }
+    EXPECT_EQ(mismatches, 0);
+}
+
+TEST_F(ConvLayerTest, DeepConv3x3SharedWeights) {
+    const int kernel = 3;
+    const int width = 64;
+    const int height = 32;
+    const int inchans = 12;
+    const int outchans = 8;
+    gpu::ConvLayerBuilder bld(kernel, "conv");
+    bld.context(context()).shape(outchans, height, width, inchans).type(LayerType::CONVOLUTION2D).number(1).deep().inputPadding((kernel-1)/2);
+    std::unique_ptr<float[]> ckernel(new float[kernel * kernel]);
+    for (int i=0; i < kernel * kernel; i++) ckernel[i] = (float)(i - kernel);
+    std::unique_ptr<float[]> wandb(stackConvolution(0.5f, ckernel.get(), kernel, kernel, inchans, outchans));
+    SingleWeightProvider wsrc(wandb.get() + outchans, wandb.get());
+    WeightStore store;
+    wsrc.setWeightStore(&store);
+    // two instances of the same layer alive at the same time must share one weight texture
+    std::unique_ptr<gpu::deep::DeepConvLayerNxN> layers[2];
+    for (int l=0; l < 2; l++) {
+        layers[l].reset(new gpu::deep::DeepConvLayerNxN(bld, 1));
+        layers[l]->loadParameters(&wsrc);
+    }
+    EXPECT_EQ(store.textures(), (size_t)1);
+    EXPECT_EQ(store.hits(), 1u);
+    std::unique_ptr<float[]> results[2];
+    for (int l=0; l < 2; l++) {
+        std::unique_ptr<float[]> input(generateConstantData(1.0f, inchans, width, height, layers[l]->getInputPadding()));
+        std::vector<const float *> inputs{input.get()};
+        generateTextures(layers[l].get(), inputs, nullptr, true);
+        layers[l]->setup();
+        layers[l]->forward(1, nullptr);
+        results[l].reset(new float[width * height * outchans]);
+        layers[l]->copyResult(results[l].get(), false);
+        layers[l]->cleanup();
+        LayerTestBase::cleanup();
+        // the texture must only be deleted with the last layer that uses it
+        EXPECT_EQ(store.textures(), (size_t)(1 - l));
+    }
+    for (int i=0; i < width * height * outchans; i++) {
+        ASSERT_EQ(results[0][i], results[1][i]);
+    }
+}
+
 TEST_F(ConvLayerTest, DeepConv3x3Speed) {
     const int kernel = 3;
     const int width = 64;
@@ -453,25 +453,30 @@ void LayerTestBase::copyToDeepTexture(const float * input, GLuint handle, fyusio
     memset(tmpimg, 0, iheight*iwidth*LayerBase::PIXEL_PACKING*sizeof(float));
     int tilex = tiler->numInputTiles(deep::DeepTiler::HORIZONTAL);
     int tiley = tiler->numInputTiles(deep::DeepTiler::VERTICAL);
-    int chan = 0;
     int srcstride = (includesPadding) ? netwidth + 2*padding : netwidth;
     int srcstridec = (includesPadding) ? srcstride * (netheight+2*padding) : srcstride * netheight;
-    for (int ty=0; ty < tiley; ty++) {
-        for (int tx=0; tx < tilex; tx++) {
-            int rem = (inChans - chan) > LayerBase::PIXEL_PACKING ? LayerBase::PIXEL_PACKING : inChans - chan;
-            if (rem > 0) {
-                float * ptr = tmpimg + LayerBase::PIXEL_PACKING * (((padding + ty*(netheight + padding))*iwidth) + padding + (tx*(netwidth + padding)));
-                const float * src = (includesPadding) ? input + padding*srcstride + padding : input;
-                for (int y=0; y < netheight; y++) {
-                    for (int x=0; x < netwidth; x++) {
-                        for (int ichan=0; ichan < rem; ichan++) {
-                            float val = src[y*srcstride + x + (chan+ichan) * srcstridec];
-                            ptr[(y*iwidth+x)*LayerBase::PIXEL_PACKING + ichan] = val;
+    // batched input is expected to be stored consecutively in the input array
+    for (int img=0; img < tiler->getBatchSize(); img++) {
+        std::pair<int,int> origin = tiler->getInputImageOffset(img);
+        const float * imgsrc = input + img * srcstridec * inChans;
+        int chan = 0;
+        for (int ty=0; ty < tiley; ty++) {
+            for (int tx=0; tx < tilex; tx++) {
+                int rem = (inChans - chan) > LayerBase::PIXEL_PACKING ? LayerBase::PIXEL_PACKING : inChans - chan;
+                if (rem > 0) {
+                    float * ptr = tmpimg + LayerBase::PIXEL_PACKING * (((origin.second + padding + ty*(netheight + padding))*iwidth) + origin.first + padding + (tx*(netwidth + padding)));
+                    const float * src = (includesPadding) ? imgsrc + padding*srcstride + padding : imgsrc;
+                    for (int y=0; y < netheight; y++) {
+                        for (int x=0; x < netwidth; x++) {
+                            for (int ichan=0; ichan < rem; ichan++) {
+                                float val = src[y*srcstride + x + (chan+ichan) * srcstridec];
+                                ptr[(y*iwidth+x)*LayerBase::PIXEL_PACKING + ichan] = val;
+                            }
                         }
                     }
                 }
+                chan += LayerBase::PIXEL_PACKING;
             }
-            chan += LayerBase::PIXEL_PACKING;
         }
     }
     configureTexture(handle, iwidth, iheight, tmpimg);
@@ -500,7 +505,7 @@ void LayerTestBase::copyToSequenceTexture(const float *input, GLuint handle, int
 void LayerTestBase::configureTexture(GLuint tex, int width, int height, const void *data) {
     using namespace fyusion::fyusenet;
     using namespace fyusion::fyusenet::gpu;
-    glBindTexture(GL_TEXTURE_2D, tex);
+    fyusion::opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, tex);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -513,7 +518,7 @@ void LayerTestBase::configureTexture(GLuint tex, int width, int height, const vo
 void LayerTestBase::configureTexture(GLuint tex, int width, int height, GLint iformat, GLenum format, GLenum dtype, const void *data) {
     using namespace fyusion::fyusenet;
     using namespace fyusion::fyusenet::gpu;
-    glBindTexture(GL_TEXTURE_2D, tex);
+    fyusion::opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, tex);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -46,7 +46,7 @@ class LayerTestBase {
   protected:
 
     virtual void cleanup() {
-        if (!testTextures_.empty()) glDeleteTextures((GLsizei)testTextures_.size(), &testTextures_[0]);
+        if (!testTextures_.empty()) fyusion::opengl::GLStateCache::deleteTextures((GLsizei)testTextures_.size(), &testTextures_[0]);
     }
 
     void generateTextures(fyusion::fyusenet::gpu::GPULayerBase * layer, const std::vector<const float *> & inputs, const float * residual=nullptr, bool includesPadding=false);
@@ -80,6 +80,12 @@ class LayerTestBase {
         layer->addOutputTexture(tex, index, 0);
     }
 
+    static void addResidualTexture(fyusion::fyusenet::gpu::GPULayerBase * layer, GLuint tex, int index) {
+        EXPECT_NE(layer, nullptr);
+        if (!layer) return;
+        layer->addResidualTexture(tex, index);
+    }
+
     [[nodiscard]] fyusion::opengl::FBO * getFBO(fyusion::fyusenet::gpu::GPULayerBase * layer, int index) {
         EXPECT_NE(layer, nullptr);
         if (!layer) return nullptr;
@@ -9,9 +9,15 @@
 //--------------------------------------- System Headers -------------------------------------------
 
 #include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
+#include <map>
 #include <memory>
 #include <thread>
+#include <unistd.h>
 
 //-------------------------------------- Project  Headers ------------------------------------------
 
@@ -24,12 +30,188 @@
 #include <fyusenet/gpu/batchnormlayer.h>
 #include <fyusenet/gpu/deep/deepbatchnormlayer.h>
 #include <fyusenet/gpu/deep/deepgemmlayer.h>
+#include <fyusenet/gpu/floatconversion.h>
+#include <fyusenet/gpu/uploadlayer.h>
+#include <fyusenet/gpu/deep/deepdownloadlayer.h>
+#include <fyusenet/gpu/imgpreproclayer.h>
+#include <fyusenet/gpu/compactlayer.h>
+#include <fyusenet/gpu/deep/deeptopklayer.h>
+#include <fyusenet/gpu/sequence/rmsnorm_sequence.h>
+#include <fyusenet/gpu/sequence/rudiments/matmul_const.h>
+#include <fyusenet/gpu/sequence/rudiments/tiled_attention.h>
+#include <fyusenet/gpu/sequence/rudiments/kv_quantizer.h>
+#include <fyusenet/gpu/sequence/rudiments/dotprod_single.h>
+#include <fyusenet/gpu/sequence/rudiments/dotprod_batched.h>
+#include <fyusenet/gpu/sequence/rudiments/masked_softmax_single.h>
+#include <fyusenet/gpu/sequence/rudiments/masked_softmax_batched.h>
+#include <fyusenet/gpu/sequence/rudiments/attmul_single.h>
+#include <fyusenet/gpu/sequence/rudiments/attmul_batched.h>
+#include <fyusenet/gpu/sequence/causal_multihead_attentionlayer.h>
+#include <fyusenet/gpu/custom/sequence/linear_gateup.h>
+#include <fyusenet/gpu/custom/sequence/linear_hadamard.h>
+#include <fyusenet/gl/programbinarycache.h>
+#include <fyusenet/gl/shaderresource.h>
+#include <fyusenet/gl/vertexshader.h>
+#include <fyusenet/gl/fragmentshader.h>
 #include "layertestbase.h"
 
 //-------------------------------------- Global Variables ------------------------------------------
 
 //-------------------------------------- Local Definitions -----------------------------------------
 
+/**
+ * 4-bit quantized weight matrix (row-major, 8 rows per 32-bit word) with per-group scales and
+ * zero-points, as well as its dequantized counterpart for reference computations
+ */
+struct QuantMatrix {
+    std::vector<uint32_t> weights, zeros;
+    std::vector<float> scales, dequant;
+};
+
+static QuantMatrix quantize(int rows, int cols, int grpsize, int seed) {
+    QuantMatrix mat;
+    int groups = rows / grpsize;
+    mat.weights.resize((rows / 8) * cols, 0);
+    mat.zeros.resize(groups * std::max(1, cols / 8), 0);
+    mat.scales.resize(groups * cols);
+    mat.dequant.resize(rows * cols);
+    for (int g=0; g < groups; g++) {
+        for (int c=0; c < cols; c++) {
+            mat.scales[g * cols + c] = 0.01f * (float)(1 + (c + g + seed) % 4);
+            mat.zeros[g * (cols / 8) + c / 8] |= (uint32_t)((c * 3 + g + seed) % 9) << (4 * (c % 8));
+        }
+    }
+    for (int r=0; r < rows; r++) {
+        int g = r / grpsize;
+        for (int c=0; c < cols; c++) {
+            uint32_t q = (uint32_t)((r * 5 + c * 11 + seed) % 16);
+            uint32_t z = (mat.zeros[g * (cols / 8) + c / 8] >> (4 * (c % 8))) & 0xF;
+            mat.weights[(r / 8) * cols + c] |= q << (4 * (r % 8));
+            mat.dequant[r * cols + c] = mat.scales[g * cols + c] * ((float)q - (float)(z + 1));
+        }
+    }
+    return mat;
+}
+
+
+/**
+ * Parameter provider that serves quantized matrices under their parameter names
+ * (\c name.weights, \c name.zeros and \c name.scales). Parameters that were not added (e.g.
+ * optional biases) are returned as empty blobs
+ */
+struct NamedProvider : fyusion::fyusenet::ParameterProvider {
+    std::map<std::string, std::unique_ptr<fyusion::fyusenet::DataWrapper>> entries;
+    void add(const std::string& name, const QuantMatrix& mat) {
+        using namespace fyusion::fyusenet;
+        entries[name + ".weights"] = std::make_unique<DefaultDataWrapper<uint8_t>>(reinterpret_cast<const uint8_t *>(mat.weights.data()));
+        entries[name + ".zeros"] = std::make_unique<DefaultDataWrapper<uint8_t>>(reinterpret_cast<const uint8_t *>(mat.zeros.data()));
+        entries[name + ".scales"] = std::make_unique<DefaultDataWrapper<float>>(mat.scales.data());
+    }
+    fyusion::fyusenet::DataBlob get(const std::string& name, int layerNo, int subIndex) const override {
+        auto it = entries.find(name);
+        return (it == entries.end()) ? fyusion::fyusenet::DataBlob() : fyusion::fyusenet::DataBlob(it->second.get());
+    }
+};
+
+
+/**
+ * Multiply \c tokens rows of the input with a dequantized matrix of the supplied size
+ */
+static std::vector<float> matMulReference(const float *input, int tokens, const QuantMatrix& mat, int rows, int cols) {
+    std::vector<float> result(tokens * cols, 0.0f);
+    for (int t=0; t < tokens; t++) {
+        for (int c=0; c < cols; c++) {
+            for (int r=0; r < rows; r++) result[t * cols + c] += input[t * rows + r] * mat.dequant[r * cols + c];
+        }
+    }
+    return result;
+}
+
+
+/**
+ * Apply rotary positional encoding in place, using the row index as token position. Each head
+ * rotates element \c d with element \c d + hdim/2, as done by the rotary encoder
+ */
+static void rotaryReference(std::vector<float>& data, int tokens, int heads, int hdim, float thetaBase) {
+    for (int t=0; t < tokens; t++) {
+        for (int h=0; h < heads; h++) {
+            float * head = data.data() + (t * heads + h) * hdim;
+            std::vector<float> src(head, head + hdim);
+            for (int d=0; d < hdim; d++) {
+                float freq = (float)t * powf(thetaBase, -(float)((2 * d) % hdim) / (float)hdim);
+                float sign = (d < hdim / 2) ? -1.0f : 1.0f;
+                head[d] = src[d] * cosf(freq) + sign * src[(d + hdim / 2) % hdim] * sinf(freq);
+            }
+        }
+    }
+}
+
+
+/**
+ * Compute a (causal) attention on the CPU. Row \c t of the query and the result belongs to the
+ * token at index \c tokenIndex + t, keys and values are stored from the first token onwards
+ */
+static std::vector<float> attentionReference(const float *query, const float *key, const float *value,
+                                             int heads, int kvheads, int hdim, int tokenIndex, int numTokens) {
+    const int embed = heads * hdim, kvembed = kvheads * hdim, group = heads / kvheads;
+    std::vector<float> result(numTokens * embed);
+    for (int t=0; t < numTokens; t++) {
+        for (int h=0; h < heads; h++) {
+            const int kvoffset = (h / group) * hdim;
+            std::vector<float> scores(tokenIndex + t + 1);
+            float maxscore = -FLT_MAX, sum = 0.0f;
+            for (int k=0; k <= tokenIndex + t; k++) {
+                float dp = 0.0f;
+                for (int d=0; d < hdim; d++) dp += query[t * embed + h * hdim + d] * key[k * kvembed + kvoffset + d];
+                scores[k] = dp / sqrtf((float)hdim);
+                maxscore = std::max(maxscore, scores[k]);
+            }
+            for (float & sc : scores) sum += (sc = expf(sc - maxscore));
+            for (int d=0; d < hdim; d++) {
+                float y = 0.0f;
+                for (int k=0; k <= tokenIndex + t; k++) y += scores[k] / sum * value[k * kvembed + kvoffset + d];
+                result[t * embed + h * hdim + d] = y;
+            }
+        }
+    }
+    return result;
+}
+
+
+/**
+ * Compare the output of a (causal) attention computation against a CPU reference and return the
+ * number of mismatching elements, see attentionReference() for the data layout
+ */
+static int attentionMismatches(const float *result, const float *query, const float *key, const float *value,
+                               int heads, int kvheads, int hdim, int tokenIndex, int numTokens, float tolerance) {
+    std::vector<float> ref = attentionReference(query, key, value, heads, kvheads, hdim, tokenIndex, numTokens);
+    int mismatch = 0;
+    for (size_t i=0; i < ref.size(); i++) {
+        if (fabsf(result[i] - ref[i]) > tolerance * (1.0f + fabsf(ref[i]))) mismatch++;
+    }
+    return mismatch;
+}
+
+
+/**
+ * Quantize keys or values the same way as the 8-bit key/value cache does (one scale per token and
+ * head) and return the dequantized values for reference computations
+ */
+static std::vector<float> quantizeKV(const std::vector<float>& src, int tokens, int kvheads, int hdim) {
+    const int kvembed = kvheads * hdim;
+    std::vector<float> result(src.size());
+    for (int t=0; t < tokens; t++) {
+        for (int h=0; h < kvheads; h++) {
+            const float * in = src.data() + t * kvembed + h * hdim;
+            float absmax = 0.0f;
+            for (int d=0; d < hdim; d++) absmax = std::max(absmax, fabsf(in[d]));
+            float scale = absmax / 127.0f;
+            for (int d=0; d < hdim; d++) result[t * kvembed + h * hdim + d] = roundf(in[d] / scale) * scale;
+        }
+    }
+    return result;
+}
+
 
 /*##################################################################################################
 #                                   P U B L I C  F U N C T I O N S                                 #
@@ -285,6 +467,1236 @@ TEST_F(GEMMTest, DeepGEMM) {
     }
 }
 
+
+TEST_F(MiscLayerTest, ZeroCopyUpload) {
+    const int width = 16, height = 8, channels = 8;
+    gpu::UpDownLayerBuilder bld(gpu::UpDownLayerBuilder::UPLOAD, "upload");
+    bld.shape(channels, height, width, channels).context(context()).zeroCopy(2);
+    gpu::UploadLayer layer(bld, 1);
+    GLuint tex[2];
+    glGenTextures(2, tex);
+    for (int t=0; t < 2; t++) {
+        configureTexture(tex[t], width, height, nullptr);
+        testTextures_.push_back(tex[t]);
+        addOutputTexture(&layer, tex[t], t);
+    }
+    layer.setup();
+    ASSERT_EQ(layer.inputSlotBytes(), (size_t)(width * height * channels * sizeof(float)));
+    std::vector<float> result(width * height * PIXEL_PACKING);
+    // run more frames than there are slots to make sure the slots are recycled
+    for (int frame=1; frame <= 3; frame++) {
+        int slot = -1;
+        auto * data = (float *)layer.acquireInputSlot(slot);
+        ASSERT_NE(data, nullptr);
+        for (int i=0; i < width * height * channels; i++) data[i] = (float)(frame * 100 + (i % 64));
+        layer.submitInputSlot(slot);
+        ASSERT_TRUE(layer.hasSubmittedInput());
+        layer.forward(frame, nullptr);
+        ASSERT_FALSE(layer.hasSubmittedInput());
+        for (int t=0; t < 2; t++) {
+            fyusion::opengl::FBO fbo(context(), width, height, tex[t]);
+            fbo.writeToMemory<float, GL_FLOAT>(result.data(), PIXEL_PACKING, (GLsizei)(result.size() * sizeof(float)));
+            for (int i=0; i < width * height * PIXEL_PACKING; i++) {
+                int src = t * width * height * PIXEL_PACKING + i;
+                ASSERT_EQ(result[i], (float)(frame * 100 + (src % 64)));
+            }
+        }
+    }
+    layer.cleanup();
+}
+
+
+TEST_F(MiscLayerTest, DeepDownloadBatched) {
+    const int width = 16, height = 8, channels = 8, batch = 3;
+    gpu::UpDownLayerBuilder bld(gpu::UpDownLayerBuilder::DOWNLOAD, "download");
+    bld.shape(channels, height, width, channels).deep().batch(batch).context(context());
+    gpu::deep::DeepDownloadLayer layer(bld, 1);
+    std::vector<BufferSpec> outspecs = layer.getRequiredOutputBuffers();
+    ASSERT_EQ((int)outspecs.size(), batch);
+    // integer-valued data that is exactly representable in half precision, unique per image
+    const int imgsize = width * height * channels;
+    std::vector<float> input(batch * imgsize);
+    for (int i=0; i < batch * imgsize; i++) input[i] = (float)((i / imgsize) * 512 + ((i % imgsize) / (width * height)) * 32 + (i % 31));
+    GLuint tex;
+    glGenTextures(1, &tex);
+    testTextures_.push_back(tex);
+    copyToDeepTexture(input.data(), tex, layer.getTiler(), width, height, 0, channels, false);
+    addInputTexture(&layer, tex, 0);
+    std::vector<std::unique_ptr<cpu::CPUBuffer>> outputs;
+    for (int port=0; port < batch; port++) {
+        outputs.emplace_back(layer.getOutputShape(port).createCPUBuffer());
+        layer.addCPUOutputBuffer(outputs.back().get(), port);
+    }
+    layer.setup();
+    layer.forward(1, nullptr);
+    layer.cleanup();
+    for (int img=0; img < batch; img++) {
+        std::unique_ptr<cpu::CPUBuffer> chan(outputs[img]->toChannelWise());
+        const float * res = chan->map<float>();
+        int mismatches = 0;
+        for (int i=0; i < imgsize; i++) {
+            if (res[i] != input[img * imgsize + i]) mismatches++;
+        }
+        chan->unmap();
+        EXPECT_EQ(mismatches, 0) << "image " << img;
+    }
+}
+
+
+TEST_F(MiscLayerTest, ImagePreprocCenterCrop) {
+    const int srcwidth = 8, srcheight = 4, outsize = 2;
+    // upload 8-bit RGB data as-is
+    gpu::UpDownLayerBuilder upbld(gpu::UpDownLayerBuilder::UPLOAD, "upload");
+    upbld.shape(3, srcheight, srcwidth, 3).dataType(BufferSpec::dtype::UBYTE).context(context());
+    gpu::UploadLayer upload(upbld, 1);
+    gpu::ImgPreprocLayerBuilder bld("preproc");
+    bld.source(srcwidth, srcheight, gpu::ImgPreprocLayerBuilder::RGB).centerCrop(srcheight).shape(3, outsize, outsize, 3).context(context());
+    gpu::ImgPreprocLayer layer(bld, 2);
+    GLuint tex[2];
+    glGenTextures(2, tex);
+    configureTexture(tex[0], srcwidth, srcheight, GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    configureTexture(tex[1], outsize, outsize, nullptr);
+    testTextures_.push_back(tex[0]);
+    testTextures_.push_back(tex[1]);
+    addOutputTexture(&upload, tex[0], 0);
+    addInputTexture(&layer, tex[0], 0);
+    addOutputTexture(&layer, tex[1], 0);
+    CPUBuffer input(BufferShape(srcheight, srcwidth, 3, 0, BufferShape::type::UINT8, BufferSpec::order::GPU_SHALLOW));
+    auto * rgb = input.map<uint8_t>();
+    for (int y=0; y < srcheight; y++) {
+        for (int x=0; x < srcwidth; x++) {
+            rgb[(y*srcwidth+x)*3 + 0] = (uint8_t)(x * 30);
+            rgb[(y*srcwidth+x)*3 + 1] = (uint8_t)(y * 60);
+            rgb[(y*srcwidth+x)*3 + 2] = 200;
+        }
+    }
+    input.unmap();
+    upload.setup();
+    layer.setup();
+    upload.setCPUInputBuffer(&input, 0);
+    upload.forward(1, nullptr);
+    layer.forward(1, nullptr);
+    std::vector<float> result(outsize * outsize * PIXEL_PACKING);
+    fyusion::opengl::FBO fbo(context(), outsize, outsize, tex[1]);
+    fbo.writeToMemory<float, GL_FLOAT>(result.data(), PIXEL_PACKING, (GLsizei)(result.size() * sizeof(float)));
+    // the center 2x2 region of the image maps exactly to source pixels (3..4, 1..2)
+    for (int y=0; y < outsize; y++) {
+        for (int x=0; x < outsize; x++) {
+            const float * pix = result.data() + (y * outsize + x) * PIXEL_PACKING;
+            EXPECT_NEAR(pix[0], (float)((x + 3) * 30) / 255.f, 1e-2f);
+            EXPECT_NEAR(pix[1], (float)((y + 1) * 60) / 255.f, 1e-2f);
+            EXPECT_NEAR(pix[2], 200.f / 255.f, 1e-2f);
+        }
+    }
+    layer.cleanup();
+    upload.cleanup();
+}
+
+
+TEST_F(MiscLayerTest, ImagePreprocNV12) {
+    const int srcwidth = 16, srcheight = 8, outwidth = 8, outheight = 4;
+    const float mean[3] = {0.5f, 0.4f, 0.3f};
+    const float stddev[3] = {0.2f, 0.25f, 0.5f};
+    const uint8_t yval = 128, uval = 100, vval = 160;
+    gpu::UpDownLayerBuilder upbld(gpu::UpDownLayerBuilder::UPLOAD, "upload");
+    upbld.shape(3, srcheight, srcwidth, 3).nv12().context(context());
+    gpu::UploadLayer upload(upbld, 1);
+    ASSERT_EQ(upload.getRequiredOutputBuffers().size(), (size_t)2);
+    gpu::ImgPreprocLayerBuilder bld("preproc");
+    bld.source(srcwidth, srcheight, gpu::ImgPreprocLayerBuilder::NV12).swapRB().normalize(mean, stddev);
+    bld.shape(3, outheight, outwidth, 3).context(context());
+    gpu::ImgPreprocLayer layer(bld, 2);
+    GLuint tex[3];
+    glGenTextures(3, tex);
+    configureTexture(tex[0], srcwidth, srcheight, GL_R8, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+    configureTexture(tex[1], srcwidth / 2, srcheight / 2, GL_RG8, GL_RG, GL_UNSIGNED_BYTE, nullptr);
+    configureTexture(tex[2], outwidth, outheight, nullptr);
+    for (int t=0; t < 3; t++) testTextures_.push_back(tex[t]);
+    addOutputTexture(&upload, tex[0], 0);
+    addOutputTexture(&upload, tex[1], 1);
+    addInputTexture(&layer, tex[0], 0);
+    addInputTexture(&layer, tex[1], 1);
+    addOutputTexture(&layer, tex[2], 0);
+    CPUBuffer input(BufferShape(srcheight + srcheight / 2, srcwidth, 1, 0, BufferShape::type::UINT8, BufferSpec::order::GPU_SHALLOW));
+    auto * frame = input.map<uint8_t>();
+    memset(frame, yval, srcwidth * srcheight);
+    for (int i=0; i < srcwidth * srcheight / 4; i++) {
+        frame[srcwidth * srcheight + 2 * i] = uval;
+        frame[srcwidth * srcheight + 2 * i + 1] = vval;
+    }
+    input.unmap();
+    upload.setup();
+    layer.setup();
+    upload.setCPUInputBuffer(&input, 0);
+    upload.forward(1, nullptr);
+    layer.forward(1, nullptr);
+    // BT.601 limited range reference
+    float y = 1.164383f * ((float)yval / 255.f - 16.f / 255.f);
+    float u = (float)uval / 255.f - 0.5f;
+    float v = (float)vval / 255.f - 0.5f;
+    float rgb[3] = {y + 1.596027f * v, y - 0.391762f * u - 0.812968f * v, y + 2.017232f * u};
+    std::vector<float> result(outwidth * outheight * PIXEL_PACKING);
+    fyusion::opengl::FBO fbo(context(), outwidth, outheight, tex[2]);
+    fbo.writeToMemory<float, GL_FLOAT>(result.data(), PIXEL_PACKING, (GLsizei)(result.size() * sizeof(float)));
+    for (int i=0; i < outwidth * outheight; i++) {
+        for (int c=0; c < 3; c++) {
+            float expected = (std::min(1.f, std::max(0.f, rgb[2 - c])) - mean[2 - c]) / stddev[2 - c];
+            EXPECT_NEAR(result[i * PIXEL_PACKING + c], expected, 2e-2f);
+        }
+    }
+    layer.cleanup();
+    upload.cleanup();
+}
+
+
+
+TEST_F(MiscLayerTest, SparseCompaction) {
+    const int width = 32, height = 16, slotsx = 4, slotsy = 2;
+    gpu::CompactLayerBuilder bld("compact");
+    bld.slots(slotsx, slotsy).threshold(0.1f).shape(4, height, width, 4).context(context());
+    gpu::CompactLayer layer(bld, 1);
+    std::vector<BufferSpec> outspecs = layer.getRequiredOutputBuffers();
+    ASSERT_EQ(outspecs.size(), (size_t)1);
+    ASSERT_EQ(outspecs[0].width_, slotsx);
+    ASSERT_EQ(outspecs[0].height_, slotsy + 1);
+    std::vector<float> input(width * height * PIXEL_PACKING, 0.0f);
+    auto peak = [&](int x, int y, int chan, float val) { input[(y * width + x) * PIXEL_PACKING + chan] = val; };
+    peak(3, 4, 1, 5.0f);
+    peak(5, 6, 2, 3.0f);        // same slot as the previous one with lower score
+    peak(20, 12, 3, 2.0f);
+    peak(30, 1, 0, 0.5f);
+    peak(10, 10, 0, 0.05f);     // below threshold
+    GLuint tex[2];
+    glGenTextures(2, tex);
+    configureTexture(tex[0], width, height, input.data());
+    configureTexture(tex[1], slotsx, slotsy + 1, (GLint)outspecs[0].internalFormat_, (GLenum)outspecs[0].format_, (GLenum)outspecs[0].type_, nullptr);
+    testTextures_.push_back(tex[0]);
+    testTextures_.push_back(tex[1]);
+    addInputTexture(&layer, tex[0], 0);
+    addOutputTexture(&layer, tex[1], 0);
+    layer.setup();
+    layer.forward(1, nullptr);
+    std::vector<float> result(slotsx * (slotsy + 1) * PIXEL_PACKING);
+    fyusion::opengl::FBO fbo(context(), slotsx, slotsy + 1, tex[1]);
+    fbo.writeToMemory<float, GL_FLOAT>(result.data(), PIXEL_PACKING, (GLsizei)(result.size() * sizeof(float)));
+    layer.cleanup();
+    auto slot = [&](int x, int y) { return result.data() + (y * slotsx + x) * PIXEL_PACKING; };
+    const float * s0 = slot(0, 0);
+    EXPECT_EQ(s0[0], 3.0f);
+    EXPECT_EQ(s0[1], 4.0f);
+    EXPECT_EQ(s0[2], 1.0f);
+    EXPECT_EQ(s0[3], 5.0f);
+    const float * s1 = slot(2, 1);
+    EXPECT_EQ(s1[0], 20.0f);
+    EXPECT_EQ(s1[1], 12.0f);
+    EXPECT_EQ(s1[2], 3.0f);
+    EXPECT_EQ(s1[3], 2.0f);
+    const float * s2 = slot(3, 0);
+    EXPECT_EQ(s2[0], 30.0f);
+    EXPECT_EQ(s2[1], 1.0f);
+    EXPECT_EQ(s2[2], 0.0f);
+    EXPECT_EQ(s2[3], 0.5f);
+    int occupied = 0;
+    for (int y=0; y < slotsy; y++) {
+        for (int x=0; x < slotsx; x++) {
+            if (slot(x, y)[2] >= 0.0f) occupied++;
+        }
+    }
+    EXPECT_EQ(occupied, 3);
+    // total number of candidates (including the one that collided)
+    EXPECT_EQ(slot(0, slotsy)[0], 4.0f);
+}
+
+TEST_F(MiscLayerTest, SparseCompactionDeep) {
+    const int width = 16, height = 8, channels = 8, pad = 1, slotsx = 4, slotsy = 2;
+    gpu::CompactLayerBuilder bld("compact");
+    bld.slots(slotsx, slotsy).threshold(0.1f).shape(channels, height, width, channels).inputPadding(pad).deep().context(context());
+    gpu::CompactLayer layer(bld, 1);
+    std::vector<BufferSpec> inspecs = layer.getRequiredInputBuffers();
+    ASSERT_EQ(inspecs.size(), (size_t)1);
+    const int texwidth = inspecs[0].width_, texheight = inspecs[0].height_, tilesx = (texwidth - pad) / (width + pad);
+    std::vector<float> input(texwidth * texheight * PIXEL_PACKING, 0.0f);
+    auto peak = [&](int x, int y, int chan, float val) {
+        int tile = chan / PIXEL_PACKING;
+        int tx = (tile % tilesx) * (width + pad) + pad + x, ty = (tile / tilesx) * (height + pad) + pad + y;
+        input[(ty * texwidth + tx) * PIXEL_PACKING + chan % PIXEL_PACKING] = val;
+    };
+    peak(2, 1, 5, 4.0f);
+    peak(3, 2, 1, 1.5f);        // same slot as the previous one with lower score
+    peak(13, 6, 7, 2.5f);
+    peak(9, 0, 0, 0.05f);       // below threshold
+    std::vector<BufferSpec> outspecs = layer.getRequiredOutputBuffers();
+    GLuint tex[2];
+    glGenTextures(2, tex);
+    configureTexture(tex[0], texwidth, texheight, input.data());
+    configureTexture(tex[1], slotsx, slotsy + 1, (GLint)outspecs[0].internalFormat_, (GLenum)outspecs[0].format_, (GLenum)outspecs[0].type_, nullptr);
+    testTextures_.push_back(tex[0]);
+    testTextures_.push_back(tex[1]);
+    addInputTexture(&layer, tex[0], 0);
+    addOutputTexture(&layer, tex[1], 0);
+    layer.setup();
+    layer.forward(1, nullptr);
+    std::vector<float> result(slotsx * (slotsy + 1) * PIXEL_PACKING);
+    fyusion::opengl::FBO fbo(context(), slotsx, slotsy + 1, tex[1]);
+    fbo.writeToMemory<float, GL_FLOAT>(result.data(), PIXEL_PACKING, (GLsizei)(result.size() * sizeof(float)));
+    layer.cleanup();
+    auto slot = [&](int x, int y) { return result.data() + (y * slotsx + x) * PIXEL_PACKING; };
+    const float * s0 = slot(0, 0);
+    EXPECT_EQ(s0[0], 2.0f);
+    EXPECT_EQ(s0[1], 1.0f);
+    EXPECT_EQ(s0[2], 5.0f);
+    EXPECT_EQ(s0[3], 4.0f);
+    const float * s1 = slot(3, 1);
+    EXPECT_EQ(s1[0], 13.0f);
+    EXPECT_EQ(s1[1], 6.0f);
+    EXPECT_EQ(s1[2], 7.0f);
+    EXPECT_EQ(s1[3], 2.5f);
+    int occupied = 0;
+    for (int y=0; y < slotsy; y++) {
+        for (int x=0; x < slotsx; x++) {
+            if (slot(x, y)[2] >= 0.0f) occupied++;
+        }
+    }
+    EXPECT_EQ(occupied, 2);
+    EXPECT_EQ(slot(0, slotsy)[0], 3.0f);
+}
+
+TEST_F(MiscLayerTest, SparseCompactionArgMax) {
+    const int width = 16, height = 8, pad = 1, slotsx = 4, slotsy = 2;
+    const int texwidth = width + 2 * pad, texheight = height + 2 * pad;
+    gpu::CompactLayerBuilder bld("compact");
+    bld.slots(slotsx, slotsy).threshold(0.5f).argmaxInput().shape(1, height, width, 1).inputPadding(pad).context(context());
+    gpu::CompactLayer layer(bld, 1);
+    std::vector<BufferSpec> inspecs = layer.getRequiredInputBuffers();
+    ASSERT_EQ(inspecs.size(), (size_t)1);
+    ASSERT_EQ(inspecs[0].width_, texwidth);
+    ASSERT_EQ(inspecs[0].height_, texheight);
+    // argmax output: class index in the first and maximum value in the second channel
+    std::vector<float> input(texwidth * texheight * PIXEL_PACKING, 0.0f);
+    for (int y=0; y < height; y++) {
+        for (int x=0; x < width; x++) {
+            float * pix = input.data() + ((y + pad) * texwidth + x + pad) * PIXEL_PACKING;
+            pix[0] = (float)((x + y) % 10);
+            pix[1] = 0.25f;
+        }
+    }
+    auto peak = [&](int x, int y, int cls, float val) {
+        float * pix = input.data() + ((y + pad) * texwidth + x + pad) * PIXEL_PACKING;
+        pix[0] = (float)cls;
+        pix[1] = val;
+    };
+    peak(5, 3, 7, 3.0f);
+    peak(12, 5, 2, 1.25f);
+    std::vector<BufferSpec> outspecs = layer.getRequiredOutputBuffers();
+    GLuint tex[2];
+    glGenTextures(2, tex);
+    configureTexture(tex[0], texwidth, texheight, input.data());
+    configureTexture(tex[1], slotsx, slotsy + 1, (GLint)outspecs[0].internalFormat_, (GLenum)outspecs[0].format_, (GLenum)outspecs[0].type_, nullptr);
+    testTextures_.push_back(tex[0]);
+    testTextures_.push_back(tex[1]);
+    addInputTexture(&layer, tex[0], 0);
+    addOutputTexture(&layer, tex[1], 0);
+    layer.setup();
+    layer.forward(1, nullptr);
+    std::vector<float> result(slotsx * (slotsy + 1) * PIXEL_PACKING);
+    fyusion::opengl::FBO fbo(context(), slotsx, slotsy + 1, tex[1]);
+    fbo.writeToMemory<float, GL_FLOAT>(result.data(), PIXEL_PACKING, (GLsizei)(result.size() * sizeof(float)));
+    layer.cleanup();
+    auto slot = [&](int x, int y) { return result.data() + (y * slotsx + x) * PIXEL_PACKING; };
+    const float * s0 = slot(1, 0);
+    EXPECT_EQ(s0[0], 5.0f);
+    EXPECT_EQ(s0[1], 3.0f);
+    EXPECT_EQ(s0[2], 7.0f);
+    EXPECT_EQ(s0[3], 3.0f);
+    const float * s1 = slot(3, 1);
+    EXPECT_EQ(s1[0], 12.0f);
+    EXPECT_EQ(s1[1], 5.0f);
+    EXPECT_EQ(s1[2], 2.0f);
+    EXPECT_EQ(s1[3], 1.25f);
+    int occupied = 0;
+    for (int y=0; y < slotsy; y++) {
+        for (int x=0; x < slotsx; x++) {
+            if (slot(x, y)[2] >= 0.0f) occupied++;
+        }
+    }
+    EXPECT_EQ(occupied, 2);
+    EXPECT_EQ(slot(0, slotsy)[0], 2.0f);
+}
+
+TEST_F(MiscLayerTest, DeepTopKSoftmax) {
+    const int channels = 37, topk = 5;
+    gpu::TopKLayerBuilder bld("topk");
+    bld.topK(topk).softmax().shape(channels, 1, 1, channels).deep().context(context());
+    gpu::deep::DeepTopKLayer layer(bld, 1);
+    std::vector<BufferSpec> outspecs = layer.getRequiredOutputBuffers();
+    ASSERT_EQ(outspecs.size(), (size_t)1);
+    ASSERT_EQ(outspecs[0].width_, topk);
+    ASSERT_EQ(outspecs[0].height_, 1);
+    // distinct values that are exactly representable in half-precision, with a tie at the maximum
+    std::vector<float> input(channels);
+    for (int c=0; c < channels; c++) input[c] = (float)((c * 7) % channels) * 0.25f - 4.0f;
+    input[20] = input[5] = 6.0f;
+    std::vector<int> order(channels);
+    for (int c=0; c < channels; c++) order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return input[a] > input[b]; });
+    float sum = 0.0f;
+    for (int c=0; c < channels; c++) sum += std::exp(input[c] - 6.0f);
+    gpu::deep::DeepTiler * tiler = layer.getTiler();
+    GLuint tex[2];
+    glGenTextures(2, tex);
+    configureTexture(tex[0], tiler->getInputTextureWidth(), tiler->getInputTextureHeight(), nullptr);
+    configureTexture(tex[1], topk, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+    testTextures_.push_back(tex[0]);
+    testTextures_.push_back(tex[1]);
+    copyToDeepTexture(input.data(), tex[0], tiler, 1, 1, 0, channels, false);
+    addInputTexture(&layer, tex[0], 0);
+    addOutputTexture(&layer, tex[1], 0);
+    layer.setup();
+    layer.forward(1, nullptr);
+    std::vector<float> result(topk * PIXEL_PACKING);
+    fyusion::opengl::FBO fbo(context(), topk, 1, tex[1]);
+    fbo.writeToMemory<float, GL_FLOAT>(result.data(), PIXEL_PACKING, (GLsizei)(result.size() * sizeof(float)));
+    layer.cleanup();
+    EXPECT_EQ(result[0], 5.0f);
+    EXPECT_EQ(result[PIXEL_PACKING], 20.0f);
+    for (int k=0; k < topk; k++) {
+        const float * entry = result.data() + k * PIXEL_PACKING;
+        EXPECT_EQ((int)entry[0], order[k]);
+        EXPECT_EQ(entry[1], input[order[k]]);
+        EXPECT_NEAR(entry[2], std::exp(input[order[k]] - 6.0f) / sum, 1e-4f);
+    }
+}
+
+TEST_F(MiscLayerTest, RMSNormSinglePass) {
+    const int embed = 38, maxtokens = 7, width = (embed + PIXEL_PACKING - 1) / PIXEL_PACKING;
+    gpu::GPULayerBuilder bld("rmsnorm");
+    bld.sequence(maxtokens).channels(embed).type(LayerType::RMSNORM).context(context());
+    gpu::sequence::RMSNormLayer layer(bld, 1);
+    std::vector<float> input(width * maxtokens * PIXEL_PACKING, 0.0f);
+    std::vector<float> weights(embed);
+    for (int i=0; i < embed; i++) weights[i] = 0.5f + (float)(i % 5) * 0.25f;
+    for (int row=0; row < maxtokens; row++) {
+        for (int i=0; i < embed; i++) input[row * width * PIXEL_PACKING + i] = (float)((i * 7 + row * 3) % 13) - 6.0f + 0.1f * (float)row;
+    }
+    GLuint tex[2];
+    glGenTextures(2, tex);
+    configureTexture(tex[0], width, maxtokens, GL_RGBA32F, GL_RGBA, GL_FLOAT, input.data());
+    configureTexture(tex[1], width, maxtokens, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+    testTextures_.push_back(tex[0]);
+    testTextures_.push_back(tex[1]);
+    addInputTexture(&layer, tex[0], 0);
+    addOutputTexture(&layer, tex[1], 0);
+    layer.setup();
+    // the layer treats undeclared weight types as 16-bit
+    struct FP32Provider : SingleWeightProvider {
+        using SingleWeightProvider::SingleWeightProvider;
+        param_type dataType(const std::string&, int, int) const override { return param_type::WGT_FLOAT32; }
+    } provider(weights.data());
+    layer.loadParameters(&provider);
+    fyusion::opengl::FBO fbo(context(), width, maxtokens, tex[1]);
+    std::vector<float> result(width * maxtokens * PIXEL_PACKING);
+    int mismatches = 0;
+    // single token (decoding) as well as multiple tokens (prompt), all in the same pass
+    for (int tokens : {1, maxtokens}) {
+        StateToken token;
+        token.seqLength = tokens;
+        layer.forward(1, &token);
+        fbo.writeToMemory<float, GL_FLOAT>(result.data(), PIXEL_PACKING, (GLsizei)(result.size() * sizeof(float)));
+        for (int row=0; row < tokens; row++) {
+            const float * in = input.data() + row * width * PIXEL_PACKING;
+            const float * out = result.data() + row * width * PIXEL_PACKING;
+            double sumsq = 0.0;
+            for (int i=0; i < embed; i++) sumsq += in[i] * in[i];
+            float scale = 1.0f / sqrtf((float)(sumsq / embed) + 1.0e-6f);
+            for (int i=0; i < embed; i++) {
+                if (fabsf(out[i] - in[i] * weights[i] * scale) > 1.0e-3f) mismatches++;
+            }
+        }
+    }
+    layer.cleanup();
+    ASSERT_EQ(mismatches, 0);
+}
+
+TEST_F(MiscLayerTest, FusedGateUpProjection) {
+    using namespace fyusion::fyusenet::gpu::custom::sequence;
+    const int embed = 64, proj = 32, outdim = 16, qgs = 32, maxtokens = 9;
+    QuantMatrix gate = quantize(embed, proj, qgs, 1), up = quantize(embed, proj, qgs, 2), down = quantize(proj, outdim, qgs, 3);
+    NamedProvider provider;
+    provider.add("gate", gate);
+    provider.add("up", up);
+    provider.add("down", down);
+    std::unique_ptr<CustomLayerBuilder> gubld(LinearGateUpLayer::createBuilder("gateup", "gate", "up", qt_type::QT_MIXED_FLOAT, param_type::WGT_INT4, qgs));
+    gubld->context(context()).sequence(maxtokens).inChannels(embed).outChannels(proj).number(1);
+    std::unique_ptr<CustomLayerBuilder> dnbld(LinearHadamardLayer::createBuilder("down", qt_type::QT_MIXED_FLOAT, param_type::WGT_INT4, qgs, false, true));
+    dnbld->context(context()).sequence(maxtokens).inChannels(proj).outChannels(outdim).prefixAct(ActType::SILU, 1).number(2);
+    // same down projection with a residual input (as used in the LLaMa sample), which runs the primed shader variants
+    std::unique_ptr<CustomLayerBuilder> dnresbld(LinearHadamardLayer::createBuilder("down", qt_type::QT_MIXED_FLOAT, param_type::WGT_INT4, qgs, false, true));
+    dnresbld->context(context()).sequence(maxtokens).inChannels(proj).outChannels(outdim).prefixAct(ActType::SILU, 1).residual().number(3);
+    LinearGateUpLayer gateup(*gubld);
+    LinearHadamardLayer downproj(*dnbld);
+    LinearHadamardLayer downres(*dnresbld);
+    ASSERT_EQ(gateup.projectionChannels(), proj);
+    ASSERT_EQ(downproj.numInputPorts(), 1);
+    ASSERT_EQ(downres.numInputPorts(), 2);
+    std::vector<float> input(embed * maxtokens), residual(outdim * maxtokens);
+    for (int i=0; i < (int)input.size(); i++) input[i] = 0.25f * (float)((i * 7) % 9) - 1.0f;
+    for (int i=0; i < (int)residual.size(); i++) residual[i] = 0.5f * (float)((i * 5) % 7) - 1.5f;
+    GLuint tex[5];
+    glGenTextures(5, tex);
+    configureTexture(tex[0], embed / PIXEL_PACKING, maxtokens, GL_RGBA32F, GL_RGBA, GL_FLOAT, input.data());
+    configureTexture(tex[1], 2 * proj / PIXEL_PACKING, maxtokens, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+    configureTexture(tex[2], outdim / PIXEL_PACKING, maxtokens, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+    configureTexture(tex[3], outdim / PIXEL_PACKING, maxtokens, GL_RGBA32F, GL_RGBA, GL_FLOAT, residual.data());
+    configureTexture(tex[4], outdim / PIXEL_PACKING, maxtokens, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+    for (int i=0; i < 5; i++) testTextures_.push_back(tex[i]);
+    addInputTexture(&gateup, tex[0], 0);
+    addOutputTexture(&gateup, tex[1], 0);
+    addInputTexture(&downproj, tex[1], 0);
+    addOutputTexture(&downproj, tex[2], 0);
+    addInputTexture(&downres, tex[1], 0);
+    addResidualTexture(&downres, tex[3], 0);
+    addOutputTexture(&downres, tex[4], 0);
+    gateup.setup();
+    downproj.setup();
+    downres.setup();
+    gateup.loadParameters(&provider);
+    downproj.loadParameters(&provider);
+    downres.loadParameters(&provider);
+    fyusion::opengl::FBO midfbo(context(), 2 * proj / PIXEL_PACKING, maxtokens, tex[1]);
+    fyusion::opengl::FBO outfbo(context(), outdim / PIXEL_PACKING, maxtokens, tex[2]);
+    fyusion::opengl::FBO resfbo(context(), outdim / PIXEL_PACKING, maxtokens, tex[4]);
+    std::vector<float> mid(2 * proj * maxtokens), result(outdim * maxtokens), resresult(outdim * maxtokens);
+    int midmismatch = 0, outmismatch = 0, resmismatch = 0;
+    // short (decoding) as well as long (prompt) sequences use different shader paths
+    for (int tokens : {2, maxtokens}) {
+        StateToken token;
+        token.seqLength = tokens;
+        gateup.forward(1, &token);
+        downproj.forward(1, &token);
+        downres.forward(1, &token);
+        midfbo.writeToMemory<float, GL_FLOAT>(mid.data(), PIXEL_PACKING, (GLsizei)(mid.size() * sizeof(float)));
+        outfbo.writeToMemory<float, GL_FLOAT>(result.data(), PIXEL_PACKING, (GLsizei)(result.size() * sizeof(float)));
+        resfbo.writeToMemory<float, GL_FLOAT>(resresult.data(), PIXEL_PACKING, (GLsizei)(resresult.size() * sizeof(float)));
+        for (int t=0; t < tokens; t++) {
+            std::vector<float> hidden(proj);
+            for (int c=0; c < proj; c++) {
+                float g = 0.0f, u = 0.0f;
+                for (int r=0; r < embed; r++) {
+                    g += input[t * embed + r] * gate.dequant[r * proj + c];
+                    u += input[t * embed + r] * up.dequant[r * proj + c];
+                }
+                // gate in even, up projection in odd pixels
+                int pix = (c / PIXEL_PACKING) * 2 * PIXEL_PACKING + (c % PIXEL_PACKING);
+                if (fabsf(mid[t * 2 * proj + pix] - g) > 1.0e-2f * (1.0f + fabsf(g))) midmismatch++;
+                if (fabsf(mid[t * 2 * proj + pix + PIXEL_PACKING] - u) > 1.0e-2f * (1.0f + fabsf(u))) midmismatch++;
+                hidden[c] = g / (1.0f + expf(-g)) * u;
+            }
+            for (int o=0; o < outdim; o++) {
+                float y = 0.0f;
+                for (int c=0; c < proj; c++) y += hidden[c] * down.dequant[c * outdim + o];
+                if (fabsf(result[t * outdim + o] - y) > 1.0e-2f * (1.0f + fabsf(y))) outmismatch++;
+                float yres = y + residual[t * outdim + o];
+                if (fabsf(resresult[t * outdim + o] - yres) > 1.0e-2f * (1.0f + fabsf(yres))) resmismatch++;
+            }
+        }
+    }
+    gateup.cleanup();
+    downproj.cleanup();
+    downres.cleanup();
+    ASSERT_EQ(midmismatch, 0);
+    ASSERT_EQ(outmismatch, 0);
+    ASSERT_EQ(resmismatch, 0);
+}
+
+
+TEST_F(MiscLayerTest, MultiOutputMatMul) {
+    using namespace fyusion::fyusenet::gpu::sequence::rudiments;
+    using fyusion::opengl::GLStateCache;
+    const int embed = 64, proj = 16, qgs = 32, height = 10, groups = embed / qgs;
+    QuantMatrix mats[3] = {quantize(embed, proj, qgs, 1), quantize(embed, proj, qgs, 2), quantize(embed, proj, qgs, 3)};
+    // concatenate the three matrices column-wise
+    QuantMatrix cat;
+    for (int r=0; r < embed / 8; r++) {
+        for (auto & mat : mats) cat.weights.insert(cat.weights.end(), mat.weights.begin() + r * proj, mat.weights.begin() + (r + 1) * proj);
+    }
+    for (int g=0; g < groups; g++) {
+        for (auto & mat : mats) {
+            cat.scales.insert(cat.scales.end(), mat.scales.begin() + g * proj, mat.scales.begin() + (g + 1) * proj);
+            cat.zeros.insert(cat.zeros.end(), mat.zeros.begin() + g * (proj / 8), mat.zeros.begin() + (g + 1) * (proj / 8));
+        }
+    }
+    MatMulConst mul(gpu::rudiments::PreambleGenerator(), embed, 3 * proj, height, param_type::WGT_INT4, qgs, false, false, false, context());
+    mul.multiOutput(3);
+    mul.setup();
+    DefaultDataWrapper<uint8_t> wgtwrap(reinterpret_cast<const uint8_t *>(cat.weights.data()));
+    DefaultDataWrapper<uint8_t> zerowrap(reinterpret_cast<const uint8_t *>(cat.zeros.data()));
+    DefaultDataWrapper<float> scalewrap(cat.scales.data());
+    mul.loadWeights(DataBlob(&wgtwrap));
+    mul.loadQuantizationTables(DataBlob(&scalewrap), DataBlob(&zerowrap));
+    std::vector<float> input(embed * height);
+    for (int i=0; i < (int)input.size(); i++) input[i] = 0.25f * (float)((i * 7) % 9) - 1.0f;
+    GLuint tex[4];
+    glGenTextures(4, tex);
+    configureTexture(tex[0], embed / PIXEL_PACKING, height, GL_RGBA32F, GL_RGBA, GL_FLOAT, input.data());
+    for (int i=1; i < 4; i++) configureTexture(tex[i], proj / PIXEL_PACKING, height, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+    for (int i=0; i < 4; i++) testTextures_.push_back(tex[i]);
+    fyusion::opengl::FBO target(context(), proj / PIXEL_PACKING, height, tex[1]);
+    target.addTexture(GL_COLOR_ATTACHMENT1, tex[2], GL_TEXTURE_2D);
+    target.addTexture(GL_COLOR_ATTACHMENT2, tex[3], GL_TEXTURE_2D);
+    target.setWriteMask();
+    target.unbind();
+    std::vector<float> result(proj * height);
+    int mismatch = 0;
+    // short (decoding) as well as long (prompt) sequences use different shader paths
+    for (auto [tokens, offset] : {std::pair<int, int>{2, 1}, std::pair<int, int>{9, 0}}) {
+        GLStateCache::activeTexture(GL_TEXTURE0 + MatMulConst::INPUT0_UNIT);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, tex[0]);
+        GLStateCache::enable(GL_SCISSOR_TEST);
+        mul.forward(tokens, offset, &target);
+        GLStateCache::disable(GL_SCISSOR_TEST);
+        for (int out=0; out < 3; out++) {
+            fyusion::opengl::FBO readback(context(), proj / PIXEL_PACKING, height, tex[out + 1]);
+            readback.writeToMemory<float, GL_FLOAT>(result.data(), PIXEL_PACKING, (GLsizei)(result.size() * sizeof(float)));
+            for (int t=0; t < tokens; t++) {
+                for (int c=0; c < proj; c++) {
+                    float y = 0.0f;
+                    for (int r=0; r < embed; r++) y += input[t * embed + r] * mats[out].dequant[r * proj + c];
+                    if (fabsf(result[(t + offset) * proj + c] - y) > 1.0e-2f * (1.0f + fabsf(y))) mismatch++;
+                }
+            }
+        }
+    }
+    ASSERT_EQ(mismatch, 0);
+}
+
+
+TEST_F(MiscLayerTest, TiledAttention) {
+    using namespace fyusion::fyusenet::gpu::sequence::rudiments;
+    using fyusion::opengl::GLStateCache;
+    const int heads = 8, hdim = 8, maxseq = 24, embed = heads * hdim, block = 5;
+    std::vector<float> query(embed * maxseq), key(embed * maxseq), value(embed * maxseq);
+    srand(31337);
+    for (auto * data : {&query, &key, &value}) {
+        for (float & v : *data) v = 2.0f * ((float)rand() / (float)RAND_MAX) - 1.0f;
+    }
+    std::vector<float> result(embed * maxseq);
+    int mismatch = 0;
+    // regular multi-head attention as well as grouped-query attention with shared key/value heads
+    for (int kvheads : {heads, 2}) {
+        const int kvembed = kvheads * hdim;
+        TiledAttention att(heads, kvheads, hdim, block, maxseq, context());
+        att.setup(0);
+        GLuint tex[4];
+        glGenTextures(4, tex);
+        configureTexture(tex[0], embed / PIXEL_PACKING, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, query.data());
+        configureTexture(tex[1], kvembed / PIXEL_PACKING, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, key.data());
+        configureTexture(tex[2], kvembed / PIXEL_PACKING, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, value.data());
+        configureTexture(tex[3], embed / PIXEL_PACKING, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+        for (int i=0; i < 4; i++) testTextures_.push_back(tex[i]);
+        fyusion::opengl::FBO target(context(), embed / PIXEL_PACKING, maxseq, tex[3]);
+        target.unbind();
+        // prompt processing from scratch as well as a multi-token continuation of a cached sequence
+        for (auto [tokenidx, tokens] : {std::pair<int, int>{0, 17}, std::pair<int, int>{13, 3}}) {
+            int keylen = tokenidx + tokens;
+            GLStateCache::enable(GL_SCISSOR_TEST);
+            att.forward(tex[0], tex[1], tex[2], tokenidx, tokens, keylen, &target);
+            GLStateCache::disable(GL_SCISSOR_TEST);
+            target.writeToMemory<float, GL_FLOAT>(result.data(), PIXEL_PACKING, (GLsizei)(result.size() * sizeof(float)));
+            // the query texture is read from its first row on
+            mismatch += attentionMismatches(result.data(), query.data(), key.data(), value.data(), heads, kvheads, hdim, tokenidx, tokens, 5.0e-3f);
+        }
+    }
+    ASSERT_EQ(mismatch, 0);
+}
+
+TEST_F(MiscLayerTest, QuantizedKVCache) {
+    using namespace fyusion::fyusenet::gpu::sequence::rudiments;
+    using fyusion::opengl::GLStateCache;
+    const int heads = 8, kvheads = 2, hdim = 8, maxseq = 24, block = 5;
+    const int embed = heads * hdim, kvembed = kvheads * hdim, cached = 13, total = 16;
+    std::vector<float> query(embed * maxseq), key(kvembed * maxseq), value(kvembed * maxseq);
+    srand(4711);
+    for (auto * data : {&query, &key, &value}) {
+        for (float & v : *data) v = 2.0f * ((float)rand() / (float)RAND_MAX) - 1.0f;
+    }
+    std::vector<float> qkey = quantizeKV(key, total, kvheads, hdim), qvalue = quantizeKV(value, total, kvheads, hdim);
+    KVQuantizer quantizer(kvheads, hdim, context());
+    quantizer.setup();
+    TiledAttention att(heads, kvheads, hdim, block, maxseq, context());
+    att.quantizedCache();
+    att.setup(0);
+    // 0: query, 1/2: float key/value staging, 3/4: int8 key/value cache, 5/6: key/value scales, 7: output
+    GLuint tex[8];
+    glGenTextures(8, tex);
+    configureTexture(tex[0], embed / PIXEL_PACKING, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, query.data());
+    configureTexture(tex[1], kvembed / PIXEL_PACKING, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+    configureTexture(tex[2], kvembed / PIXEL_PACKING, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+    configureTexture(tex[3], kvembed / PIXEL_PACKING, maxseq, GL_RGBA8I, GL_RGBA_INTEGER, GL_BYTE, nullptr);
+    configureTexture(tex[4], kvembed / PIXEL_PACKING, maxseq, GL_RGBA8I, GL_RGBA_INTEGER, GL_BYTE, nullptr);
+    configureTexture(tex[5], 1, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+    configureTexture(tex[6], 1, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+    configureTexture(tex[7], embed / PIXEL_PACKING, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+    for (int i=0; i < 8; i++) testTextures_.push_back(tex[i]);
+    fyusion::opengl::FBO keycache(context(), kvembed / PIXEL_PACKING, maxseq, tex[3]);
+    fyusion::opengl::FBO valuecache(context(), kvembed / PIXEL_PACKING, maxseq, tex[4]);
+    fyusion::opengl::FBO keyscales(context(), 1, maxseq, tex[5]);
+    fyusion::opengl::FBO valuescales(context(), 1, maxseq, tex[6]);
+    fyusion::opengl::FBO target(context(), embed / PIXEL_PACKING, maxseq, tex[7]);
+    target.unbind();
+    std::vector<float> result(embed * maxseq);
+    int mismatch = 0;
+    // fill the cache with a prompt first and append a few tokens afterwards, staging always starts at row 0
+    for (auto [tokenidx, tokens] : {std::pair<int, int>{0, cached}, std::pair<int, int>{cached, total - cached}}) {
+        int keylen = tokenidx + tokens;
+        glBindTexture(GL_TEXTURE_2D, tex[1]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, kvembed / PIXEL_PACKING, tokens, GL_RGBA, GL_FLOAT, key.data() + tokenidx * kvembed);
+        glBindTexture(GL_TEXTURE_2D, tex[2]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, kvembed / PIXEL_PACKING, tokens, GL_RGBA, GL_FLOAT, value.data() + tokenidx * kvembed);
+        glBindTexture(GL_TEXTURE_2D, tex[0]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, embed / PIXEL_PACKING, tokens, GL_RGBA, GL_FLOAT, query.data() + tokenidx * embed);
+        GLStateCache::enable(GL_SCISSOR_TEST);
+        quantizer.forward(tex[1], tokens, tokenidx, &keycache, &keyscales);
+        quantizer.forward(tex[2], tokens, tokenidx, &valuecache, &valuescales);
+        GLStateCache::activeTexture(GL_TEXTURE0 + KVQuantizer::KEY_SCALE_UNIT);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, tex[5]);
+        GLStateCache::activeTexture(GL_TEXTURE0 + KVQuantizer::VALUE_SCALE_UNIT);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, tex[6]);
+        att.forward(tex[0], tex[3], tex[4], tokenidx, tokens, keylen, &target);
+        GLStateCache::disable(GL_SCISSOR_TEST);
+        target.writeToMemory<float, GL_FLOAT>(result.data(), PIXEL_PACKING, (GLsizei)(result.size() * sizeof(float)));
+        mismatch += attentionMismatches(result.data(), query.data() + tokenidx * embed, qkey.data(), qvalue.data(), heads, kvheads, hdim, tokenidx, tokens, 1.0e-2f);
+    }
+    ASSERT_EQ(mismatch, 0);
+}
+
+TEST_F(MiscLayerTest, QuantizedKVCacheDecode) {
+    using namespace fyusion::fyusenet::gpu::sequence::rudiments;
+    using fyusion::opengl::GLStateCache;
+    const int heads = 8, kvheads = 2, hdim = 16, maxseq = 24;
+    const int embed = heads * hdim, kvembed = kvheads * hdim, cached = 13, total = 16;
+    std::vector<float> query(embed * maxseq), key(kvembed * maxseq), value(kvembed * maxseq);
+    srand(2711);
+    for (auto * data : {&query, &key, &value}) {
+        for (float & v : *data) v = 2.0f * ((float)rand() / (float)RAND_MAX) - 1.0f;
+    }
+    std::vector<float> qkey = quantizeKV(key, total, kvheads, hdim), qvalue = quantizeKV(value, total, kvheads, hdim);
+    KVQuantizer quantizer(kvheads, hdim, context());
+    quantizer.setup();
+    DotProductSingle dotprod(embed / PIXEL_PACKING, heads, kvheads, hdim, context());
+    MaskedSoftMaxSingle softmax(heads, hdim, context());
+    AttentionMulSingle attmul(embed / PIXEL_PACKING, heads, kvheads, hdim, context());
+    dotprod.quantizedCache();
+    attmul.quantizedCache();
+    dotprod.setup();
+    softmax.setup(0);
+    attmul.setup();
+    // 0: query, 1/2: float key/value staging, 3/4: int8 key/value cache, 5/6: key/value scales,
+    // 7: dot-products, 8: attention weights, 9: output
+    GLuint tex[10];
+    glGenTextures(10, tex);
+    configureTexture(tex[0], embed / PIXEL_PACKING, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+    configureTexture(tex[1], kvembed / PIXEL_PACKING, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, key.data());
+    configureTexture(tex[2], kvembed / PIXEL_PACKING, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, value.data());
+    configureTexture(tex[3], kvembed / PIXEL_PACKING, maxseq, GL_RGBA8I, GL_RGBA_INTEGER, GL_BYTE, nullptr);
+    configureTexture(tex[4], kvembed / PIXEL_PACKING, maxseq, GL_RGBA8I, GL_RGBA_INTEGER, GL_BYTE, nullptr);
+    configureTexture(tex[5], 1, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+    configureTexture(tex[6], 1, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+    configureTexture(tex[7], maxseq, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+    configureTexture(tex[8], maxseq, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+    configureTexture(tex[9], embed / PIXEL_PACKING, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+    for (int i=0; i < 10; i++) testTextures_.push_back(tex[i]);
+    fyusion::opengl::FBO keycache(context(), kvembed / PIXEL_PACKING, maxseq, tex[3]);
+    fyusion::opengl::FBO valuecache(context(), kvembed / PIXEL_PACKING, maxseq, tex[4]);
+    fyusion::opengl::FBO keyscales(context(), 1, maxseq, tex[5]);
+    fyusion::opengl::FBO valuescales(context(), 1, maxseq, tex[6]);
+    fyusion::opengl::FBO dotprods(context(), maxseq, maxseq, tex[7]);
+    fyusion::opengl::FBO weights(context(), maxseq, maxseq, tex[8]);
+    fyusion::opengl::FBO target(context(), embed / PIXEL_PACKING, maxseq, tex[9]);
+    target.unbind();
+    // the cache is filled by the prompt, the following tokens are quantized one at a time while decoding
+    GLStateCache::enable(GL_SCISSOR_TEST);
+    quantizer.forward(tex[1], cached, 0, &keycache, &keyscales);
+    quantizer.forward(tex[2], cached, 0, &valuecache, &valuescales);
+    GLStateCache::disable(GL_SCISSOR_TEST);
+    std::vector<float> result(embed * maxseq);
+    int mismatch = 0;
+    for (int tokenidx=cached; tokenidx < total; tokenidx++) {
+        GLStateCache::activeTexture(GL_TEXTURE0);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, tex[1]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, kvembed / PIXEL_PACKING, 1, GL_RGBA, GL_FLOAT, key.data() + tokenidx * kvembed);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, tex[2]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, kvembed / PIXEL_PACKING, 1, GL_RGBA, GL_FLOAT, value.data() + tokenidx * kvembed);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, tex[0]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, embed / PIXEL_PACKING, 1, GL_RGBA, GL_FLOAT, query.data() + tokenidx * embed);
+        GLStateCache::enable(GL_SCISSOR_TEST);
+        quantizer.forward(tex[1], 1, tokenidx, &keycache, &keyscales);
+        quantizer.forward(tex[2], 1, tokenidx, &valuecache, &valuescales);
+        GLStateCache::activeTexture(GL_TEXTURE0 + KVQuantizer::KEY_SCALE_UNIT);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, tex[5]);
+        GLStateCache::activeTexture(GL_TEXTURE0 + KVQuantizer::VALUE_SCALE_UNIT);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, tex[6]);
+        dotprod.forward(tex[0], tex[3], tokenidx + 1, &dotprods);
+        softmax.forward(tex[7], tokenidx, tokenidx + 1, &weights);
+        attmul.forward(tex[4], tex[8], tokenidx, tokenidx + 1, &target);
+        GLStateCache::disable(GL_SCISSOR_TEST);
+        target.writeToMemory<float, GL_FLOAT>(result.data(), PIXEL_PACKING, (GLsizei)(result.size() * sizeof(float)));
+        mismatch += attentionMismatches(result.data(), query.data() + tokenidx * embed, qkey.data(), qvalue.data(), heads, kvheads, hdim, tokenidx, 1, 1.0e-2f);
+    }
+    ASSERT_EQ(mismatch, 0);
+}
+
+TEST_F(MiscLayerTest, QuantizedKVCacheLayer) {
+    const int heads = 8, kvheads = 2, hdim = 16, embed = heads * hdim, qgs = 32, maxseq = 32;
+    NamedProvider provider;
+    QuantMatrix qmat = quantize(embed, embed, qgs, 1), kmat = quantize(embed, kvheads * hdim, qgs, 2);
+    QuantMatrix vmat = quantize(embed, kvheads * hdim, qgs, 3), omat = quantize(embed, embed, qgs, 4);
+    provider.add("att.query", qmat);
+    provider.add("att.key", kmat);
+    provider.add("att.value", vmat);
+    provider.add("att.out", omat);
+    std::vector<float> input(embed * maxseq);
+    srand(99);
+    for (float & v : input) v = 2.0f * ((float)rand() / (float)RAND_MAX) - 1.0f;
+    int mismatch = 0;
+    // tiled attention as well as the batched path for the prompt, decoding always uses the single-token path
+    for (int blocksize : {8, 0}) {
+        // results for the default, the half-precision and the 8-bit cache (in that order)
+        std::vector<std::vector<float>> results[3];
+        for (KVCacheType cache : {KVCacheType::DEFAULT, KVCacheType::FLOAT16, KVCacheType::INT8}) {
+            AttentionLayerBuilder bld("att");
+            bld.sequence(maxseq).channels(embed).heads(heads).headDim(hdim).kvHeads(kvheads).keyBlockSize(blocksize).kvCache(cache)
+                .quantize(qt_type::QT_MIXED_FLOAT, param_type::WGT_INT4).quantGroupSize(qgs)
+                .positionalEncoding(PosEncType::ROTARY).rotaryThetaBase(10000.0f).incremental().causal().context(context()).number(1);
+            sequence::CausalMultiHeadAttentionLayer layer(bld, 1);
+            GLuint tex[2];
+            glGenTextures(2, tex);
+            configureTexture(tex[0], embed / PIXEL_PACKING, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+            configureTexture(tex[1], embed / PIXEL_PACKING, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+            for (int i=0; i < 2; i++) testTextures_.push_back(tex[i]);
+            addInputTexture(&layer, tex[0], 0);
+            addOutputTexture(&layer, tex[1], 0);
+            layer.setup();
+            layer.loadParameters(&provider);
+            fyusion::opengl::FBO readback(context(), embed / PIXEL_PACKING, maxseq, tex[1]);
+            readback.unbind();
+            // prompt, followed by single-token and multi-token continuations that append to the cache
+            int tokenidx = 0;
+            for (int tokens : {17, 1, 3, 1}) {
+                fyusion::opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+                fyusion::opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, tex[0]);
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, embed / PIXEL_PACKING, tokens, GL_RGBA, GL_FLOAT, input.data() + tokenidx * embed);
+                StateToken state;
+                state.seqLength = tokens;
+                state.seqIndex = tokenidx;
+                state.reset = (tokenidx == 0);
+                layer.forward(1, &state);
+                std::vector<float> result(embed * maxseq);
+                readback.writeToMemory<float, GL_FLOAT>(result.data(), PIXEL_PACKING, (GLsizei)(result.size() * sizeof(float)));
+                result.resize(tokens * embed);
+                results[(int)cache].push_back(result);
+                tokenidx += tokens;
+            }
+            layer.cleanup();
+        }
+        for (size_t step=0; step < results[0].size(); step++) {
+            for (size_t i=0; i < results[0][step].size(); i++) {
+                float y = results[0][step][i];
+                if (fabsf(results[(int)KVCacheType::FLOAT16][step][i] - y) > 1.0e-2f * (1.0f + fabsf(y))) mismatch++;
+                if (fabsf(results[(int)KVCacheType::INT8][step][i] - y) > 5.0e-2f * (1.0f + fabsf(y))) mismatch++;
+            }
+        }
+    }
+    ASSERT_EQ(mismatch, 0);
+}
+
+TEST_F(MiscLayerTest, FusedQKVAttentionLayer) {
+    const int heads = 8, hdim = 16, embed = heads * hdim, qgs = 32, maxseq = 32, total = 19;
+    const float theta = 10000.0f;
+    std::vector<float> input(embed * maxseq);
+    srand(8086);
+    for (float & v : input) v = 2.0f * ((float)rand() / (float)RAND_MAX) - 1.0f;
+    int mismatch = 0;
+    // as many key/value heads as query heads run a single fused Q/K/V projection, the grouped
+    // variant uses separate projections and cross-checks the reference
+    for (int kvheads : {heads, 2}) {
+        const int kvembed = kvheads * hdim;
+        QuantMatrix qmat = quantize(embed, embed, qgs, 1), kmat = quantize(embed, kvembed, qgs, 2);
+        QuantMatrix vmat = quantize(embed, kvembed, qgs, 3), omat = quantize(embed, embed, qgs, 4);
+        NamedProvider provider;
+        provider.add("att.query", qmat);
+        provider.add("att.key", kmat);
+        provider.add("att.value", vmat);
+        provider.add("att.out", omat);
+        // CPU reference for the whole sequence
+        std::vector<float> query = matMulReference(input.data(), total, qmat, embed, embed);
+        std::vector<float> key = matMulReference(input.data(), total, kmat, embed, kvembed);
+        std::vector<float> value = matMulReference(input.data(), total, vmat, embed, kvembed);
+        rotaryReference(query, total, heads, hdim, theta);
+        rotaryReference(key, total, kvheads, hdim, theta);
+        AttentionLayerBuilder bld("att");
+        bld.sequence(maxseq).channels(embed).heads(heads).headDim(hdim).kvHeads(kvheads)
+            .quantize(qt_type::QT_MIXED_FLOAT, param_type::WGT_INT4).quantGroupSize(qgs)
+            .positionalEncoding(PosEncType::ROTARY).rotaryThetaBase(theta).incremental().causal().context(context()).number(1);
+        sequence::CausalMultiHeadAttentionLayer layer(bld, 1);
+        GLuint tex[2];
+        glGenTextures(2, tex);
+        configureTexture(tex[0], embed / PIXEL_PACKING, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+        configureTexture(tex[1], embed / PIXEL_PACKING, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+        for (int i=0; i < 2; i++) testTextures_.push_back(tex[i]);
+        addInputTexture(&layer, tex[0], 0);
+        addOutputTexture(&layer, tex[1], 0);
+        layer.setup();
+        layer.loadParameters(&provider);
+        fyusion::opengl::FBO readback(context(), embed / PIXEL_PACKING, maxseq, tex[1]);
+        readback.unbind();
+        std::vector<float> result(embed * maxseq);
+        // prompt, followed by two decoding steps
+        int tokenidx = 0;
+        for (int tokens : {17, 1, 1}) {
+            fyusion::opengl::GLStateCache::activeTexture(GL_TEXTURE0);
+            fyusion::opengl::GLStateCache::bindTexture(GL_TEXTURE_2D, tex[0]);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, embed / PIXEL_PACKING, tokens, GL_RGBA, GL_FLOAT, input.data() + tokenidx * embed);
+            StateToken state;
+            state.seqLength = tokens;
+            state.seqIndex = tokenidx;
+            state.reset = (tokenidx == 0);
+            layer.forward(1, &state);
+            readback.writeToMemory<float, GL_FLOAT>(result.data(), PIXEL_PACKING, (GLsizei)(result.size() * sizeof(float)));
+            std::vector<float> att = attentionReference(query.data() + tokenidx * embed, key.data(), value.data(), heads, kvheads, hdim, tokenidx, tokens);
+            std::vector<float> ref = matMulReference(att.data(), tokens, omat, embed, embed);
+            for (int i=0; i < tokens * embed; i++) {
+                if (fabsf(result[i] - ref[i]) > 5.0e-2f * (1.0f + fabsf(ref[i]))) mismatch++;
+            }
+            tokenidx += tokens;
+        }
+        layer.cleanup();
+    }
+    ASSERT_EQ(mismatch, 0);
+}
+
+TEST_F(MiscLayerTest, GroupedQueryAttention) {
+    using namespace fyusion::fyusenet::gpu::sequence::rudiments;
+    using fyusion::opengl::GLStateCache;
+    // the dot-product rudiments process 4 pixels of a head per instance, which requires a head size of 16 or more
+    const int heads = 8, hdim = 16, maxseq = 40, embed = heads * hdim, maxbatch = 8;
+    std::vector<float> query(embed * maxseq), key(embed * maxseq), value(embed * maxseq);
+    srand(1234);
+    for (auto * data : {&query, &key, &value}) {
+        for (float & v : *data) v = 2.0f * ((float)rand() / (float)RAND_MAX) - 1.0f;
+    }
+    std::vector<float> result(embed * maxseq);
+    int mismatch = 0;
+    // key/value heads shared by 2 and 4 query heads (GQA) as well as a single key/value head (MQA)
+    for (int kvheads : {4, 2, 1}) {
+        const int kvembed = kvheads * hdim, batch = heads / PIXEL_PACKING;
+        DotProductSingle dpsingle(embed / PIXEL_PACKING, heads, kvheads, hdim, context());
+        MaskedSoftMaxSingle smsingle(heads, hdim, context());
+        AttentionMulSingle amsingle(embed / PIXEL_PACKING, heads, kvheads, hdim, context());
+        DotProductBatched dpbatched(heads, kvheads, hdim, maxbatch, context());
+        MaskedSoftMaxBatched smbatched(maxseq, maxbatch, context());
+        AttentionMulBatched ambatched(heads, kvheads, hdim, maxseq, context());
+        dpsingle.setup();
+        smsingle.setup(0);
+        amsingle.setup();
+        dpbatched.setup();
+        smbatched.setup(0);
+        ambatched.setup();
+        // 0: query, 1: key, 2: value, 3: dot-products, 4: attention weights, 5: output
+        GLuint tex[6];
+        glGenTextures(6, tex);
+        configureTexture(tex[0], embed / PIXEL_PACKING, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+        configureTexture(tex[1], kvembed / PIXEL_PACKING, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, key.data());
+        configureTexture(tex[2], kvembed / PIXEL_PACKING, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, value.data());
+        configureTexture(tex[3], maxseq, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+        configureTexture(tex[4], maxseq, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+        configureTexture(tex[5], embed / PIXEL_PACKING, maxseq, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
+        for (int i=0; i < 6; i++) testTextures_.push_back(tex[i]);
+        fyusion::opengl::FBO dotprods(context(), maxseq, maxseq, tex[3]);
+        fyusion::opengl::FBO weights(context(), maxseq, maxseq, tex[4]);
+        fyusion::opengl::FBO target(context(), embed / PIXEL_PACKING, maxseq, tex[5]);
+        target.unbind();
+        // single tokens take the decoding path, multiple tokens are processed in head batches
+        for (auto [tokenidx, tokens] : {std::pair<int, int>{0, 1}, std::pair<int, int>{13, 1}, std::pair<int, int>{0, 17}, std::pair<int, int>{13, 3}}) {
+            int keylen = tokenidx + tokens;
+            GLStateCache::activeTexture(GL_TEXTURE0);
+            GLStateCache::bindTexture(GL_TEXTURE_2D, tex[0]);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, embed / PIXEL_PACKING, tokens, GL_RGBA, GL_FLOAT, query.data() + tokenidx * embed);
+            GLStateCache::enable(GL_SCISSOR_TEST);
+            if (tokens == 1) {
+                dpsingle.forward(tex[0], tex[1], keylen, &dotprods);
+                smsingle.forward(tex[3], tokenidx, keylen, &weights);
+                amsingle.forward(tex[2], tex[4], tokenidx, keylen, &target);
+            } else {
+                dpbatched.forward(tex[0], tex[1], tokens, keylen, 0, batch, &dotprods);
+                smbatched.forward(tex[3], tokenidx, tokens, keylen, batch, &weights);
+                ambatched.forward(tex[2], tex[4], tokens, tokenidx, 0, batch, &target);
+            }
+            GLStateCache::disable(GL_SCISSOR_TEST);
+            target.writeToMemory<float, GL_FLOAT>(result.data(), PIXEL_PACKING, (GLsizei)(result.size() * sizeof(float)));
+            mismatch += attentionMismatches(result.data(), query.data() + tokenidx * embed, key.data(), value.data(), heads, kvheads, hdim, tokenidx, tokens, 5.0e-3f);
+        }
+    }
+    ASSERT_EQ(mismatch, 0);
+}
+
+TEST_F(MiscLayerTest, ProgramBinaryCacheRoundTrip) {
+    using namespace fyusion::opengl;
+    const std::string cachefile = (std::filesystem::temp_directory_path() / ("fyn_pbc_test_" + std::to_string(getpid()) + ".bin")).string();
+    std::remove(cachefile.c_str());
+    // closes the cache and removes its file, also when an assertion bails out early
+    struct CacheCleanup {
+        const std::string & file;
+        ~CacheCleanup() {
+            ProgramBinaryCache::close();
+            std::remove(file.c_str());
+        }
+    } cachecleanup{cachefile};
+    std::vector<shaderptr> shaders;
+    auto makeprog = [&]() {
+        shaderptr vert(new VertexShader(context()));
+        shaderptr frag(new FragmentShader(context()));
+        vert->setCode(ShaderRepository::getShader("shaders/default.vert"));
+        frag->setCode(ShaderRepository::getShader("shaders/add.frag"));
+        vert->setPreprocDefs("#define NUM_LANES 1\n#define SIGNED 1\n#define PBC_TEST_UNIQUE 1\n");
+        frag->setPreprocDefs("#define NUM_LANES 1\n#define SIGNED 1\n#define PBC_TEST_UNIQUE 1\n");
+        programptr prog = ShaderProgram::createInstance(context());
+        prog->addShader(vert);
+        prog->addShader(frag);
+        prog->bindAttributeLocation("attributes0", 0);
+        prog->link();
+        shaders = {vert, frag};
+        return prog;
+    };
+    ProgramBinaryCache * cache = ProgramBinaryCache::open(cachefile);
+    if (!cache) GTEST_SKIP() << "Program binaries not supported by GL implementation";
+    ASSERT_EQ(cache->size(), (size_t)0);
+    programptr first = makeprog();
+    ASSERT_TRUE(first->isLinked());
+    ASSERT_EQ(cache->size(), (size_t)1);
+    for (const shaderptr & shader : shaders) ASSERT_TRUE(shader->isCompiled());
+    ProgramBinaryCache::close();
+    // re-open from file, linking the same program must be served from the cache without compiling
+    cache = ProgramBinaryCache::open(cachefile);
+    ASSERT_NE(cache, nullptr);
+    ASSERT_EQ(cache->size(), (size_t)1);
+    programptr second = makeprog();
+    ASSERT_TRUE(second->isLinked());
+    ASSERT_EQ(cache->size(), (size_t)1);
+    for (const shaderptr & shader : shaders) ASSERT_FALSE(shader->isCompiled());
+    ASSERT_GE(second->resolveLocation("op1Layer0", true), 0);
+}
+
+
+TEST_F(MiscLayerTest, PBOPoolSizeClasses) {
+    using namespace fyusion::opengl;
+    auto * pool = new PBOPool(2, context());
+    ASSERT_EQ(pool->prewarm(64, 64, 4, 1, 2, PBO::WRITE), 2);
+    ASSERT_EQ(pool->prewarm(64, 64, 4, 1, 2, PBO::WRITE), 0);
+    {
+        // smaller requests are served from the pre-warmed (larger) size class
+        ManagedPBO first = pool->getAvailablePBO(16, 16, 4, 1);
+        ManagedPBO second = pool->getAvailablePBO(64, 64, 4, 1);
+        ASSERT_NE(*first, *second);
+        // pool is exhausted, the next request must be woken up by a release
+        PBO * secondpbo = *second;
+        std::atomic<bool> served{false};
+        std::thread waiter([&]() {
+            ManagedPBO third = pool->getAvailablePBO(64, 64, 4, 1);
+            served = (*third == secondpbo);
+        });
+        while (pool->getStatistics().waits == 0) std::this_thread::yield();
+        second = ManagedPBO();
+        waiter.join();
+        EXPECT_TRUE(served);
+    }
+    PBOPool::statistics stats = pool->getStatistics();
+    EXPECT_EQ(stats.requests, (uint64_t)3);
+    EXPECT_EQ(stats.immediateHits, (uint64_t)2);
+    EXPECT_EQ(stats.waits, (uint64_t)1);
+    EXPECT_EQ(stats.created, (uint64_t)2);
+    EXPECT_EQ(stats.current, 2);
+    EXPECT_EQ(stats.busy, 0);
+    delete pool;
+}
+
+TEST_F(MiscLayerTest, GLStateCacheElision) {
+    using namespace fyusion::opengl;
+    ASSERT_NE(GLStateCache::current(), nullptr);
+    GLStateCache::invalidate();
+    GLStateCache::statistics before = GLStateCache::getStatistics();
+    GLStateCache::viewport(0, 0, 16, 16);
+    GLStateCache::viewport(0, 0, 16, 16);
+    GLStateCache::disable(GL_BLEND);
+    GLStateCache::disable(GL_BLEND);
+    GLStateCache::enable(GL_BLEND);
+    GLStateCache::disable(GL_BLEND);
+    GLStateCache::statistics after = GLStateCache::getStatistics();
+    EXPECT_EQ(after.issued - before.issued, (uint64_t)4);
+    EXPECT_EQ(after.elided - before.elided, (uint64_t)2);
+    // state that was changed behind the back of the cache is re-issued after invalidation
+    glViewport(0, 0, 8, 8);
+    GLStateCache::invalidate();
+    GLStateCache::viewport(0, 0, 16, 16);
+    GLint vp[4] = {0};
+    glGetIntegerv(GL_VIEWPORT, vp);
+    EXPECT_EQ(vp[2], 16);
+    // deleted texture names may be re-used by GL, bindings must not be elided afterwards
+    GLuint tex[2] = {0};
+    glGenTextures(1, &tex[0]);
+    GLStateCache::activeTexture(GL_TEXTURE0);
+    GLStateCache::bindTexture(GL_TEXTURE_2D, tex[0]);
+    GLStateCache::deleteTextures(1, &tex[0]);
+    glGenTextures(1, &tex[1]);
+    GLStateCache::bindTexture(GL_TEXTURE_2D, tex[1]);
+    GLint bound = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+    EXPECT_EQ((GLuint)bound, tex[1]);
+    GLStateCache::bindTexture(GL_TEXTURE_2D, 0);
+    GLStateCache::deleteTextures(1, &tex[1]);
+}
+
+TEST_F(MiscLayerTest, GLCommandBufferReplay) {
+    using namespace fyusion::opengl;
+    GLuint tex[3] = {0};
+    GLuint fbo = 0;
+    glGenTextures(3, tex);
+    for (int i=0; i < 3; i++) {
+        GLStateCache::bindTexture(GL_TEXTURE_2D, tex[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 4, 4, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glGenFramebuffers(1, &fbo);
+    GLStateCache::bindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex[0], 0);
+    ASSERT_EQ(glCheckFramebufferStatus(GL_FRAMEBUFFER), (GLenum)GL_FRAMEBUFFER_COMPLETE);
+    GLStateCache::bindFramebuffer(GL_FRAMEBUFFER, 0);
+    // record a clear of the FBO and a binding of a texture that is mapped to a slot
+    GLCommandBuffer commands;
+    int slot = commands.addTextureSlot(tex[1]);
+    commands.begin();
+    EXPECT_EQ(GLCommandBuffer::recorder(), &commands);
+    GLStateCache::bindFramebuffer(GL_FRAMEBUFFER, fbo);
+    GLStateCache::viewport(0, 0, 4, 4);
+    GLStateCache::clearColor(1.0f, 0.0f, 0.0f, 1.0f);
+    GLCommandBuffer::clear(GL_COLOR_BUFFER_BIT);
+    GLStateCache::activeTexture(GL_TEXTURE0);
+    GLStateCache::bindTexture(GL_TEXTURE_2D, tex[1]);
+    commands.end();
+    EXPECT_EQ(GLCommandBuffer::recorder(), nullptr);
+    EXPECT_EQ(commands.commands(), 6);
+    // change the state behind the back of the buffer and replay
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    commands.setTextureSlot(slot, tex[2]);
+    commands.replay();
+    GLint bound = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+    EXPECT_EQ((GLuint)bound, tex[2]);
+    uint8_t pixel[4] = {0};
+    glReadPixels(0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+    EXPECT_EQ(pixel[0], 255);
+    EXPECT_EQ(pixel[1], 0);
+    EXPECT_EQ(pixel[3], 255);
+    GLStateCache::bindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLStateCache::bindTexture(GL_TEXTURE_2D, 0);
+    GLStateCache::deleteFramebuffers(1, &fbo);
+    GLStateCache::deleteTextures(3, tex);
+}
+
+TEST(FloatConversionTest, BulkFP16RoundTrip) {
+    // large enough to trigger the chunked / parallel code path, odd size to exercise the tail
+    const size_t entries = (1 << 19) + 7;
+    std::vector<float> input(entries);
+    for (size_t i=0; i < entries; i++) input[i] = (float)((int)(i % 2001) - 1000) / 16.0f;
+    std::vector<uint16_t> half(entries);
+    std::vector<float> output(entries);
+    FloatConversion * conv = FloatConversion::getInstance();
+    conv->toFP16(input.data(), half.data(), entries);
+    conv->toFP32(half.data(), output.data(), entries);
+    for (size_t i=0; i < entries; i++) {
+        ASSERT_EQ(input[i], output[i]);
+        ASSERT_EQ(FloatConversion::toFP32(half[i]), output[i]);
+    }
+}
+
+
+TEST(CPUBufferTest, LayoutConversion) {
+    using order = BufferShape::order;
+    // shallow (with padding and a partial last channel block) and deep (multiple tiles)
+    for (order ord : {order::GPU_SHALLOW, order::GPU_DEEP}) {
+        int pad = (ord == order::GPU_SHALLOW) ? 1 : 0;
+        BufferShape shape(37, 53, 10, pad, BufferShape::type::FLOAT32, order::CHANNELWISE);
+        std::unique_ptr<cpu::CPUBuffer> chan(shape.createCPUBuffer());
+        float * data = chan->map<float>();
+        int lwidth = 53 + 2 * pad, lheight = 37 + 2 * pad;
+        for (int c=0; c < 10; c++) {
+            for (int y=0; y < lheight; y++) {
+                for (int x=0; x < lwidth; x++) {
+                    bool border = (x < pad) || (y < pad) || (x >= lwidth - pad) || (y >= lheight - pad);
+                    data[(c * lheight + y) * lwidth + x] = (border) ? 0.f : (float)(c * 10000 + y * 100 + x) / 16.f;
+                }
+            }
+        }
+        chan->unmap();
+        std::unique_ptr<cpu::CPUBuffer> gpu((ord == order::GPU_SHALLOW) ? chan->toGPUShallow() : chan->toGPUDeep());
+        ASSERT_EQ(gpu->shape().dataOrder(), ord);
+        std::unique_ptr<cpu::CPUBuffer> back(gpu->toChannelWise());
+        std::vector<uint16_t> half(shape.bytes() / sizeof(float));
+        gpu->toChannelWiseFP16(half.data());
+        const float * ref = chan->map<float>();
+        const float * res = back->map<float>();
+        for (size_t i=0; i < half.size(); i++) {
+            ASSERT_EQ(ref[i], res[i]);
+            ASSERT_NEAR(FloatConversion::toFP32(half[i]), ref[i], fabs(ref[i]) * 1e-3f);
+        }
+        back->unmap();
+        chan->unmap();
+        // FP16 input must end up in the same GPU layout
+        std::unique_ptr<cpu::CPUBuffer> gpuhalf(gpu->shape().createCPUBuffer());
+        gpuhalf->fromChannelWiseFP16(half.data());
+        std::unique_ptr<cpu::CPUBuffer> backhalf(gpuhalf->toChannelWise());
+        const float * reshalf = backhalf->map<float>();
+        for (size_t i=0; i < half.size(); i++) ASSERT_EQ(reshalf[i], FloatConversion::toFP32(half[i]));
+        backhalf->unmap();
+    }
+}
+
+
+TEST(CPUBufferTest, ShallowRoundTrip) {
+    using order = BufferShape::order;
+    // channel counts that are not a multiple of 4 must still use a stride of 4 in the GPU layout
+    for (int channels : {5, 7}) {
+        const int pad = 1, width = 19, height = 11;
+        const int lwidth = width + 2 * pad, lheight = height + 2 * pad;
+        const int blocks = (channels + PIXEL_PACKING - 1) / PIXEL_PACKING;
+        const size_t planesize = (size_t)lwidth * lheight;
+        std::vector<float> raw(blocks * planesize * PIXEL_PACKING, 0.f);
+        std::vector<float> ref(channels * planesize, 0.f);
+        for (int c=0; c < channels; c++) {
+            for (int y=pad; y < lheight - pad; y++) {
+                for (int x=pad; x < lwidth - pad; x++) {
+                    float val = (float)(c * 10000 + y * 100 + x);
+                    ref[c * planesize + y * lwidth + x] = val;
+                    raw[((c / PIXEL_PACKING) * planesize + y * lwidth + x) * PIXEL_PACKING + (c % PIXEL_PACKING)] = val;
+                }
+            }
+        }
+        BufferShape shape(height, width, channels, pad, BufferShape::type::FLOAT32, order::CHANNELWISE);
+        std::unique_ptr<cpu::CPUBuffer> chan(shape.cpuFromRawBuffer<float>(raw.data(), order::GPU_SHALLOW, pad));
+        ASSERT_NE(chan, nullptr);
+        const float * res = chan->map<float>();
+        for (size_t i=0; i < ref.size(); i++) ASSERT_EQ(res[i], ref[i]);
+        chan->unmap();
+        std::unique_ptr<cpu::CPUBuffer> gpu(chan->toGPUShallow());
+        ASSERT_EQ(gpu->bytes(), raw.size() * sizeof(float));
+        const float * back = gpu->map<float>();
+        for (size_t i=0; i < raw.size(); i++) ASSERT_EQ(back[i], raw[i]);
+        gpu->unmap();
+    }
+}
+
 // TODO (mw) more test patterns, maybe fuzz-testing with randomization
 
 INSTANTIATE_TEST_CASE_P(ArgMax, ArgMaxTest, testing::Values(
@@ -9,16 +9,22 @@
 //--------------------------------------- System Headers -------------------------------------------
 
 #include <cstdint>
+#include <cstring>
+#include <vector>
 #include <cmath>
 #include <fstream>
 #include <atomic>
 #include <memory>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
 
 //-------------------------------------- Project  Headers ------------------------------------------
 
 #include <gtest/gtest.h>
 #include <fyusenet/fyusenet.h>
+#include <fyusenet/cpu/reducelayerbuilder.h>
 #include "gltesthelpers.h"
 #include "layertestbase.h"
 
@@ -61,7 +67,8 @@ class NetworkTestBase : public ::testing::Test, public TestContextManager {
  */
 class TestNet01 : public fyusion::fyusenet::NeuralNetwork {
  public:
-    TestNet01(bool async=false) : async_(async) {
+    TestNet01(bool async=false, const fyusion::fyusenet::GfxContextLink & ctx = fyusion::fyusenet::GfxContextLink()) :
+        NeuralNetwork(ctx), async_(async) {
     }
 
     ~TestNet01() {
@@ -99,10 +106,23 @@ class TestNet01 : public fyusion::fyusenet::NeuralNetwork {
         auto * layer = layers["conv3x3"];
         ASSERT_NE(layer, nullptr);
         SingleWeightProvider wsource(wb + 8, wb);
+        if (shareWeights_) wsource.setWeightStore(sharedWeights());
         layer->loadParameters(&wsource);
     }
 
+    /**
+     * @brief Value of the input tensor at the supplied (linear) index
+     */
+    virtual float inputValue(int index) const {
+        return 1.0f;
+    }
+
     void setInputOutput() {
+        setInput();
+        setOutput();
+    }
+
+    void setInput() {
         using namespace fyusion::fyusenet;
         using namespace fyusion::fyusenet::cpu;
         CompiledLayers & layers = engine_->getLayers();
@@ -116,21 +136,27 @@ class TestNet01 : public fyusion::fyusenet::NeuralNetwork {
         inputBuffer = new CPUBuffer(BufferShape(inspec.height_, inspec.width_, inspec.channels_, 0, BufferShape::type::FLOAT32, BufferShape::order::GPU_SHALLOW));
         float * in = inputBuffer->map<float>();
         ASSERT_NE(nullptr, in);
-        for (int i=0; i < inspec.width_*inspec.height_*inspec.channels_; i++) in[i] = 1.0f;
+        for (int i=0; i < inspec.width_*inspec.height_*inspec.channels_; i++) in[i] = inputValue(i);
         inputBuffer->unmap();
 
         ASSERT_NE(dynamic_cast<cpu::CPULayerInterface *>(layer), nullptr);
         (dynamic_cast<cpu::CPULayerInterface *>(layer))->setCPUInputBuffer(inputBuffer, 0);
+    }
 
-        layer = layers["download"];
+    virtual void setOutput() {
+        using namespace fyusion::fyusenet;
+        using namespace fyusion::fyusenet::cpu;
+        CompiledLayers & layers = engine_->getLayers();
+
+        LayerBase * layer = layers["download"];
         ASSERT_NE(layer, nullptr);
-        specs = layer->getRequiredOutputBuffers();
+        auto specs = layer->getRequiredOutputBuffers();
         ASSERT_EQ(specs.size(), 1ul);
         const BufferSpec & outspec = specs[0];
 
-        outputBuffer = new CPUBuffer(BufferShape(outspec.height_, outspec.width_, outspec.channels_, 0, BufferShape::type::FLOAT32, BufferShape::order::GPU_SHALLOW));
+        outputBuffer = new CPUBuffer(BufferShape(outspec.height_, outspec.width_, outspec.channels_, 0, BufferShape::type::FLOAT32, outspec.dataOrder_));
         float * out = outputBuffer->map<float>();
-        ASSERT_NE(nullptr, in);
+        ASSERT_NE(nullptr, out);
         for (int i=0; i < outspec.width_*outspec.height_*outspec.channels_; i++) out[i] = 1.0f;
         outputBuffer->unmap();
 
@@ -139,24 +165,36 @@ class TestNet01 : public fyusion::fyusenet::NeuralNetwork {
     }
 
     virtual fyusion::fyusenet::CompiledLayers buildLayers() override {
+        std::shared_ptr<fyusion::fyusenet::LayerFactory> factory = getLayerFactory();
+        pushLayers(factory);
+        return factory->compileLayers();
+    }
+
+    virtual void pushLayers(std::shared_ptr<fyusion::fyusenet::LayerFactory> & factory) {
         using namespace fyusion::fyusenet;
-        std::shared_ptr<LayerFactory> factory = getLayerFactory();
         gpu::UpDownLayerBuilder * up = new gpu::UpDownLayerBuilder(gpu::UpDownLayerBuilder::UPLOAD, "upload");
-        up->shape(4, 32, 32, 4).context(context_).number(1);
+        up->shape(4, height_, width_, 4).context(context_).number(1);
 #ifdef FYUSENET_MULTITHREADING
-        if (async_) up->async();
+        if (async_) {
+            up->async(std::max(2, pipelineDepth()));
+            if (uploadCallback_) up->callback(uploadCallback_);
+        }
 #endif
         up->push(factory);
         gpu::ConvLayerBuilder * conv = new gpu::ConvLayerBuilder(3, "conv3x3");
-        conv->shape(8, 32, 32, 4).type(LayerType::CONVOLUTION2D).context(context_).number(2);
+        conv->shape(outputChannels_, height_, width_, 4).type(LayerType::CONVOLUTION2D).context(context_).number(2);
+        if (deep_) conv->deep();
         conv->push(factory);
         gpu::UpDownLayerBuilder * down = new gpu::UpDownLayerBuilder(gpu::UpDownLayerBuilder::DOWNLOAD, "download");
-        down->shape(8, 32, 32, 8).context(context_).number(3);
+        down->shape(outputChannels_, height_, width_, outputChannels_).context(context_).number(3);
+        if (deep_) down->deep();
 #ifdef FYUSENET_MULTITHREADING
-        if (async_) down->async();
+        if (async_) {
+            down->async();
+            if (downloadCallback_) down->callback(downloadCallback_);
+        }
 #endif
         down->push(factory);
-        return factory->compileLayers();
     }
 
     virtual void connectLayers(fyusion::fyusenet::CompiledLayers& layers, fyusion::fyusenet::BufferManager * buffers) override {
@@ -165,9 +203,260 @@ class TestNet01 : public fyusion::fyusenet::NeuralNetwork {
     }
 
     bool async_= false;
+    bool shareWeights_ = false;
+    bool deep_ = false;
+    int outputChannels_ = 8;
+    int width_ = 32;
+    int height_ = 32;
+    std::function<void(uint64_t, fyusion::fyusenet::cpu::CPUBuffer *, fyusion::fyusenet::AsyncLayer::state)> uploadCallback_;
+    std::function<void(uint64_t, fyusion::fyusenet::cpu::CPUBuffer *, fyusion::fyusenet::AsyncLayer::state)> downloadCallback_;
+};
+
+
+/**
+ * @brief Variant of TestNet01 that supports changing the input resolution
+ */
+class ResizableTestNet01 : public TestNet01 {
+ public:
+    ResizableTestNet01(int width=32, int height=32) {
+        width_ = width;
+        height_ = height;
+        // only deep convolution layers take their weights from a weight store
+        deep_ = true;
+        shareWeights_ = true;
+    }
+
+    ~ResizableTestNet01() {
+        for (auto * buf : retired_) delete buf;
+    }
+
+    void switchResolution(int width, int height) {
+        resize(width, height);
+        attachBuffers();
+    }
+
+    void attachBuffers() {
+        using namespace fyusion::fyusenet;
+        // parked engines may still refer to the old buffers, keep them alive
+        auto * down = dynamic_cast<cpu::CPULayerInterface *>(engine_->getLayers()["download"]);
+        ASSERT_NE(down, nullptr);
+        down->clearCPUOutputBuffers(0);
+        setInputOutput();
+    }
+
+    fyusion::fyusenet::gpu::WeightStore * weights() {
+        return sharedWeights();
+    }
+
+    std::pair<int,int> inputResolution() const override {
+        return {width_, height_};
+    }
+
+    bool failBuild = false;
+
+ protected:
+    float inputValue(int index) const override {
+        return (float)((index * 7) % 13) - 6.0f;
+    }
+
+    void setInputResolution(int width, int height) override {
+        retired_.push_back(inputBuffer);
+        retired_.push_back(outputBuffer);
+        inputBuffer = nullptr;
+        outputBuffer = nullptr;
+        width_ = width;
+        height_ = height;
+    }
+
+    fyusion::fyusenet::CompiledLayers buildLayers() override {
+        if (failBuild) THROW_EXCEPTION_ARGS(fyusion::FynException, "Simulated build failure");
+        return TestNet01::buildLayers();
+    }
 
+    std::vector<fyusion::fyusenet::cpu::CPUBuffer *> retired_;
 };
 
+
+/**
+ * @brief Variant of TestNet01 that adds a CPU reduction layer behind the download layer
+ *
+ * In asynchronous mode, the reduction layer depends on the (background) download of the same
+ * sequence, which exercises the download dependencies of the engine.
+ */
+class TestNet02 : public TestNet01 {
+ public:
+    explicit TestNet02(bool async=false) : TestNet01(async) {
+        // padded to 8 channels by the download layer, which is what the reduction layer consumes
+        outputChannels_ = 6;
+        // large enough for the readout to be still running when the reduction layer is reached
+        width_ = 512;
+        height_ = 512;
+    }
+
+    ~TestNet02() {
+        delete outputBuffer;
+    }
+
+    fyusion::fyusenet::cpu::CPUBuffer * downloadBuffer = nullptr;
+
+ protected:
+    float inputValue(int index) const override {
+        return (float)((index * 5) % 11) - 5.0f;
+    }
+
+    void pushLayers(std::shared_ptr<fyusion::fyusenet::LayerFactory> & factory) override {
+        using namespace fyusion::fyusenet;
+        TestNet01::pushLayers(factory);
+        auto * reduce = new cpu::ReduceLayerBuilder(cpu::ReduceLayerBuilder::NORM_L1, "reduce");
+        reduce->shape(1, height_, width_, 8).type(LayerType::REDUCE).number(4);
+        reduce->push(factory);
+    }
+
+    void connectLayers(fyusion::fyusenet::CompiledLayers& layers, fyusion::fyusenet::BufferManager * buffers) override {
+        TestNet01::connectLayers(layers, buffers);
+        buffers->connectLayers(layers[3], layers[4], 0);
+    }
+
+    void setOutput() override {
+        using namespace fyusion::fyusenet;
+        using namespace fyusion::fyusenet::cpu;
+        CompiledLayers & layers = engine_->getLayers();
+        auto * down = dynamic_cast<CPULayerInterface *>(layers["download"]);
+        ASSERT_NE(down, nullptr);
+        downloadBuffer = down->getCPUOutputBuffer(0);
+        ASSERT_NE(downloadBuffer, nullptr);
+        auto * reduce = dynamic_cast<CPULayerInterface *>(layers["reduce"]);
+        ASSERT_NE(reduce, nullptr);
+        auto specs = layers["reduce"]->getRequiredOutputBuffers();
+        ASSERT_EQ(specs.size(), 1ul);
+        outputBuffer = new CPUBuffer(BufferShape(specs[0].height_, specs[0].width_, specs[0].channels_, 0, BufferShape::type::FLOAT32, specs[0].dataOrder_));
+        reduce->addCPUOutputBuffer(outputBuffer, 0);
+    }
+};
+
+
+/**
+ * @brief Variant of TestNet01 that feeds a different input to every frame
+ *
+ * Each frame has its own input and output buffer. In asynchronous mode, the output buffer of the
+ * download layer is switched to the one of the next frame as soon as the download of the current
+ * frame commenced, and the input buffer is only switched after the upload of the previous frame
+ * commenced (see the warning on gpu::UploadLayer::setCPUInputBuffer).
+ */
+class FrameTestNet01 : public TestNet01 {
+ public:
+    FrameTestNet01(int frames, bool async=false) : TestNet01(async), frames_(frames) {
+        uploadCallback_ = [this](uint64_t, fyusion::fyusenet::cpu::CPUBuffer *, fyusion::fyusenet::AsyncLayer::state state) {
+            if (state == fyusion::fyusenet::AsyncLayer::UPLOAD_COMMENCED) {
+                std::lock_guard<std::mutex> lck(uploadLock_);
+                uploadBusy_ = false;
+                uploadAvail_.notify_one();
+            }
+        };
+        downloadCallback_ = [this](uint64_t seq, fyusion::fyusenet::cpu::CPUBuffer *, fyusion::fyusenet::AsyncLayer::state state) {
+            // sequence numbers start at 1, the buffer for the first frame is set in setOutput()
+            if ((state == fyusion::fyusenet::AsyncLayer::DOWNLOAD_COMMENCED) && ((int)seq < frames_)) {
+                auto * down = dynamic_cast<fyusion::fyusenet::gpu::DownloadLayer *>(engine_->getLayers()["download"]);
+                down->updateOutputBuffer(frameOutputs[seq], 0);
+            }
+        };
+    }
+
+    ~FrameTestNet01() {
+        for (auto * buf : frameInputs) delete buf;
+        for (auto * buf : frameOutputs) delete buf;
+    }
+
+    /**
+     * @brief Set the input (and in synchronous mode also the output) buffer for the next frame
+     *
+     * @param frame Frame index (0-based), must be called in frame order before running the frame
+     */
+    void selectFrame(int frame) {
+        using namespace fyusion::fyusenet;
+        auto * up = dynamic_cast<cpu::CPULayerInterface *>(engine_->getLayers()["upload"]);
+        ASSERT_NE(up, nullptr);
+        if (async_) {
+            std::unique_lock<std::mutex> lck(uploadLock_);
+            ASSERT_TRUE(uploadAvail_.wait_for(lck, std::chrono::seconds(5), [this]() { return !uploadBusy_; }));
+            up->setCPUInputBuffer(frameInputs.at(frame), 0);
+            uploadBusy_ = true;
+        } else {
+            up->setCPUInputBuffer(frameInputs.at(frame), 0);
+            auto * down = dynamic_cast<gpu::DownloadLayer *>(engine_->getLayers()["download"]);
+            ASSERT_NE(down, nullptr);
+            down->updateOutputBuffer(frameOutputs.at(frame), 0);
+        }
+    }
+
+    std::vector<fyusion::fyusenet::cpu::CPUBuffer *> frameInputs;
+    std::vector<fyusion::fyusenet::cpu::CPUBuffer *> frameOutputs;
+
+ protected:
+
+    static float frameValue(int frame, int index) {
+        return (float)((index * 7 + frame * 3) % 13) - 6.0f;
+    }
+
+    void setOutput() override {
+        using namespace fyusion::fyusenet;
+        using namespace fyusion::fyusenet::cpu;
+        CompiledLayers & layers = engine_->getLayers();
+        const BufferSpec inspec = layers["upload"]->getRequiredInputBuffers().at(0);
+        const BufferSpec outspec = layers["download"]->getRequiredOutputBuffers().at(0);
+        for (int frame=0; frame < frames_; frame++) {
+            auto * in = new CPUBuffer(BufferShape(inspec.height_, inspec.width_, inspec.channels_, 0, BufferShape::type::FLOAT32, BufferShape::order::GPU_SHALLOW));
+            float * ptr = in->map<float>();
+            ASSERT_NE(ptr, nullptr);
+            for (int i=0; i < inspec.width_*inspec.height_*inspec.channels_; i++) ptr[i] = frameValue(frame, i);
+            in->unmap();
+            frameInputs.push_back(in);
+            auto * out = new CPUBuffer(BufferShape(outspec.height_, outspec.width_, outspec.channels_, 0, BufferShape::type::FLOAT32, outspec.dataOrder_));
+            ptr = out->map<float>();
+            ASSERT_NE(ptr, nullptr);
+            memset(ptr, 0, out->bytes());
+            out->unmap();
+            frameOutputs.push_back(out);
+        }
+        auto * down = dynamic_cast<CPULayerInterface *>(layers["download"]);
+        ASSERT_NE(down, nullptr);
+        down->addCPUOutputBuffer(frameOutputs[0], 0);
+    }
+
+    int frames_;
+    bool uploadBusy_ = false;
+    std::mutex uploadLock_;
+    std::condition_variable uploadAvail_;
+};
+
+
+/**
+ * @brief Check output of a (resized) network against a network that was built for that resolution
+ */
+static void compareToFreshNetwork(ResizableTestNet01& net) {
+    using namespace fyusion::fyusenet;
+    auto [width, height] = net.inputResolution();
+    ResizableTestNet01 fresh(width, height);
+    fresh.setup();
+    EXPECT_EQ(fresh.forward().status, NeuralNetwork::state::EXEC_DONE);
+    EXPECT_EQ(net.outputBuffer->shape().width(), fresh.outputBuffer->shape().width());
+    EXPECT_EQ(net.outputBuffer->shape().height(), fresh.outputBuffer->shape().height());
+    int mismatch = 0, nonzero = 0;
+    if (net.outputBuffer->bytes() == fresh.outputBuffer->bytes()) {
+        const float * res = net.outputBuffer->map<float>();
+        const float * ref = fresh.outputBuffer->map<float>();
+        for (int i=0; i < (int)(net.outputBuffer->bytes() / sizeof(float)); i++) {
+            if (fabsf(res[i] - ref[i]) > 1e-4f) mismatch++;
+            if (ref[i] != 0.f) nonzero++;
+        }
+        fresh.outputBuffer->unmap();
+        net.outputBuffer->unmap();
+    } else mismatch = -1;
+    fresh.cleanup();
+    ASSERT_EQ(mismatch, 0) << "resolution " << width << "x" << height;
+    ASSERT_GT(nonzero, 0);
+}
+
 //-----------------------------------------------------------------------------
 // Test Fixtures
 //-----------------------------------------------------------------------------
@@ -187,7 +476,123 @@ TEST_F(NetworkTestBase, SimpleSyncTest01GC) {
     net.cleanup();
 }
 
+TEST_F(NetworkTestBase, ResizeSyncTest01GC) {
+    using namespace fyusion::fyusenet;
+    ResizableTestNet01 net;
+    net.setResolutionCacheSize(2);
+    net.setup();
+    ASSERT_EQ(net.forward().status, NeuralNetwork::state::EXEC_DONE);
+    compareToFreshNetwork(net);
+    ASSERT_EQ(net.weights()->hits(), 0u);
+    // new resolution, back to the cached one, another new one and a cached one that is not the most recent
+    const int sizes[4][2] = {{48, 24}, {32, 32}, {16, 40}, {48, 24}};
+    for (int s=0; s < 4; s++) {
+        net.switchResolution(sizes[s][0], sizes[s][1]);
+        NeuralNetwork::execstate st = net.forward();
+        ASSERT_EQ(st.status, NeuralNetwork::state::EXEC_DONE);
+        // sequence numbers continue across resolutions
+        ASSERT_EQ(st.sequenceNo, (uint64_t)(s + 2));
+        compareToFreshNetwork(net);
+    }
+    // only the two new resolutions were built and took their weights from the store
+    ASSERT_EQ(net.weights()->hits(), 2u);
+    ASSERT_EQ(net.weights()->textures(), 1u);
+    net.cleanup();
+}
+
+TEST_F(NetworkTestBase, ResizeFailureSyncTest01GC) {
+    using namespace fyusion::fyusenet;
+    ResizableTestNet01 net;
+    net.setup();
+    ASSERT_EQ(net.forward().status, NeuralNetwork::state::EXEC_DONE);
+    net.failBuild = true;
+    ASSERT_THROW(net.switchResolution(48, 24), fyusion::FynException);
+    net.failBuild = false;
+    // network stays usable at its previous resolution
+    ASSERT_EQ(net.inputResolution(), std::make_pair(32, 32));
+    net.attachBuffers();
+    NeuralNetwork::execstate st = net.forward();
+    ASSERT_EQ(st.status, NeuralNetwork::state::EXEC_DONE);
+    ASSERT_EQ(st.sequenceNo, (uint64_t)2);
+    compareToFreshNetwork(net);
+    net.switchResolution(48, 24);
+    ASSERT_EQ(net.forward().status, NeuralNetwork::state::EXEC_DONE);
+    compareToFreshNetwork(net);
+    net.switchResolution(32, 32);
+    ASSERT_EQ(net.forward().status, NeuralNetwork::state::EXEC_DONE);
+    compareToFreshNetwork(net);
+    net.cleanup();
+}
+
+TEST_F(NetworkTestBase, ReplaySyncTest01GC) {
+    using namespace fyusion::fyusenet;
+    TestNet01 replay, live;
+    replay.setCommandReplay(true);
+    replay.setup();
+    live.setup();
+    const int outsize = 32 * 32 * 8;
+    for (int run=0; run < 4; run++) {
+        // change the input on every run, a replay that does nothing would yield stale results
+        for (TestNet01 * net : {&replay, &live}) {
+            float * in = net->inputBuffer->map<float>();
+            ASSERT_NE(in, nullptr);
+            for (int i=0; i < (int)(net->inputBuffer->bytes() / sizeof(float)); i++) in[i] = (float)((i * 7 + run * 13) % 11);
+            net->inputBuffer->unmap();
+            ASSERT_EQ(net->forward().status, NeuralNetwork::state::EXEC_DONE);
+        }
+        std::vector<float> expected(outsize);
+        const float * res = live.outputBuffer->map<float>();
+        ASSERT_NE(res, nullptr);
+        memcpy(expected.data(), res, outsize * sizeof(float));
+        live.outputBuffer->unmap();
+        res = replay.outputBuffer->map<float>();
+        ASSERT_NE(res, nullptr);
+        bool nonzero = false;
+        for (int i=0; i < outsize; i++) {
+            ASSERT_EQ(res[i], expected[i]) << "run " << run << " index " << i;
+            nonzero |= (res[i] != 0.f);
+        }
+        replay.outputBuffer->unmap();
+        ASSERT_TRUE(nonzero);
+    }
+    replay.cleanup();
+    live.cleanup();
+}
+
 #ifdef FYUSENET_MULTITHREADING
+TEST_F(NetworkTestBase, DispatcherTest01GC) {
+    using namespace fyusion::fyusenet;
+    // on single-GPU systems, device 1 is mapped onto the same GPU with its own contexts
+    NetworkDispatcher disp({0, 1}, [](const GfxContextLink & ctx, int replica) {
+        return new TestNet01(false, ctx);
+    });
+    disp.setup();
+    ASSERT_EQ(disp.replicas(), 2);
+    std::mutex lock;
+    std::vector<uint64_t> tickets;
+    int errors = 0;
+    const int runs = 16;
+    for (int i=0; i < runs; i++) {
+        disp.submit(nullptr, [&](uint64_t ticket, NeuralNetwork * net, int replica, const NeuralNetwork::execstate & st) {
+            auto * tnet = static_cast<TestNet01 *>(net);
+            const float * res = tnet->outputBuffer->map<float>();
+            bool ok = (st.status == NeuralNetwork::state::EXEC_DONE) && (res != nullptr);
+            for (int j=0; (ok) && (j < 32*32*8); j++) ok = (res[j] == 0.f);
+            if (res) tnet->outputBuffer->unmap();
+            std::lock_guard<std::mutex> lck(lock);
+            tickets.push_back(ticket);
+            if (!ok) errors++;
+        });
+    }
+    disp.finish();
+    disp.cleanup();
+    ASSERT_EQ(errors, 0);
+    ASSERT_EQ((int)tickets.size(), runs);
+    ASSERT_EQ(disp.processed(0) + disp.processed(1), (uint64_t)runs);
+    ASSERT_GT(disp.processed(0), 0u);
+    ASSERT_GT(disp.processed(1), 0u);
+}
+
 TEST_F(NetworkTestBase, SimpleAsyncTest01GC) {
     using namespace fyusion::fyusenet;
     TestNet01 net(true);
@@ -204,6 +609,107 @@ TEST_F(NetworkTestBase, SimpleAsyncTest01GC) {
     net.outputBuffer->unmap();
     net.cleanup();
 }
+
+TEST_F(NetworkTestBase, PipelinedAsyncTest01GC) {
+    using namespace fyusion::fyusenet;
+    const int runs = 8;
+    // reference results from synchronous runs, one per frame
+    FrameTestNet01 ref(runs);
+    ref.setup();
+    std::vector<std::vector<float>> expected(runs);
+    for (int run=0; run < runs; run++) {
+        ref.selectFrame(run);
+        ASSERT_EQ(ref.forward().status, NeuralNetwork::state::EXEC_DONE);
+        expected[run].resize(ref.frameOutputs[run]->bytes() / sizeof(float));
+        const float * refout = ref.frameOutputs[run]->map<float>();
+        ASSERT_NE(refout, nullptr);
+        memcpy(expected[run].data(), refout, expected[run].size() * sizeof(float));
+        ref.frameOutputs[run]->unmap();
+    }
+    ref.cleanup();
+    // make sure that the frames can be told apart
+    for (int run=1; run < runs; run++) {
+        ASSERT_NE(expected[run], expected[run-1]);
+    }
+    FrameTestNet01 net(runs, true);
+    net.asynchronous(NeuralNetwork::AsyncAdapter().pipelineDepth(3));
+    net.setup();
+    ASSERT_EQ(net.pipelineDepth(), 3);
+    for (int run=0; run < runs; run++) {
+        net.selectFrame(run);
+        NeuralNetwork::execstate st = net.forward();
+        ASSERT_NE(st.status, NeuralNetwork::state::EXEC_ERROR);
+    }
+    NeuralNetwork::execstate st = net.finish();
+    ASSERT_EQ(st.status, NeuralNetwork::state::EXEC_DONE);
+    ASSERT_EQ(st.sequenceNo, (uint64_t)runs);
+    for (int run=0; run < runs; run++) {
+        ASSERT_EQ(net.frameOutputs[run]->sequence(), (uint64_t)(run+1));
+        const float * res = net.frameOutputs[run]->map<float>();
+        ASSERT_NE(res, nullptr);
+        for (int i=0; i < (int)expected[run].size(); i++) {
+            ASSERT_EQ(res[i], expected[run][i]) << "frame " << run << " index " << i;
+        }
+        net.frameOutputs[run]->unmap();
+    }
+    net.cleanup();
+}
+
+TEST_F(NetworkTestBase, PipelinedDownloadDependencyTest02GC) {
+    using namespace fyusion::fyusenet;
+    // reference result from a synchronous run
+    TestNet02 ref;
+    ref.setup();
+    ASSERT_EQ(ref.forward().status, NeuralNetwork::state::EXEC_DONE);
+    std::vector<float> expected(ref.outputBuffer->bytes() / sizeof(float));
+    const float * refout = ref.outputBuffer->map<float>();
+    ASSERT_NE(refout, nullptr);
+    memcpy(expected.data(), refout, expected.size() * sizeof(float));
+    ref.outputBuffer->unmap();
+    ref.cleanup();
+    // the engine thread reports the completed sequences right after the reduction layer ran
+    std::mutex lock;
+    std::vector<uint64_t> completed;
+    std::vector<uint64_t> downloaded;
+    TestNet02 net(true);
+    net.asynchronous(NeuralNetwork::AsyncAdapter().pipelineDepth(3).sequenceDone([&](uint64_t seq) {
+        std::lock_guard<std::mutex> lck(lock);
+        completed.push_back(seq);
+        downloaded.push_back(net.downloadBuffer->sequence());
+    }));
+    net.setup();
+    ASSERT_EQ(net.pipelineDepth(), 3);
+    const int runs = 8;
+    for (int run=0; run < runs; run++) {
+        NeuralNetwork::execstate st = net.forward();
+        ASSERT_NE(st.status, NeuralNetwork::state::EXEC_ERROR);
+    }
+    NeuralNetwork::execstate st = net.finish();
+    std::vector<float> result(expected.size());
+    const float * res = net.outputBuffer->map<float>();
+    if (res) memcpy(result.data(), res, result.size() * sizeof(float));
+    net.outputBuffer->unmap();
+    // NOTE (mw) the sequence callback may still be running after finish() returned, cleaning up the
+    // network also stops the engine thread
+    net.cleanup();
+    ASSERT_NE(res, nullptr);
+    ASSERT_EQ(st.status, NeuralNetwork::state::EXEC_DONE);
+    ASSERT_EQ(st.sequenceNo, (uint64_t)runs);
+    ASSERT_FALSE(completed.empty());
+    ASSERT_EQ(completed.back(), (uint64_t)runs);
+    for (size_t i=0; i < completed.size(); i++) {
+        if (i > 0) {
+            EXPECT_GT(completed[i], completed[i-1]);
+        }
+        // the reduction layer must not run before the download of its own sequence has finished
+        EXPECT_GE(downloaded[i], completed[i]) << "sequence " << completed[i];
+    }
+    int mismatches = 0;
+    for (int i=0; i < (int)expected.size(); i++) {
+        if (result[i] != expected[i]) mismatches++;
+    }
+    ASSERT_EQ(mismatches, 0);
+}
 #endif
 
 